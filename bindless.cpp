@@ -0,0 +1,147 @@
+#include "bindless.h"
+#include "bindless_types.h"
+
+#include <algorithm>
+#include <iostream>
+
+BindlessResources::BindlessResources(MTL::Device *device, uint32_t frames_in_flight)
+    : d_buffers(BINDLESS_CAPACITY)
+    , d_textures(BINDLESS_CAPACITY)
+    , d_frames_in_flight(frames_in_flight) {
+    auto buffers = MTL::make_owned(MTL::ArgumentDescriptor::alloc()->init());
+    buffers->setDataType(MTL::DataTypePointer);
+    buffers->setIndex(BindlessTableIndexBuffers);
+    buffers->setArrayLength(BINDLESS_CAPACITY);
+    buffers->setAccess(MTL::ArgumentAccessReadOnly);
+
+    auto textures = MTL::make_owned(MTL::ArgumentDescriptor::alloc()->init());
+    textures->setDataType(MTL::DataTypeTexture);
+    textures->setIndex(BindlessTableIndexTextures);
+    textures->setArrayLength(BINDLESS_CAPACITY);
+    textures->setTextureType(MTL::TextureType2D);
+    textures->setAccess(MTL::ArgumentAccessReadOnly);
+
+    const NS::Object *arguments[] = { buffers.get(), textures.get() };
+
+    d_encoder = MTL::make_owned(device->newArgumentEncoder(NS::Array::array(arguments, 2)));
+
+    if (!d_encoder) {
+        std::cerr << "Failed to create argument encoder" << std::endl;
+        std::exit(-1);
+    }
+
+    d_argument_buffer = MTL::make_owned(device->newBuffer(d_encoder->encodedLength(), MTL::ResourceStorageModeShared));
+    d_encoder->setArgumentBuffer(d_argument_buffer.get(), 0);
+}
+
+ResourceHandle
+BindlessResources::addBuffer(MTL::Buffer *buffer) {
+    auto handle = d_buffers.insert(MTL::shared_ptr<MTL::Buffer>(buffer));
+
+    if (handle.isValid()) {
+        d_encoder->setBuffer(buffer, 0, BindlessTableIndexBuffers + handle.index);
+        d_residency_dirty = true;
+    }
+
+    return handle;
+}
+
+ResourceHandle
+BindlessResources::addTexture(MTL::Texture *texture) {
+    auto handle = d_textures.insert(MTL::shared_ptr<MTL::Texture>(texture));
+
+    if (handle.isValid()) {
+        d_encoder->setTexture(texture, BindlessTableIndexTextures + handle.index);
+        d_residency_dirty = true;
+    }
+
+    return handle;
+}
+
+void
+BindlessResources::removeBuffer(ResourceHandle handle) {
+    if (d_buffers.contains(handle)) {
+        d_retired.push_back({ handle, false, d_frame });
+    }
+}
+
+void
+BindlessResources::removeTexture(ResourceHandle handle) {
+    if (d_textures.contains(handle)) {
+        d_retired.push_back({ handle, true, d_frame });
+    }
+}
+
+void
+BindlessResources::addHeap(MTL::Heap *heap) {
+    d_heaps.emplace_back(heap);
+    d_residency_dirty = true;
+}
+
+void
+BindlessResources::bind(MTL::RenderCommandEncoder *encoder, NS::UInteger index) {
+    if (d_residency_dirty) {
+        rebuildResidency();
+    }
+
+    encoder->setVertexBuffer(d_argument_buffer.get(), 0, index);
+    encoder->setFragmentBuffer(d_argument_buffer.get(), 0, index);
+
+    auto stages = MTL::RenderStageVertex | MTL::RenderStageFragment;
+
+    if (!d_resident.empty()) {
+        encoder->useResources(d_resident.data(), d_resident.size(), MTL::ResourceUsageRead, stages);
+    }
+
+    if (!d_resident_heaps.empty()) {
+        encoder->useHeaps(d_resident_heaps.data(), d_resident_heaps.size(), stages);
+    }
+}
+
+void
+BindlessResources::endFrame() {
+    ++d_frame;
+
+    auto expired = std::stable_partition(
+        d_retired.begin(), d_retired.end(),
+        [this](const Retired& retired) {
+            return d_frame - retired.frame < d_frames_in_flight;
+        });
+
+    // A handle removed twice is retired twice; by the second expiry its slot
+    // may hold a new resource, whose entry must stay.
+    for (auto it = expired; it != d_retired.end(); ++it) {
+        if (it->is_texture) {
+            if (d_textures.remove(it->handle)) {
+                d_encoder->setTexture(nullptr, BindlessTableIndexTextures + it->handle.index);
+                d_residency_dirty = true;
+            }
+        }
+        else if (d_buffers.remove(it->handle)) {
+            d_encoder->setBuffer(nullptr, 0, BindlessTableIndexBuffers + it->handle.index);
+            d_residency_dirty = true;
+        }
+    }
+
+    d_retired.erase(expired, d_retired.end());
+}
+
+void
+BindlessResources::rebuildResidency() {
+    d_resident.clear();
+    d_resident_heaps.clear();
+
+    d_buffers.forEach([this](uint32_t, const MTL::shared_ptr<MTL::Buffer>& buffer) {
+        d_resident.push_back(buffer.get());
+    });
+
+    d_textures.forEach([this](uint32_t, const MTL::shared_ptr<MTL::Texture>& texture) {
+        d_resident.push_back(texture.get());
+    });
+
+    for (const auto& heap : d_heaps) {
+        d_resident_heaps.push_back(heap.get());
+    }
+
+    d_residency_dirty = false;
+}
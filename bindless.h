@@ -0,0 +1,59 @@
+#pragma once
+
+#include "handle_table.h"
+
+#include <Metal/Metal.hpp>
+#include <Metal/shared_ptr.hpp>
+
+#include <vector>
+
+// Global argument buffer holding every registered buffer and texture. Draws
+// refer to resources by handle index rather than by per-draw bindings.
+class BindlessResources {
+public:
+
+    // `frames_in_flight` is how many `endFrame()` calls a removed slot waits
+    // before it can be reused, so the GPU never sees a slot change under it.
+    BindlessResources(MTL::Device *device, uint32_t frames_in_flight = 3);
+
+    ResourceHandle addBuffer(MTL::Buffer *buffer);
+    ResourceHandle addTexture(MTL::Texture *texture);
+
+    void removeBuffer(ResourceHandle handle);
+    void removeTexture(ResourceHandle handle);
+
+    // Heaps are made resident as a whole with `useHeaps`; resources allocated
+    // from them should still be added for their slots.
+    void addHeap(MTL::Heap *heap);
+
+    // Binds the argument buffer to both stages and declares residency for
+    // everything in it with one `useResources` and one `useHeaps` call.
+    void bind(MTL::RenderCommandEncoder *encoder, NS::UInteger index);
+
+    void endFrame();
+
+private:
+
+    struct Retired {
+        ResourceHandle handle;
+        bool is_texture;
+        uint64_t frame;
+    };
+
+    void rebuildResidency();
+
+    MTL::shared_ptr<MTL::ArgumentEncoder> d_encoder;
+    MTL::shared_ptr<MTL::Buffer> d_argument_buffer;
+
+    HandleTable<MTL::shared_ptr<MTL::Buffer>> d_buffers;
+    HandleTable<MTL::shared_ptr<MTL::Texture>> d_textures;
+    std::vector<MTL::shared_ptr<MTL::Heap>> d_heaps;
+
+    std::vector<Retired> d_retired;
+    uint64_t d_frame = 0;
+    uint32_t d_frames_in_flight;
+
+    std::vector<const MTL::Resource *> d_resident;
+    std::vector<const MTL::Heap *> d_resident_heaps;
+    bool d_residency_dirty = true;
+};
@@ -0,0 +1,28 @@
+/*
+Header containing types and enum constants shared between the bindless
+shaders and C++ code
+*/
+
+#ifndef bindless_types_H
+#define bindless_types_H
+
+#include <simd/simd.h>
+
+// Number of buffer slots and of texture slots in the global argument buffer.
+#define BINDLESS_CAPACITY 256
+
+// Argument buffer ids: all buffer slots first, then all texture slots.
+typedef enum BindlessTableIndex
+{
+    BindlessTableIndexBuffers  = 0,
+    BindlessTableIndexTextures = BINDLESS_CAPACITY,
+} BindlessTableIndex;
+
+// Per-draw slot indices, passed with setVertexBytes in place of bindings.
+typedef struct
+{
+    uint32_t vertices;
+    uint32_t viewportSize;
+} BindlessDrawArguments;
+
+#endif /* bindless_types_H */
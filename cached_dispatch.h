@@ -0,0 +1,98 @@
+#pragma once
+
+#include "method_cache.h"
+
+#include <Foundation/Foundation.hpp>
+#include <Metal/Metal.hpp>
+
+#include <objc/message.h>
+#include <objc/runtime.h>
+
+#include <type_traits>
+
+// `MethodCache` policy for the Objective-C runtime.
+struct ObjCRuntime {
+    using Class = ::Class;
+    using Selector = SEL;
+    using Imp = IMP;
+
+    static Imp methodImplementation(Class cls, SEL selector) {
+        return class_getMethodImplementation(cls, selector);
+    }
+
+    // Unimplemented selectors resolve to the forwarding trampoline, which
+    // expects to be entered the way objc_msgSend enters it.
+    static bool isCacheable(Imp imp) {
+        return imp && imp != (Imp)&_objc_msgForward;
+    }
+};
+
+namespace NS {
+
+// Sends one selector with a fixed signature. After the first message to a
+// given receiver class, later ones call that class's implementation directly
+// instead of going through objc_msgSend's method cache probe. Opt-in, for
+// calls hot enough for that probe to show up; see `invalidateMethodCaches()`
+// for when cached implementations must be dropped.
+template<typename Ret, typename... Args>
+class CachedMessage {
+public:
+
+    // An IMP called through a correctly typed pointer follows the normal C
+    // ABI, but forwarding falls back to objc_msgSend, which would need the
+    // _stret/_fpret variants for these.
+    static_assert(std::is_void<Ret>::value || std::is_integral<Ret>::value || std::is_pointer<Ret>::value,
+                  "CachedMessage only supports void, integral and pointer results");
+
+    explicit CachedMessage(SEL selector) : d_cache(selector) {
+    }
+
+    Ret operator()(const void *receiver, Args... args) {
+        using Proc = Ret (*)(const void *, SEL, Args...);
+
+        // Messages to nil do nothing and return zero.
+        if (!receiver) {
+            return Ret();
+        }
+
+        IMP imp = d_cache.lookup(object_getClass((id)receiver));
+        Proc proc = imp ? reinterpret_cast<Proc>(imp) : reinterpret_cast<Proc>(&objc_msgSend);
+
+        return proc(receiver, d_cache.selector(), args...);
+    }
+
+private:
+
+    MethodCache<ObjCRuntime> d_cache;
+};
+
+}
+
+// Cached-dispatch versions of the render encoder calls issued per draw.
+namespace CachedEncoder {
+
+inline void
+setRenderPipelineState(MTL::RenderCommandEncoder *encoder, const MTL::RenderPipelineState *pipeline) {
+    static NS::CachedMessage<void, const MTL::RenderPipelineState *> send(_MTL_PRIVATE_SEL(setRenderPipelineState_));
+    send(encoder, pipeline);
+}
+
+inline void
+setVertexBytes(MTL::RenderCommandEncoder *encoder, const void *bytes, NS::UInteger length, NS::UInteger index) {
+    static NS::CachedMessage<void, const void *, NS::UInteger, NS::UInteger> send(_MTL_PRIVATE_SEL(setVertexBytes_length_atIndex_));
+    send(encoder, bytes, length, index);
+}
+
+inline void
+setViewport(MTL::RenderCommandEncoder *encoder, MTL::Viewport viewport) {
+    static NS::CachedMessage<void, MTL::Viewport> send(_MTL_PRIVATE_SEL(setViewport_));
+    send(encoder, viewport);
+}
+
+inline void
+drawPrimitives(MTL::RenderCommandEncoder *encoder, MTL::PrimitiveType primitive_type, NS::UInteger vertex_start, NS::UInteger vertex_count, NS::UInteger instance_count) {
+    static NS::CachedMessage<void, MTL::PrimitiveType, NS::UInteger, NS::UInteger, NS::UInteger> send(_MTL_PRIVATE_SEL(drawPrimitives_vertexStart_vertexCount_instanceCount_));
+    send(encoder, primitive_type, vertex_start, vertex_count, instance_count);
+}
+
+}
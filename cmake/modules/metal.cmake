@@ -27,9 +27,19 @@ function(compile_metal_source src result)
     get_filename_component(src_base "${src}" NAME_WE)
     set(dot_metallib "${src_base}.metallib")
 
+    # Sources that need a newer language version than the default set the
+    # METAL_STANDARD source property, e.g. to macos-metal2.3.
+    get_source_file_property(metal_standard "${src}" METAL_STANDARD)
+    if(NOT metal_standard)
+        set(metal_standard macos-metal2.2)
+    endif()
+
+    # Recorded so --hot-reload can compile each source the same way.
+    set_property(GLOBAL APPEND PROPERTY METAL_SOURCE_STANDARDS "${src}=${metal_standard}")
+
     add_custom_command(
         OUTPUT ${CMAKE_CURRENT_BINARY_DIR}/${dot_metallib}
-        COMMAND ${METAL} -std=macos-metal2.2 -o ${CMAKE_CURRENT_BINARY_DIR}/${dot_metallib} ${src}
+        COMMAND ${METAL} -std=${metal_standard} -o ${CMAKE_CURRENT_BINARY_DIR}/${dot_metallib} ${src}
         MAIN_DEPENDENCY ${src}
         WORKING_DIRECTORY "${CMAKE_CURRENT_SOURCE_DIR}")
     message("Generated ${CMAKE_CURRENT_BINARY_DIR}/${dot_metallib}")
@@ -0,0 +1,117 @@
+#include "command_capture.h"
+#include "cached_dispatch.h"
+
+#include <Metal/Metal.hpp>
+
+void
+CapturingEncoder::setRenderPipelineState(const MTL::RenderPipelineState *pipeline, const char *name) {
+    if (d_cached_dispatch) {
+        CachedEncoder::setRenderPipelineState(d_encoder, pipeline);
+    }
+    else {
+        d_encoder->setRenderPipelineState(pipeline);
+    }
+
+    if (d_writer) {
+        d_writer->setRenderPipelineState(pipeline, name);
+    }
+}
+
+void
+CapturingEncoder::setVertexBytes(const void *bytes, NS::UInteger length, NS::UInteger index) {
+    if (d_cached_dispatch) {
+        CachedEncoder::setVertexBytes(d_encoder, bytes, length, index);
+    }
+    else {
+        d_encoder->setVertexBytes(bytes, length, index);
+    }
+
+    if (d_writer) {
+        d_writer->setVertexBytes(bytes, length, (uint32_t)index);
+    }
+}
+
+void
+CapturingEncoder::setViewport(const MTL::Viewport& viewport) {
+    if (d_cached_dispatch) {
+        CachedEncoder::setViewport(d_encoder, viewport);
+    }
+    else {
+        d_encoder->setViewport(viewport);
+    }
+
+    if (d_writer) {
+        d_writer->setViewport(LoggedViewport {
+            (float)viewport.originX, (float)viewport.originY,
+            (float)viewport.width, (float)viewport.height,
+            (float)viewport.znear, (float)viewport.zfar
+        });
+    }
+}
+
+void
+CapturingEncoder::drawPrimitives(MTL::PrimitiveType primitive_type, NS::UInteger vertex_start, NS::UInteger vertex_count, NS::UInteger instance_count) {
+    if (d_cached_dispatch) {
+        CachedEncoder::drawPrimitives(d_encoder, primitive_type, vertex_start, vertex_count, instance_count);
+    }
+    else {
+        d_encoder->drawPrimitives(primitive_type, vertex_start, vertex_count, instance_count);
+    }
+
+    if (d_writer) {
+        d_writer->drawPrimitives((uint32_t)primitive_type, vertex_start, vertex_count, instance_count);
+    }
+}
+
+void
+MetalReplaySink::setPipeline(const std::string& name, MTL::RenderPipelineState *pipeline) {
+    d_pipelines[name] = pipeline;
+
+    // The old pipeline may be gone; the next setRenderPipelineState rebinds.
+    d_bound = nullptr;
+}
+
+void
+MetalReplaySink::definePipeline(uint32_t id, const std::string& name) {
+    d_names[id] = name;
+}
+
+void
+MetalReplaySink::setRenderPipelineState(uint32_t id) {
+    d_bound = nullptr;
+
+    auto name = d_names.find(id);
+
+    if (name != d_names.end()) {
+        auto pipeline = d_pipelines.find(name->second);
+
+        if (pipeline != d_pipelines.end()) {
+            d_bound = pipeline->second;
+        }
+    }
+
+    if (d_bound) {
+        d_encoder->setRenderPipelineState(d_bound);
+    }
+}
+
+void
+MetalReplaySink::setVertexBytes(const void *bytes, size_t length, uint32_t index) {
+    d_encoder->setVertexBytes(bytes, length, index);
+}
+
+void
+MetalReplaySink::setViewport(const LoggedViewport& viewport) {
+    d_encoder->setViewport(MTL::Viewport {
+        viewport.origin_x, viewport.origin_y,
+        viewport.width, viewport.height,
+        viewport.znear, viewport.zfar
+    });
+}
+
+void
+MetalReplaySink::drawPrimitives(uint32_t primitive_type, uint64_t vertex_start, uint64_t vertex_count, uint64_t instance_count) {
+    if (d_bound) {
+        d_encoder->drawPrimitives((MTL::PrimitiveType)primitive_type, vertex_start, vertex_count, instance_count);
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "command_log.h"
+
+#include <Metal/MetalFwd.hpp>
+
+#include <map>
+#include <string>
+
+// Forwards the render encoder calls the example makes and, when a writer is
+// attached, records them for offline replay. With `cached_dispatch` the calls
+// go through `CachedEncoder` instead of objc_msgSend.
+class CapturingEncoder {
+public:
+
+    CapturingEncoder(MTL::RenderCommandEncoder *encoder, CommandLogWriter *writer, bool cached_dispatch = false)
+        : d_encoder(encoder)
+        , d_writer(writer)
+        , d_cached_dispatch(cached_dispatch) {
+    }
+
+    // `name` identifies the pipeline in the log; replay looks it up by name.
+    void setRenderPipelineState(const MTL::RenderPipelineState *pipeline, const char *name);
+    void setVertexBytes(const void *bytes, NS::UInteger length, NS::UInteger index);
+    void setViewport(const MTL::Viewport& viewport);
+    void drawPrimitives(MTL::PrimitiveType primitive_type, NS::UInteger vertex_start, NS::UInteger vertex_count, NS::UInteger instance_count = 1);
+
+private:
+
+    MTL::RenderCommandEncoder *d_encoder;
+    CommandLogWriter *d_writer;
+    bool d_cached_dispatch;
+};
+
+// Executes replayed commands on a Metal render encoder. Pipelines are
+// resolved by the names they were recorded with; draws using unknown
+// pipelines are dropped.
+class MetalReplaySink : public CommandSink {
+public:
+
+    // Adds or replaces a named pipeline, e.g. after a shader reload.
+    void setPipeline(const std::string& name, MTL::RenderPipelineState *pipeline);
+
+    void setEncoder(MTL::RenderCommandEncoder *encoder) {
+        d_encoder = encoder;
+    }
+
+    void definePipeline(uint32_t id, const std::string& name) override;
+    void setRenderPipelineState(uint32_t id) override;
+    void setVertexBytes(const void *bytes, size_t length, uint32_t index) override;
+    void setViewport(const LoggedViewport& viewport) override;
+    void drawPrimitives(uint32_t primitive_type, uint64_t vertex_start, uint64_t vertex_count, uint64_t instance_count) override;
+
+private:
+
+    std::map<std::string, MTL::RenderPipelineState *> d_pipelines;
+    std::map<uint32_t, std::string> d_names;
+
+    MTL::RenderCommandEncoder *d_encoder = nullptr;
+    MTL::RenderPipelineState *d_bound = nullptr;
+};
@@ -0,0 +1,155 @@
+#include "atlas_packer.h"
+
+#include <algorithm>
+#include <numeric>
+
+SkylinePacker::SkylinePacker(uint32_t width, uint32_t height, uint32_t padding)
+    : d_width(width)
+    , d_height(height)
+    , d_padding(padding) {
+    reset();
+}
+
+void
+SkylinePacker::reset() {
+    d_skyline.assign(1, Segment { 0, 0, d_width });
+    d_used_area = 0;
+}
+
+uint32_t
+SkylinePacker::fitAt(size_t index, uint32_t width) const {
+    if (d_skyline[index].x + width > d_width) {
+        return UINT32_MAX;
+    }
+
+    // The rectangle rests on the highest segment under it. The skyline spans
+    // the whole page, so this never runs off the end.
+    uint32_t y = 0;
+
+    for (size_t i = index; width > 0; ++i) {
+        y = std::max(y, d_skyline[i].y);
+        width -= std::min(width, d_skyline[i].width);
+    }
+
+    return y;
+}
+
+bool
+SkylinePacker::pack(uint32_t width, uint32_t height, AtlasRect *rect) {
+    if (width == 0 || height == 0 || width > d_width || height > d_height) {
+        return false;
+    }
+
+    // Padding may hang over the page edge.
+    uint32_t padded_width = std::min(width + d_padding, d_width);
+    uint32_t padded_height = std::min(height + d_padding, d_height);
+
+    size_t best = SIZE_MAX;
+    uint32_t best_y = UINT32_MAX;
+
+    for (size_t i = 0; i < d_skyline.size(); ++i) {
+        uint32_t y = fitAt(i, padded_width);
+
+        if (y < best_y && y + padded_height <= d_height) {
+            best = i;
+            best_y = y;
+        }
+    }
+
+    if (best == SIZE_MAX) {
+        return false;
+    }
+
+    uint32_t x = d_skyline[best].x;
+    uint32_t right = x + padded_width;
+
+    d_skyline.insert(d_skyline.begin() + best, Segment { x, best_y + padded_height, padded_width });
+
+    // Trim or drop the segments the new one now covers.
+    size_t next = best + 1;
+
+    while (next < d_skyline.size() && d_skyline[next].x < right) {
+        Segment& segment = d_skyline[next];
+        uint32_t segment_right = segment.x + segment.width;
+
+        if (segment_right <= right) {
+            d_skyline.erase(d_skyline.begin() + next);
+        }
+        else {
+            segment.width = segment_right - right;
+            segment.x = right;
+            break;
+        }
+    }
+
+    // Merge neighbours at the same height.
+    for (size_t i = 1; i < d_skyline.size();) {
+        if (d_skyline[i - 1].y == d_skyline[i].y) {
+            d_skyline[i - 1].width += d_skyline[i].width;
+            d_skyline.erase(d_skyline.begin() + i);
+        }
+        else {
+            ++i;
+        }
+    }
+
+    *rect = AtlasRect { x, best_y, width, height };
+    d_used_area += (uint64_t)width * height;
+
+    return true;
+}
+
+AtlasLayout
+packAtlas(const AtlasRect *sizes, size_t count, uint32_t page_width, uint32_t page_height, uint32_t padding) {
+    AtlasLayout layout;
+    layout.page_width = page_width;
+    layout.page_height = page_height;
+    layout.entries.resize(count);
+
+    std::vector<size_t> order(count);
+    std::iota(order.begin(), order.end(), 0);
+
+    std::stable_sort(order.begin(), order.end(), [sizes](size_t a, size_t b) {
+        return sizes[a].height != sizes[b].height ? sizes[a].height > sizes[b].height : sizes[a].width > sizes[b].width;
+    });
+
+    std::vector<SkylinePacker> pages;
+
+    for (size_t index : order) {
+        const AtlasRect& size = sizes[index];
+        AtlasEntry& entry = layout.entries[index];
+
+        if (size.width == 0 || size.height == 0 || size.width > page_width || size.height > page_height) {
+            continue;
+        }
+
+        for (uint32_t page = 0; page < pages.size(); ++page) {
+            if (pages[page].pack(size.width, size.height, &entry.rect)) {
+                entry.page = page;
+                break;
+            }
+        }
+
+        if (entry.page == UINT32_MAX) {
+            pages.emplace_back(page_width, page_height, padding);
+
+            if (pages.back().pack(size.width, size.height, &entry.rect)) {
+                entry.page = (uint32_t)pages.size() - 1;
+            }
+        }
+    }
+
+    uint64_t used = 0;
+
+    for (const auto& page : pages) {
+        used += page.usedArea();
+    }
+
+    layout.page_count = (uint32_t)pages.size();
+
+    if (!pages.empty()) {
+        layout.occupancy = (float)((double)used / ((double)page_width * page_height * pages.size()));
+    }
+
+    return layout;
+}
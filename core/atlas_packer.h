@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Pixel rectangle within an atlas page, origin at the top left.
+struct AtlasRect {
+    uint32_t x = 0, y = 0;
+    uint32_t width = 0, height = 0;
+};
+
+// Packs rectangles into one page with the skyline bottom-left heuristic: the
+// page's filled area is tracked as a list of horizontal segments, and each
+// rectangle goes where its top edge ends up lowest, leftmost on ties.
+class SkylinePacker {
+public:
+
+    // `padding` empty pixels are kept to the right of and below every
+    // rectangle so that filtering never bleeds between neighbours.
+    SkylinePacker(uint32_t width, uint32_t height, uint32_t padding = 0);
+
+    // Returns false, leaving the page unchanged, when the rectangle does not fit.
+    bool pack(uint32_t width, uint32_t height, AtlasRect *rect);
+
+    void reset();
+
+    uint32_t width() const {
+        return d_width;
+    }
+
+    uint32_t height() const {
+        return d_height;
+    }
+
+    // Pixels covered by packed rectangles, not counting padding.
+    uint64_t usedArea() const {
+        return d_used_area;
+    }
+
+    float occupancy() const {
+        return (float)((double)d_used_area / ((double)d_width * d_height));
+    }
+
+private:
+
+    struct Segment {
+        uint32_t x, y, width;
+    };
+
+    // Lowest top edge for a `width` wide rectangle starting at segment
+    // `index`, or UINT32_MAX when it would leave the page.
+    uint32_t fitAt(size_t index, uint32_t width) const;
+
+    uint32_t d_width, d_height, d_padding;
+    uint64_t d_used_area = 0;
+    std::vector<Segment> d_skyline;
+};
+
+struct AtlasEntry {
+    // UINT32_MAX for images that are empty or do not fit on an empty page.
+    uint32_t page = UINT32_MAX;
+    AtlasRect rect;
+};
+
+struct AtlasLayout {
+    uint32_t page_width = 0, page_height = 0;
+    uint32_t page_count = 0;
+
+    // One per input image, in input order.
+    std::vector<AtlasEntry> entries;
+
+    // Packed area over the area of all pages.
+    float occupancy = 0.0f;
+};
+
+// Packs `count` images into as few `page_width` x `page_height` pages as the
+// heuristic manages; only the sizes' width and height are read. Images are
+// placed tallest first, each on the first page with room, which keeps
+// skylines flat.
+AtlasLayout packAtlas(const AtlasRect *sizes, size_t count, uint32_t page_width, uint32_t page_height, uint32_t padding = 1);
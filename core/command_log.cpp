@@ -0,0 +1,350 @@
+#include "command_log.h"
+
+#include <cstring>
+
+namespace {
+
+const char command_log_magic[8] = { 'S', 'M', 'C', 'L', 'O', 'G', 0, 0 };
+const uint32_t command_log_version = 1;
+const size_t command_log_header_size = 16;
+
+// Inline data alignment within the file.
+const size_t command_log_data_alignment = 16;
+
+enum Opcode : uint8_t {
+    OpcodeBeginFrame = 1,
+    OpcodeEndFrame,
+    OpcodeDefinePipeline,
+    OpcodeSetRenderPipelineState,
+    OpcodeSetVertexBytes,
+    OpcodeRepeatVertexBytes,
+    OpcodeSetViewport,
+    OpcodeDrawPrimitives,
+};
+
+}
+
+CommandLogWriter::~CommandLogWriter() {
+    close();
+}
+
+bool
+CommandLogWriter::open(const char *path) {
+    close();
+
+    d_file = std::fopen(path, "wb");
+
+    if (!d_file) {
+        return false;
+    }
+
+    uint8_t header[command_log_header_size] = {};
+    std::memcpy(header, command_log_magic, sizeof(command_log_magic));
+    std::memcpy(header + 8, &command_log_version, sizeof(command_log_version));
+
+    d_bytes_written = std::fwrite(header, 1, sizeof(header), d_file);
+    d_pipeline_ids.clear();
+
+    for (auto& bytes : d_last_bytes) {
+        bytes.clear();
+    }
+
+    return d_bytes_written == sizeof(header);
+}
+
+void
+CommandLogWriter::close() {
+    if (d_file) {
+        std::fclose(d_file);
+        d_file = nullptr;
+    }
+}
+
+void
+CommandLogWriter::beginFrame(uint64_t frame) {
+    d_frame.clear();
+    writeByte(OpcodeBeginFrame);
+    writeVarint(frame);
+}
+
+void
+CommandLogWriter::endFrame() {
+    writeByte(OpcodeEndFrame);
+
+    if (d_file) {
+        d_bytes_written += std::fwrite(d_frame.data(), 1, d_frame.size(), d_file);
+    }
+
+    d_frame.clear();
+}
+
+void
+CommandLogWriter::setRenderPipelineState(const void *pipeline, const char *name) {
+    auto it = d_pipeline_ids.find(pipeline);
+
+    if (it == d_pipeline_ids.end()) {
+        uint32_t id = (uint32_t)d_pipeline_ids.size();
+        it = d_pipeline_ids.emplace(pipeline, id).first;
+
+        size_t length = std::strlen(name);
+        writeByte(OpcodeDefinePipeline);
+        writeVarint(id);
+        writeVarint(length);
+        writeRaw(name, length);
+    }
+
+    writeByte(OpcodeSetRenderPipelineState);
+    writeVarint(it->second);
+}
+
+void
+CommandLogWriter::setVertexBytes(const void *bytes, size_t length, uint32_t index) {
+    if (index >= command_log_max_buffer_index) {
+        return;
+    }
+
+    auto& last = d_last_bytes[index];
+
+    if (last.size() == length && std::memcmp(last.data(), bytes, length) == 0) {
+        writeByte(OpcodeRepeatVertexBytes);
+        writeVarint(index);
+        return;
+    }
+
+    last.assign((const uint8_t *)bytes, (const uint8_t *)bytes + length);
+
+    writeByte(OpcodeSetVertexBytes);
+    writeVarint(index);
+    writeVarint(length);
+    padTo(command_log_data_alignment);
+    writeRaw(bytes, length);
+}
+
+void
+CommandLogWriter::setViewport(const LoggedViewport& viewport) {
+    writeByte(OpcodeSetViewport);
+    writeRaw(&viewport, sizeof(viewport));
+}
+
+void
+CommandLogWriter::drawPrimitives(uint32_t primitive_type, uint64_t vertex_start, uint64_t vertex_count, uint64_t instance_count) {
+    writeByte(OpcodeDrawPrimitives);
+    writeVarint(primitive_type);
+    writeVarint(vertex_start);
+    writeVarint(vertex_count);
+    writeVarint(instance_count);
+}
+
+void
+CommandLogWriter::writeByte(uint8_t value) {
+    d_frame.push_back(value);
+}
+
+void
+CommandLogWriter::writeVarint(uint64_t value) {
+    while (value >= 0x80) {
+        d_frame.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+
+    d_frame.push_back((uint8_t)value);
+}
+
+void
+CommandLogWriter::writeRaw(const void *bytes, size_t length) {
+    d_frame.insert(d_frame.end(), (const uint8_t *)bytes, (const uint8_t *)bytes + length);
+}
+
+void
+CommandLogWriter::padTo(size_t alignment) {
+    // Alignment is of the eventual file offset, not of the frame buffer.
+    while ((d_bytes_written + d_frame.size()) % alignment != 0) {
+        d_frame.push_back(0);
+    }
+}
+
+CommandLogReader::CommandLogReader(const uint8_t *data, size_t size)
+    : d_data(data)
+    , d_size(size) {
+    uint32_t version = 0;
+
+    if (size >= command_log_header_size && std::memcmp(data, command_log_magic, sizeof(command_log_magic)) == 0) {
+        std::memcpy(&version, data + 8, sizeof(version));
+    }
+
+    d_valid = version == command_log_version;
+    rewind();
+}
+
+void
+CommandLogReader::rewind() {
+    d_offset = command_log_header_size;
+    d_failed = !d_valid;
+
+    for (auto& bytes : d_last_bytes) {
+        bytes = Bytes();
+    }
+}
+
+bool
+CommandLogReader::replayFrame(CommandSink& sink) {
+    if (d_failed || d_offset >= d_size) {
+        return false;
+    }
+
+    uint8_t opcode;
+    uint64_t frame;
+
+    if (!readByte(opcode) || opcode != OpcodeBeginFrame || !readVarint(frame)) {
+        d_failed = true;
+        return false;
+    }
+
+    sink.beginFrame(frame);
+
+    for (;;) {
+        if (!readByte(opcode)) {
+            d_failed = true;
+            return false;
+        }
+
+        switch (opcode) {
+            case OpcodeEndFrame: {
+                sink.endFrame();
+                return true;
+            }
+
+            case OpcodeDefinePipeline: {
+                uint64_t id, length;
+
+                if (!readVarint(id) || !readVarint(length) || length > d_size - d_offset) {
+                    d_failed = true;
+                    return false;
+                }
+
+                sink.definePipeline((uint32_t)id, std::string((const char *)d_data + d_offset, length));
+                d_offset += length;
+            } break;
+
+            case OpcodeSetRenderPipelineState: {
+                uint64_t id;
+
+                if (!readVarint(id)) {
+                    d_failed = true;
+                    return false;
+                }
+
+                sink.setRenderPipelineState((uint32_t)id);
+            } break;
+
+            case OpcodeSetVertexBytes: {
+                uint64_t index, length;
+
+                if (!readVarint(index) || index >= command_log_max_buffer_index ||
+                    !readVarint(length) || !align(command_log_data_alignment) || length > d_size - d_offset) {
+                    d_failed = true;
+                    return false;
+                }
+
+                d_last_bytes[index].data = d_data + d_offset;
+                d_last_bytes[index].length = length;
+                d_offset += length;
+
+                sink.setVertexBytes(d_last_bytes[index].data, length, (uint32_t)index);
+            } break;
+
+            case OpcodeRepeatVertexBytes: {
+                uint64_t index;
+
+                if (!readVarint(index) || index >= command_log_max_buffer_index || !d_last_bytes[index].data) {
+                    d_failed = true;
+                    return false;
+                }
+
+                sink.setVertexBytes(d_last_bytes[index].data, d_last_bytes[index].length, (uint32_t)index);
+            } break;
+
+            case OpcodeSetViewport: {
+                LoggedViewport viewport;
+
+                if (!readRaw(&viewport, sizeof(viewport))) {
+                    d_failed = true;
+                    return false;
+                }
+
+                sink.setViewport(viewport);
+            } break;
+
+            case OpcodeDrawPrimitives: {
+                uint64_t primitive_type, vertex_start, vertex_count, instance_count;
+
+                if (!readVarint(primitive_type) || !readVarint(vertex_start) ||
+                    !readVarint(vertex_count) || !readVarint(instance_count)) {
+                    d_failed = true;
+                    return false;
+                }
+
+                sink.drawPrimitives((uint32_t)primitive_type, vertex_start, vertex_count, instance_count);
+            } break;
+
+            default: {
+                d_failed = true;
+                return false;
+            }
+        }
+    }
+}
+
+bool
+CommandLogReader::readByte(uint8_t& value) {
+    if (d_offset >= d_size) {
+        return false;
+    }
+
+    value = d_data[d_offset++];
+    return true;
+}
+
+bool
+CommandLogReader::readVarint(uint64_t& value) {
+    value = 0;
+
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        uint8_t byte;
+
+        if (!readByte(byte)) {
+            return false;
+        }
+
+        value |= (uint64_t)(byte & 0x7f) << shift;
+
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool
+CommandLogReader::readRaw(void *out, size_t length) {
+    if (length > d_size - d_offset) {
+        return false;
+    }
+
+    std::memcpy(out, d_data + d_offset, length);
+    d_offset += length;
+    return true;
+}
+
+bool
+CommandLogReader::align(size_t alignment) {
+    size_t aligned = (d_offset + alignment - 1) / alignment * alignment;
+
+    if (aligned > d_size) {
+        return false;
+    }
+
+    d_offset = aligned;
+    return true;
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Binary log of the render commands issued each frame, for offline replay.
+//
+// The file is a 16-byte header followed by commands. Each command is a one
+// byte opcode and varint operands. Inline data (setVertexBytes) is padded to
+// a 16-byte file offset so a memory-mapped log can be read in place, and data
+// identical to the previous bytes at the same index is stored as a reference.
+// That makes frames depend on earlier ones: decode in order from the start.
+
+// Viewport as recorded; mirrors MTL::Viewport in single precision.
+struct LoggedViewport {
+    float origin_x, origin_y;
+    float width, height;
+    float znear, zfar;
+};
+
+// Receives decoded commands. Pointers passed in are only valid for the call.
+class CommandSink {
+public:
+
+    virtual ~CommandSink() = default;
+
+    virtual void beginFrame(uint64_t /* frame */) {}
+    virtual void endFrame() {}
+
+    // Pipelines are recorded by name the first time they are used.
+    virtual void definePipeline(uint32_t /* id */, const std::string& /* name */) {}
+    virtual void setRenderPipelineState(uint32_t /* id */) {}
+
+    virtual void setVertexBytes(const void * /* bytes */, size_t /* length */, uint32_t /* index */) {}
+    virtual void setViewport(const LoggedViewport& /* viewport */) {}
+
+    // `primitive_type` holds the raw MTL::PrimitiveType value.
+    virtual void drawPrimitives(uint32_t /* primitive_type */, uint64_t /* vertex_start */, uint64_t /* vertex_count */, uint64_t /* instance_count */) {}
+};
+
+// Buffer argument table size; Metal has 31 vertex buffer slots.
+const uint32_t command_log_max_buffer_index = 31;
+
+class CommandLogWriter {
+public:
+
+    ~CommandLogWriter();
+
+    bool open(const char *path);
+    void close();
+
+    void beginFrame(uint64_t frame);
+
+    // Writes the frame out; nothing reaches the file before this.
+    void endFrame();
+
+    // `pipeline` only identifies the object; `name` is what replay sees.
+    void setRenderPipelineState(const void *pipeline, const char *name);
+
+    void setVertexBytes(const void *bytes, size_t length, uint32_t index);
+    void setViewport(const LoggedViewport& viewport);
+    void drawPrimitives(uint32_t primitive_type, uint64_t vertex_start, uint64_t vertex_count, uint64_t instance_count);
+
+    uint64_t bytesWritten() const {
+        return d_bytes_written;
+    }
+
+private:
+
+    void writeByte(uint8_t value);
+    void writeVarint(uint64_t value);
+    void writeRaw(const void *bytes, size_t length);
+    void padTo(size_t alignment);
+
+    FILE *d_file = nullptr;
+    uint64_t d_bytes_written = 0;
+    std::vector<uint8_t> d_frame;
+
+    std::unordered_map<const void *, uint32_t> d_pipeline_ids;
+    std::array<std::vector<uint8_t>, command_log_max_buffer_index> d_last_bytes;
+};
+
+class CommandLogReader {
+public:
+
+    CommandLogReader(const uint8_t *data, size_t size);
+
+    // Whether the header was recognized.
+    bool valid() const {
+        return d_valid;
+    }
+
+    // Decodes the next frame into `sink`. Returns false at the end of the log
+    // or if the data is malformed; `failed()` tells the two apart.
+    bool replayFrame(CommandSink& sink);
+
+    bool failed() const {
+        return d_failed;
+    }
+
+    void rewind();
+
+    size_t offset() const {
+        return d_offset;
+    }
+
+private:
+
+    bool readByte(uint8_t& value);
+    bool readVarint(uint64_t& value);
+    bool readRaw(void *out, size_t length);
+    bool align(size_t alignment);
+
+    const uint8_t *d_data;
+    size_t d_size;
+    size_t d_offset = 0;
+    bool d_valid = false, d_failed = false;
+
+    struct Bytes {
+        const uint8_t *data = nullptr;
+        size_t length = 0;
+    };
+
+    std::array<Bytes, command_log_max_buffer_index> d_last_bytes;
+};
@@ -0,0 +1,452 @@
+#include "culling.h"
+#include "software_rasterizer.h"
+#include "thread_pool.h"
+#include "vec4.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Objects per parallel task; a multiple of the eight-object step.
+const size_t cull_grain = 8192;
+
+// Clip-space w below which a point counts as behind the eye.
+const float min_w = 1e-6f;
+
+// Bounding radius of each object against one plane: the sphere's radius,
+// or the box's extent along the plane normal.
+inline float
+planeRadius(const CullBounds& bounds, CullShape shape, const float plane[4], size_t i) {
+    if (shape == CullShapeSphere) {
+        return bounds.radius[i];
+    }
+
+    return bounds.extent[0][i] * std::fabs(plane[0]) + bounds.extent[1][i] * std::fabs(plane[1]) +
+           bounds.extent[2][i] * std::fabs(plane[2]);
+}
+
+inline bool
+isInside(const CullBounds& bounds, const Frustum& frustum, CullShape shape, size_t i) {
+    for (const auto& plane : frustum.planes) {
+        float distance = bounds.center[0][i] * plane[0] + bounds.center[1][i] * plane[1] +
+                         bounds.center[2][i] * plane[2] + plane[3];
+
+        if (distance < -planeRadius(bounds, shape, plane, i)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Which of the four objects at `i` are outside some plane, as `Mask4` bits.
+template<CullShape shape>
+inline int
+outsideBits(const CullBounds& bounds, const Vec4f planes[6][4], const Vec4f abs_normals[6][3], size_t i) {
+    Vec4f x = Vec4f::load(&bounds.center[0][i]);
+    Vec4f y = Vec4f::load(&bounds.center[1][i]);
+    Vec4f z = Vec4f::load(&bounds.center[2][i]);
+
+    auto isOutside = [&](int p) {
+        Vec4f distance = x * planes[p][0] + y * planes[p][1] + z * planes[p][2] + planes[p][3];
+
+        if constexpr (shape == CullShapeSphere) {
+            return distance < -Vec4f::load(&bounds.radius[i]);
+        }
+        else {
+            Vec4f radius = Vec4f::load(&bounds.extent[0][i]) * abs_normals[p][0] +
+                           Vec4f::load(&bounds.extent[1][i]) * abs_normals[p][1] +
+                           Vec4f::load(&bounds.extent[2][i]) * abs_normals[p][2];
+            return distance < -radius;
+        }
+    };
+
+    Mask4 outside = isOutside(0);
+
+    for (int p = 1; p < 6; ++p) {
+        outside = outside | isOutside(p);
+    }
+
+    return outside.bits();
+}
+
+// Tests objects [begin, end) and writes the visible ones' indices to `out`,
+// returning how many. Writes never run ahead of the object being tested, so
+// `out` may be the slice of the result that starts at `begin`.
+template<CullShape shape>
+size_t
+cullRange(const CullBounds& bounds, const Frustum& frustum, size_t begin, size_t end, uint32_t *out, SimdKernel kernel) {
+    size_t count = 0;
+    size_t simd_end = kernel == SimdKernelVector ? begin + (end - begin) / 8 * 8 : begin;
+
+    Vec4f planes[6][4], abs_normals[6][3];
+
+    for (int p = 0; p < 6; ++p) {
+        for (int c = 0; c < 4; ++c) {
+            planes[p][c] = Vec4f::broadcast(frustum.planes[p][c]);
+        }
+
+        for (int c = 0; c < 3; ++c) {
+            abs_normals[p][c] = Vec4f::broadcast(std::fabs(frustum.planes[p][c]));
+        }
+    }
+
+    // Eight at a time, as two independent halves, with a branch-free append.
+    for (size_t i = begin; i < simd_end; i += 8) {
+        int outside = outsideBits<shape>(bounds, planes, abs_normals, i) |
+                      outsideBits<shape>(bounds, planes, abs_normals, i + 4) << 4;
+
+        for (int lane = 0; lane < 8; ++lane) {
+            out[count] = uint32_t(i + lane);
+            count += ((outside >> lane) & 1) ^ 1;
+        }
+    }
+
+    for (size_t i = simd_end; i < end; ++i) {
+        out[count] = uint32_t(i);
+        count += isInside(bounds, frustum, shape, i) ? 1 : 0;
+    }
+
+    return count;
+}
+
+size_t
+cullRange(const CullBounds& bounds, const Frustum& frustum, CullShape shape, size_t begin, size_t end, uint32_t *out,
+    SimdKernel kernel) {
+    if (shape == CullShapeSphere) {
+        return cullRange<CullShapeSphere>(bounds, frustum, begin, end, out, kernel);
+    }
+
+    return cullRange<CullShapeBox>(bounds, frustum, begin, end, out, kernel);
+}
+
+// Column-major matrix times (x, y, z, w).
+inline void
+transform(const float m[16], float x, float y, float z, float w, float out[4]) {
+    for (int r = 0; r < 4; ++r) {
+        out[r] = m[r] * x + m[4 + r] * y + m[8 + r] * z + m[12 + r] * w;
+    }
+}
+
+// Writes one occluder triangle into a `width` x `height` depth buffer.
+void
+addConservativeTriangle(const RasterPoint screen[3], const float depth[3], uint32_t width, uint32_t height,
+    float *depth_buffer) {
+    float ex1 = screen[1].x - screen[0].x, ey1 = screen[1].y - screen[0].y;
+    float ex2 = screen[2].x - screen[0].x, ey2 = screen[2].y - screen[0].y;
+    float area = ex1 * ey2 - ex2 * ey1;
+
+    if (area == 0.0f) {
+        return;
+    }
+
+    // Edge functions as a + b x + c y, each made positive inside whichever
+    // way the triangle winds.
+    float sign = area > 0.0f ? 1.0f : -1.0f;
+    float a[3], b[3], c[3];
+
+    for (int k = 0; k < 3; ++k) {
+        RasterPoint p = screen[k], q = screen[(k + 1) % 3];
+        b[k] = -(q.y - p.y) * sign;
+        c[k] = (q.x - p.x) * sign;
+        a[k] = -(b[k] * p.x + c[k] * p.y);
+    }
+
+    // Depth after the perspective divide is affine in screen space.
+    float dz1 = depth[1] - depth[0], dz2 = depth[2] - depth[0];
+    float dzdx = (dz1 * ey2 - dz2 * ey1) / area, dzdy = (dz2 * ex1 - dz1 * ex2) / area;
+    float z0 = depth[0] - dzdx * screen[0].x - dzdy * screen[0].y;
+    float max_depth = std::max(std::max(depth[0], depth[1]), depth[2]);
+
+    float min_x = std::min(std::min(screen[0].x, screen[1].x), screen[2].x);
+    float max_x = std::max(std::max(screen[0].x, screen[1].x), screen[2].x);
+    float min_y = std::min(std::min(screen[0].y, screen[1].y), screen[2].y);
+    float max_y = std::max(std::max(screen[0].y, screen[1].y), screen[2].y);
+
+    int x0 = std::max(0, (int)std::ceil(min_x)), x1 = std::min((int)width, (int)std::floor(max_x)) - 1;
+    int y0 = std::max(0, (int)std::ceil(min_y)), y1 = std::min((int)height, (int)std::floor(max_y)) - 1;
+
+    // A pixel counts only when the triangle covers all of it, i.e. every edge
+    // function is non-negative at the pixel's worst corner, and it stores the
+    // farthest depth the triangle reaches over it. A box behind that depth is
+    // behind the occluder everywhere in the pixel, so the test never hides
+    // something visible; pixels cut by an edge, including the seams inside a
+    // mesh, are left to other triangles and only lose culling.
+    float corner_a[3], corner_z = z0 + std::max(0.0f, dzdx) + std::max(0.0f, dzdy);
+
+    for (int k = 0; k < 3; ++k) {
+        corner_a[k] = a[k] + std::min(0.0f, b[k]) + std::min(0.0f, c[k]);
+    }
+
+    for (int y = y0; y <= y1; ++y) {
+        float *row = &depth_buffer[(size_t)y * width];
+
+        for (int x = x0; x <= x1; ++x) {
+            bool covered = true;
+
+            for (int k = 0; k < 3; ++k) {
+                covered = covered && corner_a[k] + b[k] * x + c[k] * y >= 0.0f;
+            }
+
+            if (covered) {
+                float z = std::min(max_depth, corner_z + dzdx * x + dzdy * y);
+                row[x] = std::min(row[x], z);
+            }
+        }
+    }
+}
+
+}
+
+void
+CullBounds::resize(size_t count) {
+    for (int c = 0; c < 3; ++c) {
+        center[c].resize(count);
+        extent[c].resize(count);
+    }
+
+    radius.resize(count);
+}
+
+void
+CullBounds::clear() {
+    resize(0);
+}
+
+void
+CullBounds::set(size_t index, float x, float y, float z, float extent_x, float extent_y, float extent_z) {
+    center[0][index] = x;
+    center[1][index] = y;
+    center[2][index] = z;
+    extent[0][index] = extent_x;
+    extent[1][index] = extent_y;
+    extent[2][index] = extent_z;
+    radius[index] = std::sqrt(extent_x * extent_x + extent_y * extent_y + extent_z * extent_z);
+}
+
+void
+CullBounds::setSphere(size_t index, float x, float y, float z, float r) {
+    set(index, x, y, z, r, r, r);
+    radius[index] = r;
+}
+
+uint32_t
+CullBounds::add(float x, float y, float z, float extent_x, float extent_y, float extent_z) {
+    uint32_t index = (uint32_t)size();
+    resize(index + 1);
+    set(index, x, y, z, extent_x, extent_y, extent_z);
+    return index;
+}
+
+Frustum
+frustumFromMatrix(const float m[16]) {
+    // Rows of the matrix; clip space is -w <= x, y <= w and 0 <= z <= w.
+    float rows[4][4];
+
+    for (int r = 0; r < 4; ++r) {
+        for (int c = 0; c < 4; ++c) {
+            rows[r][c] = m[c * 4 + r];
+        }
+    }
+
+    Frustum frustum;
+
+    for (int c = 0; c < 4; ++c) {
+        frustum.planes[0][c] = rows[3][c] + rows[0][c];
+        frustum.planes[1][c] = rows[3][c] - rows[0][c];
+        frustum.planes[2][c] = rows[3][c] + rows[1][c];
+        frustum.planes[3][c] = rows[3][c] - rows[1][c];
+        frustum.planes[4][c] = rows[2][c];
+        frustum.planes[5][c] = rows[3][c] - rows[2][c];
+    }
+
+    for (auto& plane : frustum.planes) {
+        float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+
+        // A plane that does not depend on position, as with an orthographic
+        // projection of flat geometry, is left as it is.
+        if (length > 0.0f) {
+            for (float& c : plane) {
+                c /= length;
+            }
+        }
+    }
+
+    return frustum;
+}
+
+size_t
+cullFrustum(const CullBounds& bounds, const Frustum& frustum, CullShape shape, std::vector<uint32_t>& visible,
+    ThreadPool *pool, SimdKernel kernel) {
+    size_t count = bounds.size();
+    visible.resize(count);
+
+    if (pool && count > cull_grain) {
+        // Each task fills its own slice, then the slices are closed up.
+        std::vector<size_t> counts((count + cull_grain - 1) / cull_grain);
+
+        pool->parallelFor(count, cull_grain, [&](size_t begin, size_t end) {
+            counts[begin / cull_grain] = cullRange(bounds, frustum, shape, begin, end, &visible[begin], kernel);
+        });
+
+        size_t total = counts[0];
+
+        for (size_t task = 1; task < counts.size(); ++task) {
+            std::memmove(&visible[total], &visible[task * cull_grain], counts[task] * sizeof(uint32_t));
+            total += counts[task];
+        }
+
+        visible.resize(total);
+    }
+    else {
+        visible.resize(cullRange(bounds, frustum, shape, 0, count, visible.data(), kernel));
+    }
+
+    return visible.size();
+}
+
+OcclusionBuffer::OcclusionBuffer(uint32_t width, uint32_t height)
+    : d_width(width), d_height(height), d_depth((size_t)width * height, 1.0f) {
+}
+
+void
+OcclusionBuffer::clear() {
+    std::fill(d_depth.begin(), d_depth.end(), 1.0f);
+}
+
+void
+OcclusionBuffer::addOccluders(const float view_projection[16], const float *positions, size_t vertex_count,
+    const uint32_t *indices, size_t index_count) {
+    d_clip.resize(vertex_count * 4);
+
+    for (size_t v = 0; v < vertex_count; ++v) {
+        const float *p = positions + v * 3;
+        transform(view_projection, p[0], p[1], p[2], 1.0f, &d_clip[v * 4]);
+    }
+
+    for (size_t i = 0; i + 3 <= index_count; i += 3) {
+        RasterPoint screen[3];
+        float depth[3];
+        bool clipped = false;
+
+        for (int k = 0; k < 3; ++k) {
+            const float *clip = &d_clip[indices[i + k] * 4];
+
+            if (clip[3] < min_w || clip[2] < 0.0f) {
+                clipped = true;
+                break;
+            }
+
+            float inverse_w = 1.0f / clip[3];
+            screen[k].x = (clip[0] * inverse_w * 0.5f + 0.5f) * d_width;
+            screen[k].y = (0.5f - clip[1] * inverse_w * 0.5f) * d_height;
+            depth[k] = clip[2] * inverse_w;
+        }
+
+        if (clipped) {
+            continue;
+        }
+
+        addConservativeTriangle(screen, depth, d_width, d_height, d_depth.data());
+    }
+}
+
+bool
+OcclusionBuffer::isOccluded(const CullBounds& bounds, const float m[16], uint32_t index) const {
+    // The corners are the transformed center plus or minus each transformed
+    // half axis.
+    float center[4], axes[3][4];
+    transform(m, bounds.center[0][index], bounds.center[1][index], bounds.center[2][index], 1.0f, center);
+
+    for (int a = 0; a < 3; ++a) {
+        float e = bounds.extent[a][index];
+        transform(m, a == 0 ? e : 0.0f, a == 1 ? e : 0.0f, a == 2 ? e : 0.0f, 0.0f, axes[a]);
+    }
+
+    // Four corners per vector: x and y alternate in sign across the lanes,
+    // z between the two halves.
+    static const float signs_x[4] = { -1.0f, 1.0f, -1.0f, 1.0f }, signs_y[4] = { -1.0f, -1.0f, 1.0f, 1.0f };
+    const Vec4f sign_x = Vec4f::load(signs_x), sign_y = Vec4f::load(signs_y);
+
+    Vec4f screen_x[2], screen_y[2], depth[2];
+
+    for (int half = 0; half < 2; ++half) {
+        Vec4f clip[4];
+
+        for (int c = 0; c < 4; ++c) {
+            Vec4f z_axis = Vec4f::broadcast(half ? axes[2][c] : -axes[2][c]);
+            clip[c] = Vec4f::broadcast(center[c]) + sign_x * Vec4f::broadcast(axes[0][c]) +
+                      sign_y * Vec4f::broadcast(axes[1][c]) + z_axis;
+        }
+
+        if (((clip[3] < Vec4f::broadcast(min_w)) | (clip[2] < Vec4f::broadcast(0.0f))).bits() != 0) {
+            return false;
+        }
+
+        Vec4f inverse_w = Vec4f::broadcast(1.0f) / clip[3];
+        const Vec4f half_width = Vec4f::broadcast(0.5f * d_width), half_height = Vec4f::broadcast(0.5f * d_height);
+
+        screen_x[half] = clip[0] * inverse_w * half_width + half_width;
+        screen_y[half] = half_height - clip[1] * inverse_w * half_height;
+        depth[half] = clip[2] * inverse_w;
+    }
+
+    float lanes[5][4];
+    min(screen_x[0], screen_x[1]).store(lanes[0]);
+    max(screen_x[0], screen_x[1]).store(lanes[1]);
+    min(screen_y[0], screen_y[1]).store(lanes[2]);
+    max(screen_y[0], screen_y[1]).store(lanes[3]);
+    min(depth[0], depth[1]).store(lanes[4]);
+
+    float min_x = std::min(std::min(lanes[0][0], lanes[0][1]), std::min(lanes[0][2], lanes[0][3]));
+    float max_x = std::max(std::max(lanes[1][0], lanes[1][1]), std::max(lanes[1][2], lanes[1][3]));
+    float min_y = std::min(std::min(lanes[2][0], lanes[2][1]), std::min(lanes[2][2], lanes[2][3]));
+    float max_y = std::max(std::max(lanes[3][0], lanes[3][1]), std::max(lanes[3][2], lanes[3][3]));
+    float nearest = std::min(std::min(lanes[4][0], lanes[4][1]), std::min(lanes[4][2], lanes[4][3]));
+
+    // Every pixel the box's screen rectangle touches.
+    int x0 = std::max(0, (int)std::floor(min_x)), x1 = std::min((int)d_width - 1, (int)std::floor(max_x));
+    int y0 = std::max(0, (int)std::floor(min_y)), y1 = std::min((int)d_height - 1, (int)std::floor(max_y));
+
+    if (x0 > x1 || y0 > y1) {
+        return false;
+    }
+
+    // Visible as soon as one pixel has no occluder in front of the box.
+    const Vec4f box_depth = Vec4f::broadcast(nearest);
+
+    for (int y = y0; y <= y1; ++y) {
+        const float *row = &d_depth[(size_t)y * d_width];
+        int x = x0;
+
+        for (; x + 4 <= x1 + 1; x += 4) {
+            if ((Vec4f::load(row + x) >= box_depth).bits() != 0) {
+                return false;
+            }
+        }
+
+        for (; x <= x1; ++x) {
+            if (row[x] >= nearest) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+size_t
+OcclusionBuffer::cull(const CullBounds& bounds, const float view_projection[16], std::vector<uint32_t>& visible) const {
+    size_t count = 0;
+
+    for (uint32_t index : visible) {
+        if (!isOccluded(bounds, view_projection, index)) {
+            visible[count++] = index;
+        }
+    }
+
+    visible.resize(count);
+    return count;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "simd_kernel.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+enum CullShape : uint8_t {
+    CullShapeSphere,
+    CullShapeBox,
+};
+
+// World-space bounds of the objects to cull, one array per component. Each
+// object has an axis-aligned box, given by its center and half size, and the
+// sphere around that box.
+struct CullBounds {
+    std::vector<float> center[3];
+    std::vector<float> extent[3];
+    std::vector<float> radius;
+
+    size_t size() const {
+        return radius.size();
+    }
+
+    void resize(size_t count);
+    void clear();
+
+    void set(size_t index, float x, float y, float z, float extent_x, float extent_y, float extent_z);
+    void setSphere(size_t index, float x, float y, float z, float radius);
+
+    uint32_t add(float x, float y, float z, float extent_x, float extent_y, float extent_z);
+};
+
+// Inward-facing planes (x, y, z, w) with unit normals: a point p is inside
+// when x * p.x + y * p.y + z * p.z + w >= 0 for all six.
+struct Frustum {
+    float planes[6][4];
+};
+
+// Extracts the planes of a column-major view-projection matrix with Metal's
+// clip space, where 0 <= z <= w.
+Frustum frustumFromMatrix(const float view_projection[16]);
+
+// Writes the indices of the objects that are at least partly inside
+// `frustum` to `visible`, in ascending order, and returns how many there
+// are. The SIMD kernel tests eight objects per step as two four-wide
+// halves; with a pool, ranges of objects are tested in parallel and then
+// compacted. Every kernel gives the same list.
+size_t cullFrustum(const CullBounds& bounds, const Frustum& frustum, CullShape shape, std::vector<uint32_t>& visible,
+    ThreadPool *pool = nullptr, SimdKernel kernel = SimdKernelVector);
+
+// Low-resolution depth of occluder triangles for a software occlusion
+// test. Depth is Metal's, 0 at the near plane and 1 at the far plane. A
+// pixel only takes an occluder that covers all of it, and then the farthest
+// depth the occluder reaches inside it, so the test is conservative: it may
+// keep hidden objects but never drops a visible one.
+class OcclusionBuffer {
+public:
+
+    OcclusionBuffer(uint32_t width, uint32_t height);
+
+    void clear();
+
+    // Rasterizes indexed triangles, with `vertex_count` positions as packed
+    // xyz in world space. Triangles that reach behind the near plane are
+    // skipped, which only makes the test more conservative.
+    void addOccluders(const float view_projection[16], const float *positions, size_t vertex_count,
+        const uint32_t *indices, size_t index_count);
+
+    // Removes from `visible` the objects whose boxes are behind the
+    // occluders at every pixel they cover, keeping the order, and returns
+    // how many are left. Boxes that reach behind the near plane are kept.
+    size_t cull(const CullBounds& bounds, const float view_projection[16], std::vector<uint32_t>& visible) const;
+
+    uint32_t width() const {
+        return d_width;
+    }
+
+    uint32_t height() const {
+        return d_height;
+    }
+
+    const float *depth() const {
+        return d_depth.data();
+    }
+
+private:
+
+    bool isOccluded(const CullBounds& bounds, const float view_projection[16], uint32_t index) const;
+
+    uint32_t d_width, d_height;
+    std::vector<float> d_depth;
+
+    // Occluder vertices in clip space, reused between calls.
+    std::vector<float> d_clip;
+};
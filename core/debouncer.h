@@ -0,0 +1,47 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Collapses bursts of notifications per key: a key becomes ready once it has
+// gone `quiet` without being touched. Time is passed in so callers control it.
+class Debouncer {
+public:
+
+    using Clock = std::chrono::steady_clock;
+
+    explicit Debouncer(Clock::duration quiet) : d_quiet(quiet) {
+    }
+
+    void touch(const std::string& key, Clock::time_point now) {
+        d_last_touched[key] = now;
+    }
+
+    // Returns the keys that are ready and forgets them.
+    std::vector<std::string> ready(Clock::time_point now) {
+        std::vector<std::string> result;
+
+        for (auto it = d_last_touched.begin(); it != d_last_touched.end(); ) {
+            if (now - it->second >= d_quiet) {
+                result.push_back(it->first);
+                it = d_last_touched.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+
+        return result;
+    }
+
+    bool empty() const {
+        return d_last_touched.empty();
+    }
+
+private:
+
+    Clock::duration d_quiet;
+    std::unordered_map<std::string, Clock::time_point> d_last_touched;
+};
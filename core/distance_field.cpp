@@ -0,0 +1,181 @@
+#include "distance_field.h"
+#include "thread_pool.h"
+#include "vec4.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+// Columns per vertical sweep task; a multiple of the vector width.
+const uint32_t column_strip = 64;
+
+// Runs the down and up sweeps over columns [x0, x1) of `g`, which holds 0 at
+// features and `cap` elsewhere, leaving each pixel's distance to the nearest
+// feature in its column, capped.
+void
+sweepColumns(float *g, uint32_t width, uint32_t height, uint32_t x0, uint32_t x1, DistanceFieldKernel kernel) {
+    uint32_t simd_end = kernel == DistanceFieldKernelSimd ? x0 + (x1 - x0) / 4 * 4 : x0;
+    const Vec4f one = Vec4f::broadcast(1.0f);
+
+    for (uint32_t y = 1; y < height; ++y) {
+        const float *above = g + (size_t)(y - 1) * width;
+        float *row = g + (size_t)y * width;
+
+        for (uint32_t x = x0; x < simd_end; x += 4) {
+            min(Vec4f::load(row + x), Vec4f::load(above + x) + one).store(row + x);
+        }
+
+        for (uint32_t x = simd_end; x < x1; ++x) {
+            row[x] = std::min(row[x], above[x] + 1.0f);
+        }
+    }
+
+    for (uint32_t y = height - 1; y-- > 0;) {
+        const float *below = g + (size_t)(y + 1) * width;
+        float *row = g + (size_t)y * width;
+
+        for (uint32_t x = x0; x < simd_end; x += 4) {
+            min(Vec4f::load(row + x), Vec4f::load(below + x) + one).store(row + x);
+        }
+
+        for (uint32_t x = simd_end; x < x1; ++x) {
+            row[x] = std::min(row[x], below[x] + 1.0f);
+        }
+    }
+}
+
+// Squared distance to the nearest feature for each pixel of a row, from the
+// row's column distances: min over |dx| <= radius of g[x + dx]^2 + dx^2.
+// `padded` holds the squared column distances with `radius` capped entries
+// on each side.
+void
+minimizeRow(const float *padded, uint32_t width, uint32_t radius, float *d2, DistanceFieldKernel kernel) {
+    uint32_t simd_end = kernel == DistanceFieldKernelSimd ? width / 4 * 4 : 0;
+
+    for (uint32_t x = 0; x < simd_end; x += 4) {
+        Vec4f best = Vec4f::load(padded + x + radius);
+
+        for (uint32_t dx = 1; dx <= radius; ++dx) {
+            Vec4f offset = Vec4f::broadcast((float)(dx * dx));
+            best = min(best, Vec4f::load(padded + x + radius - dx) + offset);
+            best = min(best, Vec4f::load(padded + x + radius + dx) + offset);
+        }
+
+        best.store(d2 + x);
+    }
+
+    for (uint32_t x = simd_end; x < width; ++x) {
+        float best = padded[x + radius];
+
+        for (uint32_t dx = 1; dx <= radius; ++dx) {
+            float offset = (float)(dx * dx);
+            best = std::min(best, padded[x + radius - dx] + offset);
+            best = std::min(best, padded[x + radius + dx] + offset);
+        }
+
+        d2[x] = best;
+    }
+}
+
+}
+
+void
+computeDistanceField(const uint8_t *coverage, uint32_t width, uint32_t height, float spread, float *distance,
+    ThreadPool *pool, DistanceFieldKernel kernel) {
+    if (width == 0 || height == 0) {
+        return;
+    }
+
+    // Any distance up to `spread` is found within `radius`; capped column
+    // distances are past it and clamp to `spread` like true ones would.
+    uint32_t radius = (uint32_t)std::ceil(spread) + 1;
+    float cap = (float)(radius + 1);
+    size_t pixels = (size_t)width * height;
+
+    // Column distances to the nearest inside pixel and to the nearest
+    // outside one.
+    std::vector<float> to_inside(pixels), to_outside(pixels);
+
+    for (size_t i = 0; i < pixels; ++i) {
+        bool inside = coverage[i] >= 128;
+        to_inside[i] = inside ? 0.0f : cap;
+        to_outside[i] = inside ? cap : 0.0f;
+    }
+
+    auto sweep = [&](size_t begin, size_t end) {
+        for (size_t strip = begin; strip < end; ++strip) {
+            uint32_t x0 = (uint32_t)strip * column_strip;
+            uint32_t x1 = std::min(x0 + column_strip, width);
+            sweepColumns(to_inside.data(), width, height, x0, x1, kernel);
+            sweepColumns(to_outside.data(), width, height, x0, x1, kernel);
+        }
+    };
+
+    auto minimize = [&](size_t begin, size_t end) {
+        std::vector<float> padded(width + 2 * radius, cap * cap);
+        std::vector<float> inside_d2(width), outside_d2(width);
+
+        for (size_t y = begin; y < end; ++y) {
+            const float *inside_row = to_inside.data() + y * width;
+            const float *outside_row = to_outside.data() + y * width;
+
+            for (uint32_t x = 0; x < width; ++x) {
+                padded[radius + x] = inside_row[x] * inside_row[x];
+            }
+
+            minimizeRow(padded.data(), width, radius, inside_d2.data(), kernel);
+
+            for (uint32_t x = 0; x < width; ++x) {
+                padded[radius + x] = outside_row[x] * outside_row[x];
+            }
+
+            minimizeRow(padded.data(), width, radius, outside_d2.data(), kernel);
+
+            float *out = distance + y * width;
+
+            for (uint32_t x = 0; x < width; ++x) {
+                float d = inside_row[x] == 0.0f ?
+                    std::sqrt(outside_d2[x]) - 0.5f :
+                    0.5f - std::sqrt(inside_d2[x]);
+                out[x] = std::clamp(d, -spread, spread);
+            }
+        }
+    };
+
+    size_t strips = (width + column_strip - 1) / column_strip;
+
+    if (pool) {
+        pool->parallelFor(strips, 1, sweep);
+        pool->parallelFor(height, 16, minimize);
+    }
+    else {
+        sweep(0, strips);
+        minimize(0, height);
+    }
+}
+
+void
+computeDistanceFieldReference(const uint8_t *coverage, uint32_t width, uint32_t height, float spread, float *distance) {
+    int radius = (int)std::ceil(spread) + 1;
+
+    for (int y = 0; y < (int)height; ++y) {
+        for (int x = 0; x < (int)width; ++x) {
+            bool inside = coverage[(size_t)y * width + x] >= 128;
+            int best = INT32_MAX;
+
+            for (int sy = std::max(y - radius, 0); sy <= std::min(y + radius, (int)height - 1); ++sy) {
+                for (int sx = std::max(x - radius, 0); sx <= std::min(x + radius, (int)width - 1); ++sx) {
+                    if ((coverage[(size_t)sy * width + sx] >= 128) != inside) {
+                        best = std::min(best, (sx - x) * (sx - x) + (sy - y) * (sy - y));
+                    }
+                }
+            }
+
+            float nearest = best == INT32_MAX ? spread + 1.0f : std::sqrt((float)best);
+            float d = inside ? nearest - 0.5f : 0.5f - nearest;
+            distance[(size_t)y * width + x] = std::clamp(d, -spread, spread);
+        }
+    }
+}
@@ -0,0 +1,217 @@
+#include "file_watcher.h"
+
+#if defined(__linux__)
+
+#include <cerrno>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <unordered_map>
+
+struct FileWatcher::Impl {
+    int fd = -1;
+    std::unordered_map<int, std::string> directories;
+};
+
+FileWatcher::FileWatcher() : d_impl(new Impl) {
+    d_impl->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+}
+
+FileWatcher::~FileWatcher() {
+    if (d_impl->fd >= 0) {
+        close(d_impl->fd);
+    }
+}
+
+bool
+FileWatcher::watchDirectory(const std::string& path) {
+    if (d_impl->fd < 0) {
+        return false;
+    }
+
+    // Editors either rewrite in place or write a temporary and rename it over.
+    int wd = inotify_add_watch(d_impl->fd, path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+
+    if (wd < 0) {
+        return false;
+    }
+
+    d_impl->directories[wd] = path;
+    return true;
+}
+
+void
+FileWatcher::poll(std::vector<std::string>& changed) {
+    if (d_impl->fd < 0) {
+        return;
+    }
+
+    alignas(inotify_event) char buffer[4096];
+
+    for (;;) {
+        ssize_t length = read(d_impl->fd, buffer, sizeof(buffer));
+
+        if (length <= 0) {
+            break;
+        }
+
+        for (char *p = buffer; p < buffer + length; ) {
+            auto event = (const inotify_event *)p;
+
+            auto directory = d_impl->directories.find(event->wd);
+
+            if (event->len > 0 && directory != d_impl->directories.end()) {
+                changed.push_back(directory->second + "/" + event->name);
+            }
+
+            p += sizeof(inotify_event) + event->len;
+        }
+    }
+}
+
+#elif defined(__APPLE__)
+
+#include <CoreServices/CoreServices.h>
+#include <mutex>
+
+namespace {
+
+// Filled on the FSEvents dispatch queue, drained by `poll`.
+struct PendingEvents {
+    std::mutex mutex;
+    std::vector<std::string> paths;
+};
+
+void
+fileEventCallback(ConstFSEventStreamRef, void *info, size_t count, void *event_paths, const FSEventStreamEventFlags flags[], const FSEventStreamEventId[]) {
+    auto pending = (PendingEvents *)info;
+    auto paths = (char **)event_paths;
+
+    std::lock_guard<std::mutex> lock(pending->mutex);
+
+    for (size_t i = 0; i < count; ++i) {
+        if (flags[i] & kFSEventStreamEventFlagItemIsFile) {
+            pending->paths.push_back(paths[i]);
+        }
+    }
+}
+
+}
+
+struct FileWatcher::Impl {
+    PendingEvents pending;
+
+    dispatch_queue_t queue = nullptr;
+    std::vector<FSEventStreamRef> streams;
+};
+
+FileWatcher::FileWatcher() : d_impl(new Impl) {
+    d_impl->queue = dispatch_queue_create("FileWatcher", DISPATCH_QUEUE_SERIAL);
+}
+
+FileWatcher::~FileWatcher() {
+    for (auto stream : d_impl->streams) {
+        FSEventStreamStop(stream);
+        FSEventStreamInvalidate(stream);
+        FSEventStreamRelease(stream);
+    }
+
+    dispatch_release(d_impl->queue);
+}
+
+bool
+FileWatcher::watchDirectory(const std::string& path) {
+    CFStringRef cf_path = CFStringCreateWithCString(nullptr, path.c_str(), kCFStringEncodingUTF8);
+    CFArrayRef cf_paths = CFArrayCreate(nullptr, (const void **)&cf_path, 1, &kCFTypeArrayCallBacks);
+
+    FSEventStreamContext context = { 0, &d_impl->pending, nullptr, nullptr, nullptr };
+
+    FSEventStreamRef stream = FSEventStreamCreate(
+        nullptr, &fileEventCallback, &context, cf_paths,
+        kFSEventStreamEventIdSinceNow, 0.02,
+        kFSEventStreamCreateFlagFileEvents | kFSEventStreamCreateFlagNoDefer);
+
+    CFRelease(cf_paths);
+    CFRelease(cf_path);
+
+    if (!stream) {
+        return false;
+    }
+
+    FSEventStreamSetDispatchQueue(stream, d_impl->queue);
+
+    if (!FSEventStreamStart(stream)) {
+        FSEventStreamInvalidate(stream);
+        FSEventStreamRelease(stream);
+        return false;
+    }
+
+    d_impl->streams.push_back(stream);
+    return true;
+}
+
+void
+FileWatcher::poll(std::vector<std::string>& changed) {
+    std::lock_guard<std::mutex> lock(d_impl->pending.mutex);
+    changed.insert(changed.end(), d_impl->pending.paths.begin(), d_impl->pending.paths.end());
+    d_impl->pending.paths.clear();
+}
+
+#else
+
+#include <filesystem>
+#include <map>
+
+struct FileWatcher::Impl {
+    std::vector<std::string> directories;
+    std::map<std::string, std::filesystem::file_time_type> times;
+};
+
+FileWatcher::FileWatcher() : d_impl(new Impl) {
+}
+
+FileWatcher::~FileWatcher() {
+}
+
+bool
+FileWatcher::watchDirectory(const std::string& path) {
+    std::error_code error;
+
+    if (!std::filesystem::is_directory(path, error)) {
+        return false;
+    }
+
+    d_impl->directories.push_back(path);
+
+    // Record current times so existing files are not reported as changed.
+    for (const auto& entry : std::filesystem::directory_iterator(path, error)) {
+        if (entry.is_regular_file(error)) {
+            d_impl->times[entry.path().string()] = entry.last_write_time(error);
+        }
+    }
+
+    return true;
+}
+
+void
+FileWatcher::poll(std::vector<std::string>& changed) {
+    std::error_code error;
+
+    for (const auto& directory : d_impl->directories) {
+        for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+            if (!entry.is_regular_file(error)) {
+                continue;
+            }
+
+            auto path = entry.path().string();
+            auto time = entry.last_write_time(error);
+            auto it = d_impl->times.find(path);
+
+            if (it == d_impl->times.end() || it->second != time) {
+                d_impl->times[path] = time;
+                changed.push_back(path);
+            }
+        }
+    }
+}
+
+#endif
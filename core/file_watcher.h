@@ -0,0 +1,28 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// Reports files written in a set of directories. Uses inotify on Linux,
+// FSEvents on macOS and modification-time polling elsewhere.
+class FileWatcher {
+public:
+
+    FileWatcher();
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    bool watchDirectory(const std::string& path);
+
+    // Appends the paths modified since the previous call. Never blocks; a
+    // single save may be reported several times.
+    void poll(std::vector<std::string>& changed);
+
+private:
+
+    struct Impl;
+    std::unique_ptr<Impl> d_impl;
+};
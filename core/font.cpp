@@ -0,0 +1,353 @@
+#include "font.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const uint32_t first_codepoint = 0x20;
+const uint32_t codepoint_count = 95;
+
+const int cell_width = 5;
+const int cell_rows = 9;
+
+// Row 6 sits on the baseline; rows 7 and 8 are descenders.
+const int baseline_row = 6;
+
+// Each row's bit 4 is the leftmost pixel.
+const uint8_t builtin_rows[codepoint_count][cell_rows] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // space
+    { 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04, 0x00, 0x00 }, // !
+    { 0x0a, 0x0a, 0x0a, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // "
+    { 0x0a, 0x0a, 0x1f, 0x0a, 0x1f, 0x0a, 0x0a, 0x00, 0x00 }, // #
+    { 0x04, 0x0f, 0x14, 0x0e, 0x05, 0x1e, 0x04, 0x00, 0x00 }, // $
+    { 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03, 0x00, 0x00 }, // %
+    { 0x0c, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0d, 0x00, 0x00 }, // &
+    { 0x0c, 0x04, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '
+    { 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02, 0x00, 0x00 }, // (
+    { 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08, 0x00, 0x00 }, // )
+    { 0x00, 0x04, 0x15, 0x0e, 0x15, 0x04, 0x00, 0x00, 0x00 }, // *
+    { 0x00, 0x04, 0x04, 0x1f, 0x04, 0x04, 0x00, 0x00, 0x00 }, // +
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x04, 0x08, 0x00 }, // ,
+    { 0x00, 0x00, 0x00, 0x1f, 0x00, 0x00, 0x00, 0x00, 0x00 }, // -
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x0c, 0x00, 0x00 }, // .
+    { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00, 0x00, 0x00 }, // /
+    { 0x0e, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0e, 0x00, 0x00 }, // 0
+    { 0x04, 0x0c, 0x04, 0x04, 0x04, 0x04, 0x0e, 0x00, 0x00 }, // 1
+    { 0x0e, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1f, 0x00, 0x00 }, // 2
+    { 0x1f, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0e, 0x00, 0x00 }, // 3
+    { 0x02, 0x06, 0x0a, 0x12, 0x1f, 0x02, 0x02, 0x00, 0x00 }, // 4
+    { 0x1f, 0x10, 0x1e, 0x01, 0x01, 0x11, 0x0e, 0x00, 0x00 }, // 5
+    { 0x06, 0x08, 0x10, 0x1e, 0x11, 0x11, 0x0e, 0x00, 0x00 }, // 6
+    { 0x1f, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08, 0x00, 0x00 }, // 7
+    { 0x0e, 0x11, 0x11, 0x0e, 0x11, 0x11, 0x0e, 0x00, 0x00 }, // 8
+    { 0x0e, 0x11, 0x11, 0x0f, 0x01, 0x02, 0x0c, 0x00, 0x00 }, // 9
+    { 0x00, 0x0c, 0x0c, 0x00, 0x0c, 0x0c, 0x00, 0x00, 0x00 }, // :
+    { 0x00, 0x0c, 0x0c, 0x00, 0x0c, 0x0c, 0x04, 0x08, 0x00 }, // ;
+    { 0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02, 0x00, 0x00 }, // <
+    { 0x00, 0x00, 0x1f, 0x00, 0x1f, 0x00, 0x00, 0x00, 0x00 }, // =
+    { 0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08, 0x00, 0x00 }, // >
+    { 0x0e, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04, 0x00, 0x00 }, // ?
+    { 0x0e, 0x11, 0x01, 0x0d, 0x15, 0x15, 0x0e, 0x00, 0x00 }, // @
+    { 0x0e, 0x11, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x00, 0x00 }, // A
+    { 0x1e, 0x11, 0x11, 0x1e, 0x11, 0x11, 0x1e, 0x00, 0x00 }, // B
+    { 0x0e, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0e, 0x00, 0x00 }, // C
+    { 0x1c, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1c, 0x00, 0x00 }, // D
+    { 0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x1f, 0x00, 0x00 }, // E
+    { 0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x10, 0x00, 0x00 }, // F
+    { 0x0e, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0f, 0x00, 0x00 }, // G
+    { 0x11, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11, 0x00, 0x00 }, // H
+    { 0x0e, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0e, 0x00, 0x00 }, // I
+    { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0c, 0x00, 0x00 }, // J
+    { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11, 0x00, 0x00 }, // K
+    { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1f, 0x00, 0x00 }, // L
+    { 0x11, 0x1b, 0x15, 0x15, 0x11, 0x11, 0x11, 0x00, 0x00 }, // M
+    { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11, 0x00, 0x00 }, // N
+    { 0x0e, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e, 0x00, 0x00 }, // O
+    { 0x1e, 0x11, 0x11, 0x1e, 0x10, 0x10, 0x10, 0x00, 0x00 }, // P
+    { 0x0e, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0d, 0x00, 0x00 }, // Q
+    { 0x1e, 0x11, 0x11, 0x1e, 0x14, 0x12, 0x11, 0x00, 0x00 }, // R
+    { 0x0f, 0x10, 0x10, 0x0e, 0x01, 0x01, 0x1e, 0x00, 0x00 }, // S
+    { 0x1f, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x00 }, // T
+    { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e, 0x00, 0x00 }, // U
+    { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0a, 0x04, 0x00, 0x00 }, // V
+    { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0a, 0x00, 0x00 }, // W
+    { 0x11, 0x11, 0x0a, 0x04, 0x0a, 0x11, 0x11, 0x00, 0x00 }, // X
+    { 0x11, 0x11, 0x11, 0x0a, 0x04, 0x04, 0x04, 0x00, 0x00 }, // Y
+    { 0x1f, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1f, 0x00, 0x00 }, // Z
+    { 0x0e, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0e, 0x00, 0x00 }, // [
+    { 0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00, 0x00, 0x00 }, // backslash
+    { 0x0e, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0e, 0x00, 0x00 }, // ]
+    { 0x04, 0x0a, 0x11, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // ^
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1f, 0x00 }, // _
+    { 0x08, 0x04, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // `
+    { 0x00, 0x00, 0x0e, 0x01, 0x0f, 0x11, 0x0f, 0x00, 0x00 }, // a
+    { 0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x1e, 0x00, 0x00 }, // b
+    { 0x00, 0x00, 0x0e, 0x10, 0x10, 0x11, 0x0e, 0x00, 0x00 }, // c
+    { 0x01, 0x01, 0x0d, 0x13, 0x11, 0x11, 0x0f, 0x00, 0x00 }, // d
+    { 0x00, 0x00, 0x0e, 0x11, 0x1f, 0x10, 0x0e, 0x00, 0x00 }, // e
+    { 0x06, 0x09, 0x08, 0x1c, 0x08, 0x08, 0x08, 0x00, 0x00 }, // f
+    { 0x00, 0x00, 0x0f, 0x11, 0x11, 0x11, 0x0f, 0x01, 0x0e }, // g
+    { 0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x11, 0x00, 0x00 }, // h
+    { 0x04, 0x00, 0x0c, 0x04, 0x04, 0x04, 0x0e, 0x00, 0x00 }, // i
+    { 0x02, 0x00, 0x06, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0c }, // j
+    { 0x10, 0x10, 0x12, 0x14, 0x18, 0x14, 0x12, 0x00, 0x00 }, // k
+    { 0x0c, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0e, 0x00, 0x00 }, // l
+    { 0x00, 0x00, 0x1a, 0x15, 0x15, 0x11, 0x11, 0x00, 0x00 }, // m
+    { 0x00, 0x00, 0x16, 0x19, 0x11, 0x11, 0x11, 0x00, 0x00 }, // n
+    { 0x00, 0x00, 0x0e, 0x11, 0x11, 0x11, 0x0e, 0x00, 0x00 }, // o
+    { 0x00, 0x00, 0x1e, 0x11, 0x11, 0x11, 0x1e, 0x10, 0x10 }, // p
+    { 0x00, 0x00, 0x0f, 0x11, 0x11, 0x11, 0x0f, 0x01, 0x01 }, // q
+    { 0x00, 0x00, 0x16, 0x19, 0x10, 0x10, 0x10, 0x00, 0x00 }, // r
+    { 0x00, 0x00, 0x0e, 0x10, 0x0e, 0x01, 0x1e, 0x00, 0x00 }, // s
+    { 0x08, 0x08, 0x1c, 0x08, 0x08, 0x09, 0x06, 0x00, 0x00 }, // t
+    { 0x00, 0x00, 0x11, 0x11, 0x11, 0x13, 0x0d, 0x00, 0x00 }, // u
+    { 0x00, 0x00, 0x11, 0x11, 0x11, 0x0a, 0x04, 0x00, 0x00 }, // v
+    { 0x00, 0x00, 0x11, 0x11, 0x15, 0x15, 0x0a, 0x00, 0x00 }, // w
+    { 0x00, 0x00, 0x11, 0x0a, 0x04, 0x0a, 0x11, 0x00, 0x00 }, // x
+    { 0x00, 0x00, 0x11, 0x11, 0x11, 0x11, 0x0f, 0x01, 0x0e }, // y
+    { 0x00, 0x00, 0x1f, 0x02, 0x04, 0x08, 0x1f, 0x00, 0x00 }, // z
+    { 0x02, 0x04, 0x04, 0x08, 0x04, 0x04, 0x02, 0x00, 0x00 }, // {
+    { 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x00 }, // |
+    { 0x08, 0x04, 0x04, 0x02, 0x04, 0x04, 0x08, 0x00, 0x00 }, // }
+    { 0x00, 0x00, 0x08, 0x15, 0x02, 0x00, 0x00, 0x00, 0x00 }, // ~
+};
+
+// Advance of glyphs without ink.
+const int space_advance = 3;
+
+// Most a pair is ever moved together, in font units.
+const float max_kerning = 1.0f;
+
+// Leftmost and rightmost ink column of each row, -1 in rows without ink.
+struct RowProfile {
+    int left[cell_rows], right[cell_rows];
+};
+
+bool
+inked(uint8_t row, int column) {
+    return (row >> (cell_width - 1 - column)) & 1;
+}
+
+RowProfile
+profileOf(const uint8_t *rows, int shift) {
+    RowProfile profile;
+
+    for (int r = 0; r < cell_rows; ++r) {
+        profile.left[r] = profile.right[r] = -1;
+
+        for (int c = 0; c < cell_width; ++c) {
+            if (inked(rows[r], c)) {
+                if (profile.left[r] < 0) {
+                    profile.left[r] = c - shift;
+                }
+
+                profile.right[r] = c - shift;
+            }
+        }
+    }
+
+    return profile;
+}
+
+void
+addRectangle(GlyphOutline& outline, float x0, float y0, float x1, float y1) {
+    outline.points.push_back({ x0, y0 });
+    outline.points.push_back({ x1, y0 });
+    outline.points.push_back({ x1, y1 });
+    outline.points.push_back({ x0, y1 });
+    outline.contour_ends.push_back((uint32_t)outline.points.size());
+}
+
+Font
+makeBuiltinFont() {
+    Font font;
+    font.units_per_em = 10.0f;
+    font.ascent = 7.0f;
+    font.descent = 2.0f;
+    font.line_gap = 1.0f;
+
+    RowProfile profiles[codepoint_count];
+
+    for (uint32_t i = 0; i < codepoint_count; ++i) {
+        const uint8_t *rows = builtin_rows[i];
+        Glyph& glyph = font.glyphs[first_codepoint + i];
+
+        // Columns are shifted so ink starts at x = 0.
+        int ink_left = cell_width, ink_right = -1;
+
+        for (int r = 0; r < cell_rows; ++r) {
+            for (int c = 0; c < cell_width; ++c) {
+                if (inked(rows[r], c)) {
+                    ink_left = std::min(ink_left, c);
+                    ink_right = std::max(ink_right, c);
+                }
+            }
+        }
+
+        profiles[i] = profileOf(rows, ink_right < 0 ? 0 : ink_left);
+
+        if (ink_right < 0) {
+            glyph.advance = (float)space_advance;
+            continue;
+        }
+
+        glyph.advance = (float)(ink_right - ink_left + 2);
+        bool first = true;
+
+        // One rectangle per horizontal run of ink.
+        for (int r = 0; r < cell_rows; ++r) {
+            float top = (float)(baseline_row + 1 - r), bottom = top - 1.0f;
+
+            for (int c = 0; c < cell_width;) {
+                if (!inked(rows[r], c)) {
+                    ++c;
+                    continue;
+                }
+
+                int end = c;
+
+                while (end < cell_width && inked(rows[r], end)) {
+                    ++end;
+                }
+
+                float x0 = (float)(c - ink_left), x1 = (float)(end - ink_left);
+                addRectangle(glyph.outline, x0, bottom, x1, top);
+
+                glyph.left = first ? x0 : std::min(glyph.left, x0);
+                glyph.right = first ? x1 : std::max(glyph.right, x1);
+                glyph.bottom = first ? bottom : std::min(glyph.bottom, bottom);
+                glyph.top = first ? top : std::max(glyph.top, top);
+                first = false;
+                c = end;
+            }
+        }
+    }
+
+    // A pair kerns together until the ink of the right glyph, in any row,
+    // would come within one pixel of the left glyph's ink in the same row or
+    // a neighbouring one.
+    for (uint32_t a = 0; a < codepoint_count; ++a) {
+        const Glyph& left_glyph = font.glyphs[first_codepoint + a];
+
+        if (left_glyph.outline.empty()) {
+            continue;
+        }
+
+        for (uint32_t b = 0; b < codepoint_count; ++b) {
+            if (font.glyphs[first_codepoint + b].outline.empty()) {
+                continue;
+            }
+
+            int nearest = INT32_MAX;
+
+            for (int r = 0; r < cell_rows; ++r) {
+                if (profiles[b].left[r] < 0) {
+                    continue;
+                }
+
+                for (int n = std::max(r - 1, 0); n <= std::min(r + 1, cell_rows - 1); ++n) {
+                    if (profiles[a].right[n] >= 0) {
+                        int gap = (int)left_glyph.advance - (profiles[a].right[n] + 1) + profiles[b].left[r];
+                        nearest = std::min(nearest, gap);
+                    }
+                }
+            }
+
+            if (nearest != INT32_MAX && nearest > 1) {
+                float amount = std::min((float)(nearest - 1), max_kerning);
+                font.kerning[Font::kerningKey(first_codepoint + a, first_codepoint + b)] = -amount;
+            }
+        }
+    }
+
+    return font;
+}
+
+struct Crossing {
+    float x;
+    int winding;
+};
+
+}
+
+const Glyph *
+Font::glyph(uint32_t codepoint) const {
+    auto found = glyphs.find(codepoint);
+
+    if (found == glyphs.end()) {
+        found = glyphs.find('?');
+    }
+
+    return found == glyphs.end() ? nullptr : &found->second;
+}
+
+const Font&
+builtinFont() {
+    static const Font font = makeBuiltinFont();
+    return font;
+}
+
+void
+rasterizeOutline(const GlyphOutline& outline, float scale, float origin_x, float origin_y,
+    uint32_t width, uint32_t height, uint8_t *coverage) {
+    const int grid = 4;
+
+    std::vector<Crossing> crossings;
+    std::vector<uint16_t> samples(width);
+
+    for (uint32_t y = 0; y < height; ++y) {
+        std::fill(samples.begin(), samples.end(), 0);
+
+        for (int sub = 0; sub < grid; ++sub) {
+            float scan = (float)y + (sub + 0.5f) / grid;
+            crossings.clear();
+
+            uint32_t start = 0;
+
+            for (uint32_t end : outline.contour_ends) {
+                for (uint32_t i = start; i < end; ++i) {
+                    const OutlinePoint& p0 = outline.points[i];
+                    const OutlinePoint& p1 = outline.points[i + 1 < end ? i + 1 : start];
+
+                    float y0 = origin_y - p0.y * scale, y1 = origin_y - p1.y * scale;
+
+                    if (y0 == y1 || scan < std::min(y0, y1) || scan >= std::max(y0, y1)) {
+                        continue;
+                    }
+
+                    float x0 = origin_x + p0.x * scale, x1 = origin_x + p1.x * scale;
+                    float t = (scan - y0) / (y1 - y0);
+                    crossings.push_back({ x0 + (x1 - x0) * t, y1 > y0 ? 1 : -1 });
+                }
+
+                start = end;
+            }
+
+            std::sort(crossings.begin(), crossings.end(),
+                [](const Crossing& a, const Crossing& b) { return a.x < b.x; });
+
+            int winding = 0;
+
+            for (size_t i = 0; i + 1 < crossings.size(); ++i) {
+                winding += crossings[i].winding;
+
+                if (winding == 0) {
+                    continue;
+                }
+
+                // Horizontal samples sit at (j + 0.5) / grid for integer j.
+                int first = std::max((int)std::ceil(crossings[i].x * grid - 0.5f), 0);
+                int last = std::min((int)std::ceil(crossings[i + 1].x * grid - 0.5f), (int)width * grid);
+
+                for (int j = first; j < last; ++j) {
+                    ++samples[j / grid];
+                }
+            }
+        }
+
+        for (uint32_t x = 0; x < width; ++x) {
+            coverage[(size_t)y * width + x] = (uint8_t)std::min(samples[x] * 255 / (grid * grid), 255);
+        }
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+struct OutlinePoint {
+    float x, y;
+};
+
+// Closed polygons in font units, y up with the baseline at 0. Filled with the
+// nonzero winding rule, so overlapping contours of the same direction merge.
+struct GlyphOutline {
+    std::vector<OutlinePoint> points;
+
+    // One past the last point of each contour.
+    std::vector<uint32_t> contour_ends;
+
+    bool empty() const {
+        return contour_ends.empty();
+    }
+};
+
+struct Glyph {
+    GlyphOutline outline;
+    float advance = 0.0f;
+
+    // Bounding box of the outline; all zero for empty glyphs.
+    float left = 0.0f, bottom = 0.0f, right = 0.0f, top = 0.0f;
+};
+
+// Glyph outlines and metrics, in font units.
+struct Font {
+    float units_per_em = 1.0f;
+    float ascent = 0.0f, descent = 0.0f, line_gap = 0.0f;
+
+    std::unordered_map<uint32_t, Glyph> glyphs;
+
+    // Extra advance between a pair of codepoints, keyed by `kerningKey`.
+    std::unordered_map<uint64_t, float> kerning;
+
+    static uint64_t kerningKey(uint32_t left, uint32_t right) {
+        return ((uint64_t)left << 32) | right;
+    }
+
+    // The glyph for `codepoint`, falling back to '?', or null when neither
+    // exists.
+    const Glyph *glyph(uint32_t codepoint) const;
+
+    float kerningBetween(uint32_t left, uint32_t right) const {
+        auto found = kerning.find(kerningKey(left, right));
+        return found == kerning.end() ? 0.0f : found->second;
+    }
+
+    float lineHeight() const {
+        return ascent + descent + line_gap;
+    }
+};
+
+// Printable ASCII drawn from a 5x7 pixel design with two descender rows,
+// one font unit per pixel. Spacing is proportional and kerning pairs are
+// derived from the glyphs' row profiles.
+const Font& builtinFont();
+
+// Rasterizes `outline` into `width` x `height` 8-bit coverage, rows top to
+// bottom, sampling each pixel on a 4x4 grid. Font unit (x, y) lands at pixel
+// (origin_x + x * scale, origin_y - y * scale).
+void rasterizeOutline(const GlyphOutline& outline, float scale, float origin_x, float origin_y,
+    uint32_t width, uint32_t height, uint8_t *coverage);
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <mutex>
+#include <utility>
+
+// Hands a value built on another thread to the render loop. The loop calls
+// `take` at a frame boundary; it never waits, so if the producer happens to
+// hold the lock the swap just slips to the next frame.
+template<typename T>
+class FrameSwap {
+public:
+
+    // Replaces any value that has not been taken yet.
+    void publish(T value) {
+        std::lock_guard<std::mutex> lock(d_mutex);
+        d_value = std::move(value);
+        d_ready = true;
+    }
+
+    bool take(T& out) {
+        std::unique_lock<std::mutex> lock(d_mutex, std::try_to_lock);
+
+        if (!lock.owns_lock() || !d_ready) {
+            return false;
+        }
+
+        out = std::move(d_value);
+        d_value = T();
+        d_ready = false;
+        return true;
+    }
+
+private:
+
+    std::mutex d_mutex;
+    T d_value {};
+    bool d_ready = false;
+};
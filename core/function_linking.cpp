@@ -0,0 +1,155 @@
+#include "function_linking.h"
+#include "string_hash.h"
+
+#include <algorithm>
+#include <cassert>
+
+uint64_t
+LinkSet::hash() const {
+    // Each list led by its length, so no run of names can pass for a
+    // library index or the other way around.
+    std::string description = std::to_string(functions.size()) + ':';
+
+    for (const std::string& function : functions) {
+        description += function;
+        description += '\0';
+    }
+
+    description += std::to_string(libraries.size()) + ':';
+
+    for (uint32_t library : libraries) {
+        description += std::to_string(library);
+        description += '\0';
+    }
+
+    return hashName(description);
+}
+
+uint32_t
+LinkResolver::addLibrary(ShaderLibraryInfo library) {
+    uint32_t index = (uint32_t)d_libraries.size();
+    d_libraries.push_back(std::move(library));
+
+    // The names stay where they are when `d_libraries` grows, since moving
+    // a library moves its function array rather than the functions.
+    const auto& functions = d_libraries.back().functions;
+
+    for (uint32_t i = 0; i < functions.size(); ++i) {
+        d_definitions.emplace(functions[i].name, Definition { index, i });
+    }
+
+    return index;
+}
+
+bool
+LinkResolver::resolve(const std::vector<std::string>& roots, LinkSet& set) const {
+    set.functions.clear();
+    set.libraries.clear();
+    set.missing.clear();
+
+    std::vector<bool> preload(d_libraries.size(), false);
+    std::unordered_map<std::string_view, bool> visited;
+    std::vector<std::string_view> pending(roots.begin(), roots.end());
+
+    while (!pending.empty()) {
+        std::string_view name = pending.back();
+        pending.pop_back();
+
+        if (!visited.emplace(name, true).second) {
+            continue;
+        }
+
+        auto found = d_definitions.find(name);
+
+        if (found == d_definitions.end()) {
+            set.missing.emplace_back(name);
+            continue;
+        }
+
+        const ShaderLibraryInfo& library = d_libraries[found->second.library];
+        const ShaderFunctionInfo& function = library.functions[found->second.function];
+
+        if (library.dynamic) {
+            preload[found->second.library] = true;
+        }
+        else {
+            set.functions.push_back(function.name);
+        }
+
+        for (const std::string& call : function.calls) {
+            pending.push_back(call);
+        }
+    }
+
+    for (uint32_t i = 0; i < preload.size(); ++i) {
+        if (preload[i]) {
+            set.libraries.push_back(i);
+        }
+    }
+
+    std::sort(set.functions.begin(), set.functions.end());
+    std::sort(set.missing.begin(), set.missing.end());
+
+    return set.missing.empty();
+}
+
+FunctionTableSlots::FunctionTableSlots(uint32_t capacity)
+    : d_allocator(capacity)
+    , d_names(capacity)
+    , d_references(capacity, 0) {
+}
+
+uint32_t
+FunctionTableSlots::acquire(std::string_view name) {
+    uint32_t slot = find(name);
+
+    if (slot == invalid_slot) {
+        slot = d_allocator.allocate();
+
+        if (slot == invalid_slot) {
+            return invalid_slot;
+        }
+
+        d_names[slot] = std::string(name);
+        d_slots.emplace(d_names[slot], slot);
+    }
+
+    ++d_references[slot];
+    return slot;
+}
+
+void
+FunctionTableSlots::release(uint32_t slot) {
+    assert(slot < capacity() && d_references[slot] > 0 && "releasing a function table slot not in use");
+
+    if (slot >= capacity() || d_references[slot] == 0) {
+        return;
+    }
+
+    if (--d_references[slot] > 0) {
+        return;
+    }
+
+    d_slots.erase(d_names[slot]);
+    d_names[slot].clear();
+    d_allocator.free(slot);
+}
+
+uint32_t
+FunctionTableSlots::find(std::string_view name) const {
+    auto found = d_slots.find(std::string(name));
+    return found == d_slots.end() ? invalid_slot : found->second;
+}
+
+std::vector<std::string>
+FunctionTableSlots::names() const {
+    std::vector<std::string> names;
+
+    for (const std::string& name : d_names) {
+        if (!name.empty()) {
+            names.push_back(name);
+        }
+    }
+
+    return names;
+}
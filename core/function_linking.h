@@ -0,0 +1,143 @@
+#pragma once
+
+#include "handle_table.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Bookkeeping for shader functions linked at pipeline creation rather than
+// compiled into it: which functions and dynamic libraries a pipeline needs,
+// and which slot of a visible function table each function occupies.
+// material_renderer.h turns the results into `MTL::LinkedFunctions`,
+// preloaded `MTL::DynamicLibrary` lists and `MTL::VisibleFunctionTable`
+// entries.
+
+// A function a library exports and the functions it calls directly, by
+// name, in this library or others.
+struct ShaderFunctionInfo {
+    std::string name;
+    std::vector<std::string> calls;
+};
+
+// Functions of a dynamic library are resolved by preloading the library;
+// those of other libraries are linked into the pipeline one by one.
+struct ShaderLibraryInfo {
+    std::string name;
+    bool dynamic = false;
+    std::vector<ShaderFunctionInfo> functions;
+};
+
+// What a pipeline needs for a set of functions.
+struct LinkSet {
+    // Functions to link from libraries that are not dynamic, sorted by
+    // name, so equal sets compare and hash equal.
+    std::vector<std::string> functions;
+
+    // Indices of the dynamic libraries to preload, in registration order.
+    std::vector<uint32_t> libraries;
+
+    // Functions called but exported by no library, sorted by name.
+    std::vector<std::string> missing;
+
+    // Of the functions and libraries, to tell pipelines linked with
+    // different sets apart.
+    uint64_t hash() const;
+
+    // Equal functions and libraries; what is missing is not compared.
+    bool operator==(const LinkSet& other) const {
+        return functions == other.functions && libraries == other.libraries;
+    }
+};
+
+class LinkResolver {
+public:
+
+    LinkResolver() = default;
+
+    // Definitions point into the libraries, which survive a move but not a
+    // copy.
+    LinkResolver(LinkResolver&&) = default;
+    LinkResolver& operator=(LinkResolver&&) = default;
+    LinkResolver(const LinkResolver&) = delete;
+    LinkResolver& operator=(const LinkResolver&) = delete;
+
+    // Returns the library's index. A function exported by several
+    // libraries resolves to the first one added, as with a linker's search
+    // order.
+    uint32_t addLibrary(ShaderLibraryInfo library);
+
+    const ShaderLibraryInfo& library(uint32_t index) const {
+        return d_libraries[index];
+    }
+
+    uint32_t libraryCount() const {
+        return (uint32_t)d_libraries.size();
+    }
+
+    // Fills `set` with everything `roots` reach through their calls,
+    // including what functions in dynamic libraries call. Returns false if
+    // any function is missing.
+    bool resolve(const std::vector<std::string>& roots, LinkSet& set) const;
+
+private:
+
+    struct Definition {
+        uint32_t library;
+        uint32_t function;
+    };
+
+    std::vector<ShaderLibraryInfo> d_libraries;
+    std::unordered_map<std::string_view, Definition> d_definitions;
+};
+
+// Slots of a visible function table, one per distinct function however
+// many users it has. Functions are reference counted, and the slot of one
+// whose last user lets go is the next one handed out.
+class FunctionTableSlots {
+public:
+
+    static constexpr uint32_t invalid_slot = SlotAllocator::invalid_slot;
+
+    explicit FunctionTableSlots(uint32_t capacity);
+
+    // The slot holding `name`, taking a reference to it. Returns
+    // `invalid_slot` when the function is new and the table is full.
+    uint32_t acquire(std::string_view name);
+
+    // Drops a reference taken by `acquire`. The slot must be in use;
+    // release builds ignore one that is not.
+    void release(uint32_t slot);
+
+    // `invalid_slot` unless `name` holds a slot.
+    uint32_t find(std::string_view name) const;
+
+    // Empty for a free slot.
+    const std::string& name(uint32_t slot) const {
+        return d_names[slot];
+    }
+
+    uint32_t references(uint32_t slot) const {
+        return d_references[slot];
+    }
+
+    // The functions holding slots, in slot order: the roots to resolve.
+    std::vector<std::string> names() const;
+
+    uint32_t capacity() const {
+        return d_allocator.capacity();
+    }
+
+    uint32_t size() const {
+        return d_allocator.size();
+    }
+
+private:
+
+    SlotAllocator d_allocator;
+    std::vector<std::string> d_names;
+    std::vector<uint32_t> d_references;
+    std::unordered_map<std::string, uint32_t> d_slots;
+};
@@ -0,0 +1,121 @@
+#include "geometry.h"
+
+#include <cmath>
+
+namespace {
+
+void
+normalize(float v[3]) {
+    float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+
+    for (int c = 0; c < 3; ++c) {
+        v[c] /= length;
+    }
+}
+
+void
+cross(const float a[3], const float b[3], float out[3]) {
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+float
+dot(const float a[3], const float b[3]) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// Point on a (3, 2) torus knot and its derivative.
+void
+knot(float t, float p[3], float d[3]) {
+    float r = 2.0f + std::cos(3.0f * t);
+    p[0] = r * std::cos(2.0f * t);
+    p[1] = r * std::sin(2.0f * t);
+    p[2] = std::sin(3.0f * t);
+
+    float dr = -3.0f * std::sin(3.0f * t);
+    d[0] = dr * std::cos(2.0f * t) - 2.0f * r * std::sin(2.0f * t);
+    d[1] = dr * std::sin(2.0f * t) + 2.0f * r * std::cos(2.0f * t);
+    d[2] = 3.0f * std::cos(3.0f * t);
+}
+
+}
+
+void
+multiplyMatrices(const float a[16], const float b[16], float out[16]) {
+    for (int c = 0; c < 4; ++c) {
+        for (int r = 0; r < 4; ++r) {
+            out[c * 4 + r] = a[r] * b[c * 4] + a[4 + r] * b[c * 4 + 1] + a[8 + r] * b[c * 4 + 2] + a[12 + r] * b[c * 4 + 3];
+        }
+    }
+}
+
+void
+lookAt(const float eye[3], const float target[3], const float up[3], float out[16]) {
+    float forward[3] = { target[0] - eye[0], target[1] - eye[1], target[2] - eye[2] }, right[3], camera_up[3];
+    normalize(forward);
+    cross(forward, up, right);
+    normalize(right);
+    cross(right, forward, camera_up);
+
+    for (int c = 0; c < 3; ++c) {
+        out[c * 4 + 0] = right[c];
+        out[c * 4 + 1] = camera_up[c];
+        out[c * 4 + 2] = -forward[c];
+        out[c * 4 + 3] = 0.0f;
+    }
+
+    out[12] = -dot(right, eye);
+    out[13] = -dot(camera_up, eye);
+    out[14] = dot(forward, eye);
+    out[15] = 1.0f;
+}
+
+void
+perspective(float fov_y, float aspect, float near, float far, float out[16]) {
+    const float f = 1.0f / std::tan(0.5f * fov_y);
+
+    for (int i = 0; i < 16; ++i) {
+        out[i] = 0.0f;
+    }
+
+    out[0] = f / aspect;
+    out[5] = f;
+    out[10] = far / (near - far);
+    out[11] = -1.0f;
+    out[14] = near * far / (near - far);
+}
+
+void
+torusKnot(uint32_t segments, uint32_t sides, std::vector<float>& positions, std::vector<float>& normals,
+    std::vector<uint32_t>& indices) {
+    uint32_t base = (uint32_t)(positions.size() / 3);
+
+    for (uint32_t i = 0; i < segments; ++i) {
+        float t = 2.0f * float(M_PI) * i / segments;
+        float p[3], tangent[3], up[3] = { 0.0f, 0.0f, 1.0f }, side[3], bend[3];
+        knot(t, p, tangent);
+        normalize(tangent);
+        cross(tangent, up, side);
+        normalize(side);
+        cross(side, tangent, bend);
+
+        for (uint32_t j = 0; j < sides; ++j) {
+            float a = 2.0f * float(M_PI) * j / sides;
+
+            for (int c = 0; c < 3; ++c) {
+                float n = std::cos(a) * side[c] + std::sin(a) * bend[c];
+                normals.push_back(n);
+                positions.push_back(p[c] + 0.4f * n);
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < segments; ++i) {
+        for (uint32_t j = 0; j < sides; ++j) {
+            uint32_t a = base + i * sides + j, b = base + ((i + 1) % segments) * sides + j;
+            uint32_t c = base + ((i + 1) % segments) * sides + (j + 1) % sides, d = base + i * sides + (j + 1) % sides;
+            indices.insert(indices.end(), { a, b, c, a, c, d });
+        }
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Column-major 4x4 matrix helpers for building cameras on the CPU, and the
+// procedural torus knot that the meshlet renderer draws and the benches and
+// tests load.
+
+// Column-major a * b.
+void multiplyMatrices(const float a[16], const float b[16], float out[16]);
+
+// Right-handed view matrix from `eye` towards `target`, with `up` roughly up
+// on screen; the camera looks down its -z.
+void lookAt(const float eye[3], const float target[3], const float up[3], float out[16]);
+
+// Perspective projection looking down -z with Metal's 0..1 depth, from the
+// vertical field of view in radians and width over height.
+void perspective(float fov_y, float aspect, float near, float far, float out[16]);
+
+// Appends a tube of radius 0.4 around a (3, 2) torus knot, with `segments`
+// rings along the knot and `sides` vertices around each. Positions and
+// normals are packed xyz, one per vertex; each ring-by-side quad adds six
+// indices, two triangles wound counter-clockwise seen from outside.
+void torusKnot(uint32_t segments, uint32_t sides, std::vector<float>& positions, std::vector<float>& normals,
+    std::vector<uint32_t>& indices);
@@ -0,0 +1,921 @@
+#include "mapped_file.h"
+#include "mesh_loader.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace {
+
+const uint32_t glb_magic = 0x46546c67;
+const uint32_t glb_json_chunk = 0x4e4f534a;
+const uint32_t glb_binary_chunk = 0x004e4942;
+
+// Vertices, and indices, per parallel decode task.
+const size_t decode_task_size = 64 * 1024;
+
+// Just enough JSON for a glTF document: objects keep their keys in order
+// next to the values, which is all the lookups here need.
+struct JsonValue {
+    enum Type : uint8_t { Null, Bool, Number, String, Array, Object };
+
+    Type type = Null;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> items;
+    std::vector<std::string> keys;
+
+    const JsonValue *get(const char *key) const {
+        if (type != Object) {
+            return nullptr;
+        }
+
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (keys[i] == key) {
+                return &items[i];
+            }
+        }
+
+        return nullptr;
+    }
+
+    const JsonValue *at(size_t index) const {
+        return type == Array && index < items.size() ? &items[index] : nullptr;
+    }
+
+    size_t size() const {
+        return type == Array ? items.size() : 0;
+    }
+
+    double numberOr(const char *key, double fallback) const {
+        const JsonValue *value = get(key);
+        return value && value->type == Number ? value->number : fallback;
+    }
+
+    // Sizes, counts and offsets: `fallback` when missing, false unless a
+    // whole number from 0 up to 2^53, past which doubles skip integers.
+    bool sizeOr(const char *key, size_t fallback, size_t& out) const {
+        const JsonValue *value = get(key);
+
+        if (!value) {
+            out = fallback;
+            return true;
+        }
+
+        if (value->type != Number || !(value->number >= 0.0 && value->number <= 9007199254740992.0) ||
+            value->number != std::floor(value->number)) {
+            return false;
+        }
+
+        out = (size_t)value->number;
+        return true;
+    }
+
+    // -1 when missing or not a valid index.
+    int64_t index(const char *key) const {
+        double value = numberOr(key, -1.0);
+        return value >= 0.0 && value < 4294967296.0 && value == std::floor(value) ? (int64_t)value : -1;
+    }
+};
+
+class JsonParser {
+public:
+
+    JsonParser(const char *text, size_t size)
+        : d_s(text), d_end(text + size) {
+    }
+
+    bool parse(JsonValue& value) {
+        return parseValue(value, 0) && (skipSpace(), d_s == d_end);
+    }
+
+private:
+
+    void skipSpace() {
+        while (d_s < d_end && (*d_s == ' ' || *d_s == '\t' || *d_s == '\n' || *d_s == '\r')) {
+            ++d_s;
+        }
+    }
+
+    bool literal(const char *word) {
+        size_t length = std::strlen(word);
+
+        if ((size_t)(d_end - d_s) < length || std::memcmp(d_s, word, length) != 0) {
+            return false;
+        }
+
+        d_s += length;
+        return true;
+    }
+
+    bool parseString(std::string& out) {
+        if (d_s == d_end || *d_s != '"') {
+            return false;
+        }
+
+        ++d_s;
+
+        while (d_s < d_end && *d_s != '"') {
+            char c = *d_s++;
+
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+
+            if (d_s == d_end) {
+                return false;
+            }
+
+            c = *d_s++;
+
+            switch (c) {
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    if (d_end - d_s < 4) {
+                        return false;
+                    }
+
+                    unsigned code = (unsigned)std::strtoul(std::string(d_s, 4).c_str(), nullptr, 16);
+                    d_s += 4;
+
+                    // Names and URIs only; surrogate pairs come out as two
+                    // three-byte sequences.
+                    if (code < 0x80) {
+                        out += char(code);
+                    }
+                    else if (code < 0x800) {
+                        out += char(0xc0 | code >> 6);
+                        out += char(0x80 | (code & 0x3f));
+                    }
+                    else {
+                        out += char(0xe0 | code >> 12);
+                        out += char(0x80 | (code >> 6 & 0x3f));
+                        out += char(0x80 | (code & 0x3f));
+                    }
+
+                    break;
+                }
+                default: out += c; break;
+            }
+        }
+
+        if (d_s == d_end) {
+            return false;
+        }
+
+        ++d_s;
+        return true;
+    }
+
+    bool parseValue(JsonValue& value, int depth) {
+        skipSpace();
+
+        if (d_s == d_end || depth > 64) {
+            return false;
+        }
+
+        switch (*d_s) {
+            case '{': {
+                value.type = JsonValue::Object;
+                ++d_s;
+                skipSpace();
+
+                if (d_s < d_end && *d_s == '}') {
+                    ++d_s;
+                    return true;
+                }
+
+                for (;;) {
+                    skipSpace();
+                    value.keys.emplace_back();
+                    value.items.emplace_back();
+
+                    if (!parseString(value.keys.back())) {
+                        return false;
+                    }
+
+                    skipSpace();
+
+                    if (d_s == d_end || *d_s++ != ':' || !parseValue(value.items.back(), depth + 1)) {
+                        return false;
+                    }
+
+                    skipSpace();
+
+                    if (d_s == d_end) {
+                        return false;
+                    }
+
+                    if (*d_s == '}') {
+                        ++d_s;
+                        return true;
+                    }
+
+                    if (*d_s++ != ',') {
+                        return false;
+                    }
+                }
+            }
+            case '[': {
+                value.type = JsonValue::Array;
+                ++d_s;
+                skipSpace();
+
+                if (d_s < d_end && *d_s == ']') {
+                    ++d_s;
+                    return true;
+                }
+
+                for (;;) {
+                    value.items.emplace_back();
+
+                    if (!parseValue(value.items.back(), depth + 1)) {
+                        return false;
+                    }
+
+                    skipSpace();
+
+                    if (d_s == d_end) {
+                        return false;
+                    }
+
+                    if (*d_s == ']') {
+                        ++d_s;
+                        return true;
+                    }
+
+                    if (*d_s++ != ',') {
+                        return false;
+                    }
+                }
+            }
+            case '"':
+                value.type = JsonValue::String;
+                return parseString(value.string);
+            case 't':
+                value.type = JsonValue::Bool;
+                value.number = 1.0;
+                return literal("true");
+            case 'f':
+                value.type = JsonValue::Bool;
+                return literal("false");
+            case 'n':
+                return literal("null");
+            default: {
+                float number;
+                value.type = JsonValue::Number;
+
+                // Integers past 2^24 (byte offsets, counts) need more than a
+                // float, so only fractions go through the float parser.
+                const char *s = d_s;
+                bool negative = *s == '-';
+                s += negative ? 1 : 0;
+                uint64_t integer = 0;
+
+                while (s < d_end && *s >= '0' && *s <= '9' && integer < (1ull << 53)) {
+                    integer = integer * 10 + uint64_t(*s++ - '0');
+                }
+
+                if (s > d_s + (negative ? 1 : 0) && (s == d_end || !std::strchr(".eE0123456789", *s))) {
+                    value.number = negative ? -double(integer) : double(integer);
+                    d_s = s;
+                    return true;
+                }
+
+                if (!parseFloat(&d_s, d_end, &number)) {
+                    return false;
+                }
+
+                value.number = number;
+                return true;
+            }
+        }
+    }
+
+    const char *d_s;
+    const char *d_end;
+};
+
+struct Accessor {
+    const uint8_t *data = nullptr;
+    size_t count = 0;
+    size_t stride = 0;
+    int component_type = 0;
+    int components = 0;
+    bool normalized = false;
+};
+
+size_t
+componentSize(int component_type) {
+    switch (component_type) {
+        case 5120: case 5121: return 1;
+        case 5122: case 5123: return 2;
+        case 5125: case 5126: return 4;
+        default: return 0;
+    }
+}
+
+int
+componentCount(const std::string& type) {
+    static const struct { const char *name; int count; } types[] = {
+        { "SCALAR", 1 }, { "VEC2", 2 }, { "VEC3", 3 }, { "VEC4", 4 }, { "MAT2", 4 }, { "MAT3", 9 }, { "MAT4", 16 },
+    };
+
+    for (const auto& t : types) {
+        if (type == t.name) {
+            return t.count;
+        }
+    }
+
+    return 0;
+}
+
+// Component `c` of element `i` as a float, with normalized integers mapped
+// to [0, 1] or [-1, 1] as the glTF specification has it.
+inline float
+readComponent(const Accessor& a, size_t i, int c) {
+    const uint8_t *p = a.data + i * a.stride + c * componentSize(a.component_type);
+
+    switch (a.component_type) {
+        case 5120: {
+            int8_t v;
+            std::memcpy(&v, p, 1);
+            return a.normalized ? std::max(v / 127.0f, -1.0f) : v;
+        }
+        case 5121:
+            return a.normalized ? *p / 255.0f : *p;
+        case 5122: {
+            int16_t v;
+            std::memcpy(&v, p, 2);
+            return a.normalized ? std::max(v / 32767.0f, -1.0f) : v;
+        }
+        case 5123: {
+            uint16_t v;
+            std::memcpy(&v, p, 2);
+            return a.normalized ? v / 65535.0f : v;
+        }
+        case 5125: {
+            uint32_t v;
+            std::memcpy(&v, p, 4);
+            return (float)v;
+        }
+        default: {
+            float v;
+            std::memcpy(&v, p, 4);
+            return v;
+        }
+    }
+}
+
+inline uint32_t
+readIndex(const Accessor& a, size_t i) {
+    const uint8_t *p = a.data + i * a.stride;
+
+    switch (a.component_type) {
+        case 5121:
+            return *p;
+        case 5123: {
+            uint16_t v;
+            std::memcpy(&v, p, 2);
+            return v;
+        }
+        default: {
+            uint32_t v;
+            std::memcpy(&v, p, 4);
+            return v;
+        }
+    }
+}
+
+// Column-major, as glTF stores it.
+struct Matrix {
+    float m[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+};
+
+Matrix
+multiply(const Matrix& a, const Matrix& b) {
+    Matrix r;
+
+    for (int column = 0; column < 4; ++column) {
+        for (int row = 0; row < 4; ++row) {
+            float sum = 0.0f;
+
+            for (int k = 0; k < 4; ++k) {
+                sum += a.m[k * 4 + row] * b.m[column * 4 + k];
+            }
+
+            r.m[column * 4 + row] = sum;
+        }
+    }
+
+    return r;
+}
+
+Matrix
+nodeMatrix(const JsonValue& node) {
+    Matrix r;
+    const JsonValue *matrix = node.get("matrix");
+
+    if (matrix && matrix->size() == 16) {
+        for (int i = 0; i < 16; ++i) {
+            r.m[i] = (float)matrix->items[i].number;
+        }
+
+        return r;
+    }
+
+    float t[3] = { 0, 0, 0 }, q[4] = { 0, 0, 0, 1 }, s[3] = { 1, 1, 1 };
+    auto read = [](const JsonValue *array, float *out, size_t count) {
+        if (array && array->size() == count) {
+            for (size_t i = 0; i < count; ++i) {
+                out[i] = (float)array->items[i].number;
+            }
+        }
+    };
+
+    read(node.get("translation"), t, 3);
+    read(node.get("rotation"), q, 4);
+    read(node.get("scale"), s, 3);
+
+    float x = q[0], y = q[1], z = q[2], w = q[3];
+    float rotation[9] = {
+        1 - 2 * (y * y + z * z), 2 * (x * y + z * w), 2 * (x * z - y * w),
+        2 * (x * y - z * w), 1 - 2 * (x * x + z * z), 2 * (y * z + x * w),
+        2 * (x * z + y * w), 2 * (y * z - x * w), 1 - 2 * (x * x + y * y),
+    };
+
+    for (int column = 0; column < 3; ++column) {
+        for (int row = 0; row < 3; ++row) {
+            r.m[column * 4 + row] = rotation[column * 3 + row] * s[column];
+        }
+
+        r.m[12 + column] = t[column];
+    }
+
+    return r;
+}
+
+// One primitive drawn by one node, with where its output goes.
+struct Instance {
+    const JsonValue *primitive;
+    Matrix world;
+    Accessor positions, normals, colors, indices;
+    size_t vertex_base = 0, index_base = 0, index_count = 0;
+    bool indexed = false;
+};
+
+class GltfLoader {
+public:
+
+    GltfLoader(const char *directory, MeshLoadResult& result)
+        : d_directory(directory), d_result(result) {
+    }
+
+    bool load(const uint8_t *data, size_t size, MeshSink& sink, const MeshLoadOptions& options);
+
+private:
+
+    bool fail(const std::string& message) {
+        d_result.error = message;
+        return false;
+    }
+
+    bool loadBuffers();
+    bool accessor(int64_t index, Accessor& out);
+    bool collect(int64_t node_index, const Matrix& parent, int depth);
+    void decode(const Instance& instance, size_t begin, size_t end, LoadedVertex *vertices, void *indices, size_t index_size,
+        std::atomic<bool>& in_range) const;
+
+    const char *d_directory;
+    MeshLoadResult& d_result;
+    JsonValue d_document;
+    const uint8_t *d_binary = nullptr;
+    size_t d_binary_size = 0;
+    std::vector<std::unique_ptr<MappedFile>> d_files;
+    std::vector<std::pair<const uint8_t *, size_t>> d_buffers;
+    std::vector<Instance> d_instances;
+};
+
+bool
+GltfLoader::loadBuffers() {
+    const JsonValue *buffers = d_document.get("buffers");
+
+    for (size_t i = 0; buffers && i < buffers->size(); ++i) {
+        const JsonValue& buffer = buffers->items[i];
+        double length = buffer.numberOr("byteLength", -1.0);
+        const JsonValue *uri = buffer.get("uri");
+
+        if (length < 0.0) {
+            return fail("glTF buffer without a byteLength");
+        }
+
+        if (!uri) {
+            if (i != 0 || !d_binary || (double)d_binary_size < length) {
+                return fail("glTF buffer without a uri outside a GLB file");
+            }
+
+            d_buffers.emplace_back(d_binary, (size_t)length);
+            continue;
+        }
+
+        if (uri->string.compare(0, 5, "data:") == 0) {
+            return fail("glTF data URIs are not supported");
+        }
+
+        std::string path = std::string(d_directory) + uri->string;
+        d_files.emplace_back(new MappedFile());
+
+        if (!d_files.back()->open(path.c_str()) || (double)d_files.back()->size() < length) {
+            return fail("could not map glTF buffer " + path);
+        }
+
+        d_buffers.emplace_back(d_files.back()->data(), (size_t)length);
+        d_result.bytes += d_files.back()->size();
+    }
+
+    return true;
+}
+
+bool
+GltfLoader::accessor(int64_t index, Accessor& out) {
+    const JsonValue *accessors = d_document.get("accessors");
+    const JsonValue *a = accessors ? accessors->at((size_t)index) : nullptr;
+
+    if (!a) {
+        return fail("glTF accessor " + std::to_string(index) + " does not exist");
+    }
+
+    if (a->get("sparse")) {
+        return fail("glTF sparse accessors are not supported");
+    }
+
+    const JsonValue *type = a->get("type");
+    out.component_type = (int)a->numberOr("componentType", 0.0);
+    out.components = type ? componentCount(type->string) : 0;
+
+    if (!a->sizeOr("count", 0, out.count)) {
+        return fail("glTF accessor " + std::to_string(index) + " has a bad count");
+    }
+
+    const JsonValue *normalized = a->get("normalized");
+    out.normalized = normalized && normalized->number != 0.0;
+
+    size_t element_size = componentSize(out.component_type) * out.components;
+
+    if (element_size == 0) {
+        return fail("glTF accessor " + std::to_string(index) + " has an unknown type");
+    }
+
+    const JsonValue *views = d_document.get("bufferViews");
+    const JsonValue *view = views ? views->at((size_t)a->index("bufferView")) : nullptr;
+
+    if (!view) {
+        return fail("glTF accessor " + std::to_string(index) + " has no buffer view");
+    }
+
+    int64_t buffer = view->index("buffer");
+
+    if (buffer < 0 || (size_t)buffer >= d_buffers.size()) {
+        return fail("glTF buffer view refers to a missing buffer");
+    }
+
+    size_t view_offset, view_length, offset;
+
+    if (!view->sizeOr("byteOffset", 0, view_offset) || !view->sizeOr("byteLength", 0, view_length) ||
+        !a->sizeOr("byteOffset", 0, offset) || !view->sizeOr("byteStride", 0, out.stride)) {
+        return fail("glTF accessor " + std::to_string(index) + " has a bad offset, length or stride");
+    }
+
+    out.stride = out.stride ? out.stride : element_size;
+
+    // Everything read must lie inside the view, and the view inside its
+    // buffer. Each difference is taken only once it cannot wrap, and the
+    // last element is found by division rather than a product that could.
+    size_t buffer_size = d_buffers[buffer].second;
+    bool inside = view_offset <= buffer_size && view_length <= buffer_size - view_offset &&
+                  (out.count == 0 || (offset <= view_length && element_size <= view_length - offset &&
+                                         out.count - 1 <= (view_length - offset - element_size) / out.stride));
+
+    if (!inside) {
+        return fail("glTF accessor " + std::to_string(index) + " reads outside its buffer");
+    }
+
+    out.data = d_buffers[buffer].first + view_offset + offset;
+    return true;
+}
+
+bool
+GltfLoader::collect(int64_t node_index, const Matrix& parent, int depth) {
+    const JsonValue *nodes = d_document.get("nodes");
+    const JsonValue *node = nodes ? nodes->at((size_t)node_index) : nullptr;
+
+    if (!node || depth > 64) {
+        return fail("glTF node hierarchy is broken");
+    }
+
+    Matrix world = multiply(parent, nodeMatrix(*node));
+    const JsonValue *meshes = d_document.get("meshes");
+    int64_t mesh_index = node->index("mesh");
+
+    if (mesh_index >= 0) {
+        const JsonValue *mesh = meshes ? meshes->at((size_t)mesh_index) : nullptr;
+        const JsonValue *primitives = mesh ? mesh->get("primitives") : nullptr;
+
+        if (!primitives) {
+            return fail("glTF node refers to a missing mesh");
+        }
+
+        for (const JsonValue& primitive : primitives->items) {
+            if (primitive.numberOr("mode", 4.0) != 4.0) {
+                continue;
+            }
+
+            Instance instance;
+            instance.primitive = &primitive;
+            instance.world = world;
+            d_instances.push_back(instance);
+        }
+    }
+
+    const JsonValue *children = node->get("children");
+
+    for (size_t i = 0; children && i < children->size(); ++i) {
+        if (!collect((int64_t)children->items[i].number, world, depth + 1)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Vertices and indices [begin, end) of one instance.
+void
+GltfLoader::decode(const Instance& instance, size_t begin, size_t end, LoadedVertex *vertices, void *indices, size_t index_size,
+    std::atomic<bool>& in_range) const {
+    const float *m = instance.world.m;
+
+    for (size_t i = begin; i < std::min(end, instance.positions.count); ++i) {
+        LoadedVertex& out = vertices[instance.vertex_base + i];
+        float p[3];
+
+        for (int c = 0; c < 3; ++c) {
+            p[c] = readComponent(instance.positions, i, c);
+        }
+
+        out.position[0] = m[0] * p[0] + m[4] * p[1] + m[8] * p[2] + m[12];
+        out.position[1] = m[1] * p[0] + m[5] * p[1] + m[9] * p[2] + m[13];
+
+        if (instance.colors.data) {
+            for (int c = 0; c < 3; ++c) {
+                out.color[c] = readComponent(instance.colors, i, c);
+            }
+
+            out.color[3] = instance.colors.components == 4 ? readComponent(instance.colors, i, 3) : 1.0f;
+        }
+        else if (instance.normals.data) {
+            // Directions through the upper 3x3; good enough for shading
+            // unless the scale is far from uniform.
+            float n[3], w[3];
+
+            for (int c = 0; c < 3; ++c) {
+                n[c] = readComponent(instance.normals, i, c);
+            }
+
+            for (int c = 0; c < 3; ++c) {
+                w[c] = m[c] * n[0] + m[4 + c] * n[1] + m[8 + c] * n[2];
+            }
+
+            float length = std::sqrt(w[0] * w[0] + w[1] * w[1] + w[2] * w[2]);
+            float scale = length > 0.0f ? 0.5f / length : 0.0f;
+
+            for (int c = 0; c < 3; ++c) {
+                out.color[c] = 0.5f + scale * w[c];
+            }
+
+            out.color[3] = 1.0f;
+        }
+        else {
+            out.color[0] = out.color[1] = out.color[2] = 0.5f;
+            out.color[3] = 1.0f;
+        }
+    }
+
+    bool valid = true;
+
+    for (size_t i = begin; i < std::min(end, instance.index_count); ++i) {
+        uint32_t index = instance.indexed ? readIndex(instance.indices, i) : (uint32_t)i;
+        valid &= index < instance.positions.count;
+        uint32_t global = (uint32_t)instance.vertex_base + (index < instance.positions.count ? index : 0);
+
+        if (index_size == 2) {
+            static_cast<uint16_t *>(indices)[instance.index_base + i] = (uint16_t)global;
+        }
+        else {
+            static_cast<uint32_t *>(indices)[instance.index_base + i] = global;
+        }
+    }
+
+    if (!valid) {
+        in_range = false;
+    }
+}
+
+bool
+GltfLoader::load(const uint8_t *data, size_t size, MeshSink& sink, const MeshLoadOptions& options) {
+    const char *json = reinterpret_cast<const char *>(data);
+    size_t json_size = size;
+    uint32_t header[3];
+
+    if (size >= 12 && (std::memcpy(header, data, 12), header[0] == glb_magic)) {
+        // GLB: a JSON chunk, then optionally the binary buffer.
+        size_t offset = 12, length = std::min<size_t>(header[2], size);
+        json = nullptr;
+
+        while (offset + 8 <= length) {
+            uint32_t chunk[2];
+            std::memcpy(chunk, data + offset, 8);
+
+            if (chunk[0] > length - offset - 8) {
+                return fail("GLB chunk runs past the end of the file");
+            }
+
+            if (chunk[1] == glb_json_chunk && !json) {
+                json = reinterpret_cast<const char *>(data + offset + 8);
+                json_size = chunk[0];
+            }
+            else if (chunk[1] == glb_binary_chunk && !d_binary) {
+                d_binary = data + offset + 8;
+                d_binary_size = chunk[0];
+            }
+
+            offset += 8 + ((chunk[0] + 3) & ~size_t(3));
+        }
+
+        if (!json) {
+            return fail("GLB file has no JSON chunk");
+        }
+    }
+
+    if (!JsonParser(json, json_size).parse(d_document) || d_document.type != JsonValue::Object) {
+        return fail("glTF JSON does not parse");
+    }
+
+    if (!loadBuffers()) {
+        return false;
+    }
+
+    // The default scene, else the first, else every root node.
+    const JsonValue *scenes = d_document.get("scenes");
+    int64_t scene_index = d_document.index("scene");
+    const JsonValue *scene = scenes ? scenes->at(scene_index >= 0 ? (size_t)scene_index : 0) : nullptr;
+    const JsonValue *roots = scene ? scene->get("nodes") : nullptr;
+
+    if (roots) {
+        for (const JsonValue& root : roots->items) {
+            if (!collect((int64_t)root.number, Matrix(), 0)) {
+                return false;
+            }
+        }
+    }
+    else if (const JsonValue *nodes = d_document.get("nodes")) {
+        std::vector<bool> is_child(nodes->size());
+
+        for (const JsonValue& node : nodes->items) {
+            const JsonValue *children = node.get("children");
+
+            for (size_t i = 0; children && i < children->size(); ++i) {
+                size_t child = (size_t)children->items[i].number;
+
+                if (child < is_child.size()) {
+                    is_child[child] = true;
+                }
+            }
+        }
+
+        for (size_t i = 0; i < nodes->size(); ++i) {
+            if (!is_child[i] && !collect((int64_t)i, Matrix(), 0)) {
+                return false;
+            }
+        }
+    }
+
+    // Sizes first, so the sink is asked once.
+    size_t vertex_count = 0, index_count = 0;
+
+    for (Instance& instance : d_instances) {
+        const JsonValue *attributes = instance.primitive->get("attributes");
+        int64_t position = attributes ? attributes->index("POSITION") : -1;
+
+        if (position < 0) {
+            return fail("glTF primitive without positions");
+        }
+
+        if (!accessor(position, instance.positions) || instance.positions.components != 3) {
+            return d_result.error.empty() ? fail("glTF POSITION is not a VEC3") : false;
+        }
+
+        int64_t normal = attributes->index("NORMAL"), color = attributes->index("COLOR_0");
+
+        if (normal >= 0 && (!accessor(normal, instance.normals) || instance.normals.count < instance.positions.count)) {
+            return d_result.error.empty() ? fail("glTF NORMAL is shorter than POSITION") : false;
+        }
+
+        if (color >= 0 && (!accessor(color, instance.colors) || instance.colors.count < instance.positions.count ||
+                           instance.colors.components < 3)) {
+            return d_result.error.empty() ? fail("glTF COLOR_0 is shorter than POSITION") : false;
+        }
+
+        int64_t indices = instance.primitive->index("indices");
+        instance.indexed = indices >= 0;
+
+        if (instance.indexed) {
+            if (!accessor(indices, instance.indices)) {
+                return false;
+            }
+
+            if (instance.indices.components != 1 || instance.indices.component_type == 5120 ||
+                instance.indices.component_type == 5122 || instance.indices.component_type == 5126) {
+                return fail("glTF indices must be unsigned integers");
+            }
+        }
+
+        instance.vertex_base = vertex_count;
+        instance.index_base = index_count;
+        instance.index_count = (instance.indexed ? instance.indices.count : instance.positions.count) / 3 * 3;
+        vertex_count += instance.positions.count;
+        index_count += instance.index_count;
+    }
+
+    if (vertex_count > UINT32_MAX) {
+        return fail("glTF scene has too many vertices");
+    }
+
+    size_t index_size = vertex_count <= 65536 ? 2 : 4;
+    LoadedVertex *vertices = sink.allocateVertices(vertex_count);
+    void *indices = sink.allocateIndices(index_count, index_size);
+
+    if ((!vertices && vertex_count) || (!indices && index_count)) {
+        return fail("could not allocate mesh buffers");
+    }
+
+    // Big primitives are split so one mesh still spreads over the pool.
+    struct Task {
+        size_t instance, begin, end;
+    };
+
+    std::vector<Task> tasks;
+
+    for (size_t i = 0; i < d_instances.size(); ++i) {
+        size_t count = std::max(d_instances[i].positions.count, d_instances[i].index_count);
+
+        for (size_t begin = 0; begin < count; begin += decode_task_size) {
+            tasks.push_back(Task { i, begin, std::min(begin + decode_task_size, count) });
+        }
+    }
+
+    std::atomic<bool> in_range(true);
+
+    auto decodeRange = [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; ++t) {
+            decode(d_instances[tasks[t].instance], tasks[t].begin, tasks[t].end, vertices, indices, index_size, in_range);
+        }
+    };
+
+    if (options.pool) {
+        options.pool->parallelFor(tasks.size(), 1, decodeRange);
+    }
+    else {
+        decodeRange(0, tasks.size());
+    }
+
+    if (!in_range) {
+        return fail("glTF indices refer to missing vertices");
+    }
+
+    fitVertices(vertices, vertex_count, options.fit_size);
+
+    d_result.vertex_count = vertex_count;
+    d_result.index_count = index_count;
+    d_result.index_size = index_size;
+    return true;
+}
+
+}
+
+bool
+loadGltf(const uint8_t *data, size_t size, const char *directory, MeshSink& sink, const MeshLoadOptions& options,
+    MeshLoadResult& result) {
+    result = MeshLoadResult();
+    result.bytes = size;
+    return GltfLoader(directory, result).load(data, size, sink, options);
+}
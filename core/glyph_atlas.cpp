@@ -0,0 +1,124 @@
+#include "glyph_atlas.h"
+#include "distance_field.h"
+#include "font.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+struct GlyphJob {
+    uint32_t codepoint;
+    const Glyph *glyph;
+};
+
+}
+
+GlyphAtlas
+buildGlyphAtlas(const Font& font, const GlyphAtlasOptions& options, ThreadPool *pool) {
+    GlyphAtlas atlas;
+    atlas.options = options;
+
+    const float scale = options.pixel_size / font.units_per_em;
+    const uint32_t border = (uint32_t)std::ceil(options.spread);
+    const uint32_t supersample = std::max(options.supersample, 1u);
+
+    // Sorted so the packing, and with it the atlas, is deterministic.
+    std::vector<GlyphJob> jobs;
+
+    for (const auto& entry : font.glyphs) {
+        if (!entry.second.outline.empty()) {
+            jobs.push_back({ entry.first, &entry.second });
+        }
+    }
+
+    std::sort(jobs.begin(), jobs.end(), [](const GlyphJob& a, const GlyphJob& b) { return a.codepoint < b.codepoint; });
+
+    std::vector<AtlasRect> sizes(jobs.size());
+
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        const Glyph& glyph = *jobs[i].glyph;
+        sizes[i].width = (uint32_t)std::ceil((glyph.right - glyph.left) * scale) + 2 * border;
+        sizes[i].height = (uint32_t)std::ceil((glyph.top - glyph.bottom) * scale) + 2 * border;
+    }
+
+    AtlasLayout layout = packAtlas(sizes.data(), sizes.size(), options.page_size, options.page_size);
+
+    atlas.page_width = layout.page_width;
+    atlas.page_height = layout.page_height;
+    atlas.occupancy = layout.occupancy;
+    atlas.pages.assign(layout.page_count, std::vector<uint8_t>((size_t)layout.page_width * layout.page_height, 0));
+
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        const Glyph& glyph = *jobs[i].glyph;
+        const AtlasEntry& entry = layout.entries[i];
+
+        if (entry.page == UINT32_MAX) {
+            continue;
+        }
+
+        AtlasGlyph& placed = atlas.glyphs[jobs[i].codepoint];
+        placed.page = entry.page;
+        placed.rect = entry.rect;
+        placed.left = (glyph.left * scale - border) / options.pixel_size;
+        placed.top = (glyph.top * scale + border) / options.pixel_size;
+        placed.right = placed.left + entry.rect.width / options.pixel_size;
+        placed.bottom = placed.top - entry.rect.height / options.pixel_size;
+    }
+
+    // Glyphs own disjoint rects, so they can be written concurrently.
+    auto render = [&](size_t begin, size_t end) {
+        std::vector<uint8_t> coverage;
+        std::vector<float> distance;
+
+        for (size_t i = begin; i < end; ++i) {
+            const Glyph& glyph = *jobs[i].glyph;
+            const AtlasEntry& entry = layout.entries[i];
+
+            if (entry.page == UINT32_MAX) {
+                continue;
+            }
+
+            uint32_t width = entry.rect.width * supersample, height = entry.rect.height * supersample;
+            coverage.assign((size_t)width * height, 0);
+            distance.resize(coverage.size());
+
+            rasterizeOutline(glyph.outline, scale * supersample,
+                (border - glyph.left * scale) * supersample, (border + glyph.top * scale) * supersample,
+                width, height, coverage.data());
+
+            computeDistanceField(coverage.data(), width, height, options.spread * supersample, distance.data());
+
+            uint8_t *page = atlas.pages[entry.page].data();
+            const float to_byte = 127.0f / (options.spread * supersample * supersample * supersample);
+
+            for (uint32_t y = 0; y < entry.rect.height; ++y) {
+                for (uint32_t x = 0; x < entry.rect.width; ++x) {
+                    float sum = 0.0f;
+
+                    for (uint32_t sy = 0; sy < supersample; ++sy) {
+                        const float *row = &distance[((size_t)y * supersample + sy) * width + (size_t)x * supersample];
+
+                        for (uint32_t sx = 0; sx < supersample; ++sx) {
+                            sum += row[sx];
+                        }
+                    }
+
+                    float value = std::round(128.0f + sum * to_byte);
+                    page[(size_t)(entry.rect.y + y) * atlas.page_width + entry.rect.x + x] =
+                        (uint8_t)std::clamp(value, 0.0f, 255.0f);
+                }
+            }
+        }
+    };
+
+    if (pool) {
+        pool->parallelFor(jobs.size(), 1, render);
+    }
+    else {
+        render(0, jobs.size());
+    }
+
+    return atlas;
+}
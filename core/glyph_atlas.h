@@ -0,0 +1,60 @@
+#pragma once
+
+#include "atlas_packer.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+struct Font;
+class ThreadPool;
+
+struct GlyphAtlasOptions {
+    // Atlas pixels per em.
+    float pixel_size = 32.0f;
+
+    // Distance, in atlas pixels, at which the field saturates; also the
+    // empty border around every glyph.
+    float spread = 4.0f;
+
+    // Glyphs are rasterized and transformed at this many times the atlas
+    // resolution, then averaged down.
+    uint32_t supersample = 4;
+
+    uint32_t page_size = 512;
+};
+
+struct AtlasGlyph {
+    uint32_t page = UINT32_MAX;
+    AtlasRect rect;
+
+    // Where the rect's quad goes relative to the pen position on the
+    // baseline, in ems, y up.
+    float left = 0.0f, bottom = 0.0f, right = 0.0f, top = 0.0f;
+};
+
+// Single-channel signed distance fields of a font's glyphs, packed into
+// pages. 128 is the outline; each step of 127 / spread is one atlas pixel
+// further inside (up) or outside (down).
+struct GlyphAtlas {
+    GlyphAtlasOptions options;
+    uint32_t page_width = 0, page_height = 0;
+
+    // R8 pixels per page, rows top to bottom.
+    std::vector<std::vector<uint8_t>> pages;
+
+    // Only glyphs with ink are present.
+    std::unordered_map<uint32_t, AtlasGlyph> glyphs;
+
+    float occupancy = 0.0f;
+
+    const AtlasGlyph *glyph(uint32_t codepoint) const {
+        auto found = glyphs.find(codepoint);
+        return found == glyphs.end() ? nullptr : &found->second;
+    }
+};
+
+// Rasterizes and transforms every glyph of `font` and packs the results.
+// With a pool, glyphs are processed in parallel; the atlas is the same
+// either way.
+GlyphAtlas buildGlyphAtlas(const Font& font, const GlyphAtlasOptions& options, ThreadPool *pool = nullptr);
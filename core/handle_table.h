@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Hands out indices in [0, capacity) from a LIFO free list, so a freed slot is
+// the next one reused.
+class SlotAllocator {
+public:
+
+    static constexpr uint32_t invalid_slot = UINT32_MAX;
+
+    explicit SlotAllocator(uint32_t capacity) : d_capacity(capacity) {
+        d_free.reserve(capacity);
+
+        // Reversed so that slots come out in ascending order initially.
+        for (uint32_t slot = capacity; slot > 0; --slot) {
+            d_free.push_back(slot - 1);
+        }
+    }
+
+    // Returns `invalid_slot` when every slot is taken.
+    uint32_t allocate() {
+        if (d_free.empty()) {
+            return invalid_slot;
+        }
+
+        uint32_t slot = d_free.back();
+        d_free.pop_back();
+        return slot;
+    }
+
+    void free(uint32_t slot) {
+        d_free.push_back(slot);
+    }
+
+    uint32_t capacity() const {
+        return d_capacity;
+    }
+
+    uint32_t size() const {
+        return d_capacity - (uint32_t)d_free.size();
+    }
+
+private:
+
+    uint32_t d_capacity;
+    std::vector<uint32_t> d_free;
+};
+
+// Stable reference into a `HandleTable`. `index` is the slot, which is what
+// shaders see; `generation` detects use after the slot has been recycled.
+struct ResourceHandle {
+    uint32_t index = SlotAllocator::invalid_slot;
+    uint32_t generation = 0;
+
+    bool isValid() const {
+        return index != SlotAllocator::invalid_slot;
+    }
+};
+
+inline bool
+operator==(ResourceHandle lhs, ResourceHandle rhs) {
+    return lhs.index == rhs.index && lhs.generation == rhs.generation;
+}
+
+inline bool
+operator!=(ResourceHandle lhs, ResourceHandle rhs) {
+    return !(lhs == rhs);
+}
+
+// Fixed-capacity table of `T` addressed by generation-checked handles.
+template<typename T>
+class HandleTable {
+public:
+
+    explicit HandleTable(uint32_t capacity)
+        : d_slots(capacity)
+        , d_values(capacity)
+        , d_generations(capacity, 0)
+        , d_live(capacity, false) {
+    }
+
+    // Returns an invalid handle when the table is full.
+    ResourceHandle insert(T value) {
+        ResourceHandle handle;
+        handle.index = d_slots.allocate();
+
+        if (handle.isValid()) {
+            handle.generation = d_generations[handle.index];
+            d_values[handle.index] = std::move(value);
+            d_live[handle.index] = true;
+        }
+
+        return handle;
+    }
+
+    // Stale or invalid handles are ignored; returns whether anything was removed.
+    bool remove(ResourceHandle handle) {
+        if (!contains(handle)) {
+            return false;
+        }
+
+        d_values[handle.index] = T();
+        d_live[handle.index] = false;
+        ++d_generations[handle.index];
+        d_slots.free(handle.index);
+
+        return true;
+    }
+
+    bool contains(ResourceHandle handle) const {
+        return handle.index < d_slots.capacity() &&
+               d_live[handle.index] &&
+               d_generations[handle.index] == handle.generation;
+    }
+
+    T *get(ResourceHandle handle) {
+        return contains(handle) ? &d_values[handle.index] : nullptr;
+    }
+
+    const T *get(ResourceHandle handle) const {
+        return contains(handle) ? &d_values[handle.index] : nullptr;
+    }
+
+    // Calls `f(index, value)` for every live entry in slot order.
+    template<typename F>
+    void forEach(F&& f) const {
+        for (uint32_t index = 0; index < d_slots.capacity(); ++index) {
+            if (d_live[index]) {
+                f(index, d_values[index]);
+            }
+        }
+    }
+
+    uint32_t capacity() const {
+        return d_slots.capacity();
+    }
+
+    uint32_t size() const {
+        return d_slots.size();
+    }
+
+private:
+
+    SlotAllocator d_slots;
+    std::vector<T> d_values;
+    std::vector<uint32_t> d_generations;
+    std::vector<bool> d_live;
+};
@@ -0,0 +1,57 @@
+#include "hot_reload.h"
+
+#include <iostream>
+
+namespace {
+
+// How often the background thread checks for changes.
+const std::chrono::milliseconds poll_interval(20);
+
+bool
+endsWith(const std::string& s, const std::string& suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+}
+
+HotReloadService::HotReloadService(const std::vector<std::string>& directories, const std::string& extension, Debouncer::Clock::duration quiet, Rebuild rebuild)
+    : d_debouncer(quiet)
+    , d_extension(extension)
+    , d_rebuild(std::move(rebuild)) {
+    for (const auto& directory : directories) {
+        if (!d_watcher.watchDirectory(directory)) {
+            std::cerr << "Failed to watch " << directory << std::endl;
+        }
+    }
+
+    d_thread = std::thread(&HotReloadService::run, this);
+}
+
+HotReloadService::~HotReloadService() {
+    d_stop = true;
+    d_thread.join();
+}
+
+void
+HotReloadService::run() {
+    std::vector<std::string> changed;
+
+    while (!d_stop) {
+        std::this_thread::sleep_for(poll_interval);
+
+        auto now = Debouncer::Clock::now();
+
+        changed.clear();
+        d_watcher.poll(changed);
+
+        for (const auto& path : changed) {
+            if (endsWith(path, d_extension)) {
+                d_debouncer.touch(path, now);
+            }
+        }
+
+        for (const auto& path : d_debouncer.ready(now)) {
+            d_rebuild(path);
+        }
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "debouncer.h"
+#include "file_watcher.h"
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Watches directories for files with a given extension and calls `rebuild`
+// for each changed file on a background thread, once edits have settled.
+// `rebuild` typically compiles and publishes into a `FrameSwap`.
+class HotReloadService {
+public:
+
+    using Rebuild = std::function<void(const std::string& path)>;
+
+    HotReloadService(const std::vector<std::string>& directories, const std::string& extension, Debouncer::Clock::duration quiet, Rebuild rebuild);
+    ~HotReloadService();
+
+    HotReloadService(const HotReloadService&) = delete;
+    HotReloadService& operator=(const HotReloadService&) = delete;
+
+private:
+
+    void run();
+
+    FileWatcher d_watcher;
+    Debouncer d_debouncer;
+    std::string d_extension;
+    Rebuild d_rebuild;
+
+    std::atomic<bool> d_stop { false };
+    std::thread d_thread;
+};
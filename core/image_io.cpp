@@ -0,0 +1,103 @@
+#include "image_io.h"
+
+#include <cctype>
+#include <cstdio>
+
+namespace {
+
+// The next number of a PNM header, skipping whitespace and comments.
+bool
+readHeaderValue(FILE *file, uint32_t& value) {
+    int c = std::fgetc(file);
+
+    while (c == '#' || std::isspace(c)) {
+        if (c == '#') {
+            while (c != '\n' && c != EOF) {
+                c = std::fgetc(file);
+            }
+        }
+
+        c = std::fgetc(file);
+    }
+
+    if (!std::isdigit(c)) {
+        return false;
+    }
+
+    for (value = 0; std::isdigit(c); c = std::fgetc(file)) {
+        value = value * 10 + (uint32_t)(c - '0');
+    }
+
+    // One whitespace character ends the header's last value.
+    return std::isspace(c);
+}
+
+}
+
+bool
+writePGM(const char *path, const uint8_t *pixels, uint32_t width, uint32_t height) {
+    FILE *file = std::fopen(path, "wb");
+
+    if (!file) {
+        return false;
+    }
+
+    std::fprintf(file, "P5\n%u %u\n255\n", width, height);
+    size_t written = std::fwrite(pixels, 1, (size_t)width * height, file);
+    std::fclose(file);
+
+    return written == (size_t)width * height;
+}
+
+bool
+writePPM(const char *path, const uint32_t *rgba, uint32_t width, uint32_t height) {
+    FILE *file = std::fopen(path, "wb");
+
+    if (!file) {
+        return false;
+    }
+
+    std::vector<uint8_t> rgb((size_t)width * height * 3);
+
+    for (size_t i = 0; i < (size_t)width * height; ++i) {
+        rgb[i * 3 + 0] = (uint8_t)(rgba[i]);
+        rgb[i * 3 + 1] = (uint8_t)(rgba[i] >> 8);
+        rgb[i * 3 + 2] = (uint8_t)(rgba[i] >> 16);
+    }
+
+    std::fprintf(file, "P6\n%u %u\n255\n", width, height);
+    size_t written = std::fwrite(rgb.data(), 1, rgb.size(), file);
+    std::fclose(file);
+
+    return written == rgb.size();
+}
+
+bool
+readPPM(const char *path, std::vector<uint32_t>& rgba, uint32_t& width, uint32_t& height) {
+    FILE *file = std::fopen(path, "rb");
+
+    if (!file) {
+        return false;
+    }
+
+    uint32_t max_value = 0;
+    bool valid = std::fgetc(file) == 'P' && std::fgetc(file) == '6' && readHeaderValue(file, width) &&
+        readHeaderValue(file, height) && readHeaderValue(file, max_value) && max_value == 255 &&
+        width > 0 && height > 0;
+
+    std::vector<uint8_t> rgb(valid ? (size_t)width * height * 3 : 0);
+    valid = valid && std::fread(rgb.data(), 1, rgb.size(), file) == rgb.size();
+    std::fclose(file);
+
+    if (!valid) {
+        return false;
+    }
+
+    rgba.resize((size_t)width * height);
+
+    for (size_t i = 0; i < rgba.size(); ++i) {
+        rgba[i] = rgb[i * 3] | (uint32_t)rgb[i * 3 + 1] << 8 | (uint32_t)rgb[i * 3 + 2] << 16 | 0xff000000u;
+    }
+
+    return true;
+}
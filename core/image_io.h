@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Binary PGM, one byte per pixel.
+bool writePGM(const char *path, const uint8_t *pixels, uint32_t width, uint32_t height);
+
+// Binary PPM from RGBA8 pixels; alpha is dropped.
+bool writePPM(const char *path, const uint32_t *rgba, uint32_t width, uint32_t height);
+
+// Binary PPM (P6, eight bits per channel) into opaque RGBA8 pixels.
+bool readPPM(const char *path, std::vector<uint32_t>& rgba, uint32_t& width, uint32_t& height);
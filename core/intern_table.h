@@ -0,0 +1,157 @@
+#pragma once
+
+#include "string_hash.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Maps names to one `T` each, created on first use and never removed.
+//
+// Lookups take no lock: the open-addressed slot array is only ever appended
+// to, entries are immutable once published, and growing publishes a new
+// array while keeping the old ones alive, so a reader holding a stale array
+// just misses names added since. Inserts serialize on a mutex.
+template<typename T>
+class InternTable {
+public:
+
+    explicit InternTable(size_t initial_capacity = 64) {
+        size_t capacity = 16;
+
+        while (capacity < initial_capacity * 2) {
+            capacity *= 2;
+        }
+
+        publish(capacity);
+    }
+
+    InternTable(const InternTable&) = delete;
+    InternTable& operator=(const InternTable&) = delete;
+
+    const T *find(std::string_view name) const {
+        return find(name, hashName(name));
+    }
+
+    // `hash` must be `hashName(name)`; callers with a precomputed hash skip
+    // rehashing.
+    const T *find(std::string_view name, uint64_t hash) const {
+        const Slots *slots = d_slots.load(std::memory_order_acquire);
+
+        for (size_t i = hash & slots->mask;; i = (i + 1) & slots->mask) {
+            const Entry *entry = slots->entries[i].load(std::memory_order_acquire);
+
+            if (!entry) {
+                return nullptr;
+            }
+
+            if (entry->hash == hash && entry->name == name) {
+                return &entry->value;
+            }
+        }
+    }
+
+    // Returns the value for `name`, calling `make()` to create it the first
+    // time. `make` runs under the insert lock.
+    template<typename Make>
+    const T& intern(std::string_view name, Make&& make) {
+        return intern(name, hashName(name), std::forward<Make>(make));
+    }
+
+    template<typename Make>
+    const T& intern(std::string_view name, uint64_t hash, Make&& make) {
+        if (const T *value = find(name, hash)) {
+            return *value;
+        }
+
+        std::lock_guard<std::mutex> lock(d_mutex);
+
+        if (const T *value = find(name, hash)) {
+            return *value;
+        }
+
+        const Slots *slots = d_slots.load(std::memory_order_relaxed);
+
+        // Keep at most half the slots full so probe sequences stay short.
+        if ((d_entries.size() + 1) * 2 > slots->mask + 1) {
+            slots = publish((slots->mask + 1) * 2);
+        }
+
+        d_entries.push_back(std::unique_ptr<Entry>(new Entry { hash, std::string(name), make() }));
+        insert(*slots, d_entries.back().get());
+
+        return d_entries.back()->value;
+    }
+
+    // Calls `f(name, value)` for every entry, in insertion order.
+    template<typename F>
+    void forEach(F&& f) const {
+        std::lock_guard<std::mutex> lock(d_mutex);
+
+        for (const auto& entry : d_entries) {
+            f(std::string_view(entry->name), entry->value);
+        }
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(d_mutex);
+        return d_entries.size();
+    }
+
+private:
+
+    struct Entry {
+        uint64_t hash;
+        std::string name;
+        T value;
+    };
+
+    struct Slots {
+        size_t mask;
+        std::unique_ptr<std::atomic<const Entry *>[]> entries;
+    };
+
+    static void insert(const Slots& slots, const Entry *entry) {
+        size_t i = entry->hash & slots.mask;
+
+        while (slots.entries[i].load(std::memory_order_relaxed)) {
+            i = (i + 1) & slots.mask;
+        }
+
+        slots.entries[i].store(entry, std::memory_order_release);
+    }
+
+    // Fills a new slot array with every entry so far and makes it current.
+    const Slots *publish(size_t capacity) {
+        auto slots = std::make_unique<Slots>();
+        slots->mask = capacity - 1;
+        slots->entries.reset(new std::atomic<const Entry *>[capacity]);
+
+        for (size_t i = 0; i < capacity; ++i) {
+            slots->entries[i].store(nullptr, std::memory_order_relaxed);
+        }
+
+        for (const auto& entry : d_entries) {
+            insert(*slots, entry.get());
+        }
+
+        d_generations.push_back(std::move(slots));
+        d_slots.store(d_generations.back().get(), std::memory_order_release);
+
+        return d_generations.back().get();
+    }
+
+    std::atomic<const Slots *> d_slots { nullptr };
+
+    mutable std::mutex d_mutex;
+    std::vector<std::unique_ptr<Entry>> d_entries;
+
+    // Every slot array ever published; readers may still be probing old ones.
+    std::vector<std::unique_ptr<Slots>> d_generations;
+};
@@ -0,0 +1,129 @@
+#include "light_binning.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+void
+binRow(const TiledLight *lights, uint32_t light_count, uint32_t ty, LightBins& bins) {
+    float size = (float)bins.tile_size;
+    float y0 = ty * size, y1 = y0 + size;
+
+    for (uint32_t i = 0; i < light_count; ++i) {
+        const TiledLight& light = lights[i];
+
+        if (light.positionY + light.radius < y0 || light.positionY - light.radius > y1) {
+            continue;
+        }
+
+        // Tiles under the light's bounding square, clamped to the window.
+        float first = std::floor((light.positionX - light.radius) / size);
+        float last = std::floor((light.positionX + light.radius) / size);
+
+        if (last < 0.0f || first >= (float)bins.tiles_x) {
+            continue;
+        }
+
+        uint32_t tx0 = (uint32_t)std::max(first, 0.0f);
+        uint32_t tx1 = (uint32_t)std::min(last, (float)(bins.tiles_x - 1));
+
+        for (uint32_t tx = tx0; tx <= tx1; ++tx) {
+            // Whole tiles, like the tile shader, even where they hang over
+            // the window's edge.
+            float x0 = tx * size;
+
+            if (!lightIntersectsTile(light, x0, y0, x0 + size, y1)) {
+                continue;
+            }
+
+            uint32_t tile = ty * bins.tiles_x + tx;
+            uint32_t slot = bins.counts[tile]++;
+
+            if (slot < bins.max_per_tile) {
+                bins.indices[(size_t)tile * bins.max_per_tile + slot] = i;
+            }
+        }
+    }
+}
+
+}
+
+void
+animateLights(TiledLight *lights, uint32_t count, float time, uint32_t width, uint32_t height) {
+    const float golden = 0.618034f;
+
+    for (uint32_t i = 0; i < count; ++i) {
+        float phase = i * golden * 6.2831853f;
+        float fraction = i * golden - std::floor(i * golden);
+
+        TiledLight& light = lights[i];
+        light.positionX = width * (0.5f + 0.45f * std::sin(time * (0.3f + 0.1f * (i % 7)) + phase));
+        light.positionY = height * (0.5f + 0.45f * std::cos(time * (0.2f + 0.07f * (i % 5)) + phase * 1.3f));
+        light.height = 24.0f;
+        light.radius = 40.0f + 60.0f * fraction;
+
+        // Saturated hues spread around the color wheel.
+        light.colorR = 0.5f + 0.5f * std::cos(phase);
+        light.colorG = 0.5f + 0.5f * std::cos(phase - 2.0943951f);
+        light.colorB = 0.5f + 0.5f * std::cos(phase + 2.0943951f);
+        light.padding = 0.0f;
+    }
+}
+
+void
+binLights(const TiledLight *lights, uint32_t light_count, uint32_t width, uint32_t height,
+    uint32_t tile_size, uint32_t max_per_tile, LightBins& bins, ThreadPool *pool) {
+    bins.tiles_x = (width + tile_size - 1) / tile_size;
+    bins.tiles_y = (height + tile_size - 1) / tile_size;
+    bins.tile_size = tile_size;
+    bins.max_per_tile = max_per_tile;
+
+    size_t tile_count = (size_t)bins.tiles_x * bins.tiles_y;
+    bins.counts.assign(tile_count, 0);
+    bins.indices.resize(tile_count * max_per_tile);
+
+    // Rows write disjoint tiles, so they need no synchronization.
+    if (pool) {
+        pool->parallelFor(bins.tiles_y, 1, [&](size_t begin, size_t end) {
+            for (size_t ty = begin; ty < end; ++ty) {
+                binRow(lights, light_count, (uint32_t)ty, bins);
+            }
+        });
+    }
+    else {
+        for (uint32_t ty = 0; ty < bins.tiles_y; ++ty) {
+            binRow(lights, light_count, ty, bins);
+        }
+    }
+}
+
+uint64_t
+countMissingLights(const LightBins& bins, const TiledLight *lights, uint32_t light_count, uint32_t width, uint32_t height) {
+    uint64_t missing = 0;
+
+    for (uint32_t y = 0; y < height; ++y) {
+        for (uint32_t x = 0; x < width; ++x) {
+            uint32_t tile = (y / bins.tile_size) * bins.tiles_x + x / bins.tile_size;
+
+            if (bins.counts[tile] > bins.max_per_tile) {
+                continue;
+            }
+
+            const uint32_t *list = bins.list(tile);
+            const uint32_t *list_end = list + bins.listSize(tile);
+
+            for (uint32_t i = 0; i < light_count; ++i) {
+                float dx = lights[i].positionX - (x + 0.5f), dy = lights[i].positionY - (y + 0.5f);
+
+                if (dx * dx + dy * dy < lights[i].radius * lights[i].radius &&
+                    !std::binary_search(list, list_end, i)) {
+                    ++missing;
+                }
+            }
+        }
+    }
+
+    return missing;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "lighting_types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// Per-tile light lists over a window, row-major by tile; the CPU version of
+// what the tiled deferred lighting tile shader builds in tile memory.
+struct LightBins {
+    uint32_t tiles_x = 0, tiles_y = 0;
+    uint32_t tile_size = 0;
+    uint32_t max_per_tile = 0;
+
+    // Lights touching each tile, which may be more than `max_per_tile`.
+    std::vector<uint32_t> counts;
+
+    // `max_per_tile` slots per tile holding light indices in ascending order.
+    std::vector<uint32_t> indices;
+
+    uint32_t listSize(uint32_t tile) const {
+        return counts[tile] < max_per_tile ? counts[tile] : max_per_tile;
+    }
+
+    const uint32_t *list(uint32_t tile) const {
+        return &indices[(size_t)tile * max_per_tile];
+    }
+};
+
+// Moves `count` lights along fixed Lissajous paths over a `width` x `height`
+// window. Deterministic in `time`, so the app and the benchmark see the same
+// scene.
+void animateLights(TiledLight *lights, uint32_t count, float time, uint32_t width, uint32_t height);
+
+// Bins lights with the tile shader's test (`lightIntersectsTile`). Each light
+// is only tested against the tiles under its bounding square. With a pool,
+// rows of tiles are binned in parallel; the result is the same either way.
+void binLights(const TiledLight *lights, uint32_t light_count, uint32_t width, uint32_t height,
+    uint32_t tile_size, uint32_t max_per_tile, LightBins& bins, ThreadPool *pool = nullptr);
+
+// Checks `bins` against a brute-force search over pixel centers: every light
+// that reaches a pixel must be in that pixel's tile list, unless the list
+// overflowed. Returns the number of (pixel, light) pairs missing.
+uint64_t countMissingLights(const LightBins& bins, const TiledLight *lights, uint32_t light_count, uint32_t width, uint32_t height);
@@ -0,0 +1,80 @@
+/*
+Header containing types, enum constants and helpers shared between the tiled
+deferred lighting shaders and C++ code, including the CPU light binning
+*/
+
+#ifndef lighting_types_H
+#define lighting_types_H
+
+#ifndef __METAL_VERSION__
+#include <stdint.h>
+#endif
+
+// Tile edge in pixels; one light list per tile.
+#define TILED_LIGHTING_TILE_SIZE 16
+
+// Lights past this many in one tile are dropped from its list.
+#define TILED_LIGHTING_MAX_LIGHTS_PER_TILE 32
+
+// Lights are passed with setTileBytes/setFragmentBytes, which take at most
+// 4 KB.
+#define TILED_LIGHTING_MAX_LIGHTS 128
+
+// Size of the per-tile list in threadgroup memory: a count padded to 16
+// bytes, then the light indices.
+#define TILED_LIGHTING_LIST_BYTES (16 + TILED_LIGHTING_MAX_LIGHTS_PER_TILE * 4)
+
+// Color attachments of the tiled deferred render pass. Only the lighting
+// result is stored; the G-buffer lives in tile memory.
+typedef enum TiledAttachment
+{
+    TiledAttachmentLighting = 0,
+    TiledAttachmentAlbedo   = 1,
+    TiledAttachmentNormal   = 2,
+} TiledAttachment;
+
+typedef enum TiledInputIndex
+{
+    TiledInputIndexLights = 0,
+    TiledInputIndexParams = 1,
+} TiledInputIndex;
+
+typedef enum TiledThreadgroupIndex
+{
+    TiledThreadgroupIndexLightList = 0,
+} TiledThreadgroupIndex;
+
+// A point light above the z = 0 plane the scene is drawn on. Positions are in
+// window pixels, y down.
+typedef struct
+{
+    float positionX, positionY;
+    float height;
+
+    // Distance along the plane at which the light's contribution reaches zero.
+    float radius;
+
+    float colorR, colorG, colorB;
+    float padding;
+} TiledLight;
+
+typedef struct
+{
+    uint32_t lightCount;
+    float ambient;
+} TiledLightingParams;
+
+// Whether the light's disc of influence on the plane touches the pixel
+// rectangle [x0, x1) x [y0, y1). Conservative, so it may also accept a light
+// that only grazes the tile's edge.
+static inline bool lightIntersectsTile(TiledLight light, float x0, float y0, float x1, float y1)
+{
+    float nearestX = light.positionX < x0 ? x0 : (light.positionX > x1 ? x1 : light.positionX);
+    float nearestY = light.positionY < y0 ? y0 : (light.positionY > y1 ? y1 : light.positionY);
+
+    float dx = light.positionX - nearestX, dy = light.positionY - nearestY;
+
+    return dx * dx + dy * dy <= light.radius * light.radius;
+}
+
+#endif /* lighting_types_H */
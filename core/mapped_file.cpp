@@ -0,0 +1,48 @@
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool
+MappedFile::open(const char *path) {
+    close();
+
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void *data = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    d_data = (const uint8_t *)data;
+    d_size = (size_t)info.st_size;
+    return true;
+}
+
+void
+MappedFile::close() {
+    if (d_data) {
+        munmap((void *)d_data, d_size);
+        d_data = nullptr;
+        d_size = 0;
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Read-only memory mapping of a whole file.
+class MappedFile {
+public:
+
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const char *path);
+    void close();
+
+    const uint8_t *data() const {
+        return d_data;
+    }
+
+    size_t size() const {
+        return d_size;
+    }
+
+private:
+
+    const uint8_t *d_data = nullptr;
+    size_t d_size = 0;
+};
@@ -0,0 +1,591 @@
+#include "mesh_loader.h"
+#include "mapped_file.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+#include <vector>
+
+namespace {
+
+// Text per parallel OBJ task, give or take a line.
+const size_t obj_chunk_size = 256 * 1024;
+
+inline bool
+isDigit(char c) {
+    return (unsigned char)(c - '0') < 10;
+}
+
+inline bool
+isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Eight ASCII digits as one 64-bit word: a range check on all eight bytes,
+// then three multiply-and-shift steps combining pairs, quads and halves.
+// Little-endian only; elsewhere every digit takes the scalar loop.
+inline bool
+eightDigits(const char *p, uint64_t *value) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint64_t word;
+    std::memcpy(&word, p, 8);
+
+    if (((word + 0x4646464646464646ull) | (word - 0x3030303030303030ull)) & 0x8080808080808080ull) {
+        return false;
+    }
+
+    word -= 0x3030303030303030ull;
+    word = word * 10 + (word >> 8);
+    *value = (((word & 0x000000ff000000ffull) * (100 + (1000000ull << 32))) +
+              (((word >> 16) & 0x000000ff000000ffull) * (1 + (10000ull << 32)))) >> 32;
+    return true;
+#else
+    (void)p;
+    (void)value;
+    return false;
+#endif
+}
+
+// Up to 19 significant digits go into `mantissa`; further integer digits
+// only scale it. Returns whether there was at least one digit.
+inline bool
+readDigits(const char *&s, const char *end, uint64_t& mantissa, int& digits, int& exponent, bool fraction) {
+    const char *start = s;
+
+    // Leading zeros are not significant.
+    if (mantissa == 0) {
+        while (s < end && *s == '0') {
+            ++s;
+            exponent -= fraction ? 1 : 0;
+        }
+    }
+
+    for (;;) {
+        uint64_t eight;
+
+        while (end - s >= 8 && digits + 8 <= 19 && eightDigits(s, &eight)) {
+            mantissa = mantissa * 100000000 + eight;
+            digits += 8;
+            exponent -= fraction ? 8 : 0;
+            s += 8;
+        }
+
+        if (s == end || !isDigit(*s)) {
+            break;
+        }
+
+        if (digits < 19) {
+            mantissa = mantissa * 10 + uint64_t(*s - '0');
+            ++digits;
+            exponent -= fraction ? 1 : 0;
+        }
+        else if (!fraction) {
+            ++exponent;
+        }
+
+        ++s;
+    }
+
+    return s != start;
+}
+
+const double exact_powers[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+// Position and normal of one face corner. Negative OBJ indices count back
+// from the last record before the face; within a chunk that is only known
+// relative to the chunk's first record, so those are resolved afterwards.
+struct ObjCorner {
+    int64_t position, normal;
+    uint8_t relative;
+};
+
+const uint8_t relative_position = 1, relative_normal = 2;
+const int64_t no_normal = INT64_MIN;
+
+struct ObjChunk {
+    std::vector<float> positions, colors, normals;
+    std::vector<ObjCorner> corners;
+    const char *error = nullptr;
+};
+
+// Reads "v", "v/vt", "v//vn" or "v/vt/vn".
+bool
+parseCorner(const char *&s, const char *end, const ObjChunk& chunk, ObjCorner& corner) {
+    auto readIndex = [&](int64_t& index, bool& relative, size_t count) {
+        bool negative = s < end && *s == '-';
+        s += negative ? 1 : 0;
+
+        if (s == end || !isDigit(*s)) {
+            return false;
+        }
+
+        int64_t value = 0;
+
+        // An index too long to fit can only be garbage; reject the record
+        // rather than overflow.
+        while (s < end && isDigit(*s)) {
+            if (value > (INT64_MAX - 9) / 10) {
+                return false;
+            }
+
+            value = value * 10 + (*s++ - '0');
+        }
+
+        relative = negative;
+        index = negative ? (int64_t)count - value : value - 1;
+        return true;
+    };
+
+    bool relative = false;
+    corner.relative = 0;
+    corner.normal = no_normal;
+
+    if (!readIndex(corner.position, relative, chunk.positions.size() / 3)) {
+        return false;
+    }
+
+    corner.relative |= relative ? relative_position : 0;
+
+    if (s < end && *s == '/') {
+        ++s;
+
+        // Texture coordinates are not used.
+        while (s < end && (isDigit(*s) || *s == '-')) {
+            ++s;
+        }
+
+        if (s < end && *s == '/') {
+            ++s;
+
+            if (!readIndex(corner.normal, relative, chunk.normals.size() / 3)) {
+                return false;
+            }
+
+            corner.relative |= relative ? relative_normal : 0;
+        }
+    }
+
+    return s == end || isBlank(*s) || *s == '\n';
+}
+
+void
+parseObjChunk(const char *s, const char *end, ObjChunk& chunk) {
+    std::vector<ObjCorner> polygon;
+
+    while (s < end) {
+        const char *line_end = (const char *)std::memchr(s, '\n', end - s);
+        line_end = line_end ? line_end : end;
+
+        while (s < line_end && isBlank(*s)) {
+            ++s;
+        }
+
+        if (line_end - s >= 2 && s[0] == 'v' && isBlank(s[1])) {
+            s += 2;
+            float values[6];
+            int count = 0;
+
+            while (count < 6 && parseFloat(&s, line_end, &values[count])) {
+                ++count;
+            }
+
+            if (count < 3) {
+                chunk.error = s;
+                return;
+            }
+
+            chunk.positions.insert(chunk.positions.end(), values, values + 3);
+
+            // Colors only where some vertex has them; the rest are white.
+            if (count == 6 || !chunk.colors.empty()) {
+                chunk.colors.resize(chunk.positions.size() - 3, 1.0f);
+
+                if (count == 6) {
+                    chunk.colors.insert(chunk.colors.end(), values + 3, values + 6);
+                }
+                else {
+                    chunk.colors.insert(chunk.colors.end(), 3, 1.0f);
+                }
+            }
+        }
+        else if (line_end - s >= 3 && s[0] == 'v' && s[1] == 'n' && isBlank(s[2])) {
+            s += 3;
+            float values[3];
+
+            for (float& value : values) {
+                if (!parseFloat(&s, line_end, &value)) {
+                    chunk.error = s;
+                    return;
+                }
+            }
+
+            chunk.normals.insert(chunk.normals.end(), values, values + 3);
+        }
+        else if (line_end - s >= 2 && s[0] == 'f' && isBlank(s[1])) {
+            s += 2;
+            polygon.clear();
+
+            for (;;) {
+                while (s < line_end && isBlank(*s)) {
+                    ++s;
+                }
+
+                if (s == line_end) {
+                    break;
+                }
+
+                ObjCorner corner;
+
+                if (!parseCorner(s, line_end, chunk, corner)) {
+                    chunk.error = s;
+                    return;
+                }
+
+                polygon.push_back(corner);
+            }
+
+            for (size_t k = 2; k < polygon.size(); ++k) {
+                chunk.corners.push_back(polygon[0]);
+                chunk.corners.push_back(polygon[k - 1]);
+                chunk.corners.push_back(polygon[k]);
+            }
+        }
+
+        s = line_end + 1;
+    }
+}
+
+template<typename Index>
+void
+writeIndices(void *destination, const uint32_t *source, size_t count) {
+    Index *out = static_cast<Index *>(destination);
+
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = (Index)source[i];
+    }
+}
+
+}
+
+bool
+parseFloat(const char **p, const char *end, float *value) {
+    const char *s = *p;
+
+    while (s < end && isBlank(*s)) {
+        ++s;
+    }
+
+    bool negative = s < end && *s == '-';
+    s += s < end && (*s == '-' || *s == '+') ? 1 : 0;
+
+    uint64_t mantissa = 0;
+    int digits = 0, exponent = 0;
+    bool any = readDigits(s, end, mantissa, digits, exponent, false);
+
+    if (s < end && *s == '.') {
+        ++s;
+        any |= readDigits(s, end, mantissa, digits, exponent, true);
+    }
+
+    if (!any) {
+        return false;
+    }
+
+    if (s < end && (*s == 'e' || *s == 'E')) {
+        const char *e = s + 1;
+        bool negative_exponent = e < end && *e == '-';
+        e += e < end && (*e == '-' || *e == '+') ? 1 : 0;
+
+        if (e < end && isDigit(*e)) {
+            int power = 0;
+
+            while (e < end && isDigit(*e)) {
+                power = std::min(power * 10 + (*e++ - '0'), 100000);
+            }
+
+            exponent += negative_exponent ? -power : power;
+            s = e;
+        }
+    }
+
+    double result;
+
+    if (mantissa == 0) {
+        result = 0.0;
+    }
+    else if (exponent >= -22 && exponent <= 22) {
+        // The power is exact in a double, and so is the mantissa up to 2^53;
+        // past that the extra rounding is far below a float's precision.
+        result = exponent < 0 ? double(mantissa) / exact_powers[-exponent] : double(mantissa) * exact_powers[exponent];
+    }
+    else {
+        // Rare in mesh data; let the C library get it right.
+        char buffer[64];
+        size_t length = std::min<size_t>(s - *p, sizeof(buffer) - 1);
+        std::memcpy(buffer, *p, length);
+        buffer[length] = '\0';
+        *value = std::strtof(buffer, nullptr);
+        *p = s;
+        return true;
+    }
+
+    *value = float(negative ? -result : result);
+    *p = s;
+    return true;
+}
+
+void
+fitVertices(LoadedVertex *vertices, size_t count, float fit_size) {
+    if (count == 0) {
+        return;
+    }
+
+    float low[2] = { INFINITY, INFINITY }, high[2] = { -INFINITY, -INFINITY };
+
+    for (size_t i = 0; i < count; ++i) {
+        for (int c = 0; c < 2; ++c) {
+            low[c] = std::min(low[c], vertices[i].position[c]);
+            high[c] = std::max(high[c], vertices[i].position[c]);
+        }
+    }
+
+    float extent = std::max(high[0] - low[0], high[1] - low[1]);
+    float scale = extent > 0.0f ? fit_size / extent : 1.0f;
+    float center[2] = { 0.5f * (low[0] + high[0]), 0.5f * (low[1] + high[1]) };
+
+    for (size_t i = 0; i < count; ++i) {
+        for (int c = 0; c < 2; ++c) {
+            vertices[i].position[c] = (vertices[i].position[c] - center[c]) * scale;
+        }
+    }
+}
+
+bool
+loadObj(const char *text, size_t size, MeshSink& sink, const MeshLoadOptions& options, MeshLoadResult& result) {
+    result = MeshLoadResult();
+    result.bytes = size;
+
+    // Chunks start after a newline so no line is split.
+    std::vector<const char *> bounds { text };
+
+    for (size_t offset = obj_chunk_size; offset < size; offset += obj_chunk_size) {
+        const char *newline = (const char *)std::memchr(text + offset, '\n', size - offset);
+
+        if (!newline) {
+            break;
+        }
+
+        if (newline + 1 > bounds.back()) {
+            bounds.push_back(newline + 1);
+        }
+    }
+
+    bounds.push_back(text + size);
+
+    std::vector<ObjChunk> chunks(bounds.size() - 1);
+
+    auto parse = [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c) {
+            parseObjChunk(bounds[c], bounds[c + 1], chunks[c]);
+        }
+    };
+
+    if (options.pool) {
+        options.pool->parallelFor(chunks.size(), 1, parse);
+    }
+    else {
+        parse(0, chunks.size());
+    }
+
+    // Every chunk's records follow those of the chunks before it.
+    std::vector<size_t> position_base(chunks.size()), normal_base(chunks.size());
+    size_t position_count = 0, normal_count = 0, corner_count = 0;
+    bool any_color = false;
+
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        if (chunks[c].error) {
+            result.error = "malformed OBJ record at byte " + std::to_string(chunks[c].error - text);
+            return false;
+        }
+
+        position_base[c] = position_count;
+        normal_base[c] = normal_count;
+        position_count += chunks[c].positions.size() / 3;
+        normal_count += chunks[c].normals.size() / 3;
+        corner_count += chunks[c].corners.size();
+        any_color |= !chunks[c].colors.empty();
+    }
+
+    // Resolve to global indices, checking them as we go.
+    bool use_normals = !any_color && normal_count > 0;
+    bool in_range = true;
+
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        for (ObjCorner& corner : chunks[c].corners) {
+            corner.position += (corner.relative & relative_position) ? (int64_t)position_base[c] : 0;
+            in_range &= corner.position >= 0 && corner.position < (int64_t)position_count;
+
+            if (corner.normal != no_normal) {
+                corner.normal += (corner.relative & relative_normal) ? (int64_t)normal_base[c] : 0;
+                in_range &= corner.normal >= 0 && corner.normal < (int64_t)normal_count;
+            }
+        }
+    }
+
+    if (!in_range) {
+        result.error = "OBJ face refers to a missing vertex or normal";
+        return false;
+    }
+
+    // With normals for color, each distinct position/normal pair is a
+    // vertex; otherwise the positions are the vertices as they are.
+    std::vector<uint32_t> corner_vertices;
+    std::vector<uint64_t> pairs;
+
+    if (use_normals) {
+        size_t capacity = 16;
+
+        while (capacity < corner_count * 2) {
+            capacity *= 2;
+        }
+
+        std::vector<uint64_t> keys(capacity, UINT64_MAX);
+        std::vector<uint32_t> values(capacity);
+        corner_vertices.reserve(corner_count);
+
+        for (const ObjChunk& chunk : chunks) {
+            for (const ObjCorner& corner : chunk.corners) {
+                uint64_t key = uint64_t(corner.position) << 32 | uint64_t(corner.normal == no_normal ? UINT32_MAX : corner.normal);
+                size_t slot = (key * 0x9e3779b97f4a7c15ull >> 32) & (capacity - 1);
+
+                while (keys[slot] != UINT64_MAX && keys[slot] != key) {
+                    slot = (slot + 1) & (capacity - 1);
+                }
+
+                if (keys[slot] == UINT64_MAX) {
+                    keys[slot] = key;
+                    values[slot] = (uint32_t)pairs.size();
+                    pairs.push_back(key);
+                }
+
+                corner_vertices.push_back(values[slot]);
+            }
+        }
+    }
+
+    size_t vertex_count = use_normals ? pairs.size() : position_count;
+    size_t index_size = vertex_count <= 65536 ? 2 : 4;
+
+    LoadedVertex *vertices = sink.allocateVertices(vertex_count);
+    void *indices = sink.allocateIndices(corner_count, index_size);
+
+    if ((!vertices && vertex_count) || (!indices && corner_count)) {
+        result.error = "could not allocate mesh buffers";
+        return false;
+    }
+
+    // Flattened views of the chunks' records, to look them up by global
+    // index.
+    auto record = [&](int64_t index, const std::vector<size_t>& base, std::vector<float> ObjChunk::*records) {
+        size_t c = std::upper_bound(base.begin(), base.end(), (size_t)index) - base.begin() - 1;
+        return &(chunks[c].*records)[(index - base[c]) * 3];
+    };
+
+    auto writeVertices = [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v) {
+            LoadedVertex& out = vertices[v];
+            int64_t position = use_normals ? int64_t(pairs[v] >> 32) : (int64_t)v;
+            const float *p = record(position, position_base, &ObjChunk::positions);
+
+            out.position[0] = p[0];
+            out.position[1] = p[1];
+            out.color[3] = 1.0f;
+
+            if (any_color) {
+                size_t c = std::upper_bound(position_base.begin(), position_base.end(), (size_t)position) - position_base.begin() - 1;
+                const std::vector<float>& colors = chunks[c].colors;
+                size_t offset = (position - position_base[c]) * 3;
+
+                for (int k = 0; k < 3; ++k) {
+                    out.color[k] = offset < colors.size() ? colors[offset + k] : 1.0f;
+                }
+            }
+            else if (use_normals && uint32_t(pairs[v]) != UINT32_MAX) {
+                const float *n = record(int64_t(uint32_t(pairs[v])), normal_base, &ObjChunk::normals);
+                float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                float scale = length > 0.0f ? 0.5f / length : 0.0f;
+
+                for (int k = 0; k < 3; ++k) {
+                    out.color[k] = 0.5f + scale * n[k];
+                }
+            }
+            else {
+                out.color[0] = out.color[1] = out.color[2] = 0.5f;
+            }
+        }
+    };
+
+    if (options.pool) {
+        options.pool->parallelFor(vertex_count, 16384, writeVertices);
+    }
+    else {
+        writeVertices(0, vertex_count);
+    }
+
+    if (!use_normals) {
+        corner_vertices.reserve(corner_count);
+
+        for (const ObjChunk& chunk : chunks) {
+            for (const ObjCorner& corner : chunk.corners) {
+                corner_vertices.push_back((uint32_t)corner.position);
+            }
+        }
+    }
+
+    if (index_size == 2) {
+        writeIndices<uint16_t>(indices, corner_vertices.data(), corner_count);
+    }
+    else {
+        writeIndices<uint32_t>(indices, corner_vertices.data(), corner_count);
+    }
+
+    fitVertices(vertices, vertex_count, options.fit_size);
+
+    result.vertex_count = vertex_count;
+    result.index_count = corner_count;
+    result.index_size = index_size;
+    return true;
+}
+
+bool
+loadMesh(const char *path, MeshSink& sink, const MeshLoadOptions& options, MeshLoadResult& result) {
+    MappedFile file;
+
+    if (!file.open(path)) {
+        result = MeshLoadResult();
+        result.error = std::string("could not open ") + path;
+        return false;
+    }
+
+    const char *extension = std::strrchr(path, '.');
+
+    if (extension && strcasecmp(extension, ".obj") == 0) {
+        return loadObj((const char *)file.data(), file.size(), sink, options, result);
+    }
+
+    if (extension && (strcasecmp(extension, ".gltf") == 0 || strcasecmp(extension, ".glb") == 0)) {
+        const char *slash = std::strrchr(path, '/');
+        std::string directory = slash ? std::string(path, slash - path + 1) : std::string();
+        return loadGltf(file.data(), file.size(), directory.c_str(), sink, options, result);
+    }
+
+    result = MeshLoadResult();
+    result.error = std::string("unknown mesh format: ") + path;
+    return false;
+}
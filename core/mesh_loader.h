@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class ThreadPool;
+
+// The layout of AAPLVertex in triangle_types.h, which needs <simd/simd.h>:
+// a pixel-space position and an RGBA color on the next 16-byte boundary.
+struct LoadedVertex {
+    alignas(8) float position[2];
+    alignas(16) float color[4];
+};
+
+static_assert(sizeof(LoadedVertex) == 32, "LoadedVertex must match AAPLVertex");
+
+// Where loaders put their output. Each is asked once, with final sizes,
+// before anything is decoded, and writes straight into what it gets back;
+// the renderer hands out shared Metal buffers, the benchmark plain memory.
+class MeshSink {
+public:
+
+    virtual ~MeshSink() = default;
+
+    // Returning nullptr fails the load.
+    virtual LoadedVertex *allocateVertices(size_t count) = 0;
+
+    // `index_size` is 2 when every vertex fits in 16 bits, otherwise 4.
+    virtual void *allocateIndices(size_t count, size_t index_size) = 0;
+};
+
+struct MeshLoadOptions {
+    // The mesh is viewed down -z and scaled, keeping its proportions, to
+    // fit a square of this many pixels around the origin.
+    float fit_size = 400.0f;
+
+    // Parses OBJ text and decodes glTF primitives in parallel.
+    ThreadPool *pool = nullptr;
+};
+
+struct MeshLoadResult {
+    size_t vertex_count = 0;
+    size_t index_count = 0;
+    size_t index_size = 0;
+
+    // Bytes of the file, and any glTF buffers, read.
+    size_t bytes = 0;
+
+    std::string error;
+};
+
+// Triangle meshes from Wavefront OBJ text or glTF 2.0, as .gltf with its
+// buffers in files next to it or as .glb. The whole file, and each glTF
+// buffer, is memory mapped and read in place. Colors come from glTF COLOR_0
+// or OBJ vertex colors, then from normals, and are mid grey otherwise.
+// Returns false with `result.error` set on failure.
+bool loadMesh(const char *path, MeshSink& sink, const MeshLoadOptions& options, MeshLoadResult& result);
+
+// OBJ from memory: `v` (with optional r g b), `vn` and `f` records with
+// polygons fanned into triangles; everything else is skipped. The text is
+// split at line boundaries and parsed in parallel with a number parser that
+// converts eight digits at a time, then each distinct position/normal pair
+// becomes one vertex.
+bool loadObj(const char *text, size_t size, MeshSink& sink, const MeshLoadOptions& options, MeshLoadResult& result);
+
+// glTF from memory. `directory` is where relative buffer URIs are found;
+// data URIs and sparse accessors are not supported, and primitives other
+// than triangle lists are skipped. Node transforms of the default scene are
+// applied.
+bool loadGltf(const uint8_t *data, size_t size, const char *directory, MeshSink& sink, const MeshLoadOptions& options,
+    MeshLoadResult& result);
+
+// Centers `vertices` and scales them to `fit_size`, as loading does.
+void fitVertices(LoadedVertex *vertices, size_t count, float fit_size);
+
+// Parses a decimal floating-point number at `*p`, skipping leading blanks,
+// and advances past it; false, leaving `*p` alone, if there is none.
+bool parseFloat(const char **p, const char *end, float *value);
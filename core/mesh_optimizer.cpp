@@ -0,0 +1,620 @@
+#include "mesh_optimizer.h"
+#include "software_rasterizer.h"
+#include "string_hash.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+// Triangles using each vertex, as compressed rows.
+struct Adjacency {
+    std::vector<uint32_t> offsets, triangles;
+};
+
+void
+buildAdjacency(const uint32_t *indices, size_t index_count, size_t vertex_count, Adjacency& adjacency) {
+    size_t triangle_count = index_count / 3;
+    adjacency.offsets.assign(vertex_count + 1, 0);
+
+    for (size_t i = 0; i < triangle_count * 3; ++i) {
+        ++adjacency.offsets[indices[i] + 1];
+    }
+
+    for (size_t v = 0; v < vertex_count; ++v) {
+        adjacency.offsets[v + 1] += adjacency.offsets[v];
+    }
+
+    adjacency.triangles.resize(triangle_count * 3);
+    std::vector<uint32_t> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+
+    for (size_t i = 0; i < triangle_count * 3; ++i) {
+        adjacency.triangles[fill[indices[i]]++] = uint32_t(i / 3);
+    }
+}
+
+// Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality
+// and Reduced Overdraw" (2007): fan around a vertex, then move to the
+// candidate vertex that is still in the cache and will stay there while its
+// remaining triangles are drawn, falling back to recently used vertices and
+// then to a scan.
+void
+tipsify(const uint32_t *indices, size_t index_count, size_t vertex_count, uint32_t cache_size, uint32_t *destination) {
+    size_t triangle_count = index_count / 3;
+
+    Adjacency adjacency;
+    buildAdjacency(indices, index_count, vertex_count, adjacency);
+
+    std::vector<uint32_t> live(vertex_count);
+
+    for (size_t v = 0; v < vertex_count; ++v) {
+        live[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+    }
+
+    std::vector<uint32_t> timestamps(vertex_count, 0);
+    std::vector<uint8_t> emitted(triangle_count, 0);
+    std::vector<uint32_t> dead_ends, candidates;
+
+    uint32_t time = cache_size + 1;
+    size_t cursor = 0, written = 0;
+
+    auto skipDeadEnd = [&]() -> int64_t {
+        while (!dead_ends.empty()) {
+            uint32_t v = dead_ends.back();
+            dead_ends.pop_back();
+
+            if (live[v] > 0) {
+                return v;
+            }
+        }
+
+        for (; cursor < vertex_count; ++cursor) {
+            if (live[cursor] > 0) {
+                return (int64_t)cursor;
+            }
+        }
+
+        return -1;
+    };
+
+    int64_t fan = skipDeadEnd();
+
+    while (fan >= 0) {
+        candidates.clear();
+
+        for (uint32_t a = adjacency.offsets[fan]; a < adjacency.offsets[fan + 1]; ++a) {
+            uint32_t t = adjacency.triangles[a];
+
+            if (emitted[t]) {
+                continue;
+            }
+
+            for (int k = 0; k < 3; ++k) {
+                uint32_t v = indices[t * 3 + k];
+                destination[written++] = v;
+                dead_ends.push_back(v);
+                candidates.push_back(v);
+                --live[v];
+
+                if (time - timestamps[v] > cache_size) {
+                    timestamps[v] = time++;
+                }
+            }
+
+            emitted[t] = 1;
+        }
+
+        // The candidate that entered the cache longest ago among those that
+        // will still be cached after fanning around them.
+        int64_t next = -1;
+        int64_t best = -1;
+
+        for (uint32_t v : candidates) {
+            if (live[v] == 0) {
+                continue;
+            }
+
+            int64_t priority = 0;
+
+            if (time - timestamps[v] + 2 * live[v] <= cache_size) {
+                priority = time - timestamps[v];
+            }
+
+            if (priority > best) {
+                best = priority;
+                next = v;
+            }
+        }
+
+        fan = next >= 0 ? next : skipDeadEnd();
+    }
+}
+
+// Forsyth, "Linear-Speed Vertex Cache Optimisation" (2006): greedily emit
+// the triangle whose vertices score highest, where recently used vertices
+// and vertices with few triangles left score high.
+const uint32_t forsyth_cache_size = 32;
+
+float
+forsythScore(int32_t cache_position, uint32_t live) {
+    if (live == 0) {
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+
+    if (cache_position >= 0) {
+        if (cache_position < 3) {
+            // The last triangle's vertices; a fixed score so it is not
+            // favoured over triangles that share an edge with it.
+            score = 0.75f;
+        }
+        else {
+            float scaled = 1.0f - float(cache_position - 3) / float(forsyth_cache_size - 3);
+            score = std::pow(scaled, 1.5f);
+        }
+    }
+
+    return score + 2.0f / std::sqrt((float)live);
+}
+
+void
+forsyth(const uint32_t *indices, size_t index_count, size_t vertex_count, uint32_t *destination) {
+    size_t triangle_count = index_count / 3;
+
+    Adjacency adjacency;
+    buildAdjacency(indices, index_count, vertex_count, adjacency);
+
+    // Live triangles are kept at the front of each vertex's row.
+    std::vector<uint32_t> live(vertex_count);
+    std::vector<int32_t> cache_position(vertex_count, -1);
+    std::vector<float> vertex_score(vertex_count);
+
+    for (size_t v = 0; v < vertex_count; ++v) {
+        live[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+        vertex_score[v] = forsythScore(-1, live[v]);
+    }
+
+    std::vector<uint8_t> emitted(triangle_count, 0);
+
+    std::vector<uint32_t> cache, next_cache;
+    size_t cursor = 0, written = 0;
+    int64_t best = -1;
+
+    for (size_t emitted_count = 0; emitted_count < triangle_count; ++emitted_count) {
+        if (best < 0) {
+            // Nothing connected to the cache: take the next triangle left in
+            // the input, as the original does for speed.
+            while (emitted[cursor]) {
+                ++cursor;
+            }
+
+            best = (int64_t)cursor;
+        }
+
+        uint32_t t = (uint32_t)best;
+        const uint32_t *triangle = &indices[t * 3];
+        emitted[t] = 1;
+
+        for (int k = 0; k < 3; ++k) {
+            uint32_t v = triangle[k];
+            destination[written++] = v;
+
+            // A degenerate triangle is in its repeated vertex's row twice,
+            // and removed once per corner.
+            uint32_t *row = &adjacency.triangles[adjacency.offsets[v]];
+            std::swap(*std::find(row, row + live[v], t), row[live[v] - 1]);
+            --live[v];
+        }
+
+        // LRU: the triangle's vertices move to the front.
+        next_cache.clear();
+
+        for (int k = 0; k < 3; ++k) {
+            if (std::find(next_cache.begin(), next_cache.end(), triangle[k]) == next_cache.end()) {
+                next_cache.push_back(triangle[k]);
+            }
+        }
+
+        for (uint32_t v : cache) {
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+                next_cache.push_back(v);
+            }
+        }
+
+        cache.swap(next_cache);
+
+        // Evicted vertices still need their scores lowered.
+        for (size_t position = 0; position < cache.size(); ++position) {
+            uint32_t v = cache[position];
+            cache_position[v] = position < forsyth_cache_size ? int32_t(position) : -1;
+            vertex_score[v] = forsythScore(cache_position[v], live[v]);
+        }
+
+        if (cache.size() > forsyth_cache_size) {
+            cache.resize(forsyth_cache_size);
+        }
+
+        // The best triangle touching the cache.
+        best = -1;
+        float best_score = -1.0f;
+
+        for (uint32_t v : cache) {
+            for (uint32_t a = 0; a < live[v]; ++a) {
+                uint32_t candidate = adjacency.triangles[adjacency.offsets[v] + a];
+                const uint32_t *c = &indices[candidate * 3];
+                float score = vertex_score[c[0]] + vertex_score[c[1]] + vertex_score[c[2]];
+
+                if (score > best_score) {
+                    best_score = score;
+                    best = candidate;
+                }
+            }
+        }
+    }
+}
+
+// FIFO cache simulation with timestamps: a vertex is cached while fewer than
+// `cache_size` misses have happened since it was loaded.
+struct FifoCache {
+    std::vector<uint32_t> timestamps;
+    uint32_t time;
+    uint32_t size;
+
+    FifoCache(size_t vertex_count, uint32_t cache_size)
+        : timestamps(vertex_count, 0), time(cache_size + 1), size(cache_size) {
+    }
+
+    // Empties the cache without touching every vertex.
+    void flush() {
+        time += size + 1;
+    }
+
+    uint32_t triangleMisses(const uint32_t *triangle) {
+        uint32_t misses = 0;
+
+        for (int k = 0; k < 3; ++k) {
+            uint32_t v = triangle[k];
+
+            if (time - timestamps[v] > size) {
+                timestamps[v] = time++;
+                ++misses;
+            }
+        }
+
+        return misses;
+    }
+};
+
+}
+
+size_t
+weldVertices(const void *vertices, size_t vertex_count, size_t vertex_size, uint32_t *remap) {
+    const char *bytes = static_cast<const char *>(vertices);
+
+    // Open addressing over vertex indices, at most half full.
+    size_t capacity = 16;
+
+    while (capacity < vertex_count * 2) {
+        capacity *= 2;
+    }
+
+    std::vector<uint32_t> table(capacity, UINT32_MAX);
+    uint32_t unique = 0;
+
+    for (size_t i = 0; i < vertex_count; ++i) {
+        const char *vertex = bytes + i * vertex_size;
+        size_t slot = hashName(vertex, vertex_size) & (capacity - 1);
+
+        for (;; slot = (slot + 1) & (capacity - 1)) {
+            uint32_t existing = table[slot];
+
+            if (existing == UINT32_MAX) {
+                table[slot] = (uint32_t)i;
+                remap[i] = unique++;
+                break;
+            }
+
+            if (std::memcmp(bytes + existing * vertex_size, vertex, vertex_size) == 0) {
+                remap[i] = remap[existing];
+                break;
+            }
+        }
+    }
+
+    return unique;
+}
+
+void
+remapVertices(void *destination, const void *vertices, size_t vertex_count, size_t vertex_size, const uint32_t *remap) {
+    char *out = static_cast<char *>(destination);
+    const char *in = static_cast<const char *>(vertices);
+
+    for (size_t i = 0; i < vertex_count; ++i) {
+        std::memcpy(out + remap[i] * vertex_size, in + i * vertex_size, vertex_size);
+    }
+}
+
+void
+remapIndices(uint32_t *indices, const uint32_t *source, size_t index_count, const uint32_t *remap) {
+    for (size_t i = 0; i < index_count; ++i) {
+        indices[i] = remap[source ? source[i] : i];
+    }
+}
+
+void
+optimizeVertexCache(uint32_t *indices, size_t index_count, size_t vertex_count, VertexCacheAlgorithm algorithm,
+    uint32_t cache_size) {
+    std::vector<uint32_t> reordered(index_count / 3 * 3);
+
+    if (algorithm == VertexCacheAlgorithmForsyth) {
+        forsyth(indices, index_count, vertex_count, reordered.data());
+    }
+    else {
+        tipsify(indices, index_count, vertex_count, cache_size, reordered.data());
+    }
+
+    std::copy(reordered.begin(), reordered.end(), indices);
+}
+
+void
+optimizeOverdraw(uint32_t *indices, size_t index_count, const float *positions, size_t vertex_count,
+    size_t position_stride, float threshold, uint32_t cache_size) {
+    size_t triangle_count = index_count / 3;
+
+    if (triangle_count == 0) {
+        return;
+    }
+
+    auto position = [&](uint32_t v) {
+        return reinterpret_cast<const float *>(reinterpret_cast<const char *>(positions) + v * position_stride);
+    };
+
+    // Hard boundaries: triangles that miss on all three vertices, where the
+    // cache order starts afresh anyway.
+    FifoCache cache(vertex_count, cache_size);
+    std::vector<uint32_t> hard { 0 };
+
+    for (size_t t = 0; t < triangle_count; ++t) {
+        if (cache.triangleMisses(&indices[t * 3]) == 3 && t > 0) {
+            hard.push_back((uint32_t)t);
+        }
+    }
+
+    hard.push_back((uint32_t)triangle_count);
+
+    // Soft boundaries: within each, close a cluster as soon as it is at
+    // least as cache friendly as the threshold allows, counting the misses
+    // it costs to start each one with a cold cache.
+    std::vector<uint32_t> clusters;
+
+    for (size_t h = 0; h + 1 < hard.size(); ++h) {
+        uint32_t begin = hard[h], end = hard[h + 1];
+
+        cache.flush();
+        uint32_t misses = 0;
+
+        for (uint32_t t = begin; t < end; ++t) {
+            misses += cache.triangleMisses(&indices[t * 3]);
+        }
+
+        float limit = threshold * misses / float(end - begin);
+
+        cache.flush();
+        misses = 0;
+        uint32_t start = begin;
+        clusters.push_back(begin);
+
+        for (uint32_t t = begin; t < end; ++t) {
+            misses += cache.triangleMisses(&indices[t * 3]);
+
+            if (t + 1 < end && misses <= limit * (t + 1 - start)) {
+                clusters.push_back(t + 1);
+                start = t + 1;
+                misses = 0;
+                cache.flush();
+            }
+        }
+    }
+
+    clusters.push_back((uint32_t)triangle_count);
+
+    // Mesh center from the vertices the triangles use.
+    double mesh_center[3] = { 0.0, 0.0, 0.0 };
+
+    for (size_t i = 0; i < triangle_count * 3; ++i) {
+        const float *p = position(indices[i]);
+
+        for (int c = 0; c < 3; ++c) {
+            mesh_center[c] += p[c];
+        }
+    }
+
+    for (double& c : mesh_center) {
+        c /= double(triangle_count * 3);
+    }
+
+    // Sort key: how far the cluster lies out along its own average normal.
+    struct Cluster {
+        uint32_t begin, end;
+        float key;
+    };
+
+    std::vector<Cluster> sorted;
+
+    for (size_t k = 0; k + 1 < clusters.size(); ++k) {
+        double center[3] = { 0.0, 0.0, 0.0 }, normal[3] = { 0.0, 0.0, 0.0 }, area = 0.0;
+
+        for (uint32_t t = clusters[k]; t < clusters[k + 1]; ++t) {
+            const float *a = position(indices[t * 3]), *b = position(indices[t * 3 + 1]), *c = position(indices[t * 3 + 2]);
+
+            double e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+            double e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+            double n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            double triangle_area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+            for (int i = 0; i < 3; ++i) {
+                center[i] += (a[i] + b[i] + c[i]) / 3.0 * triangle_area;
+                normal[i] += n[i];
+            }
+
+            area += triangle_area;
+        }
+
+        double normal_length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        double key = 0.0;
+
+        if (area > 0.0 && normal_length > 0.0) {
+            for (int i = 0; i < 3; ++i) {
+                key += (center[i] / area - mesh_center[i]) * normal[i] / normal_length;
+            }
+        }
+
+        sorted.push_back({ clusters[k], clusters[k + 1], (float)key });
+    }
+
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster& a, const Cluster& b) {
+        return a.key > b.key;
+    });
+
+    std::vector<uint32_t> reordered;
+    reordered.reserve(triangle_count * 3);
+
+    for (const Cluster& cluster : sorted) {
+        reordered.insert(reordered.end(), indices + cluster.begin * 3, indices + cluster.end * 3);
+    }
+
+    std::copy(reordered.begin(), reordered.end(), indices);
+}
+
+size_t
+optimizeVertexFetch(void *destination, uint32_t *indices, size_t index_count, const void *vertices,
+    size_t vertex_count, size_t vertex_size) {
+    std::vector<uint32_t> remap(vertex_count, UINT32_MAX);
+    char *out = static_cast<char *>(destination);
+    const char *in = static_cast<const char *>(vertices);
+    uint32_t next = 0;
+
+    for (size_t i = 0; i < index_count; ++i) {
+        uint32_t& target = remap[indices[i]];
+
+        if (target == UINT32_MAX) {
+            std::memcpy(out + next * vertex_size, in + indices[i] * vertex_size, vertex_size);
+            target = next++;
+        }
+
+        indices[i] = target;
+    }
+
+    return next;
+}
+
+VertexCacheStats
+analyzeVertexCache(const uint32_t *indices, size_t index_count, size_t vertex_count, uint32_t cache_size) {
+    VertexCacheStats stats;
+    size_t triangle_count = index_count / 3;
+
+    if (triangle_count == 0) {
+        return stats;
+    }
+
+    FifoCache cache(vertex_count, cache_size);
+    std::vector<uint8_t> used(vertex_count, 0);
+    size_t used_count = 0;
+
+    for (size_t t = 0; t < triangle_count; ++t) {
+        stats.transformed += cache.triangleMisses(&indices[t * 3]);
+
+        for (int k = 0; k < 3; ++k) {
+            uint8_t& flag = used[indices[t * 3 + k]];
+            used_count += flag ^ 1;
+            flag = 1;
+        }
+    }
+
+    stats.acmr = float(stats.transformed) / float(triangle_count);
+    stats.atvr = float(stats.transformed) / float(used_count);
+    return stats;
+}
+
+OverdrawStats
+analyzeOverdraw(const uint32_t *indices, size_t index_count, const float *positions, size_t vertex_count,
+    size_t position_stride, uint32_t resolution) {
+    OverdrawStats stats;
+    size_t triangle_count = index_count / 3;
+
+    if (triangle_count == 0 || vertex_count == 0) {
+        return stats;
+    }
+
+    auto position = [&](uint32_t v) {
+        return reinterpret_cast<const float *>(reinterpret_cast<const char *>(positions) + v * position_stride);
+    };
+
+    float low[3], high[3];
+
+    for (int c = 0; c < 3; ++c) {
+        low[c] = std::numeric_limits<float>::max();
+        high[c] = -std::numeric_limits<float>::max();
+    }
+
+    for (size_t i = 0; i < triangle_count * 3; ++i) {
+        const float *p = position(indices[i]);
+
+        for (int c = 0; c < 3; ++c) {
+            low[c] = std::min(low[c], p[c]);
+            high[c] = std::max(high[c], p[c]);
+        }
+    }
+
+    float extent = std::max(std::max(high[0] - low[0], high[1] - low[1]), high[2] - low[2]);
+    float scale = extent > 0.0f ? resolution / extent : 0.0f;
+
+    std::vector<float> depth((size_t)resolution * resolution);
+
+    for (int axis = 0; axis < 3; ++axis) {
+        int u = (axis + 1) % 3, v = (axis + 2) % 3;
+
+        for (float direction : { 1.0f, -1.0f }) {
+            std::fill(depth.begin(), depth.end(), std::numeric_limits<float>::infinity());
+
+            for (size_t t = 0; t < triangle_count; ++t) {
+                RasterPoint screen[3];
+                float z[3];
+
+                for (int k = 0; k < 3; ++k) {
+                    const float *p = position(indices[t * 3 + k]);
+                    screen[k] = { (p[u] - low[u]) * scale, (p[v] - low[v]) * scale };
+                    z[k] = direction * p[axis];
+                }
+
+                rasterizeTriangle(screen[0], screen[1], screen[2], resolution, resolution,
+                    [&](uint32_t x, uint32_t y, float b0, float b1, float b2) {
+                        float fragment = b0 * z[0] + b1 * z[1] + b2 * z[2];
+                        float& stored = depth[(size_t)y * resolution + x];
+
+                        if (fragment <= stored) {
+                            stored = fragment;
+                            ++stats.shaded;
+                        }
+                    });
+            }
+
+            for (float d : depth) {
+                stats.covered += d != std::numeric_limits<float>::infinity() ? 1 : 0;
+            }
+        }
+    }
+
+    stats.overdraw = stats.covered ? float(stats.shaded) / float(stats.covered) : 0.0f;
+    return stats;
+}
+
+void
+narrowIndices(const uint32_t *indices, size_t index_count, uint16_t *destination) {
+    for (size_t i = 0; i < index_count; ++i) {
+        destination[i] = (uint16_t)indices[i];
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Import-time optimization of indexed triangle lists. Vertices are opaque
+// records of `vertex_size` bytes; only the overdraw pass looks inside them,
+// for positions. The usual order is weld, vertex cache, overdraw, then
+// vertex fetch, which renumbers the vertices to match the final triangles.
+
+enum VertexCacheAlgorithm : uint8_t {
+    VertexCacheAlgorithmTipsify,
+    VertexCacheAlgorithmForsyth,
+};
+
+// Post-transform cache behaviour of a triangle list under a FIFO cache of
+// `cache_size` vertices.
+struct VertexCacheStats {
+    size_t transformed = 0;
+
+    // Average cache miss ratio: vertices transformed per triangle, 0.5 at
+    // best for large regular meshes and 3 at worst.
+    float acmr = 0.0f;
+
+    // Average transform to vertex ratio: vertices transformed per vertex
+    // referenced, 1 at best.
+    float atvr = 0.0f;
+};
+
+struct OverdrawStats {
+    uint64_t covered = 0;
+    uint64_t shaded = 0;
+
+    // Fragments shaded per covered pixel, 1 at best.
+    float overdraw = 0.0f;
+};
+
+// Gives each vertex the index of the first bitwise-identical one, counting
+// unique vertices in order of first appearance: `remap[i]` is where vertex
+// `i` goes. Returns the number of unique vertices.
+size_t weldVertices(const void *vertices, size_t vertex_count, size_t vertex_size, uint32_t *remap);
+
+// Applies a remap from `weldVertices`: `destination` receives the unique
+// vertices, and `indices` the remapped `source` indices, or the remap itself
+// for an unindexed `source` (nullptr).
+void remapVertices(void *destination, const void *vertices, size_t vertex_count, size_t vertex_size, const uint32_t *remap);
+void remapIndices(uint32_t *indices, const uint32_t *source, size_t index_count, const uint32_t *remap);
+
+// Reorders triangles in place so consecutive ones share vertices. Tipsify is
+// tuned for a FIFO cache of `cache_size`; Forsyth's scores assume an LRU
+// cache and ignore it.
+void optimizeVertexCache(uint32_t *indices, size_t index_count, size_t vertex_count,
+    VertexCacheAlgorithm algorithm = VertexCacheAlgorithmTipsify, uint32_t cache_size = 16);
+
+// Reorders clusters of triangles so that outward-facing ones on the outside
+// of the mesh come first, which lets the depth test reject more of what is
+// drawn after them. Clusters end where the cache order already restarts, and
+// are split further as long as their miss ratio stays within `threshold`
+// times that of the order given, so the cache order mostly survives.
+// `positions` points at the first vertex's x, y and z.
+void optimizeOverdraw(uint32_t *indices, size_t index_count, const float *positions, size_t vertex_count,
+    size_t position_stride, float threshold = 1.05f, uint32_t cache_size = 16);
+
+// Renumbers vertices in order of first use so they are fetched in order,
+// dropping unreferenced ones. Returns how many `destination` received.
+size_t optimizeVertexFetch(void *destination, uint32_t *indices, size_t index_count, const void *vertices,
+    size_t vertex_count, size_t vertex_size);
+
+VertexCacheStats analyzeVertexCache(const uint32_t *indices, size_t index_count, size_t vertex_count, uint32_t cache_size = 16);
+
+// Rasterizes the mesh orthographically from the six axis directions at
+// `resolution` pixels across, with a depth test, and counts fragments that
+// pass it against pixels covered.
+OverdrawStats analyzeOverdraw(const uint32_t *indices, size_t index_count, const float *positions, size_t vertex_count,
+    size_t position_stride, uint32_t resolution = 256);
+
+// Index buffers whose vertices all fit in 16 bits can use half the memory.
+inline bool
+fitsIndex16(size_t vertex_count) {
+    return vertex_count <= 65536;
+}
+
+void narrowIndices(const uint32_t *indices, size_t index_count, uint16_t *destination);
@@ -0,0 +1,94 @@
+/*
+Header containing types and enum constants shared between the meshlet shaders
+and C++ code, including the CPU meshlet builder
+*/
+
+#ifndef meshlet_types_H
+#define meshlet_types_H
+
+#include "scene_types.h"
+
+#ifdef __METAL_VERSION__
+typedef packed_float3 MeshletPoint;
+typedef float4 MeshletVector;
+#else
+#include <stdint.h>
+
+typedef struct
+{
+    float x, y, z;
+} MeshletPoint;
+
+#if defined(__APPLE__)
+typedef vector_float4 MeshletVector;
+#else
+typedef struct
+{
+    alignas(16) float x;
+    float y, z, w;
+} MeshletVector;
+#endif
+#endif
+
+// Limits of one meshlet, sized for a mesh threadgroup of 128 threads: each
+// thread writes at most one vertex and one triangle.
+#define MESHLET_MAX_VERTICES  64
+#define MESHLET_MAX_TRIANGLES 124
+
+// Meshlets culled per object threadgroup, one SIMD group.
+#define MESHLET_OBJECT_THREADS 32
+#define MESHLET_MESH_THREADS   128
+
+typedef struct
+{
+    // Into the meshlet vertex list, which holds indices into the vertex
+    // buffer, and into the triangle list, which holds three bytes per
+    // triangle indexing the meshlet's own vertices.
+    uint32_t vertex_offset;
+    uint32_t triangle_offset;
+    uint32_t vertex_count;
+    uint32_t triangle_count;
+} Meshlet;
+
+typedef struct
+{
+    // Center and radius of the bounding sphere.
+    MeshletVector sphere;
+
+    // Apex, and axis with the cone cutoff in w: the meshlet faces away from
+    // an eye at e when dot(apex - e, axis) > cutoff * |apex - e|.
+    MeshletVector cone_apex;
+    MeshletVector cone_axis;
+} MeshletBounds;
+
+typedef struct
+{
+    MeshletPoint position;
+    MeshletPoint normal;
+} MeshletVertex;
+
+typedef struct
+{
+    SceneMatrix model_view_projection;
+    SceneMatrix model;
+
+    // Frustum planes and eye position in model space, for culling.
+    MeshletVector planes[6];
+    MeshletVector eye;
+
+    uint32_t meshlet_count;
+} MeshletUniforms;
+
+typedef enum MeshletInputIndex
+{
+    MeshletInputIndexVertices         = 0,
+    MeshletInputIndexMeshlets         = 1,
+    MeshletInputIndexMeshletVertices  = 2,
+    MeshletInputIndexMeshletTriangles = 3,
+    MeshletInputIndexBounds           = 4,
+    MeshletInputIndexUniforms         = 5,
+    MeshletInputIndexVisible          = 6,
+    MeshletInputIndexDrawArguments    = 7,
+} MeshletInputIndex;
+
+#endif /* meshlet_types_H */
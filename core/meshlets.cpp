@@ -0,0 +1,438 @@
+#include "meshlets.h"
+#include "thread_pool.h"
+#include "vec4.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Meshlets per parallel culling task; a multiple of the four-meshlet step.
+const size_t meshlet_cull_grain = 4096;
+
+const uint8_t not_in_meshlet = 0xff;
+
+inline const float *
+position(const float *positions, size_t stride, uint32_t index) {
+    return reinterpret_cast<const float *>(reinterpret_cast<const char *>(positions) + index * stride);
+}
+
+// Unit normal of a triangle, false if it has no area.
+inline bool
+triangleNormal(const float *a, const float *b, const float *c, float normal[3]) {
+    float u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+    float v[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+
+    normal[0] = u[1] * v[2] - u[2] * v[1];
+    normal[1] = u[2] * v[0] - u[0] * v[2];
+    normal[2] = u[0] * v[1] - u[1] * v[0];
+
+    float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+    if (length == 0.0f) {
+        return false;
+    }
+
+    for (int c = 0; c < 3; ++c) {
+        normal[c] /= length;
+    }
+
+    return true;
+}
+
+inline bool
+isVisible(const CullBounds& spheres, const MeshletCones& cones, const Frustum& frustum, const float eye[3], size_t i) {
+    for (const auto& plane : frustum.planes) {
+        float distance = spheres.center[0][i] * plane[0] + spheres.center[1][i] * plane[1] +
+                         spheres.center[2][i] * plane[2] + plane[3];
+
+        if (distance < -spheres.radius[i]) {
+            return false;
+        }
+    }
+
+    float d[3] = { cones.apex[0][i] - eye[0], cones.apex[1][i] - eye[1], cones.apex[2][i] - eye[2] };
+    float along = d[0] * cones.axis[0][i] + d[1] * cones.axis[1][i] + d[2] * cones.axis[2][i];
+
+    return !(along > cones.cutoff[i] * std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]));
+}
+
+// Which of the four meshlets at `i` are culled, as `Mask4` bits.
+inline int
+culledBits(const CullBounds& spheres, const MeshletCones& cones, const Vec4f planes[6][4], const Vec4f eye[3], size_t i) {
+    Vec4f x = Vec4f::load(&spheres.center[0][i]);
+    Vec4f y = Vec4f::load(&spheres.center[1][i]);
+    Vec4f z = Vec4f::load(&spheres.center[2][i]);
+    Vec4f radius = -Vec4f::load(&spheres.radius[i]);
+
+    Mask4 culled = x * planes[0][0] + y * planes[0][1] + z * planes[0][2] + planes[0][3] < radius;
+
+    for (int p = 1; p < 6; ++p) {
+        culled = culled | (x * planes[p][0] + y * planes[p][1] + z * planes[p][2] + planes[p][3] < radius);
+    }
+
+    Vec4f dx = Vec4f::load(&cones.apex[0][i]) - eye[0];
+    Vec4f dy = Vec4f::load(&cones.apex[1][i]) - eye[1];
+    Vec4f dz = Vec4f::load(&cones.apex[2][i]) - eye[2];
+    Vec4f along = dx * Vec4f::load(&cones.axis[0][i]) + dy * Vec4f::load(&cones.axis[1][i]) +
+                  dz * Vec4f::load(&cones.axis[2][i]);
+    Vec4f distance = sqrt(dx * dx + dy * dy + dz * dz);
+
+    return (culled | (along > Vec4f::load(&cones.cutoff[i]) * distance)).bits();
+}
+
+// Tests meshlets [begin, end) and writes the visible ones' indices to
+// `out`, returning how many; as cullRange in culling.cpp, `out` may be the
+// slice of the result that starts at `begin`.
+size_t
+cullMeshletRange(const CullBounds& spheres, const MeshletCones& cones, const Frustum& frustum, const float eye[3],
+    size_t begin, size_t end, uint32_t *out, SimdKernel kernel) {
+    size_t count = 0;
+    size_t simd_end = kernel == SimdKernelVector ? begin + (end - begin) / 4 * 4 : begin;
+
+    Vec4f planes[6][4], eye4[3];
+
+    for (int p = 0; p < 6; ++p) {
+        for (int c = 0; c < 4; ++c) {
+            planes[p][c] = Vec4f::broadcast(frustum.planes[p][c]);
+        }
+    }
+
+    for (int c = 0; c < 3; ++c) {
+        eye4[c] = Vec4f::broadcast(eye[c]);
+    }
+
+    for (size_t i = begin; i < simd_end; i += 4) {
+        int culled = culledBits(spheres, cones, planes, eye4, i);
+
+        for (int lane = 0; lane < 4; ++lane) {
+            out[count] = uint32_t(i + lane);
+            count += ((culled >> lane) & 1) ^ 1;
+        }
+    }
+
+    for (size_t i = simd_end; i < end; ++i) {
+        out[count] = uint32_t(i);
+        count += isVisible(spheres, cones, frustum, eye, i) ? 1 : 0;
+    }
+
+    return count;
+}
+
+// The meshlet being built.
+struct MeshletBuilder {
+    Meshlet meshlet = {};
+    float centroid_sum[3] = {};
+    std::vector<uint32_t> candidates;
+};
+
+}
+
+void
+MeshletCones::resize(size_t count) {
+    for (int c = 0; c < 3; ++c) {
+        apex[c].resize(count);
+        axis[c].resize(count);
+    }
+
+    cutoff.resize(count);
+}
+
+void
+buildMeshlets(MeshletMesh& mesh, const uint32_t *indices, size_t index_count, const float *positions,
+    size_t vertex_count, size_t stride, size_t max_vertices, size_t max_triangles) {
+    size_t triangle_count = index_count / 3;
+    max_vertices = std::min<size_t>(std::max<size_t>(max_vertices, 3), not_in_meshlet);
+    max_triangles = std::max<size_t>(max_triangles, 1);
+
+    mesh.meshlets.clear();
+    mesh.vertices.clear();
+    mesh.triangles.clear();
+    mesh.meshlets.reserve(triangle_count / max_triangles + 1);
+    mesh.vertices.reserve(triangle_count);
+    mesh.triangles.reserve(triangle_count * 3);
+
+    // Triangles around each vertex.
+    std::vector<uint32_t> first(vertex_count + 1, 0), adjacency(triangle_count * 3);
+
+    for (size_t i = 0; i < triangle_count * 3; ++i) {
+        ++first[indices[i] + 1];
+    }
+
+    for (size_t v = 0; v < vertex_count; ++v) {
+        first[v + 1] += first[v];
+    }
+
+    std::vector<uint32_t> fill(first.begin(), first.end() - 1);
+
+    for (size_t i = 0; i < triangle_count * 3; ++i) {
+        adjacency[fill[indices[i]]++] = uint32_t(i / 3);
+    }
+
+    std::vector<uint8_t> emitted(triangle_count, 0);
+    std::vector<uint8_t> local(vertex_count, not_in_meshlet);
+    MeshletBuilder builder;
+    size_t seed = 0;
+
+    auto finish = [&]() {
+        if (builder.meshlet.triangle_count == 0) {
+            return;
+        }
+
+        for (uint32_t v = 0; v < builder.meshlet.vertex_count; ++v) {
+            local[mesh.vertices[builder.meshlet.vertex_offset + v]] = not_in_meshlet;
+        }
+
+        mesh.meshlets.push_back(builder.meshlet);
+        builder.meshlet = Meshlet { (uint32_t)mesh.vertices.size(), (uint32_t)mesh.triangles.size(), 0, 0 };
+        builder.centroid_sum[0] = builder.centroid_sum[1] = builder.centroid_sum[2] = 0.0f;
+        builder.candidates.clear();
+    };
+
+    auto newVertices = [&](uint32_t triangle) {
+        const uint32_t *t = &indices[triangle * 3];
+        int fresh = 0;
+
+        for (int k = 0; k < 3; ++k) {
+            bool repeat = (k > 0 && t[k] == t[0]) || (k > 1 && t[k] == t[1]);
+            fresh += local[t[k]] == not_in_meshlet && !repeat ? 1 : 0;
+        }
+
+        return fresh;
+    };
+
+    auto add = [&](uint32_t triangle) {
+        emitted[triangle] = 1;
+
+        for (int k = 0; k < 3; ++k) {
+            uint32_t v = indices[triangle * 3 + k];
+
+            if (local[v] == not_in_meshlet) {
+                local[v] = (uint8_t)builder.meshlet.vertex_count++;
+                mesh.vertices.push_back(v);
+
+                const float *p = position(positions, stride, v);
+
+                for (int c = 0; c < 3; ++c) {
+                    builder.centroid_sum[c] += p[c];
+                }
+
+                for (uint32_t a = first[v]; a < first[v + 1]; ++a) {
+                    if (!emitted[adjacency[a]]) {
+                        builder.candidates.push_back(adjacency[a]);
+                    }
+                }
+            }
+
+            mesh.triangles.push_back(local[v]);
+        }
+
+        ++builder.meshlet.triangle_count;
+    };
+
+    for (size_t emitted_count = 0; emitted_count < triangle_count; ++emitted_count) {
+        // The neighbor that brings the fewest new vertices, then the one
+        // nearest the middle of the meshlet; stale candidates are dropped.
+        uint32_t best = UINT32_MAX;
+        int best_new = 4;
+        float best_distance = INFINITY;
+        float centroid[3];
+
+        for (int c = 0; c < 3; ++c) {
+            centroid[c] = builder.meshlet.vertex_count ? builder.centroid_sum[c] / builder.meshlet.vertex_count : 0.0f;
+        }
+
+        size_t kept = 0;
+
+        for (uint32_t triangle : builder.candidates) {
+            if (emitted[triangle]) {
+                continue;
+            }
+
+            builder.candidates[kept++] = triangle;
+            int fresh = newVertices(triangle);
+
+            if (fresh > best_new) {
+                continue;
+            }
+
+            float distance = 0.0f;
+
+            for (int c = 0; c < 3; ++c) {
+                float middle = (position(positions, stride, indices[triangle * 3])[c] +
+                                position(positions, stride, indices[triangle * 3 + 1])[c] +
+                                position(positions, stride, indices[triangle * 3 + 2])[c]) / 3.0f;
+                distance += (middle - centroid[c]) * (middle - centroid[c]);
+            }
+
+            if (fresh < best_new || distance < best_distance) {
+                best = triangle;
+                best_new = fresh;
+                best_distance = distance;
+            }
+        }
+
+        builder.candidates.resize(kept);
+
+        // Nothing adjacent left: carry on from the next unused triangle,
+        // in this meshlet if it fits.
+        if (best == UINT32_MAX) {
+            while (emitted[seed]) {
+                ++seed;
+            }
+
+            best = (uint32_t)seed;
+            best_new = newVertices(best);
+        }
+
+        if (builder.meshlet.vertex_count + best_new > max_vertices || builder.meshlet.triangle_count + 1 > max_triangles) {
+            finish();
+        }
+
+        add(best);
+    }
+
+    finish();
+}
+
+void
+computeMeshletBounds(const MeshletMesh& mesh, const float *positions, size_t stride, CullBounds& spheres,
+    MeshletCones& cones) {
+    spheres.resize(mesh.meshlets.size());
+    cones.resize(mesh.meshlets.size());
+
+    for (size_t m = 0; m < mesh.meshlets.size(); ++m) {
+        const Meshlet& meshlet = mesh.meshlets[m];
+        const uint32_t *vertices = &mesh.vertices[meshlet.vertex_offset];
+        const uint8_t *triangles = &mesh.triangles[meshlet.triangle_offset];
+
+        // Sphere around the box center, which is close to minimal for the
+        // compact shapes the builder makes.
+        float low[3] = { INFINITY, INFINITY, INFINITY }, high[3] = { -INFINITY, -INFINITY, -INFINITY };
+
+        for (uint32_t v = 0; v < meshlet.vertex_count; ++v) {
+            const float *p = position(positions, stride, vertices[v]);
+
+            for (int c = 0; c < 3; ++c) {
+                low[c] = std::min(low[c], p[c]);
+                high[c] = std::max(high[c], p[c]);
+            }
+        }
+
+        float center[3] = { 0.5f * (low[0] + high[0]), 0.5f * (low[1] + high[1]), 0.5f * (low[2] + high[2]) };
+        float radius = 0.0f;
+
+        for (uint32_t v = 0; v < meshlet.vertex_count; ++v) {
+            const float *p = position(positions, stride, vertices[v]);
+            float d[3] = { p[0] - center[0], p[1] - center[1], p[2] - center[2] };
+            radius = std::max(radius, std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]));
+        }
+
+        spheres.setSphere(m, center[0], center[1], center[2], radius);
+
+        // Cone around the mean normal, widened to every triangle's normal.
+        // The apex moves back along the axis until every triangle's plane
+        // is in front of it, so a view from outside the cone sees only
+        // backs.
+        std::vector<float> normals;
+        normals.reserve(meshlet.triangle_count * 3);
+        float axis[3] = {};
+
+        for (uint32_t t = 0; t < meshlet.triangle_count; ++t) {
+            float n[3];
+
+            if (triangleNormal(position(positions, stride, vertices[triangles[t * 3]]),
+                               position(positions, stride, vertices[triangles[t * 3 + 1]]),
+                               position(positions, stride, vertices[triangles[t * 3 + 2]]), n)) {
+                normals.insert(normals.end(), n, n + 3);
+
+                for (int c = 0; c < 3; ++c) {
+                    axis[c] += n[c];
+                }
+            }
+        }
+
+        float axis_length = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+        float min_dot = axis_length > 0.0f ? 1.0f : -1.0f;
+
+        for (size_t t = 0; axis_length > 0.0f && t < normals.size(); t += 3) {
+            min_dot = std::min(min_dot, (normals[t] * axis[0] + normals[t + 1] * axis[1] + normals[t + 2] * axis[2]) / axis_length);
+        }
+
+        for (int c = 0; c < 3; ++c) {
+            cones.apex[c][m] = center[c];
+            cones.axis[c][m] = 0.0f;
+        }
+
+        cones.cutoff[m] = 1.0f;
+
+        // Past 90 degrees from the axis some triangle faces every way the
+        // test could look from; a little margin keeps the apex finite.
+        if (min_dot <= 0.05f) {
+            continue;
+        }
+
+        float unit_axis[3] = { axis[0] / axis_length, axis[1] / axis_length, axis[2] / axis_length };
+        float back = 0.0f;
+
+        for (uint32_t t = 0; t < meshlet.triangle_count; ++t) {
+            const float *p = position(positions, stride, vertices[triangles[t * 3]]);
+            float n[3];
+
+            if (!triangleNormal(p, position(positions, stride, vertices[triangles[t * 3 + 1]]),
+                                position(positions, stride, vertices[triangles[t * 3 + 2]]), n)) {
+                continue;
+            }
+
+            float to_center = (center[0] - p[0]) * n[0] + (center[1] - p[1]) * n[1] + (center[2] - p[2]) * n[2];
+            float along = unit_axis[0] * n[0] + unit_axis[1] * n[1] + unit_axis[2] * n[2];
+            back = std::max(back, to_center / along);
+        }
+
+        for (int c = 0; c < 3; ++c) {
+            cones.apex[c][m] = center[c] - unit_axis[c] * back;
+            cones.axis[c][m] = unit_axis[c];
+        }
+
+        cones.cutoff[m] = std::sqrt(1.0f - min_dot * min_dot);
+    }
+}
+
+void
+packMeshletBounds(const CullBounds& spheres, const MeshletCones& cones, MeshletBounds *out) {
+    for (size_t m = 0; m < spheres.size(); ++m) {
+        out[m].sphere = MeshletVector { spheres.center[0][m], spheres.center[1][m], spheres.center[2][m], spheres.radius[m] };
+        out[m].cone_apex = MeshletVector { cones.apex[0][m], cones.apex[1][m], cones.apex[2][m], 0.0f };
+        out[m].cone_axis = MeshletVector { cones.axis[0][m], cones.axis[1][m], cones.axis[2][m], cones.cutoff[m] };
+    }
+}
+
+size_t
+cullMeshlets(const CullBounds& spheres, const MeshletCones& cones, const Frustum& frustum, const float eye[3],
+    std::vector<uint32_t>& visible, ThreadPool *pool, SimdKernel kernel) {
+    size_t count = spheres.size();
+    visible.resize(count);
+
+    if (pool && count > meshlet_cull_grain) {
+        std::vector<size_t> counts((count + meshlet_cull_grain - 1) / meshlet_cull_grain);
+
+        pool->parallelFor(count, meshlet_cull_grain, [&](size_t begin, size_t end) {
+            counts[begin / meshlet_cull_grain] = cullMeshletRange(spheres, cones, frustum, eye, begin, end, &visible[begin], kernel);
+        });
+
+        size_t total = counts[0];
+
+        for (size_t task = 1; task < counts.size(); ++task) {
+            std::memmove(&visible[total], &visible[task * meshlet_cull_grain], counts[task] * sizeof(uint32_t));
+            total += counts[task];
+        }
+
+        visible.resize(total);
+    }
+    else {
+        visible.resize(cullMeshletRange(spheres, cones, frustum, eye, 0, count, visible.data(), kernel));
+    }
+
+    return visible.size();
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "culling.h"
+#include "meshlet_types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// A mesh split into meshlets: small clusters of neighboring triangles with
+// their own vertex lists, culled and drawn as units.
+struct MeshletMesh {
+    std::vector<Meshlet> meshlets;
+
+    // Per meshlet, its vertices as indices into the source vertex buffer.
+    std::vector<uint32_t> vertices;
+
+    // Per meshlet, three bytes per triangle indexing its own vertices.
+    std::vector<uint8_t> triangles;
+};
+
+// Backface cones of meshlets, one array per component, next to their
+// spheres in a CullBounds. A meshlet faces away from an eye at e when
+// dot(apex - e, axis) > cutoff * |apex - e|; meshlets whose triangles face
+// too many ways for that to be useful have a zero axis.
+struct MeshletCones {
+    std::vector<float> apex[3];
+    std::vector<float> axis[3];
+    std::vector<float> cutoff;
+
+    size_t size() const {
+        return cutoff.size();
+    }
+
+    void resize(size_t count);
+};
+
+// Groups indexed triangles into meshlets of at most `max_vertices` vertices
+// and `max_triangles` triangles, keeping every triangle once. Each meshlet
+// grows from a seed by adding the neighboring triangle that brings in the
+// fewest new vertices, and starts over from the next unused triangle in
+// index order when it is full, so a vertex-cache-optimized order gives
+// compact meshlets. `positions` are xyz floats `stride` bytes apart; they
+// only break ties.
+void buildMeshlets(MeshletMesh& mesh, const uint32_t *indices, size_t index_count, const float *positions,
+    size_t vertex_count, size_t stride, size_t max_vertices = MESHLET_MAX_VERTICES,
+    size_t max_triangles = MESHLET_MAX_TRIANGLES);
+
+// Bounding spheres and backface cones of every meshlet.
+void computeMeshletBounds(const MeshletMesh& mesh, const float *positions, size_t stride, CullBounds& spheres,
+    MeshletCones& cones);
+
+// The same bounds laid out for the shaders.
+void packMeshletBounds(const CullBounds& spheres, const MeshletCones& cones, MeshletBounds *out);
+
+// Writes the indices of the meshlets that are at least partly inside
+// `frustum` and do not face away from `eye` to `visible`, in ascending order,
+// and returns how many there are. Frustum and eye are in the meshlets' space.
+// Kernels and threading work as with cullFrustum and give the same list.
+size_t cullMeshlets(const CullBounds& spheres, const MeshletCones& cones, const Frustum& frustum, const float eye[3],
+    std::vector<uint32_t>& visible, ThreadPool *pool = nullptr, SimdKernel kernel = SimdKernelVector);
@@ -0,0 +1,9 @@
+#include "method_cache.h"
+
+// Constant-initialized, so caches used during static initialization see it.
+std::atomic<uint32_t> method_cache_generation { 1 };
+
+void
+invalidateMethodCaches() {
+    method_cache_generation.fetch_add(1, std::memory_order_acq_rel);
+}
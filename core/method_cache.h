@@ -0,0 +1,123 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+// Incremented by `invalidateMethodCaches()`; every cache entry remembers the
+// value it was filled under and is ignored once it moves on.
+extern std::atomic<uint32_t> method_cache_generation;
+
+// Drops every cached implementation in every `MethodCache`. Call after
+// anything that can change what a class answers to a selector: swizzling,
+// adding methods or categories at runtime, or disposing a class whose
+// address may be reused.
+void invalidateMethodCaches();
+
+// Inline cache of one selector's implementation per receiver class, in the
+// spirit of a JIT's polymorphic inline cache. `Runtime` supplies the types
+// and the slow lookup:
+//
+//     struct Runtime {
+//         using Class = ...; using Selector = ...; using Imp = ...;
+//         static Imp methodImplementation(Class, Selector);
+//         static bool isCacheable(Imp);  // false for forwarding stubs
+//     };
+//
+// Lookups take no lock: each way is a seqlock, so a reader either sees a
+// consistent (class, implementation, generation) triple or misses. Fills
+// serialize on a mutex and replace ways round-robin.
+template<typename Runtime, size_t Ways = 4>
+class MethodCache {
+public:
+
+    using Class = typename Runtime::Class;
+    using Selector = typename Runtime::Selector;
+    using Imp = typename Runtime::Imp;
+
+    explicit MethodCache(Selector selector) : d_selector(selector) {
+    }
+
+    MethodCache(const MethodCache&) = delete;
+    MethodCache& operator=(const MethodCache&) = delete;
+
+    Selector selector() const {
+        return d_selector;
+    }
+
+    // Returns null when the implementation must not be called directly, in
+    // which case the caller sends the message normally.
+    Imp lookup(Class cls) {
+        uint32_t generation = method_cache_generation.load(std::memory_order_acquire);
+
+        for (auto& way : d_ways) {
+            uint32_t sequence = way.sequence.load(std::memory_order_acquire);
+
+            if (sequence & 1) {
+                continue;
+            }
+
+            Class way_class = way.cls.load(std::memory_order_relaxed);
+            Imp way_imp = way.imp.load(std::memory_order_relaxed);
+            uint32_t way_generation = way.generation.load(std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (way.sequence.load(std::memory_order_relaxed) == sequence &&
+                way_class == cls && way_generation == generation && way_imp) {
+                return way_imp;
+            }
+        }
+
+        return fill(cls, generation);
+    }
+
+    uint64_t misses() const {
+        return d_misses.load(std::memory_order_relaxed);
+    }
+
+private:
+
+    struct Way {
+        std::atomic<uint32_t> sequence { 0 };
+        std::atomic<Class> cls { Class() };
+        std::atomic<Imp> imp { Imp() };
+        std::atomic<uint32_t> generation { 0 };
+    };
+
+    Imp fill(Class cls, uint32_t generation) {
+        d_misses.fetch_add(1, std::memory_order_relaxed);
+
+        Imp imp = Runtime::methodImplementation(cls, d_selector);
+
+        if (!Runtime::isCacheable(imp)) {
+            return Imp();
+        }
+
+        std::lock_guard<std::mutex> lock(d_mutex);
+
+        Way& way = d_ways[d_next];
+        d_next = (d_next + 1) % Ways;
+
+        uint32_t sequence = way.sequence.load(std::memory_order_relaxed);
+        way.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        way.cls.store(cls, std::memory_order_relaxed);
+        way.imp.store(imp, std::memory_order_relaxed);
+        way.generation.store(generation, std::memory_order_relaxed);
+
+        way.sequence.store(sequence + 2, std::memory_order_release);
+
+        return imp;
+    }
+
+    Selector d_selector;
+    Way d_ways[Ways];
+
+    std::mutex d_mutex;
+    size_t d_next = 0;
+
+    std::atomic<uint64_t> d_misses { 0 };
+};
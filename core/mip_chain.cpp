@@ -0,0 +1,256 @@
+#include "mip_chain.h"
+#include "thread_pool.h"
+#include "vec4.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const size_t mip_row_grain = 16;
+const int max_filter_taps = 8;
+
+// A separable filter for halving: output texel x reads the `count` source
+// texels from 2x + `first`, clamped to the edge.
+struct MipKernel {
+    int first;
+    int count;
+    float weights[max_filter_taps];
+};
+
+double
+besselI0(double x) {
+    double sum = 1.0, term = 1.0;
+
+    for (int k = 1; k < 32; ++k) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+
+    return sum;
+}
+
+struct MipTables {
+    float srgb_to_linear[256];
+
+    // Linear values in steps of 1/4095, which is finer than an sRGB step
+    // everywhere but the darkest few.
+    uint8_t linear_to_srgb[4096];
+
+    MipKernel box = { 0, 2, { 0.5f, 0.5f } };
+    MipKernel kaiser = { -3, 8, {} };
+
+    MipTables() {
+        for (int i = 0; i < 256; ++i) {
+            double c = i / 255.0;
+            srgb_to_linear[i] = (float)(c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4));
+        }
+
+        for (int i = 0; i < 4096; ++i) {
+            double l = i / 4095.0;
+            double c = l <= 0.0031308 ? l * 12.92 : 1.055 * std::pow(l, 1.0 / 2.4) - 0.055;
+            linear_to_srgb[i] = (uint8_t)std::lround(c * 255.0);
+        }
+
+        // Source texel centers sit at half-texel offsets -3.5..3.5 from the
+        // output texel's center, which is 2 source texels wide.
+        const double pi = 3.14159265358979323846, alpha = 4.0;
+        double sum = 0.0, weights[max_filter_taps];
+
+        for (int k = 0; k < kaiser.count; ++k) {
+            double d = k - 3.5, x = d / 2.0;
+            double sinc = std::sin(pi * x) / (pi * x);
+            double window = besselI0(alpha * std::sqrt(1.0 - (d / 4.0) * (d / 4.0))) / besselI0(alpha);
+            weights[k] = sinc * window;
+            sum += weights[k];
+        }
+
+        for (int k = 0; k < kaiser.count; ++k) {
+            kaiser.weights[k] = (float)(weights[k] / sum);
+        }
+    }
+};
+
+const MipTables mip_tables;
+
+template <typename Function>
+void
+forEachRow(uint32_t rows, ThreadPool *pool, const Function& f) {
+    if (pool && rows > mip_row_grain) {
+        pool->parallelFor(rows, mip_row_grain, [&](size_t begin, size_t end) {
+            for (size_t row = begin; row < end; ++row) {
+                f((uint32_t)row);
+            }
+        });
+    }
+    else {
+        for (uint32_t row = 0; row < rows; ++row) {
+            f(row);
+        }
+    }
+}
+
+void
+toLinear(const uint32_t *rgba, size_t count, bool srgb, float *out) {
+    for (size_t i = 0; i < count; ++i) {
+        float alpha = (rgba[i] >> 24) / 255.0f;
+
+        for (int c = 0; c < 3; ++c) {
+            uint32_t value = (rgba[i] >> (8 * c)) & 0xff;
+            out[i * 4 + c] = (srgb ? mip_tables.srgb_to_linear[value] : value / 255.0f) * alpha;
+        }
+
+        out[i * 4 + 3] = alpha;
+    }
+}
+
+uint32_t
+fromLinear(const float texel[4], bool srgb) {
+    float alpha = std::clamp(texel[3], 0.0f, 1.0f);
+    uint32_t color = (uint32_t)(alpha * 255.0f + 0.5f) << 24;
+
+    for (int c = 0; c < 3; ++c) {
+        float value = alpha > 0.0f ? std::clamp(texel[c] / alpha, 0.0f, 1.0f) : 0.0f;
+        uint32_t encoded = srgb ? mip_tables.linear_to_srgb[(int)(value * 4095.0f + 0.5f)] : (uint32_t)(value * 255.0f + 0.5f);
+        color |= encoded << (8 * c);
+    }
+
+    return color;
+}
+
+// One row of the horizontal pass: `out_width` texels from a row of `width`.
+void
+filterRow(const float *source, size_t width, const MipKernel& kernel, float *out, size_t out_width,
+    SimdKernel simd_kernel) {
+    if (simd_kernel == SimdKernelVector) {
+        Vec4f weights[max_filter_taps];
+
+        for (int k = 0; k < kernel.count; ++k) {
+            weights[k] = Vec4f::broadcast(kernel.weights[k]);
+        }
+
+        for (size_t x = 0; x < out_width; ++x) {
+            Vec4f sum = Vec4f::broadcast(0.0f);
+
+            for (int k = 0; k < kernel.count; ++k) {
+                ptrdiff_t at = std::clamp<ptrdiff_t>((ptrdiff_t)x * 2 + kernel.first + k, 0, (ptrdiff_t)width - 1);
+                sum = sum + Vec4f::load(source + at * 4) * weights[k];
+            }
+
+            sum.store(out + x * 4);
+        }
+
+        return;
+    }
+
+    for (size_t x = 0; x < out_width; ++x) {
+        for (int c = 0; c < 4; ++c) {
+            float sum = 0.0f;
+
+            for (int k = 0; k < kernel.count; ++k) {
+                ptrdiff_t at = std::clamp<ptrdiff_t>((ptrdiff_t)x * 2 + kernel.first + k, 0, (ptrdiff_t)width - 1);
+                sum = sum + source[at * 4 + c] * kernel.weights[k];
+            }
+
+            out[x * 4 + c] = sum;
+        }
+    }
+}
+
+// Output row `y` of the vertical pass, from the source rows around 2y of an
+// image `height` rows of `width` texels; whole rows at a time keep the
+// reads sequential.
+void
+filterColumns(const float *source, size_t width, size_t height, const MipKernel& kernel, uint32_t y, float *out,
+    SimdKernel simd_kernel) {
+    const float *rows[max_filter_taps];
+
+    for (int k = 0; k < kernel.count; ++k) {
+        ptrdiff_t at = std::clamp<ptrdiff_t>((ptrdiff_t)y * 2 + kernel.first + k, 0, (ptrdiff_t)height - 1);
+        rows[k] = source + at * width * 4;
+    }
+
+    if (simd_kernel == SimdKernelVector) {
+        Vec4f weights[max_filter_taps];
+
+        for (int k = 0; k < kernel.count; ++k) {
+            weights[k] = Vec4f::broadcast(kernel.weights[k]);
+        }
+
+        for (size_t x = 0; x < width; ++x) {
+            Vec4f sum = Vec4f::broadcast(0.0f);
+
+            for (int k = 0; k < kernel.count; ++k) {
+                sum = sum + Vec4f::load(rows[k] + x * 4) * weights[k];
+            }
+
+            sum.store(out + x * 4);
+        }
+
+        return;
+    }
+
+    for (size_t x = 0; x < width; ++x) {
+        for (int c = 0; c < 4; ++c) {
+            float sum = 0.0f;
+
+            for (int k = 0; k < kernel.count; ++k) {
+                sum = sum + rows[k][x * 4 + c] * kernel.weights[k];
+            }
+
+            out[x * 4 + c] = sum;
+        }
+    }
+}
+
+}
+
+uint32_t
+mipLevelCount(uint32_t width, uint32_t height) {
+    uint32_t count = 1;
+
+    for (uint32_t size = std::max(width, height); size > 1; size >>= 1) {
+        ++count;
+    }
+
+    return count;
+}
+
+void
+generateMips(const uint32_t *rgba, uint32_t width, uint32_t height, std::vector<MipImage>& levels, MipFilter filter,
+    bool srgb, ThreadPool *pool, SimdKernel kernel) {
+    const MipKernel& mip_kernel = filter == MipFilterKaiser ? mip_tables.kaiser : mip_tables.box;
+    levels.resize(mipLevelCount(width, height) - 1);
+
+    std::vector<float> level((size_t)width * height * 4), horizontal, next;
+
+    forEachRow(height, pool, [&](uint32_t y) {
+        toLinear(rgba + (size_t)y * width, width, srgb, &level[(size_t)y * width * 4]);
+    });
+
+    for (MipImage& image : levels) {
+        image.width = std::max(width / 2, 1u);
+        image.height = std::max(height / 2, 1u);
+        image.texels.resize((size_t)image.width * image.height);
+        horizontal.resize((size_t)image.width * height * 4);
+        next.resize((size_t)image.width * image.height * 4);
+
+        forEachRow(height, pool, [&](uint32_t y) {
+            filterRow(&level[(size_t)y * width * 4], width, mip_kernel, &horizontal[(size_t)y * image.width * 4],
+                image.width, kernel);
+        });
+
+        forEachRow(image.height, pool, [&](uint32_t y) {
+            float *row = &next[(size_t)y * image.width * 4];
+            filterColumns(horizontal.data(), image.width, height, mip_kernel, y, row, kernel);
+
+            for (uint32_t x = 0; x < image.width; ++x) {
+                image.texels[(size_t)y * image.width + x] = fromLinear(row + x * 4, srgb);
+            }
+        });
+
+        level.swap(next);
+        width = image.width;
+        height = image.height;
+    }
+}
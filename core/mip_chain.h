@@ -0,0 +1,41 @@
+#pragma once
+
+#include "simd_kernel.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+enum MipFilter : uint8_t {
+    // The average of each 2x2 block: cheap, and a little blurry and aliased.
+    MipFilterBox,
+
+    // An 8-tap windowed sinc (Kaiser window, alpha 4) each way: sharper
+    // levels with less aliasing, for twice the reads.
+    MipFilterKaiser,
+};
+
+struct MipImage {
+    uint32_t width = 0, height = 0;
+    std::vector<uint32_t> texels;
+};
+
+// Levels of a full mip chain, down to 1x1.
+uint32_t mipLevelCount(uint32_t width, uint32_t height);
+
+// Every level below `rgba` down to 1x1, each half the size of the one
+// before, rounded down and at least 1, into `levels`. Filtering happens in
+// linear light on premultiplied alpha: with `srgb` the color channels are
+// taken as sRGB-encoded and converted back after, so a black and white
+// checkerboard averages to sRGB 188 rather than 128, and transparent texels
+// do not bleed their color into their neighbors. Each level is filtered
+// from the full-precision level above it, not from the rounded one. The
+// SIMD kernel keeps a texel's four channels in one vector and gives the
+// same levels as the scalar one, to within rounding of the last step when
+// the compiler fuses multiplies and adds differently. Rows are spread over
+// `pool`.
+void generateMips(const uint32_t *rgba, uint32_t width, uint32_t height, std::vector<MipImage>& levels,
+    MipFilter filter = MipFilterKaiser, bool srgb = true, ThreadPool *pool = nullptr,
+    SimdKernel kernel = SimdKernelVector);
@@ -0,0 +1,89 @@
+#include "occlusion_queries.h"
+
+#include <algorithm>
+
+OcclusionQueries::OcclusionQueries(size_t object_count, uint32_t slot_count, uint32_t requery_interval)
+    : d_slots(slot_count)
+    , d_requery_interval(std::max(requery_interval, 1u))
+    , d_visible(object_count, 1)
+    , d_pending(object_count, 0)
+    , d_query_frame(object_count, 0)
+    , d_seen(object_count, 0)
+    , d_entered(object_count, 0) {
+}
+
+void
+OcclusionQueries::beginFrame(uint64_t frame, const uint32_t *candidates, size_t count) {
+    d_draws.clear();
+    d_draw_queries.clear();
+    d_box_queries.clear();
+
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t object = candidates[i];
+
+        if (d_seen[object] != frame) {
+            d_visible[object] = 1;
+            d_entered[object] = frame;
+        }
+
+        d_seen[object] = frame + 1;
+
+        // A query is in flight; go by the last result until it lands.
+        if (d_pending[object]) {
+            if (d_visible[object]) {
+                d_draws.push_back(object);
+            }
+
+            continue;
+        }
+
+        bool requery = d_visible[object] == 0 || (frame + object) % d_requery_interval == 0;
+        uint32_t slot = requery ? d_slots.allocate() : SlotAllocator::invalid_slot;
+
+        if (slot == SlotAllocator::invalid_slot) {
+            d_draws.push_back(object);
+            continue;
+        }
+
+        d_pending[object] = 1;
+        d_query_frame[object] = frame;
+        (d_visible[object] ? d_draw_queries : d_box_queries).push_back(OcclusionQuery { object, slot });
+    }
+
+    if (!d_draw_queries.empty() || !d_box_queries.empty()) {
+        IssuedFrame issued { frame, d_draw_queries };
+        issued.queries.insert(issued.queries.end(), d_box_queries.begin(), d_box_queries.end());
+        d_issued.push_back(std::move(issued));
+    }
+}
+
+void
+OcclusionQueries::resolve(uint64_t frame, const uint64_t *results) {
+    auto issued = std::find_if(d_issued.begin(), d_issued.end(), [frame](const IssuedFrame& issued) {
+        return issued.frame == frame;
+    });
+
+    if (issued == d_issued.end()) {
+        return;
+    }
+
+    for (const OcclusionQuery& query : issued->queries) {
+        // Back in view since the query was issued: it already counts as
+        // visible, and the result no longer says anything.
+        if (d_entered[query.object] <= d_query_frame[query.object]) {
+            d_visible[query.object] = results[query.slot] != 0;
+        }
+
+        d_pending[query.object] = 0;
+        d_slots.free(query.slot);
+    }
+
+    d_issued.erase(issued);
+}
+
+bool
+OcclusionQueries::isPending(uint64_t frame) const {
+    return std::any_of(d_issued.begin(), d_issued.end(), [frame](const IssuedFrame& issued) {
+        return issued.frame == frame;
+    });
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "handle_table.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// A query to issue this frame: the visibility result of drawing `object`
+// goes to `slot` of the result buffer.
+struct OcclusionQuery {
+    uint32_t object;
+    uint32_t slot;
+};
+
+// Bookkeeping for GPU occlusion queries whose results come back frames
+// after they were issued, so that reading them never waits on the GPU.
+// Each frame, the objects that passed the other tests are split by their
+// last known result: visible objects are drawn, and every few frames one
+// is drawn in a query of its own to find out whether it has become hidden;
+// hidden objects are not drawn, but their bounding boxes are, in queries
+// that tell whether they have come back. An object has at most one query
+// in flight, and keeps its last result until that query is resolved.
+// Objects that were not candidates the frame before count as visible, since
+// whatever hid them may have moved. Slots come from a fixed pool; when it
+// runs out, hidden objects are drawn rather than left unqueried.
+class OcclusionQueries {
+public:
+
+    // `requery_interval` is how many frames apart visible objects are
+    // queried, staggered by object.
+    OcclusionQueries(size_t object_count, uint32_t slot_count, uint32_t requery_interval = 8);
+
+    // Splits `candidates` for `frame`, which must come after every frame
+    // begun before it.
+    void beginFrame(uint64_t frame, const uint32_t *candidates, size_t count);
+
+    // Visible objects to draw without a query.
+    const std::vector<uint32_t>& draws() const {
+        return d_draws;
+    }
+
+    // Visible objects to draw, each counted into its slot.
+    const std::vector<OcclusionQuery>& drawQueries() const {
+        return d_draw_queries;
+    }
+
+    // Hidden objects whose bounding boxes to draw, without writing color or
+    // depth, each counted into its slot.
+    const std::vector<OcclusionQuery>& boxQueries() const {
+        return d_box_queries;
+    }
+
+    // Takes the results of `frame` once the GPU has finished it: `results`
+    // is the result buffer, indexed by slot, nonzero where any sample
+    // passed. Frames can be resolved in any order, and frames without
+    // queries need not be.
+    void resolve(uint64_t frame, const uint64_t *results);
+
+    // Whether `frame` issued queries that are not resolved yet.
+    bool isPending(uint64_t frame) const;
+
+    bool isVisible(uint32_t object) const {
+        return d_visible[object] != 0;
+    }
+
+    uint32_t slotsInUse() const {
+        return d_slots.size();
+    }
+
+    size_t pendingFrames() const {
+        return d_issued.size();
+    }
+
+private:
+
+    struct IssuedFrame {
+        uint64_t frame;
+        std::vector<OcclusionQuery> queries;
+    };
+
+    SlotAllocator d_slots;
+    uint32_t d_requery_interval;
+
+    // Per object: the last result, whether a query is in flight, the frame
+    // it was issued in, and one past the last frame it was a candidate.
+    std::vector<uint8_t> d_visible;
+    std::vector<uint8_t> d_pending;
+    std::vector<uint64_t> d_query_frame;
+    std::vector<uint64_t> d_seen;
+
+    // The frame it last became a candidate again; results of queries from
+    // before then are stale.
+    std::vector<uint64_t> d_entered;
+
+    std::vector<uint32_t> d_draws;
+    std::vector<OcclusionQuery> d_draw_queries;
+    std::vector<OcclusionQuery> d_box_queries;
+
+    std::deque<IssuedFrame> d_issued;
+};
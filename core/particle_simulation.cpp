@@ -0,0 +1,144 @@
+#include "particle_simulation.h"
+#include "thread_pool.h"
+#include "vec4.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Particles per pool task; large enough to amortize scheduling.
+const size_t particle_grain = 16384;
+
+void
+respawn(const ParticleArrays& particles, const ParticleSimParams& params, const ParticleEmitter *emitters, uint32_t i) {
+    const ParticleEmitter& emitter = emitters[i % params.emitterCount];
+
+    uint32_t h = particleHash(i ^ particleHash(params.frame));
+    float rx = particleRandom(h), ry = particleRandom(particleHash(h));
+
+    particles.position_x[i] = emitter.positionX;
+    particles.position_y[i] = emitter.positionY;
+    particles.velocity_x[i] = emitter.velocityX + (rx - 0.5f) * emitter.spread;
+    particles.velocity_y[i] = emitter.velocityY + (ry - 0.5f) * emitter.spread;
+    particles.age[i] = 0.0f;
+}
+
+// Maps a float's bits onto a line where adjacent floats differ by one.
+int64_t
+orderedBits(float f) {
+    int32_t bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    return bits < 0 ? -(int64_t)(bits & 0x7fffffff) : (int64_t)bits;
+}
+
+}
+
+void
+initializeParticles(const ParticleArrays& particles, const ParticleSimParams& params, const ParticleEmitter *emitters) {
+    for (uint32_t i = 0; i < params.count; ++i) {
+        respawn(particles, params, emitters, i);
+        particles.age[i] = particleRandom(particleHash(~i)) * params.lifetime;
+    }
+}
+
+void
+simulateParticlesScalar(const ParticleArrays& particles, const ParticleSimParams& params, const ParticleEmitter *emitters, size_t begin, size_t end) {
+    float dt = params.dt;
+
+    for (size_t i = begin; i < end; ++i) {
+        float age = particles.age[i] + dt;
+
+        if (age >= params.lifetime) {
+            respawn(particles, params, emitters, (uint32_t)i);
+            continue;
+        }
+
+        float vx = (particles.velocity_x[i] + params.gravityX * dt) * params.damping;
+        float vy = (particles.velocity_y[i] + params.gravityY * dt) * params.damping;
+        float px = particles.position_x[i] + vx * dt;
+        float py = particles.position_y[i] + vy * dt;
+
+        if (px < -params.boundsX || px > params.boundsX) {
+            vx = -vx * params.restitution;
+            px = std::min(std::max(px, -params.boundsX), params.boundsX);
+        }
+
+        if (py < -params.boundsY || py > params.boundsY) {
+            vy = -vy * params.restitution;
+            py = std::min(std::max(py, -params.boundsY), params.boundsY);
+        }
+
+        particles.position_x[i] = px;
+        particles.position_y[i] = py;
+        particles.velocity_x[i] = vx;
+        particles.velocity_y[i] = vy;
+        particles.age[i] = age;
+    }
+}
+
+void
+simulateParticlesVector(const ParticleArrays& particles, const ParticleSimParams& params, const ParticleEmitter *emitters, size_t begin, size_t end) {
+    const Vec4f dt = Vec4f::broadcast(params.dt);
+    const Vec4f gravity_x = Vec4f::broadcast(params.gravityX), gravity_y = Vec4f::broadcast(params.gravityY);
+    const Vec4f damping = Vec4f::broadcast(params.damping);
+    const Vec4f restitution = Vec4f::broadcast(params.restitution);
+    const Vec4f max_x = Vec4f::broadcast(params.boundsX), min_x = Vec4f::broadcast(-params.boundsX);
+    const Vec4f max_y = Vec4f::broadcast(params.boundsY), min_y = Vec4f::broadcast(-params.boundsY);
+    const Vec4f lifetime = Vec4f::broadcast(params.lifetime);
+
+    size_t i = begin;
+
+    for (; i + 4 <= end; i += 4) {
+        Vec4f age = Vec4f::load(particles.age + i) + dt;
+
+        Vec4f vx = (Vec4f::load(particles.velocity_x + i) + gravity_x * dt) * damping;
+        Vec4f vy = (Vec4f::load(particles.velocity_y + i) + gravity_y * dt) * damping;
+        Vec4f px = Vec4f::load(particles.position_x + i) + vx * dt;
+        Vec4f py = Vec4f::load(particles.position_y + i) + vy * dt;
+
+        Mask4 out_x = (px < min_x) | (px > max_x);
+        vx = select(out_x, -vx * restitution, vx);
+        px = min(max(px, min_x), max_x);
+
+        Mask4 out_y = (py < min_y) | (py > max_y);
+        vy = select(out_y, -vy * restitution, vy);
+        py = min(max(py, min_y), max_y);
+
+        px.store(particles.position_x + i);
+        py.store(particles.position_y + i);
+        vx.store(particles.velocity_x + i);
+        vy.store(particles.velocity_y + i);
+        age.store(particles.age + i);
+
+        // Expired particles are rare; overwrite them after the fact.
+        int expired = (age >= lifetime).bits();
+
+        while (expired) {
+            int lane = __builtin_ctz(expired);
+            respawn(particles, params, emitters, (uint32_t)(i + lane));
+            expired &= expired - 1;
+        }
+    }
+
+    simulateParticlesScalar(particles, params, emitters, i, end);
+}
+
+void
+simulateParticles(const ParticleArrays& particles, const ParticleSimParams& params, const ParticleEmitter *emitters, ThreadPool& pool) {
+    pool.parallelFor(params.count, particle_grain, [&](size_t begin, size_t end) {
+        simulateParticlesVector(particles, params, emitters, begin, end);
+    });
+}
+
+uint32_t
+maxUlpDifference(const float *a, const float *b, size_t count) {
+    int64_t result = 0;
+
+    for (size_t i = 0; i < count; ++i) {
+        int64_t difference = orderedBits(a[i]) - orderedBits(b[i]);
+        result = std::max(result, difference < 0 ? -difference : difference);
+    }
+
+    return (uint32_t)std::min<int64_t>(result, UINT32_MAX);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "particle_types.h"
+
+#include <cstddef>
+#include <cstdint>
+
+class ThreadPool;
+
+// Structure-of-arrays particle state. The arrays are not owned, so they can
+// point straight into shared GPU buffers.
+struct ParticleArrays {
+    float *position_x;
+    float *position_y;
+    float *velocity_x;
+    float *velocity_y;
+    float *age;
+};
+
+// Spreads `params.count` particles over their emitters with staggered ages so
+// they do not all respawn on the same frame.
+void initializeParticles(const ParticleArrays& particles, const ParticleSimParams& params, const ParticleEmitter *emitters);
+
+// One step for particles [begin, end), one at a time. This is the reference
+// the vectorized path and the `simulateParticles` compute kernel follow.
+void simulateParticlesScalar(const ParticleArrays& particles, const ParticleSimParams& params, const ParticleEmitter *emitters, size_t begin, size_t end);
+
+// Same as above, four particles per iteration.
+void simulateParticlesVector(const ParticleArrays& particles, const ParticleSimParams& params, const ParticleEmitter *emitters, size_t begin, size_t end);
+
+// Vectorized step for all particles, split across the pool.
+void simulateParticles(const ParticleArrays& particles, const ParticleSimParams& params, const ParticleEmitter *emitters, ThreadPool& pool);
+
+// Largest distance in units in the last place between matching elements;
+// +0 and -0 compare equal. Used to check the CPU and GPU paths agree.
+uint32_t maxUlpDifference(const float *a, const float *b, size_t count);
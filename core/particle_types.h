@@ -0,0 +1,77 @@
+/*
+Header containing types, enum constants and helpers shared between the
+particle shaders and C++ code, including the CPU simulation
+*/
+
+#ifndef particle_types_H
+#define particle_types_H
+
+#ifndef __METAL_VERSION__
+#include <stdint.h>
+#endif
+
+// Buffer index values for the simulation kernel and the particle vertex shader.
+typedef enum ParticleInputIndex
+{
+    ParticleInputIndexPositionX    = 0,
+    ParticleInputIndexPositionY    = 1,
+    ParticleInputIndexVelocityX    = 2,
+    ParticleInputIndexVelocityY    = 3,
+    ParticleInputIndexAge          = 4,
+    ParticleInputIndexParams       = 5,
+    ParticleInputIndexEmitters     = 6,
+    ParticleInputIndexViewportSize = 7,
+} ParticleInputIndex;
+
+typedef struct
+{
+    float dt;
+    float gravityX, gravityY;
+
+    // Velocity multiplier applied every step, i.e. 1 - drag * dt.
+    float damping;
+
+    // Particles bounce off the box [-boundsX, boundsX] x [-boundsY, boundsY],
+    // in the same pixel space as AAPLVertex positions.
+    float boundsX, boundsY;
+    float restitution;
+
+    // Age in seconds at which a particle respawns at its emitter.
+    float lifetime;
+
+    uint32_t count;
+    uint32_t emitterCount;
+
+    // Frame number, mixed into the respawn random numbers.
+    uint32_t frame;
+} ParticleSimParams;
+
+// Particle `i` belongs to emitter `i % emitterCount`.
+typedef struct
+{
+    float positionX, positionY;
+    float velocityX, velocityY;
+
+    // Width of the uniform random spread added to the velocity on respawn.
+    float spread;
+} ParticleEmitter;
+
+// Integer hash used for respawn randomness. Integer-only, so the CPU and the
+// GPU produce identical values.
+static inline uint32_t particleHash(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// Uniform float in [0, 1) built from the top 24 bits of `h`; exact on both sides.
+static inline float particleRandom(uint32_t h)
+{
+    return (float)(h >> 8) * (1.0f / 16777216.0f);
+}
+
+#endif /* particle_types_H */
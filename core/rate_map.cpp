@@ -0,0 +1,167 @@
+#include "rate_map.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+float
+quantizeRate(float importance, const RateMapOptions& options) {
+    float t = std::min(std::max(importance, 0.0f), 1.0f);
+
+    if (options.levels > 1) {
+        float steps = (float)(options.levels - 1);
+        t = std::ceil(t * steps) / steps;
+    }
+
+    return options.min_rate + (1.0f - options.min_rate) * t;
+}
+
+// Rec. 709 luma of an RGBA8 pixel, in [0, 1].
+double
+luma709(const uint8_t *pixel) {
+    return (0.2126 * pixel[0] + 0.7152 * pixel[1] + 0.0722 * pixel[2]) / 255.0;
+}
+
+// Rate of the column (or row) that covers pixel `p` out of `extent`.
+float
+rateAt(const std::vector<float>& rates, uint32_t p, uint32_t extent) {
+    size_t i = (size_t)p * rates.size() / extent;
+    return rates[std::min(i, rates.size() - 1)];
+}
+
+}
+
+ImportanceGrid
+luminanceVarianceImportance(const uint8_t *rgba, uint32_t width, uint32_t height, size_t row_bytes, uint32_t tile_size) {
+    ImportanceGrid grid;
+    grid.width = (width + tile_size - 1) / tile_size;
+    grid.height = (height + tile_size - 1) / tile_size;
+    grid.values.assign((size_t)grid.width * grid.height, 0.0f);
+
+    float max_deviation = 0.0f;
+
+    for (uint32_t ty = 0; ty < grid.height; ++ty) {
+        for (uint32_t tx = 0; tx < grid.width; ++tx) {
+            uint32_t x0 = tx * tile_size, x1 = std::min(x0 + tile_size, width);
+            uint32_t y0 = ty * tile_size, y1 = std::min(y0 + tile_size, height);
+
+            // Sums are taken relative to the tile's first pixel, so a flat
+            // tile comes out at exactly zero rather than at rounding noise,
+            // which normalization would blow up to full importance.
+            const uint8_t *first = rgba + y0 * row_bytes + x0 * 4;
+            double shift = luma709(first);
+            double sum = 0.0, sum_squares = 0.0;
+
+            for (uint32_t y = y0; y < y1; ++y) {
+                const uint8_t *pixel = rgba + y * row_bytes + x0 * 4;
+
+                for (uint32_t x = x0; x < x1; ++x, pixel += 4) {
+                    double luma = luma709(pixel) - shift;
+                    sum += luma;
+                    sum_squares += luma * luma;
+                }
+            }
+
+            double count = (double)(x1 - x0) * (y1 - y0);
+            double mean = sum / count;
+            float deviation = (float)std::sqrt(std::max(sum_squares / count - mean * mean, 0.0));
+
+            grid.values[ty * grid.width + tx] = deviation;
+            max_deviation = std::max(max_deviation, deviation);
+        }
+    }
+
+    if (max_deviation > 0.0f) {
+        for (auto& value : grid.values) {
+            value /= max_deviation;
+        }
+    }
+
+    return grid;
+}
+
+ImportanceGrid
+foveatedImportance(uint32_t grid_width, uint32_t grid_height, float center_x, float center_y, float radius) {
+    ImportanceGrid grid;
+    grid.width = grid_width;
+    grid.height = grid_height;
+    grid.values.resize((size_t)grid_width * grid_height);
+
+    for (uint32_t y = 0; y < grid_height; ++y) {
+        for (uint32_t x = 0; x < grid_width; ++x) {
+            float dx = (x + 0.5f) - center_x, dy = (y + 0.5f) - center_y;
+            float distance = std::sqrt(dx * dx + dy * dy);
+            grid.values[y * grid_width + x] = std::max(1.0f - distance / radius, 0.0f);
+        }
+    }
+
+    return grid;
+}
+
+RateMapLayer
+buildRateMapLayer(const ImportanceGrid& grid, const RateMapOptions& options) {
+    std::vector<float> column_importance(grid.width, 0.0f), row_importance(grid.height, 0.0f);
+
+    for (uint32_t y = 0; y < grid.height; ++y) {
+        for (uint32_t x = 0; x < grid.width; ++x) {
+            float importance = grid.at(x, y);
+            column_importance[x] = std::max(column_importance[x], importance);
+            row_importance[y] = std::max(row_importance[y], importance);
+        }
+    }
+
+    RateMapLayer layer;
+    layer.horizontal.reserve(grid.width);
+    layer.vertical.reserve(grid.height);
+
+    for (float importance : column_importance) {
+        layer.horizontal.push_back(quantizeRate(importance, options));
+    }
+
+    for (float importance : row_importance) {
+        layer.vertical.push_back(quantizeRate(importance, options));
+    }
+
+    return layer;
+}
+
+void
+rateMapPhysicalSize(const RateMapLayer& layer, uint32_t screen_width, uint32_t screen_height, uint32_t *physical_width, uint32_t *physical_height) {
+    auto scaled = [](const std::vector<float>& rates, uint32_t extent) -> uint32_t {
+        if (rates.empty()) {
+            return extent;
+        }
+
+        double total = 0.0;
+
+        for (float rate : rates) {
+            total += rate;
+        }
+
+        return (uint32_t)std::ceil(total / rates.size() * extent);
+    };
+
+    *physical_width = scaled(layer.horizontal, screen_width);
+    *physical_height = scaled(layer.vertical, screen_height);
+}
+
+std::vector<uint8_t>
+previewRateMap(const RateMapLayer& layer, uint32_t width, uint32_t height) {
+    std::vector<uint8_t> pixels((size_t)width * height, 255);
+
+    if (layer.horizontal.empty() || layer.vertical.empty()) {
+        return pixels;
+    }
+
+    for (uint32_t y = 0; y < height; ++y) {
+        float vertical = rateAt(layer.vertical, y, height);
+
+        for (uint32_t x = 0; x < width; ++x) {
+            float rate = rateAt(layer.horizontal, x, width) * vertical;
+            pixels[(size_t)y * width + x] = (uint8_t)std::lround(rate * 255.0f);
+        }
+    }
+
+    return pixels;
+}
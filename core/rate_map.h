@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Per-tile shading importance in [0, 1], stored row-major.
+struct ImportanceGrid {
+    uint32_t width = 0, height = 0;
+    std::vector<float> values;
+
+    float at(uint32_t x, uint32_t y) const {
+        return values[y * width + x];
+    }
+};
+
+// Separable shading rates in (0, 1], one per tile column and one per tile row.
+// This is the form `MTL::RasterizationRateLayerDescriptor` takes: the rate of a
+// tile is effectively `horizontal[x] * vertical[y]`.
+struct RateMapLayer {
+    std::vector<float> horizontal, vertical;
+};
+
+struct RateMapOptions {
+    // Lowest rate handed to Metal; 0.25 means at most 4x fewer samples per axis.
+    float min_rate = 0.25f;
+
+    // Number of distinct rates between `min_rate` and 1, inclusive. Quantizing
+    // keeps the map stable when importance jitters from frame to frame.
+    uint32_t levels = 4;
+};
+
+// Importance from the luminance standard deviation of each `tile_size` square
+// of an RGBA8 image, normalized so the busiest tile is 1.
+ImportanceGrid luminanceVarianceImportance(const uint8_t *rgba, uint32_t width, uint32_t height, size_t row_bytes, uint32_t tile_size);
+
+// Importance falling off linearly from 1 at the center (in tile units) to 0 at
+// `radius` tiles away.
+ImportanceGrid foveatedImportance(uint32_t grid_width, uint32_t grid_height, float center_x, float center_y, float radius);
+
+// Maps a tile grid onto separable rates. Each column (row) takes the rate of
+// its most important tile so no tile is shaded below what it asked for.
+RateMapLayer buildRateMapLayer(const ImportanceGrid& grid, const RateMapOptions& options = RateMapOptions());
+
+// Size of the render target Metal needs for `layer` at the given screen size.
+void rateMapPhysicalSize(const RateMapLayer& layer, uint32_t screen_width, uint32_t screen_height, uint32_t *physical_width, uint32_t *physical_height);
+
+// Grayscale image of the effective shading rate (255 = full rate) at screen size.
+std::vector<uint8_t> previewRateMap(const RateMapLayer& layer, uint32_t width, uint32_t height);
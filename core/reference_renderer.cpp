@@ -0,0 +1,272 @@
+#include "reference_renderer.h"
+#include "visibility_types.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Matches AAPLVertexInputIndex.
+const uint32_t vertices_index = 0;
+const uint32_t viewport_size_index = 1;
+
+// MTL::PrimitiveTypeTriangle.
+const uint32_t primitive_type_triangle = 3;
+
+uint32_t
+packColor(const float color[4]) {
+    uint32_t result = 0;
+
+    for (int i = 0; i < 4; ++i) {
+        float c = std::min(std::max(color[i], 0.0f), 1.0f);
+        result |= (uint32_t)std::lround(c * 255.0f) << (i * 8);
+    }
+
+    return result;
+}
+
+}
+
+ReferenceRenderer::ReferenceRenderer(uint32_t width, uint32_t height, ReferenceShading shading, uint32_t sample_count)
+    : d_width(width)
+    , d_height(height)
+    , d_shading(shading)
+    , d_pixels((size_t)width * height)
+    , d_sample_count(shading == ReferenceShadingForward && sample_count == 4 ? 4 : 1) {
+    d_viewport = { 0.0f, 0.0f, (float)width, (float)height, 0.0f, 1.0f };
+
+    if (shading == ReferenceShadingVisibilityBuffer) {
+        d_visibility.resize(d_pixels.size());
+    }
+
+    if (d_sample_count > 1) {
+        d_samples.resize(d_pixels.size() * d_sample_count);
+    }
+}
+
+void
+ReferenceRenderer::beginFrame(uint64_t) {
+    // Same as the render pass: clear to opaque black.
+    std::fill(d_pixels.begin(), d_pixels.end(), 0xff000000u);
+    std::fill(d_samples.begin(), d_samples.end(), 0xff000000u);
+    std::fill(d_visibility.begin(), d_visibility.end(), VISIBILITY_EMPTY);
+
+    d_frame_triangles.clear();
+    d_instance_first.clear();
+}
+
+void
+ReferenceRenderer::endFrame() {
+    if (d_sample_count > 1) {
+        // StoreActionMultisampleResolve: the average of each pixel's samples,
+        // per channel, rounded to nearest.
+        for (size_t pixel = 0; pixel < d_pixels.size(); ++pixel) {
+            const uint32_t *samples = &d_samples[pixel * d_sample_count];
+            uint32_t result = 0;
+
+            for (int channel = 0; channel < 4; ++channel) {
+                uint32_t sum = 0;
+
+                for (uint32_t s = 0; s < d_sample_count; ++s) {
+                    sum += (samples[s] >> (channel * 8)) & 0xff;
+                }
+
+                result |= ((sum + d_sample_count / 2) / d_sample_count) << (channel * 8);
+            }
+
+            d_pixels[pixel] = result;
+        }
+    }
+
+    if (d_shading != ReferenceShadingVisibilityBuffer) {
+        return;
+    }
+
+    // The shading pass: one invocation per covered pixel, whatever the
+    // overdraw was.
+    for (uint32_t y = 0; y < d_height; ++y) {
+        for (uint32_t x = 0; x < d_width; ++x) {
+            size_t pixel = (size_t)y * d_width + x;
+            uint32_t id = d_visibility[pixel];
+
+            if (id == VISIBILITY_EMPTY) {
+                continue;
+            }
+
+            const Triangle& triangle = d_frame_triangles[d_instance_first[visibilityInstance(id)] + visibilityPrimitive(id)];
+
+            // A zero-area triangle has no barycentrics; leave the clear color.
+            float b0, b1, b2;
+
+            if (!barycentricsAt(triangle.points[0], triangle.points[1], triangle.points[2], x + 0.5f, y + 0.5f,
+                    &b0, &b1, &b2)) {
+                continue;
+            }
+
+            d_pixels[pixel] = shade(triangle, b0, b1, b2);
+            ++d_fragments;
+        }
+    }
+}
+
+void
+ReferenceRenderer::definePipeline(uint32_t id, const std::string& name) {
+    if (d_pipeline_supported.size() <= id) {
+        d_pipeline_supported.resize(id + 1, false);
+    }
+
+    d_pipeline_supported[id] = name == "triangle";
+}
+
+void
+ReferenceRenderer::setRenderPipelineState(uint32_t id) {
+    d_supported = id < d_pipeline_supported.size() && d_pipeline_supported[id];
+}
+
+void
+ReferenceRenderer::setVertexBytes(const void *bytes, size_t length, uint32_t index) {
+    d_vertex_bytes[index].assign((const uint8_t *)bytes, (const uint8_t *)bytes + length);
+}
+
+void
+ReferenceRenderer::setViewport(const LoggedViewport& viewport) {
+    d_viewport = viewport;
+}
+
+void
+ReferenceRenderer::drawPrimitives(uint32_t primitive_type, uint64_t vertex_start, uint64_t vertex_count, uint64_t instance_count) {
+    const auto& vertex_bytes = d_vertex_bytes[vertices_index];
+    const auto& viewport_bytes = d_vertex_bytes[viewport_size_index];
+
+    uint64_t available = vertex_bytes.size() / sizeof(ReferenceVertex);
+
+    if (!d_supported || primitive_type != primitive_type_triangle ||
+        viewport_bytes.size() < 2 * sizeof(uint32_t) || vertex_start + vertex_count > available) {
+        ++d_skipped;
+        return;
+    }
+
+    uint32_t viewport_size[2];
+    std::memcpy(viewport_size, viewport_bytes.data(), sizeof(viewport_size));
+
+    // vertexShader: pixel-space position divided by half the viewport size.
+    float half_width = viewport_size[0] / 2.0f, half_height = viewport_size[1] / 2.0f;
+
+    std::vector<ReferenceVertex> vertices(vertex_count);
+    std::vector<Triangle> triangles(vertex_count / 3);
+
+    std::memcpy(vertices.data(), vertex_bytes.data() + vertex_start * sizeof(ReferenceVertex), vertex_count * sizeof(ReferenceVertex));
+
+    for (uint64_t i = 0; i < triangles.size() * 3; ++i) {
+        float ndc_x = vertices[i].position[0] / half_width;
+        float ndc_y = vertices[i].position[1] / half_height;
+
+        Triangle& triangle = triangles[i / 3];
+
+        triangle.points[i % 3].x = d_viewport.origin_x + (ndc_x * 0.5f + 0.5f) * d_viewport.width;
+        triangle.points[i % 3].y = d_viewport.origin_y + (0.5f - ndc_y * 0.5f) * d_viewport.height;
+        std::memcpy(triangle.colors[i % 3], vertices[i].color, sizeof(triangle.colors[0]));
+    }
+
+    if (d_shading == ReferenceShadingForward && d_sample_count > 1) {
+        for (uint64_t instance = 0; instance < instance_count; ++instance) {
+            for (const Triangle& triangle : triangles) {
+                rasterizeTriangleMultisample(triangle.points[0], triangle.points[1], triangle.points[2], d_width, d_height,
+                    standard_sample_positions_4x, d_sample_count,
+                    [&](uint32_t x, uint32_t y, uint32_t mask, float b0, float b1, float b2) {
+                        uint32_t color = shade(triangle, b0, b1, b2);
+                        uint32_t *samples = &d_samples[((size_t)y * d_width + x) * d_sample_count];
+
+                        for (uint32_t s = 0; s < d_sample_count; ++s) {
+                            if (mask & (1u << s)) {
+                                samples[s] = color;
+                                ++d_samples_covered;
+                            }
+                        }
+
+                        ++d_rasterized;
+                        ++d_fragments;
+                    });
+
+                ++d_triangles;
+            }
+        }
+
+        return;
+    }
+
+    if (d_shading == ReferenceShadingForward) {
+        for (uint64_t instance = 0; instance < instance_count; ++instance) {
+            for (const Triangle& triangle : triangles) {
+                rasterizeTriangle(triangle.points[0], triangle.points[1], triangle.points[2], d_width, d_height,
+                    [&](uint32_t x, uint32_t y, float b0, float b1, float b2) {
+                        d_pixels[(size_t)y * d_width + x] = shade(triangle, b0, b1, b2);
+                        ++d_rasterized;
+                        ++d_fragments;
+                        ++d_samples_covered;
+                    });
+
+                ++d_triangles;
+            }
+        }
+
+        return;
+    }
+
+    if (d_instance_first.size() + instance_count > VISIBILITY_MAX_INSTANCES || triangles.size() > VISIBILITY_MAX_PRIMITIVES) {
+        ++d_skipped;
+        return;
+    }
+
+    // Every instance of a draw fetches the same vertices, so they share one
+    // copy of the triangles.
+    uint32_t first = (uint32_t)d_frame_triangles.size();
+    d_frame_triangles.insert(d_frame_triangles.end(), triangles.begin(), triangles.end());
+
+    for (uint64_t instance = 0; instance < instance_count; ++instance) {
+        uint32_t instance_id = (uint32_t)d_instance_first.size();
+        d_instance_first.push_back(first);
+
+        for (uint32_t primitive = 0; primitive < triangles.size(); ++primitive) {
+            const Triangle& triangle = triangles[primitive];
+            uint32_t id = visibilityPack(instance_id, primitive);
+
+            // The geometry pass: no shading, the last ID written wins just as
+            // the last color does in forward mode.
+            rasterizeTriangle(triangle.points[0], triangle.points[1], triangle.points[2], d_width, d_height,
+                [&](uint32_t x, uint32_t y, float, float, float) {
+                    d_visibility[(size_t)y * d_width + x] = id;
+                    ++d_rasterized;
+                    ++d_samples_covered;
+                });
+
+            ++d_triangles;
+        }
+    }
+}
+
+uint32_t
+ReferenceRenderer::shade(const Triangle& triangle, float b0, float b1, float b2) const {
+    // fragmentShader: the interpolated color.
+    float color[4];
+
+    for (int k = 0; k < 4; ++k) {
+        color[k] = triangle.colors[0][k] * b0 + triangle.colors[1][k] * b1 + triangle.colors[2][k] * b2;
+    }
+
+    if (d_shading_work > 0) {
+        // A dependent chain on a per-fragment value that the compiler cannot
+        // fold or hoist. sqrt(t * t) == t in IEEE arithmetic, so the color is
+        // unchanged.
+        float t = b0;
+
+        for (uint32_t i = 0; i < d_shading_work; ++i) {
+            t = std::sqrt(t * t);
+        }
+
+        color[0] += t - b0;
+    }
+
+    return packColor(color);
+}
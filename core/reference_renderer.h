@@ -0,0 +1,138 @@
+#pragma once
+
+#include "command_log.h"
+#include "software_rasterizer.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Layout-compatible with AAPLVertex in triangle_types.h: a vector_float2
+// position followed by a 16-byte aligned vector_float4 color.
+struct ReferenceVertex {
+    float position[2];
+    float padding[2];
+    float color[4];
+};
+
+static_assert(sizeof(ReferenceVertex) == 32, "ReferenceVertex must match AAPLVertex");
+
+enum ReferenceShading {
+    // Shade every fragment as it is rasterized, like the triangle pipeline.
+    ReferenceShadingForward,
+
+    // Two phases, like the --visibility-buffer mode of the app: draws only
+    // write a packed (instance, primitive) ID per pixel, and endFrame() shades
+    // each covered pixel once from the stored triangle.
+    ReferenceShadingVisibilityBuffer,
+};
+
+// Software implementation of the "triangle" pipeline (vertexShader and
+// fragmentShader in triangle.metal), driven by replayed commands. Draws with
+// any other pipeline are counted and skipped.
+//
+// With a `sample_count` of 4, forward shading renders like the app's --msaa
+// mode: coverage at Metal's standard sample positions, one shader invocation
+// per pixel, and a box-filter resolve at endFrame(). The visibility buffer
+// is single-sampled and ignores `sample_count`.
+class ReferenceRenderer : public CommandSink {
+public:
+
+    ReferenceRenderer(uint32_t width, uint32_t height, ReferenceShading shading = ReferenceShadingForward, uint32_t sample_count = 1);
+
+    void beginFrame(uint64_t frame) override;
+    void endFrame() override;
+    void definePipeline(uint32_t id, const std::string& name) override;
+    void setRenderPipelineState(uint32_t id) override;
+    void setVertexBytes(const void *bytes, size_t length, uint32_t index) override;
+    void setViewport(const LoggedViewport& viewport) override;
+    void drawPrimitives(uint32_t primitive_type, uint64_t vertex_start, uint64_t vertex_count, uint64_t instance_count) override;
+
+    // RGBA8, row-major, `width` pixels per row.
+    const std::vector<uint32_t>& pixels() const {
+        return d_pixels;
+    }
+
+    // Packed IDs from the last visibility buffer frame, VISIBILITY_EMPTY where
+    // nothing was drawn. Empty in forward mode.
+    const std::vector<uint32_t>& visibility() const {
+        return d_visibility;
+    }
+
+    // Extra arithmetic per shaded fragment, standing in for a material more
+    // expensive than the interpolated color so shading cost can be weighed
+    // against overdraw.
+    void setShadingWork(uint32_t iterations) {
+        d_shading_work = iterations;
+    }
+
+    uint32_t sampleCount() const {
+        return d_sample_count;
+    }
+
+    uint32_t width() const {
+        return d_width;
+    }
+
+    uint32_t height() const {
+        return d_height;
+    }
+
+    uint64_t trianglesDrawn() const {
+        return d_triangles;
+    }
+
+    // Pixels that passed coverage, counting overdraw.
+    uint64_t fragmentsRasterized() const {
+        return d_rasterized;
+    }
+
+    // Fragment shader invocations; equal to fragmentsRasterized() in forward
+    // mode, at most one per pixel per frame with a visibility buffer.
+    uint64_t fragmentsShaded() const {
+        return d_fragments;
+    }
+
+    // Samples written; equal to fragmentsRasterized() without multisampling.
+    uint64_t samplesCovered() const {
+        return d_samples_covered;
+    }
+
+    uint64_t drawsSkipped() const {
+        return d_skipped;
+    }
+
+private:
+
+    // Everything needed to shade a triangle after rasterization.
+    struct Triangle {
+        RasterPoint points[3];
+        float colors[3][4];
+    };
+
+    uint32_t shade(const Triangle& triangle, float b0, float b1, float b2) const;
+
+    uint32_t d_width, d_height;
+    ReferenceShading d_shading;
+    uint32_t d_shading_work = 0;
+    std::vector<uint32_t> d_pixels;
+
+    // Multisampled color, `d_sample_count` consecutive samples per pixel;
+    // empty when single-sampled.
+    uint32_t d_sample_count;
+    std::vector<uint32_t> d_samples;
+
+    // Visibility buffer state for the current frame: instance `i` owns the
+    // triangles starting at `d_instance_first[i]`.
+    std::vector<uint32_t> d_visibility;
+    std::vector<Triangle> d_frame_triangles;
+    std::vector<uint32_t> d_instance_first;
+
+    std::vector<bool> d_pipeline_supported;
+    bool d_supported = false;
+
+    std::vector<uint8_t> d_vertex_bytes[command_log_max_buffer_index];
+    LoggedViewport d_viewport;
+
+    uint64_t d_triangles = 0, d_rasterized = 0, d_fragments = 0, d_samples_covered = 0, d_skipped = 0;
+};
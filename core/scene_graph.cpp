@@ -0,0 +1,440 @@
+#include "scene_graph.h"
+#include "thread_pool.h"
+#include "vec4.h"
+
+#include <algorithm>
+
+namespace {
+
+// Nodes per parallel task.
+const size_t update_grain = 1024;
+
+float *
+columnsOf(SceneMatrix& matrix) {
+    return reinterpret_cast<float *>(&matrix);
+}
+
+template <typename T>
+void
+permute(std::vector<T>& values, const std::vector<uint32_t>& order) {
+    std::vector<T> sorted(values.size());
+
+    for (size_t i = 0; i < order.size(); ++i) {
+        sorted[i] = values[order[i]];
+    }
+
+    values.swap(sorted);
+}
+
+}
+
+SceneNode
+SceneGraph::addNode(SceneNode parent, const SceneTransform& local) {
+    SceneNode node = (SceneNode)d_node_of.size();
+    uint32_t index = (uint32_t)d_parent.size();
+
+    uint32_t parent_index = parent == scene_no_parent ? scene_no_parent : d_index_of[parent];
+
+    d_parent.push_back(parent_index);
+    d_depth.push_back(parent == scene_no_parent ? 0 : d_depth[parent_index] + 1);
+    d_first_child.push_back(0);
+    d_child_count.push_back(0);
+
+    for (int i = 0; i < 3; ++i) {
+        d_position[i].push_back(local.position[i]);
+        d_scale[i].push_back(local.scale[i]);
+    }
+
+    for (int i = 0; i < 4; ++i) {
+        d_rotation[i].push_back(local.rotation[i]);
+    }
+
+    d_world.push_back(SceneMatrix());
+    d_dirty.push_back(0);
+    markDirty(index);
+
+    d_index_of.push_back(index);
+    d_node_of.push_back(node);
+
+    // The child runs are rebuilt once, at the next update, however many
+    // nodes are added before it.
+    d_order_dirty = true;
+
+    return node;
+}
+
+void
+SceneGraph::markDirty(uint32_t index) {
+    if (!d_dirty[index]) {
+        d_dirty[index] = 1;
+
+        if (!d_all_dirty) {
+            d_dirty_nodes.push_back(index);
+        }
+    }
+}
+
+void
+SceneGraph::setPosition(SceneNode node, float x, float y, float z) {
+    uint32_t index = d_index_of[node];
+    d_position[0][index] = x;
+    d_position[1][index] = y;
+    d_position[2][index] = z;
+    markDirty(index);
+}
+
+void
+SceneGraph::setRotation(SceneNode node, float x, float y, float z, float w) {
+    uint32_t index = d_index_of[node];
+    d_rotation[0][index] = x;
+    d_rotation[1][index] = y;
+    d_rotation[2][index] = z;
+    d_rotation[3][index] = w;
+    markDirty(index);
+}
+
+void
+SceneGraph::setScale(SceneNode node, float x, float y, float z) {
+    uint32_t index = d_index_of[node];
+    d_scale[0][index] = x;
+    d_scale[1][index] = y;
+    d_scale[2][index] = z;
+    markDirty(index);
+}
+
+void
+SceneGraph::setLocal(SceneNode node, const SceneTransform& local) {
+    setPosition(node, local.position[0], local.position[1], local.position[2]);
+    setRotation(node, local.rotation[0], local.rotation[1], local.rotation[2], local.rotation[3]);
+    setScale(node, local.scale[0], local.scale[1], local.scale[2]);
+}
+
+SceneTransform
+SceneGraph::local(SceneNode node) const {
+    uint32_t index = d_index_of[node];
+    SceneTransform transform;
+
+    for (int i = 0; i < 3; ++i) {
+        transform.position[i] = d_position[i][index];
+        transform.scale[i] = d_scale[i][index];
+    }
+
+    for (int i = 0; i < 4; ++i) {
+        transform.rotation[i] = d_rotation[i][index];
+    }
+
+    return transform;
+}
+
+void
+SceneGraph::markAllDirty() {
+    std::fill(d_dirty.begin(), d_dirty.end(), 1);
+    d_dirty_nodes.clear();
+    d_all_dirty = true;
+}
+
+void
+SceneGraph::reorder() {
+    size_t count = d_parent.size();
+
+    // Children of each node in their current order, as offsets into one
+    // array.
+    std::vector<uint32_t> child_offset(count + 1, 0), children(count);
+
+    for (uint32_t parent : d_parent) {
+        if (parent != scene_no_parent) {
+            ++child_offset[parent + 1];
+        }
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        child_offset[i + 1] += child_offset[i];
+    }
+
+    std::vector<uint32_t> next(child_offset.begin(), child_offset.end() - 1);
+    std::vector<uint32_t> order;
+    order.reserve(count);
+
+    for (uint32_t index = 0; index < count; ++index) {
+        if (d_parent[index] == scene_no_parent) {
+            order.push_back(index);
+        }
+        else {
+            children[next[d_parent[index]]++] = index;
+        }
+    }
+
+    // Breadth first from the roots.
+    for (size_t k = 0; k < order.size(); ++k) {
+        uint32_t index = order[k];
+        order.insert(order.end(), children.begin() + child_offset[index], children.begin() + child_offset[index + 1]);
+    }
+
+    std::vector<uint32_t> new_index(count);
+
+    for (uint32_t i = 0; i < count; ++i) {
+        new_index[order[i]] = i;
+    }
+
+    permute(d_parent, order);
+
+    for (auto& parent : d_parent) {
+        parent = parent == scene_no_parent ? scene_no_parent : new_index[parent];
+    }
+
+    permute(d_depth, order);
+
+    for (auto& component : d_position) {
+        permute(component, order);
+    }
+
+    for (auto& component : d_rotation) {
+        permute(component, order);
+    }
+
+    for (auto& component : d_scale) {
+        permute(component, order);
+    }
+
+    permute(d_world, order);
+    permute(d_dirty, order);
+    permute(d_node_of, order);
+
+    for (uint32_t i = 0; i < count; ++i) {
+        d_index_of[d_node_of[i]] = i;
+    }
+
+    // Levels, and where each node's children start on the next one. A
+    // childless node gets the position its children would take, so the
+    // children of any run of nodes are [first_child[begin],
+    // first_child[end - 1] + child_count[end - 1]).
+    d_level_start.assign(1, 0);
+
+    for (uint32_t i = 0; i < count; ++i) {
+        if (i > 0 && d_depth[i] != d_depth[i - 1]) {
+            d_level_start.push_back(i);
+        }
+    }
+
+    d_level_start.push_back((uint32_t)count);
+
+    for (uint32_t i = 0; i < count; ++i) {
+        d_child_count[i] = child_offset[order[i] + 1] - child_offset[order[i]];
+        d_first_child[i] = i == d_level_start[d_depth[i]] ?
+            d_level_start[std::min<size_t>(d_depth[i] + 1, d_level_start.size() - 1)] :
+            d_first_child[i - 1] + d_child_count[i - 1];
+    }
+
+    d_dirty_nodes.clear();
+
+    if (!d_all_dirty) {
+        for (uint32_t i = 0; i < count; ++i) {
+            if (d_dirty[i]) {
+                d_dirty_nodes.push_back(i);
+            }
+        }
+    }
+
+    d_order_dirty = false;
+}
+
+void
+SceneGraph::updateRun(uint32_t begin, uint32_t end) {
+    for (uint32_t block = begin; block < end; block += 4) {
+        uint32_t lanes = std::min(end - block, 4u);
+
+        // Local rotation, scale and position of the block's nodes, one lane
+        // per node. A short block is padded with identity transforms.
+        const std::vector<float> *sources[10] = {
+            &d_rotation[0], &d_rotation[1], &d_rotation[2], &d_rotation[3],
+            &d_scale[0], &d_scale[1], &d_scale[2],
+            &d_position[0], &d_position[1], &d_position[2],
+        };
+        const float padding[10] = { 0, 0, 0, 1, 1, 1, 1, 0, 0, 0 };
+
+        Vec4f inputs[10];
+        float padded[4];
+
+        for (int k = 0; k < 10; ++k) {
+            if (lanes == 4) {
+                inputs[k] = Vec4f::load(sources[k]->data() + block);
+                continue;
+            }
+
+            for (uint32_t j = 0; j < 4; ++j) {
+                padded[j] = j < lanes ? (*sources[k])[block + j] : padding[k];
+            }
+
+            inputs[k] = Vec4f::load(padded);
+        }
+
+        const Vec4f qx = inputs[0], qy = inputs[1], qz = inputs[2], qw = inputs[3];
+        const Vec4f sx = inputs[4], sy = inputs[5], sz = inputs[6];
+
+        const Vec4f one = Vec4f::broadcast(1.0f), two = Vec4f::broadcast(2.0f);
+        Vec4f xx = qx * qx, yy = qy * qy, zz = qz * qz;
+        Vec4f xy = qx * qy, xz = qx * qz, yz = qy * qz;
+        Vec4f wx = qw * qx, wy = qw * qy, wz = qw * qz;
+
+        // Column-major rotation times scale, then the translation column.
+        float local[12][4];
+        ((one - two * (yy + zz)) * sx).store(local[0]);
+        (two * (xy + wz) * sx).store(local[1]);
+        (two * (xz - wy) * sx).store(local[2]);
+        (two * (xy - wz) * sy).store(local[3]);
+        ((one - two * (xx + zz)) * sy).store(local[4]);
+        (two * (yz + wx) * sy).store(local[5]);
+        (two * (xz + wy) * sz).store(local[6]);
+        (two * (yz - wx) * sz).store(local[7]);
+        ((one - two * (xx + yy)) * sz).store(local[8]);
+        inputs[7].store(local[9]);
+        inputs[8].store(local[10]);
+        inputs[9].store(local[11]);
+
+        for (uint32_t j = 0; j < lanes; ++j) {
+            uint32_t index = block + j;
+            uint32_t parent = d_parent[index];
+            float *world = columnsOf(d_world[index]);
+
+            if (parent == scene_no_parent) {
+                for (int c = 0; c < 4; ++c) {
+                    world[c * 4 + 0] = local[c * 3 + 0][j];
+                    world[c * 4 + 1] = local[c * 3 + 1][j];
+                    world[c * 4 + 2] = local[c * 3 + 2][j];
+                    world[c * 4 + 3] = c == 3 ? 1.0f : 0.0f;
+                }
+            }
+            else {
+                // world = parent * local, a column at a time.
+                const float *parent_world = columnsOf(d_world[parent]);
+                Vec4f p0 = Vec4f::load(parent_world), p1 = Vec4f::load(parent_world + 4);
+                Vec4f p2 = Vec4f::load(parent_world + 8), p3 = Vec4f::load(parent_world + 12);
+
+                for (int c = 0; c < 4; ++c) {
+                    Vec4f column = p0 * Vec4f::broadcast(local[c * 3 + 0][j]) +
+                                   p1 * Vec4f::broadcast(local[c * 3 + 1][j]) +
+                                   p2 * Vec4f::broadcast(local[c * 3 + 2][j]);
+
+                    if (c == 3) {
+                        column = column + p3;
+                    }
+
+                    column.store(world + c * 4);
+                }
+            }
+
+            d_dirty[index] = 0;
+        }
+    }
+}
+
+size_t
+SceneGraph::update(ThreadPool *pool) {
+    if (d_order_dirty) {
+        reorder();
+    }
+
+    std::sort(d_dirty_nodes.begin(), d_dirty_nodes.end());
+
+    uint32_t changed_begin = UINT32_MAX, changed_end = 0;
+    size_t updated = 0, next_dirty = 0;
+
+    // Children of the previous level's runs.
+    d_runs.clear();
+
+    for (uint32_t level = 0; level + 1 < d_level_start.size(); ++level) {
+        uint32_t level_end = d_level_start[level + 1];
+
+        // This level's runs: the children runs merged with its dirty nodes.
+        d_next_runs.clear();
+
+        if (d_all_dirty) {
+            d_next_runs.push_back({ d_level_start[level], level_end });
+        }
+        else {
+            size_t run = 0;
+
+            while (run < d_runs.size() || (next_dirty < d_dirty_nodes.size() && d_dirty_nodes[next_dirty] < level_end)) {
+                Run candidate;
+
+                if (run < d_runs.size() &&
+                    !(next_dirty < d_dirty_nodes.size() && d_dirty_nodes[next_dirty] < std::min(level_end, d_runs[run].begin))) {
+                    candidate = d_runs[run++];
+                }
+                else {
+                    candidate = { d_dirty_nodes[next_dirty], d_dirty_nodes[next_dirty] + 1 };
+                    ++next_dirty;
+                }
+
+                if (!d_next_runs.empty() && candidate.begin <= d_next_runs.back().end) {
+                    d_next_runs.back().end = std::max(d_next_runs.back().end, candidate.end);
+                }
+                else {
+                    d_next_runs.push_back(candidate);
+                }
+            }
+        }
+
+        d_runs.swap(d_next_runs);
+
+        if (d_runs.empty()) {
+            continue;
+        }
+
+        // Split into tasks of at most `update_grain` nodes.
+        d_tasks.clear();
+        size_t level_nodes = 0;
+
+        for (const Run& run : d_runs) {
+            for (uint32_t begin = run.begin; begin < run.end; begin += (uint32_t)update_grain) {
+                d_tasks.push_back({ begin, std::min(begin + (uint32_t)update_grain, run.end) });
+            }
+
+            level_nodes += run.end - run.begin;
+        }
+
+        auto work = [&](size_t begin, size_t end) {
+            for (size_t task = begin; task < end; ++task) {
+                updateRun(d_tasks[task].begin, d_tasks[task].end);
+            }
+        };
+
+        if (pool && d_tasks.size() > 1) {
+            pool->parallelFor(d_tasks.size(), 1, work);
+        }
+        else {
+            work(0, d_tasks.size());
+        }
+
+        updated += level_nodes;
+        changed_begin = std::min(changed_begin, d_runs.front().begin);
+        changed_end = std::max(changed_end, d_runs.back().end);
+
+        // Every node in a run changed, so all of their children follow.
+        d_next_runs.clear();
+
+        for (const Run& run : d_runs) {
+            Run children = { d_first_child[run.begin], d_first_child[run.end - 1] + d_child_count[run.end - 1] };
+
+            if (children.begin == children.end) {
+                continue;
+            }
+
+            if (!d_next_runs.empty() && children.begin <= d_next_runs.back().end) {
+                d_next_runs.back().end = std::max(d_next_runs.back().end, children.end);
+            }
+            else {
+                d_next_runs.push_back(children);
+            }
+        }
+
+        d_runs.swap(d_next_runs);
+    }
+
+    d_dirty_nodes.clear();
+    d_all_dirty = false;
+
+    d_changed_begin = updated ? changed_begin : 0;
+    d_changed_end = updated ? changed_end : 0;
+    return updated;
+}
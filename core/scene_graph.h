@@ -0,0 +1,131 @@
+#pragma once
+
+#include "scene_types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+typedef uint32_t SceneNode;
+
+const SceneNode scene_no_parent = UINT32_MAX;
+
+struct SceneTransform {
+    float position[3] = { 0.0f, 0.0f, 0.0f };
+
+    // Unit quaternion (x, y, z, w).
+    float rotation[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+    float scale[3] = { 1.0f, 1.0f, 1.0f };
+};
+
+// Transform hierarchy stored as structure-of-arrays in breadth-first order:
+// each depth is one contiguous range, and within it nodes are grouped by
+// parent in the parents' order, so any run of nodes has its children in one
+// run on the next level. World matrices are kept in the same order, so they
+// can be copied to a per-instance buffer as they are.
+//
+// Changing a node's local transform marks it dirty. `update` works level by
+// level on runs of nodes: the dirty nodes of the level plus the children of
+// the previous level's runs, four nodes at a time. Its cost follows the
+// number of nodes that change, not the size of the graph. Nodes keep the
+// handle `addNode` returned; their position in the arrays,
+// `instanceIndex`, changes when an added node does not fit the order.
+class SceneGraph {
+public:
+
+    // `parent` must already exist.
+    SceneNode addNode(SceneNode parent = scene_no_parent, const SceneTransform& local = SceneTransform());
+
+    void setPosition(SceneNode node, float x, float y, float z);
+    void setRotation(SceneNode node, float x, float y, float z, float w);
+    void setScale(SceneNode node, float x, float y, float z);
+    void setLocal(SceneNode node, const SceneTransform& local);
+
+    SceneTransform local(SceneNode node) const;
+
+    // Brings every world matrix up to date and returns how many were
+    // recomputed. With a pool, each level is split across it; the result is
+    // the same either way.
+    size_t update(ThreadPool *pool = nullptr);
+
+    // Forces the next update to recompute every node.
+    void markAllDirty();
+
+    size_t size() const {
+        return d_parent.size();
+    }
+
+    uint32_t depthCount() const {
+        return d_level_start.empty() ? 0 : (uint32_t)d_level_start.size() - 1;
+    }
+
+    uint32_t instanceIndex(SceneNode node) const {
+        return d_index_of[node];
+    }
+
+    // Instance order, valid after `update`.
+    const SceneMatrix *worldMatrices() const {
+        return d_world.data();
+    }
+
+    const SceneMatrix& world(SceneNode node) const {
+        return d_world[d_index_of[node]];
+    }
+
+    // Instance indices [changedBegin(), changedEnd()) cover every world
+    // matrix the last update wrote; empty when it wrote none.
+    uint32_t changedBegin() const {
+        return d_changed_begin;
+    }
+
+    uint32_t changedEnd() const {
+        return d_changed_end;
+    }
+
+private:
+
+    struct Run {
+        uint32_t begin, end;
+    };
+
+    void markDirty(uint32_t index);
+
+    // Re-sorts breadth first after nodes were added out of order.
+    void reorder();
+
+    // Recomputes the world matrices of [begin, end), which lie within one
+    // level.
+    void updateRun(uint32_t begin, uint32_t end);
+
+    // Structure, in instance order. Parents and children are instance
+    // indices.
+    std::vector<uint32_t> d_parent;
+    std::vector<uint32_t> d_depth;
+    std::vector<uint32_t> d_first_child, d_child_count;
+    std::vector<uint32_t> d_level_start;
+
+    // Local transforms, one array per component.
+    std::vector<float> d_position[3];
+    std::vector<float> d_rotation[4];
+    std::vector<float> d_scale[3];
+
+    std::vector<SceneMatrix> d_world;
+
+    // Set by local changes, cleared by update; `d_dirty_nodes` lists the
+    // set ones unless everything is dirty.
+    std::vector<uint8_t> d_dirty;
+    std::vector<uint32_t> d_dirty_nodes;
+    bool d_all_dirty = false;
+
+    // Per-level work of the update in progress, and its split into tasks.
+    std::vector<Run> d_runs, d_next_runs, d_tasks;
+
+    std::vector<uint32_t> d_index_of;
+    std::vector<SceneNode> d_node_of;
+    bool d_order_dirty = false;
+
+    uint32_t d_changed_begin = 0, d_changed_end = 0;
+};
@@ -0,0 +1,31 @@
+/*
+Header containing types and enum constants shared between the scene shaders
+and C++ code, including the CPU transform hierarchy
+*/
+
+#ifndef scene_types_H
+#define scene_types_H
+
+#ifdef __METAL_VERSION__
+typedef float4x4 SceneMatrix;
+#elif defined(__APPLE__)
+#include <simd/simd.h>
+typedef matrix_float4x4 SceneMatrix;
+#else
+// Stand-in for matrix_float4x4 where <simd/simd.h> is unavailable: four
+// 16-byte aligned columns, indexed the same way.
+typedef struct
+{
+    alignas(16) float columns[4][4];
+} SceneMatrix;
+#endif
+
+typedef enum SceneInputIndex
+{
+    SceneInputIndexVertices     = 0,
+    SceneInputIndexViewportSize = 1,
+    SceneInputIndexInstances    = 2,
+    SceneInputIndexVisible      = 3,
+} SceneInputIndex;
+
+#endif /* scene_types_H */
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdint>
+
+// Which implementation of a CPU kernel to run: plain scalar code, or the
+// Vec4f path from vec4.h. Both give the same results; the scalar one is the
+// reference the vectorized one is tested and benchmarked against.
+enum SimdKernel : uint8_t {
+    SimdKernelScalar,
+    SimdKernelVector,
+};
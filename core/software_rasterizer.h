@@ -0,0 +1,204 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// Position in window pixels, y down, as Metal's rasterizer sees it.
+struct RasterPoint {
+    float x, y;
+};
+
+namespace detail {
+
+inline float
+edgeFunction(RasterPoint a, RasterPoint b, float px, float py) {
+    return (b.x - a.x) * (py - a.y) - (b.y - a.y) * (px - a.x);
+}
+
+// Top-left fill rule for an edge a -> b of a triangle with positive area
+// under `edgeFunction`, i.e. clockwise on screen: top edges run right and
+// left edges run up.
+inline bool
+isTopLeft(RasterPoint a, RasterPoint b) {
+    return (a.y == b.y && b.x > a.x) || (b.y < a.y);
+}
+
+}
+
+// Barycentrics of the point (px, py), computed exactly as `rasterizeTriangle`
+// does so a pixel shaded later from stored vertices gets bit-identical
+// weights. Returns false for a degenerate triangle.
+inline bool
+barycentricsAt(RasterPoint v0, RasterPoint v1, RasterPoint v2, float px, float py, float *b0, float *b1, float *b2) {
+    float area = detail::edgeFunction(v0, v1, v2.x, v2.y);
+
+    if (area == 0.0f) {
+        return false;
+    }
+
+    bool swapped = area < 0.0f;
+
+    if (swapped) {
+        std::swap(v1, v2);
+        area = -area;
+    }
+
+    float inverse_area = 1.0f / area;
+
+    float w0 = detail::edgeFunction(v1, v2, px, py);
+    float w1 = detail::edgeFunction(v2, v0, px, py);
+    float w2 = detail::edgeFunction(v0, v1, px, py);
+
+    if (swapped) {
+        std::swap(w1, w2);
+    }
+
+    *b0 = w0 * inverse_area;
+    *b1 = w1 * inverse_area;
+    *b2 = w2 * inverse_area;
+
+    return true;
+}
+
+// Calls `shade(x, y, b0, b1, b2)` for every pixel whose center lies inside the
+// triangle, with perspective-free barycentrics. Either winding is accepted and
+// shared edges are owned by exactly one triangle (top-left rule), so adjacent
+// triangles never double-shade a pixel.
+template<typename Shade>
+void
+rasterizeTriangle(RasterPoint v0, RasterPoint v1, RasterPoint v2, uint32_t width, uint32_t height, Shade&& shade) {
+    float area = detail::edgeFunction(v0, v1, v2.x, v2.y);
+
+    if (area == 0.0f) {
+        return;
+    }
+
+    // Rasterize counter-clockwise triangles as clockwise ones, remembering
+    // to hand back barycentrics in the caller's vertex order.
+    bool swapped = area < 0.0f;
+
+    if (swapped) {
+        std::swap(v1, v2);
+        area = -area;
+    }
+
+    float min_x = std::min(std::min(v0.x, v1.x), v2.x), max_x = std::max(std::max(v0.x, v1.x), v2.x);
+    float min_y = std::min(std::min(v0.y, v1.y), v2.y), max_y = std::max(std::max(v0.y, v1.y), v2.y);
+
+    int x0 = std::max(0, (int)std::floor(min_x)), x1 = std::min((int)width - 1, (int)std::ceil(max_x));
+    int y0 = std::max(0, (int)std::floor(min_y)), y1 = std::min((int)height - 1, (int)std::ceil(max_y));
+
+    bool top_left0 = detail::isTopLeft(v1, v2);
+    bool top_left1 = detail::isTopLeft(v2, v0);
+    bool top_left2 = detail::isTopLeft(v0, v1);
+
+    float inverse_area = 1.0f / area;
+
+    for (int y = y0; y <= y1; ++y) {
+        float py = y + 0.5f;
+
+        for (int x = x0; x <= x1; ++x) {
+            float px = x + 0.5f;
+
+            float w0 = detail::edgeFunction(v1, v2, px, py);
+            float w1 = detail::edgeFunction(v2, v0, px, py);
+            float w2 = detail::edgeFunction(v0, v1, px, py);
+
+            bool inside =
+                (w0 > 0.0f || (w0 == 0.0f && top_left0)) &&
+                (w1 > 0.0f || (w1 == 0.0f && top_left1)) &&
+                (w2 > 0.0f || (w2 == 0.0f && top_left2));
+
+            if (inside) {
+                if (swapped) {
+                    std::swap(w1, w2);
+                }
+
+                shade((uint32_t)x, (uint32_t)y, w0 * inverse_area, w1 * inverse_area, w2 * inverse_area);
+            }
+        }
+    }
+}
+
+// Metal's standard 4x sample positions within a pixel, in sample order
+// (`MTL::Device::getDefaultSamplePositions`).
+inline constexpr RasterPoint standard_sample_positions_4x[4] = {
+    { 0.375f, 0.125f },
+    { 0.875f, 0.375f },
+    { 0.125f, 0.625f },
+    { 0.625f, 0.875f },
+};
+
+// Multisampled `rasterizeTriangle`: coverage is tested at each of the
+// `sample_count` (at most 32) positions with the same top-left rule, and
+// `shade(x, y, mask, b0, b1, b2)` runs once per pixel with at least one
+// covered sample, with bit i of `mask` set for sample i. Like Metal without
+// centroid or sample-rate shading, barycentrics are taken at the pixel
+// center even when the center itself is outside the triangle.
+template<typename Shade>
+void
+rasterizeTriangleMultisample(RasterPoint v0, RasterPoint v1, RasterPoint v2, uint32_t width, uint32_t height,
+    const RasterPoint *sample_positions, uint32_t sample_count, Shade&& shade) {
+    float area = detail::edgeFunction(v0, v1, v2.x, v2.y);
+
+    if (area == 0.0f) {
+        return;
+    }
+
+    bool swapped = area < 0.0f;
+
+    if (swapped) {
+        std::swap(v1, v2);
+        area = -area;
+    }
+
+    float min_x = std::min(std::min(v0.x, v1.x), v2.x), max_x = std::max(std::max(v0.x, v1.x), v2.x);
+    float min_y = std::min(std::min(v0.y, v1.y), v2.y), max_y = std::max(std::max(v0.y, v1.y), v2.y);
+
+    int x0 = std::max(0, (int)std::floor(min_x)), x1 = std::min((int)width - 1, (int)std::ceil(max_x));
+    int y0 = std::max(0, (int)std::floor(min_y)), y1 = std::min((int)height - 1, (int)std::ceil(max_y));
+
+    bool top_left0 = detail::isTopLeft(v1, v2);
+    bool top_left1 = detail::isTopLeft(v2, v0);
+    bool top_left2 = detail::isTopLeft(v0, v1);
+
+    float inverse_area = 1.0f / area;
+
+    for (int y = y0; y <= y1; ++y) {
+        for (int x = x0; x <= x1; ++x) {
+            uint32_t mask = 0;
+
+            for (uint32_t s = 0; s < sample_count; ++s) {
+                float px = x + sample_positions[s].x, py = y + sample_positions[s].y;
+
+                float w0 = detail::edgeFunction(v1, v2, px, py);
+                float w1 = detail::edgeFunction(v2, v0, px, py);
+                float w2 = detail::edgeFunction(v0, v1, px, py);
+
+                bool inside =
+                    (w0 > 0.0f || (w0 == 0.0f && top_left0)) &&
+                    (w1 > 0.0f || (w1 == 0.0f && top_left1)) &&
+                    (w2 > 0.0f || (w2 == 0.0f && top_left2));
+
+                mask |= inside ? 1u << s : 0u;
+            }
+
+            if (mask == 0) {
+                continue;
+            }
+
+            float px = x + 0.5f, py = y + 0.5f;
+
+            float w0 = detail::edgeFunction(v1, v2, px, py);
+            float w1 = detail::edgeFunction(v2, v0, px, py);
+            float w2 = detail::edgeFunction(v0, v1, px, py);
+
+            if (swapped) {
+                std::swap(w1, w2);
+            }
+
+            shade((uint32_t)x, (uint32_t)y, mask, w0 * inverse_area, w1 * inverse_area, w2 * inverse_area);
+        }
+    }
+}
@@ -0,0 +1,122 @@
+#include "sort_keys.h"
+#include "culling.h"
+#include "vec4.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const unsigned radix_bits = 8;
+const size_t radix_buckets = size_t(1) << radix_bits;
+const unsigned radix_passes = 64 / radix_bits;
+
+// Below this many keys a comparison sort beats clearing the histograms.
+const size_t radix_min_count = 64;
+
+inline float
+sphereDistance(const CullBounds& bounds, uint32_t i, const float eye[3]) {
+    float dx = bounds.center[0][i] - eye[0];
+    float dy = bounds.center[1][i] - eye[1];
+    float dz = bounds.center[2][i] - eye[2];
+    return std::sqrt(dx * dx + dy * dy + dz * dz) - bounds.radius[i];
+}
+
+}
+
+void
+encodeSortKeys(const CullBounds& bounds, const uint32_t *indices, size_t count, const float eye[3],
+    uint32_t layer, uint32_t state, SortOrder order, uint64_t *keys, SimdKernel kernel) {
+    // Layer and state, with the depth and index left zero.
+    uint64_t prefix = sortKey(layer, 0.0f, state, 0, SortFrontToBack);
+
+    size_t i = 0;
+
+    if (kernel == SimdKernelVector) {
+        Vec4f ex = Vec4f::broadcast(eye[0]), ey = Vec4f::broadcast(eye[1]), ez = Vec4f::broadcast(eye[2]);
+        Vec4f zero = Vec4f::broadcast(0.0f);
+
+        for (; i + 4 <= count; i += 4) {
+            // Objects are scattered; gather their spheres into lanes.
+            alignas(16) float lanes[4][4];
+
+            for (size_t lane = 0; lane < 4; ++lane) {
+                uint32_t index = indices[i + lane];
+                lanes[0][lane] = bounds.center[0][index];
+                lanes[1][lane] = bounds.center[1][index];
+                lanes[2][lane] = bounds.center[2][index];
+                lanes[3][lane] = bounds.radius[index];
+            }
+
+            Vec4f dx = Vec4f::load(lanes[0]) - ex;
+            Vec4f dy = Vec4f::load(lanes[1]) - ey;
+            Vec4f dz = Vec4f::load(lanes[2]) - ez;
+            Vec4f distance = max(sqrt(dx * dx + dy * dy + dz * dz) - Vec4f::load(lanes[3]), zero);
+
+            alignas(16) float distances[4];
+            distance.store(distances);
+
+            for (size_t lane = 0; lane < 4; ++lane) {
+                keys[i + lane] = prefix |
+                    uint64_t(sortKeyDepth(distances[lane], order)) << (sort_key_state_bits + sort_key_index_bits) |
+                    (indices[i + lane] & sort_key_max_index);
+            }
+        }
+    }
+
+    for (; i < count; ++i) {
+        keys[i] = sortKey(layer, sphereDistance(bounds, indices[i], eye), state, indices[i], order);
+    }
+}
+
+void
+radixSort(uint64_t *keys, size_t count, uint64_t *scratch, unsigned first_bit) {
+    if (count < radix_min_count) {
+        std::stable_sort(keys, keys + count);
+        return;
+    }
+
+    unsigned first_pass = std::min(first_bit / radix_bits, radix_passes);
+
+    // Every pass's histogram from one read of the keys.
+    std::vector<uint32_t> histograms(radix_passes * radix_buckets, 0);
+
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t key = keys[i];
+
+        for (unsigned pass = first_pass; pass < radix_passes; ++pass) {
+            ++histograms[pass * radix_buckets + ((key >> (pass * radix_bits)) & (radix_buckets - 1))];
+        }
+    }
+
+    uint64_t *source = keys, *destination = scratch;
+
+    for (unsigned pass = first_pass; pass < radix_passes; ++pass) {
+        uint32_t *histogram = &histograms[pass * radix_buckets];
+        unsigned shift = pass * radix_bits;
+
+        // One bucket holds every key: the pass would copy them in order.
+        if (histogram[(source[0] >> shift) & (radix_buckets - 1)] == count) {
+            continue;
+        }
+
+        uint32_t offset = 0;
+
+        for (size_t bucket = 0; bucket < radix_buckets; ++bucket) {
+            uint32_t bucket_count = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucket_count;
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            uint64_t key = source[i];
+            destination[histogram[(key >> shift) & (radix_buckets - 1)]++] = key;
+        }
+
+        std::swap(source, destination);
+    }
+
+    if (source != keys) {
+        std::copy(source, source + count, keys);
+    }
+}
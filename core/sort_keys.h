@@ -0,0 +1,81 @@
+#pragma once
+
+#include "simd_kernel.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+struct CullBounds;
+
+enum SortOrder : uint8_t {
+    // Opaque draws: nearest first, so early depth testing rejects what is
+    // behind them.
+    SortFrontToBack,
+
+    // Blended draws: farthest first.
+    SortBackToFront,
+};
+
+// A draw as a 64-bit key that sorts as an unsigned integer, from the most
+// significant bits down:
+//
+//     63..60  layer: whole passes or groups of draws, in order
+//     59..36  depth: the top 24 bits of a non-negative float distance
+//     35..20  state: pipeline and material, breaking ties between draws
+//             at the same quantized depth
+//     19..0   index: which draw, returned by `sortKeyIndex`
+//
+// The bits of a non-negative float increase with its value, so the depth
+// needs no range; dropping the low seven keeps sixteen mantissa bits.
+const unsigned sort_key_index_bits = 20;
+const unsigned sort_key_state_bits = 16;
+const unsigned sort_key_depth_bits = 24;
+const unsigned sort_key_layer_bits = 4;
+
+const uint32_t sort_key_max_index = (1u << sort_key_index_bits) - 1;
+
+inline uint32_t
+sortKeyDepth(float depth, SortOrder order) {
+    uint32_t bits;
+    depth = depth > 0.0f ? depth : 0.0f;
+    std::memcpy(&bits, &depth, sizeof(bits));
+    bits >>= 32 - 1 - sort_key_depth_bits;
+    return order == SortFrontToBack ? bits : ~bits & ((1u << sort_key_depth_bits) - 1);
+}
+
+inline uint64_t
+sortKey(uint32_t layer, float depth, uint32_t state, uint32_t index, SortOrder order = SortFrontToBack) {
+    return uint64_t(layer & ((1u << sort_key_layer_bits) - 1)) << (64 - sort_key_layer_bits) |
+           uint64_t(sortKeyDepth(depth, order)) << (sort_key_state_bits + sort_key_index_bits) |
+           uint64_t(state & ((1u << sort_key_state_bits) - 1)) << sort_key_index_bits |
+           (index & sort_key_max_index);
+}
+
+inline uint32_t
+sortKeyIndex(uint64_t key) {
+    return uint32_t(key) & sort_key_max_index;
+}
+
+// Keys for the objects `indices` of `bounds`, all in one layer and state, by
+// the distance from `eye` to the nearest point of each object's sphere (zero
+// inside it). The SIMD kernel works on four objects per step and gives the
+// same keys.
+void encodeSortKeys(const CullBounds& bounds, const uint32_t *indices, size_t count, const float eye[3],
+    uint32_t layer, uint32_t state, SortOrder order, uint64_t *keys, SimdKernel kernel = SimdKernelVector);
+
+// Sorts `count` keys in ascending order with a least-significant-digit radix
+// sort: eight passes of eight bits, counted in one read of the keys, less the
+// passes in which every key has the same digit, such as the layer and state
+// of a batch that shares them. `scratch` holds `count` keys. Equal keys keep
+// their order, so the whole digits below `first_bit` can be left out when the
+// keys already ascend in them, as keys encoded from a visible list in index
+// order do below `sort_key_index_bits`.
+void radixSort(uint64_t *keys, size_t count, uint64_t *scratch, unsigned first_bit = 0);
+
+inline void
+radixSort(std::vector<uint64_t>& keys, std::vector<uint64_t>& scratch, unsigned first_bit = 0) {
+    scratch.resize(keys.size());
+    radixSort(keys.data(), keys.size(), scratch.data(), first_bit);
+}
@@ -0,0 +1,67 @@
+#include "sprite_batch.h"
+
+#include <algorithm>
+
+namespace {
+
+const uint64_t index_mask = SpriteBatch::max_sprites - 1;
+
+uint64_t
+sortKey(const Sprite& sprite, size_t index) {
+    return ((uint64_t)sprite.layer << 48) |
+           ((uint64_t)sprite.blend << 40) |
+           ((uint64_t)sprite.texture << 24) |
+           (uint64_t)index;
+}
+
+}
+
+void
+SpriteBatch::add(const Sprite& sprite) {
+    if (d_sprites.size() >= max_sprites) {
+        return;
+    }
+
+    d_keys.push_back(sortKey(sprite, d_sprites.size()));
+    d_sprites.push_back(sprite);
+}
+
+size_t
+SpriteBatch::build(SpriteVertex *vertices, size_t capacity) {
+    // The index in the low bits makes every key unique, so this is stable.
+    std::sort(d_keys.begin(), d_keys.end());
+
+    d_draws.clear();
+
+    size_t count = std::min(d_keys.size(), capacity);
+
+    for (size_t i = 0; i < count; ++i) {
+        const Sprite& sprite = d_sprites[d_keys[i] & index_mask];
+
+        float left = sprite.x - sprite.width * 0.5f, right = sprite.x + sprite.width * 0.5f;
+        float bottom = sprite.y - sprite.height * 0.5f, top = sprite.y + sprite.height * 0.5f;
+
+        // Pixel space is y up and texture space y down, so the top edge takes v0.
+        SpriteVertex top_left = { left, top, sprite.u0, sprite.v0, sprite.color };
+        SpriteVertex top_right = { right, top, sprite.u1, sprite.v0, sprite.color };
+        SpriteVertex bottom_left = { left, bottom, sprite.u0, sprite.v1, sprite.color };
+        SpriteVertex bottom_right = { right, bottom, sprite.u1, sprite.v1, sprite.color };
+
+        SpriteVertex *quad = vertices + i * 6;
+        quad[0] = top_left;
+        quad[1] = bottom_left;
+        quad[2] = bottom_right;
+        quad[3] = top_left;
+        quad[4] = bottom_right;
+        quad[5] = top_right;
+
+        if (!d_draws.empty() && d_draws.back().texture == sprite.texture && d_draws.back().blend == sprite.blend) {
+            d_draws.back().vertex_count += 6;
+        }
+        else {
+            d_draws.push_back(SpriteDraw { sprite.texture, sprite.blend, (uint32_t)(i * 6), 6 });
+        }
+    }
+
+    return count;
+}
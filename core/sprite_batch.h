@@ -0,0 +1,76 @@
+#pragma once
+
+#include "sprite_types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum SpriteBlend : uint8_t {
+    SpriteBlendOpaque,
+    SpriteBlendAlpha,
+    SpriteBlendAdditive,
+    SpriteBlendCount,
+};
+
+struct Sprite {
+    // Center and size in the same pixel space as SpriteVertex.
+    float x, y;
+    float width, height;
+
+    // Sub-rectangle of the atlas page, in normalized coordinates.
+    float u0, v0, u1, v1;
+
+    uint32_t color = 0xffffffffu;
+    uint16_t texture = 0;
+    SpriteBlend blend = SpriteBlendAlpha;
+
+    // Sprites in a higher layer are drawn after every sprite in a lower one.
+    // Within a layer, order is only kept between sprites that share texture
+    // and blend state.
+    uint16_t layer = 0;
+};
+
+// A run of sprites sharing texture and blend state: one draw call.
+struct SpriteDraw {
+    uint16_t texture;
+    SpriteBlend blend;
+    uint32_t vertex_start, vertex_count;
+};
+
+// Collects sprites for a frame, then orders them by (layer, blend, texture)
+// and writes their vertices in that order, so each run of equal state is a
+// single draw. Meant to write straight into a mapped shared buffer.
+class SpriteBatch {
+public:
+
+    // Sort keys keep the submission index in 24 bits.
+    static constexpr size_t max_sprites = 1 << 24;
+
+    void clear() {
+        d_sprites.clear();
+        d_keys.clear();
+    }
+
+    // Sprites past `max_sprites` in a frame are dropped.
+    void add(const Sprite& sprite);
+
+    // Writes six vertices per sprite for at most `capacity` sprites, in draw
+    // order, and rebuilds `draws()`. Returns the number of sprites written;
+    // the rest, last in draw order, are dropped.
+    size_t build(SpriteVertex *vertices, size_t capacity);
+
+    const std::vector<SpriteDraw>& draws() const {
+        return d_draws;
+    }
+
+    size_t size() const {
+        return d_sprites.size();
+    }
+
+private:
+
+    std::vector<Sprite> d_sprites;
+    std::vector<uint64_t> d_keys;
+    std::vector<SpriteDraw> d_draws;
+};
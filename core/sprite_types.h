@@ -0,0 +1,35 @@
+/*
+Header containing types and enum constants shared between the sprite shaders
+and C++ code, including the CPU batch builder
+*/
+
+#ifndef sprite_types_H
+#define sprite_types_H
+
+#ifndef __METAL_VERSION__
+#include <stdint.h>
+#endif
+
+typedef enum SpriteInputIndex
+{
+    SpriteInputIndexVertices     = 0,
+    SpriteInputIndexViewportSize = 1,
+    SpriteInputIndexTexture      = 0,
+    SpriteInputIndexSampler      = 0,
+} SpriteInputIndex;
+
+// One corner of a sprite quad; six per sprite, drawn as two triangles.
+// Scalars only, so the layout is the same 20 bytes on both sides.
+typedef struct
+{
+    // Pixel space with the origin at the center, like AAPLVertex.
+    float positionX, positionY;
+
+    // Normalized coordinates into the sprite's atlas page.
+    float u, v;
+
+    // RGBA8 tint, red in the low byte.
+    uint32_t color;
+} SpriteVertex;
+
+#endif /* sprite_types_H */
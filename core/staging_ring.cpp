@@ -0,0 +1,61 @@
+#include "staging_ring.h"
+
+StagingRing::StagingRing(size_t capacity)
+    : d_capacity(capacity) {
+}
+
+size_t
+StagingRing::allocate(size_t size, size_t alignment) {
+    // Start over at the beginning once nothing is in flight; batches closed
+    // empty still remember where the head was.
+    if (d_used == 0 && d_batches.empty()) {
+        d_head = d_tail = 0;
+    }
+
+    size_t start = (d_head + alignment - 1) & ~(alignment - 1);
+
+    // Free space is [head, tail) once the head has wrapped around behind the
+    // tail, and [head, capacity) then [0, tail) before.
+    bool wrapped = d_head < d_tail || (d_head == d_tail && d_used > 0);
+
+    if (wrapped) {
+        if (start > d_tail || size > d_tail - start) {
+            return npos;
+        }
+    }
+    else if (start > d_capacity || size > d_capacity - start) {
+        if (size > d_tail) {
+            return npos;
+        }
+
+        start = 0;
+    }
+
+    size_t taken = start >= d_head ? start + size - d_head : d_capacity - d_head + size;
+    d_used += taken;
+    d_open_bytes += taken;
+    d_head = start + size;
+    return start;
+}
+
+uint64_t
+StagingRing::closeBatch() {
+    d_batches.push_back(Batch { d_next_batch, d_head, d_open_bytes, false });
+    d_open_bytes = 0;
+    return d_next_batch++;
+}
+
+void
+StagingRing::retire(uint64_t batch) {
+    for (Batch& in_flight : d_batches) {
+        if (in_flight.number == batch) {
+            in_flight.retired = true;
+        }
+    }
+
+    while (!d_batches.empty() && d_batches.front().retired) {
+        d_tail = d_batches.front().end;
+        d_used -= d_batches.front().bytes;
+        d_batches.pop_front();
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+// Space in a ring of staging memory that the CPU writes uploads into and
+// the GPU copies out of. Allocations are handed out in order and grouped
+// into batches, one per submission of copies; a batch's space comes back
+// when the GPU reports it finished. Batches may be reported in any order,
+// but space only comes back up to the oldest batch still in flight.
+class StagingRing {
+public:
+
+    static const size_t npos = ~size_t(0);
+
+    explicit StagingRing(size_t capacity);
+
+    // The offset of `size` bytes at a multiple of `alignment`, a power of
+    // two, or npos when they do not fit until earlier batches retire. An
+    // allocation never wraps: when it does not fit before the end, the rest
+    // of the ring is skipped.
+    size_t allocate(size_t size, size_t alignment = 16);
+
+    // Ends the batch of everything allocated since the last call and returns
+    // its number, which is passed to `retire` once the GPU is done with it.
+    // An empty batch is still numbered.
+    uint64_t closeBatch();
+
+    void retire(uint64_t batch);
+
+    size_t capacity() const {
+        return d_capacity;
+    }
+
+    // Bytes not yet retired, including skipped space.
+    size_t used() const {
+        return d_used;
+    }
+
+    size_t batchesInFlight() const {
+        return d_batches.size();
+    }
+
+private:
+
+    struct Batch {
+        uint64_t number;
+        size_t end;
+        size_t bytes;
+        bool retired;
+    };
+
+    size_t d_capacity;
+    size_t d_head = 0, d_tail = 0;
+    size_t d_used = 0;
+
+    // Bytes taken since the last closed batch.
+    size_t d_open_bytes = 0;
+    uint64_t d_next_batch = 0;
+    std::deque<Batch> d_batches;
+};
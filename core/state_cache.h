@@ -0,0 +1,340 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Immutable state objects (samplers, depth and stencil states, pipelines)
+// keyed by a canonical description, so each distinct state is created once
+// however many threads ask for it. `Key` needs `==` and a `uint64_t hash()`
+// member; `Value` is default-constructible, and reset to its default when
+// its entry is evicted.
+//
+// Lookups take no lock. Entries are recycled but never freed, so a reader
+// may always touch an entry it found in the slot array: it takes a
+// reference, then checks that the entry is live and still holds its key. A
+// reader racing a writer that moves entries may miss; misses are retried
+// under the mutex, which also serializes creation, so `make` runs once per
+// key while the key stays cached.
+//
+// Entries with references are never evicted. Past `max_entries`, creating a
+// state evicts the least recently used entry without references, or grows
+// the cache if every entry has some. Recency is counted in misses: hits
+// between two misses are equally recent, so only the first hit on an entry
+// after a miss stores to `last_used`. Every hit still adds and drops a
+// reference on its entry, so threads hitting the same state contend on that
+// entry's cache line; `sdl-metal-state-cache-bench` measures it. With
+// `max_entries` 0 nothing is evicted.
+template<typename Key, typename Value>
+class StateCache {
+    struct Entry;
+
+public:
+
+    // A reference to a cached state; the entry cannot be evicted while any
+    // exist. Empty after a miss in `find`.
+    class Ref {
+    public:
+
+        Ref() = default;
+
+        Ref(Ref&& other) noexcept : d_entry(std::exchange(other.d_entry, nullptr)) {
+        }
+
+        Ref& operator=(Ref&& other) noexcept {
+            if (this != &other) {
+                release();
+                d_entry = std::exchange(other.d_entry, nullptr);
+            }
+
+            return *this;
+        }
+
+        Ref(const Ref&) = delete;
+        Ref& operator=(const Ref&) = delete;
+
+        ~Ref() {
+            release();
+        }
+
+        explicit operator bool() const {
+            return d_entry != nullptr;
+        }
+
+        const Value& operator*() const {
+            return d_entry->value;
+        }
+
+        const Value *operator->() const {
+            return &d_entry->value;
+        }
+
+    private:
+
+        friend class StateCache;
+
+        explicit Ref(Entry *entry) : d_entry(entry) {
+        }
+
+        void release() {
+            if (d_entry) {
+                d_entry->refs.fetch_sub(1, std::memory_order_release);
+                d_entry = nullptr;
+            }
+        }
+
+        Entry *d_entry = nullptr;
+    };
+
+    explicit StateCache(size_t max_entries = 0) : d_max_entries(max_entries) {
+        size_t capacity = 16;
+
+        while (capacity < max_entries * 2) {
+            capacity *= 2;
+        }
+
+        publish(capacity);
+    }
+
+    StateCache(const StateCache&) = delete;
+    StateCache& operator=(const StateCache&) = delete;
+
+    Ref find(const Key& key) const {
+        uint64_t hash = key.hash();
+        const Slots *slots = d_slots.load(std::memory_order_acquire);
+
+        for (size_t i = hash & slots->mask, probes = 0; probes <= slots->mask; i = (i + 1) & slots->mask, ++probes) {
+            Entry *entry = slots->entries[i].load(std::memory_order_acquire);
+
+            if (!entry) {
+                return Ref();
+            }
+
+            // The hash is only a filter; the key is read once a reference
+            // keeps the entry from being recycled under us.
+            if (entry->hash.load(std::memory_order_relaxed) != hash) {
+                continue;
+            }
+
+            uint32_t refs = entry->refs.fetch_add(1, std::memory_order_acquire);
+
+            if (!(refs & dead) && entry->key == key) {
+                if (entry->last_used.load(std::memory_order_relaxed) != d_clock.load(std::memory_order_relaxed)) {
+                    entry->last_used.store(d_clock.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                }
+
+                return Ref(entry);
+            }
+
+            entry->refs.fetch_sub(1, std::memory_order_release);
+        }
+
+        return Ref();
+    }
+
+    // Returns the state for `key`, calling `make()` to create it on a miss.
+    // `make` runs under the insert lock.
+    template<typename Make>
+    Ref acquire(const Key& key, Make&& make) {
+        if (Ref ref = find(key)) {
+            return ref;
+        }
+
+        std::lock_guard<std::mutex> lock(d_mutex);
+
+        // Writers hold the lock, so this probe cannot miss.
+        if (Ref ref = find(key)) {
+            return ref;
+        }
+
+        d_misses.fetch_add(1, std::memory_order_relaxed);
+        uint64_t now = d_clock.fetch_add(1, std::memory_order_relaxed) + 1;
+
+        Entry *entry = freeEntry();
+        entry->key = key;
+        entry->value = make();
+        entry->last_used.store(now, std::memory_order_relaxed);
+        entry->hash.store(key.hash(), std::memory_order_relaxed);
+
+        const Slots *slots = d_slots.load(std::memory_order_relaxed);
+
+        // Keep at most half the slots full so probe sequences stay short.
+        if ((d_live + 1) * 2 > slots->mask + 1) {
+            slots = publish((slots->mask + 1) * 2);
+        }
+
+        // Live, with the caller's reference. Readers that found the entry
+        // while it was dead may still be backing their references out.
+        uint32_t expected = dead;
+
+        while (!entry->refs.compare_exchange_weak(expected, 1, std::memory_order_release, std::memory_order_relaxed)) {
+            expected = dead;
+        }
+
+        insert(*slots, entry);
+        ++d_live;
+
+        return Ref(entry);
+    }
+
+    // A copy of the state for `key`, for values such as retained pointers
+    // that outlive their entry.
+    template<typename Make>
+    Value get(const Key& key, Make&& make) {
+        return *acquire(key, std::forward<Make>(make));
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(d_mutex);
+        return d_live;
+    }
+
+    uint64_t misses() const {
+        return d_misses.load(std::memory_order_relaxed);
+    }
+
+    uint64_t evictions() const {
+        return d_evictions.load(std::memory_order_relaxed);
+    }
+
+private:
+
+    // Set in `refs` while the entry holds no state; readers that increment
+    // a dead entry back out again.
+    static constexpr uint32_t dead = 0x80000000u;
+
+    struct Entry {
+        std::atomic<uint32_t> refs { dead };
+        std::atomic<uint64_t> last_used { 0 };
+        std::atomic<uint64_t> hash { 0 };
+        Key key {};
+        Value value {};
+    };
+
+    struct Slots {
+        size_t mask;
+        std::unique_ptr<std::atomic<Entry *>[]> entries;
+    };
+
+    static void insert(const Slots& slots, Entry *entry) {
+        size_t i = entry->hash.load(std::memory_order_relaxed) & slots.mask;
+
+        while (slots.entries[i].load(std::memory_order_relaxed)) {
+            i = (i + 1) & slots.mask;
+        }
+
+        slots.entries[i].store(entry, std::memory_order_release);
+    }
+
+    // Takes `entry` out of the current slot array, shifting later entries
+    // of its probe run back so that no tombstones are needed.
+    void remove(Entry *entry) {
+        const Slots& slots = *d_slots.load(std::memory_order_relaxed);
+        size_t hole = entry->hash.load(std::memory_order_relaxed) & slots.mask;
+
+        while (slots.entries[hole].load(std::memory_order_relaxed) != entry) {
+            hole = (hole + 1) & slots.mask;
+        }
+
+        for (size_t i = (hole + 1) & slots.mask;; i = (i + 1) & slots.mask) {
+            Entry *next = slots.entries[i].load(std::memory_order_relaxed);
+
+            if (!next) {
+                break;
+            }
+
+            // `next` may fill the hole if its home slot does not lie
+            // cyclically between the hole and where it sits now.
+            size_t home = next->hash.load(std::memory_order_relaxed) & slots.mask;
+
+            if (((i - home) & slots.mask) >= ((i - hole) & slots.mask)) {
+                slots.entries[hole].store(next, std::memory_order_release);
+                hole = i;
+            }
+        }
+
+        slots.entries[hole].store(nullptr, std::memory_order_release);
+    }
+
+    // A dead entry to fill, evicting the least recently used unreferenced
+    // entry when the cache is full.
+    Entry *freeEntry() {
+        while (d_max_entries != 0 && d_live >= d_max_entries) {
+            Entry *oldest = nullptr;
+
+            for (const auto& entry : d_entries) {
+                uint32_t refs = entry->refs.load(std::memory_order_relaxed);
+
+                if (refs == 0 && (!oldest || entry->last_used.load(std::memory_order_relaxed) <
+                                                 oldest->last_used.load(std::memory_order_relaxed))) {
+                    oldest = entry.get();
+                }
+            }
+
+            if (!oldest) {
+                break;
+            }
+
+            // Fails if a reader took a reference since the scan; look again.
+            uint32_t expected = 0;
+
+            if (oldest->refs.compare_exchange_strong(expected, dead, std::memory_order_acquire,
+                    std::memory_order_relaxed)) {
+                remove(oldest);
+                oldest->value = Value();
+                --d_live;
+                d_evictions.fetch_add(1, std::memory_order_relaxed);
+                return oldest;
+            }
+        }
+
+        for (const auto& entry : d_entries) {
+            if (entry->refs.load(std::memory_order_relaxed) & dead) {
+                return entry.get();
+            }
+        }
+
+        d_entries.push_back(std::make_unique<Entry>());
+        return d_entries.back().get();
+    }
+
+    // Fills a new slot array with every live entry and makes it current.
+    const Slots *publish(size_t capacity) {
+        auto slots = std::make_unique<Slots>();
+        slots->mask = capacity - 1;
+        slots->entries.reset(new std::atomic<Entry *>[capacity]);
+
+        for (size_t i = 0; i < capacity; ++i) {
+            slots->entries[i].store(nullptr, std::memory_order_relaxed);
+        }
+
+        for (const auto& entry : d_entries) {
+            if (!(entry->refs.load(std::memory_order_relaxed) & dead)) {
+                insert(*slots, entry.get());
+            }
+        }
+
+        d_generations.push_back(std::move(slots));
+        d_slots.store(d_generations.back().get(), std::memory_order_release);
+
+        return d_generations.back().get();
+    }
+
+    size_t d_max_entries;
+
+    std::atomic<const Slots *> d_slots { nullptr };
+    std::atomic<uint64_t> d_clock { 0 };
+    std::atomic<uint64_t> d_misses { 0 };
+    std::atomic<uint64_t> d_evictions { 0 };
+
+    mutable std::mutex d_mutex;
+    std::vector<std::unique_ptr<Entry>> d_entries;
+    size_t d_live = 0;
+
+    // Every slot array ever published; readers may still be probing old ones.
+    std::vector<std::unique_ptr<Slots>> d_generations;
+};
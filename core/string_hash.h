@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace detail {
+
+// Little-endian load spelled out bytewise so it stays usable in constant
+// expressions; compilers merge it into a single load at runtime.
+constexpr uint64_t
+loadWord(const char *p, size_t length) {
+    uint64_t word = 0;
+
+    for (size_t i = 0; i < length; ++i) {
+        word |= (uint64_t)(uint8_t)p[i] << (8 * i);
+    }
+
+    return word;
+}
+
+constexpr uint64_t
+mixWord(uint64_t hash, uint64_t word) {
+    word *= 0x9e3779b97f4a7c15ull;
+    word ^= word >> 32;
+    return (hash ^ word) * 0xff51afd7ed558ccdull;
+}
+
+}
+
+// 64-bit name hash consuming eight bytes per step. constexpr so names
+// written as literals are hashed at compile time and looked up without
+// touching their characters again; runtime and compile-time results match.
+constexpr uint64_t
+hashName(const char *name, size_t length) {
+    uint64_t hash = 0xcbf29ce484222325ull ^ (length * 0x100000001b3ull);
+    size_t i = 0;
+
+    for (; i + 8 <= length; i += 8) {
+        hash = detail::mixWord(hash, detail::loadWord(name + i, 8));
+    }
+
+    if (i < length) {
+        hash = detail::mixWord(hash, detail::loadWord(name + i, length - i));
+    }
+
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+
+    return hash;
+}
+
+constexpr uint64_t
+hashName(std::string_view name) {
+    return hashName(name.data(), name.size());
+}
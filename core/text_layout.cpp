@@ -0,0 +1,191 @@
+#include "text_layout.h"
+#include "font.h"
+#include "glyph_atlas.h"
+#include "sprite_batch.h"
+
+#include <algorithm>
+
+namespace {
+
+const uint32_t replacement_character = 0xfffd;
+
+// Decodes one codepoint at `text[*offset]` and advances past it. Overlong
+// forms, surrogates and truncated sequences decode as U+FFFD, consuming a
+// single byte.
+uint32_t
+decodeUtf8(const char *text, size_t length, size_t *offset) {
+    const uint8_t *bytes = (const uint8_t *)text;
+    uint8_t lead = bytes[*offset];
+
+    if (lead < 0x80) {
+        ++*offset;
+        return lead;
+    }
+
+    int extra = (lead & 0xe0) == 0xc0 ? 1 : (lead & 0xf0) == 0xe0 ? 2 : (lead & 0xf8) == 0xf0 ? 3 : -1;
+
+    if (extra < 0 || *offset + extra >= length) {
+        ++*offset;
+        return replacement_character;
+    }
+
+    uint32_t codepoint = lead & (0x3f >> extra);
+
+    for (int i = 1; i <= extra; ++i) {
+        uint8_t next = bytes[*offset + i];
+
+        if ((next & 0xc0) != 0x80) {
+            ++*offset;
+            return replacement_character;
+        }
+
+        codepoint = (codepoint << 6) | (next & 0x3f);
+    }
+
+    static const uint32_t smallest[4] = { 0, 0x80, 0x800, 0x10000 };
+
+    if (codepoint < smallest[extra] || codepoint > 0x10ffff || (codepoint >= 0xd800 && codepoint <= 0xdfff)) {
+        ++*offset;
+        return replacement_character;
+    }
+
+    *offset += extra + 1;
+    return codepoint;
+}
+
+}
+
+void
+layoutText(const Font& font, const char *text, size_t length, const TextStyle& style, TextLayout& layout) {
+    layout.glyphs.clear();
+    layout.width = 0.0f;
+    layout.line_count = 1;
+
+    const float scale = style.size / font.units_per_em;
+    const float line_advance = font.lineHeight() * scale * style.line_spacing;
+    const size_t none = SIZE_MAX;
+
+    float pen_x = 0.0f, baseline = 0.0f;
+
+    // Pen position after the line's last glyph with ink, which is what
+    // counts towards its width; trailing spaces do not.
+    float line_end = 0.0f;
+    size_t line_start = 0;
+
+    // The first glyph of the last word on this line that follows a space,
+    // where the line can be broken, and the pen and line end there.
+    size_t break_glyph = none;
+    float break_x = 0.0f, break_line_end = 0.0f;
+    bool after_space = false;
+
+    uint32_t previous = 0;
+
+    auto newLine = [&](float width) {
+        layout.width = std::max(layout.width, width);
+        baseline -= line_advance;
+        ++layout.line_count;
+        line_start = layout.glyphs.size();
+        break_glyph = none;
+        after_space = false;
+        previous = 0;
+    };
+
+    for (size_t offset = 0; offset < length;) {
+        uint32_t codepoint = decodeUtf8(text, length, &offset);
+
+        if (codepoint == '\n') {
+            newLine(line_end);
+            pen_x = line_end = 0.0f;
+            continue;
+        }
+
+        if (font.glyphs.find(codepoint) == font.glyphs.end()) {
+            codepoint = '?';
+        }
+
+        const Glyph *glyph = font.glyph(codepoint);
+
+        if (!glyph) {
+            continue;
+        }
+
+        if (glyph->outline.empty()) {
+            pen_x += glyph->advance * scale;
+            after_space = true;
+            previous = codepoint;
+            continue;
+        }
+
+        if (after_space) {
+            break_glyph = layout.glyphs.size();
+            break_x = pen_x;
+            break_line_end = line_end;
+            after_space = false;
+        }
+
+        if (previous) {
+            pen_x += font.kerningBetween(previous, codepoint) * scale;
+        }
+
+        if (style.max_width > 0.0f && pen_x + glyph->right * scale > style.max_width && layout.glyphs.size() > line_start) {
+            if (break_glyph != none && break_glyph > line_start) {
+                // Carry the current word over to a new line.
+                size_t first = break_glyph;
+                newLine(break_line_end);
+                line_start = first;
+
+                for (size_t i = first; i < layout.glyphs.size(); ++i) {
+                    layout.glyphs[i].x -= break_x;
+                    layout.glyphs[i].y = baseline;
+                }
+
+                pen_x -= break_x;
+                line_end -= break_x;
+            }
+            else {
+                // A word wider than the line: break inside it.
+                newLine(line_end);
+                pen_x = line_end = 0.0f;
+            }
+        }
+
+        layout.glyphs.push_back({ codepoint, pen_x, baseline });
+        pen_x += glyph->advance * scale;
+        line_end = pen_x;
+        previous = codepoint;
+    }
+
+    layout.width = std::max(layout.width, line_end);
+    layout.height = (font.ascent + font.descent) * scale + (layout.line_count - 1) * line_advance;
+}
+
+void
+addTextSprites(const TextLayout& layout, const GlyphAtlas& atlas, float size, float x, float y,
+    uint32_t color, SpriteBatch& batch) {
+    float page_width = (float)atlas.page_width, page_height = (float)atlas.page_height;
+
+    for (const auto& positioned : layout.glyphs) {
+        const AtlasGlyph *glyph = atlas.glyph(positioned.codepoint);
+
+        if (!glyph) {
+            continue;
+        }
+
+        float left = x + positioned.x + glyph->left * size, right = x + positioned.x + glyph->right * size;
+        float bottom = y + positioned.y + glyph->bottom * size, top = y + positioned.y + glyph->top * size;
+
+        Sprite sprite;
+        sprite.x = (left + right) * 0.5f;
+        sprite.y = (bottom + top) * 0.5f;
+        sprite.width = right - left;
+        sprite.height = top - bottom;
+        sprite.u0 = glyph->rect.x / page_width;
+        sprite.v0 = glyph->rect.y / page_height;
+        sprite.u1 = (glyph->rect.x + glyph->rect.width) / page_width;
+        sprite.v1 = (glyph->rect.y + glyph->rect.height) / page_height;
+        sprite.color = color;
+        sprite.texture = (uint16_t)glyph->page;
+        sprite.blend = SpriteBlendAlpha;
+        batch.add(sprite);
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct Font;
+struct GlyphAtlas;
+class SpriteBatch;
+
+struct TextStyle {
+    // Pixels per em.
+    float size = 16.0f;
+
+    // Lines are broken at spaces to stay within this many pixels, or inside a
+    // word that is wider on its own; 0 disables wrapping.
+    float max_width = 0.0f;
+
+    // Multiplies the font's line height.
+    float line_spacing = 1.0f;
+};
+
+struct PositionedGlyph {
+    uint32_t codepoint;
+
+    // Pen position on the baseline, in pixels, y up; the first baseline is
+    // at y = 0.
+    float x, y;
+};
+
+struct TextLayout {
+    // Only glyphs with ink; spaces just move the pen.
+    std::vector<PositionedGlyph> glyphs;
+
+    // Widest line's advance and the distance from the first line's ascent to
+    // the last line's descent.
+    float width = 0.0f, height = 0.0f;
+    uint32_t line_count = 0;
+};
+
+// Lays out UTF-8 `text` with kerning, breaking lines at '\n' and, with a
+// `max_width`, greedily at the last space that fits. Malformed bytes lay out
+// as U+FFFD, which like any codepoint the font lacks draws as '?'.
+void layoutText(const Font& font, const char *text, size_t length, const TextStyle& style, TextLayout& layout);
+
+// Adds a sprite per laid-out glyph that has an atlas entry. The atlas page
+// becomes the sprite's texture; (x, y) is where the first baseline starts.
+void addTextSprites(const TextLayout& layout, const GlyphAtlas& atlas, float size, float x, float y,
+    uint32_t color, SpriteBatch& batch);
@@ -0,0 +1,832 @@
+#include "texture_codec.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+// Rows of blocks per task.
+const size_t block_row_grain = 4;
+
+// Interpolation weights out of 64: BC7's 4-bit table, which the universal
+// format shares, and ASTC's 3-bit and 2-bit weights unquantized by bit
+// replication.
+const int bc7_weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+const int astc_weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+const int astc_weights2[4] = { 0, 21, 43, 64 };
+
+// ASTC block modes for one plane of a 4x4 weight grid: the weight range
+// goes in bits 4, 0 and 1, the grid height less two in bits 5 and 6.
+// Weight ranges 0..7 and 0..3.
+const uint32_t astc_mode_weights3 = 0x053;
+const uint32_t astc_mode_weights2 = 0x042;
+
+// Color endpoint modes: LDR RGB direct and LDR RGBA direct. With either
+// weight count above, every endpoint value gets all eight bits.
+const uint32_t astc_cem_rgb = 8;
+const uint32_t astc_cem_rgba = 12;
+
+const uint32_t magenta = 0xffff00ff;
+
+struct Block {
+    int texel[16][4];
+    bool opaque;
+};
+
+void
+loadBlock(const uint32_t *rgba, uint32_t width, uint32_t height, uint32_t block_x, uint32_t block_y, Block& block) {
+    block.opaque = true;
+
+    for (uint32_t y = 0; y < 4; ++y) {
+        const uint32_t *row = rgba + (size_t)std::min(block_y * 4 + y, height - 1) * width;
+
+        for (uint32_t x = 0; x < 4; ++x) {
+            uint32_t color = row[std::min(block_x * 4 + x, width - 1)];
+            int *texel = block.texel[y * 4 + x];
+
+            for (int c = 0; c < 4; ++c) {
+                texel[c] = (color >> (8 * c)) & 0xff;
+            }
+
+            block.opaque = block.opaque && texel[3] == 255;
+        }
+    }
+}
+
+void
+storeBlock(const uint32_t texels[16], uint32_t *rgba, uint32_t width, uint32_t height, uint32_t block_x, uint32_t block_y) {
+    for (uint32_t y = 0; y < 4 && block_y * 4 + y < height; ++y) {
+        for (uint32_t x = 0; x < 4 && block_x * 4 + x < width; ++x) {
+            rgba[(size_t)(block_y * 4 + y) * width + block_x * 4 + x] = texels[y * 4 + x];
+        }
+    }
+}
+
+uint32_t
+packColor(const int color[4]) {
+    return (uint32_t)color[0] | (uint32_t)color[1] << 8 | (uint32_t)color[2] << 16 | (uint32_t)color[3] << 24;
+}
+
+// How BC7 and the universal format blend two 8-bit endpoints.
+int
+blend8(int a, int b, int weight) {
+    return ((64 - weight) * a + weight * b + 32) >> 6;
+}
+
+// How ASTC does it for 8-bit results: on endpoints widened to 16 bits.
+int
+blendASTC(int a, int b, int weight) {
+    return (((a * 257) * (64 - weight) + (b * 257) * weight + 32) >> 6) >> 8;
+}
+
+// Picks for each texel the level of `weights` whose blend of `e0` and `e1`
+// is nearest in the first `channels` channels, and returns the summed
+// squared error.
+template <typename Blend>
+int
+chooseIndices(const Block& block, const int e0[4], const int e1[4], const int *weights, int level_count, int channels,
+    uint8_t index[16], Blend blend) {
+    int palette[16][4];
+
+    for (int level = 0; level < level_count; ++level) {
+        for (int c = 0; c < 4; ++c) {
+            palette[level][c] = blend(e0[c], e1[c], weights[level]);
+        }
+    }
+
+    int total = 0;
+
+    for (int i = 0; i < 16; ++i) {
+        int best = std::numeric_limits<int>::max();
+
+        for (int level = 0; level < level_count; ++level) {
+            int error = 0;
+
+            for (int c = 0; c < channels; ++c) {
+                int d = block.texel[i][c] - palette[level][c];
+                error += d * d;
+            }
+
+            if (error < best) {
+                best = error;
+                index[i] = (uint8_t)level;
+            }
+        }
+
+        total += best;
+    }
+
+    return total;
+}
+
+// Endpoints of a line through the block's colors in the first `channels`
+// channels, the rest left at 255: the principal axis from a few rounds of
+// power iteration, spanning the texels' projections, then two rounds of
+// least squares against the nearest of `weights`.
+void
+fitLine(const Block& block, int channels, const int *weights, int level_count, float e0[4], float e1[4]) {
+    float mean[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    float low[4] = { 255.0f, 255.0f, 255.0f, 255.0f }, high[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+    for (int i = 0; i < 16; ++i) {
+        for (int c = 0; c < channels; ++c) {
+            mean[c] += block.texel[i][c] / 16.0f;
+            low[c] = std::min(low[c], (float)block.texel[i][c]);
+            high[c] = std::max(high[c], (float)block.texel[i][c]);
+        }
+    }
+
+    for (int c = 0; c < 4; ++c) {
+        e0[c] = e1[c] = c < channels ? mean[c] : 255.0f;
+    }
+
+    float covariance[4][4] = {};
+
+    for (int i = 0; i < 16; ++i) {
+        for (int a = 0; a < channels; ++a) {
+            for (int b = 0; b < channels; ++b) {
+                covariance[a][b] += (block.texel[i][a] - mean[a]) * (block.texel[i][b] - mean[b]);
+            }
+        }
+    }
+
+    float axis[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    float length = 0.0f;
+
+    for (int c = 0; c < channels; ++c) {
+        axis[c] = high[c] - low[c];
+        length += axis[c] * axis[c];
+    }
+
+    // A flat block.
+    if (length == 0.0f) {
+        return;
+    }
+
+    for (int round = 0; round < 6; ++round) {
+        float next[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        float next_length = 0.0f;
+
+        for (int a = 0; a < channels; ++a) {
+            for (int b = 0; b < channels; ++b) {
+                next[a] += covariance[a][b] * axis[b];
+            }
+
+            next_length += next[a] * next[a];
+        }
+
+        if (next_length == 0.0f) {
+            break;
+        }
+
+        for (int c = 0; c < channels; ++c) {
+            axis[c] = next[c] / std::sqrt(next_length);
+        }
+    }
+
+    length = 0.0f;
+
+    for (int c = 0; c < channels; ++c) {
+        length += axis[c] * axis[c];
+    }
+
+    float t_low = std::numeric_limits<float>::max(), t_high = -std::numeric_limits<float>::max();
+
+    for (int i = 0; i < 16; ++i) {
+        float t = 0.0f;
+
+        for (int c = 0; c < channels; ++c) {
+            t += (block.texel[i][c] - mean[c]) * axis[c];
+        }
+
+        t_low = std::min(t_low, t / length);
+        t_high = std::max(t_high, t / length);
+    }
+
+    for (int c = 0; c < channels; ++c) {
+        e0[c] = std::clamp(mean[c] + t_low * axis[c], 0.0f, 255.0f);
+        e1[c] = std::clamp(mean[c] + t_high * axis[c], 0.0f, 255.0f);
+    }
+
+    for (int round = 0; round < 2; ++round) {
+        float direction[4], span = 0.0f;
+
+        for (int c = 0; c < channels; ++c) {
+            direction[c] = e1[c] - e0[c];
+            span += direction[c] * direction[c];
+        }
+
+        if (span < 1e-3f) {
+            return;
+        }
+
+        // Sums for the normal equations of the blend (1 - w) e0 + w e1.
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        float xa[4] = { 0.0f, 0.0f, 0.0f, 0.0f }, xb[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+        for (int i = 0; i < 16; ++i) {
+            float t = 0.0f;
+
+            for (int c = 0; c < channels; ++c) {
+                t += (block.texel[i][c] - e0[c]) * direction[c];
+            }
+
+            t = t / span * 64.0f;
+            int level = 0;
+
+            for (int candidate = 1; candidate < level_count; ++candidate) {
+                if (std::fabs(weights[candidate] - t) < std::fabs(weights[level] - t)) {
+                    level = candidate;
+                }
+            }
+
+            float w = weights[level] / 64.0f;
+            aa += (1.0f - w) * (1.0f - w);
+            ab += (1.0f - w) * w;
+            bb += w * w;
+
+            for (int c = 0; c < channels; ++c) {
+                xa[c] += (1.0f - w) * block.texel[i][c];
+                xb[c] += w * block.texel[i][c];
+            }
+        }
+
+        float determinant = aa * bb - ab * ab;
+
+        if (std::fabs(determinant) < 1e-6f) {
+            return;
+        }
+
+        for (int c = 0; c < channels; ++c) {
+            e0[c] = std::clamp((bb * xa[c] - ab * xb[c]) / determinant, 0.0f, 255.0f);
+            e1[c] = std::clamp((aa * xb[c] - ab * xa[c]) / determinant, 0.0f, 255.0f);
+        }
+    }
+}
+
+// Little-endian bit fields of a 128-bit block, as two 64-bit words.
+struct BlockWriter {
+    uint64_t words[2] = { 0, 0 };
+    unsigned position = 0;
+
+    void put(uint64_t value, unsigned count) {
+        unsigned shift = position & 63;
+        words[position >> 6] |= value << shift;
+
+        if (shift + count > 64) {
+            words[1] |= value >> (64 - shift);
+        }
+
+        position += count;
+    }
+
+    // ASTC stores its weights from the top bit down: bit i of `stream`
+    // lands in bit 127 - i of the block.
+    void putReversed(uint64_t stream) {
+        stream = (stream >> 1 & 0x5555555555555555ull) | (stream & 0x5555555555555555ull) << 1;
+        stream = (stream >> 2 & 0x3333333333333333ull) | (stream & 0x3333333333333333ull) << 2;
+        stream = (stream >> 4 & 0x0f0f0f0f0f0f0f0full) | (stream & 0x0f0f0f0f0f0f0f0full) << 4;
+        stream = (stream >> 8 & 0x00ff00ff00ff00ffull) | (stream & 0x00ff00ff00ff00ffull) << 8;
+        stream = (stream >> 16 & 0x0000ffff0000ffffull) | (stream & 0x0000ffff0000ffffull) << 16;
+        words[1] |= stream >> 32 | stream << 32;
+    }
+
+    void store(uint8_t out[16]) const {
+        std::memcpy(out, words, texture_block_bytes);
+    }
+};
+
+struct BlockReader {
+    uint64_t words[2];
+    unsigned position = 0;
+
+    explicit BlockReader(const uint8_t in[16]) {
+        std::memcpy(words, in, texture_block_bytes);
+    }
+
+    uint32_t get(unsigned count) {
+        unsigned shift = position & 63;
+        uint64_t value = words[position >> 6] >> shift;
+
+        if (shift + count > 64) {
+            value |= words[1] << (64 - shift);
+        }
+
+        position += count;
+        return (uint32_t)(value & ((1ull << count) - 1));
+    }
+
+    // Bit `reversed_position` counted down from the top, and the ones after.
+    uint32_t getReversed(unsigned count, unsigned& reversed_position) {
+        uint32_t value = 0;
+
+        for (unsigned i = 0; i < count; ++i, ++reversed_position) {
+            unsigned bit = 127 - reversed_position;
+            value |= (uint32_t)((words[bit >> 6] >> (bit & 63)) & 1) << i;
+        }
+
+        return value;
+    }
+};
+
+// BC7 mode 6: seven-bit endpoint channels, each endpoint with a p-bit below
+// them, and 4-bit indices of which the first drops its top bit, so that
+// index must be below 8; the endpoints swap when it is not.
+void
+packBC7(const int q0[4], const int q1[4], int p0, int p1, const uint8_t index[16], uint8_t out[16]) {
+    const int *low = q0, *high = q1;
+    bool swap = index[0] >= 8;
+
+    if (swap) {
+        std::swap(low, high);
+        std::swap(p0, p1);
+    }
+
+    BlockWriter writer;
+    writer.put(1u << 6, 7);
+
+    for (int c = 0; c < 4; ++c) {
+        writer.put(low[c], 7);
+        writer.put(high[c], 7);
+    }
+
+    writer.put(p0, 1);
+    writer.put(p1, 1);
+
+    for (int i = 0; i < 16; ++i) {
+        writer.put(swap ? 15 - index[i] : index[i], i == 0 ? 3 : 4);
+    }
+
+    writer.store(out);
+}
+
+// The seven-bit channels nearest `endpoint` with p-bit `p`, and the squared
+// error of the eight-bit endpoint they give.
+int
+quantizeBC7(const float endpoint[4], int p, int q[4]) {
+    float error = 0.0f;
+
+    for (int c = 0; c < 4; ++c) {
+        q[c] = std::clamp((int)std::lround((endpoint[c] - p) / 2.0f), 0, 127);
+        float d = endpoint[c] - (q[c] * 2 + p);
+        error += d * d;
+    }
+
+    return (int)error;
+}
+
+void
+encodeBC7Block(const Block& block, uint8_t out[16]) {
+    float f0[4], f1[4];
+    fitLine(block, 4, bc7_weights, 16, f0, f1);
+
+    // The p-bits are shared by all channels of an endpoint, so every pair
+    // is tried against the texels.
+    int best_error = std::numeric_limits<int>::max();
+    int best_q0[4], best_q1[4], best_p0 = 0, best_p1 = 0;
+    uint8_t best_index[16], index[16];
+
+    for (int p0 = 0; p0 < 2; ++p0) {
+        for (int p1 = 0; p1 < 2; ++p1) {
+            int q0[4], q1[4], e0[4], e1[4];
+            quantizeBC7(f0, p0, q0);
+            quantizeBC7(f1, p1, q1);
+
+            for (int c = 0; c < 4; ++c) {
+                e0[c] = q0[c] * 2 + p0;
+                e1[c] = q1[c] * 2 + p1;
+            }
+
+            int error = chooseIndices(block, e0, e1, bc7_weights, 16, 4, index, blend8);
+
+            if (error < best_error) {
+                best_error = error;
+                std::copy(q0, q0 + 4, best_q0);
+                std::copy(q1, q1 + 4, best_q1);
+                std::copy(index, index + 16, best_index);
+                best_p0 = p0;
+                best_p1 = p1;
+            }
+        }
+    }
+
+    packBC7(best_q0, best_q1, best_p0, best_p1, best_index, out);
+}
+
+void
+decodeBC7Block(const uint8_t in[16], uint32_t texels[16]) {
+    BlockReader reader(in);
+
+    if (reader.get(7) != 1u << 6) {
+        std::fill(texels, texels + 16, magenta);
+        return;
+    }
+
+    int e0[4], e1[4];
+
+    for (int c = 0; c < 4; ++c) {
+        e0[c] = reader.get(7) << 1;
+        e1[c] = reader.get(7) << 1;
+    }
+
+    int p0 = reader.get(1), p1 = reader.get(1);
+
+    for (int c = 0; c < 4; ++c) {
+        e0[c] |= p0;
+        e1[c] |= p1;
+    }
+
+    for (int i = 0; i < 16; ++i) {
+        int weight = bc7_weights[reader.get(i == 0 ? 3 : 4)];
+        int color[4];
+
+        for (int c = 0; c < 4; ++c) {
+            color[c] = blend8(e0[c], e1[c], weight);
+        }
+
+        texels[i] = packColor(color);
+    }
+}
+
+// One ASTC block of either of the configurations above. When the second
+// endpoint's RGB sum is below the first's, decoders swap the endpoints and
+// blend the blue into the red and green, so the endpoints are swapped here
+// first and the weights reversed, which the symmetric weight tables allow.
+void
+packASTC(const int e0[4], const int e1[4], bool opaque, const uint8_t index[16], uint8_t out[16]) {
+    const int *low = e0, *high = e1;
+    bool swap = e1[0] + e1[1] + e1[2] < e0[0] + e0[1] + e0[2];
+    int top = opaque ? 7 : 3;
+
+    if (swap) {
+        std::swap(low, high);
+    }
+
+    BlockWriter writer;
+    writer.put(opaque ? astc_mode_weights3 : astc_mode_weights2, 11);
+    writer.put(0, 2);
+    writer.put(opaque ? astc_cem_rgb : astc_cem_rgba, 4);
+
+    for (int c = 0; c < (opaque ? 3 : 4); ++c) {
+        writer.put(low[c], 8);
+        writer.put(high[c], 8);
+    }
+
+    uint64_t weights = 0;
+    unsigned bits = opaque ? 3 : 2;
+
+    for (int i = 0; i < 16; ++i) {
+        weights |= (uint64_t)(swap ? top - index[i] : index[i]) << (i * bits);
+    }
+
+    writer.putReversed(weights);
+    writer.store(out);
+}
+
+void
+encodeASTCBlock(const Block& block, uint8_t out[16]) {
+    const int *weights = block.opaque ? astc_weights3 : astc_weights2;
+    int level_count = block.opaque ? 8 : 4;
+
+    float f0[4], f1[4];
+    fitLine(block, block.opaque ? 3 : 4, weights, level_count, f0, f1);
+
+    int e0[4], e1[4];
+
+    for (int c = 0; c < 4; ++c) {
+        e0[c] = (int)std::lround(f0[c]);
+        e1[c] = (int)std::lround(f1[c]);
+    }
+
+    uint8_t index[16];
+    chooseIndices(block, e0, e1, weights, level_count, block.opaque ? 3 : 4, index, blendASTC);
+    packASTC(e0, e1, block.opaque, index, out);
+}
+
+// ASTC's blue contraction, undone for an endpoint that was stored with it.
+void
+blueContract(int color[4]) {
+    color[0] = (color[0] + color[2]) >> 1;
+    color[1] = (color[1] + color[2]) >> 1;
+}
+
+void
+decodeASTCBlock(const uint8_t in[16], uint32_t texels[16]) {
+    BlockReader reader(in);
+    uint32_t mode = reader.get(11);
+    uint32_t partitions = reader.get(2);
+    uint32_t cem = reader.get(4);
+
+    // RGBA endpoints with 3-bit weights leave too few bits for eight-bit
+    // endpoint values, so the encoders never write them.
+    bool known = partitions == 0 &&
+        ((mode == astc_mode_weights3 && cem == astc_cem_rgb) ||
+         (mode == astc_mode_weights2 && (cem == astc_cem_rgb || cem == astc_cem_rgba)));
+
+    if (!known) {
+        std::fill(texels, texels + 16, magenta);
+        return;
+    }
+
+    int e0[4] = { 0, 0, 0, 255 }, e1[4] = { 0, 0, 0, 255 };
+
+    for (int c = 0; c < (cem == astc_cem_rgba ? 4 : 3); ++c) {
+        e0[c] = reader.get(8);
+        e1[c] = reader.get(8);
+    }
+
+    if (e1[0] + e1[1] + e1[2] < e0[0] + e0[1] + e0[2]) {
+        std::swap(e0, e1);
+        blueContract(e0);
+        blueContract(e1);
+    }
+
+    const int *weights = mode == astc_mode_weights3 ? astc_weights3 : astc_weights2;
+    unsigned bits = mode == astc_mode_weights3 ? 3 : 2;
+    unsigned weight_position = 0;
+
+    for (int i = 0; i < 16; ++i) {
+        int weight = weights[reader.getReversed(bits, weight_position)];
+        int color[4];
+
+        for (int c = 0; c < 4; ++c) {
+            color[c] = blendASTC(e0[c], e1[c], weight);
+        }
+
+        texels[i] = packColor(color);
+    }
+}
+
+// Universal blocks: the endpoints as RGBA8 in bytes 0..7, then a nibble
+// per texel.
+void
+encodeUniversalBlock(const Block& block, uint8_t out[16]) {
+    float f0[4], f1[4];
+    fitLine(block, block.opaque ? 3 : 4, bc7_weights, 16, f0, f1);
+
+    int e0[4], e1[4];
+
+    for (int c = 0; c < 4; ++c) {
+        e0[c] = (int)std::lround(f0[c]);
+        e1[c] = (int)std::lround(f1[c]);
+        out[c] = (uint8_t)e0[c];
+        out[4 + c] = (uint8_t)e1[c];
+    }
+
+    uint8_t index[16];
+    chooseIndices(block, e0, e1, bc7_weights, 16, 4, index, blend8);
+
+    for (int i = 0; i < 8; ++i) {
+        out[8 + i] = (uint8_t)(index[2 * i] | index[2 * i + 1] << 4);
+    }
+}
+
+void
+unpackUniversal(const uint8_t in[16], int e0[4], int e1[4], uint8_t index[16]) {
+    for (int c = 0; c < 4; ++c) {
+        e0[c] = in[c];
+        e1[c] = in[4 + c];
+    }
+
+    for (int i = 0; i < 8; ++i) {
+        index[2 * i] = in[8 + i] & 0xf;
+        index[2 * i + 1] = in[8 + i] >> 4;
+    }
+}
+
+void
+decodeUniversalBlock(const uint8_t in[16], uint32_t texels[16]) {
+    int e0[4], e1[4];
+    uint8_t index[16];
+    unpackUniversal(in, e0, e1, index);
+
+    for (int i = 0; i < 16; ++i) {
+        int color[4];
+
+        for (int c = 0; c < 4; ++c) {
+            color[c] = blend8(e0[c], e1[c], bc7_weights[index[i]]);
+        }
+
+        texels[i] = packColor(color);
+    }
+}
+
+// Each universal weight's nearest ASTC level, for 3-bit and 2-bit weights.
+struct WeightMap {
+    uint8_t to3[16], to2[16];
+
+    WeightMap() {
+        for (int i = 0; i < 16; ++i) {
+            to3[i] = nearest(bc7_weights[i], astc_weights3, 8);
+            to2[i] = nearest(bc7_weights[i], astc_weights2, 4);
+        }
+    }
+
+    static uint8_t nearest(int weight, const int *levels, int count) {
+        int best = 0;
+
+        for (int level = 1; level < count; ++level) {
+            if (std::abs(levels[level] - weight) < std::abs(levels[best] - weight)) {
+                best = level;
+            }
+        }
+
+        return (uint8_t)best;
+    }
+};
+
+const WeightMap weight_map;
+
+void
+transcodeBlock(const uint8_t in[16], TextureFormat format, uint8_t out[16]) {
+    int e0[4], e1[4];
+    uint8_t index[16];
+    unpackUniversal(in, e0, e1, index);
+
+    if (format == TextureFormatBC7) {
+        float f0[4], f1[4];
+        int q0[4], q1[4], p[2];
+
+        for (int c = 0; c < 4; ++c) {
+            f0[c] = (float)e0[c];
+            f1[c] = (float)e1[c];
+        }
+
+        // Whichever p-bit keeps each endpoint nearer.
+        p[0] = quantizeBC7(f0, 1, q0) < quantizeBC7(f0, 0, q0) ? 1 : 0;
+        p[1] = quantizeBC7(f1, 1, q1) < quantizeBC7(f1, 0, q1) ? 1 : 0;
+        quantizeBC7(f0, p[0], q0);
+        quantizeBC7(f1, p[1], q1);
+        packBC7(q0, q1, p[0], p[1], index, out);
+    }
+    else {
+        bool opaque = e0[3] == 255 && e1[3] == 255;
+
+        for (int i = 0; i < 16; ++i) {
+            index[i] = opaque ? weight_map.to3[index[i]] : weight_map.to2[index[i]];
+        }
+
+        packASTC(e0, e1, opaque, index, out);
+    }
+}
+
+template <typename Function>
+void
+forEachBlockRow(uint32_t block_rows, ThreadPool *pool, const Function& f) {
+    if (pool && block_rows > block_row_grain) {
+        pool->parallelFor(block_rows, block_row_grain, [&](size_t begin, size_t end) {
+            for (size_t row = begin; row < end; ++row) {
+                f((uint32_t)row);
+            }
+        });
+    }
+    else {
+        for (uint32_t row = 0; row < block_rows; ++row) {
+            f(row);
+        }
+    }
+}
+
+uint32_t
+blockCount(uint32_t texels) {
+    return (texels + texture_block_size - 1) / texture_block_size;
+}
+
+}
+
+const char *
+textureFormatName(TextureFormat format) {
+    switch (format) {
+    case TextureFormatRGBA8:
+        return "rgba8";
+    case TextureFormatBC7:
+        return "bc7";
+    case TextureFormatASTC4x4:
+        return "astc";
+    case TextureFormatUniversal:
+        return "universal";
+    default:
+        return "unknown";
+    }
+}
+
+size_t
+textureImageSize(TextureFormat format, uint32_t width, uint32_t height) {
+    if (!isBlockCompressed(format)) {
+        return (size_t)width * height * sizeof(uint32_t);
+    }
+
+    return (size_t)blockCount(width) * blockCount(height) * texture_block_bytes;
+}
+
+size_t
+textureRowBytes(TextureFormat format, uint32_t width) {
+    return isBlockCompressed(format) ? blockCount(width) * texture_block_bytes : (size_t)width * sizeof(uint32_t);
+}
+
+void
+encodeTexture(TextureFormat format, const uint32_t *rgba, uint32_t width, uint32_t height, uint8_t *out,
+    ThreadPool *pool) {
+    if (!isBlockCompressed(format)) {
+        std::memcpy(out, rgba, textureImageSize(format, width, height));
+        return;
+    }
+
+    uint32_t blocks_x = blockCount(width);
+
+    forEachBlockRow(blockCount(height), pool, [&](uint32_t block_y) {
+        Block block;
+
+        for (uint32_t block_x = 0; block_x < blocks_x; ++block_x) {
+            uint8_t *block_out = out + ((size_t)block_y * blocks_x + block_x) * texture_block_bytes;
+            loadBlock(rgba, width, height, block_x, block_y, block);
+
+            if (format == TextureFormatBC7) {
+                encodeBC7Block(block, block_out);
+            }
+            else if (format == TextureFormatASTC4x4) {
+                encodeASTCBlock(block, block_out);
+            }
+            else {
+                encodeUniversalBlock(block, block_out);
+            }
+        }
+    });
+}
+
+void
+decodeTexture(TextureFormat format, const uint8_t *blocks, uint32_t width, uint32_t height, uint32_t *rgba,
+    ThreadPool *pool) {
+    if (!isBlockCompressed(format)) {
+        std::memcpy(rgba, blocks, textureImageSize(format, width, height));
+        return;
+    }
+
+    uint32_t blocks_x = blockCount(width);
+
+    forEachBlockRow(blockCount(height), pool, [&](uint32_t block_y) {
+        uint32_t texels[16];
+
+        for (uint32_t block_x = 0; block_x < blocks_x; ++block_x) {
+            const uint8_t *block = blocks + ((size_t)block_y * blocks_x + block_x) * texture_block_bytes;
+
+            if (format == TextureFormatBC7) {
+                decodeBC7Block(block, texels);
+            }
+            else if (format == TextureFormatASTC4x4) {
+                decodeASTCBlock(block, texels);
+            }
+            else {
+                decodeUniversalBlock(block, texels);
+            }
+
+            storeBlock(texels, rgba, width, height, block_x, block_y);
+        }
+    });
+}
+
+void
+transcodeTexture(const uint8_t *universal, uint32_t width, uint32_t height, TextureFormat format, uint8_t *out,
+    ThreadPool *pool) {
+    if (format == TextureFormatRGBA8) {
+        decodeTexture(TextureFormatUniversal, universal, width, height, (uint32_t *)out, pool);
+        return;
+    }
+
+    if (format == TextureFormatUniversal) {
+        std::memcpy(out, universal, textureImageSize(format, width, height));
+        return;
+    }
+
+    uint32_t blocks_x = blockCount(width);
+
+    forEachBlockRow(blockCount(height), pool, [&](uint32_t block_y) {
+        size_t first = (size_t)block_y * blocks_x * texture_block_bytes;
+
+        for (uint32_t block_x = 0; block_x < blocks_x; ++block_x) {
+            size_t offset = first + block_x * texture_block_bytes;
+            transcodeBlock(universal + offset, format, out + offset);
+        }
+    });
+}
+
+double
+texturePSNR(const uint32_t *a, const uint32_t *b, size_t count) {
+    double sum = 0.0;
+
+    for (size_t i = 0; i < count; ++i) {
+        for (int c = 0; c < 4; ++c) {
+            int d = (int)((a[i] >> (8 * c)) & 0xff) - (int)((b[i] >> (8 * c)) & 0xff);
+            sum += d * d;
+        }
+    }
+
+    if (sum == 0.0) {
+        return std::numeric_limits<double>::infinity();
+    }
+
+    return 10.0 * std::log10(255.0 * 255.0 / (sum / (count * 4.0)));
+}
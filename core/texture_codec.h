@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class ThreadPool;
+
+// Texel data as stored and uploaded. Every compressed format here codes a
+// 4x4 block of RGBA8 texels in 16 bytes.
+enum TextureFormat : uint8_t {
+    TextureFormatRGBA8,
+
+    // BC7, as sampled by Intel and AMD GPUs in Macs.
+    TextureFormatBC7,
+
+    // ASTC LDR with 4x4 blocks, as sampled by Apple GPUs.
+    TextureFormatASTC4x4,
+
+    // A block format of our own that no GPU samples, meant to be shipped
+    // once and transcoded at load time to whichever of the others the
+    // device has, in the manner of Basis Universal: two RGBA8 endpoints
+    // and sixteen 4-bit weights, which map onto BC7 and ASTC blocks with
+    // table lookups and no search over the texels.
+    TextureFormatUniversal,
+
+    TextureFormatCount,
+};
+
+const uint32_t texture_block_size = 4;
+const size_t texture_block_bytes = 16;
+
+const char *textureFormatName(TextureFormat format);
+
+inline bool
+isBlockCompressed(TextureFormat format) {
+    return format != TextureFormatRGBA8;
+}
+
+// Bytes of one `width` x `height` image; partial blocks at the right and
+// bottom edges take whole blocks.
+size_t textureImageSize(TextureFormat format, uint32_t width, uint32_t height);
+
+// Bytes between rows of blocks, or of texels for RGBA8.
+size_t textureRowBytes(TextureFormat format, uint32_t width);
+
+// Codes `width` x `height` RGBA8 texels, rows packed, into `out`, which
+// holds textureImageSize bytes. Each block fits a line through its texels'
+// colors, refines its endpoints by least squares and then picks each
+// texel's weight against the endpoints as quantized. The encoders use one
+// mode per format: BC7 mode 6 (one subset, RGBA endpoints with a p-bit,
+// 4-bit weights); ASTC with one partition on a 4x4 weight grid, direct RGB
+// endpoints with 3-bit weights for opaque blocks and direct RGBA endpoints
+// with 2-bit weights for the rest, all without trits or quints. Edge blocks
+// repeat the last row and column. Blocks are spread over `pool`.
+void encodeTexture(TextureFormat format, const uint32_t *rgba, uint32_t width, uint32_t height, uint8_t *out,
+    ThreadPool *pool = nullptr);
+
+// Back to RGBA8, for the blocks the encoders write: other BC7 modes and
+// ASTC block modes decode to magenta.
+void decodeTexture(TextureFormat format, const uint8_t *blocks, uint32_t width, uint32_t height, uint32_t *rgba,
+    ThreadPool *pool = nullptr);
+
+// Rewrites universal blocks as `format` blocks, or decodes them for RGBA8.
+// BC7 keeps the weights and drops a bit of each endpoint channel; ASTC
+// keeps the endpoints and rounds the weights to the nearest of its levels.
+void transcodeTexture(const uint8_t *universal, uint32_t width, uint32_t height, TextureFormat format, uint8_t *out,
+    ThreadPool *pool = nullptr);
+
+// Peak signal to noise ratio in dB between two sets of RGBA8 texels, over
+// all four channels; infinity when they are equal.
+double texturePSNR(const uint32_t *a, const uint32_t *b, size_t count);
@@ -0,0 +1,110 @@
+#include "texture_file.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const char texture_file_magic[4] = { 'S', 'M', 'T', 'X' };
+const uint32_t texture_file_version = 1;
+const size_t texture_file_header_size = 24;
+const size_t texture_file_level_size = 16;
+const size_t texture_file_alignment = 16;
+
+size_t
+alignUp(size_t offset) {
+    return (offset + texture_file_alignment - 1) & ~(texture_file_alignment - 1);
+}
+
+void
+putWord(std::vector<uint8_t>& file, size_t offset, uint32_t value) {
+    std::memcpy(&file[offset], &value, sizeof(value));
+}
+
+uint32_t
+getWord(const uint8_t *data, size_t offset) {
+    uint32_t value;
+    std::memcpy(&value, data + offset, sizeof(value));
+    return value;
+}
+
+}
+
+std::vector<uint8_t>
+cookTexture(const uint32_t *rgba, uint32_t width, uint32_t height, TextureFormat format, bool mipmaps,
+    ThreadPool *pool, MipFilter filter, bool srgb) {
+    uint32_t level_count = mipmaps ? mipLevelCount(width, height) : 1;
+    size_t offset = alignUp(texture_file_header_size + level_count * texture_file_level_size);
+
+    std::vector<uint8_t> file(offset);
+    std::memcpy(file.data(), texture_file_magic, sizeof(texture_file_magic));
+    putWord(file, 4, texture_file_version);
+    putWord(file, 8, format);
+    putWord(file, 12, width);
+    putWord(file, 16, height);
+    putWord(file, 20, level_count);
+
+    std::vector<MipImage> mips;
+
+    if (level_count > 1) {
+        generateMips(rgba, width, height, mips, filter, srgb, pool);
+    }
+
+    for (uint32_t i = 0; i < level_count; ++i) {
+        uint32_t level_width = i == 0 ? width : mips[i - 1].width;
+        uint32_t level_height = i == 0 ? height : mips[i - 1].height;
+        const uint32_t *texels = i == 0 ? rgba : mips[i - 1].texels.data();
+
+        uint64_t size = textureImageSize(format, level_width, level_height);
+        uint64_t level_offset = file.size();
+        std::memcpy(&file[texture_file_header_size + i * texture_file_level_size], &level_offset, sizeof(level_offset));
+        std::memcpy(&file[texture_file_header_size + i * texture_file_level_size + 8], &size, sizeof(size));
+
+        file.resize(alignUp(level_offset + size));
+        encodeTexture(format, texels, level_width, level_height, &file[level_offset], pool);
+    }
+
+    return file;
+}
+
+bool
+parseTextureFile(const uint8_t *data, size_t size, TextureFileView& view) {
+    view.levels.clear();
+
+    if (size < texture_file_header_size || std::memcmp(data, texture_file_magic, sizeof(texture_file_magic)) != 0 ||
+        getWord(data, 4) != texture_file_version) {
+        return false;
+    }
+
+    uint32_t format = getWord(data, 8);
+    view.width = getWord(data, 12);
+    view.height = getWord(data, 16);
+    uint32_t level_count = getWord(data, 20);
+
+    if (format >= TextureFormatCount || view.width == 0 || view.height == 0 || level_count == 0 ||
+        level_count > mipLevelCount(view.width, view.height) ||
+        size < texture_file_header_size + level_count * texture_file_level_size) {
+        return false;
+    }
+
+    view.format = (TextureFormat)format;
+    uint32_t level_width = view.width, level_height = view.height;
+
+    for (uint32_t i = 0; i < level_count; ++i) {
+        uint64_t offset, level_size;
+        std::memcpy(&offset, data + texture_file_header_size + i * texture_file_level_size, sizeof(offset));
+        std::memcpy(&level_size, data + texture_file_header_size + i * texture_file_level_size + 8, sizeof(level_size));
+
+        if (level_size != textureImageSize(view.format, level_width, level_height) || offset > size ||
+            level_size > size - offset) {
+            view.levels.clear();
+            return false;
+        }
+
+        view.levels.push_back(TextureLevel { level_width, level_height, data + offset, (size_t)level_size });
+        level_width = std::max(level_width / 2, 1u);
+        level_height = std::max(level_height / 2, 1u);
+    }
+
+    return true;
+}
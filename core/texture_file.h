@@ -0,0 +1,42 @@
+#pragma once
+
+#include "mip_chain.h"
+#include "texture_codec.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// Cooked textures: a whole mip chain, encoded ahead of time, in a file that
+// is read in place from a memory mapping.
+//
+// The file is a 24-byte header (magic, version, format, width, height and
+// level count, as 32-bit words after the magic), then per level the 64-bit
+// offset and size of its data, then the data of each level from the full
+// image down, at 16-byte file offsets. Every level is half the size of the
+// one before, rounded down and at least 1.
+
+struct TextureLevel {
+    uint32_t width, height;
+    const uint8_t *data;
+    size_t size;
+};
+
+struct TextureFileView {
+    TextureFormat format = TextureFormatRGBA8;
+    uint32_t width = 0, height = 0;
+    std::vector<TextureLevel> levels;
+};
+
+// Encodes `rgba` and, with `mipmaps`, every smaller level down to 1x1 as
+// `format`, and returns the whole file. The levels come from generateMips
+// with `filter`, sRGB-aware unless `srgb` is false, as for normal maps and
+// other data that is not color.
+std::vector<uint8_t> cookTexture(const uint32_t *rgba, uint32_t width, uint32_t height, TextureFormat format,
+    bool mipmaps = true, ThreadPool *pool = nullptr, MipFilter filter = MipFilterKaiser, bool srgb = true);
+
+// Points `view` at the levels inside `data`, which must outlive it. Returns
+// false unless `data` holds a whole file this version wrote.
+bool parseTextureFile(const uint8_t *data, size_t size, TextureFileView& view);
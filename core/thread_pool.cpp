@@ -0,0 +1,122 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned worker_count) {
+    d_workers.reserve(worker_count);
+
+    for (unsigned i = 0; i < worker_count; ++i) {
+        d_workers.emplace_back(&ThreadPool::workerMain, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(d_mutex);
+        d_stop = true;
+    }
+
+    d_wake.notify_all();
+
+    for (auto& worker : d_workers) {
+        worker.join();
+    }
+}
+
+void
+ThreadPool::parallelFor(size_t count, size_t grain, const Function& f) {
+    if (count == 0) {
+        return;
+    }
+
+    grain = std::max<size_t>(grain, 1);
+    size_t chunks = (count + grain - 1) / grain;
+
+    if (d_workers.empty() || chunks == 1) {
+        f(0, count);
+        return;
+    }
+
+    std::lock_guard<std::mutex> submit_lock(d_submit_mutex);
+
+    {
+        std::lock_guard<std::mutex> lock(d_mutex);
+        d_function = &f;
+        d_count = count;
+        d_grain = grain;
+        d_chunks = chunks;
+        d_next.store(0);
+        d_pending.store(chunks);
+        ++d_generation;
+    }
+
+    d_wake.notify_all();
+
+    runChunks();
+
+    // Wait for stragglers to leave `runChunks` too, so none of them can read
+    // the job state while the next loop is being set up.
+    std::unique_lock<std::mutex> lock(d_mutex);
+    d_done.wait(lock, [this] {
+        return d_pending.load() == 0 && d_busy == 0;
+    });
+
+    d_function = nullptr;
+}
+
+unsigned
+ThreadPool::defaultWorkerCount() {
+    unsigned hardware = std::thread::hardware_concurrency();
+    return hardware > 1 ? hardware - 1 : 0;
+}
+
+void
+ThreadPool::workerMain() {
+    uint64_t seen = 0;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(d_mutex);
+            d_wake.wait(lock, [&] {
+                return d_stop || (d_generation != seen && d_function);
+            });
+
+            if (d_stop) {
+                return;
+            }
+
+            seen = d_generation;
+            ++d_busy;
+        }
+
+        runChunks();
+
+        {
+            std::lock_guard<std::mutex> lock(d_mutex);
+            --d_busy;
+        }
+
+        d_done.notify_all();
+    }
+}
+
+void
+ThreadPool::runChunks() {
+    for (;;) {
+        size_t chunk = d_next.fetch_add(1);
+
+        if (chunk >= d_chunks) {
+            break;
+        }
+
+        size_t begin = chunk * d_grain;
+        size_t end = std::min(begin + d_grain, d_count);
+
+        (*d_function)(begin, end);
+
+        if (d_pending.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lock(d_mutex);
+            d_done.notify_all();
+        }
+    }
+}
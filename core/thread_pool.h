@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that run one data-parallel loop at a time.
+class ThreadPool {
+public:
+
+    using Function = std::function<void(size_t begin, size_t end)>;
+
+    // The calling thread also works on each loop, so `worker_count` is one
+    // less than the number of threads that end up busy.
+    explicit ThreadPool(unsigned worker_count = defaultWorkerCount());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Runs `f` over [0, count) in chunks of at most `grain` items and returns
+    // once every chunk has finished.
+    void parallelFor(size_t count, size_t grain, const Function& f);
+
+    unsigned threadCount() const {
+        return (unsigned)d_workers.size() + 1;
+    }
+
+    static unsigned defaultWorkerCount();
+
+private:
+
+    void workerMain();
+    void runChunks();
+
+    std::vector<std::thread> d_workers;
+
+    std::mutex d_submit_mutex;
+
+    std::mutex d_mutex;
+    std::condition_variable d_wake, d_done;
+    uint64_t d_generation = 0;
+    unsigned d_busy = 0;
+    bool d_stop = false;
+
+    const Function *d_function = nullptr;
+    size_t d_count = 0, d_grain = 0, d_chunks = 0;
+    std::atomic<size_t> d_next { 0 }, d_pending { 0 };
+};
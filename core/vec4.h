@@ -0,0 +1,148 @@
+#pragma once
+
+// Minimal 4-wide float vector over SSE2 or NEON, with a scalar fallback.
+// Only what the CPU kernels in this directory need; lanes are independent.
+
+#include <cmath>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define VEC4_SSE2 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define VEC4_NEON 1
+#endif
+
+struct Vec4f {
+#if VEC4_SSE2
+    __m128 v;
+#elif VEC4_NEON
+    float32x4_t v;
+#else
+    float v[4];
+#endif
+
+    static Vec4f load(const float *p) {
+        Vec4f r;
+#if VEC4_SSE2
+        r.v = _mm_loadu_ps(p);
+#elif VEC4_NEON
+        r.v = vld1q_f32(p);
+#else
+        for (int i = 0; i < 4; ++i) r.v[i] = p[i];
+#endif
+        return r;
+    }
+
+    static Vec4f broadcast(float x) {
+        Vec4f r;
+#if VEC4_SSE2
+        r.v = _mm_set1_ps(x);
+#elif VEC4_NEON
+        r.v = vdupq_n_f32(x);
+#else
+        for (int i = 0; i < 4; ++i) r.v[i] = x;
+#endif
+        return r;
+    }
+
+    void store(float *p) const {
+#if VEC4_SSE2
+        _mm_storeu_ps(p, v);
+#elif VEC4_NEON
+        vst1q_f32(p, v);
+#else
+        for (int i = 0; i < 4; ++i) p[i] = v[i];
+#endif
+    }
+};
+
+// Comparison results: all-ones lanes where true.
+struct Mask4 {
+#if VEC4_SSE2
+    __m128 m;
+#elif VEC4_NEON
+    uint32x4_t m;
+#else
+    bool m[4];
+#endif
+
+    // Bit i set when lane i is true.
+    int bits() const {
+#if VEC4_SSE2
+        return _mm_movemask_ps(m);
+#elif VEC4_NEON
+        static const int32_t shifts[4] = { 0, 1, 2, 3 };
+        uint32x4_t one = vshrq_n_u32(m, 31);
+        return (int)vaddvq_u32(vshlq_u32(one, vld1q_s32(shifts)));
+#else
+        return (m[0] ? 1 : 0) | (m[1] ? 2 : 0) | (m[2] ? 4 : 0) | (m[3] ? 8 : 0);
+#endif
+    }
+};
+
+#if VEC4_SSE2
+
+inline Vec4f operator+(Vec4f a, Vec4f b) { return { _mm_add_ps(a.v, b.v) }; }
+inline Vec4f operator-(Vec4f a, Vec4f b) { return { _mm_sub_ps(a.v, b.v) }; }
+inline Vec4f operator*(Vec4f a, Vec4f b) { return { _mm_mul_ps(a.v, b.v) }; }
+inline Vec4f operator/(Vec4f a, Vec4f b) { return { _mm_div_ps(a.v, b.v) }; }
+inline Vec4f operator-(Vec4f a) { return { _mm_xor_ps(a.v, _mm_set1_ps(-0.0f)) }; }
+inline Vec4f min(Vec4f a, Vec4f b) { return { _mm_min_ps(a.v, b.v) }; }
+inline Vec4f max(Vec4f a, Vec4f b) { return { _mm_max_ps(a.v, b.v) }; }
+inline Vec4f sqrt(Vec4f a) { return { _mm_sqrt_ps(a.v) }; }
+inline Mask4 operator<(Vec4f a, Vec4f b) { return { _mm_cmplt_ps(a.v, b.v) }; }
+inline Mask4 operator>(Vec4f a, Vec4f b) { return { _mm_cmpgt_ps(a.v, b.v) }; }
+inline Mask4 operator<=(Vec4f a, Vec4f b) { return { _mm_cmple_ps(a.v, b.v) }; }
+inline Mask4 operator>=(Vec4f a, Vec4f b) { return { _mm_cmpge_ps(a.v, b.v) }; }
+inline Mask4 operator|(Mask4 a, Mask4 b) { return { _mm_or_ps(a.m, b.m) }; }
+inline Mask4 operator&(Mask4 a, Mask4 b) { return { _mm_and_ps(a.m, b.m) }; }
+inline Vec4f select(Mask4 m, Vec4f a, Vec4f b) { return { _mm_or_ps(_mm_and_ps(m.m, a.v), _mm_andnot_ps(m.m, b.v)) }; }
+
+#elif VEC4_NEON
+
+inline Vec4f operator+(Vec4f a, Vec4f b) { return { vaddq_f32(a.v, b.v) }; }
+inline Vec4f operator-(Vec4f a, Vec4f b) { return { vsubq_f32(a.v, b.v) }; }
+inline Vec4f operator*(Vec4f a, Vec4f b) { return { vmulq_f32(a.v, b.v) }; }
+inline Vec4f operator/(Vec4f a, Vec4f b) { return { vdivq_f32(a.v, b.v) }; }
+inline Vec4f operator-(Vec4f a) { return { vnegq_f32(a.v) }; }
+inline Vec4f min(Vec4f a, Vec4f b) { return { vminq_f32(a.v, b.v) }; }
+inline Vec4f max(Vec4f a, Vec4f b) { return { vmaxq_f32(a.v, b.v) }; }
+inline Vec4f sqrt(Vec4f a) { return { vsqrtq_f32(a.v) }; }
+inline Mask4 operator<(Vec4f a, Vec4f b) { return { vcltq_f32(a.v, b.v) }; }
+inline Mask4 operator>(Vec4f a, Vec4f b) { return { vcgtq_f32(a.v, b.v) }; }
+inline Mask4 operator<=(Vec4f a, Vec4f b) { return { vcleq_f32(a.v, b.v) }; }
+inline Mask4 operator>=(Vec4f a, Vec4f b) { return { vcgeq_f32(a.v, b.v) }; }
+inline Mask4 operator|(Mask4 a, Mask4 b) { return { vorrq_u32(a.m, b.m) }; }
+inline Mask4 operator&(Mask4 a, Mask4 b) { return { vandq_u32(a.m, b.m) }; }
+inline Vec4f select(Mask4 m, Vec4f a, Vec4f b) { return { vbslq_f32(m.m, a.v, b.v) }; }
+
+#else
+
+#define VEC4_SCALAR_BINARY(op, expr) \
+    inline Vec4f op(Vec4f a, Vec4f b) { Vec4f r; for (int i = 0; i < 4; ++i) r.v[i] = (expr); return r; }
+#define VEC4_SCALAR_COMPARE(op, cmp) \
+    inline Mask4 op(Vec4f a, Vec4f b) { Mask4 r; for (int i = 0; i < 4; ++i) r.m[i] = a.v[i] cmp b.v[i]; return r; }
+
+VEC4_SCALAR_BINARY(operator+, a.v[i] + b.v[i])
+VEC4_SCALAR_BINARY(operator-, a.v[i] - b.v[i])
+VEC4_SCALAR_BINARY(operator*, a.v[i] * b.v[i])
+VEC4_SCALAR_BINARY(operator/, a.v[i] / b.v[i])
+VEC4_SCALAR_BINARY(min, b.v[i] < a.v[i] ? b.v[i] : a.v[i])
+VEC4_SCALAR_BINARY(max, a.v[i] < b.v[i] ? b.v[i] : a.v[i])
+VEC4_SCALAR_COMPARE(operator<, <)
+VEC4_SCALAR_COMPARE(operator>, >)
+VEC4_SCALAR_COMPARE(operator<=, <=)
+VEC4_SCALAR_COMPARE(operator>=, >=)
+
+#undef VEC4_SCALAR_BINARY
+#undef VEC4_SCALAR_COMPARE
+
+inline Vec4f operator-(Vec4f a) { Vec4f r; for (int i = 0; i < 4; ++i) r.v[i] = -a.v[i]; return r; }
+inline Vec4f sqrt(Vec4f a) { Vec4f r; for (int i = 0; i < 4; ++i) r.v[i] = std::sqrt(a.v[i]); return r; }
+inline Mask4 operator|(Mask4 a, Mask4 b) { Mask4 r; for (int i = 0; i < 4; ++i) r.m[i] = a.m[i] || b.m[i]; return r; }
+inline Mask4 operator&(Mask4 a, Mask4 b) { Mask4 r; for (int i = 0; i < 4; ++i) r.m[i] = a.m[i] && b.m[i]; return r; }
+inline Vec4f select(Mask4 m, Vec4f a, Vec4f b) { Vec4f r; for (int i = 0; i < 4; ++i) r.v[i] = m.m[i] ? a.v[i] : b.v[i]; return r; }
+
+#endif
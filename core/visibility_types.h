@@ -0,0 +1,48 @@
+/*
+Header containing types, enum constants and helpers shared between the
+visibility buffer shaders and C++ code, including the CPU reference renderer
+*/
+
+#ifndef visibility_types_H
+#define visibility_types_H
+
+#ifndef __METAL_VERSION__
+#include <stdint.h>
+#endif
+
+// A visibility buffer texel is the instance ID in the high bits and the
+// primitive ID within that instance in the low bits.
+#define VISIBILITY_PRIMITIVE_BITS 20
+#define VISIBILITY_MAX_PRIMITIVES (1u << VISIBILITY_PRIMITIVE_BITS)
+#define VISIBILITY_MAX_INSTANCES ((1u << (32 - VISIBILITY_PRIMITIVE_BITS)) - 1)
+
+// Clear value; no instance reaches VISIBILITY_MAX_INSTANCES, so this is never
+// a valid ID.
+#define VISIBILITY_EMPTY 0xffffffffu
+
+// Buffer and texture indices for the kernel that shades the visibility buffer.
+typedef enum VisibilityShadeIndex
+{
+    VisibilityShadeIndexVertices        = 0,
+    VisibilityShadeIndexViewport        = 1,
+    VisibilityShadeIndexViewportSize    = 2,
+    VisibilityShadeIndexVisibility      = 0,
+    VisibilityShadeIndexOutput          = 1,
+} VisibilityShadeIndex;
+
+static inline uint32_t visibilityPack(uint32_t instance, uint32_t primitive)
+{
+    return (instance << VISIBILITY_PRIMITIVE_BITS) | primitive;
+}
+
+static inline uint32_t visibilityInstance(uint32_t value)
+{
+    return value >> VISIBILITY_PRIMITIVE_BITS;
+}
+
+static inline uint32_t visibilityPrimitive(uint32_t value)
+{
+    return value & (VISIBILITY_MAX_PRIMITIVES - 1);
+}
+
+#endif /* visibility_types_H */
@@ -0,0 +1,77 @@
+#include "depth_stencil.h"
+
+#include <iostream>
+
+DepthTarget::DepthTarget(MTL::Device *device, MTL::PixelFormat pixel_format)
+    : d_device(device)
+    , d_pixel_format(pixel_format)
+    , d_memoryless(device->supportsFamily(MTL::GPUFamilyApple1)) {
+}
+
+void
+DepthTarget::attach(MTL::RenderPassDescriptor *pass, NS::UInteger width, NS::UInteger height) {
+    if (!d_depth || d_depth->width() != width || d_depth->height() != height) {
+        auto texture_descriptor = MTL::TextureDescriptor::texture2DDescriptor(d_pixel_format, width, height, false);
+        texture_descriptor->setUsage(MTL::TextureUsageRenderTarget);
+        texture_descriptor->setStorageMode(d_memoryless ? MTL::StorageModeMemoryless : MTL::StorageModePrivate);
+
+        d_depth = MTL::make_owned(d_device->newTexture(texture_descriptor));
+    }
+
+    auto depth_attachment = pass->depthAttachment();
+    depth_attachment->setTexture(d_depth.get());
+    depth_attachment->setLoadAction(MTL::LoadActionClear);
+    depth_attachment->setStoreAction(MTL::StoreActionDontCare);
+    depth_attachment->setClearDepth(1.0);
+}
+
+DepthStencilKey
+DepthStencilKey::depth(MTL::CompareFunction compare, bool write) {
+    DepthStencilKey key;
+    key.bits = uint32_t(compare) | uint32_t(write) << 3;
+    return key.withStencil(MTL::CompareFunctionAlways, MTL::StencilOperationKeep, MTL::StencilOperationKeep,
+        MTL::StencilOperationKeep);
+}
+
+DepthStencilKey
+DepthStencilKey::withStencil(MTL::CompareFunction compare, MTL::StencilOperation stencil_failure,
+    MTL::StencilOperation depth_failure, MTL::StencilOperation pass, uint8_t read_mask, uint8_t write_mask) const {
+    DepthStencilKey key;
+    key.bits = (bits & 0xf) | uint32_t(compare) << 4 | uint32_t(stencil_failure) << 7 |
+               uint32_t(depth_failure) << 10 | uint32_t(pass) << 13 | uint32_t(read_mask) << 16 |
+               uint32_t(write_mask) << 24;
+    return key;
+}
+
+DepthStencilCache::DepthStencilCache(MTL::Device *device) : d_device(device) {
+}
+
+MTL::DepthStencilState *
+DepthStencilCache::get(DepthStencilKey key) {
+    auto state = d_states.acquire(key, [this, key] {
+        auto stencil_descriptor = MTL::make_owned(MTL::StencilDescriptor::alloc()->init());
+        stencil_descriptor->setStencilCompareFunction(MTL::CompareFunction((key.bits >> 4) & 7));
+        stencil_descriptor->setStencilFailureOperation(MTL::StencilOperation((key.bits >> 7) & 7));
+        stencil_descriptor->setDepthFailureOperation(MTL::StencilOperation((key.bits >> 10) & 7));
+        stencil_descriptor->setDepthStencilPassOperation(MTL::StencilOperation((key.bits >> 13) & 7));
+        stencil_descriptor->setReadMask((key.bits >> 16) & 0xff);
+        stencil_descriptor->setWriteMask(key.bits >> 24);
+
+        auto descriptor = MTL::make_owned(MTL::DepthStencilDescriptor::alloc()->init());
+        descriptor->setDepthCompareFunction(key.depthCompare());
+        descriptor->setDepthWriteEnabled(key.depthWrite());
+        descriptor->setFrontFaceStencil(stencil_descriptor.get());
+        descriptor->setBackFaceStencil(stencil_descriptor.get());
+
+        auto state = MTL::make_owned(d_device->newDepthStencilState(descriptor.get()));
+
+        if (!state) {
+            std::cerr << "Failed to create depth stencil state" << std::endl;
+            std::exit(-1);
+        }
+
+        return state;
+    });
+
+    return state->get();
+}
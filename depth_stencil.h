@@ -0,0 +1,99 @@
+#pragma once
+
+#include "state_cache.h"
+#include "string_hash.h"
+
+#include <Metal/Metal.hpp>
+#include <Metal/shared_ptr.hpp>
+
+#include <cstdint>
+
+// Depth attachment for a render pass, cleared to the far plane and never
+// stored, that follows the size of the color target it is attached next to.
+// On Apple GPUs it is memoryless and lives only in tile memory. Pipelines
+// drawn into the pass need a matching `setDepthAttachmentPixelFormat`.
+class DepthTarget {
+public:
+
+    explicit DepthTarget(MTL::Device *device, MTL::PixelFormat pixel_format = MTL::PixelFormatDepth32Float);
+
+    MTL::PixelFormat pixelFormat() const {
+        return d_pixel_format;
+    }
+
+    bool isMemoryless() const {
+        return d_memoryless;
+    }
+
+    // Adds the depth attachment to `pass`, first creating the texture again
+    // if it is not `width` by `height`.
+    void attach(MTL::RenderPassDescriptor *pass, NS::UInteger width, NS::UInteger height);
+
+private:
+
+    MTL::Device *d_device;
+    MTL::PixelFormat d_pixel_format;
+    bool d_memoryless;
+
+    MTL::shared_ptr<MTL::Texture> d_depth;
+};
+
+// A depth and stencil state packed into 32 bits, which are also its hash:
+//
+//     2..0    depth compare function
+//     3       depth write
+//     6..4    stencil compare function
+//     9..7    stencil failure operation
+//     12..10  depth failure operation
+//     15..13  depth and stencil pass operation
+//     23..16  stencil read mask
+//     31..24  stencil write mask
+//
+// Front and back faces share the stencil state. Without `withStencil` the
+// stencil test always passes and keeps the stencil.
+struct DepthStencilKey {
+    uint32_t bits = 0;
+
+    static DepthStencilKey depth(MTL::CompareFunction compare, bool write);
+
+    DepthStencilKey withStencil(MTL::CompareFunction compare, MTL::StencilOperation stencil_failure,
+        MTL::StencilOperation depth_failure, MTL::StencilOperation pass, uint8_t read_mask = 0xff,
+        uint8_t write_mask = 0xff) const;
+
+    MTL::CompareFunction depthCompare() const {
+        return MTL::CompareFunction(bits & 7);
+    }
+
+    bool depthWrite() const {
+        return (bits >> 3) & 1;
+    }
+
+    uint64_t hash() const {
+        return hashName(reinterpret_cast<const char *>(&bits), sizeof(bits));
+    }
+
+    bool operator==(const DepthStencilKey& other) const {
+        return bits == other.bits;
+    }
+};
+
+// Creates each `MTL::DepthStencilState` once and hands out the same object
+// for the same key afterwards, so draws can ask for their state every frame,
+// from any thread. There are only ever a few dozen distinct states, so none
+// is evicted and the pointers stay valid as long as the cache.
+class DepthStencilCache {
+public:
+
+    explicit DepthStencilCache(MTL::Device *device);
+
+    MTL::DepthStencilState *get(DepthStencilKey key);
+
+    size_t size() const {
+        return d_states.size();
+    }
+
+private:
+
+    MTL::Device *d_device;
+    StateCache<DepthStencilKey, MTL::shared_ptr<MTL::DepthStencilState>> d_states;
+};
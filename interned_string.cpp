@@ -0,0 +1,31 @@
+#include "interned_string.h"
+
+#include "intern_table.h"
+
+#include <string>
+
+namespace {
+
+InternTable<NS::String *>&
+internTable() {
+    // Leaked on purpose: strings handed out must outlive static destructors
+    // that might still use them.
+    static auto *table = new InternTable<NS::String *>(256);
+    return *table;
+}
+
+}
+
+NS::String *
+NS::internString(std::string_view name) {
+    return internString(name, hashName(name));
+}
+
+NS::String *
+NS::internString(std::string_view name, uint64_t hash) {
+    return internTable().intern(name, hash, [name]() {
+        // Copies the bytes; `name` need not be terminated. Owned by the table.
+        std::string terminated(name);
+        return String::alloc()->init(terminated.c_str(), UTF8StringEncoding);
+    });
+}
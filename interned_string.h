@@ -0,0 +1,65 @@
+#pragma once
+
+#include "string_hash.h"
+
+#include <Foundation/Foundation.hpp>
+
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+namespace NS {
+
+// A string literal paired with its constant CFString and a hash computed at
+// compile time. Create with `NS_STATIC_STRING("name")`; nothing is allocated,
+// and the `NS::String*` is valid for the life of the process.
+class StaticString {
+public:
+
+    constexpr StaticString(String *string, std::string_view name, uint64_t hash)
+        : d_string(string)
+        , d_name(name)
+        , d_hash(hash) {
+    }
+
+    String *string() const {
+        return d_string;
+    }
+
+    operator String *() const {
+        return d_string;
+    }
+
+    constexpr std::string_view name() const {
+        return d_name;
+    }
+
+    constexpr uint64_t hash() const {
+        return d_hash;
+    }
+
+private:
+
+    String *d_string;
+    std::string_view d_name;
+    uint64_t d_hash;
+};
+
+// Returns the one `NS::String` for `name`, creating it on first use. Meant for
+// names only known at runtime, e.g. read from material files; lookups of a
+// name seen before take no lock and allocate nothing. Interned strings live
+// until the process exits.
+String *internString(std::string_view name);
+
+// As above, with `hash == hashName(name)` already known.
+String *internString(std::string_view name, uint64_t hash);
+
+inline String *
+internString(const StaticString& name) {
+    return name.string();
+}
+
+}
+
+#define NS_STATIC_STRING(literal) \
+    NS::StaticString(MTLSTR(literal), literal, std::integral_constant<uint64_t, hashName(literal, sizeof(literal) - 1)>::value)
@@ -1,4 +1,25 @@
+#include "bindless.h"
+#include "bindless_types.h"
+#include "command_capture.h"
+#include "depth_stencil.h"
+#include "image_io.h"
+#include "interned_string.h"
+#include "mapped_file.h"
+#include "material_renderer.h"
+#include "mesh_renderer.h"
+#include "meshlet_renderer.h"
+#include "multisample.h"
+#include "particle_renderer.h"
+#include "render_states.h"
+#include "scene_renderer.h"
+#include "shader_reload.h"
+#include "sprite_renderer.h"
+#include "text_renderer.h"
+#include "texture_upload.h"
+#include "tiled_deferred.h"
 #include "triangle_types.h"
+#include "visibility_buffer.h"
+#include "vrs.h"
 
 #include <Foundation/Foundation.hpp>
 #include <Metal/Metal.hpp>
@@ -7,7 +28,13 @@
 
 #include <SDL.h>
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
 
 namespace {
 
@@ -28,10 +55,149 @@ const vector_uint2 viewport = {
     640, 480
 };
 
+// Screen pixels covered by one cell of the VRS importance grid.
+const uint32_t vrs_tile_size = 32;
+
 }
 
 int
 main(int argc, char **argv) {
+    bool vrs_enabled = false;
+    bool bindless_enabled = false;
+    bool hot_reload = false;
+    bool particles_enabled = false, particles_on_cpu = false, particles_validate = false;
+    bool materials_enabled = false;
+    uint32_t particle_count = 1 << 20;
+    const char *vrs_preview_path = nullptr, *vrs_importance_path = nullptr;
+    const char *record_path = nullptr, *replay_path = nullptr;
+    bool cached_dispatch = false;
+    bool visibility_enabled = false;
+    bool tiled_lighting_enabled = false;
+    uint32_t light_count = 64;
+    bool msaa_enabled = false;
+    bool depth_enabled = false;
+    uint32_t sprite_count = 0;
+    bool compressed_sprites = false;
+    bool text_enabled = false;
+    uint32_t scene_node_count = 0;
+    bool mesh_enabled = false;
+    const char *mesh_path = nullptr;
+    uint32_t meshlet_detail = 0;
+    const char *meshlet_path_name = nullptr;
+    bool occlusion_enabled = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--vrs") == 0) {
+            vrs_enabled = true;
+        }
+        else if (std::strcmp(argv[i], "--vrs-preview") == 0 && i + 1 < argc) {
+            vrs_enabled = true;
+            vrs_preview_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--vrs-importance") == 0 && i + 1 < argc) {
+            vrs_enabled = true;
+            vrs_importance_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--bindless") == 0) {
+            bindless_enabled = true;
+        }
+        else if (std::strcmp(argv[i], "--hot-reload") == 0) {
+            hot_reload = true;
+        }
+        else if (std::strcmp(argv[i], "--particles") == 0) {
+            particles_enabled = true;
+        }
+        else if (std::strcmp(argv[i], "--particles-cpu") == 0) {
+            particles_enabled = particles_on_cpu = true;
+        }
+        else if (std::strcmp(argv[i], "--particles-validate") == 0) {
+            particles_enabled = particles_validate = true;
+        }
+        else if (std::strcmp(argv[i], "--materials") == 0) {
+            materials_enabled = true;
+        }
+        else if (std::strcmp(argv[i], "--particle-count") == 0 && i + 1 < argc) {
+            particle_count = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--cached-dispatch") == 0) {
+            cached_dispatch = true;
+        }
+        else if (std::strcmp(argv[i], "--visibility-buffer") == 0) {
+            visibility_enabled = true;
+        }
+        else if (std::strcmp(argv[i], "--tiled-lighting") == 0) {
+            tiled_lighting_enabled = true;
+        }
+        else if (std::strcmp(argv[i], "--lights") == 0 && i + 1 < argc) {
+            tiled_lighting_enabled = true;
+            light_count = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--msaa") == 0) {
+            msaa_enabled = true;
+        }
+        else if (std::strcmp(argv[i], "--depth") == 0) {
+            depth_enabled = true;
+        }
+        else if (std::strcmp(argv[i], "--sprites") == 0 && i + 1 < argc) {
+            sprite_count = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--compressed-sprites") == 0) {
+            compressed_sprites = true;
+        }
+        else if (std::strcmp(argv[i], "--text") == 0) {
+            text_enabled = true;
+        }
+        else if (std::strcmp(argv[i], "--scene") == 0 && i + 1 < argc) {
+            scene_node_count = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--mesh") == 0) {
+            mesh_enabled = true;
+        }
+        else if (std::strcmp(argv[i], "--load") == 0 && i + 1 < argc) {
+            mesh_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--meshlets") == 0 && i + 1 < argc) {
+            meshlet_detail = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--meshlet-path") == 0 && i + 1 < argc) {
+            meshlet_path_name = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--occlusion") == 0) {
+            occlusion_enabled = true;
+        }
+    }
+
+    // The shading pass reconstructs the plain triangle pipeline only, at
+    // screen resolution.
+    if (visibility_enabled && (vrs_enabled || bindless_enabled || replay_path)) {
+        std::cerr << "--visibility-buffer cannot be combined with --vrs, --bindless or --replay; visibility buffer disabled" << std::endl;
+        visibility_enabled = false;
+    }
+
+    // Likewise for the G-buffer pass.
+    if (tiled_lighting_enabled && (vrs_enabled || bindless_enabled || replay_path || visibility_enabled)) {
+        std::cerr << "--tiled-lighting cannot be combined with --vrs, --bindless, --replay or --visibility-buffer; tiled lighting disabled" << std::endl;
+        tiled_lighting_enabled = false;
+    }
+
+    // Those modes own the render pass, and VRS renders into its own target.
+    if (msaa_enabled && (vrs_enabled || visibility_enabled || tiled_lighting_enabled)) {
+        std::cerr << "--msaa cannot be combined with --vrs, --visibility-buffer or --tiled-lighting; MSAA disabled" << std::endl;
+        msaa_enabled = false;
+    }
+
+    // The rate-mapped target would need a depth attachment of its own.
+    if (depth_enabled && vrs_enabled) {
+        std::cerr << "--depth cannot be combined with --vrs; depth disabled" << std::endl;
+        depth_enabled = false;
+    }
+
     SDL_SetHint(SDL_HINT_RENDER_DRIVER, "metal");
     SDL_InitSubSystem(SDL_INIT_VIDEO);
     SDL_Window *window = SDL_CreateWindow("SDL Metal", -1, -1, viewport[0], viewport[1], SDL_WINDOW_ALLOW_HIGHDPI);
@@ -57,31 +223,273 @@ main(int argc, char **argv) {
         std::exit(-1);
     }
 
-    auto vertex_function_name = NS::String::string("vertexShader", NS::ASCIIStringEncoding);
-    auto vertex_function = MTL::make_owned(library->newFunction(vertex_function_name));
+    auto pixel_format = swapchain->pixelFormat();
+
+    NS::UInteger raster_sample_count = 1;
+
+    if (msaa_enabled) {
+        if (MultisampleTarget::isSupported(device, 4)) {
+            raster_sample_count = 4;
+        }
+        else {
+            std::cerr << "4x multisampling is not supported; MSAA disabled" << std::endl;
+        }
+    }
+
+    std::unique_ptr<DepthTarget> depth;
+    std::unique_ptr<DepthStencilCache> depth_states;
+
+    if (depth_enabled) {
+        depth = std::make_unique<DepthTarget>(device);
+        depth_states = std::make_unique<DepthStencilCache>(device);
+    }
+
+    auto depth_pixel_format = depth ? depth->pixelFormat() : MTL::PixelFormatInvalid;
+
+    // The triangle shares the depth attachment only in the plain pass; the
+    // other modes render it into passes of their own.
+    bool triangle_depth = depth && raster_sample_count == 1 && !visibility_enabled && !tiled_lighting_enabled;
+    auto triangle_depth_pixel_format = triangle_depth ? depth_pixel_format : MTL::PixelFormatInvalid;
+
+    // Also used by the shader reloader, on its own thread.
+    auto build_pipeline = [device, pixel_format, triangle_depth_pixel_format, raster_sample_count, bindless_enabled](MTL::Library *library) {
+        NS::Error *err;
 
-    auto fragment_function_name = NS::String::string("fragmentShader", NS::ASCIIStringEncoding);
-    auto fragment_function = MTL::make_owned(library->newFunction(fragment_function_name));
+        auto vertex_function_name = bindless_enabled ? NS_STATIC_STRING("vertexShaderBindless") : NS_STATIC_STRING("vertexShader");
+        auto vertex_function = MTL::make_owned(library->newFunction(vertex_function_name));
 
-    auto pipeline_descriptor = MTL::make_owned(MTL::RenderPipelineDescriptor::alloc()->init());
-    pipeline_descriptor->setVertexFunction(vertex_function.get());
-    pipeline_descriptor->setFragmentFunction(fragment_function.get());
+        auto fragment_function_name = NS_STATIC_STRING("fragmentShader");
+        auto fragment_function = MTL::make_owned(library->newFunction(fragment_function_name));
 
-    auto color_attachment_descriptor = pipeline_descriptor->colorAttachments()->object(0);
-    color_attachment_descriptor->setPixelFormat(swapchain->pixelFormat());
+        auto pipeline_descriptor = MTL::make_owned(MTL::RenderPipelineDescriptor::alloc()->init());
+        pipeline_descriptor->setVertexFunction(vertex_function.get());
+        pipeline_descriptor->setFragmentFunction(fragment_function.get());
+        pipeline_descriptor->setRasterSampleCount(raster_sample_count);
+        pipeline_descriptor->setDepthAttachmentPixelFormat(triangle_depth_pixel_format);
+
+        auto color_attachment_descriptor = pipeline_descriptor->colorAttachments()->object(0);
+        color_attachment_descriptor->setPixelFormat(pixel_format);
+
+        auto pipeline = MTL::make_owned(device->newRenderPipelineState(pipeline_descriptor.get(), &err));
+
+        if (!pipeline) {
+            std::cerr << "Failed to create pipeline" << std::endl;
+        }
 
-    auto pipeline = MTL::make_owned(device->newRenderPipelineState(pipeline_descriptor.get(), &err));
+        return pipeline;
+    };
+
+    auto pipeline = build_pipeline(library.get());
 
     if (!pipeline) {
-        std::cerr << "Failed to create pipeline" << std::endl;
         std::exit(-1);
     }
 
+    std::unique_ptr<ShaderReloader> reloader;
+
+    if (hot_reload) {
+        reloader = std::make_unique<ShaderReloader>(device, SDL_METAL_SOURCE_DIR, SDL_METAL_SOURCE_STANDARDS);
+        reloader->add("triangle.metal", build_pipeline);
+        reloader->start();
+    }
+
     auto queue = MTL::make_owned(device->newCommandQueue());
 
+    std::unique_ptr<BindlessResources> bindless;
+    BindlessDrawArguments bindless_draw;
+
+    if (bindless_enabled) {
+        bindless = std::make_unique<BindlessResources>(device);
+
+        auto vertex_buffer = MTL::make_owned(device->newBuffer(&triangleVertices[0], sizeof(triangleVertices), MTL::ResourceStorageModeShared));
+        auto viewport_buffer = MTL::make_owned(device->newBuffer(&viewport, sizeof(viewport), MTL::ResourceStorageModeShared));
+
+        bindless_draw.vertices = bindless->addBuffer(vertex_buffer.get()).index;
+        bindless_draw.viewportSize = bindless->addBuffer(viewport_buffer.get()).index;
+    }
+
+    std::unique_ptr<ParticleRenderer> particles;
+
+    if (particles_enabled) {
+        particles = std::make_unique<ParticleRenderer>(device, pixel_format, depth_pixel_format, particle_count, particles_on_cpu);
+
+        if (particles_validate) {
+            particles->validate(queue.get());
+        }
+    }
+
+    std::unique_ptr<MaterialRenderer> materials;
+
+    if (materials_enabled) {
+        if (MaterialRenderer::isSupported(device)) {
+            materials = std::make_unique<MaterialRenderer>(device, pixel_format, depth_pixel_format);
+        }
+        else {
+            std::cerr << "Function pointers in render pipelines are not supported; materials disabled" << std::endl;
+        }
+    }
+
+    std::unique_ptr<SceneRenderer> scene;
+
+    if (scene_node_count > 0) {
+        scene = std::make_unique<SceneRenderer>(device, pixel_format, depth_pixel_format,
+            &triangleVertices[0], sizeof(triangleVertices) / sizeof(triangleVertices[0]), scene_node_count);
+    }
+
+    std::unique_ptr<MeshRenderer> mesh;
+
+    if (mesh_path) {
+        mesh = std::make_unique<MeshRenderer>(device, pixel_format, depth_pixel_format, mesh_path);
+    }
+    else if (mesh_enabled) {
+        std::vector<AAPLVertex> soup = rosetteTriangles(48, 192, 7);
+        mesh = std::make_unique<MeshRenderer>(device, pixel_format, depth_pixel_format, soup.data(), soup.size());
+    }
+
+    std::unique_ptr<MeshletRenderer> meshlets;
+
+    if (meshlet_detail > 0) {
+        // Mesh shaders where the GPU has them, unless asked otherwise.
+        MeshletPath path = MeshletRenderer::supportsMeshShaders(device) ? MeshletPathMeshShader : MeshletPathCompute;
+
+        if (meshlet_path_name && std::strcmp(meshlet_path_name, "cpu") == 0) {
+            path = MeshletPathCpu;
+        }
+        else if (meshlet_path_name && std::strcmp(meshlet_path_name, "compute") == 0) {
+            path = MeshletPathCompute;
+        }
+
+        meshlets = std::make_unique<MeshletRenderer>(device, pixel_format, depth_pixel_format, meshlet_detail, path);
+
+        if (occlusion_enabled) {
+            meshlets->enableOcclusionQueries(device, depth_states.get());
+        }
+    }
+    else if (occlusion_enabled) {
+        std::cerr << "--occlusion only applies to --meshlets; occlusion queries disabled" << std::endl;
+    }
+
+    // Samplers for the overlays, made once and shared between them.
+    SamplerCache samplers(device);
+
+    std::unique_ptr<TextureUploader> uploader;
+    std::unique_ptr<SpriteRenderer> sprites;
+
+    if (sprite_count > 0) {
+        uploader = std::make_unique<TextureUploader>(device, queue.get());
+        sprites = std::make_unique<SpriteRenderer>(device, &samplers, pixel_format, depth_pixel_format, sprite_count,
+            compressed_sprites, uploader.get());
+    }
+
+    std::unique_ptr<TextRenderer> text;
+
+    if (text_enabled) {
+        text = std::make_unique<TextRenderer>(device, &samplers, pixel_format, depth_pixel_format);
+    }
+
+    std::unique_ptr<VariableRateShading> vrs;
+
+    if (vrs_enabled) {
+        if (device->supportsRasterizationRateMap(1)) {
+            vrs = std::make_unique<VariableRateShading>(device, pixel_format);
+        }
+        else {
+            std::cerr << "Rasterization rate maps are not supported; VRS disabled" << std::endl;
+        }
+    }
+
+    // Rates from the detail in an image instead of foveation, as if it were
+    // the previous frame.
+    ImportanceGrid vrs_importance;
+
+    if (vrs && vrs_importance_path) {
+        std::vector<uint32_t> rgba;
+        uint32_t width, height;
+
+        if (readPPM(vrs_importance_path, rgba, width, height)) {
+            vrs_importance = luminanceVarianceImportance(
+                (const uint8_t *)rgba.data(), width, height, width * 4, vrs_tile_size);
+        }
+        else {
+            std::cerr << "Failed to read " << vrs_importance_path << std::endl;
+        }
+    }
+
+    std::unique_ptr<VisibilityBuffer> visibility;
+
+    if (visibility_enabled) {
+        // The shading kernel writes straight into the drawable.
+        swapchain->setFramebufferOnly(false);
+        visibility = std::make_unique<VisibilityBuffer>(device);
+    }
+
+    std::unique_ptr<TiledDeferredLighting> tiled_lighting;
+
+    if (tiled_lighting_enabled) {
+        if (TiledDeferredLighting::isSupported(device)) {
+            tiled_lighting = std::make_unique<TiledDeferredLighting>(device, pixel_format, light_count);
+        }
+        else {
+            std::cerr << "Tile shaders are not supported; tiled lighting disabled" << std::endl;
+        }
+    }
+
+    std::unique_ptr<MultisampleTarget> msaa;
+
+    if (raster_sample_count > 1) {
+        msaa = std::make_unique<MultisampleTarget>(device, pixel_format, raster_sample_count);
+    }
+
+    // Modes whose pass has no plain color target draw the mesh, meshlets,
+    // scene, particles, materials, sprites and text in a pass of their own
+    // afterwards; with MSAA they are simply not antialiased. So does a plain
+    // pass without the depth attachment they were built for.
+    bool draw_in_overlay = visibility || tiled_lighting || msaa || (depth && !triangle_depth);
+
+    std::unique_ptr<CommandLogWriter> recorder;
+
+    if (record_path) {
+        recorder = std::make_unique<CommandLogWriter>();
+
+        if (!recorder->open(record_path)) {
+            std::cerr << "Failed to open " << record_path << " for recording" << std::endl;
+            std::exit(-1);
+        }
+    }
+
+    MappedFile replay_file;
+    std::unique_ptr<CommandLogReader> replay;
+    std::unique_ptr<MetalReplaySink> replay_sink;
+
+    if (replay_path) {
+        if (!replay_file.open(replay_path)) {
+            std::cerr << "Failed to map " << replay_path << std::endl;
+            std::exit(-1);
+        }
+
+        replay = std::make_unique<CommandLogReader>(replay_file.data(), replay_file.size());
+
+        if (!replay->valid()) {
+            std::cerr << replay_path << " is not a command log" << std::endl;
+            std::exit(-1);
+        }
+
+        // Only the plain triangle pipeline can be rebuilt from a log; draws
+        // recorded with the bindless one are dropped.
+        replay_sink = std::make_unique<MetalReplaySink>();
+        replay_sink->setPipeline("triangle", pipeline.get());
+    }
+
+    uint64_t frame = 0;
     bool quit = false;
     SDL_Event e;
 
+    const MTL::Viewport triangle_viewport {
+        0.0f, 0.0f,
+        (double)viewport[0], (double)viewport[1],
+        0.0f, 1.0f
+    };
+
     while (!quit) {
         while (SDL_PollEvent(&e) != 0) {
             switch (e.type) {
@@ -91,41 +499,298 @@ main(int argc, char **argv) {
             }
         }
 
+        // Frame boundary: nothing from the previous frame is being encoded.
+        if (reloader) {
+            if (reloader->take("triangle.metal", pipeline) && replay_sink) {
+                replay_sink->setPipeline("triangle", pipeline.get());
+            }
+        }
+
         auto drawable = swapchain->nextDrawable();
+        auto drawable_texture = drawable->texture();
+
+        MTL::shared_ptr<MTL::RenderPassDescriptor> pass;
+
+        if (vrs) {
+            auto screen_width = drawable_texture->width(), screen_height = drawable_texture->height();
+
+            if (vrs->screenWidth() != screen_width || vrs->screenHeight() != screen_height) {
+                // Otherwise foveate around the center of the window.
+                auto importance = vrs_importance;
+
+                if (importance.values.empty()) {
+                    uint32_t grid_width = (screen_width + vrs_tile_size - 1) / vrs_tile_size;
+                    uint32_t grid_height = (screen_height + vrs_tile_size - 1) / vrs_tile_size;
+                    importance = foveatedImportance(
+                        grid_width, grid_height,
+                        grid_width * 0.5f, grid_height * 0.5f,
+                        std::max(grid_width, grid_height) * 0.5f);
+                }
+
+                auto layer = buildRateMapLayer(importance);
+
+                vrs->update(layer, screen_width, screen_height);
 
-        auto pass = MTL::make_owned(MTL::RenderPassDescriptor::renderPassDescriptor());
+                uint32_t physical_width, physical_height;
+                rateMapPhysicalSize(layer, screen_width, screen_height, &physical_width, &physical_height);
+                std::cerr << "vrs: " << screen_width << "x" << screen_height << " shaded at about "
+                          << physical_width << "x" << physical_height << std::endl;
+
+                if (vrs_preview_path) {
+                    auto preview = previewRateMap(layer, screen_width, screen_height);
+                    if (!writePGM(vrs_preview_path, preview.data(), screen_width, screen_height)) {
+                        std::cerr << "Failed to write " << vrs_preview_path << std::endl;
+                    }
+                }
+            }
+
+            pass = vrs->renderPass();
+        }
+        else if (visibility) {
+            pass = visibility->geometryPass(drawable_texture->width(), drawable_texture->height());
+        }
+        else if (tiled_lighting) {
+            pass = tiled_lighting->renderPass(drawable_texture);
+        }
+        else if (msaa) {
+            pass = msaa->renderPass(drawable_texture);
+        }
+        else {
+            pass = MTL::make_owned(MTL::RenderPassDescriptor::renderPassDescriptor());
 
-        auto color_attachment = pass->colorAttachments()->object(0);
-        color_attachment->setLoadAction(MTL::LoadAction::LoadActionClear);
-        color_attachment->setStoreAction(MTL::StoreAction::StoreActionStore);
-        color_attachment->setTexture(drawable->texture());
+            auto color_attachment = pass->colorAttachments()->object(0);
+            color_attachment->setLoadAction(MTL::LoadAction::LoadActionClear);
+            color_attachment->setStoreAction(MTL::StoreAction::StoreActionStore);
+            color_attachment->setTexture(drawable_texture);
+
+            if (triangle_depth) {
+                depth->attach(pass.get(), drawable_texture->width(), drawable_texture->height());
+            }
+
+            if (meshlets && !draw_in_overlay) {
+                pass->setVisibilityResultBuffer(meshlets->visibilityResultBuffer());
+            }
+        }
 
         //
         auto buffer = MTL::make_owned(queue->commandBuffer());
 
+        if (particles) {
+            particles->update(buffer.get(), 1.0f / 60.0f);
+        }
+
+        if (scene) {
+            scene->update(frame / 60.0f);
+        }
+
+        // Every couple of seconds the first tile takes the next material,
+        // relinking when that changes which functions are in use.
+        if (materials && frame % 120 == 0) {
+            materials->setTileMaterial(0, (uint32_t)(frame / 120 % materials->materialCount()));
+        }
+
+        if (meshlets) {
+            meshlets->update(buffer.get(), frame / 60.0f, viewport);
+        }
+
+        if (sprites) {
+            sprites->update(1.0f / 60.0f);
+        }
+
+        if (text) {
+            TextStyle style;
+            style.max_width = viewport[0] - 16.0f;
+
+            float left = viewport[0] * -0.5f + 8.0f;
+            float top = viewport[1] * 0.5f - 8.0f - text->ascent(style);
+
+            std::string hud = "frame " + std::to_string(frame);
+
+            for (int i = 1; i < argc; ++i) {
+                hud += std::string(" ") + argv[i];
+            }
+
+            text->add(hud.c_str(), left, top, style);
+        }
+
         //
         auto encoder = MTL::make_owned(buffer->renderCommandEncoder(pass.get()));
 
-        encoder->setViewport(MTL::Viewport {
-            0.0f, 0.0f,
-            (double)viewport[0], (double)viewport[1],
-            0.0f, 1.0f
-         });
+        if (replay) {
+            replay_sink->setEncoder(encoder.get());
+
+            // Loop the log; a malformed frame ends the replay.
+            if (!replay->replayFrame(*replay_sink) && !replay->failed()) {
+                replay->rewind();
+                replay->replayFrame(*replay_sink);
+            }
+        }
+        else {
+            if (recorder) {
+                recorder->beginFrame(frame);
+            }
+
+            CapturingEncoder capture(encoder.get(), recorder.get(), cached_dispatch);
+
+            capture.setViewport(triangle_viewport);
+
+            if (tiled_lighting) {
+                tiled_lighting->beginFrame(encoder.get(), frame / 60.0f);
+            }
+
+            if (bindless) {
+                // The argument table itself is not captured.
+                capture.setRenderPipelineState(pipeline.get(), "triangle-bindless");
+                bindless->bind(encoder.get(), AAPLVertexInputIndexBindlessTable);
+                capture.setVertexBytes(&bindless_draw, sizeof(bindless_draw), AAPLVertexInputIndexBindlessDraw);
+            }
+            else {
+                // Geometry passes are recorded as the triangle pipeline; they
+                // take the same inputs and cover the same pixels on replay.
+                auto triangle_pipeline =
+                    visibility ? visibility->geometryPipeline() :
+                    tiled_lighting ? tiled_lighting->geometryPipeline() :
+                    pipeline.get();
+
+                capture.setRenderPipelineState(triangle_pipeline, "triangle");
+                capture.setVertexBytes(&triangleVertices[0], sizeof(triangleVertices), AAPLVertexInputIndexVertices);
+                capture.setVertexBytes(&viewport, sizeof(viewport), AAPLVertexInputIndexViewportSize);
+            }
+
+            NS::UInteger vertex_start = 0, vertex_count = 3;
+            capture.drawPrimitives(MTL::PrimitiveType::PrimitiveTypeTriangle, vertex_start, vertex_count);
+
+            if (recorder) {
+                recorder->endFrame();
+            }
+        }
+
+        if (tiled_lighting) {
+            tiled_lighting->light(encoder.get());
+        }
+
+        if (mesh && !draw_in_overlay) {
+            mesh->draw(encoder.get(), viewport);
+        }
+
+        if (meshlets && !draw_in_overlay) {
+            if (depth) {
+                encoder->setDepthStencilState(depth_states->get(DepthStencilKey::depth(MTL::CompareFunctionLess, true)));
+            }
+
+            meshlets->draw(encoder.get());
 
-        encoder->setRenderPipelineState(pipeline.get());
+            if (depth) {
+                encoder->setDepthStencilState(depth_states->get(DepthStencilKey::depth(MTL::CompareFunctionAlways, false)));
+            }
+        }
+
+        if (scene && !draw_in_overlay) {
+            scene->draw(encoder.get(), viewport);
+        }
 
-        encoder->setVertexBytes(&triangleVertices[0], sizeof(triangleVertices), AAPLVertexInputIndexVertices);
-        encoder->setVertexBytes(&viewport, sizeof(viewport), AAPLVertexInputIndexViewportSize);
+        if (particles && !draw_in_overlay) {
+            particles->draw(encoder.get(), viewport);
+        }
+
+        if (materials && !draw_in_overlay) {
+            materials->draw(encoder.get(), viewport);
+        }
 
-        NS::UInteger vertex_start = 0, vertex_count = 3;
-        encoder->drawPrimitives(MTL::PrimitiveType::PrimitiveTypeTriangle, vertex_start, vertex_count);
+        if (sprites && !draw_in_overlay) {
+            sprites->draw(encoder.get(), viewport);
+        }
+
+        if (text && !draw_in_overlay) {
+            text->draw(encoder.get(), viewport);
+        }
 
         encoder->endEncoding();
 
+        if (vrs) {
+            vrs->resolve(buffer.get(), drawable_texture);
+        }
+
+        if (visibility) {
+            visibility->shade(buffer.get(), drawable_texture,
+                &triangleVertices[0], sizeof(triangleVertices),
+                &viewport, sizeof(viewport),
+                triangle_viewport);
+        }
+
+        if ((mesh || meshlets || scene || particles || materials || sprites || text) && draw_in_overlay) {
+            auto overlay_pass = MTL::make_owned(MTL::RenderPassDescriptor::renderPassDescriptor());
+
+            auto color_attachment = overlay_pass->colorAttachments()->object(0);
+            color_attachment->setLoadAction(MTL::LoadAction::LoadActionLoad);
+            color_attachment->setStoreAction(MTL::StoreAction::StoreActionStore);
+            color_attachment->setTexture(drawable_texture);
+
+            if (depth) {
+                depth->attach(overlay_pass.get(), drawable_texture->width(), drawable_texture->height());
+            }
+
+            if (meshlets) {
+                overlay_pass->setVisibilityResultBuffer(meshlets->visibilityResultBuffer());
+            }
+
+            auto overlay_encoder = MTL::make_owned(buffer->renderCommandEncoder(overlay_pass.get()));
+
+            if (mesh) {
+                mesh->draw(overlay_encoder.get(), viewport);
+            }
+
+            if (meshlets) {
+                if (depth) {
+                    overlay_encoder->setDepthStencilState(
+                        depth_states->get(DepthStencilKey::depth(MTL::CompareFunctionLess, true)));
+                }
+
+                meshlets->draw(overlay_encoder.get());
+
+                if (depth) {
+                    overlay_encoder->setDepthStencilState(
+                        depth_states->get(DepthStencilKey::depth(MTL::CompareFunctionAlways, false)));
+                }
+            }
+
+            if (scene) {
+                scene->draw(overlay_encoder.get(), viewport);
+            }
+
+            if (particles) {
+                particles->draw(overlay_encoder.get(), viewport);
+            }
+
+            if (materials) {
+                materials->draw(overlay_encoder.get(), viewport);
+            }
+
+            if (sprites) {
+                sprites->draw(overlay_encoder.get(), viewport);
+            }
+
+            if (text) {
+                text->draw(overlay_encoder.get(), viewport);
+            }
+
+            overlay_encoder->endEncoding();
+        }
+
         buffer->presentDrawable(drawable);
         buffer->commit();
 
         drawable->release();
+
+        if (bindless) {
+            bindless->endFrame();
+        }
+
+        ++frame;
+    }
+
+    if (recorder) {
+        recorder->close();
     }
 
     SDL_DestroyRenderer(renderer);
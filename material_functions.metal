@@ -0,0 +1,58 @@
+/*
+Material functions, compiled at runtime against the lighting dynamic library
+and linked into the material pipeline to be called through its visible
+function table. MaterialRenderer lists what each of them calls.
+*/
+
+#include <metal_stdlib>
+
+using namespace metal;
+
+#ifndef material_types_H
+#include "material_types.h"
+#endif
+
+[[visible]] float4
+materialFlat(MaterialInput in)
+{
+    return float4(materialLight(in.normal, float3(0.85, 0.35, 0.2)), 1.0);
+}
+
+[[visible]] float4
+materialChecker(MaterialInput in)
+{
+    uint2 cell = uint2(in.uv * 6.0);
+    float3 albedo = ((cell.x + cell.y) & 1) ? float3(0.9) : float3(0.15);
+    return float4(materialLight(in.normal, albedo), 1.0);
+}
+
+[[visible]] float4
+materialStripes(MaterialInput in)
+{
+    float stripe = step(0.5, fract((in.uv.x + in.uv.y) * 5.0));
+    return float4(materialLight(in.normal, mix(float3(0.2, 0.4, 0.9), float3(0.9, 0.9, 0.3), stripe)), 1.0);
+}
+
+[[visible]] float4
+materialRings(MaterialInput in)
+{
+    float ring = 0.5 + 0.5 * cos(length(in.uv - 0.5) * 40.0);
+    return float4(materialLight(in.normal, mix(float3(0.3, 0.15, 0.05), float3(0.8, 0.55, 0.3), ring)), 1.0);
+}
+
+[[visible]] float4
+materialNoise(MaterialInput in)
+{
+    uint2 cell = uint2(in.uv * 16.0);
+    uint hash = (cell.x * 73856093u) ^ (cell.y * 19349663u);
+    hash = (hash ^ (hash >> 13)) * 1274126177u;
+    float value = float(hash & 0xff) / 255.0;
+    return float4(materialLight(in.normal, float3(0.3, 0.6 + 0.4 * value, 0.3)), 1.0);
+}
+
+// Built from two other material functions, which it calls directly.
+[[visible]] float4
+materialBlend(MaterialInput in)
+{
+    return mix(materialChecker(in), materialRings(in), in.uv.x);
+}
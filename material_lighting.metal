@@ -0,0 +1,24 @@
+/*
+Lighting shared by the material functions, compiled at runtime into a dynamic
+library that the material pipelines preload
+*/
+
+#include <metal_stdlib>
+
+using namespace metal;
+
+#ifndef material_types_H
+#include "material_types.h"
+#endif
+
+float3
+materialLight(float3 normal, float3 albedo)
+{
+    float3 light = normalize(float3(0.3, 0.5, 0.8));
+    float3 halfway = normalize(light + float3(0.0, 0.0, 1.0));
+
+    float diffuse = saturate(dot(normal, light));
+    float specular = pow(saturate(dot(normal, halfway)), 32.0);
+
+    return albedo * (0.2 + 0.8 * diffuse) + 0.25 * specular;
+}
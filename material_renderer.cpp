@@ -0,0 +1,328 @@
+#include "material_renderer.h"
+#include "interned_string.h"
+#include "material_types.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+namespace {
+
+#include "material_types_h.h"
+#include "material_lighting_metal.h"
+#include "material_functions_metal.h"
+#include "materials_metal.h"
+
+// Edge of a tile in pixels.
+const uint32_t tile_size = 64;
+
+// What each library exports and what that calls, in the order the sources
+// define it; material functions first, indexed by `setTileMaterial`.
+ShaderLibraryInfo
+lightingLibraryInfo() {
+    return { "material_lighting", true, { { "materialLight", {} } } };
+}
+
+ShaderLibraryInfo
+functionsLibraryInfo() {
+    return { "material_functions", false, {
+        { "materialFlat", { "materialLight" } },
+        { "materialChecker", { "materialLight" } },
+        { "materialStripes", { "materialLight" } },
+        { "materialRings", { "materialLight" } },
+        { "materialNoise", { "materialLight" } },
+        { "materialBlend", { "materialChecker", "materialRings" } },
+    } };
+}
+
+// The embedded sources aren't NUL-terminated. Each one is compiled with the
+// shared header in front of it, standing in for its #include.
+std::string
+runtimeSource(const unsigned char *text, unsigned int length) {
+    return std::string((const char *)material_types_h, material_types_h_len) + "\n" +
+           std::string((const char *)text, length);
+}
+
+MTL::shared_ptr<MTL::CompileOptions>
+compileOptions() {
+    auto options = MTL::make_owned(MTL::CompileOptions::alloc()->init());
+    options->setLanguageVersion(MTL::LanguageVersion2_4);
+    return options;
+}
+
+MTL::shared_ptr<MTL::Library>
+compileLibrary(MTL::Device *device, const std::string& source, const MTL::CompileOptions *options,
+    const char *what) {
+    NS::Error *err;
+    auto library = MTL::make_owned(
+        device->newLibrary(NS::String::string(source.c_str(), NS::UTF8StringEncoding), options, &err));
+
+    if (!library) {
+        std::cerr << "Failed to compile " << what << ": " << err->localizedDescription()->utf8String()
+                  << std::endl;
+        std::exit(-1);
+    }
+
+    return library;
+}
+
+// Function names are only known at runtime, from the library descriptions;
+// interned, a name looked up again (the vertex function for every pipeline
+// descriptor) costs no new string.
+MTL::shared_ptr<MTL::Function>
+newFunction(MTL::Library *library, const std::string& name) {
+    auto function = MTL::make_owned(library->newFunction(NS::internString(name)));
+
+    if (!function) {
+        std::cerr << "Failed to find material function " << name << std::endl;
+        std::exit(-1);
+    }
+
+    return function;
+}
+
+MTL::shared_ptr<MTL::RenderPipelineDescriptor>
+pipelineDescriptor(MTL::Library *library, MTL::PixelFormat pixel_format, MTL::PixelFormat depth_pixel_format) {
+    auto vertex_function = newFunction(library, "materialVertex");
+
+    auto descriptor = MTL::make_owned(MTL::RenderPipelineDescriptor::alloc()->init());
+    descriptor->setVertexFunction(vertex_function.get());
+    descriptor->setDepthAttachmentPixelFormat(depth_pixel_format);
+    descriptor->colorAttachments()->object(0)->setPixelFormat(pixel_format);
+
+    return descriptor;
+}
+
+double
+millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+}
+
+bool
+MaterialRenderer::isSupported(MTL::Device *device) {
+    return device->supportsFunctionPointersFromRender() && device->supportsRenderDynamicLibraries();
+}
+
+MaterialRenderer::MaterialRenderer(MTL::Device *device, MTL::PixelFormat pixel_format,
+    MTL::PixelFormat depth_pixel_format)
+    : d_slots(MATERIAL_MAX_TILES)
+    , d_pipelines(device, 16) {
+    NS::Error *err;
+    auto start = std::chrono::steady_clock::now();
+
+    auto lighting_options = compileOptions();
+    lighting_options->setLibraryType(MTL::LibraryTypeDynamic);
+    lighting_options->setInstallName(NS_STATIC_STRING("@executable_path/material_lighting.metallib"));
+
+    auto lighting_library = compileLibrary(device, runtimeSource(material_lighting_metal, material_lighting_metal_len),
+        lighting_options.get(), "material lighting");
+    d_lighting = MTL::make_owned(device->newDynamicLibrary(lighting_library.get(), &err));
+
+    if (!d_lighting) {
+        std::cerr << "Failed to create material lighting library" << std::endl;
+        std::exit(-1);
+    }
+
+    auto functions_options = compileOptions();
+    functions_options->setLibraries(NS::Array::array(d_lighting.get()));
+    d_functions_library = compileLibrary(device,
+        runtimeSource(material_functions_metal, material_functions_metal_len), functions_options.get(),
+        "material functions");
+
+    auto uber_library = compileLibrary(device, runtimeSource(materials_metal, materials_metal_len),
+        compileOptions().get(), "material shaders");
+
+    d_descriptor = pipelineDescriptor(uber_library.get(), pixel_format, depth_pixel_format);
+    d_descriptor->setFragmentFunction(newFunction(uber_library.get(), "materialFragment").get());
+
+    double compile_ms = millisecondsSince(start);
+
+    // The resolver's indices pick out the dynamic libraries.
+    d_dynamic_libraries.push_back(d_lighting.get());
+    d_resolver.addLibrary(lightingLibraryInfo());
+    d_dynamic_libraries.push_back(nullptr);
+    d_materials = d_resolver.addLibrary(functionsLibraryInfo());
+
+    for (const ShaderFunctionInfo& function : functionsLibraryInfo().functions) {
+        d_functions.emplace(function.name, newFunction(d_functions_library.get(), function.name));
+    }
+
+    start = std::chrono::steady_clock::now();
+
+    for (uint32_t material = 0; material < materialCount(); ++material) {
+        d_tile_slots.push_back(d_slots.acquire(d_resolver.library(d_materials).functions[material].name));
+    }
+
+    link();
+
+    double link_ms = millisecondsSince(start);
+    double specialized_ms = timeSpecialized(device, pixel_format, depth_pixel_format);
+
+    // Both figures include compiling the shaders they need.
+    std::cerr << "materials: " << materialCount() << " functions linked into one pipeline in "
+              << compile_ms + link_ms << " ms (" << link_ms << " ms linking); " << materialCount()
+              << " specialized pipelines in " << specialized_ms << " ms" << std::endl;
+}
+
+uint32_t
+MaterialRenderer::materialCount() const {
+    return (uint32_t)d_resolver.library(d_materials).functions.size();
+}
+
+void
+MaterialRenderer::setTileMaterial(uint32_t tile, uint32_t material) {
+    const std::string& name = d_resolver.library(d_materials).functions[material].name;
+
+    if (d_slots.name(d_tile_slots[tile]) == name) {
+        return;
+    }
+
+    // Taking the new reference first keeps a function shared with other
+    // tiles in its slot. With the table full the tile keeps its material.
+    uint32_t slot = d_slots.acquire(name);
+
+    if (slot == FunctionTableSlots::invalid_slot) {
+        std::cerr << "No function table slot for material " << name << std::endl;
+        return;
+    }
+
+    d_slots.release(d_tile_slots[tile]);
+    d_tile_slots[tile] = slot;
+
+    link();
+}
+
+void
+MaterialRenderer::link() {
+    LinkSet set;
+
+    if (!d_resolver.resolve(d_slots.names(), set)) {
+        std::cerr << "Failed to resolve material function " << set.missing.front() << std::endl;
+        std::exit(-1);
+    }
+
+    // Pipelines are cached by the set's number rather than its hash, which
+    // two sets could share.
+    auto known = std::find(d_link_sets.begin(), d_link_sets.end(), set);
+    uint64_t key = (uint64_t)(known - d_link_sets.begin()) + 1;
+
+    if (known == d_link_sets.end()) {
+        d_link_sets.push_back(set);
+    }
+
+    if (!d_pipeline || key != d_link_key) {
+        std::vector<const NS::Object *> functions, libraries;
+
+        for (const std::string& name : set.functions) {
+            functions.push_back(d_functions.at(name).get());
+        }
+
+        for (uint32_t library : set.libraries) {
+            libraries.push_back(d_dynamic_libraries[library]);
+        }
+
+        auto linked_functions = MTL::make_owned(MTL::LinkedFunctions::alloc()->init());
+        linked_functions->setFunctions(NS::Array::array(functions.data(), functions.size()));
+
+        d_descriptor->setFragmentLinkedFunctions(linked_functions.get());
+        d_descriptor->setFragmentPreloadedLibraries(NS::Array::array(libraries.data(), libraries.size()));
+
+        d_pipeline = d_pipelines.get(d_descriptor.get(), key);
+
+        if (!d_pipeline) {
+            std::exit(-1);
+        }
+
+        d_link_key = key;
+    }
+
+    // A new table rather than rewriting the old one, which frames still in
+    // flight may be reading.
+    auto table_descriptor = MTL::make_owned(MTL::VisibleFunctionTableDescriptor::alloc()->init());
+    table_descriptor->setFunctionCount(d_slots.capacity());
+    d_table = MTL::make_owned(d_pipeline->newVisibleFunctionTable(table_descriptor.get(), MTL::RenderStageFragment));
+
+    for (uint32_t slot = 0; slot < d_slots.capacity(); ++slot) {
+        if (!d_slots.name(slot).empty()) {
+            auto function = d_functions.at(d_slots.name(slot)).get();
+            d_table->setFunction(d_pipeline->functionHandle(function, MTL::RenderStageFragment), slot);
+        }
+    }
+}
+
+double
+MaterialRenderer::timeSpecialized(MTL::Device *device, MTL::PixelFormat pixel_format,
+    MTL::PixelFormat depth_pixel_format) {
+    // The uber shaders and every material function in one library, with a
+    // fragment shader that calls the material a function constant picks.
+    std::string source = runtimeSource(material_functions_metal, material_functions_metal_len) + "\n" +
+                         std::string((const char *)materials_metal, materials_metal_len) +
+                         "\nconstant uint material_index [[function_constant(0)]];\n"
+                         "fragment float4\n"
+                         "materialSpecializedFragment(MaterialRasterizerData in [[stage_in]])\n"
+                         "{\n"
+                         "    MaterialInput input = { in.uv, normalize(in.normal) };\n"
+                         "    switch (material_index) {\n";
+
+    for (uint32_t material = 0; material < materialCount(); ++material) {
+        source += "    case " + std::to_string(material) + ": return " +
+                  d_resolver.library(d_materials).functions[material].name + "(input);\n";
+    }
+
+    source += "    }\n"
+              "    return float4(0.0);\n"
+              "}\n";
+
+    auto start = std::chrono::steady_clock::now();
+
+    auto options = compileOptions();
+    options->setLibraries(NS::Array::array(d_lighting.get()));
+    auto library = compileLibrary(device, source, options.get(), "specialized material shaders");
+
+    auto descriptor = pipelineDescriptor(library.get(), pixel_format, depth_pixel_format);
+    descriptor->setFragmentPreloadedLibraries(NS::Array::array(d_lighting.get()));
+
+    for (uint32_t material = 0; material < materialCount(); ++material) {
+        NS::Error *err;
+        auto values = MTL::make_owned(MTL::FunctionConstantValues::alloc()->init());
+        values->setConstantValue(&material, MTL::DataTypeUInt, NS::UInteger(0));
+
+        auto fragment_function = MTL::make_owned(
+            library->newFunction(NS_STATIC_STRING("materialSpecializedFragment"), values.get(), &err));
+
+        if (!fragment_function) {
+            std::cerr << "Failed to specialize material fragment function" << std::endl;
+            std::exit(-1);
+        }
+
+        descriptor->setFragmentFunction(fragment_function.get());
+        auto pipeline = MTL::make_owned(device->newRenderPipelineState(descriptor.get(), &err));
+
+        if (!pipeline) {
+            std::cerr << "Failed to create specialized material pipeline" << std::endl;
+            std::exit(-1);
+        }
+    }
+
+    return millisecondsSince(start);
+}
+
+void
+MaterialRenderer::draw(MTL::RenderCommandEncoder *encoder, vector_uint2 viewport) const {
+    MaterialUniforms uniforms = {};
+    uniforms.viewport = viewport;
+    uniforms.tile_count = tileCount();
+    uniforms.tile_size = tile_size;
+
+    for (uint32_t tile = 0; tile < tileCount(); ++tile) {
+        uniforms.slots[tile] = d_tile_slots[tile];
+    }
+
+    encoder->setRenderPipelineState(d_pipeline.get());
+    encoder->setVertexBytes(&uniforms, sizeof(uniforms), MaterialInputIndexUniforms);
+    encoder->setFragmentVisibleFunctionTable(d_table.get(), MaterialInputIndexFunctionTable);
+    encoder->drawPrimitives(MTL::PrimitiveTypeTriangleStrip, NS::UInteger(0), NS::UInteger(4),
+        NS::UInteger(tileCount()));
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "function_linking.h"
+#include "render_states.h"
+
+#include <Metal/Metal.hpp>
+#include <Metal/shared_ptr.hpp>
+
+#include <simd/simd.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// A row of tiles, each shaded by a material function that is linked into one
+// shared uber pipeline instead of being compiled into a pipeline of its own.
+// The material functions are compiled apart from the uber shaders, against a
+// dynamic library of lighting code that the pipeline preloads, and each tile
+// calls its function through a visible function table.
+//
+// Changing a tile's material rewrites the table, and relinks the pipeline
+// only when the set of functions in use changes; pipelines for sets seen
+// before come from a cache.
+class MaterialRenderer {
+public:
+
+    // Function pointers and dynamic libraries in render pipelines.
+    static bool isSupported(MTL::Device *device);
+
+    // Compiles the shaders, links the pipeline with one tile per material,
+    // and prints how long that took against creating a fully specialized
+    // pipeline per material.
+    MaterialRenderer(MTL::Device *device, MTL::PixelFormat pixel_format, MTL::PixelFormat depth_pixel_format);
+
+    uint32_t materialCount() const;
+
+    uint32_t tileCount() const {
+        return (uint32_t)d_tile_slots.size();
+    }
+
+    void setTileMaterial(uint32_t tile, uint32_t material);
+
+    void draw(MTL::RenderCommandEncoder *encoder, vector_uint2 viewport) const;
+
+private:
+
+    // Brings the pipeline and function table up to date with the slots.
+    void link();
+
+    double timeSpecialized(MTL::Device *device, MTL::PixelFormat pixel_format, MTL::PixelFormat depth_pixel_format);
+
+    MTL::shared_ptr<MTL::DynamicLibrary> d_lighting;
+    MTL::shared_ptr<MTL::Library> d_functions_library;
+    std::unordered_map<std::string, MTL::shared_ptr<MTL::Function>> d_functions;
+
+    // The linked pipeline's descriptor, less its linked functions.
+    MTL::shared_ptr<MTL::RenderPipelineDescriptor> d_descriptor;
+
+    // Dynamic libraries by their index in the resolver, null for the rest.
+    std::vector<MTL::DynamicLibrary *> d_dynamic_libraries;
+
+    LinkResolver d_resolver;
+    uint32_t d_materials;
+    FunctionTableSlots d_slots;
+    std::vector<uint32_t> d_tile_slots;
+
+    RenderPipelineCache d_pipelines;
+    MTL::shared_ptr<MTL::RenderPipelineState> d_pipeline;
+    MTL::shared_ptr<MTL::VisibleFunctionTable> d_table;
+
+    // Every set linked so far; one past a set's index is its pipeline's
+    // `library` key in `d_pipelines`.
+    std::vector<LinkSet> d_link_sets;
+    uint64_t d_link_key = 0;
+};
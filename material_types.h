@@ -0,0 +1,47 @@
+/*
+Header containing types and enum constants shared between the material
+shaders and C++ code. The material shaders are compiled at runtime, with this
+header placed in front of them.
+*/
+
+#ifndef material_types_H
+#define material_types_H
+
+#include <simd/simd.h>
+
+typedef enum MaterialInputIndex
+{
+    MaterialInputIndexUniforms      = 0,
+    MaterialInputIndexFunctionTable = 0,
+} MaterialInputIndex;
+
+#define MATERIAL_MAX_TILES 16
+
+// Tiles of `tile_size` pixels in a row along the bottom of the viewport,
+// each shaded by the function in table slot `slots[i]`.
+typedef struct
+{
+    vector_uint2 viewport;
+    uint32_t tile_count;
+    uint32_t tile_size;
+    uint32_t slots[MATERIAL_MAX_TILES];
+} MaterialUniforms;
+
+#ifdef __METAL_VERSION__
+
+// What every material function is given: the position within its tile and
+// the normal of a dome over it.
+struct MaterialInput
+{
+    float2 uv;
+    float3 normal;
+};
+
+using MaterialFunction = float4(MaterialInput);
+
+// Exported by the material lighting dynamic library.
+float3 materialLight(float3 normal, float3 albedo);
+
+#endif
+
+#endif /* material_types_H */
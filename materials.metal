@@ -0,0 +1,56 @@
+/*
+Uber shaders for the material tiles, compiled at runtime. The fragment shader
+calls each tile's material function through a visible function table. For
+comparison, MaterialRenderer also compiles this source together with the
+material functions and a fragment shader that calls one of them directly,
+picked by a function constant.
+*/
+
+#include <metal_stdlib>
+
+using namespace metal;
+
+#ifndef material_types_H
+#include "material_types.h"
+#endif
+
+struct MaterialRasterizerData
+{
+    float4 position [[position]];
+    float2 uv;
+    float3 normal;
+    uint slot [[flat]];
+};
+
+vertex MaterialRasterizerData
+materialVertex(uint vertexID [[vertex_id]],
+               uint instanceID [[instance_id]],
+               constant MaterialUniforms &uniforms [[buffer(MaterialInputIndexUniforms)]])
+{
+    MaterialRasterizerData out;
+
+    // Tiles from the left along the bottom, in the same centered, y-up
+    // pixel space as the other overlays.
+    float2 viewport = float2(uniforms.viewport);
+    float size = float(uniforms.tile_size);
+    float2 corner = float2(vertexID & 1, vertexID >> 1);
+    float2 origin = float2(-viewport.x * 0.5 + 8.0 + instanceID * (size + 8.0), -viewport.y * 0.5 + 8.0);
+    float2 position = origin + corner * size;
+
+    out.position = float4(position / (viewport * 0.5), 0.0, 1.0);
+    out.uv = float2(corner.x, 1.0 - corner.y);
+
+    float2 dome = corner * 2.0 - 1.0;
+    out.normal = normalize(float3(dome * 0.8, 1.0));
+    out.slot = uniforms.slots[instanceID];
+
+    return out;
+}
+
+fragment float4
+materialFragment(MaterialRasterizerData in [[stage_in]],
+                 visible_function_table<MaterialFunction> materials [[buffer(MaterialInputIndexFunctionTable)]])
+{
+    MaterialInput input = { in.uv, normalize(in.normal) };
+    return materials[in.slot](input);
+}
@@ -0,0 +1,222 @@
+#include "mesh_renderer.h"
+#include "interned_string.h"
+#include "mesh_loader.h"
+#include "mesh_optimizer.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+#include "triangle_metallib.h"
+
+// The loaders' layout is AAPLVertex's, so they can write straight into the
+// buffers the draw reads.
+static_assert(sizeof(LoadedVertex) == sizeof(AAPLVertex), "LoadedVertex must match AAPLVertex");
+static_assert(offsetof(LoadedVertex, position) == offsetof(AAPLVertex, position), "LoadedVertex must match AAPLVertex");
+static_assert(offsetof(LoadedVertex, color) == offsetof(AAPLVertex, color), "LoadedVertex must match AAPLVertex");
+
+// Hands the loaders shared buffers to decode into, so the file's contents
+// go from the mapping to GPU-visible memory without an intermediate copy.
+class MetalMeshSink : public MeshSink {
+public:
+
+    explicit MetalMeshSink(MTL::Device *device)
+        : d_device(device) {
+    }
+
+    LoadedVertex *allocateVertices(size_t count) override {
+        vertices = MTL::make_owned(d_device->newBuffer(sizeof(AAPLVertex) * std::max<size_t>(count, 1), MTL::ResourceStorageModeShared));
+        return vertices ? static_cast<LoadedVertex *>(vertices->contents()) : nullptr;
+    }
+
+    void *allocateIndices(size_t count, size_t index_size) override {
+        indices = MTL::make_owned(d_device->newBuffer(index_size * std::max<size_t>(count, 1), MTL::ResourceStorageModeShared));
+        return indices ? indices->contents() : nullptr;
+    }
+
+    MTL::shared_ptr<MTL::Buffer> vertices;
+    MTL::shared_ptr<MTL::Buffer> indices;
+
+private:
+
+    MTL::Device *d_device;
+};
+
+}
+
+MeshRenderer::MeshRenderer(MTL::Device *device, MTL::PixelFormat pixel_format, MTL::PixelFormat depth_pixel_format,
+    const AAPLVertex *soup, size_t soup_count) {
+    createPipeline(device, pixel_format, depth_pixel_format);
+
+    auto start = std::chrono::steady_clock::now();
+
+    // Welding compares whole records, so the padding after the position
+    // must not hold stray bytes.
+    std::vector<AAPLVertex> canonical(soup_count);
+    std::memset(canonical.data(), 0, sizeof(AAPLVertex) * soup_count);
+
+    for (size_t i = 0; i < soup_count; ++i) {
+        canonical[i].position = soup[i].position;
+        canonical[i].color = soup[i].color;
+    }
+
+    std::vector<uint32_t> remap(soup_count);
+    size_t unique = weldVertices(canonical.data(), soup_count, sizeof(AAPLVertex), remap.data());
+
+    std::vector<AAPLVertex> welded(unique);
+    remapVertices(welded.data(), canonical.data(), soup_count, sizeof(AAPLVertex), remap.data());
+
+    std::vector<uint32_t> indices(soup_count / 3 * 3);
+    remapIndices(indices.data(), nullptr, indices.size(), remap.data());
+
+    VertexCacheStats before = analyzeVertexCache(indices.data(), indices.size(), unique);
+
+    // Flat geometry has nothing for the depth test to reject, so there is
+    // no overdraw pass.
+    optimizeVertexCache(indices.data(), indices.size(), unique);
+
+    d_vertices = MTL::make_owned(device->newBuffer(sizeof(AAPLVertex) * std::max<size_t>(unique, 1), MTL::ResourceStorageModeShared));
+    size_t used = optimizeVertexFetch(d_vertices->contents(), indices.data(), indices.size(), welded.data(), unique, sizeof(AAPLVertex));
+
+    VertexCacheStats after = analyzeVertexCache(indices.data(), indices.size(), used);
+    d_index_count = indices.size();
+
+    if (fitsIndex16(used)) {
+        d_index_type = MTL::IndexTypeUInt16;
+        d_indices = MTL::make_owned(device->newBuffer(sizeof(uint16_t) * std::max<size_t>(d_index_count, 1), MTL::ResourceStorageModeShared));
+        narrowIndices(indices.data(), d_index_count, (uint16_t *)d_indices->contents());
+    }
+    else {
+        d_index_type = MTL::IndexTypeUInt32;
+        d_indices = MTL::make_owned(device->newBuffer(sizeof(uint32_t) * std::max<size_t>(d_index_count, 1), MTL::ResourceStorageModeShared));
+        std::memcpy(d_indices->contents(), indices.data(), sizeof(uint32_t) * d_index_count);
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::cerr << "mesh: " << d_index_count / 3 << " triangles, " << soup_count << " vertices welded to " << used
+              << ", ACMR " << before.acmr << " -> " << after.acmr << ", "
+              << (d_index_type == MTL::IndexTypeUInt16 ? 16 : 32) << "-bit indices, imported in " << ms << " ms" << std::endl;
+}
+
+MeshRenderer::MeshRenderer(MTL::Device *device, MTL::PixelFormat pixel_format, MTL::PixelFormat depth_pixel_format,
+    const char *path) {
+    createPipeline(device, pixel_format, depth_pixel_format);
+
+    MetalMeshSink sink(device);
+    ThreadPool pool;
+    MeshLoadOptions options;
+    options.pool = &pool;
+    MeshLoadResult result;
+
+    auto start = std::chrono::steady_clock::now();
+
+    if (!loadMesh(path, sink, options, result)) {
+        std::cerr << "Failed to load mesh: " << result.error << std::endl;
+        std::exit(-1);
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    d_vertices = sink.vertices;
+    d_indices = sink.indices;
+    d_index_count = result.index_count;
+    d_index_type = result.index_size == 2 ? MTL::IndexTypeUInt16 : MTL::IndexTypeUInt32;
+
+    std::cerr << "mesh: " << path << ", " << d_index_count / 3 << " triangles, " << result.vertex_count << " vertices, "
+              << result.index_size * 8 << "-bit indices, loaded in " << ms << " ms ("
+              << result.bytes / ms / 1e3 << " MB/s)" << std::endl;
+}
+
+void
+MeshRenderer::createPipeline(MTL::Device *device, MTL::PixelFormat pixel_format,
+    MTL::PixelFormat depth_pixel_format) {
+    NS::Error *err;
+
+    auto library_data = dispatch_data_create(
+        &triangle_metallib[0], triangle_metallib_len,
+        dispatch_get_main_queue(),
+        ^{ });
+
+    auto library = MTL::make_owned(device->newLibrary(library_data, &err));
+
+    if (!library) {
+        std::cerr << "Failed to create mesh library" << std::endl;
+        std::exit(-1);
+    }
+
+    auto vertex_function = MTL::make_owned(library->newFunction(NS_STATIC_STRING("vertexShader")));
+    auto fragment_function = MTL::make_owned(library->newFunction(NS_STATIC_STRING("fragmentShader")));
+
+    auto pipeline_descriptor = MTL::make_owned(MTL::RenderPipelineDescriptor::alloc()->init());
+    pipeline_descriptor->setVertexFunction(vertex_function.get());
+    pipeline_descriptor->setFragmentFunction(fragment_function.get());
+    pipeline_descriptor->setDepthAttachmentPixelFormat(depth_pixel_format);
+    pipeline_descriptor->colorAttachments()->object(0)->setPixelFormat(pixel_format);
+
+    d_pipeline = MTL::make_owned(device->newRenderPipelineState(pipeline_descriptor.get(), &err));
+
+    if (!d_pipeline) {
+        std::cerr << "Failed to create mesh pipeline" << std::endl;
+        std::exit(-1);
+    }
+}
+
+void
+MeshRenderer::draw(MTL::RenderCommandEncoder *encoder, vector_uint2 viewport) const {
+    if (d_index_count == 0) {
+        return;
+    }
+
+    encoder->setRenderPipelineState(d_pipeline.get());
+    encoder->setVertexBuffer(d_vertices.get(), 0, AAPLVertexInputIndexVertices);
+    encoder->setVertexBytes(&viewport, sizeof(viewport), AAPLVertexInputIndexViewportSize);
+    encoder->drawIndexedPrimitives(MTL::PrimitiveTypeTriangle, NS::UInteger(d_index_count), d_index_type, d_indices.get(), NS::UInteger(0));
+}
+
+std::vector<AAPLVertex>
+rosetteTriangles(uint32_t rings, uint32_t segments, uint32_t petals) {
+    auto vertex = [&](uint32_t ring, uint32_t segment) {
+        float angle = 2.0f * float(M_PI) * (segment % segments) / segments;
+        float radius = 200.0f * ring / rings * (0.75f + 0.25f * std::cos(petals * angle));
+        float shade = 0.4f + 0.6f * ring / rings;
+
+        float red = 0.5f + 0.5f * std::cos(angle);
+        float green = 0.5f + 0.5f * std::cos(angle - 2.0944f);
+        float blue = 0.5f + 0.5f * std::cos(angle + 2.0944f);
+
+        return AAPLVertex {
+            { radius * std::cos(angle), radius * std::sin(angle) },
+            { shade * red, shade * green, shade * blue, 1.0f },
+        };
+    };
+
+    std::vector<AAPLVertex> soup;
+
+    for (uint32_t ring = 0; ring < rings; ++ring) {
+        for (uint32_t segment = 0; segment < segments; ++segment) {
+            AAPLVertex a = vertex(ring, segment), b = vertex(ring + 1, segment);
+            AAPLVertex c = vertex(ring + 1, segment + 1), d = vertex(ring, segment + 1);
+
+            // The innermost ring meets at one center vertex, which makes
+            // the quad a single triangle. Spelled out so -0 does not keep
+            // copies of it apart.
+            if (ring == 0) {
+                a.position = vector_float2 { 0.0f, 0.0f };
+                a.color = vector_float4 { 0.4f, 0.4f, 0.4f, 1.0f };
+                soup.insert(soup.end(), { a, b, c });
+            }
+            else {
+                soup.insert(soup.end(), { a, b, c, a, c, d });
+            }
+        }
+    }
+
+    return soup;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "triangle_types.h"
+
+#include <Metal/Metal.hpp>
+#include <Metal/shared_ptr.hpp>
+
+#include <simd/simd.h>
+#include <vector>
+
+// A triangle mesh in the plain triangle's pixel space, drawn with the same
+// shaders through `drawIndexedPrimitives`. The triangle soup it is created
+// from is imported with the mesh optimizer: welded into unique vertices,
+// reordered for the post-transform cache and then for vertex fetch, with
+// 16-bit indices when the vertex count allows. A mesh file is instead loaded
+// straight into the buffers, as the loaders in mesh_loader.h describe.
+class MeshRenderer {
+public:
+
+    // `soup` holds three vertices per triangle.
+    MeshRenderer(MTL::Device *device, MTL::PixelFormat pixel_format, MTL::PixelFormat depth_pixel_format,
+        const AAPLVertex *soup, size_t soup_count);
+
+    // An OBJ, glTF or GLB file, fitted to the middle of the viewport.
+    MeshRenderer(MTL::Device *device, MTL::PixelFormat pixel_format, MTL::PixelFormat depth_pixel_format,
+        const char *path);
+
+    void draw(MTL::RenderCommandEncoder *encoder, vector_uint2 viewport) const;
+
+private:
+
+    void createPipeline(MTL::Device *device, MTL::PixelFormat pixel_format, MTL::PixelFormat depth_pixel_format);
+
+    MTL::shared_ptr<MTL::RenderPipelineState> d_pipeline;
+    MTL::shared_ptr<MTL::Buffer> d_vertices;
+    MTL::shared_ptr<MTL::Buffer> d_indices;
+    MTL::IndexType d_index_type;
+    size_t d_index_count = 0;
+};
+
+// A flower of `petals` petals and `rings` rings of `segments` quads, colored
+// by angle, as a triangle soup: a stand-in for what an exporter hands over.
+std::vector<AAPLVertex> rosetteTriangles(uint32_t rings, uint32_t segments, uint32_t petals);
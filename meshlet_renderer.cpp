@@ -0,0 +1,380 @@
+#include "meshlet_renderer.h"
+#include "geometry.h"
+#include "interned_string.h"
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+#include "meshlets_metallib.h"
+#include "meshlet_shaders_metallib.h"
+
+MTL::shared_ptr<MTL::Library>
+newLibrary(MTL::Device *device, const unsigned char *data, size_t length) {
+    NS::Error *err;
+
+    auto library_data = dispatch_data_create(
+        data, length,
+        dispatch_get_main_queue(),
+        ^{ });
+
+    auto library = MTL::make_owned(device->newLibrary(library_data, &err));
+
+    if (!library) {
+        std::cerr << "Failed to create meshlet library" << std::endl;
+        std::exit(-1);
+    }
+
+    return library;
+}
+
+}
+
+bool
+MeshletRenderer::supportsMeshShaders(MTL::Device *device) {
+    return device->supportsFamily(MTL::GPUFamilyMetal3);
+}
+
+MeshletRenderer::MeshletRenderer(MTL::Device *device, MTL::PixelFormat pixel_format, MTL::PixelFormat depth_pixel_format,
+    uint32_t detail, MeshletPath path, uint32_t frames_in_flight)
+    : d_path(path)
+    , d_pixel_format(pixel_format)
+    , d_depth_pixel_format(depth_pixel_format) {
+    NS::Error *err;
+
+    auto library = newLibrary(device, &meshlets_metallib[0], meshlets_metallib_len);
+    auto fragment_function = MTL::make_owned(library->newFunction(NS_STATIC_STRING("meshletFragment")));
+
+    if (d_path == MeshletPathMeshShader) {
+        auto mesh_library = newLibrary(device, &meshlet_shaders_metallib[0], meshlet_shaders_metallib_len);
+        auto object_function = MTL::make_owned(mesh_library->newFunction(NS_STATIC_STRING("meshletObject")));
+        auto mesh_function = MTL::make_owned(mesh_library->newFunction(NS_STATIC_STRING("meshletMesh")));
+
+        auto pipeline_descriptor = MTL::make_owned(MTL::MeshRenderPipelineDescriptor::alloc()->init());
+        pipeline_descriptor->setObjectFunction(object_function.get());
+        pipeline_descriptor->setMeshFunction(mesh_function.get());
+        pipeline_descriptor->setFragmentFunction(fragment_function.get());
+        pipeline_descriptor->setDepthAttachmentPixelFormat(depth_pixel_format);
+        pipeline_descriptor->colorAttachments()->object(0)->setPixelFormat(pixel_format);
+
+        d_pipeline = MTL::make_owned(device->newRenderPipelineState(pipeline_descriptor.get(), MTL::PipelineOptionNone, nullptr, &err));
+    }
+    else {
+        auto vertex_function = MTL::make_owned(library->newFunction(NS_STATIC_STRING("meshletInstanceVertex")));
+
+        auto pipeline_descriptor = MTL::make_owned(MTL::RenderPipelineDescriptor::alloc()->init());
+        pipeline_descriptor->setVertexFunction(vertex_function.get());
+        pipeline_descriptor->setFragmentFunction(fragment_function.get());
+        pipeline_descriptor->setDepthAttachmentPixelFormat(depth_pixel_format);
+        pipeline_descriptor->colorAttachments()->object(0)->setPixelFormat(pixel_format);
+
+        d_pipeline = MTL::make_owned(device->newRenderPipelineState(pipeline_descriptor.get(), &err));
+    }
+
+    if (!d_pipeline) {
+        std::cerr << "Failed to create meshlet pipeline" << std::endl;
+        std::exit(-1);
+    }
+
+    if (d_path == MeshletPathCompute) {
+        auto cull_function = MTL::make_owned(library->newFunction(NS_STATIC_STRING("cullMeshlets")));
+        d_cull_pipeline = MTL::make_owned(device->newComputePipelineState(cull_function.get(), &err));
+
+        if (!d_cull_pipeline) {
+            std::cerr << "Failed to create meshlet culling pipeline" << std::endl;
+            std::exit(-1);
+        }
+    }
+
+    // Build the meshlets from a vertex cache order, so they come out
+    // compact.
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<float> positions, normals;
+    std::vector<uint32_t> indices;
+    detail = std::max(detail, 3u);
+    torusKnot(detail * 16, detail, positions, normals, indices);
+
+    std::vector<MeshletVertex> vertices(positions.size() / 3);
+
+    for (size_t v = 0; v < vertices.size(); ++v) {
+        vertices[v].position = { positions[v * 3], positions[v * 3 + 1], positions[v * 3 + 2] };
+        vertices[v].normal = { normals[v * 3], normals[v * 3 + 1], normals[v * 3 + 2] };
+    }
+
+    optimizeVertexCache(indices.data(), indices.size(), vertices.size());
+
+    MeshletMesh mesh;
+    buildMeshlets(mesh, indices.data(), indices.size(), &vertices[0].position.x, vertices.size(), sizeof(MeshletVertex));
+    computeMeshletBounds(mesh, &vertices[0].position.x, sizeof(MeshletVertex), d_spheres, d_cones);
+    d_meshlet_count = (uint32_t)mesh.meshlets.size();
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    // Triangle bytes are read in threes from any offset; pad to a word.
+    mesh.triangles.resize((mesh.triangles.size() + 3) / 4 * 4);
+
+    d_vertices = MTL::make_owned(device->newBuffer(vertices.data(), sizeof(MeshletVertex) * vertices.size(), MTL::ResourceStorageModeShared));
+    d_meshlets = MTL::make_owned(device->newBuffer(mesh.meshlets.data(), sizeof(Meshlet) * mesh.meshlets.size(), MTL::ResourceStorageModeShared));
+    d_meshlet_vertices = MTL::make_owned(device->newBuffer(mesh.vertices.data(), sizeof(uint32_t) * mesh.vertices.size(), MTL::ResourceStorageModeShared));
+    d_meshlet_triangles = MTL::make_owned(device->newBuffer(mesh.triangles.data(), mesh.triangles.size(), MTL::ResourceStorageModeShared));
+    d_bounds = MTL::make_owned(device->newBuffer(sizeof(MeshletBounds) * d_meshlet_count, MTL::ResourceStorageModeShared));
+    packMeshletBounds(d_spheres, d_cones, (MeshletBounds *)d_bounds->contents());
+
+    for (uint32_t i = 0; i < std::max(frames_in_flight, 1u); ++i) {
+        d_uniform_buffers.push_back(MTL::make_owned(device->newBuffer(sizeof(MeshletUniforms), MTL::ResourceStorageModeShared)));
+        d_visible_buffers.push_back(MTL::make_owned(device->newBuffer(sizeof(uint32_t) * d_meshlet_count, MTL::ResourceStorageModeShared)));
+        d_argument_buffers.push_back(MTL::make_owned(device->newBuffer(sizeof(MTL::DrawPrimitivesIndirectArguments), MTL::ResourceStorageModeShared)));
+    }
+
+    const char *path_names[] = { "CPU", "compute and indirect draw", "object and mesh shaders" };
+
+    std::cerr << "meshlets: " << indices.size() / 3 << " triangles in " << d_meshlet_count << " meshlets, built in "
+              << ms << " ms, culled with " << path_names[d_path] << std::endl;
+}
+
+void
+MeshletRenderer::update(MTL::CommandBuffer *buffer, float time, vector_uint2 viewport) {
+    d_current = d_frame;
+    d_frame = (d_frame + 1) % d_uniform_buffers.size();
+
+    // The knot turns about z and tips back and forth, seen from a camera
+    // close enough that part of it leaves the view.
+    float turn = 0.3f * time, tip = 0.6f * std::sin(0.2f * time);
+    float model[16] = {
+        std::cos(turn), std::sin(turn) * std::cos(tip), std::sin(turn) * std::sin(tip), 0.0f,
+        -std::sin(turn), std::cos(turn) * std::cos(tip), std::cos(turn) * std::sin(tip), 0.0f,
+        0.0f, -std::sin(tip), std::cos(tip), 0.0f,
+        0.0f, 0.0f, 0.0f, 1.0f,
+    };
+
+    // Looking along +y from below the knot, with z up.
+    const float eye[3] = { 0.0f, -5.5f, 1.5f }, origin[3] = { 0.0f, 0.0f, 0.0f }, up[3] = { 0.0f, 0.0f, 1.0f };
+    float view[16], projection[16];
+    lookAt(eye, origin, up, view);
+    perspective(50.0f * float(M_PI) / 180.0f, (float)std::max(viewport[0], 1u) / std::max(viewport[1], 1u), 0.1f,
+        100.0f, projection);
+
+    float view_projection[16], model_view_projection[16];
+    multiplyMatrices(projection, view, view_projection);
+    multiplyMatrices(view_projection, model, model_view_projection);
+
+    // Culling happens in model space: the planes come from the whole
+    // transform, and the eye goes back through the rotation.
+    Frustum frustum = frustumFromMatrix(model_view_projection);
+    float model_eye[3];
+
+    for (int c = 0; c < 3; ++c) {
+        model_eye[c] = model[c * 4] * eye[0] + model[c * 4 + 1] * eye[1] + model[c * 4 + 2] * eye[2];
+    }
+
+    MeshletUniforms *uniforms = (MeshletUniforms *)d_uniform_buffers[d_current]->contents();
+    std::memcpy(&uniforms->model_view_projection, model_view_projection, sizeof(model_view_projection));
+    std::memcpy(&uniforms->model, model, sizeof(model));
+
+    for (int p = 0; p < 6; ++p) {
+        uniforms->planes[p] = MeshletVector { frustum.planes[p][0], frustum.planes[p][1], frustum.planes[p][2], frustum.planes[p][3] };
+    }
+
+    uniforms->eye = MeshletVector { model_eye[0], model_eye[1], model_eye[2], 1.0f };
+    uniforms->meshlet_count = d_meshlet_count;
+
+    if (d_path == MeshletPathCpu) {
+        d_visible_count = cullMeshlets(d_spheres, d_cones, frustum, model_eye, d_visible, &d_pool);
+
+        // Nearest first, so the depth test rejects what they hide. The list
+        // is in index order, which spares the sort the index digits.
+        d_sort_keys.resize(d_visible_count);
+        encodeSortKeys(d_spheres, d_visible.data(), d_visible_count, model_eye, 0, 0, SortFrontToBack,
+            d_sort_keys.data());
+        radixSort(d_sort_keys, d_sort_scratch, sort_key_index_bits);
+
+        d_order.resize(d_visible_count);
+
+        for (size_t i = 0; i < d_visible_count; ++i) {
+            d_order[i] = sortKeyIndex(d_sort_keys[i]);
+        }
+
+        uint32_t *visible = (uint32_t *)d_visible_buffers[d_current]->contents();
+
+        if (!d_occlusion) {
+            std::memcpy(visible, d_order.data(), sizeof(uint32_t) * d_visible_count);
+            d_draw_count = d_visible_count;
+        }
+        else {
+            updateOcclusion(buffer, visible);
+        }
+    }
+    else if (d_path == MeshletPathCompute) {
+        // Every instance draws the most triangles a meshlet can have; the
+        // kernel counts the instances.
+        *(MTL::DrawPrimitivesIndirectArguments *)d_argument_buffers[d_current]->contents() =
+            MTL::DrawPrimitivesIndirectArguments { MESHLET_MAX_TRIANGLES * 3, 0, 0, 0 };
+
+        auto encoder = buffer->computeCommandEncoder();
+
+        encoder->setComputePipelineState(d_cull_pipeline.get());
+        encoder->setBuffer(d_bounds.get(), 0, MeshletInputIndexBounds);
+        encoder->setBuffer(d_uniform_buffers[d_current].get(), 0, MeshletInputIndexUniforms);
+        encoder->setBuffer(d_visible_buffers[d_current].get(), 0, MeshletInputIndexVisible);
+        encoder->setBuffer(d_argument_buffers[d_current].get(), 0, MeshletInputIndexDrawArguments);
+
+        NS::UInteger width = std::min<NS::UInteger>(d_cull_pipeline->maxTotalThreadsPerThreadgroup(), 256);
+        encoder->dispatchThreads(MTL::Size(d_meshlet_count, 1, 1), MTL::Size(width, 1, 1));
+
+        encoder->endEncoding();
+    }
+}
+
+void
+MeshletRenderer::draw(MTL::RenderCommandEncoder *encoder) const {
+    MTL::Buffer *uniforms = d_uniform_buffers[d_current].get();
+
+    encoder->setRenderPipelineState(d_pipeline.get());
+    encoder->setCullMode(MTL::CullModeBack);
+    encoder->setFrontFacingWinding(MTL::WindingCounterClockwise);
+
+    if (d_path == MeshletPathMeshShader) {
+        encoder->setObjectBuffer(d_bounds.get(), 0, MeshletInputIndexBounds);
+        encoder->setObjectBuffer(uniforms, 0, MeshletInputIndexUniforms);
+        encoder->setMeshBuffer(d_vertices.get(), 0, MeshletInputIndexVertices);
+        encoder->setMeshBuffer(d_meshlets.get(), 0, MeshletInputIndexMeshlets);
+        encoder->setMeshBuffer(d_meshlet_vertices.get(), 0, MeshletInputIndexMeshletVertices);
+        encoder->setMeshBuffer(d_meshlet_triangles.get(), 0, MeshletInputIndexMeshletTriangles);
+        encoder->setMeshBuffer(uniforms, 0, MeshletInputIndexUniforms);
+
+        NS::UInteger groups = (d_meshlet_count + MESHLET_OBJECT_THREADS - 1) / MESHLET_OBJECT_THREADS;
+        encoder->drawMeshThreadgroups(MTL::Size(groups, 1, 1), MTL::Size(MESHLET_OBJECT_THREADS, 1, 1),
+            MTL::Size(MESHLET_MESH_THREADS, 1, 1));
+    }
+    else {
+        encoder->setVertexBuffer(d_vertices.get(), 0, MeshletInputIndexVertices);
+        encoder->setVertexBuffer(d_meshlets.get(), 0, MeshletInputIndexMeshlets);
+        encoder->setVertexBuffer(d_meshlet_vertices.get(), 0, MeshletInputIndexMeshletVertices);
+        encoder->setVertexBuffer(d_meshlet_triangles.get(), 0, MeshletInputIndexMeshletTriangles);
+        encoder->setVertexBuffer(uniforms, 0, MeshletInputIndexUniforms);
+        encoder->setVertexBuffer(d_visible_buffers[d_current].get(), 0, MeshletInputIndexVisible);
+
+        if (d_path == MeshletPathCompute) {
+            encoder->drawPrimitives(MTL::PrimitiveTypeTriangle, d_argument_buffers[d_current].get(), NS::UInteger(0));
+        }
+        else {
+            if (d_draw_count > 0) {
+                encoder->drawPrimitives(MTL::PrimitiveTypeTriangle, NS::UInteger(0),
+                    NS::UInteger(MESHLET_MAX_TRIANGLES * 3), NS::UInteger(d_draw_count));
+            }
+
+            if (!d_query_slots.empty()) {
+                drawQueries(encoder);
+            }
+        }
+    }
+
+    // The other draws in the pass are two-sided.
+    encoder->setCullMode(MTL::CullModeNone);
+}
+
+void
+MeshletRenderer::enableOcclusionQueries(MTL::Device *device, DepthStencilCache *depth_states, uint32_t slot_count) {
+    if (d_path != MeshletPathCpu || d_depth_pixel_format == MTL::PixelFormatInvalid) {
+        std::cerr << "Meshlet occlusion queries need the CPU path and a depth attachment; not enabled" << std::endl;
+        return;
+    }
+
+    NS::Error *err;
+
+    auto library = newLibrary(device, &meshlets_metallib[0], meshlets_metallib_len);
+    auto vertex_function = MTL::make_owned(library->newFunction(NS_STATIC_STRING("meshletBoxVertex")));
+    auto fragment_function = MTL::make_owned(library->newFunction(NS_STATIC_STRING("meshletBoxFragment")));
+
+    auto pipeline_descriptor = MTL::make_owned(MTL::RenderPipelineDescriptor::alloc()->init());
+    pipeline_descriptor->setVertexFunction(vertex_function.get());
+    pipeline_descriptor->setFragmentFunction(fragment_function.get());
+    pipeline_descriptor->setDepthAttachmentPixelFormat(d_depth_pixel_format);
+
+    auto color_attachment_descriptor = pipeline_descriptor->colorAttachments()->object(0);
+    color_attachment_descriptor->setPixelFormat(d_pixel_format);
+    color_attachment_descriptor->setWriteMask(MTL::ColorWriteMaskNone);
+
+    d_box_pipeline = MTL::make_owned(device->newRenderPipelineState(pipeline_descriptor.get(), &err));
+
+    if (!d_box_pipeline) {
+        std::cerr << "Failed to create meshlet box pipeline" << std::endl;
+        std::exit(-1);
+    }
+
+    // Slots are never reused before their results are read, so every
+    // frame in flight shares the one buffer.
+    d_query_results = MTL::make_owned(device->newBuffer(sizeof(uint64_t) * slot_count, MTL::ResourceStorageModeShared));
+    d_occlusion = std::make_unique<OcclusionQueries>(d_meshlet_count, slot_count);
+    d_completed = std::make_shared<CompletedFrames>();
+    d_depth_states = depth_states;
+}
+
+void
+MeshletRenderer::updateOcclusion(MTL::CommandBuffer *buffer, uint32_t *visible) {
+    std::vector<uint64_t> completed;
+
+    {
+        std::lock_guard<std::mutex> lock(d_completed->mutex);
+        completed.swap(d_completed->frames);
+    }
+
+    uint64_t *results = (uint64_t *)d_query_results->contents();
+
+    for (uint64_t frame : completed) {
+        d_occlusion->resolve(frame, results);
+    }
+
+    // Nearest first within each list, as sorted.
+    d_occlusion->beginFrame(d_frame_number, d_order.data(), d_order.size());
+
+    const auto& draws = d_occlusion->draws();
+    std::memcpy(visible, draws.data(), sizeof(uint32_t) * draws.size());
+    d_draw_count = draws.size();
+    d_draw_query_count = d_occlusion->drawQueries().size();
+    d_query_slots.clear();
+
+    for (const auto *queries : { &d_occlusion->drawQueries(), &d_occlusion->boxQueries() }) {
+        for (const OcclusionQuery& query : *queries) {
+            visible[d_draw_count + d_query_slots.size()] = query.object;
+            d_query_slots.push_back(query.slot);
+            results[query.slot] = 0;
+        }
+    }
+
+    // The handler can outlive the renderer; it only holds the list.
+    buffer->addCompletedHandler([completed = d_completed, frame = d_frame_number](MTL::CommandBuffer *) {
+        std::lock_guard<std::mutex> lock(completed->mutex);
+        completed->frames.push_back(frame);
+    });
+
+    ++d_frame_number;
+}
+
+void
+MeshletRenderer::drawQueries(MTL::RenderCommandEncoder *encoder) const {
+    // Each query is a draw of its own, counted at its slot's offset.
+    for (size_t i = 0; i < d_query_slots.size(); ++i) {
+        bool box = i >= d_draw_query_count;
+
+        if (i == d_draw_query_count) {
+            // Boxes test depth but write nothing, from inside as well.
+            encoder->setRenderPipelineState(d_box_pipeline.get());
+            encoder->setDepthStencilState(d_depth_states->get(DepthStencilKey::depth(MTL::CompareFunctionLess, false)));
+            encoder->setCullMode(MTL::CullModeNone);
+            encoder->setVertexBuffer(d_bounds.get(), 0, MeshletInputIndexBounds);
+        }
+
+        encoder->setVisibilityResultMode(MTL::VisibilityResultModeBoolean, d_query_slots[i] * sizeof(uint64_t));
+        encoder->drawPrimitives(MTL::PrimitiveTypeTriangle, NS::UInteger(0),
+            NS::UInteger(box ? 36 : MESHLET_MAX_TRIANGLES * 3), NS::UInteger(1), NS::UInteger(d_draw_count + i));
+    }
+
+    encoder->setVisibilityResultMode(MTL::VisibilityResultModeDisabled, 0);
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "culling.h"
+#include "depth_stencil.h"
+#include "meshlet_types.h"
+#include "meshlets.h"
+#include "occlusion_queries.h"
+#include "sort_keys.h"
+#include "thread_pool.h"
+
+#include <Metal/Metal.hpp>
+#include <Metal/shared_ptr.hpp>
+
+#include <simd/simd.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+enum MeshletPath : uint8_t {
+    // Culled by cullMeshlets, drawn as one instanced draw of the survivors,
+    // nearest first.
+    MeshletPathCpu,
+
+    // Culled by a compute pass that fills the arguments of an indirect draw.
+    MeshletPathCompute,
+
+    // Culled by object shaders, drawn by mesh shaders.
+    MeshletPathMeshShader,
+};
+
+// A turning torus knot split into meshlets at startup and culled per meshlet
+// against the frustum and each meshlet's backface cone every frame, each
+// meshlet tinted its own color. The CPU path runs the same tests as the GPU
+// paths, which read the same packed bounds.
+class MeshletRenderer {
+public:
+
+    // Object and mesh shaders need a Metal 3 GPU.
+    static bool supportsMeshShaders(MTL::Device *device);
+
+    // `detail` is the number of segments around the tube; the knot has
+    // sixteen times as many along it. `depth_pixel_format` is that of the
+    // pass's depth attachment, or `MTL::PixelFormatInvalid` without one.
+    MeshletRenderer(MTL::Device *device, MTL::PixelFormat pixel_format, MTL::PixelFormat depth_pixel_format,
+        uint32_t detail, MeshletPath path, uint32_t frames_in_flight = 3);
+
+    // Turns the knot to where it is at `time` seconds and culls it, on the
+    // CPU or in a compute pass on `buffer`. Call before the render pass.
+    void update(MTL::CommandBuffer *buffer, float time, vector_uint2 viewport);
+
+    void draw(MTL::RenderCommandEncoder *encoder) const;
+
+    // Also culls meshlets hidden behind the others, on the CPU path with a
+    // depth attachment, by GPU occlusion queries (occlusion_queries.h).
+    // Results are read as command buffers complete and used from the next
+    // update on, so nothing waits on the GPU. The pass drawn into needs
+    // `visibilityResultBuffer()`.
+    void enableOcclusionQueries(MTL::Device *device, DepthStencilCache *depth_states, uint32_t slot_count = 4096);
+
+    // Null without occlusion queries.
+    MTL::Buffer *visibilityResultBuffer() const {
+        return d_query_results.get();
+    }
+
+private:
+
+    // Resolves the frames that completed, splits the sorted meshlets into
+    // draws and queries, and writes them to `visible`.
+    void updateOcclusion(MTL::CommandBuffer *buffer, uint32_t *visible);
+
+    void drawQueries(MTL::RenderCommandEncoder *encoder) const;
+
+    // Frames whose command buffers have completed, filled from Metal's
+    // completion handlers.
+    struct CompletedFrames {
+        std::mutex mutex;
+        std::vector<uint64_t> frames;
+    };
+
+    MeshletPath d_path;
+    MTL::PixelFormat d_pixel_format, d_depth_pixel_format;
+
+    MTL::shared_ptr<MTL::RenderPipelineState> d_pipeline;
+    MTL::shared_ptr<MTL::ComputePipelineState> d_cull_pipeline;
+
+    MTL::shared_ptr<MTL::Buffer> d_vertices;
+    MTL::shared_ptr<MTL::Buffer> d_meshlets;
+    MTL::shared_ptr<MTL::Buffer> d_meshlet_vertices;
+    MTL::shared_ptr<MTL::Buffer> d_meshlet_triangles;
+    MTL::shared_ptr<MTL::Buffer> d_bounds;
+
+    // Per frame in flight: uniforms, the visible list and the indirect draw
+    // arguments.
+    std::vector<MTL::shared_ptr<MTL::Buffer>> d_uniform_buffers;
+    std::vector<MTL::shared_ptr<MTL::Buffer>> d_visible_buffers;
+    std::vector<MTL::shared_ptr<MTL::Buffer>> d_argument_buffers;
+    uint32_t d_frame = 0;
+    uint32_t d_current = 0;
+
+    uint32_t d_meshlet_count = 0;
+    size_t d_visible_count = 0;
+
+    CullBounds d_spheres;
+    MeshletCones d_cones;
+    std::vector<uint32_t> d_visible;
+    std::vector<uint64_t> d_sort_keys, d_sort_scratch;
+
+    // Occlusion queries. The visible buffer lists the meshlets drawn
+    // without a query, then those drawn with one, then those whose boxes
+    // are drawn; the slots are those of the last two, in order.
+    std::unique_ptr<OcclusionQueries> d_occlusion;
+    std::shared_ptr<CompletedFrames> d_completed;
+    MTL::shared_ptr<MTL::RenderPipelineState> d_box_pipeline;
+    MTL::shared_ptr<MTL::Buffer> d_query_results;
+    DepthStencilCache *d_depth_states = nullptr;
+    uint64_t d_frame_number = 0;
+    std::vector<uint32_t> d_order;
+    size_t d_draw_count = 0, d_draw_query_count = 0;
+    std::vector<uint32_t> d_query_slots;
+
+    ThreadPool d_pool;
+};
@@ -0,0 +1,72 @@
+/*
+Meshlet culling and drawing with object and mesh shaders: each object
+threadgroup culls one SIMD group's worth of meshlets and launches a mesh
+threadgroup for each survivor
+*/
+
+#include <metal_stdlib>
+
+using namespace metal;
+
+#include "meshlet_shading.h"
+
+struct MeshletPayload
+{
+    uint meshlets[MESHLET_OBJECT_THREADS];
+};
+
+using MeshletOutput = metal::mesh<MeshletRasterizerData, void, MESHLET_MAX_VERTICES, MESHLET_MAX_TRIANGLES, topology::triangle>;
+
+[[object]] void
+meshletObject(object_data MeshletPayload &payload [[payload]],
+              mesh_grid_properties grid,
+              constant MeshletBounds *bounds [[buffer(MeshletInputIndexBounds)]],
+              constant MeshletUniforms &uniforms [[buffer(MeshletInputIndexUniforms)]],
+              uint index [[thread_position_in_grid]],
+              uint lane [[thread_index_in_threadgroup]])
+{
+    bool visible = index < uniforms.meshlet_count && meshletVisible(bounds[index], uniforms);
+
+    // The threadgroup is one SIMD group, so a prefix sum packs the
+    // survivors.
+    uint slot = simd_prefix_exclusive_sum(uint(visible));
+
+    if (visible) {
+        payload.meshlets[slot] = index;
+    }
+
+    uint count = simd_sum(uint(visible));
+
+    if (lane == 0) {
+        grid.set_threadgroups_per_grid(uint3(count, 1, 1));
+    }
+}
+
+[[mesh]] void
+meshletMesh(MeshletOutput output,
+            const object_data MeshletPayload &payload [[payload]],
+            constant MeshletVertex *vertices [[buffer(MeshletInputIndexVertices)]],
+            constant Meshlet *meshlets [[buffer(MeshletInputIndexMeshlets)]],
+            constant uint *meshlet_vertices [[buffer(MeshletInputIndexMeshletVertices)]],
+            constant uchar *meshlet_triangles [[buffer(MeshletInputIndexMeshletTriangles)]],
+            constant MeshletUniforms &uniforms [[buffer(MeshletInputIndexUniforms)]],
+            uint lane [[thread_index_in_threadgroup]],
+            uint group [[threadgroup_position_in_grid]])
+{
+    uint index = payload.meshlets[group];
+    Meshlet meshlet = meshlets[index];
+
+    if (lane == 0) {
+        output.set_primitive_count(meshlet.triangle_count);
+    }
+
+    if (lane < meshlet.vertex_count) {
+        output.set_vertex(lane, meshletVertex(vertices[meshlet_vertices[meshlet.vertex_offset + lane]], index, uniforms));
+    }
+
+    if (lane < meshlet.triangle_count) {
+        for (uint k = 0; k < 3; ++k) {
+            output.set_index(lane * 3 + k, meshlet_triangles[meshlet.triangle_offset + lane * 3 + k]);
+        }
+    }
+}
@@ -0,0 +1,48 @@
+/*
+Culling and shading shared by the compute-and-indirect meshlet shaders and the
+object and mesh shaders
+*/
+
+#ifndef meshlet_shading_H
+#define meshlet_shading_H
+
+#include "core/meshlet_types.h"
+
+struct MeshletRasterizerData
+{
+    float4 position [[position]];
+    float4 color;
+};
+
+// The CPU's cullMeshlets for one meshlet: inside every frustum plane and not
+// facing away from the eye.
+static inline bool
+meshletVisible(MeshletBounds bounds, constant MeshletUniforms &uniforms)
+{
+    for (int p = 0; p < 6; ++p) {
+        if (dot(uniforms.planes[p].xyz, bounds.sphere.xyz) + uniforms.planes[p].w < -bounds.sphere.w) {
+            return false;
+        }
+    }
+
+    float3 toward = bounds.cone_apex.xyz - uniforms.eye.xyz;
+    return !(dot(toward, bounds.cone_axis.xyz) > bounds.cone_axis.w * length(toward));
+}
+
+// A vertex tinted by its meshlet, so the clusters show.
+static inline MeshletRasterizerData
+meshletVertex(MeshletVertex vertex, uint meshlet, constant MeshletUniforms &uniforms)
+{
+    MeshletRasterizerData out;
+    out.position = uniforms.model_view_projection * float4(float3(vertex.position), 1.0);
+
+    uint hash = meshlet * 2654435761u;
+    float3 tint = 0.35 + 0.65 * float3(uint3(hash, hash >> 8, hash >> 16) & 0xff) / 255.0;
+    float3 normal = normalize((uniforms.model * float4(float3(vertex.normal), 0.0)).xyz);
+    float light = 0.25 + 0.75 * saturate(dot(normal, normalize(float3(0.3, 0.5, 0.8))));
+
+    out.color = float4(tint * light, 1.0);
+    return out;
+}
+
+#endif /* meshlet_shading_H */
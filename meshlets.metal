@@ -0,0 +1,98 @@
+/*
+Meshlet culling in a compute pass, with the survivors drawn by one indirect
+instanced draw: one instance per meshlet, three vertices per triangle slot.
+Also the bounding boxes drawn for occlusion queries
+*/
+
+#include <metal_stdlib>
+
+using namespace metal;
+
+#include "meshlet_shading.h"
+
+// Appends each visible meshlet to the list the draw reads and counts it in
+// the draw's instance count, which starts at zero each frame.
+kernel void
+cullMeshlets(constant MeshletBounds *bounds [[buffer(MeshletInputIndexBounds)]],
+             constant MeshletUniforms &uniforms [[buffer(MeshletInputIndexUniforms)]],
+             device uint *visible [[buffer(MeshletInputIndexVisible)]],
+             device atomic_uint *arguments [[buffer(MeshletInputIndexDrawArguments)]],
+             uint index [[thread_position_in_grid]])
+{
+    if (index >= uniforms.meshlet_count || !meshletVisible(bounds[index], uniforms)) {
+        return;
+    }
+
+    // The instance count is the second word of the draw arguments.
+    uint slot = atomic_fetch_add_explicit(&arguments[1], 1, memory_order_relaxed);
+    visible[slot] = index;
+}
+
+// Triangle slots past the meshlet's own triangles collapse to a point and
+// draw nothing.
+vertex MeshletRasterizerData
+meshletInstanceVertex(uint vertexID [[vertex_id]],
+                      uint instanceID [[instance_id]],
+                      constant MeshletVertex *vertices [[buffer(MeshletInputIndexVertices)]],
+                      constant Meshlet *meshlets [[buffer(MeshletInputIndexMeshlets)]],
+                      constant uint *meshlet_vertices [[buffer(MeshletInputIndexMeshletVertices)]],
+                      constant uchar *meshlet_triangles [[buffer(MeshletInputIndexMeshletTriangles)]],
+                      constant MeshletUniforms &uniforms [[buffer(MeshletInputIndexUniforms)]],
+                      constant uint *visible [[buffer(MeshletInputIndexVisible)]])
+{
+    uint index = visible[instanceID];
+    Meshlet meshlet = meshlets[index];
+
+    if (vertexID / 3 >= meshlet.triangle_count) {
+        MeshletRasterizerData out;
+        out.position = float4(0.0, 0.0, 0.0, 1.0);
+        out.color = float4(0.0);
+        return out;
+    }
+
+    uint local = meshlet_triangles[meshlet.triangle_offset + vertexID];
+    return meshletVertex(vertices[meshlet_vertices[meshlet.vertex_offset + local]], index, uniforms);
+}
+
+fragment float4
+meshletFragment(MeshletRasterizerData in [[stage_in]])
+{
+    return in.color;
+}
+
+// Corners of a box, as bits of x, y and z, for its twelve triangles.
+constant uchar box_corners[36] = {
+    0, 2, 1, 1, 2, 3, 4, 5, 6, 5, 7, 6,
+    0, 1, 4, 1, 5, 4, 2, 6, 3, 3, 6, 7,
+    0, 4, 2, 2, 4, 6, 1, 3, 5, 3, 7, 5,
+};
+
+struct MeshletBoxData
+{
+    float4 position [[position]];
+};
+
+// The box around a hidden meshlet's sphere, which writes neither color nor
+// depth; the occlusion query only counts its samples that pass the depth
+// test.
+vertex MeshletBoxData
+meshletBoxVertex(uint vertexID [[vertex_id]],
+                 uint instanceID [[instance_id]],
+                 constant MeshletBounds *bounds [[buffer(MeshletInputIndexBounds)]],
+                 constant MeshletUniforms &uniforms [[buffer(MeshletInputIndexUniforms)]],
+                 constant uint *visible [[buffer(MeshletInputIndexVisible)]])
+{
+    float4 sphere = bounds[visible[instanceID]].sphere;
+    uint corner = box_corners[vertexID];
+    float3 side = float3(uint3(corner, corner >> 1, corner >> 2) & 1) * 2.0 - 1.0;
+
+    MeshletBoxData out;
+    out.position = uniforms.model_view_projection * float4(sphere.xyz + side * sphere.w, 1.0);
+    return out;
+}
+
+fragment half4
+meshletBoxFragment()
+{
+    return half4(0.0);
+}
@@ -0,0 +1,63 @@
+//-------------------------------------------------------------------------------------------------------------------------------------------------------------
+//
+// Foundation/FoundationFwd.hpp
+//
+// Forward declarations of the metal-cpp Foundation types, for headers that only refer to them by pointer. The class
+// templates (Referencing, Copying, ...) are left out since their default arguments may only be given once.
+//
+//-------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+#include "NSDefines.hpp"
+
+#include <cstdint>
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+namespace NS
+{
+// Must match NSTypes.hpp; repeating an alias of the same type is allowed.
+using TimeInterval = double;
+using Integer = std::intptr_t;
+using UInteger = std::uintptr_t;
+
+class Array;
+class AutoreleasePool;
+class Bundle;
+class Condition;
+class Data;
+class Date;
+class Dictionary;
+class Error;
+class FastEnumeration;
+class Notification;
+class NotificationCenter;
+class Number;
+class Object;
+class ProcessInfo;
+class Set;
+class String;
+class URL;
+class Value;
+
+struct FastEnumerationState;
+struct OperatingSystemVersion;
+struct Range;
+
+_NS_ENUM(Integer, ComparisonResult);
+_NS_ENUM(NS::Integer, ProcessInfoThermalState);
+_NS_ENUM(NS::UInteger, StringEncoding);
+
+using ActivityOptions = std::uint64_t;
+using StringCompareOptions = NS::UInteger;
+
+using ErrorDomain = String*;
+using ErrorUserInfoKey = String*;
+using NotificationName = String*;
+using unichar = unsigned short;
+}
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------------------
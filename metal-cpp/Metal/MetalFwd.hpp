@@ -0,0 +1,310 @@
+//-------------------------------------------------------------------------------------------------------------------------------------------------------------
+//
+// Metal/MetalFwd.hpp
+//
+// Forward declarations of every metal-cpp Metal type. Enough for a translation unit that only passes objects by
+// pointer and enums or packed structs through signatures; include Metal.hpp to call methods or lay out structs.
+//
+//-------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+#include "../Foundation/FoundationFwd.hpp"
+
+#include "MTLDefines.hpp"
+
+#include <cstdint>
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+namespace MTL
+{
+class AccelerationStructure;
+class AccelerationStructureBoundingBoxGeometryDescriptor;
+class AccelerationStructureCommandEncoder;
+class AccelerationStructureDescriptor;
+class AccelerationStructureGeometryDescriptor;
+class AccelerationStructureMotionBoundingBoxGeometryDescriptor;
+class AccelerationStructureMotionTriangleGeometryDescriptor;
+class AccelerationStructurePassDescriptor;
+class AccelerationStructurePassSampleBufferAttachmentDescriptor;
+class AccelerationStructurePassSampleBufferAttachmentDescriptorArray;
+class AccelerationStructureTriangleGeometryDescriptor;
+class Argument;
+class ArgumentDescriptor;
+class ArgumentEncoder;
+class ArrayType;
+class Attribute;
+class AttributeDescriptor;
+class AttributeDescriptorArray;
+class BinaryArchive;
+class BinaryArchiveDescriptor;
+class Binding;
+class BlitCommandEncoder;
+class BlitPassDescriptor;
+class BlitPassSampleBufferAttachmentDescriptor;
+class BlitPassSampleBufferAttachmentDescriptorArray;
+class Buffer;
+class BufferBinding;
+class BufferLayoutDescriptor;
+class BufferLayoutDescriptorArray;
+class CaptureDescriptor;
+class CaptureManager;
+class CaptureScope;
+class CommandBuffer;
+class CommandBufferDescriptor;
+class CommandBufferEncoderInfo;
+class CommandEncoder;
+class CommandQueue;
+class CompileOptions;
+class ComputeCommandEncoder;
+class ComputePassDescriptor;
+class ComputePassSampleBufferAttachmentDescriptor;
+class ComputePassSampleBufferAttachmentDescriptorArray;
+class ComputePipelineDescriptor;
+class ComputePipelineReflection;
+class ComputePipelineState;
+class Counter;
+class CounterSampleBuffer;
+class CounterSampleBufferDescriptor;
+class CounterSet;
+class DepthStencilDescriptor;
+class DepthStencilState;
+class Device;
+class Drawable;
+class DynamicLibrary;
+class Event;
+class Fence;
+class Function;
+class FunctionConstant;
+class FunctionConstantValues;
+class FunctionDescriptor;
+class FunctionHandle;
+class FunctionLog;
+class FunctionLogDebugLocation;
+class FunctionStitchingAttribute;
+class FunctionStitchingAttributeAlwaysInline;
+class FunctionStitchingFunctionNode;
+class FunctionStitchingGraph;
+class FunctionStitchingInputNode;
+class FunctionStitchingNode;
+class Heap;
+class HeapDescriptor;
+class IOCommandBuffer;
+class IOCommandQueue;
+class IOCommandQueueDescriptor;
+class IOFileHandle;
+class IOScratchBuffer;
+class IOScratchBufferAllocator;
+class IndirectCommandBuffer;
+class IndirectCommandBufferDescriptor;
+class IndirectComputeCommand;
+class IndirectRenderCommand;
+class InstanceAccelerationStructureDescriptor;
+class IntersectionFunctionDescriptor;
+class IntersectionFunctionTable;
+class IntersectionFunctionTableDescriptor;
+class Library;
+class LinkedFunctions;
+class LogContainer;
+class MeshRenderPipelineDescriptor;
+class MotionKeyframeData;
+class ObjectPayloadBinding;
+class ParallelRenderCommandEncoder;
+class PipelineBufferDescriptor;
+class PipelineBufferDescriptorArray;
+class PointerType;
+class PrimitiveAccelerationStructureDescriptor;
+class RasterizationRateLayerArray;
+class RasterizationRateLayerDescriptor;
+class RasterizationRateMap;
+class RasterizationRateMapDescriptor;
+class RasterizationRateSampleArray;
+class RenderCommandEncoder;
+class RenderPassAttachmentDescriptor;
+class RenderPassColorAttachmentDescriptor;
+class RenderPassColorAttachmentDescriptorArray;
+class RenderPassDepthAttachmentDescriptor;
+class RenderPassDescriptor;
+class RenderPassSampleBufferAttachmentDescriptor;
+class RenderPassSampleBufferAttachmentDescriptorArray;
+class RenderPassStencilAttachmentDescriptor;
+class RenderPipelineColorAttachmentDescriptor;
+class RenderPipelineColorAttachmentDescriptorArray;
+class RenderPipelineDescriptor;
+class RenderPipelineFunctionsDescriptor;
+class RenderPipelineReflection;
+class RenderPipelineState;
+class Resource;
+class ResourceStateCommandEncoder;
+class ResourceStatePassDescriptor;
+class ResourceStatePassSampleBufferAttachmentDescriptor;
+class ResourceStatePassSampleBufferAttachmentDescriptorArray;
+class SamplerDescriptor;
+class SamplerState;
+class SharedEvent;
+class SharedEventHandle;
+class SharedEventListener;
+class SharedTextureHandle;
+class StageInputOutputDescriptor;
+class StencilDescriptor;
+class StitchedLibraryDescriptor;
+class StructMember;
+class StructType;
+class Texture;
+class TextureBinding;
+class TextureDescriptor;
+class TextureReferenceType;
+class ThreadgroupBinding;
+class TileRenderPipelineColorAttachmentDescriptor;
+class TileRenderPipelineColorAttachmentDescriptorArray;
+class TileRenderPipelineDescriptor;
+class Type;
+class VertexAttribute;
+class VertexAttributeDescriptor;
+class VertexAttributeDescriptorArray;
+class VertexBufferLayoutDescriptor;
+class VertexBufferLayoutDescriptorArray;
+class VertexDescriptor;
+class VisibleFunctionTable;
+class VisibleFunctionTableDescriptor;
+
+struct AccelerationStructureInstanceDescriptor;
+struct AccelerationStructureMotionInstanceDescriptor;
+struct AccelerationStructureSizes;
+struct AccelerationStructureUserIDInstanceDescriptor;
+struct AxisAlignedBoundingBox;
+struct ClearColor;
+struct CounterResultStageUtilization;
+struct CounterResultStatistic;
+struct CounterResultTimestamp;
+struct DispatchThreadgroupsIndirectArguments;
+struct DrawIndexedPrimitivesIndirectArguments;
+struct DrawPatchIndirectArguments;
+struct DrawPrimitivesIndirectArguments;
+struct IndirectCommandBufferExecutionRange;
+struct MapIndirectArguments;
+struct Origin;
+struct PackedFloat3;
+struct PackedFloat4x3;
+struct QuadTessellationFactorsHalf;
+struct Region;
+struct ResourceID;
+struct SamplePosition;
+struct ScissorRect;
+struct Size;
+struct SizeAndAlign;
+struct StageInRegionIndirectArguments;
+struct TextureSwizzleChannels;
+struct TriangleTessellationFactorsHalf;
+struct VertexAmplificationViewMapping;
+struct Viewport;
+
+_MTL_ENUM(NS::UInteger, AccelerationStructureInstanceDescriptorType);
+_MTL_ENUM(NS::UInteger, ArgumentAccess);
+_MTL_ENUM(NS::UInteger, ArgumentBuffersTier);
+_MTL_ENUM(NS::UInteger, ArgumentType);
+_MTL_ENUM(NS::UInteger, AttributeFormat);
+_MTL_ENUM(NS::UInteger, BinaryArchiveError);
+_MTL_ENUM(NS::Integer, BindingType);
+_MTL_ENUM(NS::UInteger, BlendFactor);
+_MTL_ENUM(NS::UInteger, BlendOperation);
+_MTL_ENUM(NS::UInteger, CPUCacheMode);
+_MTL_ENUM(NS::Integer, CaptureDestination);
+_MTL_ENUM(NS::Integer, CaptureError);
+_MTL_ENUM(NS::UInteger, CommandBufferError);
+_MTL_ENUM(NS::UInteger, CommandBufferStatus);
+_MTL_ENUM(NS::Integer, CommandEncoderErrorState);
+_MTL_ENUM(NS::UInteger, CompareFunction);
+_MTL_ENUM(NS::Integer, CompileSymbolVisibility);
+_MTL_ENUM(NS::Integer, CounterSampleBufferError);
+_MTL_ENUM(NS::UInteger, CounterSamplingPoint);
+_MTL_ENUM(NS::UInteger, CullMode);
+_MTL_ENUM(NS::UInteger, DataType);
+_MTL_ENUM(NS::UInteger, DepthClipMode);
+_MTL_ENUM(NS::UInteger, DeviceLocation);
+_MTL_ENUM(NS::UInteger, DispatchType);
+_MTL_ENUM(NS::UInteger, DynamicLibraryError);
+_MTL_ENUM(NS::UInteger, FeatureSet);
+_MTL_ENUM(NS::UInteger, FunctionLogType);
+_MTL_ENUM(NS::UInteger, FunctionType);
+_MTL_ENUM(NS::Integer, GPUFamily);
+_MTL_ENUM(NS::UInteger, HazardTrackingMode);
+_MTL_ENUM(NS::Integer, HeapType);
+_MTL_ENUM(NS::Integer, IOCommandQueueType);
+_MTL_ENUM(NS::Integer, IOCompressionMethod);
+_MTL_ENUM(NS::Integer, IOCompressionStatus);
+_MTL_ENUM(NS::Integer, IOError);
+_MTL_ENUM(NS::Integer, IOPriority);
+_MTL_ENUM(NS::Integer, IOStatus);
+_MTL_ENUM(NS::UInteger, IndexType);
+_MTL_ENUM(NS::UInteger, LanguageVersion);
+_MTL_ENUM(NS::UInteger, LibraryError);
+_MTL_ENUM(NS::Integer, LibraryOptimizationLevel);
+_MTL_ENUM(NS::Integer, LibraryType);
+_MTL_ENUM(NS::UInteger, LoadAction);
+_MTL_ENUM(uint32_t, MotionBorderMode);
+_MTL_ENUM(NS::UInteger, MultisampleDepthResolveFilter);
+_MTL_ENUM(NS::UInteger, MultisampleStencilResolveFilter);
+_MTL_ENUM(NS::UInteger, Mutability);
+_MTL_ENUM(NS::UInteger, PatchType);
+_MTL_ENUM(NS::UInteger, PixelFormat);
+_MTL_ENUM(NS::UInteger, PrimitiveTopologyClass);
+_MTL_ENUM(NS::UInteger, PrimitiveType);
+_MTL_ENUM(NS::UInteger, PurgeableState);
+_MTL_ENUM(NS::UInteger, ReadWriteTextureTier);
+_MTL_ENUM(NS::UInteger, SamplerAddressMode);
+_MTL_ENUM(NS::UInteger, SamplerBorderColor);
+_MTL_ENUM(NS::UInteger, SamplerMinMagFilter);
+_MTL_ENUM(NS::UInteger, SamplerMipFilter);
+_MTL_ENUM(NS::Integer, SparsePageSize);
+_MTL_ENUM(NS::UInteger, SparseTextureMappingMode);
+_MTL_ENUM(NS::UInteger, SparseTextureRegionAlignmentMode);
+_MTL_ENUM(NS::UInteger, StencilOperation);
+_MTL_ENUM(NS::UInteger, StepFunction);
+_MTL_ENUM(NS::UInteger, StorageMode);
+_MTL_ENUM(NS::UInteger, StoreAction);
+_MTL_ENUM(NS::UInteger, TessellationControlPointIndexType);
+_MTL_ENUM(NS::UInteger, TessellationFactorFormat);
+_MTL_ENUM(NS::UInteger, TessellationFactorStepFunction);
+_MTL_ENUM(NS::UInteger, TessellationPartitionMode);
+_MTL_ENUM(NS::Integer, TextureCompressionType);
+_MTL_ENUM(uint8_t, TextureSwizzle);
+_MTL_ENUM(NS::UInteger, TextureType);
+_MTL_ENUM(NS::UInteger, TriangleFillMode);
+_MTL_ENUM(NS::UInteger, VertexFormat);
+_MTL_ENUM(NS::UInteger, VertexStepFunction);
+_MTL_ENUM(NS::UInteger, VisibilityResultMode);
+_MTL_ENUM(NS::UInteger, Winding);
+
+// Option sets are plain integers with an anonymous enum of flags; only the integer type can be declared ahead.
+using AccelerationStructureInstanceOptions = uint32_t;
+using AccelerationStructureRefitOptions = NS::UInteger;
+using AccelerationStructureUsage = NS::UInteger;
+using BarrierScope = NS::UInteger;
+using BlitOption = NS::UInteger;
+using ColorWriteMask = NS::UInteger;
+using CommandBufferErrorOption = NS::UInteger;
+using FunctionOptions = NS::UInteger;
+using IndirectCommandType = NS::UInteger;
+using IntersectionFunctionSignature = NS::UInteger;
+using PipelineOption = NS::UInteger;
+using RenderStages = NS::UInteger;
+using ResourceOptions = NS::UInteger;
+using ResourceUsage = NS::UInteger;
+using StoreActionOptions = NS::UInteger;
+using TextureUsage = NS::UInteger;
+
+using AutoreleasedArgument = Argument*;
+using AutoreleasedComputePipelineReflection = ComputePipelineReflection*;
+using AutoreleasedRenderPipelineReflection = RenderPipelineReflection*;
+using CommonCounter = NS::String*;
+using CommonCounterSet = NS::String*;
+using Coordinate2D = SamplePosition;
+using DeviceNotificationName = NS::String*;
+using Timestamp = std::uint64_t;
+}
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -2,6 +2,10 @@
 #define MTL_PRIVATE_IMPLEMENTATION
 #define NS_PRIVATE_IMPLEMENTATION
 
+// Included first so that any drift between the forward declarations and the
+// definitions fails to compile here.
+#include "QuartzCore/QuartzCoreFwd.hpp"
+
 #include "Foundation/Foundation.hpp"
 #include "Metal/Metal.hpp"
 #include "QuartzCore/QuartzCore.hpp"
\ No newline at end of file
@@ -0,0 +1,23 @@
+//-------------------------------------------------------------------------------------------------------------------------------------------------------------
+//
+// QuartzCore/QuartzCoreFwd.hpp
+//
+// Forward declarations of the metal-cpp QuartzCore types, for headers that only refer to them by pointer.
+//
+//-------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+#include "../Metal/MetalFwd.hpp"
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+namespace CA
+{
+class MetalDrawable;
+class MetalLayer;
+}
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -22,11 +22,38 @@
 
 import argparse
 import datetime
+import hashlib
+import json
 import logging
 import os
 import re
 import subprocess
 import sys
+import tempfile
+import time
+
+#--------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+class Timer( object ):
+	def __init__( self ):
+		self.__phases	= list()
+		self.__start	= time.perf_counter()
+		self.__last		= self.__start
+
+	def mark( self, phase ):
+		now = time.perf_counter()
+		self.__phases.append( ( phase, now - self.__last ) )
+		self.__last = now
+
+	def report( self ):
+		lines = [ 'Timing:' ]
+
+		for phase, seconds in self.__phases:
+			lines.append( '\t{:<12} {:8.2f} ms'.format( phase, seconds * 1000.0 ) )
+
+		lines.append( '\t{:<12} {:8.2f} ms'.format( 'total', ( time.perf_counter() - self.__start ) * 1000.0 ) )
+
+		return '\n'.join( lines )
 
 #--------------------------------------------------------------------------------------------------------------------------------------------------------------
 
@@ -55,13 +82,72 @@ class HeaderPrefix( object ):
 	__template_commit	=	'Autogenerated from commit {commit}.'
 	__template_date		=	'Autogenerated on %B %d, %Y.'
 
-	def __init__( self, file ):
-		self.__file = file
+	def __init__( self, file, meta_data = None ):
+		self.__file			= file
+		self.__meta_data	= meta_data
 
 	def __str__( self ):
-		return self.__template.format( file = self.__file, meta_data = self.__meta_data_string() )
+		return self.__template.format( file = self.__file, meta_data = self.meta_data() )
+
+	def meta_data( self ):
+		if not self.__meta_data:
+			self.__meta_data = self.__meta_data_string()
+
+		return self.__meta_data
+
+	def __find_git_dir( self, path ):
+		while True:
+			git_dir = os.path.join( path, '.git' )
+
+			if os.path.isdir( git_dir ):
+				return git_dir
+
+			parent = os.path.dirname( path )
+
+			if parent == path:
+				return None
+
+			path = parent
+
+	# Resolves HEAD from the repository files, which is much cheaper than spawning git. Worktrees, where .git is a
+	# file, and anything else unusual fall back to `git rev-parse`.
+	def __read_commit_hash( self ):
+		git_dir = self.__find_git_dir( os.path.dirname( os.path.realpath( __file__ ) ) )
+
+		if not git_dir:
+			return None
+
+		with open( os.path.join( git_dir, 'HEAD' ), 'r' ) as f:
+			head = f.read().strip()
+
+		if not head.startswith( 'ref: ' ):
+			return head
+
+		ref			= head[ len( 'ref: ' ): ]
+		ref_path	= os.path.join( git_dir, ref )
+
+		if os.path.isfile( ref_path ):
+			with open( ref_path, 'r' ) as f:
+				return f.read().strip()
+
+		with open( os.path.join( git_dir, 'packed-refs' ), 'r' ) as f:
+			for line in f:
+				fields = line.split()
+
+				if len( fields ) == 2 and fields[1] == ref:
+					return fields[0]
+
+		return None
 
 	def __get_commit_hash( self ):
+		try:
+			git_commit_hash = self.__read_commit_hash()
+
+			if git_commit_hash:
+				return git_commit_hash
+		except:
+			pass
+
 		git_commit_hash = None
 
 		try:
@@ -99,10 +185,16 @@ class HeaderPrefix( object ):
 #--------------------------------------------------------------------------------------------------------------------------------------------------------------
 
 class SingleHeader( object ):
-	__pragma_once = '#pragma once\n\n'
+	__pragma_once 				= '#pragma once\n\n'
+	__pragma_once_pattern		= re.compile( '\\s*#pragma once\\s*\\/\\/-*\\n' )
+	__comment_pattern			= re.compile( '^//.*\\n', re.MULTILINE )
+	__empty_lines_pattern		= re.compile( '\\n\\n+', re.MULTILINE )
+	__include_pattern			= re.compile( '^\\s*#include\\s\\"(?P<HEADER_PATH>\\S*)\\"', re.MULTILINE )
+	__foundation_directive		= '#include <Foundation/Foundation.hpp>'
 
 	def __init__( self ):
 		self.__header_paths = list()
+		self.__dependencies	= dict()
 
 	def __str__( self ):
 		return self.process()
@@ -115,30 +207,40 @@ class SingleHeader( object ):
 
 		self.__included_headers	= set()
 		self.__base_path 		= list()
+		self.__header_stack		= list()
+		self.__dependencies		= dict()
 
 		for header_path in self.__header_paths:
 			out_header += self.__process_header( header_path )
 
 		return self.__strip_empty_lines( out_header )
 
+	# Include graph of the last `process()`: for every header read, its content hash and the headers it includes, in
+	# order, as real paths.
+	def dependencies( self ):
+		return self.__dependencies
+
 	def __read_header( self, path ):
 		path = os.path.realpath( path )
 
 		try:
-			f = open( path, 'r' )
+			with open( path, 'rb' ) as f:
+				data = f.read()
 		except:
 			raise RuntimeError( 'Failed to open file \"' + path + '\" for read!' )
 
-		return f.read()
+		self.__dependencies[ path ] = { 'sha1' : hashlib.sha1( data ).hexdigest(), 'includes' : list() }
+
+		return data.decode( 'utf-8' )
 
 	def __strip_pragma_once( self, header ):
-		return re.sub( '\\s*#pragma once\s*\\/\\/-*\\n', '', header )
+		return self.__pragma_once_pattern.sub( '', header )
 
 	def __strip_comments( self, header ):
-		return re.sub( '^//.*\\n', '', header, flags = re.MULTILINE )
+		return self.__comment_pattern.sub( '', header )
 
 	def __strip_empty_lines( self, header ):
-		return re.sub( '\\n\\n+', '\\n\\n', header, flags = re.MULTILINE )
+		return self.__empty_lines_pattern.sub( '\n\n', header )
 
 	def __substitute_include_directive( self, match ):
 		header_path = match.group( 'HEADER_PATH' )
@@ -148,12 +250,12 @@ class SingleHeader( object ):
 		return self.__process_header( os.path.join( self.__base_path[-1], header_path ) )
 
 	def __process_include_directives( self, header ):
-		return re.sub( '^\\s*#include\\s\\"(?P<HEADER_PATH>\\S*)\\"', self.__substitute_include_directive, header, flags = re.MULTILINE )
+		return self.__include_pattern.sub( self.__substitute_include_directive, header )
 
 	def __process_foundation_directives( self, header ):
-		if header.find("#include <Foundation/Foundation.hpp>") != -1:
+		if header.find( self.__foundation_directive ) != -1:
 			logging.info( '\tSubstituting <Foundation/Foundation.hpp>...' )
-			return header.replace("#include <Foundation/Foundation.hpp>", self.__process_header( os.path.join( self.__base_path[-1], "../Foundation/Foundation.hpp" ) ) )
+			return header.replace( self.__foundation_directive, self.__process_header( os.path.join( self.__base_path[-1], "../Foundation/Foundation.hpp" ) ) )
 		return header
 
 
@@ -162,10 +264,14 @@ class SingleHeader( object ):
 
 		header_path = os.path.realpath( header_path )
 
+		if self.__header_stack:
+			self.__dependencies[ self.__header_stack[-1] ][ 'includes' ].append( header_path )
+
 		if not header_path in self.__included_headers:
 			logging.info( 'Processing \"' + header_path + '\"...' )
 
 			self.__base_path.append( os.path.dirname( header_path ) )
+			self.__header_stack.append( header_path )
 			self.__included_headers.add( header_path )
 			
 			out_header = self.__read_header( header_path )
@@ -174,6 +280,7 @@ class SingleHeader( object ):
 			out_header = self.__process_include_directives( out_header )
 			out_header = self.__process_foundation_directives( out_header )
 
+			self.__header_stack.pop()
 			self.__base_path.pop()
 		else:
 			logging.info( '\tSkipping \"' + header_path + '\"...' )
@@ -182,12 +289,171 @@ class SingleHeader( object ):
 
 #--------------------------------------------------------------------------------------------------------------------------------------------------------------
 
+# Reduces a generated single header to what a compiler needs: every comment, and every selector or class declaration
+# (`_NS_PRIVATE_DEF_SEL`, `_MTL_PRIVATE_DEF_CLS`, ...) that no wrapper refers to. The result is only meant to be
+# compiled, not read, and code that names `Private::Selector::s_k...` symbols directly will not find the removed ones.
+
+class StrippedHeader( object ):
+	__comment_pattern		= re.compile( r'//[^\n]*|/\*.*?\*/|"(?:\\.|[^"\\\n])*"|\'(?:\\.|[^\'\\\n])*\'', re.DOTALL )
+	__trailing_space		= re.compile( r'[ \t]+$', re.MULTILINE )
+	__empty_lines_pattern	= re.compile( r'\n\s*\n+' )
+	__use_pattern			= re.compile( r'_(?P<PREFIX>[A-Z]+)_PRIVATE_(?P<KIND>SEL|CLS)\(\s*(?P<NAME>\w+)\s*\)' )
+	__declaration_pattern	= re.compile( r'^[ \t]*_(?P<PREFIX>[A-Z]+)_PRIVATE_DEF_(?P<KIND>SEL|CLS)\(\s*(?P<NAME>\w+)[^;]*;[ \t]*\n', re.MULTILINE )
+
+	def __init__( self, header ):
+		self.__header		= header
+		self.__removed		= 0
+
+	def __str__( self ):
+		return self.process()
+
+	def removed_declarations( self ):
+		return self.__removed
+
+	def process( self ):
+		header = self.__comment_pattern.sub( self.__substitute_comment, self.__header )
+		header = self.__trailing_space.sub( '', header )
+		header = self.__strip_unused_declarations( header )
+
+		return self.__empty_lines_pattern.sub( '\n', header ).lstrip()
+
+	def __substitute_comment( self, match ):
+		text = match.group( 0 )
+
+		if text.startswith( '//' ):
+			return ''
+
+		# Keep line structure so `#` directives and line splices around block comments stay intact.
+		if text.startswith( '/*' ):
+			return ' ' + '\n' * text.count( '\n' )
+
+		return text
+
+	def __strip_unused_declarations( self, header ):
+		used			= set( match.group( 'PREFIX', 'KIND', 'NAME' ) for match in self.__use_pattern.finditer( header ) )
+		self.__removed	= 0
+
+		def substitute( match ):
+			if match.group( 'PREFIX', 'KIND', 'NAME' ) in used:
+				return match.group( 0 )
+
+			self.__removed += 1
+			return ''
+
+		return self.__declaration_pattern.sub( substitute, header )
+
+#--------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+# Remembers, between runs, the include graph and content hash of every input along with what the outputs were built
+# from. An unchanged `stat()` is trusted; otherwise the file is rehashed, so touching a header does not force a rebuild.
+
+class BuildCache( object ):
+	__version = 1
+
+	def __init__( self, path ):
+		self.__path		= path
+		self.__data		= None
+		self.__refreshed	= False
+
+		try:
+			with open( path, 'r' ) as f:
+				data = json.load( f )
+
+			if data.get( 'version' ) == self.__version:
+				self.__data = data
+		except:
+			logging.info( 'No usable cache at \"' + path + '\"' )
+
+	def is_up_to_date( self, key, roots, output_paths ):
+		if not self.__data or self.__data.get( 'key' ) != key:
+			return False
+
+		outputs = self.__data.get( 'outputs', dict() )
+
+		if sorted( outputs.keys() ) != sorted( output_paths ):
+			return False
+
+		for path, info in outputs.items():
+			if self.__stat( path ) != info:
+				logging.info( 'Output \"' + path + '\" changed' )
+				return False
+
+		files	= self.__data.get( 'files', dict() )
+		pending	= list( roots )
+		visited	= set()
+
+		while pending:
+			path = pending.pop()
+
+			if path in visited:
+				continue
+
+			visited.add( path )
+
+			if not path in files or not self.__is_unchanged( path, files[ path ] ):
+				logging.info( 'Input \"' + path + '\" changed' )
+				return False
+
+			pending.extend( files[ path ][ 'includes' ] )
+
+		return True
+
+	# Whether an up-to-date check refreshed timestamps that are worth saving.
+	def is_refreshed( self ):
+		return self.__refreshed
+
+	def update( self, key, dependencies, output_paths ):
+		files = dict()
+
+		for path, info in dependencies.items():
+			entry			= dict( info )
+			entry[ 'stat' ]	= self.__stat( path )
+			files[ path ]	= entry
+
+		self.__data = { 'version' : self.__version, 'key' : key, 'files' : files,
+						'outputs' : dict( ( path, self.__stat( path ) ) for path in output_paths ) }
+
+	def save( self ):
+		write_file( self.__path, json.dumps( self.__data, indent = 1, sort_keys = True ) + '\n' )
+
+	def __stat( self, path ):
+		try:
+			st = os.stat( path )
+		except OSError:
+			return None
+
+		return [ st.st_mtime_ns, st.st_size ]
+
+	def __is_unchanged( self, path, info ):
+		stat = self.__stat( path )
+
+		if stat is None:
+			return False
+
+		if stat == info[ 'stat' ]:
+			return True
+
+		with open( path, 'rb' ) as f:
+			if hashlib.sha1( f.read() ).hexdigest() != info[ 'sha1' ]:
+				return False
+
+		# Same content under a new timestamp; remember it, once saved, so the next check is a plain stat again.
+		info[ 'stat' ]		= stat
+		self.__refreshed	= True
+		return True
+
+#--------------------------------------------------------------------------------------------------------------------------------------------------------------
+
 def create_argument_parser():
 	parser 			= argparse.ArgumentParser()
 	base_path 		= os.path.dirname( os.path.realpath( __file__ ) )
 	output_path		= os.path.join( base_path, 'Metal.hpp' )
 
 	parser.add_argument( '-o', '--output',  dest = 'output_path', metavar = 'PATH', default = output_path, help = 'Output path for the single header file.' )
+	parser.add_argument( '-s', '--stripped-output', dest = 'stripped_output_path', metavar = 'PATH', help = 'Also write a variant without comments and unused declarations.' )
+	parser.add_argument( '-i', '--incremental', action = 'store_true', help = 'Skip generation when no input changed since the last run.' )
+	parser.add_argument( '--cache', dest = 'cache_path', metavar = 'PATH', help = 'Cache file for --incremental. Defaults to the output path plus ".cache".' )
+	parser.add_argument( '-t', '--timing', action = 'store_true', help = 'Report the time spent in each phase.' )
 	parser.add_argument( '-v', '--verbose', action = 'store_true',  help = 'Show verbose output.' )
 	parser.add_argument( dest = 'header_paths', metavar = 'HEADER_FILE', nargs='+', help = 'Input header file.' )
 
@@ -204,18 +470,38 @@ def parse_arguments():
 	else:
 		logging.getLogger().setLevel( logging.ERROR )
 
+	args.output_path	= os.path.realpath( args.output_path )
+	args.header_paths	= [ os.path.realpath( path ) for path in args.header_paths ]
+
+	if args.stripped_output_path:
+		args.stripped_output_path = os.path.realpath( args.stripped_output_path )
+
+	if not args.cache_path:
+		args.cache_path = args.output_path + '.cache'
+
 	return args
 
 #--------------------------------------------------------------------------------------------------------------------------------------------------------------
 
-def make_header( args ):
-	prefix = HeaderPrefix( os.path.basename( args.output_path ) )
-	header = SingleHeader()
-	
-	for header_path in args.header_paths:
-		header.append( header_path )
+def output_paths( args ):
+	paths = [ args.output_path ]
 
-	return str( prefix ) + str( header )
+	if args.stripped_output_path:
+		paths.append( args.stripped_output_path )
+
+	return paths
+
+#--------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+# Everything besides the input files that the outputs depend on.
+
+def cache_key( args, meta_data ):
+	key = json.dumps( [ meta_data, args.header_paths, output_paths( args ) ] )
+
+	with open( os.path.realpath( __file__ ), 'rb' ) as f:
+		script = f.read()
+
+	return hashlib.sha1( key.encode( 'utf-8' ) + script ).hexdigest()
 
 #--------------------------------------------------------------------------------------------------------------------------------------------------------------
 
@@ -230,19 +516,91 @@ def make_dir( path ):
 
 #--------------------------------------------------------------------------------------------------------------------------------------------------------------
 
-def write_header( args, content ):
-	path = os.path.realpath( args.output_path )
+# Writes through a temporary file in the same directory and renames it over `path`, so readers never see a partial
+# file. Identical content is left untouched to keep its timestamp, and with it any downstream build, as it was.
+
+def write_file( path, content ):
+	if os.path.isfile( path ):
+		with open( path, 'r' ) as f:
+			if f.read() == content:
+				logging.info( 'Keeping unchanged \"' + path + '\"' )
+				return False
 
 	logging.info( 'Writing \"' + path + '\"...' )
 
-	make_dir( os.path.dirname( path ) )
+	directory = os.path.dirname( path )
+	make_dir( directory )
 
 	try:
-		f = open( path, 'w' )
+		fd, temp_path = tempfile.mkstemp( dir = directory, prefix = '.' + os.path.basename( path ) + '.' )
 	except:
 		raise RuntimeError( 'Failed to open file \"' + path + '\" for write!' )
 
-	f.write( content )
+	try:
+		# mkstemp() creates the file private to the user; give it the permissions `open()` would have.
+		umask = os.umask( 0 )
+		os.umask( umask )
+		os.chmod( temp_path, 0o666 & ~umask )
+
+		with os.fdopen( fd, 'w' ) as f:
+			f.write( content )
+
+		os.replace( temp_path, path )
+	except:
+		os.unlink( temp_path )
+		raise
+
+	return True
+
+#--------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+def make_headers( args ):
+	timer	= Timer()
+	prefix	= HeaderPrefix( os.path.basename( args.output_path ) )
+	key		= cache_key( args, prefix.meta_data() )
+	cache	= BuildCache( args.cache_path ) if args.incremental else None
+
+	timer.mark( 'prepare' )
+
+	if cache and cache.is_up_to_date( key, args.header_paths, output_paths( args ) ):
+		timer.mark( 'check' )
+		logging.info( 'Up to date' )
+
+		if cache.is_refreshed():
+			cache.save()
+			timer.mark( 'cache' )
+	else:
+		timer.mark( 'check' )
+
+		header = SingleHeader()
+
+		for header_path in args.header_paths:
+			header.append( header_path )
+
+		content = str( header )
+		timer.mark( 'expand' )
+
+		write_file( args.output_path, str( prefix ) + content )
+		timer.mark( 'write' )
+
+		if args.stripped_output_path:
+			stripped		= StrippedHeader( content )
+			stripped_prefix	= HeaderPrefix( os.path.basename( args.stripped_output_path ), prefix.meta_data() )
+			content			= str( stripped )
+
+			logging.info( 'Removed {} unused declarations'.format( stripped.removed_declarations() ) )
+			timer.mark( 'strip' )
+
+			write_file( args.stripped_output_path, str( stripped_prefix ) + content )
+			timer.mark( 'write' )
+
+		if cache:
+			cache.update( key, header.dependencies(), output_paths( args ) )
+			cache.save()
+			timer.mark( 'cache' )
+
+	if args.timing:
+		print( timer.report(), file = sys.stderr )
 
 #--------------------------------------------------------------------------------------------------------------------------------------------------------------
 
@@ -255,9 +613,8 @@ if __name__ == '__main__':
 			sys.setdefaultencoding( 'utf-8' )
 
 		args 	= parse_arguments()
-		header 	= make_header( args )
 
-		write_header( args, header )
+		make_headers( args )
 
 		result = 0
 
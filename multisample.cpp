@@ -0,0 +1,38 @@
+#include "multisample.h"
+
+bool
+MultisampleTarget::isSupported(MTL::Device *device, NS::UInteger sample_count) {
+    return device->supportsTextureSampleCount(sample_count);
+}
+
+MultisampleTarget::MultisampleTarget(MTL::Device *device, MTL::PixelFormat pixel_format, NS::UInteger sample_count)
+    : d_device(device)
+    , d_pixel_format(pixel_format)
+    , d_sample_count(sample_count)
+    , d_memoryless(device->supportsFamily(MTL::GPUFamilyApple1)) {
+}
+
+MTL::shared_ptr<MTL::RenderPassDescriptor>
+MultisampleTarget::renderPass(MTL::Texture *target) {
+    auto width = target->width(), height = target->height();
+
+    if (!d_samples || d_samples->width() != width || d_samples->height() != height) {
+        auto texture_descriptor = MTL::TextureDescriptor::texture2DDescriptor(d_pixel_format, width, height, false);
+        texture_descriptor->setTextureType(MTL::TextureType2DMultisample);
+        texture_descriptor->setSampleCount(d_sample_count);
+        texture_descriptor->setUsage(MTL::TextureUsageRenderTarget);
+        texture_descriptor->setStorageMode(d_memoryless ? MTL::StorageModeMemoryless : MTL::StorageModePrivate);
+
+        d_samples = MTL::make_owned(d_device->newTexture(texture_descriptor));
+    }
+
+    auto pass = MTL::make_owned(MTL::RenderPassDescriptor::alloc()->init());
+
+    auto color_attachment = pass->colorAttachments()->object(0);
+    color_attachment->setLoadAction(MTL::LoadAction::LoadActionClear);
+    color_attachment->setStoreAction(MTL::StoreAction::StoreActionMultisampleResolve);
+    color_attachment->setTexture(d_samples.get());
+    color_attachment->setResolveTexture(target);
+
+    return pass;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <Metal/Metal.hpp>
+#include <Metal/shared_ptr.hpp>
+
+// Multisampled color target that is resolved into the drawable as the render
+// pass stores it. On Apple GPUs the samples are memoryless, so they live only
+// in tile memory and the single-sample resolve is the only write to DRAM.
+// Pipelines drawn into the pass need a matching `setRasterSampleCount`.
+class MultisampleTarget {
+public:
+
+    // Whether `device` can render with `sample_count` samples per pixel.
+    static bool isSupported(MTL::Device *device, NS::UInteger sample_count);
+
+    MultisampleTarget(MTL::Device *device, MTL::PixelFormat pixel_format, NS::UInteger sample_count);
+
+    NS::UInteger sampleCount() const {
+        return d_sample_count;
+    }
+
+    // Whether the samples are memoryless rather than a private texture,
+    // which GPUs without tile memory need.
+    bool isMemoryless() const {
+        return d_memoryless;
+    }
+
+    // Render pass that clears the samples and resolves them into `target`.
+    // The multisample texture follows the target's size.
+    MTL::shared_ptr<MTL::RenderPassDescriptor> renderPass(MTL::Texture *target);
+
+private:
+
+    MTL::Device *d_device;
+    MTL::PixelFormat d_pixel_format;
+    NS::UInteger d_sample_count;
+    bool d_memoryless;
+
+    MTL::shared_ptr<MTL::Texture> d_samples;
+};
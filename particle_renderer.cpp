@@ -0,0 +1,188 @@
+#include "particle_renderer.h"
+#include "interned_string.h"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+#include "particles_metallib.h"
+
+// Report CPU simulation throughput this often.
+const uint32_t report_interval = 120;
+
+}
+
+ParticleRenderer::ParticleRenderer(MTL::Device *device, MTL::PixelFormat pixel_format, MTL::PixelFormat depth_pixel_format,
+    uint32_t count, bool simulate_on_cpu)
+    : d_simulate_on_cpu(simulate_on_cpu) {
+    NS::Error *err;
+
+    auto library_data = dispatch_data_create(
+        &particles_metallib[0], particles_metallib_len,
+        dispatch_get_main_queue(),
+        ^{ });
+
+    auto library = MTL::make_owned(device->newLibrary(library_data, &err));
+
+    if (!library) {
+        std::cerr << "Failed to create particle library" << std::endl;
+        std::exit(-1);
+    }
+
+    auto simulate_function = MTL::make_owned(library->newFunction(NS_STATIC_STRING("simulateParticles")));
+    d_simulate_pipeline = MTL::make_owned(device->newComputePipelineState(simulate_function.get(), &err));
+
+    if (!d_simulate_pipeline) {
+        std::cerr << "Failed to create particle simulation pipeline" << std::endl;
+        std::exit(-1);
+    }
+
+    auto vertex_function = MTL::make_owned(library->newFunction(NS_STATIC_STRING("particleVertex")));
+    auto fragment_function = MTL::make_owned(library->newFunction(NS_STATIC_STRING("particleFragment")));
+
+    auto pipeline_descriptor = MTL::make_owned(MTL::RenderPipelineDescriptor::alloc()->init());
+    pipeline_descriptor->setVertexFunction(vertex_function.get());
+    pipeline_descriptor->setFragmentFunction(fragment_function.get());
+    pipeline_descriptor->setDepthAttachmentPixelFormat(depth_pixel_format);
+
+    auto color_attachment_descriptor = pipeline_descriptor->colorAttachments()->object(0);
+    color_attachment_descriptor->setPixelFormat(pixel_format);
+    color_attachment_descriptor->setBlendingEnabled(true);
+    color_attachment_descriptor->setSourceRGBBlendFactor(MTL::BlendFactorSourceAlpha);
+    color_attachment_descriptor->setDestinationRGBBlendFactor(MTL::BlendFactorOneMinusSourceAlpha);
+
+    d_render_pipeline = MTL::make_owned(device->newRenderPipelineState(pipeline_descriptor.get(), &err));
+
+    if (!d_render_pipeline) {
+        std::cerr << "Failed to create particle render pipeline" << std::endl;
+        std::exit(-1);
+    }
+
+    d_params.dt = 1.0f / 60.0f;
+    d_params.gravityX = 0.0f;
+    d_params.gravityY = -300.0f;
+    d_params.damping = 1.0f - 0.2f * d_params.dt;
+    d_params.boundsX = 320.0f;
+    d_params.boundsY = 240.0f;
+    d_params.restitution = 0.6f;
+    d_params.lifetime = 4.0f;
+    d_params.count = count;
+    d_params.emitterCount = 2;
+    d_params.frame = 0;
+
+    d_emitters[0] = { -150.0f, -200.0f,  60.0f, 400.0f, 200.0f };
+    d_emitters[1] = {  150.0f, -200.0f, -60.0f, 400.0f, 200.0f };
+
+    for (auto& buffer : d_buffers) {
+        buffer = MTL::make_owned(device->newBuffer(sizeof(float) * count, MTL::ResourceStorageModeShared));
+    }
+
+    initializeParticles(arrays(), d_params, d_emitters);
+}
+
+void
+ParticleRenderer::update(MTL::CommandBuffer *buffer, float dt) {
+    d_params.dt = dt;
+    d_params.damping = 1.0f - 0.2f * dt;
+
+    if (d_simulate_on_cpu) {
+        if (d_previous) {
+            d_previous->waitUntilCompleted();
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        simulateParticles(arrays(), d_params, d_emitters, d_pool);
+        d_cpu_time += std::chrono::steady_clock::now() - start;
+
+        if (++d_cpu_steps == report_interval) {
+            double seconds = std::chrono::duration<double>(d_cpu_time).count();
+            std::cerr << "particles: " << (double)d_params.count * d_cpu_steps / seconds / 1.0e6
+                      << " M particles/s on " << d_pool.threadCount() << " threads" << std::endl;
+            d_cpu_time = std::chrono::steady_clock::duration(0);
+            d_cpu_steps = 0;
+        }
+
+        d_previous.reset(buffer);
+    }
+    else {
+        encodeStep(buffer);
+    }
+
+    ++d_params.frame;
+}
+
+void
+ParticleRenderer::draw(MTL::RenderCommandEncoder *encoder, vector_uint2 viewport) const {
+    encoder->setRenderPipelineState(d_render_pipeline.get());
+    encoder->setVertexBuffer(d_buffers[0].get(), 0, ParticleInputIndexPositionX);
+    encoder->setVertexBuffer(d_buffers[1].get(), 0, ParticleInputIndexPositionY);
+    encoder->setVertexBuffer(d_buffers[4].get(), 0, ParticleInputIndexAge);
+    encoder->setVertexBytes(&d_params, sizeof(d_params), ParticleInputIndexParams);
+    encoder->setVertexBytes(&viewport, sizeof(viewport), ParticleInputIndexViewportSize);
+    encoder->drawPrimitives(MTL::PrimitiveType::PrimitiveTypeTriangle, NS::UInteger(0), NS::UInteger(3), NS::UInteger(d_params.count));
+}
+
+void
+ParticleRenderer::validate(MTL::CommandQueue *queue) {
+    size_t count = d_params.count;
+
+    // Snapshot the state, step it on the CPU, then step the buffers on the GPU.
+    std::vector<float> expected[5];
+    float *expected_pointers[5];
+
+    for (int i = 0; i < 5; ++i) {
+        auto contents = (const float *)d_buffers[i]->contents();
+        expected[i].assign(contents, contents + count);
+        expected_pointers[i] = expected[i].data();
+    }
+
+    ParticleArrays cpu = { expected_pointers[0], expected_pointers[1], expected_pointers[2], expected_pointers[3], expected_pointers[4] };
+    simulateParticles(cpu, d_params, d_emitters, d_pool);
+
+    auto buffer = queue->commandBuffer();
+    encodeStep(buffer);
+    buffer->commit();
+    buffer->waitUntilCompleted();
+
+    const char *names[5] = { "position.x", "position.y", "velocity.x", "velocity.y", "age" };
+
+    for (int i = 0; i < 5; ++i) {
+        auto gpu = (const float *)d_buffers[i]->contents();
+        std::cerr << "particles: " << names[i] << " max difference "
+                  << maxUlpDifference(expected[i].data(), gpu, count) << " ulp" << std::endl;
+    }
+
+    ++d_params.frame;
+}
+
+ParticleArrays
+ParticleRenderer::arrays() const {
+    return {
+        (float *)d_buffers[0]->contents(),
+        (float *)d_buffers[1]->contents(),
+        (float *)d_buffers[2]->contents(),
+        (float *)d_buffers[3]->contents(),
+        (float *)d_buffers[4]->contents()
+    };
+}
+
+void
+ParticleRenderer::encodeStep(MTL::CommandBuffer *buffer) const {
+    auto encoder = buffer->computeCommandEncoder();
+
+    encoder->setComputePipelineState(d_simulate_pipeline.get());
+
+    for (int i = 0; i < 5; ++i) {
+        encoder->setBuffer(d_buffers[i].get(), 0, ParticleInputIndexPositionX + i);
+    }
+
+    encoder->setBytes(&d_params, sizeof(d_params), ParticleInputIndexParams);
+    encoder->setBytes(d_emitters, sizeof(d_emitters), ParticleInputIndexEmitters);
+
+    NS::UInteger width = std::min<NS::UInteger>(d_simulate_pipeline->maxTotalThreadsPerThreadgroup(), 256);
+    encoder->dispatchThreads(MTL::Size(d_params.count, 1, 1), MTL::Size(width, 1, 1));
+
+    encoder->endEncoding();
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "particle_simulation.h"
+#include "thread_pool.h"
+
+#include <Metal/Metal.hpp>
+#include <Metal/shared_ptr.hpp>
+
+#include <chrono>
+#include <simd/simd.h>
+
+// Particle system simulated either by a compute kernel or by the vectorized
+// CPU path, drawn as one instanced triangle per particle. The state lives in
+// shared buffers so both paths read and write it in place.
+class ParticleRenderer {
+public:
+
+    ParticleRenderer(MTL::Device *device, MTL::PixelFormat pixel_format, MTL::PixelFormat depth_pixel_format,
+        uint32_t count, bool simulate_on_cpu);
+
+    // Advances the simulation by `dt`. On the GPU path the step is encoded
+    // into `buffer` ahead of any render pass; on the CPU path it runs now.
+    void update(MTL::CommandBuffer *buffer, float dt);
+
+    void draw(MTL::RenderCommandEncoder *encoder, vector_uint2 viewport) const;
+
+    // Runs one step on the GPU and the CPU from identical state and prints
+    // the largest difference per array in ULPs.
+    void validate(MTL::CommandQueue *queue);
+
+private:
+
+    ParticleArrays arrays() const;
+    void encodeStep(MTL::CommandBuffer *buffer) const;
+
+    ParticleSimParams d_params;
+    ParticleEmitter d_emitters[2];
+    bool d_simulate_on_cpu;
+
+    MTL::shared_ptr<MTL::ComputePipelineState> d_simulate_pipeline;
+    MTL::shared_ptr<MTL::RenderPipelineState> d_render_pipeline;
+    MTL::shared_ptr<MTL::Buffer> d_buffers[5];
+
+    // The CPU path writes the buffers the previous frame is drawing from, so
+    // it waits for that frame first.
+    MTL::shared_ptr<MTL::CommandBuffer> d_previous;
+
+    ThreadPool d_pool;
+
+    std::chrono::steady_clock::duration d_cpu_time { 0 };
+    uint32_t d_cpu_steps = 0;
+};
@@ -0,0 +1,103 @@
+/*
+Particle simulation kernel and the shaders that draw each particle as a
+small triangle
+*/
+
+#include <metal_stdlib>
+
+using namespace metal;
+
+#include "core/particle_types.h"
+
+// One thread per particle. Mirrors simulateParticlesScalar() in
+// core/particle_simulation.cpp; keep the two in step.
+kernel void
+simulateParticles(device float *positionX [[buffer(ParticleInputIndexPositionX)]],
+                  device float *positionY [[buffer(ParticleInputIndexPositionY)]],
+                  device float *velocityX [[buffer(ParticleInputIndexVelocityX)]],
+                  device float *velocityY [[buffer(ParticleInputIndexVelocityY)]],
+                  device float *ages [[buffer(ParticleInputIndexAge)]],
+                  constant ParticleSimParams &params [[buffer(ParticleInputIndexParams)]],
+                  constant ParticleEmitter *emitters [[buffer(ParticleInputIndexEmitters)]],
+                  uint i [[thread_position_in_grid]])
+{
+    if (i >= params.count) {
+        return;
+    }
+
+    float dt = params.dt;
+    float age = ages[i] + dt;
+
+    if (age >= params.lifetime) {
+        ParticleEmitter emitter = emitters[i % params.emitterCount];
+
+        uint32_t h = particleHash(i ^ particleHash(params.frame));
+        float rx = particleRandom(h), ry = particleRandom(particleHash(h));
+
+        positionX[i] = emitter.positionX;
+        positionY[i] = emitter.positionY;
+        velocityX[i] = emitter.velocityX + (rx - 0.5f) * emitter.spread;
+        velocityY[i] = emitter.velocityY + (ry - 0.5f) * emitter.spread;
+        ages[i] = 0.0f;
+        return;
+    }
+
+    float vx = (velocityX[i] + params.gravityX * dt) * params.damping;
+    float vy = (velocityY[i] + params.gravityY * dt) * params.damping;
+    float px = positionX[i] + vx * dt;
+    float py = positionY[i] + vy * dt;
+
+    if (px < -params.boundsX || px > params.boundsX) {
+        vx = -vx * params.restitution;
+        px = min(max(px, -params.boundsX), params.boundsX);
+    }
+
+    if (py < -params.boundsY || py > params.boundsY) {
+        vy = -vy * params.restitution;
+        py = min(max(py, -params.boundsY), params.boundsY);
+    }
+
+    positionX[i] = px;
+    positionY[i] = py;
+    velocityX[i] = vx;
+    velocityY[i] = vy;
+    ages[i] = age;
+}
+
+struct ParticleRasterizerData
+{
+    float4 position [[position]];
+    float4 color;
+};
+
+// Three vertices per instance, one instance per particle.
+vertex ParticleRasterizerData
+particleVertex(uint vertexID [[vertex_id]],
+               uint instanceID [[instance_id]],
+               const device float *positionX [[buffer(ParticleInputIndexPositionX)]],
+               const device float *positionY [[buffer(ParticleInputIndexPositionY)]],
+               const device float *ages [[buffer(ParticleInputIndexAge)]],
+               constant ParticleSimParams &params [[buffer(ParticleInputIndexParams)]],
+               constant uint2 *viewportSizePointer [[buffer(ParticleInputIndexViewportSize)]])
+{
+    // Corners of a triangle roughly two pixels across.
+    const float2 corners[3] = { float2(0.0, 1.2), float2(-1.0, -0.6), float2(1.0, -0.6) };
+
+    ParticleRasterizerData out;
+
+    float2 pixelSpacePosition = float2(positionX[instanceID], positionY[instanceID]) + corners[vertexID];
+    float2 viewportSize = float2(*viewportSizePointer);
+
+    out.position = float4(pixelSpacePosition / (viewportSize / 2.0), 0.0, 1.0);
+
+    float t = saturate(ages[instanceID] / params.lifetime);
+    out.color = float4(mix(float3(1.0, 0.9, 0.4), float3(0.8, 0.1, 0.1), t), 1.0 - t);
+
+    return out;
+}
+
+fragment float4
+particleFragment(ParticleRasterizerData in [[stage_in]])
+{
+    return in.color;
+}
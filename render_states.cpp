@@ -0,0 +1,143 @@
+#include "render_states.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+const uint32_t pipeline_color_attachments = 4;
+
+uint64_t
+hashFunctionName(const MTL::Function *function) {
+    if (!function) {
+        return 0;
+    }
+
+    const char *name = function->name()->utf8String();
+    return hashName(name, std::strlen(name));
+}
+
+}
+
+SamplerKey
+SamplerKey::filtered(MTL::SamplerMinMagFilter filter, MTL::SamplerMipFilter mip_filter,
+    MTL::SamplerAddressMode address_mode) {
+    SamplerKey key;
+    key.bits = uint32_t(filter) | uint32_t(filter) << 1 | uint32_t(mip_filter) << 2 | uint32_t(address_mode) << 4 |
+               uint32_t(address_mode) << 7 | uint32_t(address_mode) << 10 | 1u << 13;
+    return key;
+}
+
+SamplerKey
+SamplerKey::withAnisotropy(uint32_t max_anisotropy) const {
+    SamplerKey key;
+    key.bits = (bits & ~(0x1fu << 13)) | std::clamp(max_anisotropy, 1u, 16u) << 13;
+    return key;
+}
+
+SamplerKey
+SamplerKey::withCompare(MTL::CompareFunction compare) const {
+    SamplerKey key;
+    key.bits = (bits & ~(7u << 18)) | uint32_t(compare) << 18;
+    return key;
+}
+
+SamplerKey
+SamplerKey::withBorderColor(MTL::SamplerBorderColor border_color) const {
+    SamplerKey key;
+    key.bits = (bits & ~(3u << 21)) | uint32_t(border_color) << 21;
+    return key;
+}
+
+SamplerKey
+SamplerKey::withArgumentBuffers() const {
+    SamplerKey key;
+    key.bits = bits | 1u << 23;
+    return key;
+}
+
+RenderPipelineKey
+RenderPipelineKey::describe(const MTL::RenderPipelineDescriptor *descriptor, uint64_t library) {
+    RenderPipelineKey key;
+    key.library = library;
+    key.vertex_function = hashFunctionName(descriptor->vertexFunction());
+    key.fragment_function = hashFunctionName(descriptor->fragmentFunction());
+
+    for (uint32_t i = 0; i < pipeline_color_attachments; ++i) {
+        auto attachment = descriptor->colorAttachments()->object(i);
+        key.color_formats[i] = uint32_t(attachment->pixelFormat());
+
+        if (attachment->pixelFormat() == MTL::PixelFormatInvalid) {
+            continue;
+        }
+
+        key.color_blending[i] = uint32_t(attachment->blendingEnabled()) | uint32_t(attachment->writeMask()) << 1 |
+                                uint32_t(attachment->rgbBlendOperation()) << 5 |
+                                uint32_t(attachment->alphaBlendOperation()) << 8;
+
+        // Factors only matter with blending on.
+        if (attachment->blendingEnabled()) {
+            key.color_blending[i] |= uint32_t(attachment->sourceRGBBlendFactor()) << 11 |
+                                     uint32_t(attachment->destinationRGBBlendFactor()) << 16 |
+                                     uint32_t(attachment->sourceAlphaBlendFactor()) << 21 |
+                                     uint32_t(attachment->destinationAlphaBlendFactor()) << 26;
+        }
+    }
+
+    key.depth_format = uint32_t(descriptor->depthAttachmentPixelFormat());
+    key.stencil_format = uint32_t(descriptor->stencilAttachmentPixelFormat());
+    key.raster_sample_count = uint32_t(descriptor->rasterSampleCount());
+    key.alpha_to_coverage = descriptor->alphaToCoverageEnabled();
+
+    return key;
+}
+
+SamplerCache::SamplerCache(MTL::Device *device, size_t max_entries)
+    : d_device(device)
+    , d_states(max_entries) {
+}
+
+MTL::shared_ptr<MTL::SamplerState>
+SamplerCache::get(SamplerKey key) {
+    return d_states.get(key, [this, key] {
+        auto descriptor = MTL::make_owned(MTL::SamplerDescriptor::alloc()->init());
+        descriptor->setMinFilter(MTL::SamplerMinMagFilter(key.bits & 1));
+        descriptor->setMagFilter(MTL::SamplerMinMagFilter((key.bits >> 1) & 1));
+        descriptor->setMipFilter(MTL::SamplerMipFilter((key.bits >> 2) & 3));
+        descriptor->setSAddressMode(MTL::SamplerAddressMode((key.bits >> 4) & 7));
+        descriptor->setTAddressMode(MTL::SamplerAddressMode((key.bits >> 7) & 7));
+        descriptor->setRAddressMode(MTL::SamplerAddressMode((key.bits >> 10) & 7));
+        descriptor->setMaxAnisotropy((key.bits >> 13) & 0x1f);
+        descriptor->setCompareFunction(MTL::CompareFunction((key.bits >> 18) & 7));
+        descriptor->setBorderColor(MTL::SamplerBorderColor((key.bits >> 21) & 3));
+        descriptor->setSupportArgumentBuffers((key.bits >> 23) & 1);
+
+        auto state = MTL::make_owned(d_device->newSamplerState(descriptor.get()));
+
+        if (!state) {
+            std::cerr << "Failed to create sampler state" << std::endl;
+            std::exit(-1);
+        }
+
+        return state;
+    });
+}
+
+RenderPipelineCache::RenderPipelineCache(MTL::Device *device, size_t max_entries)
+    : d_device(device)
+    , d_states(max_entries) {
+}
+
+MTL::shared_ptr<MTL::RenderPipelineState>
+RenderPipelineCache::get(const MTL::RenderPipelineDescriptor *descriptor, uint64_t library) {
+    return d_states.get(RenderPipelineKey::describe(descriptor, library), [this, descriptor] {
+        NS::Error *err;
+        auto pipeline = MTL::make_owned(d_device->newRenderPipelineState(descriptor, &err));
+
+        if (!pipeline) {
+            std::cerr << "Failed to create pipeline: " << err->localizedDescription()->utf8String() << std::endl;
+        }
+
+        return pipeline;
+    });
+}
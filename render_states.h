@@ -0,0 +1,118 @@
+#pragma once
+
+#include "state_cache.h"
+#include "string_hash.h"
+
+#include <Metal/Metal.hpp>
+#include <Metal/shared_ptr.hpp>
+
+#include <cstdint>
+#include <cstring>
+
+// A sampler state packed into 32 bits:
+//
+//     0       minification filter
+//     1       magnification filter
+//     3..2    mip filter
+//     6..4    s address mode
+//     9..7    t address mode
+//     12..10  r address mode
+//     17..13  maximum anisotropy, 1 to 16
+//     20..18  compare function
+//     22..21  border color
+//     23      usable from argument buffers
+//
+// Coordinates are normalized and the level of detail is not clamped.
+struct SamplerKey {
+    uint32_t bits = 0;
+
+    static SamplerKey filtered(MTL::SamplerMinMagFilter filter, MTL::SamplerMipFilter mip_filter,
+        MTL::SamplerAddressMode address_mode);
+
+    SamplerKey withAnisotropy(uint32_t max_anisotropy) const;
+    SamplerKey withCompare(MTL::CompareFunction compare) const;
+    SamplerKey withBorderColor(MTL::SamplerBorderColor border_color) const;
+    SamplerKey withArgumentBuffers() const;
+
+    uint64_t hash() const {
+        return hashName(reinterpret_cast<const char *>(&bits), sizeof(bits));
+    }
+
+    bool operator==(const SamplerKey& other) const {
+        return bits == other.bits;
+    }
+};
+
+// The parts of a render pipeline descriptor that tell pipelines apart, in a
+// fixed layout. Functions are known by name within `library`, a value the
+// caller picks to tell libraries apart, such as a hash of the metallib or a
+// reload count. Vertex descriptors, tessellation, linked functions and more
+// than four color attachments are not described; pipelines that differ only
+// there need different `library` values.
+struct RenderPipelineKey {
+    uint64_t library = 0;
+    uint64_t vertex_function = 0, fragment_function = 0;
+
+    // Per attachment: the pixel format, then blending packed as the enable
+    // bit, the write mask, the RGB and alpha operations and the four
+    // factors.
+    uint32_t color_formats[4] = {};
+    uint32_t color_blending[4] = {};
+
+    uint32_t depth_format = 0, stencil_format = 0;
+    uint32_t raster_sample_count = 0, alpha_to_coverage = 0;
+
+    static RenderPipelineKey describe(const MTL::RenderPipelineDescriptor *descriptor, uint64_t library = 0);
+
+    uint64_t hash() const {
+        return hashName(reinterpret_cast<const char *>(this), sizeof(*this));
+    }
+
+    bool operator==(const RenderPipelineKey& other) const {
+        return std::memcmp(this, &other, sizeof(*this)) == 0;
+    }
+};
+
+// Creates each `MTL::SamplerState` once and hands out the same object for
+// the same key, from any thread. Past `max_entries` the least recently used
+// sampler leaves the cache; the ones handed out stay alive as long as they
+// are held.
+class SamplerCache {
+public:
+
+    explicit SamplerCache(MTL::Device *device, size_t max_entries = 256);
+
+    MTL::shared_ptr<MTL::SamplerState> get(SamplerKey key);
+
+    size_t size() const {
+        return d_states.size();
+    }
+
+private:
+
+    MTL::Device *d_device;
+    StateCache<SamplerKey, MTL::shared_ptr<MTL::SamplerState>> d_states;
+};
+
+// Creates each render pipeline once per distinct descriptor, from any
+// thread, so asking for a pipeline that was made before costs a lookup
+// instead of a compile. Creation runs under the cache's lock. A pipeline
+// that fails to compile is reported and cached as empty, since the same
+// descriptor fails the same way again.
+class RenderPipelineCache {
+public:
+
+    explicit RenderPipelineCache(MTL::Device *device, size_t max_entries = 64);
+
+    MTL::shared_ptr<MTL::RenderPipelineState> get(const MTL::RenderPipelineDescriptor *descriptor,
+        uint64_t library = 0);
+
+    size_t size() const {
+        return d_states.size();
+    }
+
+private:
+
+    MTL::Device *d_device;
+    StateCache<RenderPipelineKey, MTL::shared_ptr<MTL::RenderPipelineState>> d_states;
+};
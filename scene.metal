@@ -0,0 +1,42 @@
+/*
+Shaders for instanced scene nodes, positioned by their world matrices
+*/
+
+#include <metal_stdlib>
+
+using namespace metal;
+
+#include "triangle_types.h"
+#include "core/scene_types.h"
+
+struct SceneRasterizerData
+{
+    float4 position [[position]];
+    float4 color;
+};
+
+vertex SceneRasterizerData
+sceneVertex(uint vertexID [[vertex_id]],
+            uint instanceID [[instance_id]],
+            constant AAPLVertex *vertices [[buffer(SceneInputIndexVertices)]],
+            constant vector_uint2 *viewportSizePointer [[buffer(SceneInputIndexViewportSize)]],
+            constant SceneMatrix *worlds [[buffer(SceneInputIndexInstances)]],
+            constant uint *visible [[buffer(SceneInputIndexVisible)]])
+{
+    SceneRasterizerData out;
+
+    // World space is pixel space, like the plain triangle's.
+    float4 world = worlds[visible[instanceID]] * float4(vertices[vertexID].position, 0.0, 1.0);
+    float2 viewportSize = float2(*viewportSizePointer);
+
+    out.position = float4(world.xy / (viewportSize / 2.0), 0.0, 1.0);
+    out.color = vertices[vertexID].color;
+
+    return out;
+}
+
+fragment float4
+sceneFragment(SceneRasterizerData in [[stage_in]])
+{
+    return in.color;
+}
@@ -0,0 +1,174 @@
+#include "scene_renderer.h"
+#include "interned_string.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+#include "scene_metallib.h"
+
+const uint32_t branching = 5;
+
+}
+
+SceneRenderer::SceneRenderer(MTL::Device *device, MTL::PixelFormat pixel_format, MTL::PixelFormat depth_pixel_format,
+    const AAPLVertex *vertices, size_t vertex_count, uint32_t node_count, uint32_t frames_in_flight)
+    : d_vertex_count(vertex_count) {
+    NS::Error *err;
+
+    auto library_data = dispatch_data_create(
+        &scene_metallib[0], scene_metallib_len,
+        dispatch_get_main_queue(),
+        ^{ });
+
+    auto library = MTL::make_owned(device->newLibrary(library_data, &err));
+
+    if (!library) {
+        std::cerr << "Failed to create scene library" << std::endl;
+        std::exit(-1);
+    }
+
+    auto vertex_function = MTL::make_owned(library->newFunction(NS_STATIC_STRING("sceneVertex")));
+    auto fragment_function = MTL::make_owned(library->newFunction(NS_STATIC_STRING("sceneFragment")));
+
+    auto pipeline_descriptor = MTL::make_owned(MTL::RenderPipelineDescriptor::alloc()->init());
+    pipeline_descriptor->setVertexFunction(vertex_function.get());
+    pipeline_descriptor->setFragmentFunction(fragment_function.get());
+    pipeline_descriptor->setDepthAttachmentPixelFormat(depth_pixel_format);
+    pipeline_descriptor->colorAttachments()->object(0)->setPixelFormat(pixel_format);
+
+    d_pipeline = MTL::make_owned(device->newRenderPipelineState(pipeline_descriptor.get(), &err));
+
+    if (!d_pipeline) {
+        std::cerr << "Failed to create scene pipeline" << std::endl;
+        std::exit(-1);
+    }
+
+    d_vertices = MTL::make_owned(device->newBuffer(vertices, sizeof(AAPLVertex) * vertex_count, MTL::ResourceStorageModeShared));
+
+    for (size_t i = 0; i < vertex_count; ++i) {
+        d_vertex_radius = std::max(d_vertex_radius, std::hypot(vertices[i].position[0], vertices[i].position[1]));
+    }
+
+    // Breadth first, so each level is a ring of smaller triangles around
+    // its parent. Positions are in the parent's space: the parent's scale
+    // shrinks the orbit along with the triangle.
+    node_count = std::max(node_count, 1u);
+
+    SceneTransform root;
+    root.scale[0] = root.scale[1] = root.scale[2] = 0.5f;
+    std::vector<SceneNode> nodes { d_scene.addNode(scene_no_parent, root) };
+
+    for (uint32_t i = 1; i < node_count; ++i) {
+        uint32_t parent = (i - 1) / branching, slot = (i - 1) % branching;
+        float angle = 2.0f * float(M_PI) * slot / branching;
+
+        SceneTransform local;
+        local.position[0] = 700.0f * std::cos(angle);
+        local.position[1] = 700.0f * std::sin(angle);
+        local.scale[0] = local.scale[1] = local.scale[2] = 0.4f;
+        nodes.push_back(d_scene.addNode(nodes[parent], local));
+    }
+
+    // Every node with children spins, alternating direction by depth.
+    for (uint32_t i = 0; i * branching + 1 < node_count; ++i) {
+        uint32_t depth = 0;
+
+        for (uint32_t j = i; j != 0; j = (j - 1) / branching) {
+            ++depth;
+        }
+
+        d_spinning.push_back(nodes[i]);
+        d_speeds.push_back((depth % 2 ? -0.6f : 0.4f) * (1.0f + 0.25f * depth));
+    }
+
+    for (uint32_t i = 0; i < frames_in_flight; ++i) {
+        d_instance_buffers.push_back(MTL::make_owned(device->newBuffer(
+            sizeof(SceneMatrix) * node_count, MTL::ResourceStorageModeShared)));
+        d_visible_buffers.push_back(MTL::make_owned(device->newBuffer(
+            sizeof(uint32_t) * node_count, MTL::ResourceStorageModeShared)));
+    }
+
+    d_bounds.resize(node_count);
+
+    d_stale.assign(frames_in_flight, Range { 0, node_count });
+}
+
+void
+SceneRenderer::update(float time) {
+    for (size_t i = 0; i < d_spinning.size(); ++i) {
+        float half = 0.5f * d_speeds[i] * time;
+        d_scene.setRotation(d_spinning[i], 0.0f, 0.0f, std::sin(half), std::cos(half));
+    }
+
+    d_scene.update(&d_pool);
+
+    uint32_t begin = d_scene.changedBegin(), end = d_scene.changedEnd();
+
+    if (begin == end) {
+        return;
+    }
+
+    // A node's circle is its origin and the vertex radius under its largest
+    // axis scale.
+    const SceneMatrix *worlds = d_scene.worldMatrices();
+
+    for (uint32_t i = begin; i < end; ++i) {
+        const SceneMatrix& world = worlds[i];
+        float scale = std::max(std::hypot(world.columns[0][0], world.columns[0][1]),
+            std::hypot(world.columns[1][0], world.columns[1][1]));
+        d_bounds.setSphere(i, world.columns[3][0], world.columns[3][1], 0.0f, scale * d_vertex_radius);
+    }
+
+    for (Range& stale : d_stale) {
+        if (stale.begin == stale.end) {
+            stale = Range { begin, end };
+        }
+        else {
+            stale.begin = std::min(stale.begin, begin);
+            stale.end = std::max(stale.end, end);
+        }
+    }
+}
+
+void
+SceneRenderer::draw(MTL::RenderCommandEncoder *encoder, vector_uint2 viewport) {
+    MTL::Buffer *instance_buffer = d_instance_buffers[d_frame].get();
+    MTL::Buffer *visible_buffer = d_visible_buffers[d_frame].get();
+    Range& stale = d_stale[d_frame];
+    d_frame = (d_frame + 1) % d_instance_buffers.size();
+
+    // Only what changed since this buffer was last drawn from.
+    if (stale.begin != stale.end) {
+        std::memcpy((SceneMatrix *)instance_buffer->contents() + stale.begin, d_scene.worldMatrices() + stale.begin,
+            sizeof(SceneMatrix) * (stale.end - stale.begin));
+        stale = Range();
+    }
+
+    // The shader's pixel-to-clip mapping as a matrix, with depth held at
+    // one half so only the side planes cull.
+    float view_projection[16] = {};
+    view_projection[0] = 2.0f / viewport[0];
+    view_projection[5] = 2.0f / viewport[1];
+    view_projection[14] = 0.5f;
+    view_projection[15] = 1.0f;
+
+    size_t visible_count = cullFrustum(d_bounds, frustumFromMatrix(view_projection), CullShapeSphere, d_visible, &d_pool);
+
+    if (visible_count == 0) {
+        return;
+    }
+
+    std::memcpy(visible_buffer->contents(), d_visible.data(), sizeof(uint32_t) * visible_count);
+
+    encoder->setRenderPipelineState(d_pipeline.get());
+    encoder->setVertexBuffer(d_vertices.get(), 0, SceneInputIndexVertices);
+    encoder->setVertexBytes(&viewport, sizeof(viewport), SceneInputIndexViewportSize);
+    encoder->setVertexBuffer(instance_buffer, 0, SceneInputIndexInstances);
+    encoder->setVertexBuffer(visible_buffer, 0, SceneInputIndexVisible);
+    encoder->drawPrimitives(MTL::PrimitiveTypeTriangle, NS::UInteger(0), NS::UInteger(d_vertex_count),
+        NS::UInteger(visible_count));
+}
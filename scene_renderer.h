@@ -0,0 +1,58 @@
+#pragma once
+
+#include "culling.h"
+#include "scene_graph.h"
+#include "thread_pool.h"
+#include "triangle_types.h"
+
+#include <Metal/Metal.hpp>
+#include <Metal/shared_ptr.hpp>
+
+#include <simd/simd.h>
+#include <vector>
+
+// A hierarchy of spinning triangles: each node orbits its parent, and every
+// node with children turns each frame, so whole subtrees follow. Drawn as one
+// instanced draw whose per-instance world matrices come from a ring of shared
+// buffers, into which only the matrices that changed since a buffer was last
+// written are copied. Nodes outside the viewport are culled on the CPU first;
+// the draw covers the visible list only.
+class SceneRenderer {
+public:
+
+    SceneRenderer(MTL::Device *device, MTL::PixelFormat pixel_format, MTL::PixelFormat depth_pixel_format,
+        const AAPLVertex *vertices, size_t vertex_count, uint32_t node_count, uint32_t frames_in_flight = 3);
+
+    void update(float time);
+
+    void draw(MTL::RenderCommandEncoder *encoder, vector_uint2 viewport);
+
+private:
+
+    struct Range {
+        uint32_t begin = 0, end = 0;
+    };
+
+    MTL::shared_ptr<MTL::RenderPipelineState> d_pipeline;
+    MTL::shared_ptr<MTL::Buffer> d_vertices;
+    size_t d_vertex_count;
+
+    std::vector<MTL::shared_ptr<MTL::Buffer>> d_instance_buffers;
+    std::vector<MTL::shared_ptr<MTL::Buffer>> d_visible_buffers;
+
+    // Instances each buffer is missing.
+    std::vector<Range> d_stale;
+    uint32_t d_frame = 0;
+
+    SceneGraph d_scene;
+    std::vector<SceneNode> d_spinning;
+    std::vector<float> d_speeds;
+
+    // Bounding circles by instance index, and the radius of the vertices
+    // around the origin.
+    CullBounds d_bounds;
+    float d_vertex_radius = 0.0f;
+    std::vector<uint32_t> d_visible;
+
+    ThreadPool d_pool;
+};
@@ -0,0 +1,166 @@
+#include "shader_reload.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+// Saves usually arrive as a burst of events; wait this long for them to stop.
+const std::chrono::milliseconds reload_quiet_period(150);
+
+// What `compile_metal_source` uses for sources without a METAL_STANDARD.
+const char *const default_metal_standard = "macos-metal2.2";
+
+std::string
+baseName(const std::string& path) {
+    auto slash = path.find_last_of('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+// Same invocation as `compile_metal_source` in cmake/modules/metal.cmake.
+bool
+compileMetalSource(const std::string& source, const std::string& standard, const std::string& include_directory,
+    const std::string& output) {
+    std::string command =
+        "xcrun -sdk macosx metal -std=" + standard +
+        " -I '" + include_directory + "'"
+        " -o '" + output + "'"
+        " '" + source + "' 2>&1";
+
+    FILE *pipe = popen(command.c_str(), "r");
+
+    if (!pipe) {
+        return false;
+    }
+
+    std::string log;
+    char line[512];
+
+    while (std::fgets(line, sizeof(line), pipe)) {
+        log += line;
+    }
+
+    int status = pclose(pipe);
+
+    if (!log.empty()) {
+        std::cerr << log;
+    }
+
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+}
+
+ShaderReloader::ShaderReloader(MTL::Device *device, const std::string& source_directory,
+    const std::string& standards)
+    : d_device(device)
+    , d_source_directory(source_directory) {
+    for (size_t begin = 0; begin < standards.size(); ) {
+        size_t end = standards.find(',', begin);
+        end = end == std::string::npos ? standards.size() : end;
+
+        std::string entry = standards.substr(begin, end - begin);
+        size_t equals = entry.find('=');
+
+        if (equals != std::string::npos) {
+            d_standards[entry.substr(0, equals)] = entry.substr(equals + 1);
+        }
+
+        begin = end + 1;
+    }
+}
+
+void
+ShaderReloader::add(const std::string& file, Builder builder) {
+    auto entry = std::make_unique<Entry>();
+    entry->builder = std::move(builder);
+    d_entries[file] = std::move(entry);
+}
+
+void
+ShaderReloader::start() {
+    d_service = std::make_unique<HotReloadService>(
+        std::vector<std::string> { d_source_directory }, ".metal", reload_quiet_period,
+        [this](const std::string& path) {
+            rebuild(path);
+        });
+}
+
+bool
+ShaderReloader::take(const std::string& file, MTL::shared_ptr<MTL::RenderPipelineState>& pipeline) {
+    auto it = d_entries.find(file);
+
+    if (it == d_entries.end()) {
+        return false;
+    }
+
+    MTL::shared_ptr<MTL::RenderPipelineState> rebuilt;
+
+    if (!it->second->swap.take(rebuilt)) {
+        return false;
+    }
+
+    pipeline = std::move(rebuilt);
+    return true;
+}
+
+void
+ShaderReloader::rebuild(const std::string& path) {
+    // Runs on the watcher thread.
+    auto file = baseName(path);
+    auto it = d_entries.find(file);
+
+    if (it == d_entries.end()) {
+        return;
+    }
+
+    auto pool = NS::AutoreleasePool::alloc()->init();
+    auto start = std::chrono::steady_clock::now();
+
+    std::cerr << "Recompiling " << file << std::endl;
+
+    auto standard = d_standards.find(file);
+
+    // A fresh file nobody else can have put in place; the library is read
+    // in full when it is created, so the file goes right after.
+    char output[] = "/tmp/sdl-metal-XXXXXX.metallib";
+    int fd = mkstemps(output, (int)std::strlen(".metallib"));
+
+    if (fd < 0) {
+        std::cerr << "Failed to create a file for " << file << std::endl;
+        pool->release();
+        return;
+    }
+
+    close(fd);
+
+    if (compileMetalSource(d_source_directory + "/" + file,
+            standard == d_standards.end() ? default_metal_standard : standard->second, d_source_directory, output)) {
+        NS::Error *err;
+
+        auto url = NS::URL::fileURLWithPath(NS::String::string(output, NS::UTF8StringEncoding));
+        auto library = MTL::make_owned(d_device->newLibrary(url, &err));
+
+        if (library) {
+            auto pipeline = it->second->builder(library.get());
+
+            if (pipeline) {
+                it->second->swap.publish(std::move(pipeline));
+
+                auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                std::cerr << "Reloaded " << file << " in " << elapsed << " ms" << std::endl;
+            }
+        }
+        else {
+            std::cerr << "Failed to load " << output << std::endl;
+        }
+    }
+
+    unlink(output);
+    pool->release();
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "frame_swap.h"
+#include "hot_reload.h"
+
+#include <Metal/Metal.hpp>
+#include <Metal/shared_ptr.hpp>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
+// Development mode: recompiles `.metal` sources when they are saved and
+// rebuilds the pipelines made from them, all off the render thread. The
+// render loop swaps the new pipelines in between frames.
+class ShaderReloader {
+public:
+
+    // Returns an empty pointer on failure, leaving the old pipeline in use.
+    using Builder = std::function<MTL::shared_ptr<MTL::RenderPipelineState>(MTL::Library *library)>;
+
+    // `standards` lists the language version of each source as
+    // "file=standard,...", as the build compiled them; others use the
+    // build's default.
+    ShaderReloader(MTL::Device *device, const std::string& source_directory, const std::string& standards);
+
+    // Registers a pipeline to rebuild when `file`, a name relative to the
+    // source directory, changes. Call before `start`.
+    void add(const std::string& file, Builder builder);
+
+    void start();
+
+    // Replaces `pipeline` if a rebuilt one from `file` is waiting.
+    bool take(const std::string& file, MTL::shared_ptr<MTL::RenderPipelineState>& pipeline);
+
+private:
+
+    struct Entry {
+        Builder builder;
+        FrameSwap<MTL::shared_ptr<MTL::RenderPipelineState>> swap;
+    };
+
+    void rebuild(const std::string& path);
+
+    MTL::Device *d_device;
+    std::string d_source_directory;
+    std::map<std::string, std::string> d_standards;
+
+    std::map<std::string, std::unique_ptr<Entry>> d_entries;
+    std::unique_ptr<HotReloadService> d_service;
+};
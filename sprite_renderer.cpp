@@ -0,0 +1,217 @@
+#include "sprite_renderer.h"
+#include "interned_string.h"
+#include "texture_loader.h"
+#include "texture_upload.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+namespace {
+
+#include "sprites_metallib.h"
+
+const uint32_t image_count = 96;
+const uint32_t page_size = 256;
+
+// Fills `width` x `height` RGBA8 pixels at `pixels` (rows `stride` pixels
+// apart) with a soft disc whose hue depends on `seed`, so images are told
+// apart on screen.
+void
+paintImage(uint32_t *pixels, uint32_t stride, uint32_t width, uint32_t height, uint32_t seed) {
+    uint32_t red = 128 + (seed * 53) % 128, green = 128 + (seed * 97) % 128, blue = 128 + (seed * 31) % 128;
+
+    for (uint32_t y = 0; y < height; ++y) {
+        for (uint32_t x = 0; x < width; ++x) {
+            float dx = ((float)x + 0.5f) / width * 2.0f - 1.0f;
+            float dy = ((float)y + 0.5f) / height * 2.0f - 1.0f;
+            float alpha = std::clamp(1.0f - std::sqrt(dx * dx + dy * dy), 0.0f, 1.0f);
+
+            uint32_t a = (uint32_t)(alpha * 255.0f + 0.5f);
+            pixels[y * stride + x] = red | (green << 8) | (blue << 16) | (a << 24);
+        }
+    }
+}
+
+}
+
+SpriteRenderer::SpriteRenderer(MTL::Device *device, SamplerCache *samplers, MTL::PixelFormat pixel_format,
+    MTL::PixelFormat depth_pixel_format, uint32_t count, bool compressed_atlas, TextureUploader *uploader,
+    uint32_t frames_in_flight)
+    : d_sampler(samplers->get(SamplerKey::filtered(MTL::SamplerMinMagFilterLinear, MTL::SamplerMipFilterNotMipmapped,
+        MTL::SamplerAddressModeClampToEdge))) {
+    NS::Error *err;
+
+    auto library_data = dispatch_data_create(
+        &sprites_metallib[0], sprites_metallib_len,
+        dispatch_get_main_queue(),
+        ^{ });
+
+    auto library = MTL::make_owned(device->newLibrary(library_data, &err));
+
+    if (!library) {
+        std::cerr << "Failed to create sprite library" << std::endl;
+        std::exit(-1);
+    }
+
+    auto vertex_function = MTL::make_owned(library->newFunction(NS_STATIC_STRING("spriteVertex")));
+    auto fragment_function = MTL::make_owned(library->newFunction(NS_STATIC_STRING("spriteFragment")));
+
+    for (int blend = 0; blend < SpriteBlendCount; ++blend) {
+        auto pipeline_descriptor = MTL::make_owned(MTL::RenderPipelineDescriptor::alloc()->init());
+        pipeline_descriptor->setVertexFunction(vertex_function.get());
+        pipeline_descriptor->setFragmentFunction(fragment_function.get());
+        pipeline_descriptor->setDepthAttachmentPixelFormat(depth_pixel_format);
+
+        auto color_attachment_descriptor = pipeline_descriptor->colorAttachments()->object(0);
+        color_attachment_descriptor->setPixelFormat(pixel_format);
+
+        if (blend != SpriteBlendOpaque) {
+            color_attachment_descriptor->setBlendingEnabled(true);
+            color_attachment_descriptor->setSourceRGBBlendFactor(MTL::BlendFactorSourceAlpha);
+            color_attachment_descriptor->setDestinationRGBBlendFactor(
+                blend == SpriteBlendAdditive ? MTL::BlendFactorOne : MTL::BlendFactorOneMinusSourceAlpha);
+        }
+
+        d_pipelines[blend] = MTL::make_owned(device->newRenderPipelineState(pipeline_descriptor.get(), &err));
+
+        if (!d_pipelines[blend]) {
+            std::cerr << "Failed to create sprite pipeline" << std::endl;
+            std::exit(-1);
+        }
+    }
+
+    std::mt19937 random(42);
+
+    // Atlas: procedural images of random size, packed and uploaded page by page.
+    std::vector<AtlasRect> sizes(image_count);
+    std::uniform_int_distribution<uint32_t> edge(8, 48);
+
+    for (auto& size : sizes) {
+        size.width = edge(random);
+        size.height = edge(random);
+    }
+
+    AtlasLayout layout = packAtlas(sizes.data(), sizes.size(), page_size, page_size);
+    std::vector<std::vector<uint32_t>> page_pixels(layout.page_count, std::vector<uint32_t>(page_size * page_size, 0));
+
+    for (uint32_t i = 0; i < image_count; ++i) {
+        const AtlasEntry& entry = layout.entries[i];
+        paintImage(&page_pixels[entry.page][entry.rect.y * page_size + entry.rect.x], page_size,
+            entry.rect.width, entry.rect.height, i);
+    }
+
+    // Pages are cooked without mips, since sprites are drawn at their own
+    // size, and loaded like any other texture.
+    TextureFormat page_format = compressed_atlas ? TextureFormatUniversal : TextureFormatRGBA8;
+
+    for (const auto& pixels : page_pixels) {
+        std::vector<uint8_t> file = cookTexture(pixels.data(), page_size, page_size, page_format, false);
+        TextureFileView view;
+        parseTextureFile(file.data(), file.size(), view);
+        d_pages.push_back(loadTexture(device, view, nullptr, uploader));
+    }
+
+    if (uploader) {
+        uploader->flush();
+    }
+
+    std::cerr << "sprites: " << image_count << " images on " << layout.page_count << " atlas pages, "
+              << layout.occupancy * 100.0f << "% occupied, "
+              << textureFormatName(compressed_atlas ? nativeTextureFormat(device) : TextureFormatRGBA8) << std::endl;
+
+    // Sprites: a random image each, moving around the viewport.
+    std::uniform_real_distribution<float> position_x(-320.0f, 320.0f), position_y(-240.0f, 240.0f);
+    std::uniform_real_distribution<float> speed(-120.0f, 120.0f);
+
+    d_sprites.resize(count);
+    d_bodies.resize(count);
+
+    for (uint32_t i = 0; i < count; ++i) {
+        const AtlasEntry& entry = layout.entries[random() % image_count];
+        Sprite& sprite = d_sprites[i];
+
+        sprite.x = position_x(random);
+        sprite.y = position_y(random);
+        sprite.width = (float)entry.rect.width;
+        sprite.height = (float)entry.rect.height;
+        sprite.u0 = (float)entry.rect.x / page_size;
+        sprite.v0 = (float)entry.rect.y / page_size;
+        sprite.u1 = (float)(entry.rect.x + entry.rect.width) / page_size;
+        sprite.v1 = (float)(entry.rect.y + entry.rect.height) / page_size;
+        sprite.texture = (uint16_t)entry.page;
+        sprite.blend = (SpriteBlend)(1 + random() % (SpriteBlendCount - 1));
+        sprite.layer = (uint16_t)(random() % 2);
+
+        d_bodies[i] = Body { speed(random), speed(random) };
+    }
+
+    // Written by the CPU each frame while the GPU may still read the
+    // previous ones, hence one buffer per frame in flight. Shared storage
+    // stays mapped for the life of the buffer.
+    for (uint32_t i = 0; i < frames_in_flight; ++i) {
+        d_vertex_buffers.push_back(MTL::make_owned(device->newBuffer(
+            sizeof(SpriteVertex) * 6 * std::max(count, 1u), MTL::ResourceStorageModeShared)));
+    }
+}
+
+void
+SpriteRenderer::update(float dt) {
+    for (size_t i = 0; i < d_sprites.size(); ++i) {
+        Sprite& sprite = d_sprites[i];
+        Body& body = d_bodies[i];
+
+        sprite.x += body.velocity_x * dt;
+        sprite.y += body.velocity_y * dt;
+
+        if (std::abs(sprite.x) > 320.0f) {
+            body.velocity_x = -body.velocity_x;
+            sprite.x = std::clamp(sprite.x, -320.0f, 320.0f);
+        }
+
+        if (std::abs(sprite.y) > 240.0f) {
+            body.velocity_y = -body.velocity_y;
+            sprite.y = std::clamp(sprite.y, -240.0f, 240.0f);
+        }
+    }
+}
+
+void
+SpriteRenderer::draw(MTL::RenderCommandEncoder *encoder, vector_uint2 viewport) {
+    if (d_sprites.empty()) {
+        return;
+    }
+
+    MTL::Buffer *vertex_buffer = d_vertex_buffers[d_frame].get();
+    d_frame = (d_frame + 1) % d_vertex_buffers.size();
+
+    d_batch.clear();
+
+    for (const auto& sprite : d_sprites) {
+        d_batch.add(sprite);
+    }
+
+    d_batch.build((SpriteVertex *)vertex_buffer->contents(), d_sprites.size());
+
+    encoder->setVertexBuffer(vertex_buffer, 0, SpriteInputIndexVertices);
+    encoder->setVertexBytes(&viewport, sizeof(viewport), SpriteInputIndexViewportSize);
+    encoder->setFragmentSamplerState(d_sampler.get(), SpriteInputIndexSampler);
+
+    // Draws come sorted, so state only changes between runs.
+    int bound_blend = -1, bound_texture = -1;
+
+    for (const auto& draw : d_batch.draws()) {
+        if (draw.blend != bound_blend) {
+            encoder->setRenderPipelineState(d_pipelines[draw.blend].get());
+            bound_blend = draw.blend;
+        }
+
+        if (draw.texture != bound_texture) {
+            encoder->setFragmentTexture(d_pages[draw.texture].get(), SpriteInputIndexTexture);
+            bound_texture = draw.texture;
+        }
+
+        encoder->drawPrimitives(MTL::PrimitiveTypeTriangle, NS::UInteger(draw.vertex_start), NS::UInteger(draw.vertex_count));
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "atlas_packer.h"
+#include "render_states.h"
+#include "sprite_batch.h"
+
+#include <Metal/Metal.hpp>
+#include <Metal/shared_ptr.hpp>
+
+#include <simd/simd.h>
+#include <vector>
+
+class TextureUploader;
+
+// Bouncing textured sprites drawn through `SpriteBatch`. Procedural images
+// are packed into atlas pages at startup; every frame the batch writes its
+// vertices straight into one of a ring of persistently mapped shared
+// buffers and issues one draw per run of equal texture and blend state.
+class SpriteRenderer {
+public:
+
+    // `frames_in_flight` vertex buffers are cycled, matching how many frames
+    // the GPU may still be reading. With `compressed_atlas`, pages are
+    // cooked to universal blocks and transcoded to the device's block
+    // format as they are loaded. With `uploader`, pages are private and
+    // filled through its staging ring. The linear, clamped sampler comes
+    // from `samplers`, shared with the other overlays.
+    SpriteRenderer(MTL::Device *device, SamplerCache *samplers, MTL::PixelFormat pixel_format,
+        MTL::PixelFormat depth_pixel_format, uint32_t count, bool compressed_atlas = false, TextureUploader *uploader = nullptr,
+        uint32_t frames_in_flight = 3);
+
+    void update(float dt);
+
+    void draw(MTL::RenderCommandEncoder *encoder, vector_uint2 viewport);
+
+    uint32_t atlasPageCount() const {
+        return (uint32_t)d_pages.size();
+    }
+
+private:
+
+    struct Body {
+        float velocity_x, velocity_y;
+    };
+
+    MTL::shared_ptr<MTL::RenderPipelineState> d_pipelines[SpriteBlendCount];
+    MTL::shared_ptr<MTL::SamplerState> d_sampler;
+    std::vector<MTL::shared_ptr<MTL::Texture>> d_pages;
+    std::vector<MTL::shared_ptr<MTL::Buffer>> d_vertex_buffers;
+    uint32_t d_frame = 0;
+
+    std::vector<Sprite> d_sprites;
+    std::vector<Body> d_bodies;
+    SpriteBatch d_batch;
+};
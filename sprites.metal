@@ -0,0 +1,41 @@
+/*
+Shaders for batched, textured sprites
+*/
+
+#include <metal_stdlib>
+
+using namespace metal;
+
+#include "core/sprite_types.h"
+
+struct SpriteRasterizerData
+{
+    float4 position [[position]];
+    float2 texCoord;
+    float4 color;
+};
+
+vertex SpriteRasterizerData
+spriteVertex(uint vertexID [[vertex_id]],
+             constant SpriteVertex *vertices [[buffer(SpriteInputIndexVertices)]],
+             constant vector_uint2 *viewportSizePointer [[buffer(SpriteInputIndexViewportSize)]])
+{
+    SpriteRasterizerData out;
+
+    constant SpriteVertex &in = vertices[vertexID];
+    float2 viewportSize = float2(*viewportSizePointer);
+
+    out.position = float4(float2(in.positionX, in.positionY) / (viewportSize / 2.0), 0.0, 1.0);
+    out.texCoord = float2(in.u, in.v);
+    out.color = unpack_unorm4x8_to_float(in.color);
+
+    return out;
+}
+
+fragment float4
+spriteFragment(SpriteRasterizerData in [[stage_in]],
+               texture2d<float> atlas [[texture(SpriteInputIndexTexture)]],
+               sampler s [[sampler(SpriteInputIndexSampler)]])
+{
+    return atlas.sample(s, in.texCoord) * in.color;
+}
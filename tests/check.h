@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdio>
+
+// Assertions for the test executables. A failed CHECK prints where it is and
+// is counted, and the test goes on; `checkResult` turns the count into the
+// exit status CTest looks at.
+
+inline int&
+checkFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(condition)                                                                   \
+    do {                                                                                   \
+        if (!(condition)) {                                                                \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            ++checkFailures();                                                             \
+        }                                                                                  \
+    } while (0)
+
+inline int
+checkResult(const char *test) {
+    if (checkFailures() > 0) {
+        std::printf("%s: %d check%s failed\n", test, checkFailures(), checkFailures() == 1 ? "" : "s");
+        return 1;
+    }
+
+    std::printf("%s: passed\n", test);
+    return 0;
+}
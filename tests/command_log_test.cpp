@@ -0,0 +1,266 @@
+// The command log format: frames written by CommandLogWriter decode to the
+// same commands from a mapped file, inline data is aligned in place and
+// repeated bytes come back as the earlier data, rewinding replays the same
+// again, and truncated or malformed logs fail instead of reading past the
+// end.
+
+#include "check.h"
+#include "command_log.h"
+#include "mapped_file.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+const size_t header_size = 16;
+
+// Opcodes as command_log.cpp numbers them.
+const uint8_t opcode_begin_frame = 1, opcode_end_frame = 2, opcode_repeat_vertex_bytes = 6;
+
+// Every command as a line of text, data included, so two runs compare as
+// strings.
+class RecordingSink : public CommandSink {
+public:
+
+    void beginFrame(uint64_t frame) override {
+        commands.push_back("begin " + std::to_string(frame));
+    }
+
+    void endFrame() override {
+        commands.push_back("end");
+    }
+
+    void definePipeline(uint32_t id, const std::string& name) override {
+        commands.push_back("pipeline " + std::to_string(id) + " " + name);
+    }
+
+    void setRenderPipelineState(uint32_t id) override {
+        commands.push_back("state " + std::to_string(id));
+    }
+
+    void setVertexBytes(const void *bytes, size_t length, uint32_t index) override {
+        commands.push_back("bytes " + std::to_string(index) + " " + std::string((const char *)bytes, length));
+        data.push_back((const uint8_t *)bytes);
+    }
+
+    void setViewport(const LoggedViewport& viewport) override {
+        commands.push_back("viewport " + std::to_string(viewport.width) + "x" + std::to_string(viewport.height));
+    }
+
+    void drawPrimitives(uint32_t primitive_type, uint64_t vertex_start, uint64_t vertex_count,
+        uint64_t instance_count) override {
+        commands.push_back("draw " + std::to_string(primitive_type) + " " + std::to_string(vertex_start) + " " +
+                           std::to_string(vertex_count) + " " + std::to_string(instance_count));
+    }
+
+    std::vector<std::string> commands;
+
+    // Where each setVertexBytes pointed.
+    std::vector<const uint8_t *> data;
+};
+
+// Three frames: a pipeline defined on first use and only selected after,
+// vertex data repeated, changed and sent to an index past the table, and
+// counts that need several varint bytes.
+bool
+writeLog(const char *path, std::vector<std::string>& expected) {
+    CommandLogWriter writer;
+
+    if (!writer.open(path)) {
+        return false;
+    }
+
+    int triangle = 0, other = 0;
+    const char vertices[] = "three vertices, 48 bytes of them in the log....";
+    const uint32_t small[2] = { 640, 480 }, large[2] = { 1280, 960 };
+    const LoggedViewport viewport = { 0.0f, 0.0f, 640.0f, 480.0f, 0.0f, 1.0f };
+
+    writer.beginFrame(7);
+    writer.setRenderPipelineState(&triangle, "triangle");
+    writer.setViewport(viewport);
+    writer.setVertexBytes(vertices, 48, 0);
+    writer.setVertexBytes(small, sizeof(small), 1);
+    writer.drawPrimitives(3, 0, 3, 1);
+    writer.endFrame();
+
+    writer.beginFrame(8);
+    writer.setRenderPipelineState(&triangle, "triangle");
+    writer.setVertexBytes(vertices, 48, 0);
+    writer.setVertexBytes(large, sizeof(large), 1);
+    writer.setVertexBytes(large, sizeof(large), command_log_max_buffer_index);
+    writer.drawPrimitives(3, 3, 300000, 1000);
+    writer.endFrame();
+
+    writer.beginFrame(9);
+    writer.setRenderPipelineState(&other, "other");
+    writer.setRenderPipelineState(&triangle, "triangle");
+    writer.setVertexBytes(small, sizeof(small), 1);
+    writer.drawPrimitives(4, 0, 2, 1);
+    writer.endFrame();
+
+    bool written = writer.bytesWritten() > header_size;
+    writer.close();
+
+    std::string first = "bytes 0 " + std::string(vertices, 48);
+    std::string small_bytes = "bytes 1 " + std::string((const char *)small, sizeof(small));
+    std::string large_bytes = "bytes 1 " + std::string((const char *)large, sizeof(large));
+
+    expected = {
+        "begin 7", "pipeline 0 triangle", "state 0", "viewport 640.000000x480.000000", first, small_bytes,
+        "draw 3 0 3 1", "end",
+        "begin 8", "state 0", first, large_bytes, "draw 3 3 300000 1000", "end",
+        "begin 9", "pipeline 1 other", "state 1", "state 0", small_bytes, "draw 4 0 2 1", "end",
+    };
+
+    return written;
+}
+
+void
+testRoundTrip(const MappedFile& file, const std::vector<std::string>& expected, std::vector<size_t>& frame_ends) {
+    CommandLogReader reader(file.data(), file.size());
+    CHECK(reader.valid() && !reader.failed());
+
+    RecordingSink sink;
+    size_t frames = 0;
+
+    while (reader.replayFrame(sink)) {
+        frame_ends.push_back(reader.offset());
+        ++frames;
+    }
+
+    CHECK(frames == 3 && !reader.failed() && reader.offset() == file.size());
+    CHECK(sink.commands == expected);
+
+    // Inline data is read in place at 16-byte file offsets; the repeat in
+    // the second frame points at the first frame's copy.
+    bool in_place = sink.data.size() == 5;
+
+    for (const uint8_t *data : sink.data) {
+        in_place = in_place && data > file.data() && data < file.data() + file.size() &&
+                   (size_t)(data - file.data()) % 16 == 0;
+    }
+
+    CHECK(in_place);
+    CHECK(sink.data.size() == 5 && sink.data[2] == sink.data[0]);
+
+    // Once more from the start.
+    reader.rewind();
+    RecordingSink again;
+
+    while (reader.replayFrame(again)) {
+    }
+
+    CHECK(!reader.failed() && again.commands == expected);
+}
+
+void
+testTruncated(const MappedFile& file, const std::vector<size_t>& frame_ends) {
+    // Every prefix decodes the frames it holds whole; cut anywhere but at
+    // a frame boundary, the next one fails.
+    bool matches = true;
+
+    for (size_t size = header_size; size < file.size(); ++size) {
+        CommandLogReader reader(file.data(), size);
+        RecordingSink sink;
+        size_t frames = 0, whole = 0;
+        bool boundary = size == header_size;
+
+        while (reader.replayFrame(sink)) {
+            ++frames;
+        }
+
+        for (size_t end : frame_ends) {
+            whole += end <= size ? 1 : 0;
+            boundary = boundary || end == size;
+        }
+
+        matches = matches && frames == whole && reader.failed() == !boundary;
+    }
+
+    CHECK(matches);
+
+    // Too short for a header.
+    CommandLogReader empty(file.data(), header_size - 1);
+    RecordingSink sink;
+    CHECK(!empty.valid() && !empty.replayFrame(sink) && empty.failed());
+}
+
+// `body` after the header of `file`.
+bool
+replays(const MappedFile& file, const std::vector<uint8_t>& body, bool& failed) {
+    std::vector<uint8_t> log(file.data(), file.data() + header_size);
+    log.insert(log.end(), body.begin(), body.end());
+
+    CommandLogReader reader(log.data(), log.size());
+    RecordingSink sink;
+    bool replayed = reader.replayFrame(sink);
+    failed = reader.failed();
+    return replayed;
+}
+
+void
+testMalformed(const MappedFile& file) {
+    bool failed = false;
+
+    // A frame that is fine, to show the rest fail for what they hold.
+    CHECK(replays(file, { opcode_begin_frame, 0, opcode_end_frame }, failed) && !failed);
+
+    // Commands outside a frame, unknown opcodes, and a repeat with nothing
+    // to repeat.
+    CHECK(!replays(file, { opcode_end_frame }, failed) && failed);
+    CHECK(!replays(file, { opcode_begin_frame, 0, 0xee, opcode_end_frame }, failed) && failed);
+    CHECK(!replays(file, { opcode_begin_frame, 0, opcode_repeat_vertex_bytes, 0, opcode_end_frame }, failed) && failed);
+
+    // A buffer index past the table, and a varint past 64 bits.
+    CHECK(!replays(file, { opcode_begin_frame, 0, opcode_repeat_vertex_bytes, 31, opcode_end_frame }, failed) &&
+          failed);
+    CHECK(!replays(file, { opcode_begin_frame, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x01,
+                               opcode_end_frame },
+              failed) &&
+          failed);
+
+    // Another magic or version.
+    std::vector<uint8_t> log(file.data(), file.data() + file.size());
+    log[0] = 'X';
+    CHECK(!CommandLogReader(log.data(), log.size()).valid());
+
+    log[0] = file.data()[0];
+    log[8] = 2;
+    CommandLogReader reader(log.data(), log.size());
+    RecordingSink sink;
+    CHECK(!reader.valid() && !reader.replayFrame(sink) && reader.failed() && sink.commands.empty());
+}
+
+}
+
+int
+main() {
+    char path[] = "/tmp/sdl-metal-test-XXXXXX.log";
+    int fd = mkstemps(path, 4);
+    CHECK(fd >= 0);
+
+    if (fd >= 0) {
+        close(fd);
+
+        std::vector<std::string> expected;
+        std::vector<size_t> frame_ends;
+        MappedFile file;
+        CHECK(writeLog(path, expected));
+        CHECK(file.open(path));
+
+        if (file.size() > header_size) {
+            testRoundTrip(file, expected, frame_ends);
+            testTruncated(file, frame_ends);
+            testMalformed(file);
+        }
+
+        file.close();
+        std::remove(path);
+    }
+
+    return checkResult("command_log_test");
+}
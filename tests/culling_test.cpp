@@ -0,0 +1,159 @@
+// CPU visibility culling: frustum planes and kernels, and the occlusion
+// buffer, which must stay conservative where an occluder only partly covers
+// a pixel or slopes away inside it. The occlusion tests use the identity as
+// the view-projection, so positions are clip coordinates with w = 1.
+
+#include "check.h"
+#include "culling.h"
+#include "thread_pool.h"
+
+#include <cmath>
+#include <vector>
+
+namespace {
+
+const float identity[16] = {
+    1.0f, 0.0f, 0.0f, 0.0f,
+    0.0f, 1.0f, 0.0f, 0.0f,
+    0.0f, 0.0f, 1.0f, 0.0f,
+    0.0f, 0.0f, 0.0f, 1.0f,
+};
+
+// Adds one occluder triangle with the given corners.
+void
+addTriangle(OcclusionBuffer& buffer, const float corners[9]) {
+    const uint32_t indices[3] = { 0, 1, 2 };
+    buffer.addOccluders(identity, corners, 3, indices, 3);
+}
+
+// Indices left visible after the occlusion test, from all of `bounds`.
+std::vector<uint32_t>
+unoccluded(const OcclusionBuffer& buffer, const CullBounds& bounds) {
+    std::vector<uint32_t> visible;
+
+    for (uint32_t i = 0; i < bounds.size(); ++i) {
+        visible.push_back(i);
+    }
+
+    buffer.cull(bounds, identity, visible);
+    return visible;
+}
+
+void
+testFrustum() {
+    CullBounds bounds;
+    bounds.add(0.0f, 0.0f, 0.5f, 0.1f, 0.1f, 0.1f);
+    bounds.add(3.0f, 0.0f, 0.5f, 0.1f, 0.1f, 0.1f);
+    bounds.add(1.05f, 0.0f, 0.5f, 0.1f, 0.1f, 0.1f);
+    bounds.add(0.0f, 0.0f, -0.5f, 0.1f, 0.1f, 0.1f);
+    bounds.add(0.0f, 0.0f, 1.05f, 0.1f, 0.1f, 0.1f);
+    bounds.add(0.0f, -1.2f, 0.5f, 0.1f, 0.1f, 0.1f);
+
+    Frustum frustum = frustumFromMatrix(identity);
+
+    // Inside, well outside, straddling the right plane, behind the near
+    // plane, straddling the far plane, below.
+    std::vector<uint32_t> visible;
+    CHECK(cullFrustum(bounds, frustum, CullShapeBox, visible, nullptr, SimdKernelScalar) == 3);
+    CHECK((visible == std::vector<uint32_t> { 0, 2, 4 }));
+
+    // The sphere around the box reaches further than the box.
+    bounds.setSphere(5, 0.0f, -1.2f, 0.5f, 0.25f);
+    CHECK(cullFrustum(bounds, frustum, CullShapeSphere, visible, nullptr, SimdKernelScalar) == 4);
+    CHECK((visible == std::vector<uint32_t> { 0, 2, 4, 5 }));
+
+    // Every kernel, with and without the pool, gives the same list.
+    CullBounds many;
+
+    for (int i = 0; i < 20000; ++i) {
+        many.add(std::sin(i * 0.37f) * 2.0f, std::cos(i * 0.11f) * 2.0f, std::sin(i * 0.05f), 0.05f, 0.05f, 0.05f);
+    }
+
+    ThreadPool pool;
+    std::vector<uint32_t> scalar, simd, pooled;
+    cullFrustum(many, frustum, CullShapeBox, scalar, nullptr, SimdKernelScalar);
+    cullFrustum(many, frustum, CullShapeBox, simd, nullptr, SimdKernelVector);
+    cullFrustum(many, frustum, CullShapeBox, pooled, &pool, SimdKernelVector);
+    CHECK(!scalar.empty() && scalar.size() < many.size());
+    CHECK(simd == scalar && pooled == scalar);
+}
+
+void
+testFullCoverage() {
+    // One triangle well past the screen at depth 0.5.
+    OcclusionBuffer buffer(8, 8);
+    const float wall[9] = { -3.0f, -3.0f, 0.5f, 9.0f, -3.0f, 0.5f, -3.0f, 9.0f, 0.5f };
+    addTriangle(buffer, wall);
+
+    bool flat = true;
+
+    for (size_t i = 0; i < 64; ++i) {
+        flat = flat && buffer.depth()[i] == 0.5f;
+    }
+
+    CHECK(flat);
+
+    // Behind, in front, crossing it, and reaching behind the near plane.
+    CullBounds bounds;
+    bounds.add(0.0f, 0.0f, 0.8f, 0.3f, 0.3f, 0.1f);
+    bounds.add(0.0f, 0.0f, 0.3f, 0.3f, 0.3f, 0.1f);
+    bounds.add(0.5f, 0.5f, 0.5f, 0.1f, 0.1f, 0.1f);
+    bounds.add(0.0f, 0.0f, 0.05f, 0.1f, 0.1f, 0.1f);
+    CHECK((unoccluded(buffer, bounds) == std::vector<uint32_t> { 1, 2, 3 }));
+
+    // After a clear nothing is hidden.
+    buffer.clear();
+    CHECK((unoccluded(buffer, bounds) == std::vector<uint32_t> { 0, 1, 2, 3 }));
+}
+
+void
+testPartialCoverage() {
+    // An occluder whose right edge is at x = 0.15, inside the pixel that
+    // spans 0 to 0.25 and past that pixel's center at 0.125.
+    OcclusionBuffer buffer(8, 8);
+    const float wall[9] = { 0.15f, -20.0f, 0.5f, 0.15f, 20.0f, 0.5f, -20.0f, 0.0f, 0.5f };
+    addTriangle(buffer, wall);
+
+    // The cut pixel takes nothing; the one to its left is covered.
+    CHECK(buffer.depth()[3 * 8 + 4] == 1.0f);
+    CHECK(buffer.depth()[3 * 8 + 3] == 0.5f);
+
+    // A box behind the wall, and one behind the same pixel row but just past
+    // the wall's edge, where it can be seen.
+    CullBounds bounds;
+    bounds.add(-0.4f, 0.1f, 0.8f, 0.05f, 0.05f, 0.05f);
+    bounds.add(0.2f, 0.1f, 0.8f, 0.02f, 0.05f, 0.05f);
+    CHECK((unoccluded(buffer, bounds) == std::vector<uint32_t> { 1 }));
+}
+
+void
+testSlopedCoverage() {
+    // A screen-filling occluder whose depth is 0.5 + 0.1 x. The leftmost of
+    // four columns spans x from -1 to -0.5: depth 0.425 at its center and up
+    // to 0.45 at its right edge.
+    OcclusionBuffer buffer(4, 4);
+    const float wall[9] = { -3.0f, -3.0f, 0.2f, 9.0f, -3.0f, 1.4f, -3.0f, 9.0f, 0.2f };
+    addTriangle(buffer, wall);
+    CHECK(std::fabs(buffer.depth()[0] - 0.45f) < 1e-5f);
+
+    // A thin box at depth 0.436 near x = -0.575, where the occluder is at
+    // about 0.4425 and so behind the box: the box is visible, though it is
+    // farther than the occluder at the pixel's center. A box past the
+    // farthest depth in the same pixel is hidden.
+    CullBounds bounds;
+    bounds.add(-0.575f, 0.5f, 0.436f, 0.025f, 0.1f, 0.001f);
+    bounds.add(-0.75f, 0.5f, 0.47f, 0.1f, 0.1f, 0.01f);
+    CHECK((unoccluded(buffer, bounds) == std::vector<uint32_t> { 0 }));
+}
+
+}
+
+int
+main() {
+    testFrustum();
+    testFullCoverage();
+    testPartialCoverage();
+    testSlopedCoverage();
+
+    return checkResult("culling_test");
+}
@@ -0,0 +1,139 @@
+// LinkResolver and FunctionTableSlots: calls followed through static and
+// dynamic libraries, cycles, search order, missing functions, link sets that
+// differ only in which list a name is on, and table slots shared by name and
+// freed after their last release.
+
+#include "check.h"
+#include "function_linking.h"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+void
+testResolve() {
+    LinkResolver resolver;
+    uint32_t noise = resolver.addLibrary({ "noise", true, { { "noise", {} } } });
+    uint32_t lighting = resolver.addLibrary({ "lighting", true, { { "light", { "noise" } } } });
+    resolver.addLibrary({ "materials", false, {
+        { "flat", { "light" } },
+        { "checker", { "light" } },
+        { "rings", { "light" } },
+        { "blend", { "checker", "rings" } },
+        { "ping", { "pong" } },
+        { "pong", { "ping" } },
+    } });
+    resolver.addLibrary({ "overrides", false, { { "flat", {} } } });
+    CHECK(resolver.libraryCount() == 4);
+
+    // Static functions are linked one by one; reaching into a dynamic
+    // library preloads it, and it in turn what it calls.
+    LinkSet set, same;
+    CHECK(resolver.resolve({ "blend" }, set));
+    CHECK((set.functions == std::vector<std::string> { "blend", "checker", "rings" }));
+    CHECK((set.libraries == std::vector<uint32_t> { noise, lighting }));
+    CHECK(set.missing.empty());
+
+    // Order and repeats of the roots don't matter.
+    CHECK(resolver.resolve({ "rings", "blend", "checker", "blend" }, same));
+    CHECK(same == set && same.hash() == set.hash());
+
+    // The first library to export `flat` wins, and that one lights it.
+    CHECK(resolver.resolve({ "flat" }, set));
+    CHECK((set.functions == std::vector<std::string> { "flat" }) && set.libraries.size() == 2);
+    CHECK(!(same == set) && same.hash() != set.hash());
+
+    // Cycles end.
+    CHECK(resolver.resolve({ "ping" }, set));
+    CHECK((set.functions == std::vector<std::string> { "ping", "pong" }) && set.libraries.empty());
+}
+
+void
+testMissing() {
+    LinkResolver resolver;
+    resolver.addLibrary({ "lighting", true, { { "light", { "shadow" } } } });
+    resolver.addLibrary({ "materials", false, { { "flat", { "light", "bogus" } } } });
+
+    // Reported whether a static or a dynamic function calls them, sorted,
+    // with what was found still filled in.
+    LinkSet set;
+    CHECK(!resolver.resolve({ "flat", "missing" }, set));
+    CHECK((set.missing == std::vector<std::string> { "bogus", "missing", "shadow" }));
+    CHECK((set.functions == std::vector<std::string> { "flat" }));
+    CHECK((set.libraries == std::vector<uint32_t> { 0 }));
+
+    // The next resolution starts over.
+    CHECK(!resolver.resolve({ "light" }, set));
+    CHECK((set.missing == std::vector<std::string> { "shadow" }) && set.functions.empty());
+}
+
+void
+testLinkSetHash() {
+    // A function named like a library index is not that library.
+    LinkSet function_only, library_only, empty;
+    function_only.functions = { "0" };
+    library_only.libraries = { 0 };
+
+    CHECK(!(function_only == library_only));
+    CHECK(function_only.hash() != library_only.hash());
+    CHECK(function_only.hash() != empty.hash() && library_only.hash() != empty.hash());
+
+    // Names are not run together across the boundary either.
+    LinkSet split, joined;
+    split.functions = { "a", "b" };
+    joined.functions = { "a" };
+    joined.libraries = { 0 };
+    CHECK(split.hash() != joined.hash());
+
+    // What is missing doesn't change the pipeline.
+    LinkSet with_missing = function_only;
+    with_missing.missing = { "bogus" };
+    CHECK(with_missing == function_only && with_missing.hash() == function_only.hash());
+}
+
+void
+testSlots() {
+    FunctionTableSlots slots(4);
+    const uint32_t invalid = FunctionTableSlots::invalid_slot;
+    CHECK(slots.capacity() == 4 && slots.size() == 0);
+
+    // Two acquires of one name share its slot.
+    CHECK(slots.acquire("a") == 0);
+    CHECK(slots.acquire("b") == 1);
+    CHECK(slots.acquire("a") == 0);
+    CHECK(slots.references(0) == 2 && slots.size() == 2);
+
+    // The first release keeps it, the last frees it.
+    slots.release(0);
+    CHECK(slots.find("a") == 0 && slots.name(0) == "a" && slots.references(0) == 1);
+    slots.release(0);
+    CHECK(slots.find("a") == invalid && slots.name(0).empty() && slots.references(0) == 0);
+    CHECK(slots.size() == 1);
+
+    // The freed slot is the next one handed out.
+    CHECK(slots.acquire("c") == 0);
+    CHECK(slots.acquire("d") == 2);
+    CHECK(slots.acquire("e") == 3);
+
+    // A full table refuses new names but still shares the ones it holds.
+    CHECK(slots.acquire("f") == invalid);
+    CHECK(slots.acquire("b") == 1 && slots.references(1) == 2);
+    CHECK((slots.names() == std::vector<std::string> { "c", "b", "d", "e" }));
+
+    slots.release(1);
+    slots.release(1);
+    CHECK(slots.find("b") == invalid && slots.acquire("f") == 1);
+}
+
+}
+
+int
+main() {
+    testResolve();
+    testMissing();
+    testLinkSetHash();
+    testSlots();
+
+    return checkResult("function_linking_test");
+}
@@ -0,0 +1,121 @@
+// The shared camera helpers and the torus knot: matrix products in
+// column-major order, a look-at that puts the target straight ahead, a
+// perspective that maps the near and far planes to Metal's 0 and 1 depth,
+// and a closed, outward-wound tube.
+
+#include "check.h"
+#include "geometry.h"
+
+#include <cmath>
+#include <vector>
+
+namespace {
+
+bool
+near(float a, float b, float tolerance = 1e-5f) {
+    return std::fabs(a - b) <= tolerance;
+}
+
+// Column-major m * (x, y, z, 1).
+void
+transformPoint(const float m[16], const float p[3], float out[4]) {
+    for (int r = 0; r < 4; ++r) {
+        out[r] = m[r] * p[0] + m[4 + r] * p[1] + m[8 + r] * p[2] + m[12 + r];
+    }
+}
+
+void
+testMultiply() {
+    // A translation by (1, 2, 3) after a scale by 2: the product scales
+    // first.
+    float translate[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 1, 2, 3, 1 };
+    float scale[16] = { 2, 0, 0, 0, 0, 2, 0, 0, 0, 0, 2, 0, 0, 0, 0, 1 };
+    float product[16], p[4];
+    multiplyMatrices(translate, scale, product);
+
+    const float point[3] = { 1.0f, 1.0f, 1.0f };
+    transformPoint(product, point, p);
+    CHECK(near(p[0], 3.0f) && near(p[1], 4.0f) && near(p[2], 5.0f) && near(p[3], 1.0f));
+}
+
+void
+testCamera() {
+    const float eye[3] = { 3.0f, -4.0f, 2.0f }, target[3] = { 1.0f, 1.0f, 0.5f }, up[3] = { 0.0f, 0.0f, 1.0f };
+    float view[16], p[4];
+    lookAt(eye, target, up, view);
+
+    // The eye at the origin, the target straight down -z at its distance.
+    transformPoint(view, eye, p);
+    CHECK(near(p[0], 0.0f) && near(p[1], 0.0f) && near(p[2], 0.0f));
+
+    float distance = std::sqrt(4.0f + 25.0f + 2.25f);
+    transformPoint(view, target, p);
+    CHECK(near(p[0], 0.0f) && near(p[1], 0.0f) && near(p[2], -distance, 1e-4f));
+
+    // Up stays up on screen.
+    const float above[3] = { eye[0], eye[1], eye[2] + 1.0f };
+    transformPoint(view, above, p);
+    CHECK(p[1] > 0.0f);
+
+    float projection[16];
+    perspective(float(M_PI) / 2.0f, 2.0f, 0.5f, 100.0f, projection);
+
+    const float on_near[3] = { 0.0f, 0.0f, -0.5f }, on_far[3] = { 0.0f, 0.0f, -100.0f };
+    transformPoint(projection, on_near, p);
+    CHECK(near(p[2] / p[3], 0.0f));
+    transformPoint(projection, on_far, p);
+    CHECK(near(p[2] / p[3], 1.0f));
+
+    // A 90 degree field of view reaches x = w at 45 degrees up, and half
+    // that across at an aspect of 2.
+    const float corner[3] = { 2.0f, 1.0f, -1.0f };
+    transformPoint(projection, corner, p);
+    CHECK(near(p[0] / p[3], 1.0f) && near(p[1] / p[3], 1.0f));
+}
+
+void
+testTorusKnot() {
+    const uint32_t segments = 20, sides = 6;
+    std::vector<float> positions = { 9.0f, 9.0f, 9.0f }, normals = { 0.0f, 0.0f, 1.0f };
+    std::vector<uint32_t> indices;
+    torusKnot(segments, sides, positions, normals, indices);
+
+    // Appended after what was there, with indices offset to match.
+    CHECK(positions.size() == 3 + segments * sides * 3 && normals.size() == positions.size());
+    CHECK(indices.size() == segments * sides * 6);
+
+    bool in_range = true, unit_normals = true, outward = true;
+
+    for (uint32_t index : indices) {
+        in_range = in_range && index >= 1 && index <= segments * sides;
+    }
+
+    for (size_t v = 1; v < normals.size() / 3; ++v) {
+        const float *n = &normals[v * 3];
+        unit_normals = unit_normals && near(n[0] * n[0] + n[1] * n[1] + n[2] * n[2], 1.0f, 1e-4f);
+    }
+
+    // Each triangle's normal points the same way as its vertices' normals.
+    for (size_t t = 0; t + 3 <= indices.size(); t += 3) {
+        const float *a = &positions[indices[t] * 3], *b = &positions[indices[t + 1] * 3];
+        const float *c = &positions[indices[t + 2] * 3], *n = &normals[indices[t] * 3];
+        float u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] }, w[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+        float face[3] = { u[1] * w[2] - u[2] * w[1], u[2] * w[0] - u[0] * w[2], u[0] * w[1] - u[1] * w[0] };
+        outward = outward && face[0] * n[0] + face[1] * n[1] + face[2] * n[2] > 0.0f;
+    }
+
+    CHECK(in_range);
+    CHECK(unit_normals);
+    CHECK(outward);
+}
+
+}
+
+int
+main() {
+    testMultiply();
+    testCamera();
+    testTorusKnot();
+
+    return checkResult("geometry_test");
+}
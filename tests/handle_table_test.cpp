@@ -0,0 +1,76 @@
+// SlotAllocator and HandleTable: slot order and reuse, exhaustion, and
+// generation checks on stale handles.
+
+#include "check.h"
+#include "handle_table.h"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+void
+testSlotAllocator() {
+    SlotAllocator slots(3);
+    CHECK(slots.capacity() == 3 && slots.size() == 0);
+
+    // Ascending at first, then last freed first reused.
+    CHECK(slots.allocate() == 0);
+    CHECK(slots.allocate() == 1);
+    CHECK(slots.allocate() == 2);
+    CHECK(slots.allocate() == SlotAllocator::invalid_slot);
+    CHECK(slots.size() == 3);
+
+    slots.free(0);
+    slots.free(2);
+    CHECK(slots.size() == 1);
+    CHECK(slots.allocate() == 2);
+    CHECK(slots.allocate() == 0);
+    CHECK(slots.allocate() == SlotAllocator::invalid_slot);
+
+    SlotAllocator empty(0);
+    CHECK(empty.allocate() == SlotAllocator::invalid_slot);
+}
+
+void
+testHandleTable() {
+    HandleTable<std::string> table(2);
+
+    ResourceHandle a = table.insert("a");
+    ResourceHandle b = table.insert("b");
+    CHECK(a.isValid() && b.isValid() && a != b);
+    CHECK(!table.insert("c").isValid());
+    CHECK(table.size() == 2);
+    CHECK(table.get(a) && *table.get(a) == "a");
+
+    CHECK(table.remove(a));
+    CHECK(!table.contains(a) && table.get(a) == nullptr);
+    CHECK(!table.remove(a));
+
+    // The slot comes back under a new generation; the old handle stays dead,
+    // so removing it again leaves the new entry alone.
+    ResourceHandle c = table.insert("c");
+    CHECK(c.index == a.index && c.generation != a.generation);
+    CHECK(!table.contains(a) && table.contains(c));
+    CHECK(!table.remove(a));
+    CHECK(table.get(c) && *table.get(c) == "c");
+
+    std::vector<std::string> values;
+    table.forEach([&](uint32_t, const std::string& value) {
+        values.push_back(value);
+    });
+    CHECK((values == std::vector<std::string> { "c", "b" }));
+
+    CHECK(!table.contains(ResourceHandle()));
+    CHECK(!table.contains(ResourceHandle { 7, 0 }));
+}
+
+}
+
+int
+main() {
+    testSlotAllocator();
+    testHandleTable();
+
+    return checkResult("handle_table_test");
+}
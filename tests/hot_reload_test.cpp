@@ -0,0 +1,182 @@
+// The hot-reload layer without Metal: Debouncer timing, FrameSwap handoff
+// between threads, and HotReloadService end to end, where a burst of writes
+// to a watched file must come out as one rebuild published at a frame
+// boundary.
+
+#include "check.h"
+#include "debouncer.h"
+#include "file_watcher.h"
+#include "frame_swap.h"
+#include "hot_reload.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using namespace std::chrono_literals;
+
+void
+writeFile(const std::string& path, const std::string& text) {
+    FILE *file = std::fopen(path.c_str(), "w");
+
+    if (file) {
+        std::fputs(text.c_str(), file);
+        std::fclose(file);
+    }
+}
+
+void
+testDebouncer() {
+    Debouncer debouncer(150ms);
+    auto t0 = Debouncer::Clock::now();
+
+    // A burst of touches only counts from the last one.
+    debouncer.touch("a", t0);
+    debouncer.touch("a", t0 + 50ms);
+    debouncer.touch("a", t0 + 100ms);
+    debouncer.touch("b", t0 + 60ms);
+
+    CHECK(debouncer.ready(t0 + 200ms).empty());
+    CHECK(debouncer.ready(t0 + 210ms) == std::vector<std::string> { "b" });
+    CHECK(debouncer.ready(t0 + 240ms).empty());
+    CHECK(debouncer.ready(t0 + 250ms) == std::vector<std::string> { "a" });
+    CHECK(debouncer.empty());
+    CHECK(debouncer.ready(t0 + 1000ms).empty());
+}
+
+void
+testFrameSwap() {
+    FrameSwap<int> swap;
+    int value = 0;
+
+    CHECK(!swap.take(value));
+
+    // Only the latest unread value is handed over, once.
+    swap.publish(1);
+    swap.publish(2);
+    CHECK(swap.take(value) && value == 2);
+    CHECK(!swap.take(value));
+
+    // A producer thread publishing while the loop polls once per "frame":
+    // values arrive in order, and the last one always arrives.
+    const int count = 1000;
+    std::thread producer([&swap] {
+        for (int i = 1; i <= count; ++i) {
+            swap.publish(i);
+        }
+    });
+
+    int last = 0;
+    bool ordered = true;
+    auto deadline = std::chrono::steady_clock::now() + 5s;
+
+    while (last < count && std::chrono::steady_clock::now() < deadline) {
+        if (swap.take(value)) {
+            ordered = ordered && value > last;
+            last = value;
+        }
+    }
+
+    producer.join();
+
+    CHECK(ordered);
+    CHECK(last == count);
+}
+
+void
+testFileWatcher(const std::string& directory) {
+    FileWatcher watcher;
+    CHECK(watcher.watchDirectory(directory));
+    CHECK(!watcher.watchDirectory(directory + "/missing"));
+
+    std::string path = directory + "/watched.metal";
+    writeFile(path, "one");
+
+    std::vector<std::string> changed;
+    auto deadline = std::chrono::steady_clock::now() + 2s;
+
+    while (changed.empty() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(10ms);
+        watcher.poll(changed);
+    }
+
+    CHECK(!changed.empty());
+
+    for (const auto& change : changed) {
+        CHECK(change == path);
+    }
+}
+
+void
+testHotReloadService(const std::string& directory) {
+    FrameSwap<std::string> swap;
+    std::mutex mutex;
+    std::vector<std::string> rebuilt;
+
+    HotReloadService service({ directory }, ".metal", 100ms, [&](const std::string& path) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            rebuilt.push_back(path);
+        }
+
+        swap.publish(path);
+    });
+
+    // Several saves in a row, and a file the service should ignore.
+    std::string path = directory + "/shader.metal";
+
+    for (int i = 0; i < 4; ++i) {
+        writeFile(path, "version " + std::to_string(i));
+        writeFile(directory + "/notes.txt", "not a shader");
+        std::this_thread::sleep_for(20ms);
+    }
+
+    // The render loop, polling once per frame.
+    std::string taken;
+    auto deadline = std::chrono::steady_clock::now() + 3s;
+
+    while (taken.empty() && std::chrono::steady_clock::now() < deadline) {
+        swap.take(taken);
+        std::this_thread::sleep_for(16ms);
+    }
+
+    CHECK(taken == path);
+
+    // Long enough for a second rebuild to have shown up if there were one.
+    std::this_thread::sleep_for(400ms);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    CHECK(rebuilt == std::vector<std::string> { path });
+    CHECK(!swap.take(taken));
+}
+
+}
+
+int
+main() {
+    testDebouncer();
+    testFrameSwap();
+
+    char pattern[] = "/tmp/sdl-metal-test-XXXXXX";
+    const char *directory = mkdtemp(pattern);
+    CHECK(directory != nullptr);
+
+    if (directory) {
+        testFileWatcher(directory);
+        testHotReloadService(directory);
+
+        std::remove((std::string(directory) + "/watched.metal").c_str());
+        std::remove((std::string(directory) + "/shader.metal").c_str());
+        std::remove((std::string(directory) + "/notes.txt").c_str());
+        std::remove(directory);
+    }
+
+    return checkResult("hot_reload_test");
+}
@@ -0,0 +1,170 @@
+// OBJ parsing of face records: fanning, negative indices, and rejection of
+// indices that are out of range or too long to represent. glTF accessors
+// whose counts, offsets or strides are malformed, or would overflow when
+// multiplied out, are rejected before anything is read.
+
+#include "check.h"
+#include "mesh_loader.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+class VectorSink : public MeshSink {
+public:
+
+    LoadedVertex *allocateVertices(size_t count) override {
+        vertices.resize(count);
+        return vertices.data();
+    }
+
+    void *allocateIndices(size_t count, size_t index_size) override {
+        indices.resize(count * index_size);
+        return indices.data();
+    }
+
+    std::vector<LoadedVertex> vertices;
+    std::vector<uint8_t> indices;
+};
+
+bool
+load(const std::string& text, MeshLoadResult& result) {
+    VectorSink sink;
+    return loadObj(text.data(), text.size(), sink, MeshLoadOptions(), result);
+}
+
+const char *const square =
+    "v 0 0 0\n"
+    "v 1 0 0\n"
+    "v 1 1 0\n"
+    "v 0 1 0\n";
+
+void
+testFaces() {
+    MeshLoadResult result;
+
+    // A quad fans into two triangles over four vertices.
+    CHECK(load(std::string(square) + "f 1 2 3 4\n", result));
+    CHECK(result.vertex_count == 4 && result.index_count == 6);
+
+    // The same quad through negative indices and v//vn corners.
+    CHECK(load(std::string(square) + "vn 0 0 1\nf -4//1 -3//1 -2//-1 -1//1\n", result));
+    CHECK(result.vertex_count == 4 && result.index_count == 6);
+}
+
+void
+testBadIndices() {
+    MeshLoadResult result;
+
+    CHECK(!load(std::string(square) + "f 1 2 5\n", result));
+    CHECK(!result.error.empty());
+
+    CHECK(!load(std::string(square) + "f 1 2 0\n", result));
+
+    // Twenty digits would overflow a 64-bit index; they must be rejected
+    // rather than wrap.
+    CHECK(!load(std::string(square) + "f 1 2 99999999999999999999\n", result));
+    CHECK(!load(std::string(square) + "f 1 2 -99999999999999999999\n", result));
+    CHECK(!load(std::string(square) + "f 1//99999999999999999999 2 3\n", result));
+
+    // A long index that does fit is parsed, then found out of range.
+    CHECK(!load(std::string(square) + "f 1 2 999999999999999999\n", result));
+    CHECK(!load(std::string(square) + "f 1 2 -999999999999999999\n", result));
+}
+
+// A GLB holding `json` and a binary chunk of `binary_size` bytes, with one
+// triangle of float positions at its start.
+std::vector<uint8_t>
+glb(const std::string& json, size_t binary_size) {
+    std::string text = json;
+    text.resize((text.size() + 3) & ~size_t(3), ' ');
+    binary_size = (binary_size + 3) & ~size_t(3);
+
+    std::vector<uint8_t> file(12 + 8 + text.size() + 8 + binary_size, 0);
+    uint32_t header[5] = { 0x46546c67, 2, (uint32_t)file.size(), (uint32_t)text.size(), 0x4e4f534a };
+    std::memcpy(file.data(), header, sizeof(header));
+    std::memcpy(file.data() + 20, text.data(), text.size());
+
+    uint32_t binary_header[2] = { (uint32_t)binary_size, 0x004e4942 };
+    uint8_t *binary = file.data() + 20 + text.size();
+    std::memcpy(binary, binary_header, sizeof(binary_header));
+
+    const float triangle[9] = { 0, 0, 0, 1, 0, 0, 0, 1, 0 };
+    std::memcpy(binary + 8, triangle, sizeof(triangle));
+    return file;
+}
+
+// One triangle, in a buffer of `binary_size` bytes, with `attribute` read
+// through `accessor` and `view`. Unless that is the positions, they come
+// from the start of the buffer.
+bool
+loadAccessor(const std::string& accessor, const std::string& view, size_t binary_size, MeshLoadResult& result,
+    const std::string& attribute = "POSITION") {
+    std::string attributes = "\"" + attribute + "\":0";
+
+    if (attribute != "POSITION") {
+        attributes += ",\"POSITION\":1";
+    }
+
+    std::string json = "{\"asset\":{\"version\":\"2.0\"},\"nodes\":[{\"mesh\":0}],"
+                       "\"meshes\":[{\"primitives\":[{\"attributes\":{" + attributes + "}}]}],"
+                       "\"buffers\":[{\"byteLength\":" + std::to_string(binary_size) + "}],"
+                       "\"bufferViews\":[{\"buffer\":0," + view + "},{\"buffer\":0,\"byteLength\":36}],"
+                       "\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"type\":\"VEC3\"," +
+                       accessor + "},"
+                       "{\"bufferView\":1,\"componentType\":5126,\"type\":\"VEC3\",\"count\":3}]}";
+    std::vector<uint8_t> file = glb(json, binary_size);
+    VectorSink sink;
+    return loadGltf(file.data(), file.size(), "", sink, MeshLoadOptions(), result);
+}
+
+void
+testGltfAccessors() {
+    MeshLoadResult result;
+    const std::string view = "\"byteLength\":36";
+
+    CHECK(loadAccessor("\"count\":3", view, 36, result));
+    CHECK(result.vertex_count == 3);
+
+    // Counts that are negative, fractional or too large to be a size.
+    CHECK(!loadAccessor("\"count\":-1", view, 36, result));
+    CHECK(!result.error.empty());
+    CHECK(!loadAccessor("\"count\":2.5", view, 36, result));
+    CHECK(!loadAccessor("\"count\":1e30", view, 36, result));
+    CHECK(!loadAccessor("\"count\":\"3\"", view, 36, result));
+
+    // Offsets, lengths and strides likewise.
+    CHECK(!loadAccessor("\"count\":3,\"byteOffset\":-12", view, 36, result));
+    CHECK(!loadAccessor("\"count\":3", "\"byteLength\":-36", 36, result));
+    CHECK(!loadAccessor("\"count\":3", "\"byteLength\":36,\"byteOffset\":1e300", 36, result));
+    CHECK(!loadAccessor("\"count\":3", "\"byteLength\":36,\"byteStride\":-12", 36, result));
+
+    // One element too many, and a view past its buffer.
+    CHECK(!loadAccessor("\"count\":4", view, 36, result));
+    CHECK(!loadAccessor("\"count\":3", "\"byteLength\":36,\"byteOffset\":4", 36, result));
+
+    CHECK(loadAccessor("\"count\":3", view, 36, result, "NORMAL"));
+
+    // 2^53 normals 2048 bytes apart from offset 2048 end 2^64 + 12 bytes
+    // into the view: wrapped, that would be 12 and pass, and the second
+    // normal of the three read would lie past the view.
+    CHECK(!loadAccessor("\"count\":9007199254740992,\"byteOffset\":2048", "\"byteLength\":4096,\"byteStride\":2048",
+        4096, result, "NORMAL"));
+
+    // A view that ends past the end of memory.
+    CHECK(!loadAccessor("\"count\":3", "\"byteLength\":9007199254740992,\"byteOffset\":9007199254740992", 36,
+        result));
+}
+
+}
+
+int
+main() {
+    testFaces();
+    testBadIndices();
+    testGltfAccessors();
+
+    return checkResult("mesh_loader_test");
+}
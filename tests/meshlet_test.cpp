@@ -0,0 +1,206 @@
+// Meshlet building and culling on a small torus knot in vertex cache order:
+// every triangle lands in exactly one meshlet within the limits, spheres hold
+// their vertices, a meshlet culled by its cone shows the eye no front face, and
+// every kernel gives the same list. A flat patch checks the cone directly.
+
+#include "check.h"
+#include "geometry.h"
+#include "mesh_optimizer.h"
+#include "meshlets.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+struct KnotMeshlets {
+    std::vector<float> positions;
+    std::vector<uint32_t> indices;
+    MeshletMesh mesh;
+    CullBounds spheres;
+    MeshletCones cones;
+};
+
+void
+buildKnot(KnotMeshlets& knot) {
+    std::vector<float> normals;
+    torusKnot(256, 32, knot.positions, normals, knot.indices);
+    optimizeVertexCache(knot.indices.data(), knot.indices.size(), knot.positions.size() / 3);
+
+    buildMeshlets(knot.mesh, knot.indices.data(), knot.indices.size(), knot.positions.data(),
+        knot.positions.size() / 3, sizeof(float) * 3);
+    computeMeshletBounds(knot.mesh, knot.positions.data(), sizeof(float) * 3, knot.spheres, knot.cones);
+}
+
+// Source vertex `local` of meshlet `meshlet` refers to.
+uint32_t
+meshletVertex(const MeshletMesh& mesh, const Meshlet& meshlet, uint32_t local) {
+    return mesh.vertices[meshlet.vertex_offset + std::min(local, meshlet.vertex_count - 1)];
+}
+
+void
+testBuild(const KnotMeshlets& knot) {
+    const MeshletMesh& mesh = knot.mesh;
+    CHECK(!mesh.meshlets.empty());
+    CHECK(knot.spheres.size() == mesh.meshlets.size() && knot.cones.size() == mesh.meshlets.size());
+
+    std::vector<std::array<uint32_t, 3>> input, output;
+    bool limits = true;
+
+    for (size_t t = 0; t + 3 <= knot.indices.size(); t += 3) {
+        input.push_back({ knot.indices[t], knot.indices[t + 1], knot.indices[t + 2] });
+    }
+
+    for (const Meshlet& meshlet : mesh.meshlets) {
+        limits = limits && meshlet.vertex_count > 0 && meshlet.vertex_count <= MESHLET_MAX_VERTICES &&
+                 meshlet.triangle_count > 0 && meshlet.triangle_count <= MESHLET_MAX_TRIANGLES;
+
+        for (uint32_t t = 0; t < meshlet.triangle_count; ++t) {
+            std::array<uint32_t, 3> triangle;
+
+            for (int k = 0; k < 3; ++k) {
+                uint8_t local = mesh.triangles[meshlet.triangle_offset + t * 3 + k];
+                limits = limits && local < meshlet.vertex_count;
+                triangle[k] = meshletVertex(mesh, meshlet, local);
+            }
+
+            output.push_back(triangle);
+        }
+    }
+
+    // The same triangles with the same winding, each once.
+    std::sort(input.begin(), input.end());
+    std::sort(output.begin(), output.end());
+    CHECK(limits);
+    CHECK(input == output);
+
+    // Spheres hold their vertices.
+    size_t outside = 0;
+
+    for (size_t m = 0; m < mesh.meshlets.size(); ++m) {
+        const Meshlet& meshlet = mesh.meshlets[m];
+
+        for (uint32_t v = 0; v < meshlet.vertex_count; ++v) {
+            const float *p = &knot.positions[meshletVertex(mesh, meshlet, v) * 3];
+            float dx = p[0] - knot.spheres.center[0][m], dy = p[1] - knot.spheres.center[1][m];
+            float dz = p[2] - knot.spheres.center[2][m];
+            outside += std::sqrt(dx * dx + dy * dy + dz * dz) > knot.spheres.radius[m] * (1.0f + 1e-5f) ? 1 : 0;
+        }
+    }
+
+    CHECK(outside == 0);
+}
+
+// Perspective from `eye` towards the origin, z up.
+Frustum
+frustumFrom(const float eye[3]) {
+    const float origin[3] = { 0.0f, 0.0f, 0.0f }, up[3] = { 0.0f, 0.0f, 1.0f };
+    float view[16], projection[16], view_projection[16];
+    lookAt(eye, origin, up, view);
+    perspective(50.0f * float(M_PI) / 180.0f, 1.0f, 0.1f, 100.0f, projection);
+    multiplyMatrices(projection, view, view_projection);
+    return frustumFromMatrix(view_projection);
+}
+
+void
+testCull(const KnotMeshlets& knot) {
+    const MeshletMesh& mesh = knot.mesh;
+    ThreadPool pool;
+    size_t cone_culled = 0, front_faces = 0;
+    bool kernels_agree = true;
+
+    for (int view = 0; view < 8; ++view) {
+        float angle = 2.0f * float(M_PI) * view / 8;
+        const float eye[3] = { 4.5f * std::cos(angle), 4.5f * std::sin(angle), 2.0f * std::sin(3.0f * angle) };
+        Frustum frustum = frustumFrom(eye);
+
+        std::vector<uint32_t> scalar, simd, pooled, in_frustum;
+        cullMeshlets(knot.spheres, knot.cones, frustum, eye, scalar, nullptr, SimdKernelScalar);
+        cullMeshlets(knot.spheres, knot.cones, frustum, eye, simd, nullptr, SimdKernelVector);
+        cullMeshlets(knot.spheres, knot.cones, frustum, eye, pooled, &pool, SimdKernelVector);
+        kernels_agree = kernels_agree && simd == scalar && pooled == scalar;
+
+        // Meshlets the frustum keeps but the cone drops must face away: no
+        // triangle of theirs may face the eye.
+        cullFrustum(knot.spheres, frustum, CullShapeSphere, in_frustum);
+        std::vector<uint8_t> kept(mesh.meshlets.size(), 0);
+
+        for (uint32_t m : scalar) {
+            kept[m] = 1;
+        }
+
+        for (uint32_t m : in_frustum) {
+            if (kept[m]) {
+                continue;
+            }
+
+            ++cone_culled;
+            const Meshlet& meshlet = mesh.meshlets[m];
+
+            for (uint32_t t = 0; t < meshlet.triangle_count; ++t) {
+                const float *p[3];
+
+                for (int k = 0; k < 3; ++k) {
+                    p[k] = &knot.positions[meshletVertex(mesh, meshlet, mesh.triangles[meshlet.triangle_offset + t * 3 + k]) * 3];
+                }
+
+                double u[3], w[3];
+
+                for (int c = 0; c < 3; ++c) {
+                    u[c] = (double)p[1][c] - p[0][c];
+                    w[c] = (double)p[2][c] - p[0][c];
+                }
+
+                double n[3] = { u[1] * w[2] - u[2] * w[1], u[2] * w[0] - u[0] * w[2], u[0] * w[1] - u[1] * w[0] };
+                double toward_eye = n[0] * (eye[0] - p[0][0]) + n[1] * (eye[1] - p[0][1]) + n[2] * (eye[2] - p[0][2]);
+                double scale = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                front_faces += toward_eye > 1e-5 * scale ? 1 : 0;
+            }
+        }
+    }
+
+    CHECK(kernels_agree);
+    CHECK(cone_culled > 0);
+    CHECK(front_faces == 0);
+}
+
+void
+testFlatPatch() {
+    // Two triangles in the z = 0 plane, facing +z.
+    const float positions[12] = { -1.0f, -1.0f, 0.0f, 1.0f, -1.0f, 0.0f, 1.0f, 1.0f, 0.0f, -1.0f, 1.0f, 0.0f };
+    const uint32_t indices[6] = { 0, 1, 2, 0, 2, 3 };
+
+    MeshletMesh mesh;
+    CullBounds spheres;
+    MeshletCones cones;
+    buildMeshlets(mesh, indices, 6, positions, 4, sizeof(float) * 3);
+    computeMeshletBounds(mesh, positions, sizeof(float) * 3, spheres, cones);
+    CHECK(mesh.meshlets.size() == 1);
+    CHECK(mesh.meshlets[0].vertex_count == 4 && mesh.meshlets[0].triangle_count == 2);
+    CHECK(std::fabs(cones.axis[2][0]) > 0.99f);
+
+    // Kept from the front, culled from behind, with the frustum on both
+    // sides letting it through.
+    const float front[3] = { 0.0f, 0.5f, 3.0f }, back[3] = { 0.0f, 0.5f, -3.0f };
+    std::vector<uint32_t> visible;
+    CHECK(cullMeshlets(spheres, cones, frustumFrom(front), front, visible) == 1);
+    CHECK(cullFrustum(spheres, frustumFrom(back), CullShapeSphere, visible) == 1);
+    CHECK(cullMeshlets(spheres, cones, frustumFrom(back), back, visible) == 0);
+}
+
+}
+
+int
+main() {
+    KnotMeshlets knot;
+    buildKnot(knot);
+
+    testBuild(knot);
+    testCull(knot);
+    testFlatPatch();
+
+    return checkResult("meshlet_test");
+}
@@ -0,0 +1,199 @@
+// Occlusion query bookkeeping without a GPU: how candidates are split into
+// draws, draw queries and box queries, staggered requeries, results that
+// arrive late and out of order, stale results for objects that left and came
+// back, and a slot pool that runs dry.
+
+#include "check.h"
+#include "occlusion_queries.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+std::vector<uint32_t>
+objectsOf(const std::vector<OcclusionQuery>& queries) {
+    std::vector<uint32_t> objects;
+
+    for (const OcclusionQuery& query : queries) {
+        objects.push_back(query.object);
+    }
+
+    return objects;
+}
+
+// No slot is handed out twice in one frame, and none past the pool.
+bool
+uniqueSlots(const OcclusionQueries& queries, uint32_t slot_count) {
+    std::vector<uint8_t> taken(slot_count, 0);
+
+    for (const auto *list : { &queries.drawQueries(), &queries.boxQueries() }) {
+        for (const OcclusionQuery& query : *list) {
+            if (query.slot >= slot_count || taken[query.slot]) {
+                return false;
+            }
+
+            taken[query.slot] = 1;
+        }
+    }
+
+    return true;
+}
+
+// A result buffer where the objects in `hidden` drew no samples.
+std::vector<uint64_t>
+resultsFor(const OcclusionQueries& queries, uint32_t slot_count, const std::vector<uint32_t>& hidden) {
+    std::vector<uint64_t> results(slot_count, 0);
+
+    for (const auto *list : { &queries.drawQueries(), &queries.boxQueries() }) {
+        for (const OcclusionQuery& query : *list) {
+            bool is_hidden = std::find(hidden.begin(), hidden.end(), query.object) != hidden.end();
+            results[query.slot] = is_hidden ? 0 : 1;
+        }
+    }
+
+    return results;
+}
+
+void
+testLifecycle() {
+    const uint32_t slot_count = 16;
+    OcclusionQueries queries(4, slot_count, 1);
+    const uint32_t candidates[4] = { 0, 1, 2, 3 };
+
+    // New objects count as visible and, queried every frame, are all drawn
+    // in queries.
+    queries.beginFrame(0, candidates, 4);
+    CHECK(queries.draws().empty() && queries.boxQueries().empty());
+    CHECK((objectsOf(queries.drawQueries()) == std::vector<uint32_t> { 0, 1, 2, 3 }));
+    CHECK(uniqueSlots(queries, slot_count));
+    CHECK(queries.slotsInUse() == 4 && queries.pendingFrames() == 1 && queries.isPending(0));
+    std::vector<uint64_t> frame0 = resultsFor(queries, slot_count, { 1 });
+
+    // While the results are out, the objects go by their last result.
+    queries.beginFrame(1, candidates, 4);
+    CHECK((queries.draws() == std::vector<uint32_t> { 0, 1, 2, 3 }));
+    CHECK(queries.drawQueries().empty() && queries.boxQueries().empty());
+    CHECK(!queries.isPending(1));
+
+    queries.resolve(0, frame0.data());
+    CHECK(!queries.isPending(0) && queries.pendingFrames() == 0 && queries.slotsInUse() == 0);
+    CHECK(queries.isVisible(0) && !queries.isVisible(1) && queries.isVisible(2));
+
+    // The hidden object is not drawn; its box is, to see if it comes back.
+    queries.beginFrame(2, candidates, 4);
+    CHECK(queries.draws().empty());
+    CHECK((objectsOf(queries.drawQueries()) == std::vector<uint32_t> { 0, 2, 3 }));
+    CHECK((objectsOf(queries.boxQueries()) == std::vector<uint32_t> { 1 }));
+    CHECK(uniqueSlots(queries, slot_count));
+    std::vector<uint64_t> frame2 = resultsFor(queries, slot_count, {});
+
+    // Still hidden while its box query is out: neither drawn nor queried.
+    queries.beginFrame(3, candidates, 4);
+    CHECK((queries.draws() == std::vector<uint32_t> { 0, 2, 3 }));
+    CHECK(queries.boxQueries().empty());
+
+    queries.resolve(2, frame2.data());
+    CHECK(queries.isVisible(1) && queries.slotsInUse() == 0);
+
+    // Resolving a frame that issued nothing, or twice, changes nothing.
+    queries.resolve(3, frame2.data());
+    queries.resolve(2, frame2.data());
+    CHECK(queries.isVisible(1) && queries.pendingFrames() == 0);
+}
+
+void
+testStaggeredRequery() {
+    // Visible objects are queried every fourth frame, staggered by object.
+    OcclusionQueries queries(8, 64, 4);
+    const uint32_t candidates[8] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+
+    queries.beginFrame(0, candidates, 8);
+    CHECK((objectsOf(queries.drawQueries()) == std::vector<uint32_t> { 0, 4 }));
+    CHECK((queries.draws() == std::vector<uint32_t> { 1, 2, 3, 5, 6, 7 }));
+
+    queries.beginFrame(1, candidates, 8);
+    CHECK((objectsOf(queries.drawQueries()) == std::vector<uint32_t> { 3, 7 }));
+    CHECK(queries.draws().size() == 6);
+}
+
+void
+testOutOfOrder() {
+    const uint32_t slot_count = 8;
+    OcclusionQueries queries(2, slot_count, 1);
+    const uint32_t first[1] = { 0 }, second[1] = { 1 };
+
+    queries.beginFrame(0, first, 1);
+    std::vector<uint64_t> frame0 = resultsFor(queries, slot_count, { 0 });
+    queries.beginFrame(1, second, 1);
+    std::vector<uint64_t> frame1 = resultsFor(queries, slot_count, {});
+    CHECK(queries.pendingFrames() == 2 && queries.slotsInUse() == 2);
+
+    // The later frame lands first; each result goes to its own object.
+    queries.resolve(1, frame1.data());
+    CHECK(queries.isPending(0) && !queries.isPending(1) && queries.slotsInUse() == 1);
+    CHECK(queries.isVisible(1));
+
+    queries.resolve(0, frame0.data());
+    CHECK(!queries.isVisible(0) && queries.slotsInUse() == 0 && queries.pendingFrames() == 0);
+}
+
+void
+testStaleResult() {
+    const uint32_t slot_count = 8;
+    OcclusionQueries queries(1, slot_count, 1);
+    const uint32_t candidates[1] = { 0 };
+
+    // Queried in frame 0, out of the candidates in frame 1, back in frame 2.
+    queries.beginFrame(0, candidates, 1);
+    std::vector<uint64_t> frame0 = resultsFor(queries, slot_count, { 0 });
+    queries.beginFrame(1, nullptr, 0);
+    queries.beginFrame(2, candidates, 1);
+    CHECK((queries.draws() == std::vector<uint32_t> { 0 }));
+
+    // Whatever hid it may have moved since: the old result is dropped, but
+    // its slot still comes back.
+    queries.resolve(0, frame0.data());
+    CHECK(queries.isVisible(0) && queries.slotsInUse() == 0);
+}
+
+void
+testSlotsRunOut() {
+    const uint32_t slot_count = 2;
+    OcclusionQueries queries(4, slot_count, 1);
+    const uint32_t candidates[4] = { 0, 1, 2, 3 };
+
+    // Two queries fit; the rest are drawn without one.
+    queries.beginFrame(0, candidates, 4);
+    CHECK((objectsOf(queries.drawQueries()) == std::vector<uint32_t> { 0, 1 }));
+    CHECK((queries.draws() == std::vector<uint32_t> { 2, 3 }));
+    CHECK(uniqueSlots(queries, slot_count) && queries.slotsInUse() == 2);
+    std::vector<uint64_t> frame0 = resultsFor(queries, slot_count, { 0, 1 });
+
+    // With the pool dry, nothing new is queried.
+    queries.beginFrame(1, candidates, 4);
+    CHECK(queries.drawQueries().empty() && queries.boxQueries().empty());
+    CHECK(queries.draws().size() == 4);
+
+    // Once the slots return, the hidden objects are drawn as boxes and the
+    // others take what is left.
+    queries.resolve(0, frame0.data());
+    queries.beginFrame(2, candidates, 4);
+    CHECK((objectsOf(queries.boxQueries()) == std::vector<uint32_t> { 0, 1 }));
+    CHECK(queries.drawQueries().empty());
+    CHECK((queries.draws() == std::vector<uint32_t> { 2, 3 }));
+    CHECK(uniqueSlots(queries, slot_count));
+}
+
+}
+
+int
+main() {
+    testLifecycle();
+    testStaggeredRequery();
+    testOutOfOrder();
+    testStaleResult();
+    testSlotsRunOut();
+
+    return checkResult("occlusion_queries_test");
+}
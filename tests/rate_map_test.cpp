@@ -0,0 +1,164 @@
+// Rate map construction: importance to quantized separable rates, the
+// physical target size a layer needs, the importance sources and the preview.
+
+#include "check.h"
+#include "rate_map.h"
+
+#include <cmath>
+#include <vector>
+
+namespace {
+
+bool
+near(float a, float b) {
+    return std::fabs(a - b) < 1e-5f;
+}
+
+bool
+near(const std::vector<float>& a, const std::vector<float>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (!near(a[i], b[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+ImportanceGrid
+grid(uint32_t width, uint32_t height, std::vector<float> values) {
+    ImportanceGrid result;
+    result.width = width;
+    result.height = height;
+    result.values = std::move(values);
+    return result;
+}
+
+void
+testQuantization() {
+    // Four levels over [0.25, 1]: importance rounds up to the next level, so
+    // no tile gets less than it asked for. Out-of-range values clamp.
+    RateMapLayer layer = buildRateMapLayer(grid(6, 1, { 0.0f, 0.1f, 0.5f, 1.0f, -1.0f, 2.0f }));
+    CHECK(near(layer.horizontal, { 0.25f, 0.5f, 0.75f, 1.0f, 0.25f, 1.0f }));
+    CHECK(near(layer.vertical, { 1.0f }));
+
+    // Exactly on a level stays there.
+    layer = buildRateMapLayer(grid(2, 1, { 1.0f / 3.0f, 2.0f / 3.0f }));
+    CHECK(near(layer.horizontal, { 0.5f, 0.75f }));
+
+    // One level means no quantization at all.
+    RateMapOptions continuous;
+    continuous.min_rate = 0.5f;
+    continuous.levels = 1;
+    layer = buildRateMapLayer(grid(3, 1, { 0.0f, 0.3f, 1.0f }), continuous);
+    CHECK(near(layer.horizontal, { 0.5f, 0.65f, 1.0f }));
+
+    // Two levels: anything above zero is full rate.
+    RateMapOptions binary;
+    binary.levels = 2;
+    layer = buildRateMapLayer(grid(3, 1, { 0.0f, 0.01f, 1.0f }), binary);
+    CHECK(near(layer.horizontal, { 0.25f, 1.0f, 1.0f }));
+}
+
+void
+testSeparableMaximum() {
+    // Each column and row takes its most important tile.
+    RateMapLayer layer = buildRateMapLayer(grid(3, 2, {
+        0.0f, 1.0f, 0.0f,
+        0.0f, 0.0f, 0.4f,
+    }));
+
+    CHECK(near(layer.horizontal, { 0.25f, 1.0f, 0.75f }));
+    CHECK(near(layer.vertical, { 1.0f, 0.75f }));
+}
+
+void
+testPhysicalSize() {
+    uint32_t width = 0, height = 0;
+
+    RateMapLayer layer;
+    layer.horizontal = { 1.0f, 0.5f };
+    layer.vertical = { 0.25f, 0.25f, 1.0f, 1.0f };
+    rateMapPhysicalSize(layer, 100, 80, &width, &height);
+    CHECK(width == 75 && height == 50);
+
+    // Rounded up, so the target is never too small.
+    layer.horizontal = { 0.3f };
+    layer.vertical = { 1.0f };
+    rateMapPhysicalSize(layer, 101, 7, &width, &height);
+    CHECK(width == 31 && height == 7);
+
+    // Full rate, or no rates at all, is the screen size.
+    rateMapPhysicalSize(buildRateMapLayer(grid(2, 2, { 1.0f, 1.0f, 1.0f, 1.0f })), 640, 480, &width, &height);
+    CHECK(width == 640 && height == 480);
+
+    rateMapPhysicalSize(RateMapLayer(), 640, 480, &width, &height);
+    CHECK(width == 640 && height == 480);
+}
+
+void
+testImportance() {
+    // A flat tile next to a black and white checker, and a partial third tile
+    // with a single gradient step.
+    const uint32_t width = 5, height = 2;
+    std::vector<uint8_t> rgba(width * height * 4, 255);
+    const uint8_t luma[height][width] = {
+        { 128, 128, 0, 255, 0 },
+        { 128, 128, 255, 0, 255 },
+    };
+
+    for (uint32_t y = 0; y < height; ++y) {
+        for (uint32_t x = 0; x < width; ++x) {
+            for (int c = 0; c < 3; ++c) {
+                rgba[(y * width + x) * 4 + c] = luma[y][x];
+            }
+        }
+    }
+
+    ImportanceGrid importance = luminanceVarianceImportance(rgba.data(), width, height, width * 4, 2);
+    CHECK(importance.width == 3 && importance.height == 1);
+    CHECK(near(importance.at(0, 0), 0.0f));
+    CHECK(near(importance.at(1, 0), 1.0f));
+    CHECK(near(importance.at(2, 0), 1.0f));
+
+    // A uniform image has no busiest tile and stays all zero.
+    std::vector<uint8_t> flat(16 * 16 * 4, 90);
+    importance = luminanceVarianceImportance(flat.data(), 16, 16, 16 * 4, 4);
+    CHECK(importance.width == 4 && importance.height == 4);
+    CHECK(near(importance.values, std::vector<float>(16, 0.0f)));
+
+    // Foveation peaks at the center tile and is gone at the radius.
+    importance = foveatedImportance(5, 5, 2.5f, 2.5f, 2.0f);
+    CHECK(near(importance.at(2, 2), 1.0f));
+    CHECK(near(importance.at(2, 0), 0.0f) && near(importance.at(0, 2), 0.0f));
+    CHECK(near(importance.at(3, 2), 0.5f));
+}
+
+void
+testPreview() {
+    RateMapLayer layer;
+    layer.horizontal = { 1.0f, 0.5f };
+    layer.vertical = { 1.0f, 0.25f };
+
+    std::vector<uint8_t> preview = previewRateMap(layer, 4, 2);
+    CHECK((preview == std::vector<uint8_t> { 255, 255, 128, 128, 64, 64, 32, 32 }));
+
+    CHECK(previewRateMap(RateMapLayer(), 3, 1) == std::vector<uint8_t>(3, 255));
+}
+
+}
+
+int
+main() {
+    testQuantization();
+    testSeparableMaximum();
+    testPhysicalSize();
+    testImportance();
+    testPreview();
+
+    return checkResult("rate_map_test");
+}
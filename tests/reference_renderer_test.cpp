@@ -0,0 +1,189 @@
+// The reference rasterizer against images worked out by hand, on an 8x8
+// target at 1x and 4x: which pixels a quad and a triangle cover under the
+// top-left rule, what the 4x resolve makes of edges crossing a pixel at
+// Metal's standard sample positions, and colors interpolated at the pixel
+// center.
+
+#include "check.h"
+#include "reference_renderer.h"
+
+#include <cmath>
+#include <vector>
+
+namespace {
+
+const uint32_t size = 8;
+const uint32_t black = 0xff000000u, white = 0xffffffffu;
+
+// MTL::PrimitiveTypeTriangle.
+const uint32_t primitive_type_triangle = 3;
+
+// A vertex at window position (x, y), y down, for an 8x8 viewport: the
+// vertex shader takes pixels from the center, y up.
+ReferenceVertex
+vertex(float x, float y, float gray = 1.0f) {
+    return { { x - size / 2.0f, size / 2.0f - y }, { 0.0f, 0.0f }, { gray, gray, gray, 1.0f } };
+}
+
+// The quad [x0, x1] x [y0, y1] as two triangles sharing a diagonal.
+void
+addQuad(std::vector<ReferenceVertex>& vertices, float x0, float y0, float x1, float y1) {
+    vertices.insert(vertices.end(), { vertex(x0, y0), vertex(x1, y0), vertex(x1, y1) });
+    vertices.insert(vertices.end(), { vertex(x0, y0), vertex(x1, y1), vertex(x0, y1) });
+}
+
+// One frame drawing `vertices` with the triangle pipeline.
+void
+render(ReferenceRenderer& renderer, const std::vector<ReferenceVertex>& vertices) {
+    const uint32_t viewport_size[2] = { size, size };
+
+    renderer.beginFrame(0);
+    renderer.definePipeline(0, "triangle");
+    renderer.setRenderPipelineState(0);
+    renderer.setVertexBytes(vertices.data(), vertices.size() * sizeof(ReferenceVertex), 0);
+    renderer.setVertexBytes(viewport_size, sizeof(viewport_size), 1);
+    renderer.drawPrimitives(primitive_type_triangle, 0, vertices.size(), 1);
+    renderer.endFrame();
+}
+
+uint32_t
+pixel(const ReferenceRenderer& renderer, uint32_t x, uint32_t y) {
+    return renderer.pixels()[y * size + x];
+}
+
+// Opaque gray with every color channel `level`.
+uint32_t
+gray(uint32_t level) {
+    return 0xff000000u | level << 16 | level << 8 | level;
+}
+
+void
+testQuad() {
+    // Pixels [2, 6) both ways. At 1x the diagonal runs through the centers
+    // of four of them, each owned by one triangle; at 4x it splits their
+    // samples, so both triangles shade them, but every sample is written
+    // once.
+    std::vector<ReferenceVertex> vertices;
+    addQuad(vertices, 2.0f, 2.0f, 6.0f, 6.0f);
+
+    for (uint32_t sample_count : { 1u, 4u }) {
+        ReferenceRenderer renderer(size, size, ReferenceShadingForward, sample_count);
+        render(renderer, vertices);
+        CHECK(renderer.sampleCount() == sample_count);
+        CHECK(renderer.trianglesDrawn() == 2 && renderer.drawsSkipped() == 0);
+        CHECK(renderer.fragmentsRasterized() == (sample_count == 1 ? 16 : 20));
+        CHECK(renderer.samplesCovered() == 16 * sample_count);
+
+        bool matches = true;
+
+        for (uint32_t y = 0; y < size; ++y) {
+            for (uint32_t x = 0; x < size; ++x) {
+                bool inside = x >= 2 && x < 6 && y >= 2 && y < 6;
+                matches = matches && pixel(renderer, x, y) == (inside ? white : black);
+            }
+        }
+
+        CHECK(matches);
+    }
+}
+
+void
+testPartialCoverage() {
+    // Edges through pixels rather than between them: the left edge at
+    // x = 2.6 takes the two samples right of x + 0.6 in column 2, the top
+    // edge at y = 2.25 the three samples below y + 0.25 in row 2, and the
+    // corner pixel the two samples that are both.
+    std::vector<ReferenceVertex> vertices;
+    addQuad(vertices, 2.6f, 2.25f, 6.0f, 6.0f);
+
+    ReferenceRenderer single(size, size);
+    render(single, vertices);
+
+    // Sampled at the center, the left column is out and the top row in.
+    CHECK(pixel(single, 2, 4) == black && pixel(single, 3, 2) == white && pixel(single, 2, 2) == black);
+    CHECK(single.fragmentsRasterized() == 12);
+
+    ReferenceRenderer multisample(size, size, ReferenceShadingForward, 4);
+    render(multisample, vertices);
+
+    // Two of four samples white resolve to (2 * 255 + 2) / 4 = 128, three
+    // to 191.
+    CHECK(pixel(multisample, 2, 4) == gray(128));
+    CHECK(pixel(multisample, 3, 2) == gray(191));
+    CHECK(pixel(multisample, 2, 2) == gray(128));
+    CHECK(pixel(multisample, 4, 4) == white && pixel(multisample, 1, 4) == black);
+    CHECK(multisample.samplesCovered() == 9 * 4 + 3 * 2 + 3 * 3 + 2);
+}
+
+void
+testTriangle() {
+    // The corner triangle x + y < 4: pixels with x + y <= 2 hold their
+    // centers, and the hypotenuse through the centers of x + y = 3 is a
+    // bottom-right edge that owns none of them. At 4x those take samples 0
+    // and 2, whose offsets sum below 1.
+    std::vector<ReferenceVertex> vertices = { vertex(0.0f, 0.0f), vertex(4.0f, 0.0f), vertex(0.0f, 4.0f) };
+
+    ReferenceRenderer single(size, size);
+    ReferenceRenderer multisample(size, size, ReferenceShadingForward, 4);
+    render(single, vertices);
+    render(multisample, vertices);
+
+    bool single_matches = true, multisample_matches = true;
+
+    for (uint32_t y = 0; y < size; ++y) {
+        for (uint32_t x = 0; x < size; ++x) {
+            uint32_t diagonal = x + y;
+            single_matches = single_matches && pixel(single, x, y) == (diagonal <= 2 ? white : black);
+            multisample_matches = multisample_matches &&
+                                  pixel(multisample, x, y) == (diagonal <= 2 ? white : diagonal == 3 ? gray(128) : black);
+        }
+    }
+
+    CHECK(single_matches && single.fragmentsRasterized() == 6);
+    CHECK(multisample_matches && multisample.fragmentsRasterized() == 10);
+
+    // Wound the other way, the same pixels.
+    std::vector<ReferenceVertex> reversed = { vertices[0], vertices[2], vertices[1] };
+    ReferenceRenderer flipped(size, size);
+    render(flipped, reversed);
+    CHECK(flipped.pixels() == single.pixels());
+}
+
+void
+testInterpolation() {
+    // Black on the left edge of the target to white on the right: each
+    // column gets its center's share, at 4x too, since the shader runs at
+    // the center of a fully covered pixel.
+    std::vector<ReferenceVertex> vertices = {
+        vertex(0.0f, 0.0f, 0.0f), vertex(8.0f, 0.0f, 1.0f), vertex(8.0f, 8.0f, 1.0f),
+        vertex(0.0f, 0.0f, 0.0f), vertex(8.0f, 8.0f, 1.0f), vertex(0.0f, 8.0f, 0.0f),
+    };
+
+    for (uint32_t sample_count : { 1u, 4u }) {
+        ReferenceRenderer renderer(size, size, ReferenceShadingForward, sample_count);
+        render(renderer, vertices);
+
+        bool matches = true;
+
+        for (uint32_t y = 0; y < size; ++y) {
+            for (uint32_t x = 0; x < size; ++x) {
+                uint32_t expected = gray((uint32_t)std::lround((x + 0.5f) / size * 255.0f));
+                matches = matches && pixel(renderer, x, y) == expected;
+            }
+        }
+
+        CHECK(matches);
+    }
+}
+
+}
+
+int
+main() {
+    testQuad();
+    testPartialCoverage();
+    testTriangle();
+    testInterpolation();
+
+    return checkResult("reference_renderer_test");
+}
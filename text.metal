@@ -0,0 +1,46 @@
+/*
+Shaders for text drawn from a signed distance field glyph atlas
+*/
+
+#include <metal_stdlib>
+
+using namespace metal;
+
+#include "core/sprite_types.h"
+
+struct TextRasterizerData
+{
+    float4 position [[position]];
+    float2 texCoord;
+    float4 color;
+};
+
+vertex TextRasterizerData
+textVertex(uint vertexID [[vertex_id]],
+           constant SpriteVertex *vertices [[buffer(SpriteInputIndexVertices)]],
+           constant vector_uint2 *viewportSizePointer [[buffer(SpriteInputIndexViewportSize)]])
+{
+    TextRasterizerData out;
+
+    constant SpriteVertex &in = vertices[vertexID];
+    float2 viewportSize = float2(*viewportSizePointer);
+
+    out.position = float4(float2(in.positionX, in.positionY) / (viewportSize / 2.0), 0.0, 1.0);
+    out.texCoord = float2(in.u, in.v);
+    out.color = unpack_unorm4x8_to_float(in.color);
+
+    return out;
+}
+
+fragment float4
+textFragment(TextRasterizerData in [[stage_in]],
+             texture2d<float> atlas [[texture(SpriteInputIndexTexture)]],
+             sampler s [[sampler(SpriteInputIndexSampler)]])
+{
+    // 0.5 is the outline; antialias over about one screen pixel at any scale.
+    float distance = atlas.sample(s, in.texCoord).r;
+    float width = max(fwidth(distance) * 0.75, 1.0e-4);
+    float coverage = smoothstep(0.5 - width, 0.5 + width, distance);
+
+    return float4(in.color.rgb, in.color.a * coverage);
+}
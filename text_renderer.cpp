@@ -0,0 +1,109 @@
+#include "text_renderer.h"
+#include "interned_string.h"
+#include "thread_pool.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+#include "text_metallib.h"
+
+}
+
+TextRenderer::TextRenderer(MTL::Device *device, SamplerCache *samplers, MTL::PixelFormat pixel_format,
+    MTL::PixelFormat depth_pixel_format, uint32_t frames_in_flight)
+    : d_font(builtinFont())
+    , d_sampler(samplers->get(SamplerKey::filtered(MTL::SamplerMinMagFilterLinear, MTL::SamplerMipFilterNotMipmapped,
+        MTL::SamplerAddressModeClampToEdge))) {
+    NS::Error *err;
+
+    auto library_data = dispatch_data_create(
+        &text_metallib[0], text_metallib_len,
+        dispatch_get_main_queue(),
+        ^{ });
+
+    auto library = MTL::make_owned(device->newLibrary(library_data, &err));
+
+    if (!library) {
+        std::cerr << "Failed to create text library" << std::endl;
+        std::exit(-1);
+    }
+
+    auto vertex_function = MTL::make_owned(library->newFunction(NS_STATIC_STRING("textVertex")));
+    auto fragment_function = MTL::make_owned(library->newFunction(NS_STATIC_STRING("textFragment")));
+
+    auto pipeline_descriptor = MTL::make_owned(MTL::RenderPipelineDescriptor::alloc()->init());
+    pipeline_descriptor->setVertexFunction(vertex_function.get());
+    pipeline_descriptor->setFragmentFunction(fragment_function.get());
+    pipeline_descriptor->setDepthAttachmentPixelFormat(depth_pixel_format);
+
+    auto color_attachment_descriptor = pipeline_descriptor->colorAttachments()->object(0);
+    color_attachment_descriptor->setPixelFormat(pixel_format);
+    color_attachment_descriptor->setBlendingEnabled(true);
+    color_attachment_descriptor->setSourceRGBBlendFactor(MTL::BlendFactorSourceAlpha);
+    color_attachment_descriptor->setDestinationRGBBlendFactor(MTL::BlendFactorOneMinusSourceAlpha);
+
+    d_pipeline = MTL::make_owned(device->newRenderPipelineState(pipeline_descriptor.get(), &err));
+
+    if (!d_pipeline) {
+        std::cerr << "Failed to create text pipeline" << std::endl;
+        std::exit(-1);
+    }
+
+    // Built at startup rather than shipped; the pool only lives this long.
+    {
+        ThreadPool pool;
+        auto start = std::chrono::steady_clock::now();
+        d_atlas = buildGlyphAtlas(d_font, GlyphAtlasOptions(), &pool);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cerr << "text: " << d_atlas.glyphs.size() << " glyphs in " << seconds * 1e3 << " ms on "
+                  << pool.threadCount() << " threads" << std::endl;
+    }
+
+    auto texture_descriptor = MTL::make_owned(MTL::TextureDescriptor::texture2DDescriptor(
+        MTL::PixelFormatR8Unorm, d_atlas.page_width, d_atlas.page_height, false));
+
+    for (const auto& pixels : d_atlas.pages) {
+        auto page = MTL::make_owned(device->newTexture(texture_descriptor.get()));
+        page->replaceRegion(MTL::Region(0, 0, d_atlas.page_width, d_atlas.page_height), 0, pixels.data(), d_atlas.page_width);
+        d_pages.push_back(page);
+    }
+
+    for (uint32_t i = 0; i < frames_in_flight; ++i) {
+        d_vertex_buffers.push_back(MTL::make_owned(device->newBuffer(
+            sizeof(SpriteVertex) * 6 * max_glyphs, MTL::ResourceStorageModeShared)));
+    }
+}
+
+void
+TextRenderer::add(const char *text, float x, float y, const TextStyle& style, uint32_t color) {
+    layoutText(d_font, text, std::strlen(text), style, d_layout);
+    addTextSprites(d_layout, d_atlas, style.size, x, y, color, d_batch);
+}
+
+void
+TextRenderer::draw(MTL::RenderCommandEncoder *encoder, vector_uint2 viewport) {
+    if (d_batch.size() == 0) {
+        return;
+    }
+
+    MTL::Buffer *vertex_buffer = d_vertex_buffers[d_frame].get();
+    d_frame = (d_frame + 1) % d_vertex_buffers.size();
+
+    d_batch.build((SpriteVertex *)vertex_buffer->contents(), max_glyphs);
+
+    encoder->setRenderPipelineState(d_pipeline.get());
+    encoder->setVertexBuffer(vertex_buffer, 0, SpriteInputIndexVertices);
+    encoder->setVertexBytes(&viewport, sizeof(viewport), SpriteInputIndexViewportSize);
+    encoder->setFragmentSamplerState(d_sampler.get(), SpriteInputIndexSampler);
+
+    for (const auto& draw : d_batch.draws()) {
+        encoder->setFragmentTexture(d_pages[draw.texture].get(), SpriteInputIndexTexture);
+        encoder->drawPrimitives(MTL::PrimitiveTypeTriangle, NS::UInteger(draw.vertex_start), NS::UInteger(draw.vertex_count));
+    }
+
+    d_batch.clear();
+}
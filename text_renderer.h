@@ -0,0 +1,57 @@
+#pragma once
+
+#include "font.h"
+#include "glyph_atlas.h"
+#include "render_states.h"
+#include "sprite_batch.h"
+#include "text_layout.h"
+
+#include <Metal/Metal.hpp>
+#include <Metal/shared_ptr.hpp>
+
+#include <simd/simd.h>
+#include <vector>
+
+// Text overlays from an SDF atlas of the built-in font, built when the
+// renderer is created. Strings queued during a frame are laid out into one
+// `SpriteBatch` and drawn in a draw per atlas page, from a ring of
+// persistently mapped vertex buffers like `SpriteRenderer`'s.
+class TextRenderer {
+public:
+
+    // The atlas is sampled through the linear, clamped sampler in `samplers`.
+    TextRenderer(MTL::Device *device, SamplerCache *samplers, MTL::PixelFormat pixel_format,
+        MTL::PixelFormat depth_pixel_format, uint32_t frames_in_flight = 3);
+
+    // Queues `text` with its first baseline starting at (x, y), in the same
+    // centered, y-up pixel space as the other overlays. Beyond `max_glyphs`
+    // in a frame, the last glyphs in draw order are dropped.
+    void add(const char *text, float x, float y, const TextStyle& style, uint32_t color = 0xffffffffu);
+
+    // Draws and clears everything queued since the last call.
+    void draw(MTL::RenderCommandEncoder *encoder, vector_uint2 viewport);
+
+    float lineHeight(const TextStyle& style) const {
+        return d_font.lineHeight() * style.size / d_font.units_per_em * style.line_spacing;
+    }
+
+    float ascent(const TextStyle& style) const {
+        return d_font.ascent * style.size / d_font.units_per_em;
+    }
+
+    static constexpr uint32_t max_glyphs = 16384;
+
+private:
+
+    const Font& d_font;
+    GlyphAtlas d_atlas;
+
+    MTL::shared_ptr<MTL::RenderPipelineState> d_pipeline;
+    MTL::shared_ptr<MTL::SamplerState> d_sampler;
+    std::vector<MTL::shared_ptr<MTL::Texture>> d_pages;
+    std::vector<MTL::shared_ptr<MTL::Buffer>> d_vertex_buffers;
+    uint32_t d_frame = 0;
+
+    TextLayout d_layout;
+    SpriteBatch d_batch;
+};
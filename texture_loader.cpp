@@ -0,0 +1,92 @@
+#include "texture_loader.h"
+#include "texture_upload.h"
+
+#include <vector>
+
+TextureFormat
+nativeTextureFormat(MTL::Device *device) {
+    if (deviceSupportsFormat(device, TextureFormatASTC4x4)) {
+        return TextureFormatASTC4x4;
+    }
+
+    return deviceSupportsFormat(device, TextureFormatBC7) ? TextureFormatBC7 : TextureFormatRGBA8;
+}
+
+bool
+deviceSupportsFormat(MTL::Device *device, TextureFormat format) {
+    switch (format) {
+    case TextureFormatRGBA8:
+        return true;
+    case TextureFormatASTC4x4:
+        return device->supportsFamily(MTL::GPUFamilyApple2);
+    case TextureFormatBC7:
+        return device->supportsBCTextureCompression();
+    default:
+        return false;
+    }
+}
+
+MTL::PixelFormat
+texturePixelFormat(TextureFormat format) {
+    switch (format) {
+    case TextureFormatBC7:
+        return MTL::PixelFormatBC7_RGBAUnorm;
+    case TextureFormatASTC4x4:
+        return MTL::PixelFormatASTC_4x4_LDR;
+    default:
+        return MTL::PixelFormatRGBA8Unorm;
+    }
+}
+
+MTL::shared_ptr<MTL::Texture>
+loadTexture(MTL::Device *device, const TextureFileView& file, ThreadPool *pool, TextureUploader *uploader) {
+    TextureFormat format = file.format;
+
+    if (format == TextureFormatUniversal) {
+        format = nativeTextureFormat(device);
+    }
+    else if (!deviceSupportsFormat(device, format)) {
+        format = TextureFormatRGBA8;
+    }
+
+    auto texture_descriptor = MTL::TextureDescriptor::texture2DDescriptor(
+        texturePixelFormat(format), file.width, file.height, false);
+    texture_descriptor->setMipmapLevelCount(file.levels.size());
+    texture_descriptor->setUsage(MTL::TextureUsageShaderRead);
+
+    if (uploader) {
+        texture_descriptor->setStorageMode(MTL::StorageModePrivate);
+    }
+
+    auto texture = MTL::make_owned(device->newTexture(texture_descriptor));
+    std::vector<uint8_t> converted;
+
+    for (size_t level = 0; level < file.levels.size(); ++level) {
+        const TextureLevel& source = file.levels[level];
+        const uint8_t *data = source.data;
+
+        if (format != file.format) {
+            converted.resize(textureImageSize(format, source.width, source.height));
+
+            if (file.format == TextureFormatUniversal) {
+                transcodeTexture(source.data, source.width, source.height, format, converted.data(), pool);
+            }
+            else {
+                decodeTexture(file.format, source.data, source.width, source.height, (uint32_t *)converted.data(), pool);
+            }
+
+            data = converted.data();
+        }
+
+        if (uploader) {
+            uploader->upload(texture.get(), level, source.width, source.height, data, textureRowBytes(format, source.width),
+                isBlockCompressed(format) ? texture_block_size : 1);
+        }
+        else {
+            texture->replaceRegion(MTL::Region(0, 0, source.width, source.height), level, data,
+                textureRowBytes(format, source.width));
+        }
+    }
+
+    return texture;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "texture_file.h"
+
+#include <Metal/Metal.hpp>
+#include <Metal/shared_ptr.hpp>
+
+class TextureUploader;
+class ThreadPool;
+
+// The block format `device` samples: ASTC on Apple GPUs, BC7 on GPUs with BC
+// compression, such as the Intel and AMD GPUs of older Macs, and RGBA8 on
+// anything else.
+TextureFormat nativeTextureFormat(MTL::Device *device);
+
+bool deviceSupportsFormat(MTL::Device *device, TextureFormat format);
+
+MTL::PixelFormat texturePixelFormat(TextureFormat format);
+
+// A texture with every level of a cooked file. Levels the device samples
+// as they are go straight up; universal levels are transcoded to the
+// native format first, and ASTC or BC7 levels the device cannot sample are
+// decoded to RGBA8 on the CPU, over `pool`. With `uploader` the texture is
+// private and its levels are queued on it, to be flushed by the caller;
+// without, they are written with replaceRegion.
+MTL::shared_ptr<MTL::Texture> loadTexture(MTL::Device *device, const TextureFileView& file, ThreadPool *pool = nullptr,
+    TextureUploader *uploader = nullptr);
@@ -0,0 +1,122 @@
+#include "texture_upload.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+TextureUploader::TextureUploader(MTL::Device *device, MTL::CommandQueue *queue, size_t staging_bytes)
+    : d_queue(queue)
+    , d_staging(MTL::make_owned(device->newBuffer(staging_bytes, MTL::ResourceStorageModeShared)))
+    , d_ring(staging_bytes)
+    , d_completed(std::make_shared<CompletedBatches>()) {
+    if (!d_staging) {
+        std::cerr << "Failed to create texture staging buffer" << std::endl;
+        std::exit(-1);
+    }
+}
+
+TextureUploader::~TextureUploader() {
+    finish();
+}
+
+void
+TextureUploader::upload(MTL::Texture *texture, NS::UInteger level, uint32_t width, uint32_t height, const void *data,
+    size_t row_bytes, uint32_t row_height) {
+    uint32_t rows = (height + row_height - 1) / row_height;
+    uint32_t band_rows = (uint32_t)std::max<size_t>(1, d_ring.capacity() / 2 / row_bytes);
+    auto source = (const uint8_t *)data;
+
+    reclaim();
+
+    for (uint32_t row = 0; row < rows; row += band_rows) {
+        uint32_t count = std::min(band_rows, rows - row);
+        size_t size = count * row_bytes;
+        size_t offset = d_ring.allocate(size, 16);
+
+        while (offset == StagingRing::npos) {
+            waitForOldest();
+            offset = d_ring.allocate(size, 16);
+        }
+
+        std::memcpy((uint8_t *)d_staging->contents() + offset, source + row * row_bytes, size);
+
+        uint32_t y = row * row_height;
+        d_copies.push_back(Copy { MTL::shared_ptr<MTL::Texture>(texture), level, offset, row_bytes, y, width,
+            std::min(count * row_height, height - y) });
+        d_bytes_uploaded += size;
+    }
+}
+
+void
+TextureUploader::flush() {
+    reclaim();
+
+    if (d_copies.empty()) {
+        return;
+    }
+
+    auto buffer = MTL::make_owned(d_queue->commandBuffer());
+    auto blit = buffer->blitCommandEncoder();
+
+    for (const Copy& copy : d_copies) {
+        blit->copyFromBuffer(d_staging.get(), copy.offset, copy.row_bytes, 0, MTL::Size(copy.width, copy.height, 1),
+            copy.texture.get(), 0, copy.level, MTL::Origin(0, copy.y, 0));
+    }
+
+    blit->endEncoding();
+
+    uint64_t batch = d_ring.closeBatch();
+
+    buffer->addCompletedHandler([completed = d_completed, batch](MTL::CommandBuffer *) {
+        std::lock_guard<std::mutex> lock(completed->mutex);
+        completed->batches.push_back(batch);
+    });
+
+    buffer->commit();
+    d_in_flight.push_back(InFlight { batch, buffer });
+    d_copies.clear();
+}
+
+void
+TextureUploader::finish() {
+    flush();
+
+    while (!d_in_flight.empty()) {
+        waitForOldest();
+    }
+}
+
+void
+TextureUploader::reclaim() {
+    std::vector<uint64_t> batches;
+
+    {
+        std::lock_guard<std::mutex> lock(d_completed->mutex);
+        batches.swap(d_completed->batches);
+    }
+
+    for (uint64_t batch : batches) {
+        d_ring.retire(batch);
+        d_in_flight.erase(std::remove_if(d_in_flight.begin(), d_in_flight.end(), [batch](const InFlight& in_flight) {
+            return in_flight.batch == batch;
+        }), d_in_flight.end());
+    }
+}
+
+void
+TextureUploader::waitForOldest() {
+    if (d_in_flight.empty()) {
+        flush();
+    }
+
+    if (d_in_flight.empty()) {
+        return;
+    }
+
+    // The completion handler may not have run yet when the wait returns, so
+    // the batch is retired here; retiring it twice is harmless.
+    InFlight oldest = d_in_flight.front();
+    d_in_flight.pop_front();
+    oldest.buffer->waitUntilCompleted();
+    d_ring.retire(oldest.batch);
+}
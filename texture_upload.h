@@ -0,0 +1,81 @@
+#pragma once
+
+#include "staging_ring.h"
+
+#include <Metal/Metal.hpp>
+#include <Metal/shared_ptr.hpp>
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Fills private textures through a ring of shared staging memory instead of
+// replaceRegion, with every level supplied, mip levels included, so that no
+// generateMipmaps pass lands on the GPU at load time. Uploads are copied
+// into the ring and queued; `flush` encodes all queued copies as one blit
+// pass on a command buffer of its own, and the ring space comes back when
+// that command buffer completes. Work committed to the same queue after a
+// flush sees the textures filled.
+class TextureUploader {
+public:
+
+    TextureUploader(MTL::Device *device, MTL::CommandQueue *queue, size_t staging_bytes = 16 << 20);
+
+    // Waits for every upload.
+    ~TextureUploader();
+
+    TextureUploader(const TextureUploader&) = delete;
+    TextureUploader& operator=(const TextureUploader&) = delete;
+
+    // Queues `level` of `texture`, `width` x `height` texels, from rows of
+    // `row_bytes` at `data`, each `row_height` texels tall: 1 for RGBA8 and
+    // 4 for block formats. The data is copied before this returns. Levels
+    // larger than half the ring go in bands of rows. When the ring is full,
+    // what is queued is flushed and the oldest flush waited for.
+    void upload(MTL::Texture *texture, NS::UInteger level, uint32_t width, uint32_t height, const void *data,
+        size_t row_bytes, uint32_t row_height = 1);
+
+    void flush();
+
+    // Flushes and waits until every copy has landed.
+    void finish();
+
+    uint64_t bytesUploaded() const {
+        return d_bytes_uploaded;
+    }
+
+private:
+
+    struct Copy {
+        MTL::shared_ptr<MTL::Texture> texture;
+        NS::UInteger level;
+        size_t offset, row_bytes;
+        uint32_t y, width, height;
+    };
+
+    struct InFlight {
+        uint64_t batch;
+        MTL::shared_ptr<MTL::CommandBuffer> buffer;
+    };
+
+    // Batches whose command buffers have completed, filled in by their
+    // completion handlers on a Metal thread.
+    struct CompletedBatches {
+        std::mutex mutex;
+        std::vector<uint64_t> batches;
+    };
+
+    void reclaim();
+    void waitForOldest();
+
+    MTL::CommandQueue *d_queue;
+    MTL::shared_ptr<MTL::Buffer> d_staging;
+    StagingRing d_ring;
+
+    std::vector<Copy> d_copies;
+    std::deque<InFlight> d_in_flight;
+    std::shared_ptr<CompletedBatches> d_completed;
+
+    uint64_t d_bytes_uploaded = 0;
+};
@@ -0,0 +1,159 @@
+#include "tiled_deferred.h"
+#include "interned_string.h"
+#include "light_binning.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+#include "tiled_deferred_metallib.h"
+
+// G-buffer formats; the normal is stored biased into [0, 1].
+const MTL::PixelFormat albedo_format = MTL::PixelFormatRGBA8Unorm;
+const MTL::PixelFormat normal_format = MTL::PixelFormatRGBA8Unorm;
+
+}
+
+bool
+TiledDeferredLighting::isSupported(MTL::Device *device) {
+    return device->supportsFamily(MTL::GPUFamilyApple4);
+}
+
+TiledDeferredLighting::TiledDeferredLighting(MTL::Device *device, MTL::PixelFormat pixel_format, uint32_t light_count)
+    : d_device(device)
+    , d_lights(std::min<uint32_t>(std::max<uint32_t>(light_count, 1), TILED_LIGHTING_MAX_LIGHTS)) {
+    NS::Error *err;
+
+    d_params.lightCount = (uint32_t)d_lights.size();
+    d_params.ambient = 0.1f;
+
+    auto library_data = dispatch_data_create(
+        &tiled_deferred_metallib[0], tiled_deferred_metallib_len,
+        dispatch_get_main_queue(),
+        ^{ });
+
+    auto library = MTL::make_owned(device->newLibrary(library_data, &err));
+
+    if (!library) {
+        std::cerr << "Failed to create tiled deferred library" << std::endl;
+        std::exit(-1);
+    }
+
+    // Every pipeline in the pass sees the same attachments.
+    auto set_formats = [pixel_format](auto *color_attachments) {
+        color_attachments->object(TiledAttachmentLighting)->setPixelFormat(pixel_format);
+        color_attachments->object(TiledAttachmentAlbedo)->setPixelFormat(albedo_format);
+        color_attachments->object(TiledAttachmentNormal)->setPixelFormat(normal_format);
+    };
+
+    auto geometry_vertex = MTL::make_owned(library->newFunction(NS_STATIC_STRING("gbufferVertex")));
+    auto geometry_fragment = MTL::make_owned(library->newFunction(NS_STATIC_STRING("gbufferFragment")));
+
+    auto geometry_descriptor = MTL::make_owned(MTL::RenderPipelineDescriptor::alloc()->init());
+    geometry_descriptor->setVertexFunction(geometry_vertex.get());
+    geometry_descriptor->setFragmentFunction(geometry_fragment.get());
+    set_formats(geometry_descriptor->colorAttachments());
+
+    d_geometry_pipeline = MTL::make_owned(device->newRenderPipelineState(geometry_descriptor.get(), &err));
+
+    if (!d_geometry_pipeline) {
+        std::cerr << "Failed to create G-buffer pipeline" << std::endl;
+        std::exit(-1);
+    }
+
+    auto cull_function = MTL::make_owned(library->newFunction(NS_STATIC_STRING("tiledCullLights")));
+
+    auto cull_descriptor = MTL::make_owned(MTL::TileRenderPipelineDescriptor::alloc()->init());
+    cull_descriptor->setTileFunction(cull_function.get());
+    cull_descriptor->setThreadgroupSizeMatchesTileSize(true);
+    set_formats(cull_descriptor->colorAttachments());
+
+    d_cull_pipeline = MTL::make_owned(device->newRenderPipelineState(cull_descriptor.get(), MTL::PipelineOptionNone, nullptr, &err));
+
+    if (!d_cull_pipeline) {
+        std::cerr << "Failed to create light culling tile pipeline" << std::endl;
+        std::exit(-1);
+    }
+
+    auto lighting_vertex = MTL::make_owned(library->newFunction(NS_STATIC_STRING("tiledLightingVertex")));
+    auto lighting_fragment = MTL::make_owned(library->newFunction(NS_STATIC_STRING("tiledLighting")));
+
+    auto lighting_descriptor = MTL::make_owned(MTL::RenderPipelineDescriptor::alloc()->init());
+    lighting_descriptor->setVertexFunction(lighting_vertex.get());
+    lighting_descriptor->setFragmentFunction(lighting_fragment.get());
+    set_formats(lighting_descriptor->colorAttachments());
+
+    d_lighting_pipeline = MTL::make_owned(device->newRenderPipelineState(lighting_descriptor.get(), &err));
+
+    if (!d_lighting_pipeline) {
+        std::cerr << "Failed to create tiled lighting pipeline" << std::endl;
+        std::exit(-1);
+    }
+}
+
+MTL::shared_ptr<MTL::RenderPassDescriptor>
+TiledDeferredLighting::renderPass(MTL::Texture *target) {
+    auto width = target->width(), height = target->height();
+
+    if (!d_albedo || d_albedo->width() != width || d_albedo->height() != height) {
+        // Memoryless: the G-buffer only ever exists in tile memory.
+        auto make_target = [this, width, height](MTL::PixelFormat format) {
+            auto texture_descriptor = MTL::TextureDescriptor::texture2DDescriptor(format, width, height, false);
+            texture_descriptor->setUsage(MTL::TextureUsageRenderTarget);
+            texture_descriptor->setStorageMode(MTL::StorageModeMemoryless);
+
+            return MTL::make_owned(d_device->newTexture(texture_descriptor));
+        };
+
+        d_albedo = make_target(albedo_format);
+        d_normal = make_target(normal_format);
+    }
+
+    auto pass = MTL::make_owned(MTL::RenderPassDescriptor::alloc()->init());
+
+    auto lighting_attachment = pass->colorAttachments()->object(TiledAttachmentLighting);
+    lighting_attachment->setLoadAction(MTL::LoadAction::LoadActionClear);
+    lighting_attachment->setStoreAction(MTL::StoreAction::StoreActionStore);
+    lighting_attachment->setClearColor(MTL::ClearColor(0.0, 0.0, 0.0, 1.0));
+    lighting_attachment->setTexture(target);
+
+    // Zero albedo alpha marks pixels nothing was drawn to.
+    for (auto index : { TiledAttachmentAlbedo, TiledAttachmentNormal }) {
+        auto attachment = pass->colorAttachments()->object(index);
+        attachment->setLoadAction(MTL::LoadAction::LoadActionClear);
+        attachment->setStoreAction(MTL::StoreAction::StoreActionDontCare);
+        attachment->setClearColor(MTL::ClearColor(0.0, 0.0, 0.0, 0.0));
+        attachment->setTexture(index == TiledAttachmentAlbedo ? d_albedo.get() : d_normal.get());
+    }
+
+    pass->setTileWidth(TILED_LIGHTING_TILE_SIZE);
+    pass->setTileHeight(TILED_LIGHTING_TILE_SIZE);
+    pass->setThreadgroupMemoryLength(TILED_LIGHTING_LIST_BYTES);
+
+    return pass;
+}
+
+void
+TiledDeferredLighting::beginFrame(MTL::RenderCommandEncoder *encoder, float time) {
+    animateLights(d_lights.data(), (uint32_t)d_lights.size(), time, (uint32_t)d_albedo->width(), (uint32_t)d_albedo->height());
+
+    encoder->setFragmentBytes(&d_params, sizeof(d_params), TiledInputIndexParams);
+}
+
+void
+TiledDeferredLighting::light(MTL::RenderCommandEncoder *encoder) const {
+    // Lights are small enough to pass inline; TILED_LIGHTING_MAX_LIGHTS keeps
+    // them under the 4 KB limit.
+    NS::UInteger lights_length = d_lights.size() * sizeof(TiledLight);
+
+    encoder->setRenderPipelineState(d_cull_pipeline.get());
+    encoder->setThreadgroupMemoryLength(TILED_LIGHTING_LIST_BYTES, 0, TiledThreadgroupIndexLightList);
+    encoder->setTileBytes(d_lights.data(), lights_length, TiledInputIndexLights);
+    encoder->setTileBytes(&d_params, sizeof(d_params), TiledInputIndexParams);
+    encoder->dispatchThreadsPerTile(MTL::Size(TILED_LIGHTING_TILE_SIZE, TILED_LIGHTING_TILE_SIZE, 1));
+
+    encoder->setRenderPipelineState(d_lighting_pipeline.get());
+    encoder->setFragmentBytes(d_lights.data(), lights_length, TiledInputIndexLights);
+    encoder->drawPrimitives(MTL::PrimitiveType::PrimitiveTypeTriangle, NS::UInteger(0), NS::UInteger(3));
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "lighting_types.h"
+
+#include <Metal/Metal.hpp>
+#include <Metal/shared_ptr.hpp>
+
+#include <vector>
+
+// Deferred lighting that never leaves tile memory. The scene is drawn into a
+// G-buffer of memoryless attachments, a tile shader bins the lights of each
+// tile into threadgroup memory, and a full-screen pass in the same render
+// pass shades every pixel with its tile's lights. Only the lit color is
+// stored. `binLights` in core/light_binning.h does the binning on the CPU.
+class TiledDeferredLighting {
+public:
+
+    // Tile shaders and memoryless targets need an Apple GPU.
+    static bool isSupported(MTL::Device *device);
+
+    TiledDeferredLighting(MTL::Device *device, MTL::PixelFormat pixel_format, uint32_t light_count);
+
+    // Pipeline for the scene's draws; takes the same vertex buffers as the
+    // triangle pipeline.
+    MTL::RenderPipelineState *geometryPipeline() const {
+        return d_geometry_pipeline.get();
+    }
+
+    // Render pass that leaves the lit result in `target`. The G-buffer is
+    // reallocated when the target's size changes.
+    MTL::shared_ptr<MTL::RenderPassDescriptor> renderPass(MTL::Texture *target);
+
+    // Moves the lights to where they are at `time` seconds and binds what the
+    // G-buffer pass needs. Call before the scene's draws.
+    void beginFrame(MTL::RenderCommandEncoder *encoder, float time);
+
+    // Bins the lights per tile and lights every pixel. Call after the scene's
+    // draws, on the same encoder.
+    void light(MTL::RenderCommandEncoder *encoder) const;
+
+private:
+
+    MTL::Device *d_device;
+
+    MTL::shared_ptr<MTL::RenderPipelineState> d_geometry_pipeline;
+    MTL::shared_ptr<MTL::RenderPipelineState> d_cull_pipeline;
+    MTL::shared_ptr<MTL::RenderPipelineState> d_lighting_pipeline;
+
+    MTL::shared_ptr<MTL::Texture> d_albedo, d_normal;
+
+    std::vector<TiledLight> d_lights;
+    TiledLightingParams d_params;
+};
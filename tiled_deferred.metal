@@ -0,0 +1,152 @@
+/*
+Shaders for tiled deferred lighting on Apple GPUs: the G-buffer stays in tile
+memory, a tile shader bins lights per tile into threadgroup memory, and a
+full-screen pass lights every pixel from its tile's list
+*/
+
+#include <metal_stdlib>
+
+using namespace metal;
+
+#include "triangle_types.h"
+#include "core/lighting_types.h"
+
+// All color attachments of the pass. Every pipeline in it declares the same
+// layout; the albedo and normal attachments are memoryless.
+struct GBufferData
+{
+    half4 lighting [[color(TiledAttachmentLighting)]];
+    half4 albedo   [[color(TiledAttachmentAlbedo)]];
+    half4 normal   [[color(TiledAttachmentNormal)]];
+};
+
+// Per-tile light list, built by tiledCullLights and read by tiledLighting.
+// Matches TILED_LIGHTING_LIST_BYTES.
+struct TileLightList
+{
+    atomic_uint count;
+    uint padding[3];
+    uint indices[TILED_LIGHTING_MAX_LIGHTS_PER_TILE];
+};
+
+struct GBufferRasterizerData
+{
+    float4 position [[position]];
+    float4 color;
+};
+
+// Same transform as vertexShader in triangle.metal.
+vertex GBufferRasterizerData
+gbufferVertex(uint vertexID [[vertex_id]],
+              constant AAPLVertex *vertices [[buffer(AAPLVertexInputIndexVertices)]],
+              constant vector_uint2 *viewportSizePointer [[buffer(AAPLVertexInputIndexViewportSize)]])
+{
+    GBufferRasterizerData out;
+
+    vector_float2 viewportSize = vector_float2(*viewportSizePointer);
+
+    out.position = vector_float4(0.0, 0.0, 0.0, 1.0);
+    out.position.xy = vertices[vertexID].position.xy / (viewportSize / 2.0);
+    out.color = vertices[vertexID].color;
+
+    return out;
+}
+
+// Writes the surface into the G-buffer. The normal is a procedural ripple so
+// the lights have some relief to show; it is stored as n * 0.5 + 0.5.
+fragment GBufferData
+gbufferFragment(GBufferRasterizerData in [[stage_in]],
+                constant TiledLightingParams &params [[buffer(TiledInputIndexParams)]])
+{
+    float2 ripple = sin(in.position.xy * 0.05) * 0.35;
+    float3 normal = normalize(float3(ripple, 1.0));
+
+    GBufferData out;
+    out.albedo = half4(in.color);
+    out.normal = half4(half3(normal * 0.5 + 0.5), 1.0);
+    out.lighting = half4(half3(in.color.rgb * params.ambient), 1.0);
+
+    return out;
+}
+
+// Runs once per tile, after every G-buffer draw in it. Each thread tests a
+// strided subset of the lights against the tile's rectangle and appends hits.
+kernel void
+tiledCullLights(uint2 tile [[threadgroup_position_in_grid]],
+                uint2 tileSize [[threads_per_threadgroup]],
+                uint threadIndex [[thread_index_in_threadgroup]],
+                threadgroup TileLightList &list [[threadgroup(TiledThreadgroupIndexLightList)]],
+                constant TiledLight *lights [[buffer(TiledInputIndexLights)]],
+                constant TiledLightingParams &params [[buffer(TiledInputIndexParams)]])
+{
+    if (threadIndex == 0) {
+        atomic_store_explicit(&list.count, 0, memory_order_relaxed);
+    }
+
+    threadgroup_barrier(mem_flags::mem_threadgroup);
+
+    float2 origin = float2(tile * tileSize);
+    float2 end = origin + float2(tileSize);
+    uint threadCount = tileSize.x * tileSize.y;
+
+    for (uint i = threadIndex; i < params.lightCount; i += threadCount) {
+        if (lightIntersectsTile(lights[i], origin.x, origin.y, end.x, end.y)) {
+            uint slot = atomic_fetch_add_explicit(&list.count, 1, memory_order_relaxed);
+
+            if (slot < TILED_LIGHTING_MAX_LIGHTS_PER_TILE) {
+                list.indices[slot] = i;
+            }
+        }
+    }
+}
+
+struct LightingData
+{
+    float4 position [[position]];
+};
+
+// Draws a single triangle that covers the whole screen.
+vertex LightingData
+tiledLightingVertex(uint vertexID [[vertex_id]])
+{
+    LightingData out;
+
+    float2 uv = float2((vertexID << 1) & 2, vertexID & 2);
+    out.position = float4(uv * 2.0 - 1.0, 0.0, 1.0);
+
+    return out;
+}
+
+// Reads the G-buffer from tile memory and adds the tile's lights to the
+// ambient term written by the G-buffer pass.
+fragment half4
+tiledLighting(LightingData in [[stage_in]],
+              GBufferData gbuffer,
+              threadgroup TileLightList &list [[threadgroup(TiledThreadgroupIndexLightList)]],
+              constant TiledLight *lights [[buffer(TiledInputIndexLights)]])
+{
+    // Nothing was drawn here.
+    if (gbuffer.albedo.a == 0.0h) {
+        return gbuffer.lighting;
+    }
+
+    float3 albedo = float3(gbuffer.albedo.rgb);
+    float3 normal = normalize(float3(gbuffer.normal.xyz) * 2.0 - 1.0);
+    float3 color = float3(gbuffer.lighting.rgb);
+
+    uint count = min(atomic_load_explicit(&list.count, memory_order_relaxed), uint(TILED_LIGHTING_MAX_LIGHTS_PER_TILE));
+
+    for (uint i = 0; i < count; ++i) {
+        TiledLight light = lights[list.indices[i]];
+
+        float2 offset = float2(light.positionX, light.positionY) - in.position.xy;
+        float attenuation = saturate(1.0 - length(offset) / light.radius);
+
+        float3 direction = normalize(float3(offset, light.height));
+        float diffuse = saturate(dot(normal, direction));
+
+        color += albedo * float3(light.colorR, light.colorG, light.colorB) * diffuse * attenuation * attenuation;
+    }
+
+    return half4(half3(color), 1.0h);
+}
@@ -0,0 +1,237 @@
+// Measures CPU visibility culling of a field of random boxes: frustum tests
+// with the scalar and SIMD kernels, on one thread and on the pool, in
+// objects per millisecond, then the software occlusion test against a few
+// large walls. Checks that every kernel produces the same visible list and
+// that the frustum test agrees with a double-precision one.
+
+#include "culling.h"
+#include "geometry.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+void
+usage(const char *program) {
+    std::fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --objects N      boxes in the scene (default 1048576)\n"
+        "  --spheres        test bounding spheres instead of boxes\n"
+        "  --frames N       camera positions per run (default 60)\n"
+        "  --occlusion WxH  occlusion buffer size (default 256x128)\n"
+        "  --no-validate    skip the reference check\n",
+        program);
+}
+
+// Right-handed perspective looking down -z, with Metal's 0..1 depth, times a
+// turn of `yaw` radians about y.
+void
+viewProjection(float yaw, float out[16]) {
+    float projection[16];
+    perspective(60.0f * float(M_PI) / 180.0f, 16.0f / 9.0f, 0.5f, 2000.0f, projection);
+
+    float view[16] = {};
+    view[0] = std::cos(yaw);
+    view[2] = std::sin(yaw);
+    view[5] = 1.0f;
+    view[8] = -std::sin(yaw);
+    view[10] = std::cos(yaw);
+    view[15] = 1.0f;
+
+    multiplyMatrices(projection, view, out);
+}
+
+// Objects the double-precision test classifies differently from `visible`,
+// ignoring those within a hair of a plane.
+size_t
+countFrustumMismatches(const CullBounds& bounds, const Frustum& frustum, CullShape shape, const std::vector<uint32_t>& visible) {
+    std::vector<uint8_t> is_visible(bounds.size(), 0);
+
+    for (uint32_t index : visible) {
+        is_visible[index] = 1;
+    }
+
+    size_t mismatches = 0;
+
+    for (size_t i = 0; i < bounds.size(); ++i) {
+        double slack = INFINITY;
+
+        for (const auto& plane : frustum.planes) {
+            double distance = (double)bounds.center[0][i] * plane[0] + (double)bounds.center[1][i] * plane[1] +
+                              (double)bounds.center[2][i] * plane[2] + plane[3];
+            double radius = shape == CullShapeSphere ? (double)bounds.radius[i] :
+                (double)bounds.extent[0][i] * std::fabs(plane[0]) + (double)bounds.extent[1][i] * std::fabs(plane[1]) +
+                (double)bounds.extent[2][i] * std::fabs(plane[2]);
+            slack = std::min(slack, distance + radius);
+        }
+
+        if ((slack >= 0.0) != (is_visible[i] != 0) && std::fabs(slack) > 1e-3) {
+            ++mismatches;
+        }
+    }
+
+    return mismatches;
+}
+
+struct RunResult {
+    double objects_per_ms;
+    size_t visible;
+};
+
+RunResult
+runFrustum(const CullBounds& bounds, CullShape shape, unsigned frames, ThreadPool *pool, SimdKernel kernel,
+    std::vector<uint32_t>& visible) {
+    size_t total = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for (unsigned frame = 0; frame < frames; ++frame) {
+        float matrix[16];
+        viewProjection(frame * 2.0f * float(M_PI) / frames, matrix);
+        total += cullFrustum(bounds, frustumFromMatrix(matrix), shape, visible, pool, kernel);
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return { (double)bounds.size() * frames / ms, total / frames };
+}
+
+}
+
+int
+main(int argc, char **argv) {
+    unsigned object_count = 1 << 20, frames = 60;
+    unsigned occlusion_width = 256, occlusion_height = 128;
+    CullShape shape = CullShapeBox;
+    bool validate = true;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--objects") == 0 && i + 1 < argc) {
+            object_count = std::max(1u, (unsigned)std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--spheres") == 0) {
+            shape = CullShapeSphere;
+        }
+        else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = std::max(1u, (unsigned)std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--occlusion") == 0 && i + 1 < argc) {
+            if (std::sscanf(argv[++i], "%ux%u", &occlusion_width, &occlusion_height) != 2 ||
+                occlusion_width == 0 || occlusion_height == 0) {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--no-validate") == 0) {
+            validate = false;
+        }
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    // Boxes scattered around the camera, most of them out of view at any
+    // one time.
+    std::mt19937 random(41);
+    std::uniform_real_distribution<float> position(-1000.0f, 1000.0f), size(0.5f, 8.0f);
+    CullBounds bounds;
+    bounds.resize(object_count);
+
+    for (unsigned i = 0; i < object_count; ++i) {
+        float x = position(random), y = position(random) * 0.25f, z = position(random);
+        bounds.set(i, x, y, z, size(random), size(random), size(random));
+    }
+
+    std::printf("%u %s, %u camera positions\n", object_count, shape == CullShapeSphere ? "spheres" : "boxes", frames);
+
+    ThreadPool pool;
+    std::vector<uint32_t> scalar_visible, simd_visible, pool_visible;
+
+    RunResult scalar = runFrustum(bounds, shape, frames, nullptr, SimdKernelScalar, scalar_visible);
+    RunResult simd = runFrustum(bounds, shape, frames, nullptr, SimdKernelVector, simd_visible);
+    RunResult parallel = runFrustum(bounds, shape, frames, &pool, SimdKernelVector, pool_visible);
+
+    std::printf("%-9s %2u thread%s %10.0f objects/ms, %zu visible per frame\n", "scalar", 1u, " ",
+        scalar.objects_per_ms, scalar.visible);
+    std::printf("%-9s %2u thread%s %10.0f objects/ms %6.2fx\n", "simd", 1u, " ", simd.objects_per_ms,
+        simd.objects_per_ms / scalar.objects_per_ms);
+    std::printf("%-9s %2u thread%s %10.0f objects/ms %6.2fx\n", "simd", pool.threadCount(),
+        pool.threadCount() == 1 ? " " : "s", parallel.objects_per_ms, parallel.objects_per_ms / scalar.objects_per_ms);
+
+    // Walls across the view at the last camera position, covering most of
+    // the screen at a few depths.
+    float matrix[16];
+    viewProjection((frames - 1) * 2.0f * float(M_PI) / frames, matrix);
+
+    std::vector<float> positions;
+    std::vector<uint32_t> indices;
+
+    auto addWall = [&](float x0, float x1, float y0, float y1, float z) {
+        uint32_t base = (uint32_t)positions.size() / 3;
+        const float corners[4][3] = { { x0, y0, z }, { x1, y0, z }, { x1, y1, z }, { x0, y1, z } };
+
+        for (const auto& corner : corners) {
+            // Into world space: undo the camera's turn about y.
+            float yaw = (frames - 1) * 2.0f * float(M_PI) / frames;
+            positions.push_back(corner[0] * std::cos(yaw) + corner[2] * std::sin(yaw));
+            positions.push_back(corner[1]);
+            positions.push_back(-corner[0] * std::sin(yaw) + corner[2] * std::cos(yaw));
+        }
+
+        for (uint32_t k : { 0u, 1u, 2u, 0u, 2u, 3u }) {
+            indices.push_back(base + k);
+        }
+    };
+
+    addWall(-60.0f, -5.0f, -40.0f, 40.0f, -50.0f);
+    addWall(5.0f, 60.0f, -40.0f, 40.0f, -50.0f);
+    addWall(-200.0f, 200.0f, -150.0f, -20.0f, -150.0f);
+
+    OcclusionBuffer occlusion(occlusion_width, occlusion_height);
+    auto start = std::chrono::steady_clock::now();
+
+    for (unsigned frame = 0; frame < frames; ++frame) {
+        occlusion.clear();
+        occlusion.addOccluders(matrix, positions.data(), positions.size() / 3, indices.data(), indices.size());
+    }
+
+    double raster_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+
+    // The occlusion test only sees what survived the frustum.
+    std::vector<uint32_t> in_frustum, unoccluded;
+    cullFrustum(bounds, frustumFromMatrix(matrix), shape, in_frustum, &pool);
+    start = std::chrono::steady_clock::now();
+
+    for (unsigned frame = 0; frame < frames; ++frame) {
+        unoccluded = in_frustum;
+        occlusion.cull(bounds, matrix, unoccluded);
+    }
+
+    double cull_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+
+    std::printf("occlusion %ux%u: occluders in %.3f ms, %10.0f objects/ms, %zu of %zu in the frustum left\n",
+        occlusion_width, occlusion_height, raster_ms, in_frustum.size() / cull_ms, unoccluded.size(), in_frustum.size());
+
+    if (simd_visible != scalar_visible || pool_visible != scalar_visible) {
+        std::printf("validation: kernels disagree on the visible list\n");
+        return 1;
+    }
+
+    if (validate) {
+        size_t mismatches = countFrustumMismatches(bounds, frustumFromMatrix(matrix), shape, scalar_visible);
+        std::printf("validation: %zu objects classified differently from the double-precision test\n", mismatches);
+
+        if (mismatches != 0) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
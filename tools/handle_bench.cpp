@@ -0,0 +1,144 @@
+// Measures bindless slot bookkeeping: SlotAllocator allocate/free churn, and
+// HandleTable insert/lookup/remove against an unordered_map keyed by a
+// running id, which is what stable handles would otherwise cost.
+
+#include "handle_table.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+void
+usage(const char *program) {
+    std::fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --capacity N    slots in the table (default 4096)\n"
+        "  --ops N         operations per run (default 20000000)\n",
+        program);
+}
+
+double
+secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void
+report(const char *what, uint64_t ops, double seconds, uint64_t sink) {
+    std::printf("%-28s %8.1f M ops/s%s\n", what, ops / seconds / 1e6, sink == 0 ? " (no results)" : "");
+}
+
+}
+
+int
+main(int argc, char **argv) {
+    uint32_t capacity = 4096;
+    uint64_t ops = 20000000;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--capacity") == 0 && i + 1 < argc) {
+            capacity = std::max(2u, (uint32_t)std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--ops") == 0 && i + 1 < argc) {
+            ops = std::max(1ull, std::strtoull(argv[++i], nullptr, 10));
+        }
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    // The same random sequence of lookups and replacements for every run:
+    // a quarter of the operations retire a random entry and add a new one.
+    std::mt19937 rng(5);
+    std::vector<uint32_t> picks(1 << 16);
+
+    for (uint32_t& pick : picks) {
+        pick = rng() % capacity;
+    }
+
+    SlotAllocator slots(capacity);
+    std::vector<uint32_t> held;
+    uint64_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint64_t i = 0; i < ops; ++i) {
+        uint32_t slot = slots.allocate();
+
+        if (slot == SlotAllocator::invalid_slot) {
+            uint32_t victim = picks[i & (picks.size() - 1)] % held.size();
+            slots.free(held[victim]);
+            held[victim] = held.back();
+            held.pop_back();
+        }
+        else {
+            held.push_back(slot);
+            sink += slot;
+        }
+    }
+
+    report("SlotAllocator churn", ops, secondsSince(start), sink + 1);
+
+    HandleTable<uint64_t> table(capacity);
+    std::vector<ResourceHandle> handles;
+
+    for (uint32_t i = 0; i < capacity; ++i) {
+        handles.push_back(table.insert(i));
+    }
+
+    sink = 0;
+    start = std::chrono::steady_clock::now();
+
+    for (uint64_t i = 0; i < ops; ++i) {
+        ResourceHandle& handle = handles[picks[i & (picks.size() - 1)]];
+
+        if ((i & 3) == 0) {
+            table.remove(handle);
+            handle = table.insert(i);
+        }
+        else if (const uint64_t *value = table.get(handle)) {
+            sink += *value;
+        }
+    }
+
+    report("HandleTable get/replace", ops, secondsSince(start), sink);
+
+    std::unordered_map<uint64_t, uint64_t> map;
+    std::vector<uint64_t> ids;
+
+    for (uint32_t i = 0; i < capacity; ++i) {
+        map.emplace(i, i);
+        ids.push_back(i);
+    }
+
+    uint64_t next_id = capacity;
+    sink = 0;
+    start = std::chrono::steady_clock::now();
+
+    for (uint64_t i = 0; i < ops; ++i) {
+        uint64_t& id = ids[picks[i & (picks.size() - 1)]];
+
+        if ((i & 3) == 0) {
+            map.erase(id);
+            id = next_id++;
+            map.emplace(id, i);
+        }
+        else {
+            auto found = map.find(id);
+
+            if (found != map.end()) {
+                sink += found->second;
+            }
+        }
+    }
+
+    report("unordered_map get/replace", ops, secondsSince(start), sink);
+
+    return 0;
+}
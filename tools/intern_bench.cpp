@@ -0,0 +1,200 @@
+// Measures name lookups per second through the intern table against building
+// a fresh string for every lookup, which is what calling
+// `NS::String::string(name, ...)` per lookup amounts to. On Apple platforms
+// the same comparison also runs against real NS::Strings.
+
+#include "intern_table.h"
+
+#if INTERN_BENCH_FOUNDATION
+#include "interned_string.h"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+void
+usage(const char *program) {
+    std::fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --names N       distinct names (default 4096)\n"
+        "  --lookups N     lookups per thread and method (default 4000000)\n"
+        "  --threads N     reader threads for the concurrent runs (default: all cores)\n",
+        program);
+}
+
+// Runs `lookup(thread, i)` `lookups` times on each of `threads` threads and
+// returns total lookups per second. `sink` keeps results observable.
+template<typename Lookup>
+double
+measure(unsigned threads, uint64_t lookups, Lookup&& lookup) {
+    std::atomic<uint64_t> sink { 0 };
+    std::vector<std::thread> workers;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            uint64_t local = 0;
+
+            for (uint64_t i = 0; i < lookups; ++i) {
+                local += lookup(t, i);
+            }
+
+            sink += local;
+        });
+    }
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (sink.load() == 0) {
+        std::fprintf(stderr, "(no results)\n");
+    }
+
+    return (double)(threads * lookups) / seconds;
+}
+
+void
+report(const char *method, unsigned threads, double per_second, double baseline) {
+    std::printf("%-34s %2u thread%s %10.1f M/s %8.1fx\n",
+        method, threads, threads == 1 ? " " : "s", per_second / 1e6, per_second / baseline);
+}
+
+}
+
+int
+main(int argc, char **argv) {
+    unsigned name_count = 4096;
+    uint64_t lookups = 4000000;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--names") == 0 && i + 1 < argc) {
+            name_count = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--lookups") == 0 && i + 1 < argc) {
+            lookups = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        }
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (name_count == 0 || threads == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // Shaped like material function names, and too long for the small
+    // string optimization so building one allocates, as an NS::String would.
+    std::vector<std::string> names;
+    std::vector<uint64_t> hashes;
+
+    for (unsigned i = 0; i < name_count; ++i) {
+        names.push_back("material" + std::to_string(i) + "SurfaceFragment");
+        hashes.push_back(hashName(names.back()));
+    }
+
+    InternTable<uint32_t> table;
+    std::unordered_map<std::string, uint32_t> map;
+    std::mutex map_mutex;
+
+    for (unsigned i = 0; i < name_count; ++i) {
+        table.intern(names[i], [i]() { return i; });
+        map.emplace(names[i], i);
+    }
+
+    // Visit names in a scattered order so lookups do not just hit one line.
+    auto name_index = [name_count](unsigned thread, uint64_t i) {
+        return (size_t)((i * 2654435761u + thread * 40503u) % name_count);
+    };
+
+    std::vector<unsigned> thread_counts = { 1 };
+
+    if (threads > 1) {
+        thread_counts.push_back(threads);
+    }
+
+    std::printf("%u names, %llu lookups per thread\n", name_count, (unsigned long long)lookups);
+
+    double baseline = measure(1, lookups, [&](unsigned t, uint64_t i) {
+        auto string = std::make_unique<std::string>(names[name_index(t, i)]);
+        return (uint64_t)string->size();
+    });
+
+    report("create a string per lookup", 1, baseline, baseline);
+
+    for (unsigned n : thread_counts) {
+        double per_second = measure(n, lookups, [&](unsigned t, uint64_t i) {
+            std::lock_guard<std::mutex> lock(map_mutex);
+            return (uint64_t)map.find(names[name_index(t, i)])->second;
+        });
+
+        report("locked unordered_map", n, per_second, baseline);
+    }
+
+    for (unsigned n : thread_counts) {
+        double per_second = measure(n, lookups, [&](unsigned t, uint64_t i) {
+            return (uint64_t)*table.find(names[name_index(t, i)]);
+        });
+
+        report("intern table", n, per_second, baseline);
+    }
+
+    for (unsigned n : thread_counts) {
+        double per_second = measure(n, lookups, [&](unsigned t, uint64_t i) {
+            size_t index = name_index(t, i);
+            return (uint64_t)*table.find(names[index], hashes[index]);
+        });
+
+        report("intern table, precomputed hash", n, per_second, baseline);
+    }
+
+#if INTERN_BENCH_FOUNDATION
+    // Each pool drains the strings created by `NS::String::string`.
+    double ns_baseline = measure(1, lookups, [&](unsigned t, uint64_t i) {
+        auto pool = NS::AutoreleasePool::alloc()->init();
+        auto string = NS::String::string(names[name_index(t, i)].c_str(), NS::UTF8StringEncoding);
+        uint64_t length = string->length();
+        pool->release();
+        return length;
+    });
+
+    report("NS::String::string per lookup", 1, ns_baseline, ns_baseline);
+
+    for (unsigned n : thread_counts) {
+        double per_second = measure(n, lookups, [&](unsigned t, uint64_t i) {
+            return (uint64_t)NS::internString(names[name_index(t, i)]);
+        });
+
+        report("NS::internString", n, per_second, ns_baseline);
+    }
+
+    double static_per_second = measure(1, lookups, [&](unsigned, uint64_t) {
+        return (uint64_t)NS_STATIC_STRING("materialSurfaceFragment").string();
+    });
+
+    report("NS_STATIC_STRING", 1, static_per_second, ns_baseline);
+#endif
+
+    return 0;
+}
@@ -0,0 +1,119 @@
+// Benchmarks and validates the CPU light binning that mirrors the tiled
+// deferred lighting tile shader: binning rate on one thread and on the
+// thread pool, per-tile list statistics, and a brute-force per-pixel check
+// that no light reaching a pixel is missing from its tile's list.
+
+#include "light_binning.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+void
+usage(const char *program) {
+    std::fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --lights N       lights (default %u, the GPU path's limit)\n"
+        "  --size WxH       window size (default 1920x1080)\n"
+        "  --tile N         tile size in pixels (default %u)\n"
+        "  --frames N       animation frames binned per run (default 1000)\n"
+        "  --no-validate    skip the brute-force check\n",
+        program, (unsigned)TILED_LIGHTING_MAX_LIGHTS, (unsigned)TILED_LIGHTING_TILE_SIZE);
+}
+
+// Bins `frames` steps of the animation and returns frames per second.
+double
+run(std::vector<TiledLight>& lights, unsigned width, unsigned height, unsigned tile_size, unsigned frames, ThreadPool *pool) {
+    LightBins bins;
+    auto start = std::chrono::steady_clock::now();
+
+    for (unsigned frame = 0; frame < frames; ++frame) {
+        animateLights(lights.data(), (uint32_t)lights.size(), frame / 60.0f, width, height);
+        binLights(lights.data(), (uint32_t)lights.size(), width, height, tile_size, TILED_LIGHTING_MAX_LIGHTS_PER_TILE, bins, pool);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return frames / seconds;
+}
+
+}
+
+int
+main(int argc, char **argv) {
+    unsigned light_count = TILED_LIGHTING_MAX_LIGHTS;
+    unsigned width = 1920, height = 1080;
+    unsigned tile_size = TILED_LIGHTING_TILE_SIZE;
+    unsigned frames = 1000;
+    bool validate = true;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--lights") == 0 && i + 1 < argc) {
+            light_count = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            if (std::sscanf(argv[++i], "%ux%u", &width, &height) != 2) {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--tile") == 0 && i + 1 < argc) {
+            tile_size = std::max(1u, (unsigned)std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = std::max(1u, (unsigned)std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--no-validate") == 0) {
+            validate = false;
+        }
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<TiledLight> lights(light_count);
+    ThreadPool pool;
+
+    std::printf("%u lights, %ux%u, %ux%u tiles\n", light_count, width, height, tile_size, tile_size);
+
+    double single = run(lights, width, height, tile_size, frames, nullptr);
+    double parallel = run(lights, width, height, tile_size, frames, &pool);
+
+    std::printf("%-10s %2u thread%s %10.1f frames/s\n", "binning", 1u, " ", single);
+    std::printf("%-10s %2u thread%s %10.1f frames/s %6.2fx\n", "binning", pool.threadCount(),
+        pool.threadCount() == 1 ? " " : "s", parallel, parallel / single);
+
+    // Statistics and validation on the first frame.
+    LightBins bins;
+    animateLights(lights.data(), light_count, 0.0f, width, height);
+    binLights(lights.data(), light_count, width, height, tile_size, TILED_LIGHTING_MAX_LIGHTS_PER_TILE, bins);
+
+    uint64_t total = 0;
+    uint32_t most = 0, overflowed = 0;
+
+    for (uint32_t count : bins.counts) {
+        total += count;
+        most = std::max(most, count);
+        overflowed += count > bins.max_per_tile ? 1 : 0;
+    }
+
+    std::printf("%.2f lights per tile on average, %u at most, %u of %zu tiles over the limit of %u\n",
+        (double)total / bins.counts.size(), most, overflowed, bins.counts.size(), bins.max_per_tile);
+
+    if (validate) {
+        uint64_t missing = countMissingLights(bins, lights.data(), light_count, width, height);
+        std::printf("validation: %llu missing (pixel, light) pairs\n", (unsigned long long)missing);
+
+        if (missing > 0) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,231 @@
+// Measures link-set resolution over a synthetic material library (shading
+// functions calling shared helpers, some from dynamic libraries) and
+// function table slot churn, in resolutions and slot operations per second.
+// Checks resolution against a hand-built library: calls are followed through
+// static and dynamic libraries, cycles end, the first library to export a
+// function wins, missing functions are reported, and equal sets hash equal.
+// Checks that table slots are shared by name, reference counted, reused
+// once free, and refused when the table is full.
+
+#include "function_linking.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+void
+usage(const char *program) {
+    std::fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --materials N    shading functions in the synthetic library (default 256)\n"
+        "  --roots N        functions per resolved set (default 16)\n"
+        "  --runs N         resolutions and slot rounds (default 20000)\n"
+        "  --no-validate    skip the checks\n",
+        program);
+}
+
+double
+millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Materials call two or three of 64 helpers, which call into one of two
+// dynamic libraries of lighting and noise functions.
+LinkResolver
+makeLibrary(uint32_t material_count) {
+    LinkResolver resolver;
+    std::mt19937 rng(3);
+
+    ShaderLibraryInfo lighting { "lighting", true, {} };
+    ShaderLibraryInfo noise { "noise", true, {} };
+
+    for (int i = 0; i < 8; ++i) {
+        lighting.functions.push_back({ "light" + std::to_string(i), { "noise" + std::to_string(i) } });
+        noise.functions.push_back({ "noise" + std::to_string(i), {} });
+    }
+
+    ShaderLibraryInfo helpers { "helpers", false, {} };
+
+    for (int i = 0; i < 64; ++i) {
+        helpers.functions.push_back({ "helper" + std::to_string(i), { "light" + std::to_string(i % 8) } });
+    }
+
+    ShaderLibraryInfo materials { "materials", false, {} };
+
+    for (uint32_t i = 0; i < material_count; ++i) {
+        ShaderFunctionInfo function { "material" + std::to_string(i), {} };
+
+        for (uint32_t call = 0; call < 2 + rng() % 2; ++call) {
+            function.calls.push_back("helper" + std::to_string(rng() % 64));
+        }
+
+        materials.functions.push_back(std::move(function));
+    }
+
+    resolver.addLibrary(std::move(materials));
+    resolver.addLibrary(std::move(helpers));
+    resolver.addLibrary(std::move(lighting));
+    resolver.addLibrary(std::move(noise));
+
+    return resolver;
+}
+
+bool
+resolvesCorrectly() {
+    LinkResolver resolver;
+    uint32_t noise = resolver.addLibrary({ "noise", true, { { "noise", {} } } });
+    uint32_t lighting = resolver.addLibrary({ "lighting", true, { { "light", { "noise" } } } });
+    resolver.addLibrary({ "materials", false, {
+        { "flat", { "light" } },
+        { "checker", { "light" } },
+        { "rings", { "light" } },
+        { "blend", { "checker", "rings" } },
+        { "ping", { "pong" } },
+        { "pong", { "ping" } },
+    } });
+    resolver.addLibrary({ "overrides", false, { { "flat", {} } } });
+
+    LinkSet set, same;
+    bool ok = resolver.resolve({ "blend" }, set) &&
+              set.functions == std::vector<std::string> { "blend", "checker", "rings" } &&
+              set.libraries == std::vector<uint32_t> { noise, lighting } && set.missing.empty();
+
+    ok = ok && resolver.resolve({ "rings", "blend", "checker", "blend" }, same) && same.hash() == set.hash();
+
+    // `flat` comes from the first library that exports it, which lights it.
+    ok = ok && resolver.resolve({ "flat" }, set) && set.functions == std::vector<std::string> { "flat" } &&
+         set.libraries.size() == 2 && same.hash() != set.hash();
+
+    ok = ok && resolver.resolve({ "ping" }, set) && set.functions == std::vector<std::string> { "ping", "pong" } &&
+         set.libraries.empty();
+
+    ok = ok && !resolver.resolve({ "flat", "bogus", "missing" }, set) &&
+         set.missing == std::vector<std::string> { "bogus", "missing" };
+
+    return ok;
+}
+
+bool
+managesSlots() {
+    FunctionTableSlots slots(4);
+    const uint32_t invalid = FunctionTableSlots::invalid_slot;
+
+    bool ok = slots.acquire("a") == 0 && slots.acquire("b") == 1 && slots.acquire("c") == 2;
+    ok = ok && slots.acquire("a") == 0 && slots.references(0) == 2 && slots.size() == 3;
+
+    slots.release(0);
+    ok = ok && slots.find("a") == 0 && slots.acquire("d") == 3 && slots.acquire("e") == invalid;
+
+    slots.release(1);
+    ok = ok && slots.find("b") == invalid && slots.name(1).empty() && slots.acquire("e") == 1;
+    ok = ok && slots.names() == std::vector<std::string> { "a", "e", "c", "d" } && slots.size() == 4;
+
+    slots.release(0);
+    ok = ok && slots.find("a") == invalid && slots.acquire("f") == 0 && slots.acquire("e") == 1 &&
+         slots.references(1) == 2;
+
+    return ok;
+}
+
+}
+
+int
+main(int argc, char **argv) {
+    uint32_t material_count = 256, root_count = 16, runs = 20000;
+    bool validate = true;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--materials") == 0 && i + 1 < argc) {
+            material_count = std::max(1u, (uint32_t)std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--roots") == 0 && i + 1 < argc) {
+            root_count = std::max(1u, (uint32_t)std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            runs = std::max(1u, (uint32_t)std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--no-validate") == 0) {
+            validate = false;
+        }
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    LinkResolver resolver = makeLibrary(material_count);
+    std::mt19937 rng(11);
+
+    std::vector<std::vector<std::string>> root_sets(64);
+
+    for (auto& roots : root_sets) {
+        for (uint32_t i = 0; i < root_count; ++i) {
+            roots.push_back("material" + std::to_string(rng() % material_count));
+        }
+    }
+
+    LinkSet set;
+    size_t linked = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t run = 0; run < runs; ++run) {
+        resolver.resolve(root_sets[run % root_sets.size()], set);
+        linked += set.functions.size() + set.libraries.size();
+    }
+
+    double ms = millisecondsSince(start);
+    std::printf("resolve: %u roots of %u materials, %.1f functions and libraries per set, %10.0f sets/s\n",
+        root_count, material_count, (double)linked / runs, runs * 1e3 / ms);
+
+    // Materials come and go in a table that holds a quarter of them.
+    FunctionTableSlots slots(std::max(1u, material_count / 4));
+    std::vector<uint32_t> held;
+    size_t operations = 0, refused = 0;
+    start = std::chrono::steady_clock::now();
+
+    for (uint32_t run = 0; run < runs; ++run) {
+        for (int i = 0; i < 8; ++i) {
+            uint32_t slot = slots.acquire(root_sets[run % root_sets.size()][i % root_count]);
+
+            if (slot == FunctionTableSlots::invalid_slot) {
+                ++refused;
+            }
+            else {
+                held.push_back(slot);
+            }
+
+            ++operations;
+        }
+
+        while (held.size() > slots.capacity()) {
+            size_t victim = rng() % held.size();
+            slots.release(held[victim]);
+            held[victim] = held.back();
+            held.pop_back();
+            ++operations;
+        }
+    }
+
+    ms = millisecondsSince(start);
+    std::printf("slots: %u in the table, %10.0f operations/s, %zu of %zu acquires refused\n", slots.capacity(),
+        operations * 1e3 / ms, refused, (size_t)runs * 8);
+
+    if (!validate) {
+        return 0;
+    }
+
+    bool resolves = resolvesCorrectly();
+    bool manages = managesSlots();
+
+    std::printf("validation: link sets %s; table slots %s\n", resolves ? "resolve correctly" : "WRONG",
+        manages ? "managed correctly" : "WRONG");
+
+    return resolves && manages ? 0 : 1;
+}
@@ -0,0 +1,402 @@
+// Writes a procedural torus as Wavefront OBJ and as binary glTF, then loads
+// both back through the mesh loaders into plain memory standing in for
+// shared Metal buffers. Prints MB/s and triangles/s for OBJ on one thread
+// and on the pool and for GLB, and the number parser against strtof. Checks
+// that both formats give the same triangles, that threading does not change
+// the OBJ output, and that parsed numbers are within an ulp of strtof.
+
+#include "mesh_loader.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Plain memory in place of MTL::Buffer contents.
+class VectorMeshSink : public MeshSink {
+public:
+
+    LoadedVertex *allocateVertices(size_t count) override {
+        vertices.assign(std::max<size_t>(count, 1), LoadedVertex());
+        return vertices.data();
+    }
+
+    void *allocateIndices(size_t count, size_t size) override {
+        index_size = size;
+        indices.assign(std::max<size_t>(count * size, 1), 0);
+        return indices.data();
+    }
+
+    uint32_t index(size_t i) const {
+        if (index_size == 2) {
+            uint16_t value;
+            std::memcpy(&value, &indices[i * 2], 2);
+            return value;
+        }
+
+        uint32_t value;
+        std::memcpy(&value, &indices[i * 4], 4);
+        return value;
+    }
+
+    std::vector<LoadedVertex> vertices;
+    std::vector<uint8_t> indices;
+    size_t index_size = 0;
+};
+
+void
+usage(const char *program) {
+    std::fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --grid N         torus segments each way (default 512)\n"
+        "  --runs N         loads per format, best time reported (default 5)\n"
+        "  --obj FILE       load this OBJ file instead of the torus\n"
+        "  --gltf FILE      load this .gltf or .glb file instead of the torus\n"
+        "  --keep           keep the generated files\n"
+        "  --no-validate    skip the checks\n",
+        program);
+}
+
+struct Torus {
+    std::vector<float> positions, normals;
+    std::vector<uint32_t> indices;
+};
+
+Torus
+makeTorus(uint32_t grid) {
+    Torus torus;
+
+    for (uint32_t i = 0; i < grid; ++i) {
+        float u = 2.0f * float(M_PI) * i / grid;
+
+        for (uint32_t j = 0; j < grid; ++j) {
+            float v = 2.0f * float(M_PI) * j / grid;
+            float n[3] = { std::cos(u) * std::cos(v), std::sin(u) * std::cos(v), std::sin(v) };
+            float r = 1.0f + 0.35f * std::cos(v);
+
+            torus.positions.insert(torus.positions.end(), { r * std::cos(u), r * std::sin(u), 0.35f * std::sin(v) });
+            torus.normals.insert(torus.normals.end(), n, n + 3);
+        }
+    }
+
+    // Quads split the way an OBJ fan splits them.
+    for (uint32_t i = 0; i < grid; ++i) {
+        for (uint32_t j = 0; j < grid; ++j) {
+            uint32_t a = i * grid + j, b = ((i + 1) % grid) * grid + j;
+            uint32_t c = ((i + 1) % grid) * grid + (j + 1) % grid, d = i * grid + (j + 1) % grid;
+            torus.indices.insert(torus.indices.end(), { a, b, c, a, c, d });
+        }
+    }
+
+    return torus;
+}
+
+bool
+writeObj(const Torus& torus, const std::string& path) {
+    FILE *file = std::fopen(path.c_str(), "w");
+
+    if (!file) {
+        return false;
+    }
+
+    std::fprintf(file, "# sdl-metal-load-bench torus\n");
+
+    for (size_t v = 0; v < torus.positions.size(); v += 3) {
+        const float *p = &torus.positions[v];
+        std::fprintf(file, "v %.9g %.9g %.9g\n", p[0], p[1], p[2]);
+    }
+
+    for (size_t v = 0; v < torus.normals.size(); v += 3) {
+        const float *n = &torus.normals[v];
+        std::fprintf(file, "vn %.9g %.9g %.9g\n", n[0], n[1], n[2]);
+    }
+
+    for (size_t i = 0; i < torus.indices.size(); i += 6) {
+        const uint32_t *q = &torus.indices[i];
+        std::fprintf(file, "f %u//%u %u//%u %u//%u %u//%u\n", q[0] + 1, q[0] + 1, q[1] + 1, q[1] + 1, q[2] + 1, q[2] + 1,
+            q[5] + 1, q[5] + 1);
+    }
+
+    return std::fclose(file) == 0;
+}
+
+bool
+writeGlb(const Torus& torus, const std::string& path) {
+    size_t vertex_count = torus.positions.size() / 3;
+    size_t attribute_bytes = torus.positions.size() * sizeof(float);
+    size_t index_bytes = torus.indices.size() * sizeof(uint32_t);
+    size_t binary_bytes = attribute_bytes * 2 + index_bytes;
+
+    float low[3] = { INFINITY, INFINITY, INFINITY }, high[3] = { -INFINITY, -INFINITY, -INFINITY };
+
+    for (size_t v = 0; v < torus.positions.size(); ++v) {
+        low[v % 3] = std::min(low[v % 3], torus.positions[v]);
+        high[v % 3] = std::max(high[v % 3], torus.positions[v]);
+    }
+
+    char json[2048];
+    int length = std::snprintf(json, sizeof(json),
+        "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],\"nodes\":[{\"mesh\":0}],"
+        "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1},\"indices\":2}]}],"
+        "\"buffers\":[{\"byteLength\":%zu}],"
+        "\"bufferViews\":[{\"buffer\":0,\"byteLength\":%zu},{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu},"
+        "{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu}],"
+        "\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":%zu,\"type\":\"VEC3\","
+        "\"min\":[%.9g,%.9g,%.9g],\"max\":[%.9g,%.9g,%.9g]},"
+        "{\"bufferView\":1,\"componentType\":5126,\"count\":%zu,\"type\":\"VEC3\"},"
+        "{\"bufferView\":2,\"componentType\":5125,\"count\":%zu,\"type\":\"SCALAR\"}]}",
+        binary_bytes, attribute_bytes, attribute_bytes, attribute_bytes, attribute_bytes * 2, index_bytes, vertex_count,
+        low[0], low[1], low[2], high[0], high[1], high[2], vertex_count, torus.indices.size());
+
+    std::string padded(json, length);
+    padded.resize((padded.size() + 3) & ~size_t(3), ' ');
+
+    uint32_t header[3] = { 0x46546c67, 2, uint32_t(12 + 8 + padded.size() + 8 + binary_bytes) };
+    uint32_t json_chunk[2] = { uint32_t(padded.size()), 0x4e4f534a };
+    uint32_t binary_chunk[2] = { uint32_t(binary_bytes), 0x004e4942 };
+
+    FILE *file = std::fopen(path.c_str(), "wb");
+
+    if (!file) {
+        return false;
+    }
+
+    std::fwrite(header, sizeof(header), 1, file);
+    std::fwrite(json_chunk, sizeof(json_chunk), 1, file);
+    std::fwrite(padded.data(), padded.size(), 1, file);
+    std::fwrite(binary_chunk, sizeof(binary_chunk), 1, file);
+    std::fwrite(torus.positions.data(), attribute_bytes, 1, file);
+    std::fwrite(torus.normals.data(), attribute_bytes, 1, file);
+    std::fwrite(torus.indices.data(), index_bytes, 1, file);
+    return std::fclose(file) == 0;
+}
+
+double
+millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Best of `runs` loads; false if any load fails.
+bool
+timeLoad(const char *label, const char *path, ThreadPool *pool, unsigned runs, VectorMeshSink& sink, MeshLoadResult& result) {
+    MeshLoadOptions options;
+    options.pool = pool;
+    double best = INFINITY;
+
+    for (unsigned run = 0; run < runs; ++run) {
+        auto start = std::chrono::steady_clock::now();
+
+        if (!loadMesh(path, sink, options, result)) {
+            std::fprintf(stderr, "%s: %s\n", path, result.error.c_str());
+            return false;
+        }
+
+        best = std::min(best, millisecondsSince(start));
+    }
+
+    std::printf("%-12s %9.2f ms %8.1f MB/s %8.2f M tris/s   %zu vertices, %zu triangles, %zu-bit indices\n", label, best,
+        result.bytes / best / 1e3, result.index_count / 3 / best / 1e3, result.vertex_count, result.index_count / 3,
+        result.index_size * 8);
+    return true;
+}
+
+bool
+sameTriangles(const VectorMeshSink& a, const VectorMeshSink& b, size_t index_count) {
+    for (size_t i = 0; i < index_count; ++i) {
+        const LoadedVertex& u = a.vertices[a.index(i)];
+        const LoadedVertex& v = b.vertices[b.index(i)];
+
+        for (int c = 0; c < 2; ++c) {
+            if (std::fabs(u.position[c] - v.position[c]) > 1e-3f) {
+                return false;
+            }
+        }
+
+        for (int c = 0; c < 4; ++c) {
+            if (std::fabs(u.color[c] - v.color[c]) > 1e-5f) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// Field by field: LoadedVertex has padding between position and color,
+// which loaders never write.
+bool
+sameVertices(const std::vector<LoadedVertex>& a, const std::vector<LoadedVertex>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (std::memcmp(a[i].position, b[i].position, sizeof(a[i].position)) != 0 ||
+            std::memcmp(a[i].color, b[i].color, sizeof(a[i].color)) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Numbers as they show up in exported meshes, plus some longer ones.
+std::string
+numberText(size_t count) {
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> value(-100.0f, 100.0f);
+    std::string text;
+    char buffer[64];
+
+    for (size_t i = 0; i < count; ++i) {
+        float x = value(random);
+        const char *format = i % 4 == 0 ? "%.9g " : i % 4 == 1 ? "%.6f " : i % 4 == 2 ? "%.3e " : "%.17g ";
+        text.append(buffer, std::snprintf(buffer, sizeof(buffer), format, i % 5 == 0 ? x * 1e-6f : x));
+    }
+
+    return text;
+}
+
+}
+
+int
+main(int argc, char **argv) {
+    unsigned grid = 512, runs = 5;
+    const char *obj_path = nullptr, *gltf_path = nullptr;
+    bool keep = false, validate = true;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--grid") == 0 && i + 1 < argc) {
+            grid = std::max(3u, (unsigned)std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            runs = std::max(1u, (unsigned)std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--obj") == 0 && i + 1 < argc) {
+            obj_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--gltf") == 0 && i + 1 < argc) {
+            gltf_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--keep") == 0) {
+            keep = true;
+        }
+        else if (std::strcmp(argv[i], "--no-validate") == 0) {
+            validate = false;
+        }
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    ThreadPool pool;
+    bool generated = !obj_path && !gltf_path;
+    std::string generated_obj, generated_glb;
+
+    if (generated) {
+        const char *directory = std::getenv("TMPDIR") ? std::getenv("TMPDIR") : "/tmp";
+        generated_obj = std::string(directory) + "/sdl-metal-load-bench.obj";
+        generated_glb = std::string(directory) + "/sdl-metal-load-bench.glb";
+
+        Torus torus = makeTorus(grid);
+
+        if (!writeObj(torus, generated_obj) || !writeGlb(torus, generated_glb)) {
+            std::fprintf(stderr, "could not write the test meshes to %s\n", directory);
+            return 1;
+        }
+
+        obj_path = generated_obj.c_str();
+        gltf_path = generated_glb.c_str();
+        std::printf("torus: %zu vertices, %zu triangles\n", torus.positions.size() / 3, torus.indices.size() / 3);
+    }
+
+    std::printf("%u threads, best of %u loads\n", pool.threadCount(), runs);
+
+    bool ok = true;
+    VectorMeshSink obj_single, obj_pooled, gltf;
+    MeshLoadResult obj_result, gltf_result;
+
+    if (obj_path) {
+        ok &= timeLoad("obj 1 thread", obj_path, nullptr, runs, obj_single, obj_result);
+        ok &= timeLoad("obj pooled", obj_path, &pool, runs, obj_pooled, obj_result);
+    }
+
+    if (gltf_path) {
+        ok &= timeLoad("gltf", gltf_path, &pool, runs, gltf, gltf_result);
+    }
+
+    // The number parser alone.
+    std::string numbers = numberText(1 << 20);
+    std::vector<float> parsed, reference;
+    parsed.reserve(1 << 20);
+    reference.reserve(1 << 20);
+
+    auto start = std::chrono::steady_clock::now();
+    const char *end = numbers.data() + numbers.size();
+
+    for (const char *p = numbers.data(); p < end;) {
+        float value;
+
+        if (!parseFloat(&p, end, &value)) {
+            break;
+        }
+
+        parsed.push_back(value);
+    }
+
+    double parse_ms = millisecondsSince(start);
+    start = std::chrono::steady_clock::now();
+
+    for (char *p = &numbers[0]; p < end;) {
+        char *next;
+        float value = std::strtof(p, &next);
+
+        if (next == p) {
+            break;
+        }
+
+        reference.push_back(value);
+        p = next;
+    }
+
+    double strtof_ms = millisecondsSince(start);
+    std::printf("parseFloat   %9.2f ms %8.1f MB/s, strtof %.2f ms %.1f MB/s\n", parse_ms, numbers.size() / parse_ms / 1e3,
+        strtof_ms, numbers.size() / strtof_ms / 1e3);
+
+    if (generated && !keep) {
+        std::remove(generated_obj.c_str());
+        std::remove(generated_glb.c_str());
+    }
+
+    if (validate && ok) {
+        size_t off_by_one = 0, wrong = parsed.size() == reference.size() ? 0 : 1;
+
+        for (size_t i = 0; i < std::min(parsed.size(), reference.size()); ++i) {
+            int32_t a, b;
+            std::memcpy(&a, &parsed[i], 4);
+            std::memcpy(&b, &reference[i], 4);
+            off_by_one += std::abs(a - b) == 1 ? 1 : 0;
+            wrong += std::abs(a - b) > 1 ? 1 : 0;
+        }
+
+        bool threads_agree = !obj_path ||
+            (obj_single.indices == obj_pooled.indices && sameVertices(obj_single.vertices, obj_pooled.vertices));
+        bool formats_agree = !generated ||
+            (obj_result.index_count == gltf_result.index_count && sameTriangles(obj_single, gltf, obj_result.index_count));
+
+        std::printf("validation: %zu numbers, %zu an ulp from strtof, %zu further; OBJ threads %s; OBJ and GLB %s\n",
+            parsed.size(), off_by_one, wrong, threads_agree ? "agree" : "differ", formats_agree ? "agree" : "differ");
+        ok = wrong == 0 && threads_agree && formats_agree;
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,192 @@
+// Runs the import-time mesh optimizer on a procedural torus knot delivered
+// as a shuffled triangle soup, the way a naive exporter writes it: welding,
+// both vertex cache orders, overdraw clustering and vertex fetch order. Prints
+// the time each step takes with ACMR, ATVR and overdraw after it, and checks
+// that the final mesh draws exactly the triangles it started with.
+
+#include "geometry.h"
+#include "mesh_optimizer.h"
+#include "string_hash.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct BenchVertex {
+    float position[3];
+    float normal[3];
+};
+
+void
+usage(const char *program) {
+    std::fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --segments N     segments along the knot (default 1024)\n"
+        "  --sides N        segments around the tube (default 64)\n"
+        "  --cache N        FIFO cache size for Tipsify and the stats (default 16)\n"
+        "  --no-shuffle     keep the generated triangle order\n"
+        "  --no-validate    skip the triangle check\n",
+        program);
+}
+
+// A tube around the knot as a triangle soup: every triangle carries its own
+// three copies of the shared vertices.
+std::vector<BenchVertex>
+torusKnotSoup(uint32_t segments, uint32_t sides) {
+    std::vector<float> positions, normals;
+    std::vector<uint32_t> indices;
+    torusKnot(segments, sides, positions, normals, indices);
+
+    std::vector<BenchVertex> soup(indices.size());
+
+    for (size_t i = 0; i < indices.size(); ++i) {
+        for (int c = 0; c < 3; ++c) {
+            soup[i].position[c] = positions[indices[i] * 3 + c];
+            soup[i].normal[c] = normals[indices[i] * 3 + c];
+        }
+    }
+
+    return soup;
+}
+
+// Sorted hashes of each triangle's vertex records, in corner order.
+std::vector<uint64_t>
+triangleHashes(const BenchVertex *vertices, const uint32_t *indices, size_t index_count) {
+    std::vector<uint64_t> hashes;
+
+    for (size_t i = 0; i + 3 <= index_count; i += 3) {
+        BenchVertex triangle[3];
+
+        for (int k = 0; k < 3; ++k) {
+            triangle[k] = indices ? vertices[indices[i + k]] : vertices[i + k];
+        }
+
+        hashes.push_back(hashName(reinterpret_cast<const char *>(triangle), sizeof(triangle)));
+    }
+
+    std::sort(hashes.begin(), hashes.end());
+    return hashes;
+}
+
+double
+millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+}
+
+int
+main(int argc, char **argv) {
+    unsigned segments = 1024, sides = 64, cache_size = 16;
+    bool shuffle = true, validate = true;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--segments") == 0 && i + 1 < argc) {
+            segments = std::max(3u, (unsigned)std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--sides") == 0 && i + 1 < argc) {
+            sides = std::max(3u, (unsigned)std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            cache_size = std::max(3u, (unsigned)std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--no-shuffle") == 0) {
+            shuffle = false;
+        }
+        else if (std::strcmp(argv[i], "--no-validate") == 0) {
+            validate = false;
+        }
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<BenchVertex> soup = torusKnotSoup(segments, sides);
+    size_t triangle_count = soup.size() / 3;
+
+    if (shuffle) {
+        std::vector<uint32_t> order(triangle_count);
+
+        for (uint32_t t = 0; t < triangle_count; ++t) {
+            order[t] = t;
+        }
+
+        std::shuffle(order.begin(), order.end(), std::mt19937(42));
+        std::vector<BenchVertex> shuffled;
+        shuffled.reserve(soup.size());
+
+        for (uint32_t t : order) {
+            shuffled.insert(shuffled.end(), &soup[t * 3], &soup[t * 3] + 3);
+        }
+
+        soup.swap(shuffled);
+    }
+
+    std::printf("torus knot: %zu triangles, %zu soup vertices of %zu bytes%s\n", triangle_count, soup.size(),
+        sizeof(BenchVertex), shuffle ? ", shuffled" : "");
+
+    auto report = [&](const char *step, double ms, const uint32_t *indices, size_t vertex_count, const BenchVertex *vertices) {
+        VertexCacheStats cache = analyzeVertexCache(indices, triangle_count * 3, vertex_count, cache_size);
+        OverdrawStats overdraw = analyzeOverdraw(indices, triangle_count * 3, vertices[0].position, vertex_count, sizeof(BenchVertex));
+
+        std::printf("%-14s %9.2f ms %8.1f M tris/s   ACMR %5.3f  ATVR %5.3f  overdraw %5.3f\n", step, ms,
+            ms > 0.0 ? triangle_count / ms / 1e3 : 0.0, cache.acmr, cache.atvr, overdraw.overdraw);
+    };
+
+    // Weld.
+    auto start = std::chrono::steady_clock::now();
+    std::vector<uint32_t> remap(soup.size());
+    size_t vertex_count = weldVertices(soup.data(), soup.size(), sizeof(BenchVertex), remap.data());
+    std::vector<BenchVertex> vertices(vertex_count);
+    remapVertices(vertices.data(), soup.data(), soup.size(), sizeof(BenchVertex), remap.data());
+    std::vector<uint32_t> indices(soup.size());
+    remapIndices(indices.data(), nullptr, soup.size(), remap.data());
+    double weld_ms = millisecondsSince(start);
+
+    std::printf("weld: %zu unique vertices in %.2f ms, %.1f M vertices/s\n", vertex_count, weld_ms,
+        soup.size() / weld_ms / 1e3);
+    report("welded", 0.0, indices.data(), vertex_count, vertices.data());
+
+    // Both cache orders from the welded input.
+    std::vector<uint32_t> forsyth_indices = indices;
+    start = std::chrono::steady_clock::now();
+    optimizeVertexCache(forsyth_indices.data(), forsyth_indices.size(), vertex_count, VertexCacheAlgorithmForsyth);
+    report("forsyth", millisecondsSince(start), forsyth_indices.data(), vertex_count, vertices.data());
+
+    start = std::chrono::steady_clock::now();
+    optimizeVertexCache(indices.data(), indices.size(), vertex_count, VertexCacheAlgorithmTipsify, cache_size);
+    report("tipsify", millisecondsSince(start), indices.data(), vertex_count, vertices.data());
+
+    start = std::chrono::steady_clock::now();
+    optimizeOverdraw(indices.data(), indices.size(), vertices[0].position, vertex_count, sizeof(BenchVertex), 1.05f, cache_size);
+    report("overdraw", millisecondsSince(start), indices.data(), vertex_count, vertices.data());
+
+    // Fetch order; the cache stats cannot change.
+    std::vector<BenchVertex> fetched(vertex_count);
+    start = std::chrono::steady_clock::now();
+    size_t used = optimizeVertexFetch(fetched.data(), indices.data(), indices.size(), vertices.data(), vertex_count, sizeof(BenchVertex));
+    report("vertex fetch", millisecondsSince(start), indices.data(), used, fetched.data());
+
+    std::printf("index buffer: %zu bytes with %s indices (%zu with 32-bit)\n",
+        indices.size() * (fitsIndex16(used) ? 2 : 4), fitsIndex16(used) ? "16-bit" : "32-bit", indices.size() * 4);
+
+    if (validate) {
+        bool same = triangleHashes(soup.data(), nullptr, soup.size()) == triangleHashes(fetched.data(), indices.data(), indices.size()) &&
+                    triangleHashes(soup.data(), nullptr, soup.size()) == triangleHashes(vertices.data(), forsyth_indices.data(), forsyth_indices.size());
+        std::printf("validation: %s\n", same ? "every triangle preserved" : "triangles differ from the input");
+
+        if (!same) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
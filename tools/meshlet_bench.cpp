@@ -0,0 +1,263 @@
+// Splits a procedural torus knot, in vertex cache order, into meshlets and
+// culls them from cameras circling it. Prints how long building and bounds
+// take, how full the meshlets are, and meshlets/ms for each culling kernel
+// with how many fall to the frustum and to the backface cones. Checks that
+// every triangle lands in exactly one meshlet within the limits, that the
+// spheres hold their vertices, that a cone-culled meshlet has no triangle
+// facing the camera, and that every kernel gives the same list.
+
+#include "geometry.h"
+#include "meshlets.h"
+#include "mesh_optimizer.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+void
+usage(const char *program) {
+    std::fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --segments N     segments along the knot (default 2048)\n"
+        "  --sides N        segments around the tube (default 128)\n"
+        "  --views N        camera positions to cull from (default 64)\n"
+        "  --no-validate    skip the checks\n",
+        program);
+}
+
+// Perspective with Metal's 0..1 depth from `eye` towards the origin, with z
+// up.
+void
+viewProjection(const float eye[3], float out[16]) {
+    const float origin[3] = { 0.0f, 0.0f, 0.0f }, up[3] = { 0.0f, 0.0f, 1.0f };
+    float view[16], projection[16];
+    lookAt(eye, origin, up, view);
+    perspective(50.0f * float(M_PI) / 180.0f, 1.0f, 0.1f, 100.0f, projection);
+    multiplyMatrices(projection, view, out);
+}
+
+// Close enough that the knot overflows the view, so both tests matter.
+void
+orbitEye(unsigned view, unsigned views, float eye[3]) {
+    float angle = 2.0f * float(M_PI) * view / views;
+    eye[0] = 4.5f * std::cos(angle);
+    eye[1] = 4.5f * std::sin(angle);
+    eye[2] = 2.0f * std::sin(3.0f * angle);
+}
+
+double
+millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+}
+
+int
+main(int argc, char **argv) {
+    unsigned segments = 2048, sides = 128, views = 64;
+    bool validate = true;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--segments") == 0 && i + 1 < argc) {
+            segments = std::max(3u, (unsigned)std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--sides") == 0 && i + 1 < argc) {
+            sides = std::max(3u, (unsigned)std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--views") == 0 && i + 1 < argc) {
+            views = std::max(1u, (unsigned)std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--no-validate") == 0) {
+            validate = false;
+        }
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<float> positions, normals;
+    std::vector<uint32_t> indices;
+    torusKnot(segments, sides, positions, normals, indices);
+    size_t vertex_count = positions.size() / 3, triangle_count = indices.size() / 3;
+    optimizeVertexCache(indices.data(), indices.size(), vertex_count);
+
+    std::printf("torus knot: %zu vertices, %zu triangles\n", vertex_count, triangle_count);
+
+    auto start = std::chrono::steady_clock::now();
+    MeshletMesh mesh;
+    buildMeshlets(mesh, indices.data(), indices.size(), positions.data(), vertex_count, sizeof(float) * 3);
+    double build_ms = millisecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    CullBounds spheres;
+    MeshletCones cones;
+    computeMeshletBounds(mesh, positions.data(), sizeof(float) * 3, spheres, cones);
+    double bounds_ms = millisecondsSince(start);
+
+    size_t with_cone = 0;
+    double cone_degrees = 0.0;
+
+    for (size_t m = 0; m < mesh.meshlets.size(); ++m) {
+        if (cones.axis[0][m] != 0.0f || cones.axis[1][m] != 0.0f || cones.axis[2][m] != 0.0f) {
+            ++with_cone;
+            cone_degrees += std::asin(std::min(cones.cutoff[m], 1.0f)) * 180.0 / M_PI;
+        }
+    }
+
+    size_t meshlet_count = mesh.meshlets.size();
+    std::printf("build: %zu meshlets in %.2f ms, %.1f M tris/s; bounds in %.2f ms\n", meshlet_count, build_ms,
+        triangle_count / build_ms / 1e3, bounds_ms);
+    std::printf("fill: %.1f of %d vertices, %.1f of %d triangles; %zu vertex references for %zu vertices\n",
+        (double)mesh.vertices.size() / meshlet_count, MESHLET_MAX_VERTICES, (double)triangle_count / meshlet_count,
+        MESHLET_MAX_TRIANGLES, mesh.vertices.size(), vertex_count);
+    std::printf("cones: %zu of %zu meshlets, mean half-angle %.1f degrees\n", with_cone, meshlet_count,
+        with_cone ? cone_degrees / with_cone : 0.0);
+
+    ThreadPool pool;
+    std::vector<uint32_t> visible;
+    std::vector<std::vector<uint32_t>> results[3];
+    const char *names[3] = { "scalar", "simd", "simd pooled" };
+
+    for (int run = 0; run < 3; ++run) {
+        size_t total = 0;
+        start = std::chrono::steady_clock::now();
+
+        for (unsigned view = 0; view < views; ++view) {
+            float eye[3], vp[16];
+            orbitEye(view, views, eye);
+            viewProjection(eye, vp);
+            total += cullMeshlets(spheres, cones, frustumFromMatrix(vp), eye, visible, run == 2 ? &pool : nullptr,
+                run == 0 ? SimdKernelScalar : SimdKernelVector);
+
+            if (validate) {
+                results[run].push_back(visible);
+            }
+        }
+
+        double ms = millisecondsSince(start);
+        std::printf("cull %-12s %8.3f ms/view %8.0f meshlets/ms, %.1f%% visible\n", names[run], ms / views,
+            meshlet_count * views / ms, 100.0 * total / (meshlet_count * views));
+    }
+
+    // What each test removes on its own.
+    size_t frustum_visible = 0;
+
+    for (unsigned view = 0; view < views; ++view) {
+        float eye[3], vp[16];
+        orbitEye(view, views, eye);
+        viewProjection(eye, vp);
+        frustum_visible += cullFrustum(spheres, frustumFromMatrix(vp), CullShapeSphere, visible);
+    }
+
+    std::printf("frustum alone keeps %.1f%%\n", 100.0 * frustum_visible / (meshlet_count * views));
+
+    if (!validate) {
+        return 0;
+    }
+
+    // Every triangle once, within the limits.
+    std::vector<std::array<uint32_t, 3>> input, output;
+    bool limits = true;
+
+    for (size_t t = 0; t < triangle_count; ++t) {
+        input.push_back({ indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2] });
+    }
+
+    for (const Meshlet& meshlet : mesh.meshlets) {
+        limits &= meshlet.vertex_count <= MESHLET_MAX_VERTICES && meshlet.triangle_count <= MESHLET_MAX_TRIANGLES &&
+                  meshlet.triangle_count > 0;
+
+        for (uint32_t t = 0; t < meshlet.triangle_count; ++t) {
+            std::array<uint32_t, 3> triangle;
+
+            for (int k = 0; k < 3; ++k) {
+                uint8_t local = mesh.triangles[meshlet.triangle_offset + t * 3 + k];
+                limits &= local < meshlet.vertex_count;
+                triangle[k] = mesh.vertices[meshlet.vertex_offset + std::min<uint32_t>(local, meshlet.vertex_count - 1)];
+            }
+
+            output.push_back(triangle);
+        }
+    }
+
+    std::sort(input.begin(), input.end());
+    std::sort(output.begin(), output.end());
+    bool same_triangles = limits && input == output;
+
+    // Spheres hold their vertices.
+    size_t outside_sphere = 0;
+
+    for (size_t m = 0; m < meshlet_count; ++m) {
+        const Meshlet& meshlet = mesh.meshlets[m];
+
+        for (uint32_t v = 0; v < meshlet.vertex_count; ++v) {
+            const float *p = &positions[mesh.vertices[meshlet.vertex_offset + v] * 3];
+            float d = std::hypot(p[0] - spheres.center[0][m], std::hypot(p[1] - spheres.center[1][m], p[2] - spheres.center[2][m]));
+            outside_sphere += d > spheres.radius[m] * (1.0f + 1e-5f) ? 1 : 0;
+        }
+    }
+
+    // Cone-culled meshlets show only backs, in double precision.
+    size_t facing = 0;
+
+    for (unsigned view = 0; view < views; ++view) {
+        float eye[3], vp[16];
+        orbitEye(view, views, eye);
+        viewProjection(eye, vp);
+        cullFrustum(spheres, frustumFromMatrix(vp), CullShapeSphere, visible);
+
+        std::vector<uint8_t> kept(meshlet_count, 0);
+
+        for (uint32_t m : results[0][view]) {
+            kept[m] = 1;
+        }
+
+        for (uint32_t m : visible) {
+            if (kept[m]) {
+                continue;
+            }
+
+            const Meshlet& meshlet = mesh.meshlets[m];
+
+            for (uint32_t t = 0; t < meshlet.triangle_count; ++t) {
+                const float *p[3];
+
+                for (int k = 0; k < 3; ++k) {
+                    p[k] = &positions[mesh.vertices[meshlet.vertex_offset + mesh.triangles[meshlet.triangle_offset + t * 3 + k]] * 3];
+                }
+
+                double u[3], w[3], n[3];
+
+                for (int c = 0; c < 3; ++c) {
+                    u[c] = (double)p[1][c] - p[0][c];
+                    w[c] = (double)p[2][c] - p[0][c];
+                }
+
+                n[0] = u[1] * w[2] - u[2] * w[1];
+                n[1] = u[2] * w[0] - u[0] * w[2];
+                n[2] = u[0] * w[1] - u[1] * w[0];
+
+                double toward_eye = n[0] * (eye[0] - p[0][0]) + n[1] * (eye[1] - p[0][1]) + n[2] * (eye[2] - p[0][2]);
+                double scale = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                facing += toward_eye > 1e-5 * scale ? 1 : 0;
+            }
+        }
+    }
+
+    bool kernels_agree = results[0] == results[1] && results[0] == results[2];
+
+    std::printf("validation: %s; %zu vertices outside their sphere; %zu front faces cone-culled; kernels %s\n",
+        same_triangles ? "every triangle in one meshlet" : "triangles lost or limits broken", outside_sphere, facing,
+        kernels_agree ? "agree" : "differ");
+
+    return same_triangles && outside_sphere == 0 && facing == 0 && kernels_agree ? 0 : 1;
+}
@@ -0,0 +1,165 @@
+// Measures the CPU particle simulation in particles per second: the scalar
+// reference, the four-wide vector step on one thread, and the vector step
+// split across the thread pool, which is what `--particles-cpu` runs. Each
+// path steps its own copy of the same initial state; the vector and pooled
+// results are then compared with the scalar one in units in the last place.
+
+#include "particle_simulation.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+namespace {
+
+void
+usage(const char *program) {
+    std::fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --count N        particles (default 1048576)\n"
+        "  --steps N        simulation steps per path (default 60)\n"
+        "  --tolerance N    largest difference from the scalar path, in ulp (default 4)\n"
+        "  --no-validate    skip the comparison\n",
+        program);
+}
+
+// One copy of the simulation state.
+struct ParticleState {
+    std::vector<float> arrays[5];
+
+    explicit ParticleState(size_t count) {
+        for (auto& array : arrays) {
+            array.resize(count);
+        }
+    }
+
+    ParticleArrays view() {
+        return { arrays[0].data(), arrays[1].data(), arrays[2].data(), arrays[3].data(), arrays[4].data() };
+    }
+};
+
+// The same setup as ParticleRenderer, so respawns and bounces both happen.
+ParticleSimParams
+defaultParams(uint32_t count) {
+    ParticleSimParams params = {};
+    params.dt = 1.0f / 60.0f;
+    params.gravityY = -300.0f;
+    params.damping = 1.0f - 0.2f * params.dt;
+    params.boundsX = 320.0f;
+    params.boundsY = 240.0f;
+    params.restitution = 0.6f;
+    params.lifetime = 4.0f;
+    params.count = count;
+    params.emitterCount = 2;
+    return params;
+}
+
+// Runs `steps` steps from `params.frame` and returns particles per second.
+double
+run(ParticleState& state, ParticleSimParams params, uint32_t steps,
+    const std::function<void(const ParticleArrays&, const ParticleSimParams&)>& step) {
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t i = 0; i < steps; ++i) {
+        step(state.view(), params);
+        ++params.frame;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return (double)params.count * steps / seconds;
+}
+
+// Prints the largest difference per array and returns the largest overall.
+uint32_t
+compare(const char *path, const ParticleState& expected, const ParticleState& actual) {
+    const char *names[5] = { "position.x", "position.y", "velocity.x", "velocity.y", "age" };
+    uint32_t result = 0;
+
+    std::printf("%-8s", path);
+
+    for (int i = 0; i < 5; ++i) {
+        uint32_t ulp = maxUlpDifference(expected.arrays[i].data(), actual.arrays[i].data(), expected.arrays[i].size());
+        std::printf(" %s %u ulp%s", names[i], ulp, i < 4 ? "," : "\n");
+        result = std::max(result, ulp);
+    }
+
+    return result;
+}
+
+}
+
+int
+main(int argc, char **argv) {
+    // Compilers that contract the scalar path's multiply-adds into FMAs
+    // round it slightly differently from the vector path.
+    uint32_t count = 1 << 20, steps = 60, tolerance = 4;
+    bool validate = true;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+            count = std::max(1u, (uint32_t)std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--steps") == 0 && i + 1 < argc) {
+            steps = std::max(1u, (uint32_t)std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+            tolerance = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--no-validate") == 0) {
+            validate = false;
+        }
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    ParticleSimParams params = defaultParams(count);
+    const ParticleEmitter emitters[2] = {
+        { -150.0f, -200.0f,  60.0f, 400.0f, 200.0f },
+        {  150.0f, -200.0f, -60.0f, 400.0f, 200.0f },
+    };
+
+    ParticleState scalar(count);
+    initializeParticles(scalar.view(), params, emitters);
+    ParticleState vector = scalar, pooled = scalar;
+
+    ThreadPool pool;
+
+    double scalar_rate = run(scalar, params, steps, [&](const ParticleArrays& particles, const ParticleSimParams& p) {
+        simulateParticlesScalar(particles, p, emitters, 0, p.count);
+    });
+
+    double vector_rate = run(vector, params, steps, [&](const ParticleArrays& particles, const ParticleSimParams& p) {
+        simulateParticlesVector(particles, p, emitters, 0, p.count);
+    });
+
+    double pooled_rate = run(pooled, params, steps, [&](const ParticleArrays& particles, const ParticleSimParams& p) {
+        simulateParticles(particles, p, emitters, pool);
+    });
+
+    std::printf("%u particles, %u steps\n", count, steps);
+    std::printf("scalar   1 thread  %8.1f M particles/s\n", scalar_rate / 1e6);
+    std::printf("vector   1 thread  %8.1f M particles/s %6.1fx\n", vector_rate / 1e6, vector_rate / scalar_rate);
+    std::printf("pooled %2u thread%s %8.1f M particles/s %6.1fx\n", pool.threadCount(),
+        pool.threadCount() == 1 ? " " : "s", pooled_rate / 1e6, pooled_rate / scalar_rate);
+
+    if (!validate) {
+        return 0;
+    }
+
+    uint32_t vector_ulp = compare("vector", scalar, vector);
+    uint32_t pooled_ulp = compare("pooled", scalar, pooled);
+    uint32_t ulp = std::max(vector_ulp, pooled_ulp);
+    bool ok = ulp <= tolerance;
+
+    std::printf("validation: vector and pooled paths %s the scalar path (%u ulp, tolerance %u)\n",
+        ok ? "match" : "DIFFER from", ulp, tolerance);
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,244 @@
+// Runs the occlusion query bookkeeping against a simulated GPU: a row of
+// objects behind a sliding occluder, seen through a window that pans
+// across them, with query results that come back a fixed number of frames
+// late and out of order. Prints the bookkeeping rate, how many draws the
+// queries save and how many draws of hidden objects they still let
+// through. Checks, with plenty of slots and with too few, that no slot is
+// handed out twice, that every candidate is drawn, queried or waiting on a
+// query, that a visible object is never missed for longer than the latency
+// allows, and that every slot comes back once the results are in.
+
+#include "occlusion_queries.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+void
+usage(const char *program) {
+    std::fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --objects N      objects in the row (default 100000)\n"
+        "  --frames N       frames to run (default 600)\n"
+        "  --latency N      frames until results come back (default 2)\n"
+        "  --slots N        query slots (default 65536)\n"
+        "  --no-validate    skip the checks\n",
+        program);
+}
+
+double
+millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Objects sit at i / count along [0, 1). An occluder covering a third of the
+// row slides back and forth, and the candidates are those inside a window
+// panning the other way.
+struct Row {
+    size_t count;
+
+    double occluderCenter(uint64_t frame) const {
+        return 0.5 + 0.3 * std::sin(0.05 * frame);
+    }
+
+    bool isVisible(uint32_t object, uint64_t frame) const {
+        return std::fabs(double(object) / count - occluderCenter(frame)) > 1.0 / 6.0;
+    }
+
+    void candidates(uint64_t frame, std::vector<uint32_t>& out) const {
+        double begin = 0.15 + 0.15 * std::cos(0.013 * frame);
+        out.clear();
+
+        for (size_t i = size_t(begin * count); i < size_t((begin + 0.7) * count) && i < count; ++i) {
+            out.push_back(uint32_t(i));
+        }
+    }
+};
+
+struct RunResult {
+    double ms = 0.0;
+    size_t candidates = 0, drawn = 0, boxes = 0, hidden_drawn = 0, missed = 0;
+    uint32_t longest_miss = 0;
+    uint32_t peak_slots = 0;
+    bool slots_unique = true, covered = true, drained = true;
+};
+
+RunResult
+run(const Row& row, uint64_t frames, uint32_t latency, uint32_t slot_count) {
+    RunResult result;
+    OcclusionQueries queries(row.count, slot_count);
+
+    // The simulated GPU writes each frame's results as it "executes" the
+    // frame; they are read `latency` frames later, in shuffled order.
+    std::vector<uint64_t> results(slot_count, 0);
+    std::vector<uint8_t> slot_taken(slot_count, 0);
+    std::vector<uint32_t> candidates, miss_run(row.count, 0);
+    std::vector<uint8_t> drawn(row.count), listed(row.count);
+
+    // Frames the GPU has finished, with the slots their queries hold.
+    std::vector<std::pair<uint64_t, std::vector<uint32_t>>> completed;
+    std::mt19937 rng(11);
+
+    for (uint64_t frame = 0; frame < frames + latency; ++frame) {
+        std::shuffle(completed.begin(), completed.end(), rng);
+
+        auto start = std::chrono::steady_clock::now();
+
+        for (auto done = completed.begin(); done != completed.end();) {
+            if (done->first + latency <= frame) {
+                queries.resolve(done->first, results.data());
+
+                for (uint32_t slot : done->second) {
+                    slot_taken[slot] = 0;
+                }
+
+                done = completed.erase(done);
+            }
+            else {
+                ++done;
+            }
+        }
+
+        // The last `latency` frames only drain the results.
+        if (frame >= frames) {
+            result.ms += millisecondsSince(start);
+            continue;
+        }
+
+        row.candidates(frame, candidates);
+        queries.beginFrame(frame, candidates.data(), candidates.size());
+        result.ms += millisecondsSince(start);
+
+        result.candidates += candidates.size();
+        result.drawn += queries.draws().size() + queries.drawQueries().size();
+        result.boxes += queries.boxQueries().size();
+        result.peak_slots = std::max(result.peak_slots, queries.slotsInUse());
+
+        // Execute the frame. A slot must not be handed out again before the
+        // frame that holds it is resolved.
+        std::vector<uint32_t> slots;
+
+        for (const auto *list : { &queries.drawQueries(), &queries.boxQueries() }) {
+            for (const OcclusionQuery& query : *list) {
+                results[query.slot] = row.isVisible(query.object, frame) ? 1 : 0;
+                result.slots_unique = result.slots_unique && !slot_taken[query.slot];
+                slot_taken[query.slot] = 1;
+                slots.push_back(query.slot);
+            }
+        }
+
+        completed.emplace_back(frame, std::move(slots));
+
+        // Each candidate is drawn, queried or waiting on a query, once.
+        std::fill(drawn.begin(), drawn.end(), 0);
+        std::fill(listed.begin(), listed.end(), 0);
+
+        for (uint32_t object : queries.draws()) {
+            drawn[object] = 1;
+            ++listed[object];
+        }
+
+        for (const OcclusionQuery& query : queries.drawQueries()) {
+            drawn[query.object] = 1;
+            ++listed[query.object];
+        }
+
+        for (const OcclusionQuery& query : queries.boxQueries()) {
+            ++listed[query.object];
+        }
+
+        for (uint32_t object : candidates) {
+            result.covered = result.covered &&
+                (listed[object] == 1 || (listed[object] == 0 && !queries.isVisible(object)));
+
+            bool visible = row.isVisible(object, frame);
+
+            if (!drawn[object] && !visible) {
+                miss_run[object] = 0;
+            }
+            else if (!drawn[object]) {
+                ++result.missed;
+                result.longest_miss = std::max(result.longest_miss, ++miss_run[object]);
+            }
+            else {
+                miss_run[object] = 0;
+                result.hidden_drawn += !visible;
+            }
+        }
+    }
+
+    result.drained = queries.slotsInUse() == 0 && queries.pendingFrames() == 0;
+    return result;
+}
+
+}
+
+int
+main(int argc, char **argv) {
+    size_t object_count = 100000;
+    unsigned frames = 600, latency = 2, slot_count = 65536;
+    bool validate = true;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--objects") == 0 && i + 1 < argc) {
+            object_count = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = std::max(1u, (unsigned)std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--latency") == 0 && i + 1 < argc) {
+            latency = std::max(1u, (unsigned)std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--slots") == 0 && i + 1 < argc) {
+            slot_count = std::max(1u, (unsigned)std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--no-validate") == 0) {
+            validate = false;
+        }
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    Row row { object_count };
+    std::printf("%zu objects, %u frames, results %u frames late\n", object_count, frames, latency);
+
+    // With the slots asked for, then with a pool far too small, which has to
+    // fall back on drawing.
+    uint32_t slot_counts[2] = { slot_count, std::max(1u, slot_count / 256) };
+    bool passed = true;
+
+    for (uint32_t slots : slot_counts) {
+        RunResult result = run(row, frames, latency, slots);
+        std::printf("%6u slots: %8.0f objects/ms, %.1f%% of candidates drawn, %.1f%% boxed, "
+            "%.1f%% of draws hidden, peak %u slots\n",
+            slots, result.candidates / result.ms, 100.0 * result.drawn / result.candidates,
+            100.0 * result.boxes / result.candidates, 100.0 * result.hidden_drawn / std::max<size_t>(result.drawn, 1),
+            result.peak_slots);
+
+        if (!validate) {
+            continue;
+        }
+
+        // Hidden by a stale result until the query issued after it
+        // resolves: at most 2 * latency - 1 frames.
+        bool bounded = result.longest_miss <= 2 * latency - 1;
+
+        std::printf("validation: slots %s; candidates %s; %zu visible draws missed, longest %u frames (%s); %s\n",
+            result.slots_unique ? "unique" : "REUSED", result.covered ? "covered" : "LOST",
+            result.missed, result.longest_miss, bounded ? "within latency" : "TOO LONG",
+            result.drained ? "every slot returned" : "SLOTS LEAKED");
+
+        passed = passed && result.slots_unique && result.covered && bounded && result.drained;
+    }
+
+    return passed ? 0 : 1;
+}
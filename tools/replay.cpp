@@ -0,0 +1,240 @@
+// Replays a command log recorded with `sdl-metal --record` through the
+// software reference renderer, and reports decode and execution throughput.
+// With --visibility-buffer it also reports overdraw, and --synthetic writes a
+// log of overlapping triangles to measure it on.
+
+#include "command_log.h"
+#include "image_io.h"
+#include "mapped_file.h"
+#include "reference_renderer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+void
+usage(const char *program) {
+    std::fprintf(stderr,
+        "usage: %s [options] LOG\n"
+        "  --decode-only        decode without rendering\n"
+        "  --loops N            replay the whole log N times (default 1)\n"
+        "  --size WxH           framebuffer size (default 640x480)\n"
+        "  --dump FRAME FILE    write frame number FRAME of the first loop as PPM\n"
+        "  --visibility-buffer  rasterize IDs first, then shade each pixel once\n"
+        "  --shading-work N     extra arithmetic per shaded fragment (default 0)\n"
+        "  --samples N          1, or 4 for MSAA with Metal's standard pattern\n"
+        "  --synthetic N        first write LOG: 60 frames of N random triangles\n",
+        program);
+}
+
+// Counts commands without doing anything with them.
+class NullSink : public CommandSink {
+public:
+
+    void drawPrimitives(uint32_t, uint64_t, uint64_t, uint64_t) override {
+        ++draws;
+    }
+
+    uint64_t draws = 0;
+};
+
+// Random triangles 1/8 to 1/2 of the viewport across, so they overlap
+// heavily, in the same pixel space and layout as the app's triangle.
+bool
+writeSyntheticLog(const char *path, unsigned triangles, unsigned width, unsigned height) {
+    CommandLogWriter writer;
+
+    if (!writer.open(path)) {
+        return false;
+    }
+
+    struct Vertex {
+        float position[2];
+        float padding[2];
+        float color[4];
+    };
+
+    uint32_t state = 12345;
+    auto random = [&state]() {
+        state = state * 1664525u + 1013904223u;
+        return (float)(state >> 8) * (1.0f / 16777216.0f);
+    };
+
+    std::vector<Vertex> vertices((size_t)triangles * 3);
+
+    for (unsigned t = 0; t < triangles; ++t) {
+        float center_x = (random() - 0.5f) * width, center_y = (random() - 0.5f) * height;
+        float size = (0.125f + 0.375f * random()) * (float)std::min(width, height);
+        float color[4] = { random(), random(), random(), 1.0f };
+
+        for (unsigned k = 0; k < 3; ++k) {
+            Vertex& vertex = vertices[t * 3 + k];
+            vertex.position[0] = center_x + (random() - 0.5f) * size;
+            vertex.position[1] = center_y + (random() - 0.5f) * size;
+            std::memcpy(vertex.color, color, sizeof(color));
+        }
+    }
+
+    uint32_t viewport_size[2] = { width, height };
+    int pipeline = 0;
+
+    for (uint64_t frame = 0; frame < 60; ++frame) {
+        writer.beginFrame(frame);
+        writer.setViewport(LoggedViewport { 0.0f, 0.0f, (float)width, (float)height, 0.0f, 1.0f });
+        writer.setRenderPipelineState(&pipeline, "triangle");
+        writer.setVertexBytes(vertices.data(), vertices.size() * sizeof(Vertex), 0);
+        writer.setVertexBytes(viewport_size, sizeof(viewport_size), 1);
+        writer.drawPrimitives(3, 0, vertices.size(), 1);
+        writer.endFrame();
+    }
+
+    writer.close();
+    return true;
+}
+
+}
+
+int
+main(int argc, char **argv) {
+    bool decode_only = false;
+    bool visibility_buffer = false;
+    unsigned shading_work = 0;
+    unsigned synthetic_triangles = 0;
+    unsigned sample_count = 1;
+    unsigned loops = 1;
+    unsigned width = 640, height = 480;
+    long dump_frame = -1;
+    const char *dump_path = nullptr;
+    const char *log_path = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--decode-only") == 0) {
+            decode_only = true;
+        }
+        else if (std::strcmp(argv[i], "--loops") == 0 && i + 1 < argc) {
+            loops = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            if (std::sscanf(argv[++i], "%ux%u", &width, &height) != 2) {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--dump") == 0 && i + 2 < argc) {
+            dump_frame = std::strtol(argv[++i], nullptr, 10);
+            dump_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--visibility-buffer") == 0) {
+            visibility_buffer = true;
+        }
+        else if (std::strcmp(argv[i], "--shading-work") == 0 && i + 1 < argc) {
+            shading_work = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+            sample_count = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+
+            if (sample_count != 1 && sample_count != 4) {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--synthetic") == 0 && i + 1 < argc) {
+            synthetic_triangles = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (argv[i][0] != '-' && !log_path) {
+            log_path = argv[i];
+        }
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!log_path) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (visibility_buffer && sample_count > 1) {
+        std::fprintf(stderr, "--visibility-buffer is single-sampled; --samples ignored\n");
+        sample_count = 1;
+    }
+
+    if (synthetic_triangles > 0 && !writeSyntheticLog(log_path, synthetic_triangles, width, height)) {
+        std::fprintf(stderr, "Failed to write %s\n", log_path);
+        return 1;
+    }
+
+    MappedFile file;
+
+    if (!file.open(log_path)) {
+        std::fprintf(stderr, "Failed to map %s\n", log_path);
+        return 1;
+    }
+
+    CommandLogReader reader(file.data(), file.size());
+
+    if (!reader.valid()) {
+        std::fprintf(stderr, "%s is not a command log\n", log_path);
+        return 1;
+    }
+
+    NullSink null_sink;
+    ReferenceRenderer renderer(width, height, visibility_buffer ? ReferenceShadingVisibilityBuffer : ReferenceShadingForward, sample_count);
+    renderer.setShadingWork(shading_work);
+
+    CommandSink& sink = decode_only ? (CommandSink&)null_sink : (CommandSink&)renderer;
+
+    uint64_t frames = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for (unsigned loop = 0; loop < loops; ++loop) {
+        reader.rewind();
+
+        for (long frame = 0; reader.replayFrame(sink); ++frame, ++frames) {
+            if (loop == 0 && frame == dump_frame && !decode_only) {
+                if (!writePPM(dump_path, renderer.pixels().data(), width, height)) {
+                    std::fprintf(stderr, "Failed to write %s\n", dump_path);
+                }
+            }
+        }
+
+        if (reader.failed()) {
+            std::fprintf(stderr, "Malformed log at offset %zu\n", reader.offset());
+            return 1;
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double megabytes = (double)(file.size() * loops) / (1024.0 * 1024.0);
+
+    std::printf("%llu frames, %.3f s: %.1f frames/s, %.1f MB/s\n",
+        (unsigned long long)frames, seconds, frames / seconds, megabytes / seconds);
+
+    if (!decode_only) {
+        std::printf("%llu triangles, %llu fragments rasterized, %llu shaded, %llu draws skipped\n",
+            (unsigned long long)renderer.trianglesDrawn(),
+            (unsigned long long)renderer.fragmentsRasterized(),
+            (unsigned long long)renderer.fragmentsShaded(),
+            (unsigned long long)renderer.drawsSkipped());
+
+        if (sample_count > 1) {
+            std::printf("%llu samples covered, %.2f per rasterized fragment\n",
+                (unsigned long long)renderer.samplesCovered(),
+                renderer.fragmentsRasterized() > 0 ? (double)renderer.samplesCovered() / renderer.fragmentsRasterized() : 0.0);
+        }
+
+        if (visibility_buffer && renderer.fragmentsShaded() > 0) {
+            std::printf("overdraw %.2fx: shaded %.1f%% of rasterized fragments\n",
+                (double)renderer.fragmentsRasterized() / renderer.fragmentsShaded(),
+                100.0 * renderer.fragmentsShaded() / renderer.fragmentsRasterized());
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,274 @@
+// Measures scene graph world-matrix propagation: full updates and
+// incremental updates with a fraction of nodes animated each frame, on one
+// thread and on the pool, in nodes per second. Checks the result against a
+// straightforward per-node composition.
+
+#include "scene_graph.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+void
+usage(const char *program) {
+    std::fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --nodes N        nodes in the hierarchy (default 1048576)\n"
+        "  --branching N    children per node (default 4)\n"
+        "  --dirty F        fraction of nodes animated per frame (default 0.01)\n"
+        "  --frames N       frames per run (default 20)\n"
+        "  --no-validate    skip the reference check\n",
+        program);
+}
+
+SceneTransform
+randomTransform(std::mt19937& random) {
+    std::uniform_real_distribution<float> position(-10.0f, 10.0f), unit(-1.0f, 1.0f), scale(0.5f, 1.5f);
+    SceneTransform transform;
+
+    for (float& p : transform.position) {
+        p = position(random);
+    }
+
+    float length = 0.0f;
+
+    for (float& q : transform.rotation) {
+        q = unit(random);
+        length += q * q;
+    }
+
+    for (float& q : transform.rotation) {
+        q /= std::sqrt(length);
+    }
+
+    for (float& s : transform.scale) {
+        s = scale(random);
+    }
+
+    return transform;
+}
+
+// Column-major local matrix, the textbook way.
+void
+localMatrix(const SceneTransform& t, float m[16]) {
+    float x = t.rotation[0], y = t.rotation[1], z = t.rotation[2], w = t.rotation[3];
+    float r[9] = {
+        1 - 2 * (y * y + z * z), 2 * (x * y + w * z), 2 * (x * z - w * y),
+        2 * (x * y - w * z), 1 - 2 * (x * x + z * z), 2 * (y * z + w * x),
+        2 * (x * z + w * y), 2 * (y * z - w * x), 1 - 2 * (x * x + y * y),
+    };
+
+    for (int c = 0; c < 3; ++c) {
+        for (int row = 0; row < 3; ++row) {
+            m[c * 4 + row] = r[c * 3 + row] * t.scale[c];
+        }
+
+        m[c * 4 + 3] = 0.0f;
+    }
+
+    m[12] = t.position[0];
+    m[13] = t.position[1];
+    m[14] = t.position[2];
+    m[15] = 1.0f;
+}
+
+// Relative difference of the worst element against a per-node composition
+// in creation order, where parents always come first.
+double
+compareWithReference(const SceneGraph& scene, const std::vector<SceneNode>& parents) {
+    std::vector<float> worlds(parents.size() * 16);
+    double worst = 0.0;
+
+    for (SceneNode node = 0; node < parents.size(); ++node) {
+        float local[16];
+        localMatrix(scene.local(node), local);
+        float *world = &worlds[node * 16];
+
+        if (parents[node] == scene_no_parent) {
+            std::memcpy(world, local, sizeof(local));
+        }
+        else {
+            const float *parent = &worlds[parents[node] * 16];
+
+            for (int c = 0; c < 4; ++c) {
+                for (int row = 0; row < 4; ++row) {
+                    float sum = 0.0f;
+
+                    for (int k = 0; k < 4; ++k) {
+                        sum += parent[k * 4 + row] * local[c * 4 + k];
+                    }
+
+                    world[c * 4 + row] = sum;
+                }
+            }
+        }
+
+        const float *actual = reinterpret_cast<const float *>(&scene.world(node));
+
+        for (int i = 0; i < 16; ++i) {
+            double difference = std::fabs((double)actual[i] - world[i]) / std::max(1.0, std::fabs((double)world[i]));
+            worst = std::max(worst, difference);
+        }
+    }
+
+    return worst;
+}
+
+struct RunResult {
+    double full_nodes_per_second;
+    double incremental_nodes_per_second;
+    double updated_per_frame;
+};
+
+RunResult
+run(SceneGraph& scene, const std::vector<SceneNode>& animated, unsigned frames, ThreadPool *pool) {
+    RunResult result;
+
+    auto start = std::chrono::steady_clock::now();
+    size_t updated = 0;
+
+    for (unsigned frame = 0; frame < frames; ++frame) {
+        scene.markAllDirty();
+        updated += scene.update(pool);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.full_nodes_per_second = updated / seconds;
+
+    start = std::chrono::steady_clock::now();
+    updated = 0;
+
+    for (unsigned frame = 0; frame < frames; ++frame) {
+        float angle = frame * 0.01f;
+        float sine = std::sin(angle), cosine = std::cos(angle);
+
+        for (SceneNode node : animated) {
+            scene.setRotation(node, 0.0f, 0.0f, sine, cosine);
+        }
+
+        updated += scene.update(pool);
+    }
+
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.incremental_nodes_per_second = updated / seconds;
+    result.updated_per_frame = (double)updated / frames;
+    return result;
+}
+
+}
+
+int
+main(int argc, char **argv) {
+    unsigned node_count = 1 << 20, branching = 4, frames = 20;
+    float dirty = 0.01f;
+    bool validate = true;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--nodes") == 0 && i + 1 < argc) {
+            node_count = std::max(1u, (unsigned)std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--branching") == 0 && i + 1 < argc) {
+            branching = std::max(1u, (unsigned)std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--dirty") == 0 && i + 1 < argc) {
+            dirty = std::clamp(std::strtof(argv[++i], nullptr), 0.0f, 1.0f);
+        }
+        else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = std::max(1u, (unsigned)std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--no-validate") == 0) {
+            validate = false;
+        }
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    // A complete tree, created in shuffled order so the graph has to sort
+    // it by depth.
+    std::mt19937 random(99);
+    std::vector<uint32_t> order(node_count);
+
+    for (uint32_t i = 0; i < node_count; ++i) {
+        order[i] = i;
+    }
+
+    std::shuffle(order.begin() + 1, order.end(), random);
+
+    SceneGraph scene;
+    std::vector<SceneNode> handles(node_count, scene_no_parent), parents;
+
+    // Nodes are added once their parent exists; the tree parent of i is
+    // (i - 1) / branching.
+    std::vector<uint32_t> pending = order;
+
+    while (!pending.empty()) {
+        std::vector<uint32_t> later;
+
+        for (uint32_t i : pending) {
+            SceneNode parent = i == 0 ? scene_no_parent : handles[(i - 1) / branching];
+
+            if (i != 0 && parent == scene_no_parent) {
+                later.push_back(i);
+                continue;
+            }
+
+            handles[i] = scene.addNode(parent, randomTransform(random));
+            parents.push_back(parent);
+        }
+
+        pending.swap(later);
+    }
+
+    std::vector<SceneNode> animated;
+
+    for (SceneNode node = 0; node < node_count; ++node) {
+        if (std::uniform_real_distribution<float>(0.0f, 1.0f)(random) < dirty) {
+            animated.push_back(node);
+        }
+    }
+
+    scene.update();
+    std::printf("%u nodes, %u levels, %zu animated per frame\n", node_count, scene.depthCount(), animated.size());
+
+    ThreadPool pool;
+    RunResult single = run(scene, animated, frames, nullptr);
+    std::vector<SceneMatrix> single_worlds(scene.worldMatrices(), scene.worldMatrices() + scene.size());
+
+    RunResult parallel = run(scene, animated, frames, &pool);
+
+    std::printf("%-12s %2u thread%s %10.1f M nodes/s\n", "full", 1u, " ", single.full_nodes_per_second / 1e6);
+    std::printf("%-12s %2u thread%s %10.1f M nodes/s %6.2fx\n", "full", pool.threadCount(),
+        pool.threadCount() == 1 ? " " : "s", parallel.full_nodes_per_second / 1e6,
+        parallel.full_nodes_per_second / single.full_nodes_per_second);
+    std::printf("%-12s %2u thread%s %10.1f M nodes/s, %.0f nodes updated per frame\n", "incremental", 1u, " ",
+        single.incremental_nodes_per_second / 1e6, single.updated_per_frame);
+    std::printf("%-12s %2u thread%s %10.1f M nodes/s %6.2fx\n", "incremental", pool.threadCount(),
+        pool.threadCount() == 1 ? " " : "s", parallel.incremental_nodes_per_second / 1e6,
+        parallel.incremental_nodes_per_second / single.incremental_nodes_per_second);
+
+    if (std::memcmp(single_worlds.data(), scene.worldMatrices(), single_worlds.size() * sizeof(SceneMatrix)) != 0) {
+        std::printf("validation: pooled update differs from single-threaded\n");
+        return 1;
+    }
+
+    if (validate) {
+        double worst = compareWithReference(scene, parents);
+        std::printf("validation: worst relative difference from reference %.2g\n", worst);
+
+        if (worst > 1e-4) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
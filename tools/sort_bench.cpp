@@ -0,0 +1,202 @@
+// Encodes draw sort keys for a cloud of random spheres seen from a moving
+// eye and sorts them. Prints keys/ms for each encoding kernel and for the
+// radix sort against std::sort, on one batch whose draws share a layer and
+// state and on draws spread over many states. Checks that the kernels give
+// the same keys, that the radix sort agrees with std::sort, and that the
+// sorted draws run front to back (or back to front) by distance.
+
+#include "culling.h"
+#include "sort_keys.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+void
+usage(const char *program) {
+    std::fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --count N        draws per frame, at most %u (default 1000000)\n"
+        "  --frames N       eye positions to sort from (default 16)\n"
+        "  --no-validate    skip the checks\n",
+        program, sort_key_max_index + 1);
+}
+
+double
+millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void
+frameEye(unsigned frame, unsigned frames, float eye[3]) {
+    float angle = 2.0f * float(M_PI) * frame / frames;
+    eye[0] = 120.0f * std::cos(angle);
+    eye[1] = 120.0f * std::sin(angle);
+    eye[2] = 10.0f;
+}
+
+}
+
+int
+main(int argc, char **argv) {
+    unsigned count = 1000000, frames = 16;
+    bool validate = true;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+            count = std::min(sort_key_max_index + 1, std::max(1u, (unsigned)std::strtoul(argv[++i], nullptr, 10)));
+        }
+        else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = std::max(1u, (unsigned)std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--no-validate") == 0) {
+            validate = false;
+        }
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f), size(0.1f, 2.0f);
+    std::uniform_int_distribution<uint32_t> state(0, 255);
+
+    CullBounds bounds;
+
+    for (unsigned i = 0; i < count; ++i) {
+        float half = size(rng);
+        bounds.add(position(rng), position(rng), position(rng), half, half, half);
+    }
+
+    // Every other draw, as if the rest were culled.
+    std::vector<uint32_t> indices;
+
+    for (unsigned i = 0; i < count; i += 2) {
+        indices.push_back(i);
+    }
+
+    size_t draw_count = indices.size();
+    std::printf("%zu of %u draws per frame, %u frames\n", draw_count, count, frames);
+
+    std::vector<uint64_t> keys(draw_count), scalar_keys(draw_count), sorted, scratch;
+    const char *kernel_names[2] = { "scalar", "simd" };
+
+    for (int run = 0; run < 2; ++run) {
+        auto start = std::chrono::steady_clock::now();
+
+        for (unsigned frame = 0; frame < frames; ++frame) {
+            float eye[3];
+            frameEye(frame, frames, eye);
+            encodeSortKeys(bounds, indices.data(), draw_count, eye, 1, 3, SortFrontToBack,
+                run == 0 ? scalar_keys.data() : keys.data(), run == 0 ? SimdKernelScalar : SimdKernelVector);
+        }
+
+        double ms = millisecondsSince(start);
+        std::printf("encode %-8s %8.3f ms/frame %8.0f keys/ms\n", kernel_names[run], ms / frames,
+            draw_count * frames / ms);
+    }
+
+    // Both runs ended on the last frame.
+    bool kernels_agree = keys == scalar_keys;
+
+    // One batch sharing layer and state, then draws over 256 states in
+    // four layers, which leaves the radix sort fewer passes to skip.
+    std::vector<uint32_t> states(count);
+
+    for (unsigned i = 0; i < count; ++i) {
+        states[i] = state(rng);
+    }
+
+    const char *batch_names[2] = { "one state", "256 states" };
+    bool sorts_agree = true;
+
+    for (int batch = 0; batch < 2; ++batch) {
+        double radix_ms = 0.0, std_ms = 0.0;
+
+        for (unsigned frame = 0; frame < frames; ++frame) {
+            float eye[3];
+            frameEye(frame, frames, eye);
+            encodeSortKeys(bounds, indices.data(), draw_count, eye, 1, 3, SortFrontToBack, keys.data());
+
+            if (batch == 1) {
+                // Keep depth and index, replace layer and state.
+                uint64_t depth_and_index = ~sortKey(~0u, 0.0f, ~0u, 0);
+
+                for (size_t i = 0; i < draw_count; ++i) {
+                    uint32_t s = states[indices[i]];
+                    keys[i] = (keys[i] & depth_and_index) | sortKey(s & 3, 0.0f, s, 0);
+                }
+            }
+
+            // Encoded in index order: the index digits need no pass.
+            sorted = keys;
+            auto start = std::chrono::steady_clock::now();
+            radixSort(sorted, scratch, sort_key_index_bits);
+            radix_ms += millisecondsSince(start);
+
+            start = std::chrono::steady_clock::now();
+            std::sort(keys.begin(), keys.end());
+            std_ms += millisecondsSince(start);
+
+            sorts_agree = sorts_agree && sorted == keys;
+        }
+
+        std::printf("sort %-10s radix %8.3f ms/frame %8.0f keys/ms, std::sort %8.3f ms/frame %8.0f keys/ms, "
+            "%.1fx\n", batch_names[batch], radix_ms / frames, draw_count * frames / radix_ms, std_ms / frames,
+            draw_count * frames / std_ms, std_ms / radix_ms);
+    }
+
+    if (!validate) {
+        return 0;
+    }
+
+    // Sorted draws by their true distance: never more than one quantization
+    // step out of order, in either direction, and each draw exactly once.
+    size_t misordered = 0;
+    bool permutation = true;
+
+    for (int order = 0; order < 2; ++order) {
+        float eye[3];
+        frameEye(0, frames, eye);
+        encodeSortKeys(bounds, indices.data(), draw_count, eye, 0, 0, SortOrder(order), keys.data());
+        radixSort(keys, scratch, sort_key_index_bits);
+
+        std::vector<bool> seen(count, false);
+        float previous = order == SortFrontToBack ? 0.0f : INFINITY;
+
+        for (uint64_t key : keys) {
+            uint32_t i = sortKeyIndex(key);
+            permutation = permutation && !seen[i];
+            seen[i] = true;
+
+            float dx = bounds.center[0][i] - eye[0], dy = bounds.center[1][i] - eye[1];
+            float dz = bounds.center[2][i] - eye[2];
+            float distance = std::max(std::sqrt(dx * dx + dy * dy + dz * dz) - bounds.radius[i], 0.0f);
+
+            // Sixteen mantissa bits: a relative step of 2^-16, allowed twice.
+            float slack = std::max(distance, previous) * 0x1p-15f;
+
+            if (order == SortFrontToBack ? distance + slack < previous : distance - slack > previous) {
+                ++misordered;
+            }
+
+            previous = distance;
+        }
+
+        permutation = permutation && (size_t)std::count(seen.begin(), seen.end(), true) == draw_count;
+    }
+
+    std::printf("validation: encoding kernels %s; radix sort %s std::sort; %zu draws out of depth order; %s\n",
+        kernels_agree ? "agree" : "DIFFER", sorts_agree ? "matches" : "DIFFERS FROM", misordered,
+        permutation ? "every draw once" : "draws LOST OR REPEATED");
+
+    return kernels_agree && sorts_agree && misordered == 0 && permutation ? 0 : 1;
+}
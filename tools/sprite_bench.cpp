@@ -0,0 +1,157 @@
+// Measures the sprite batch builder (quads per second into a buffer, and the
+// draw calls sorting saves) and the skyline atlas packer (images per second
+// and page occupancy) on random inputs.
+
+#include "atlas_packer.h"
+#include "sprite_batch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+void
+usage(const char *program) {
+    std::fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --sprites N      sprites per frame (default 100000)\n"
+        "  --textures N     distinct textures (default 8)\n"
+        "  --frames N       frames batched (default 100)\n"
+        "  --images N       images packed into the atlas (default 4000)\n"
+        "  --max-size N     largest image edge, smallest is 8 (default 64)\n"
+        "  --page N         atlas page size (default 1024)\n",
+        program);
+}
+
+}
+
+int
+main(int argc, char **argv) {
+    unsigned sprite_count = 100000, texture_count = 8, frames = 100;
+    unsigned image_count = 4000, max_size = 64, page_size = 1024;
+
+    for (int i = 1; i < argc; ++i) {
+        unsigned *option =
+            std::strcmp(argv[i], "--sprites") == 0 ? &sprite_count :
+            std::strcmp(argv[i], "--textures") == 0 ? &texture_count :
+            std::strcmp(argv[i], "--frames") == 0 ? &frames :
+            std::strcmp(argv[i], "--images") == 0 ? &image_count :
+            std::strcmp(argv[i], "--max-size") == 0 ? &max_size :
+            std::strcmp(argv[i], "--page") == 0 ? &page_size :
+            nullptr;
+
+        if (!option || i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+
+        *option = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+    }
+
+    texture_count = std::max(texture_count, 1u);
+    frames = std::max(frames, 1u);
+    max_size = std::max(max_size, 8u);
+
+    std::mt19937 random(1234);
+
+    // Batching: sprites submitted in random state order, as a scene walk
+    // would produce them.
+    std::vector<Sprite> sprites(sprite_count);
+
+    for (auto& sprite : sprites) {
+        sprite.x = std::uniform_real_distribution<float>(-320.0f, 320.0f)(random);
+        sprite.y = std::uniform_real_distribution<float>(-240.0f, 240.0f)(random);
+        sprite.width = sprite.height = std::uniform_real_distribution<float>(4.0f, 32.0f)(random);
+        sprite.u0 = sprite.v0 = 0.0f;
+        sprite.u1 = sprite.v1 = 1.0f;
+        sprite.texture = (uint16_t)(random() % texture_count);
+        sprite.blend = (SpriteBlend)(random() % SpriteBlendCount);
+    }
+
+    std::vector<SpriteVertex> vertices((size_t)sprite_count * 6);
+    SpriteBatch batch;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (unsigned frame = 0; frame < frames; ++frame) {
+        batch.clear();
+
+        for (const auto& sprite : sprites) {
+            batch.add(sprite);
+        }
+
+        batch.build(vertices.data(), sprite_count);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Draws needed without sorting: one per change of state along submission order.
+    size_t unsorted_draws = 0;
+
+    for (size_t i = 0; i < sprites.size(); ++i) {
+        if (i == 0 || sprites[i].texture != sprites[i - 1].texture || sprites[i].blend != sprites[i - 1].blend) {
+            ++unsorted_draws;
+        }
+    }
+
+    std::printf("batch: %u sprites, %u textures: %.1f M quads/s, %zu draws (%zu unsorted)\n",
+        sprite_count, texture_count, (double)sprite_count * frames / seconds / 1e6,
+        batch.draws().size(), unsorted_draws);
+
+    // Atlas packing.
+    std::vector<AtlasRect> sizes(image_count);
+    std::uniform_int_distribution<uint32_t> edge(8, max_size);
+
+    for (auto& size : sizes) {
+        size.width = edge(random);
+        size.height = edge(random);
+    }
+
+    start = std::chrono::steady_clock::now();
+    AtlasLayout layout = packAtlas(sizes.data(), sizes.size(), page_size, page_size);
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t unplaced = std::count_if(layout.entries.begin(), layout.entries.end(),
+        [](const AtlasEntry& entry) { return entry.page == UINT32_MAX; });
+
+    // Every placement must be on its page and clear of the others.
+    size_t overlaps = 0;
+
+    for (size_t a = 0; a < layout.entries.size(); ++a) {
+        const AtlasEntry& first = layout.entries[a];
+
+        if (first.page == UINT32_MAX) {
+            continue;
+        }
+
+        if (first.rect.x + first.rect.width > page_size || first.rect.y + first.rect.height > page_size) {
+            ++overlaps;
+        }
+
+        for (size_t b = a + 1; b < layout.entries.size(); ++b) {
+            const AtlasEntry& second = layout.entries[b];
+
+            if (second.page == first.page &&
+                first.rect.x < second.rect.x + second.rect.width && second.rect.x < first.rect.x + first.rect.width &&
+                first.rect.y < second.rect.y + second.rect.height && second.rect.y < first.rect.y + first.rect.height) {
+                ++overlaps;
+            }
+        }
+    }
+
+    std::printf("atlas: %u images of 8-%u px: %.1f K images/s, %u pages of %u, %.1f%% occupied, %zu unplaced\n",
+        image_count, max_size, image_count / seconds / 1e3, layout.page_count, page_size,
+        layout.occupancy * 100.0f, unplaced);
+
+    if (overlaps > 0) {
+        std::printf("atlas: %zu overlapping or out-of-page placements\n", overlaps);
+        return 1;
+    }
+
+    return 0;
+}
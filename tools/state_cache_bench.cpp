@@ -0,0 +1,299 @@
+// Measures concurrent lookups per second through the state cache against a
+// locked unordered_map, first with every state cached, spread over all of
+// them and then all on one, and then with a cache holding half the working
+// set, where misses create states and evict others. Checks that a state is
+// created once per key however many threads race for it, that a reference
+// always sees its own key's state while other threads evict, that
+// referenced states survive eviction, and that the least recently used
+// state is the one evicted.
+
+#include "state_cache.h"
+#include "string_hash.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// Shaped like a packed sampler or depth and stencil description.
+struct BenchKey {
+    uint32_t bits = 0;
+
+    uint64_t hash() const {
+        return hashName(reinterpret_cast<const char *>(&bits), sizeof(bits));
+    }
+
+    bool operator==(const BenchKey& other) const {
+        return bits == other.bits;
+    }
+};
+
+uint64_t
+stateFor(BenchKey key) {
+    return key.bits * 0x9e3779b97f4a7c15ull + 1;
+}
+
+void
+usage(const char *program) {
+    std::fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --keys N        distinct states (default 512)\n"
+        "  --lookups N     lookups per thread and method (default 4000000)\n"
+        "  --threads N     threads for the concurrent runs (default: all cores)\n"
+        "  --no-validate   skip the checks\n",
+        program);
+}
+
+// Runs `lookup(thread, i)` `lookups` times on each of `threads` threads and
+// returns total lookups per second. `sink` keeps results observable.
+template<typename Lookup>
+double
+measure(unsigned threads, uint64_t lookups, Lookup&& lookup) {
+    std::atomic<uint64_t> sink { 0 };
+    std::vector<std::thread> workers;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            uint64_t local = 0;
+
+            for (uint64_t i = 0; i < lookups; ++i) {
+                local += lookup(t, i);
+            }
+
+            sink += local;
+        });
+    }
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (sink.load() == 0) {
+        std::fprintf(stderr, "(no results)\n");
+    }
+
+    return (double)(threads * lookups) / seconds;
+}
+
+void
+report(const char *method, unsigned threads, double per_second, double baseline) {
+    std::printf("%-34s %2u thread%s %10.1f M/s %8.1fx\n",
+        method, threads, threads == 1 ? " " : "s", per_second / 1e6, per_second / baseline);
+}
+
+// Every thread asks for every key at once; each must be created once.
+bool
+createsOnce(unsigned threads, unsigned key_count) {
+    StateCache<BenchKey, uint64_t> cache;
+    std::atomic<unsigned> created { 0 };
+    std::atomic<bool> matches { true };
+    std::vector<std::thread> workers;
+
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            for (unsigned i = 0; i < key_count; ++i) {
+                BenchKey key { (i + t * 7) % key_count };
+                auto state = cache.acquire(key, [&] {
+                    ++created;
+                    return stateFor(key);
+                });
+
+                if (*state != stateFor(key)) {
+                    matches = false;
+                }
+            }
+        });
+    }
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    return matches && created == key_count && cache.size() == key_count && cache.misses() == key_count;
+}
+
+// Threads look up twice as many keys as fit while holding on to a few, so
+// states are evicted and entries recycled under readers.
+bool
+survivesEviction(unsigned threads, unsigned key_count) {
+    unsigned max_entries = std::max(4u, key_count / 2);
+    StateCache<BenchKey, uint64_t> cache(max_entries);
+    std::vector<StateCache<BenchKey, uint64_t>::Ref> pinned;
+
+    for (uint32_t i = 0; i < 4; ++i) {
+        pinned.push_back(cache.acquire(BenchKey { i }, [i] { return stateFor(BenchKey { i }); }));
+    }
+
+    std::atomic<bool> matches { true };
+    std::vector<std::thread> workers;
+
+    for (unsigned t = 0; t < std::max(2u, threads); ++t) {
+        workers.emplace_back([&, t]() {
+            for (uint64_t i = 0; i < 200000; ++i) {
+                BenchKey key { (uint32_t)(4 + (i * 2654435761u + t * 40503u) % key_count) };
+                auto state = cache.acquire(key, [key] { return stateFor(key); });
+
+                if (*state != stateFor(key)) {
+                    matches = false;
+                }
+            }
+        });
+    }
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    for (uint32_t i = 0; i < 4; ++i) {
+        auto state = cache.find(BenchKey { i });
+        matches = matches && state && *state == stateFor(BenchKey { i }) && *pinned[i] == stateFor(BenchKey { i });
+    }
+
+    return matches && cache.evictions() > 0 && cache.size() <= max_entries &&
+           cache.misses() - cache.evictions() == cache.size();
+}
+
+// Four states in a cache of four; touching the first makes the second the
+// oldest, so a fifth state evicts the second.
+bool
+evictsLeastRecentlyUsed() {
+    StateCache<BenchKey, uint64_t> cache(4);
+
+    for (uint32_t i = 0; i < 4; ++i) {
+        cache.acquire(BenchKey { i }, [i] { return stateFor(BenchKey { i }); });
+    }
+
+    cache.find(BenchKey { 0 });
+    cache.acquire(BenchKey { 4 }, [] { return stateFor(BenchKey { 4 }); });
+
+    return cache.find(BenchKey { 0 }) && !cache.find(BenchKey { 1 }) && cache.find(BenchKey { 2 }) &&
+           cache.find(BenchKey { 4 }) && cache.size() == 4;
+}
+
+}
+
+int
+main(int argc, char **argv) {
+    unsigned key_count = 512;
+    uint64_t lookups = 4000000;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    bool validate = true;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--keys") == 0 && i + 1 < argc) {
+            key_count = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--lookups") == 0 && i + 1 < argc) {
+            lookups = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--no-validate") == 0) {
+            validate = false;
+        }
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (key_count < 8 || threads == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    StateCache<BenchKey, uint64_t> cache;
+    std::unordered_map<uint32_t, uint64_t> map;
+    std::mutex map_mutex;
+
+    for (uint32_t i = 0; i < key_count; ++i) {
+        cache.acquire(BenchKey { i }, [i] { return stateFor(BenchKey { i }); });
+        map.emplace(i, stateFor(BenchKey { i }));
+    }
+
+    // Visit keys in a scattered order so lookups do not just hit one line.
+    auto key_index = [key_count](unsigned thread, uint64_t i) {
+        return (uint32_t)((i * 2654435761u + thread * 40503u) % key_count);
+    };
+
+    std::vector<unsigned> thread_counts = { 1 };
+
+    if (threads > 1) {
+        thread_counts.push_back(threads);
+    }
+
+    std::printf("%u states, %llu lookups per thread\n", key_count, (unsigned long long)lookups);
+
+    double baseline = 0.0;
+
+    for (unsigned n : thread_counts) {
+        double per_second = measure(n, lookups, [&](unsigned t, uint64_t i) {
+            std::lock_guard<std::mutex> lock(map_mutex);
+            return map.find(key_index(t, i))->second;
+        });
+
+        baseline = baseline == 0.0 ? per_second : baseline;
+        report("locked unordered_map", n, per_second, baseline);
+    }
+
+    for (unsigned n : thread_counts) {
+        double per_second = measure(n, lookups, [&](unsigned t, uint64_t i) {
+            return *cache.acquire(BenchKey { key_index(t, i) }, [] { return uint64_t(0); });
+        });
+
+        report("state cache", n, per_second, baseline);
+    }
+
+    // Every thread on the same state: each hit adds and drops a reference on
+    // one entry, so the threads contend on its cache line.
+    for (unsigned n : thread_counts) {
+        double per_second = measure(n, lookups, [&](unsigned, uint64_t) {
+            return *cache.acquire(BenchKey { 0 }, [] { return uint64_t(0); });
+        });
+
+        report("state cache, one state", n, per_second, baseline);
+    }
+
+    // Lookups favor the low keys, as real state use does, and only half the
+    // keys they touch fit: misses create a state and evict another.
+    for (unsigned n : thread_counts) {
+        StateCache<BenchKey, uint64_t> small(key_count / 4);
+        double per_second = measure(n, lookups, [&](unsigned t, uint64_t i) {
+            uint32_t index = key_index(t, i);
+            BenchKey key { index % 4 == 0 ? index : index % (key_count / 4) };
+            return *small.acquire(key, [key] { return stateFor(key); });
+        });
+
+        char label[64];
+        std::snprintf(label, sizeof(label), "state cache, %.2f%% misses",
+            100.0 * small.misses() / (double)(n * lookups));
+        report(label, n, per_second, baseline);
+    }
+
+    if (!validate) {
+        return 0;
+    }
+
+    bool once = createsOnce(std::max(2u, threads), key_count);
+    bool consistent = survivesEviction(threads, key_count);
+    bool lru = evictsLeastRecentlyUsed();
+
+    std::printf("validation: %s; %s; %s\n", once ? "each state created once" : "STATES CREATED TWICE",
+        consistent ? "references consistent under eviction" : "REFERENCES INCONSISTENT",
+        lru ? "least recently used evicted" : "WRONG STATE EVICTED");
+
+    return once && consistent && lru ? 0 : 1;
+}
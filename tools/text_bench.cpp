@@ -0,0 +1,222 @@
+// Benchmarks the pieces of SDF text rendering: the distance transform
+// (scalar and SIMD, on one thread and on the pool, checked against brute
+// force), building the built-in font's glyph atlas, and laying out and
+// batching a paragraph. Can also write the atlas out for offline use.
+
+#include "distance_field.h"
+#include "font.h"
+#include "glyph_atlas.h"
+#include "image_io.h"
+#include "sprite_batch.h"
+#include "text_layout.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+const char paragraph[] =
+    "The quick brown fox jumps over the lazy dog. Sphinx of black quartz, judge my vow! "
+    "AVA, To, Ty, LT: kerning pairs 0123456789 (brackets) [square] {curly} #$%&*+-/<=>?@ "
+    "Pack my box with five dozen liquor jugs; how vexingly quick daft zebras jump.\n"
+    "Supercalifragilisticexpialidocious-is-one-word-that-will-not-fit-on-one-line.";
+
+void
+usage(const char *program) {
+    std::fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --size N          distance transform image edge (default 1024)\n"
+        "  --spread F        distance transform spread in pixels (default 16)\n"
+        "  --iterations N    distance transforms per run (default 10)\n"
+        "  --pixel-size F    atlas pixels per em (default 32)\n"
+        "  --write-atlas F   write the first atlas page as a PGM\n"
+        "  --no-validate     skip the brute-force check\n",
+        program);
+}
+
+// Random overlapping discs, so there are edges at every angle.
+std::vector<uint8_t>
+makeCoverage(uint32_t size) {
+    std::vector<uint8_t> coverage((size_t)size * size, 0);
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> position(0.0f, (float)size), radius(2.0f, size / 16.0f + 2.0f);
+
+    for (int disc = 0; disc < 64; ++disc) {
+        float cx = position(random), cy = position(random), r = radius(random);
+        int y0 = std::max(0, (int)(cy - r)), y1 = std::min((int)size - 1, (int)(cy + r));
+        int x0 = std::max(0, (int)(cx - r)), x1 = std::min((int)size - 1, (int)(cx + r));
+
+        for (int y = y0; y <= y1; ++y) {
+            for (int x = x0; x <= x1; ++x) {
+                float dx = x + 0.5f - cx, dy = y + 0.5f - cy;
+
+                if (dx * dx + dy * dy <= r * r) {
+                    coverage[(size_t)y * size + x] = 255;
+                }
+            }
+        }
+    }
+
+    return coverage;
+}
+
+// Returns megapixels per second.
+double
+runTransform(const std::vector<uint8_t>& coverage, uint32_t size, float spread, unsigned iterations,
+    ThreadPool *pool, DistanceFieldKernel kernel, std::vector<float>& distance) {
+    auto start = std::chrono::steady_clock::now();
+
+    for (unsigned i = 0; i < iterations; ++i) {
+        computeDistanceField(coverage.data(), size, size, spread, distance.data(), pool, kernel);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return (double)size * size * iterations / seconds / 1e6;
+}
+
+}
+
+int
+main(int argc, char **argv) {
+    unsigned size = 1024, iterations = 10;
+    float spread = 16.0f, pixel_size = 32.0f;
+    const char *atlas_path = nullptr;
+    bool validate = true;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            size = std::max(1u, (unsigned)std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--spread") == 0 && i + 1 < argc) {
+            spread = std::max(1.0f, std::strtof(argv[++i], nullptr));
+        }
+        else if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = std::max(1u, (unsigned)std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--pixel-size") == 0 && i + 1 < argc) {
+            pixel_size = std::max(4.0f, std::strtof(argv[++i], nullptr));
+        }
+        else if (std::strcmp(argv[i], "--write-atlas") == 0 && i + 1 < argc) {
+            atlas_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--no-validate") == 0) {
+            validate = false;
+        }
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    ThreadPool pool;
+
+    // Distance transform.
+    std::vector<uint8_t> coverage = makeCoverage(size);
+    std::vector<float> distance(coverage.size());
+
+    double scalar = runTransform(coverage, size, spread, iterations, nullptr, DistanceFieldKernelScalar, distance);
+    double simd = runTransform(coverage, size, spread, iterations, nullptr, DistanceFieldKernelSimd, distance);
+    double parallel = runTransform(coverage, size, spread, iterations, &pool, DistanceFieldKernelSimd, distance);
+
+    std::printf("distance transform: %ux%u, spread %.1f\n", size, size, spread);
+    std::printf("%-10s %2u thread%s %10.1f Mpixels/s\n", "scalar", 1u, " ", scalar);
+    std::printf("%-10s %2u thread%s %10.1f Mpixels/s %6.2fx\n", "simd", 1u, " ", simd, simd / scalar);
+    std::printf("%-10s %2u thread%s %10.1f Mpixels/s %6.2fx\n", "simd", pool.threadCount(),
+        pool.threadCount() == 1 ? " " : "s", parallel, parallel / scalar);
+
+    if (validate) {
+        // Brute force is quadratic in the spread, so check a corner.
+        uint32_t check = std::min(size, 256u);
+        std::vector<uint8_t> corner((size_t)check * check);
+
+        for (uint32_t y = 0; y < check; ++y) {
+            std::memcpy(&corner[(size_t)y * check], &coverage[(size_t)y * size], check);
+        }
+
+        std::vector<float> expected(corner.size()), actual(corner.size());
+        computeDistanceFieldReference(corner.data(), check, check, spread, expected.data());
+
+        size_t mismatched = 0;
+        const DistanceFieldKernel kernels[] = { DistanceFieldKernelScalar, DistanceFieldKernelSimd };
+
+        for (DistanceFieldKernel kernel : kernels) {
+            for (ThreadPool *with : { (ThreadPool *)nullptr, &pool }) {
+                computeDistanceField(corner.data(), check, check, spread, actual.data(), with, kernel);
+
+                for (size_t i = 0; i < actual.size(); ++i) {
+                    mismatched += actual[i] != expected[i] ? 1 : 0;
+                }
+            }
+        }
+
+        std::printf("validation: %zu pixels differ from brute force\n", mismatched);
+
+        if (mismatched > 0) {
+            return 1;
+        }
+    }
+
+    // Glyph atlas.
+    const Font& font = builtinFont();
+    GlyphAtlasOptions options;
+    options.pixel_size = pixel_size;
+
+    auto start = std::chrono::steady_clock::now();
+    GlyphAtlas atlas = buildGlyphAtlas(font, options);
+    double single_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    GlyphAtlas pooled = buildGlyphAtlas(font, options, &pool);
+    double pooled_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("atlas: %zu glyphs at %.0f px/em: %.1f ms on 1 thread, %.1f ms on %u, %zu pages of %u, %.1f%% occupied\n",
+        atlas.glyphs.size(), pixel_size, single_seconds * 1e3, pooled_seconds * 1e3, pool.threadCount(),
+        atlas.pages.size(), atlas.page_width, atlas.occupancy * 100.0f);
+
+    if (atlas.pages != pooled.pages) {
+        std::printf("atlas: built differently on the pool\n");
+        return 1;
+    }
+
+    if (atlas_path && !atlas.pages.empty()) {
+        if (!writePGM(atlas_path, atlas.pages[0].data(), atlas.page_width, atlas.page_height)) {
+            std::fprintf(stderr, "Failed to write %s\n", atlas_path);
+            return 1;
+        }
+    }
+
+    // Layout and batching.
+    TextStyle style;
+    style.size = 16.0f;
+    style.max_width = 320.0f;
+
+    TextLayout layout;
+    SpriteBatch batch;
+    std::vector<SpriteVertex> vertices;
+    const unsigned layouts = 2000;
+
+    start = std::chrono::steady_clock::now();
+
+    for (unsigned i = 0; i < layouts; ++i) {
+        layoutText(font, paragraph, sizeof(paragraph) - 1, style, layout);
+        batch.clear();
+        addTextSprites(layout, atlas, style.size, -160.0f, 100.0f, 0xffffffffu, batch);
+        vertices.resize(batch.size() * 6);
+        batch.build(vertices.data(), batch.size());
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("layout: %zu glyphs on %u lines, %.0f x %.0f px: %.1f M glyphs/s laid out and batched in %zu draws\n",
+        layout.glyphs.size(), layout.line_count, layout.width, layout.height,
+        (double)layout.glyphs.size() * layouts / seconds / 1e6, batch.draws().size());
+
+    return 0;
+}
@@ -0,0 +1,127 @@
+// Cooks a binary PPM into a texture file with its mip chain encoded ahead of
+// time, for loading with loadTexture: ASTC for Apple GPUs, BC7 for the Intel
+// and AMD GPUs of older Macs, or the universal format that is transcoded to
+// either at load time. Mip levels are filtered in linear light, with a box
+// or a Kaiser-windowed sinc. Prints each level's size and the full image's
+// PSNR.
+
+#include "image_io.h"
+#include "texture_file.h"
+#include "thread_pool.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+void
+usage(const char *program) {
+    std::fprintf(stderr,
+        "usage: %s [options] input.ppm output.smtx\n"
+        "  --format F       astc, bc7, universal or rgba8 (default universal)\n"
+        "  --no-mips        only the full image\n"
+        "  --filter F       box or kaiser mip filter (default kaiser)\n"
+        "  --linear         not sRGB color: filter the values as they are\n",
+        program);
+}
+
+}
+
+int
+main(int argc, char **argv) {
+    TextureFormat format = TextureFormatUniversal;
+    bool mipmaps = true, srgb = true;
+    MipFilter filter = MipFilterKaiser;
+    const char *paths[2] = { nullptr, nullptr };
+    int path_count = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            const char *name = argv[++i];
+            format = TextureFormatCount;
+
+            for (int candidate = 0; candidate < TextureFormatCount; ++candidate) {
+                if (std::strcmp(name, textureFormatName((TextureFormat)candidate)) == 0) {
+                    format = (TextureFormat)candidate;
+                }
+            }
+
+            if (format == TextureFormatCount) {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--no-mips") == 0) {
+            mipmaps = false;
+        }
+        else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            const char *name = argv[++i];
+
+            if (std::strcmp(name, "box") != 0 && std::strcmp(name, "kaiser") != 0) {
+                usage(argv[0]);
+                return 1;
+            }
+
+            filter = std::strcmp(name, "box") == 0 ? MipFilterBox : MipFilterKaiser;
+        }
+        else if (std::strcmp(argv[i], "--linear") == 0) {
+            srgb = false;
+        }
+        else if (argv[i][0] != '-' && path_count < 2) {
+            paths[path_count++] = argv[i];
+        }
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (path_count != 2) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::vector<uint32_t> rgba;
+    uint32_t width, height;
+
+    if (!readPPM(paths[0], rgba, width, height)) {
+        std::fprintf(stderr, "%s: not a binary PPM with 8-bit channels\n", paths[0]);
+        return 1;
+    }
+
+    ThreadPool pool;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<uint8_t> file = cookTexture(rgba.data(), width, height, format, mipmaps, &pool, filter, srgb);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    TextureFileView view;
+    parseTextureFile(file.data(), file.size(), view);
+
+    for (size_t i = 0; i < view.levels.size(); ++i) {
+        std::printf("level %2zu: %5u x %-5u %9zu bytes\n", i, view.levels[i].width, view.levels[i].height,
+            view.levels[i].size);
+    }
+
+    std::vector<uint32_t> decoded(rgba.size());
+    decodeTexture(format, view.levels[0].data, width, height, decoded.data(), &pool);
+
+    std::printf("%s: %u x %u as %s, %zu bytes, %.1f ms, %.2f dB\n", paths[1], width, height,
+        textureFormatName(format), file.size(), ms, texturePSNR(rgba.data(), decoded.data(), rgba.size()));
+
+    FILE *out = std::fopen(paths[1], "wb");
+
+    if (!out || std::fwrite(file.data(), 1, file.size(), out) != file.size()) {
+        std::fprintf(stderr, "%s: cannot write\n", paths[1]);
+
+        if (out) {
+            std::fclose(out);
+        }
+
+        return 1;
+    }
+
+    std::fclose(out);
+    return 0;
+}
@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+
+# Summarizes clang -ftime-trace output: where each translation unit spent its
+# compile time, and which headers cost the most to parse across all of them.
+#
+# usage: time_trace_report.py OBJECT_OR_TRACE...
+#
+# Object files are mapped to the trace clang writes next to them
+# (foo.cpp.o -> foo.cpp.json).
+
+import json
+import os
+import sys
+
+PHASES = [ 'ExecuteCompiler', 'Frontend', 'Source', 'ParseClass', 'InstantiateClass', 'InstantiateFunction', 'Backend' ]
+TOP_HEADERS = 15
+
+
+def trace_path( path ):
+    base, ext = os.path.splitext( path )
+    return path if ext == '.json' else base + '.json'
+
+
+def load_trace( path ):
+    with open( path, 'r' ) as f:
+        return json.load( f ).get( 'traceEvents', [] )
+
+
+def summarize( events ):
+    totals = dict()
+    headers = dict()
+
+    for event in events:
+        name = event.get( 'name', '' )
+        duration = event.get( 'dur', 0 )
+
+        if name.startswith( 'Total ' ):
+            totals[ name[ len( 'Total ' ): ] ] = duration
+        elif name == 'Source':
+            # Source events nest like the includes do, so this is inclusive time;
+            # a header included twice is only parsed once thanks to #pragma once.
+            header = event.get( 'args', {} ).get( 'detail', '?' )
+            headers[ header ] = max( headers.get( header, 0 ), duration )
+
+    return totals, headers
+
+
+def main( paths ):
+    if not paths:
+        print( 'usage: time_trace_report.py OBJECT_OR_TRACE...', file = sys.stderr )
+        return 1
+
+    rows = []
+    all_headers = dict()
+
+    for path in paths:
+        trace = trace_path( path )
+
+        if not os.path.isfile( trace ):
+            print( 'missing trace ' + trace + ' (was it compiled with -ftime-trace?)', file = sys.stderr )
+            return 1
+
+        totals, headers = summarize( load_trace( trace ) )
+        rows.append( ( os.path.basename( trace ), totals ) )
+
+        for header, duration in headers.items():
+            all_headers[ header ] = all_headers.get( header, 0 ) + duration
+
+    rows.sort( key = lambda row: row[ 1 ].get( 'ExecuteCompiler', 0 ), reverse = True )
+
+    name_width = max( len( 'translation unit' ), max( len( name ) for name, _ in rows ) )
+    print( '{:<{}}'.format( 'translation unit', name_width ) + ''.join( '{:>20}'.format( phase ) for phase in PHASES ) )
+
+    for name, totals in rows:
+        print( '{:<{}}'.format( name, name_width ) + ''.join( '{:>17.1f} ms'.format( totals.get( phase, 0 ) / 1000.0 ) for phase in PHASES ) )
+
+    print()
+    print( 'Most expensive headers (inclusive parse time, summed over translation units):' )
+
+    for header, duration in sorted( all_headers.items(), key = lambda item: item[ 1 ], reverse = True )[ :TOP_HEADERS ]:
+        print( '{:>10.1f} ms  {}'.format( duration / 1000.0, header ) )
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit( main( sys.argv[ 1: ] ) )
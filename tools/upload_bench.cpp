@@ -0,0 +1,292 @@
+// Generates mip chains on the CPU with the box and Kaiser filters, on the
+// scalar and SIMD kernels and on the pool, and streams texture levels
+// through a staging ring against a simulated GPU that finishes each batch of
+// copies a few frames later. Prints source MPix/s and levels per second for
+// the mips, and MB/s into the ring with how often it was full. Checks that
+// both kernels give the same levels, that filtering is gamma-correct and
+// does not bleed the color of transparent texels, that no two live staging
+// allocations overlap, and that every byte comes back.
+
+#include "mip_chain.h"
+#include "staging_ring.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace {
+
+void
+usage(const char *program) {
+    std::fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --size N         mip source width and height (default 2048)\n"
+        "  --ring MB        staging ring size (default 16)\n"
+        "  --latency N      frames until the GPU finishes a batch (default 2)\n"
+        "  --runs N         runs per measurement, best time reported (default 3)\n"
+        "  --no-validate    skip the checks\n",
+        program);
+}
+
+double
+millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::vector<uint32_t>
+makeImage(uint32_t size) {
+    std::vector<uint32_t> rgba((size_t)size * size);
+    std::mt19937 rng(9);
+
+    for (uint32_t y = 0; y < size; ++y) {
+        for (uint32_t x = 0; x < size; ++x) {
+            float u = (float)x / size, v = (float)y / size;
+            uint32_t r = (uint32_t)(255.0f * u), g = (uint32_t)(127.5f + 127.5f * std::sin(40.0f * u * v));
+            uint32_t b = ((x / 3 + y / 5) % 2) * 255, a = 128 + rng() % 128;
+            rgba[(size_t)y * size + x] = r | g << 8 | b << 16 | a << 24;
+        }
+    }
+
+    return rgba;
+}
+
+bool
+levelsMatch(const std::vector<MipImage>& a, const std::vector<MipImage>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+
+    for (size_t level = 0; level < a.size(); ++level) {
+        for (size_t i = 0; i < a[level].texels.size(); ++i) {
+            for (int c = 0; c < 32; c += 8) {
+                int d = (int)((a[level].texels[i] >> c) & 0xff) - (int)((b[level].texels[i] >> c) & 0xff);
+
+                if (std::abs(d) > 1) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+struct UploadResult {
+    double ms = 0.0;
+    uint64_t bytes = 0;
+    size_t uploads = 0, full = 0;
+    bool disjoint = true, drained = true;
+};
+
+// Texture levels of random sizes written into the ring each frame; the
+// simulated GPU finishes a frame's batch `latency` frames later. When the
+// ring is full the CPU waits for the oldest batch, as a real uploader has to.
+UploadResult
+runUploads(size_t capacity, uint32_t latency, unsigned frames) {
+    struct Live {
+        size_t offset, size;
+        uint64_t batch;
+    };
+
+    UploadResult result;
+    StagingRing ring(capacity);
+    std::vector<uint8_t> staging(capacity), source(capacity);
+    std::vector<Live> live;
+    std::vector<uint64_t> in_flight;
+    std::mt19937 rng(17);
+
+    std::iota(source.begin(), source.end(), 0);
+
+    // Closes the batch of the allocations made since the last one.
+    auto submit = [&] {
+        uint64_t batch = ring.closeBatch();
+
+        for (Live& l : live) {
+            l.batch = l.batch == ~uint64_t(0) ? batch : l.batch;
+        }
+
+        in_flight.push_back(batch);
+    };
+
+    auto retireOldest = [&] {
+        uint64_t batch = in_flight.front();
+        in_flight.erase(in_flight.begin());
+        ring.retire(batch);
+        live.erase(std::remove_if(live.begin(), live.end(), [batch](const Live& l) { return l.batch == batch; }),
+            live.end());
+    };
+
+    for (unsigned frame = 0; frame < frames; ++frame) {
+        while (in_flight.size() >= latency) {
+            retireOldest();
+        }
+
+        // A few levels of textures up to 512x512 RGBA8, down to 4x4.
+        unsigned count = 1 + rng() % 8;
+        auto start = std::chrono::steady_clock::now();
+
+        for (unsigned i = 0; i < count; ++i) {
+            size_t edge = size_t(4) << (rng() % 8);
+            size_t size = std::min(edge * edge * 4, capacity / 2);
+            size_t offset = ring.allocate(size, 16);
+
+            while (offset == StagingRing::npos) {
+                ++result.full;
+
+                // Submits what is open, then waits for the oldest batch.
+                submit();
+                retireOldest();
+                offset = ring.allocate(size, 16);
+            }
+
+            for (const Live& other : live) {
+                result.disjoint = result.disjoint &&
+                    (offset + size <= other.offset || other.offset + other.size <= offset);
+            }
+
+            std::memcpy(&staging[offset], source.data(), size);
+            live.push_back(Live { offset, size, ~uint64_t(0) });
+            result.bytes += size;
+            ++result.uploads;
+        }
+
+        submit();
+        result.ms += millisecondsSince(start);
+    }
+
+    while (!in_flight.empty()) {
+        retireOldest();
+    }
+
+    result.drained = ring.used() == 0 && ring.batchesInFlight() == 0;
+    return result;
+}
+
+}
+
+int
+main(int argc, char **argv) {
+    uint32_t size = 2048;
+    size_t ring_mb = 16;
+    unsigned latency = 2, runs = 3;
+    bool validate = true;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            size = std::max(1u, (uint32_t)std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--ring") == 0 && i + 1 < argc) {
+            ring_mb = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--latency") == 0 && i + 1 < argc) {
+            latency = std::max(1u, (unsigned)std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            runs = std::max(1u, (unsigned)std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--no-validate") == 0) {
+            validate = false;
+        }
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    ThreadPool pool;
+    std::vector<uint32_t> image = makeImage(size);
+    uint32_t level_count = mipLevelCount(size, size) - 1;
+
+    std::printf("%u x %u source, %u levels below it, %u threads\n", size, size, level_count, pool.threadCount());
+
+    bool kernels_match = true;
+
+    for (MipFilter filter : { MipFilterBox, MipFilterKaiser }) {
+        std::vector<MipImage> scalar, simd, threaded;
+        struct {
+            const char *label;
+            std::vector<MipImage> *levels;
+            ThreadPool *pool;
+            SimdKernel kernel;
+        } variants[3] = {
+            { "scalar", &scalar, nullptr, SimdKernelScalar },
+            { "simd", &simd, nullptr, SimdKernelVector },
+            { "simd on pool", &threaded, &pool, SimdKernelVector },
+        };
+
+        for (auto& variant : variants) {
+            double best = 1e30;
+
+            for (unsigned run = 0; run < runs; ++run) {
+                auto start = std::chrono::steady_clock::now();
+                generateMips(image.data(), size, size, *variant.levels, filter, true, variant.pool, variant.kernel);
+                best = std::min(best, millisecondsSince(start));
+            }
+
+            std::printf("%-6s %-12s %8.1f MPix/s, %8.1f levels/s\n", filter == MipFilterBox ? "box" : "kaiser",
+                variant.label, image.size() / 1e3 / best, level_count * 1e3 / best);
+        }
+
+        kernels_match = kernels_match && levelsMatch(scalar, simd) && levelsMatch(simd, threaded);
+    }
+
+    // With the ring asked for, then with one too small for a frame's
+    // uploads, which has to wait on the GPU.
+    bool disjoint = true, drained = true;
+
+    for (size_t ring_bytes : { ring_mb << 20, size_t(1) << 20 }) {
+        UploadResult upload = runUploads(ring_bytes, latency, 2000);
+        std::printf("staging: %zu uploads, %8.1f MB/s into a %zu KB ring, full %zu times\n", upload.uploads,
+            upload.bytes / 1e3 / upload.ms, ring_bytes >> 10, upload.full);
+
+        disjoint = disjoint && upload.disjoint;
+        drained = drained && upload.drained;
+    }
+
+    if (!validate) {
+        return 0;
+    }
+
+    // A black and white checkerboard averages to half the light, which is
+    // sRGB 188, and to 128 when the values are taken as linear.
+    std::vector<uint32_t> checker(16 * 16);
+
+    for (uint32_t i = 0; i < checker.size(); ++i) {
+        checker[i] = ((i % 16 + i / 16) % 2) ? 0xffffffffu : 0xff000000u;
+    }
+
+    bool gamma_correct = true;
+
+    for (MipFilter filter : { MipFilterBox, MipFilterKaiser }) {
+        std::vector<MipImage> levels;
+        generateMips(checker.data(), 16, 16, levels, filter, true);
+        gamma_correct = gamma_correct && (levels[0].texels[27] & 0xff) == 188;
+        generateMips(checker.data(), 16, 16, levels, filter, false);
+        gamma_correct = gamma_correct && (levels[0].texels[27] & 0xff) == 128;
+    }
+
+    // Opaque green next to transparent red stays green.
+    std::vector<uint32_t> fringe(8 * 8);
+
+    for (uint32_t i = 0; i < fringe.size(); ++i) {
+        fringe[i] = (i % 2) ? 0xff00ff00u : 0x000000ffu;
+    }
+
+    std::vector<MipImage> fringe_levels;
+    generateMips(fringe.data(), 8, 8, fringe_levels, MipFilterBox, true);
+    bool no_bleed = (fringe_levels[0].texels[0] & 0x00ffffffu) == 0x0000ff00u;
+
+    std::printf("validation: kernels %s; filtering %s; transparent texels %s; staging %s, %s\n",
+        kernels_match ? "match" : "DIFFER", gamma_correct ? "gamma-correct" : "NOT GAMMA-CORRECT",
+        no_bleed ? "do not bleed" : "BLEED", disjoint ? "disjoint" : "OVERLAPPING",
+        drained ? "every byte returned" : "BYTES LEAKED");
+
+    return kernels_match && gamma_correct && no_bleed && disjoint && drained ? 0 : 1;
+}
@@ -11,6 +11,7 @@ using namespace metal;
 
 // Include header shared between this Metal shader code and C code executing Metal API commands.
 #include "triangle_types.h"
+#include "bindless_types.h"
 
 // Vertex shader outputs and fragment shader inputs
 struct RasterizerData
@@ -54,6 +55,33 @@ vertexShader(uint vertexID [[vertex_id]],
     return out;
 }
 
+// Global argument buffer; resources are addressed by slot instead of binding.
+struct BindlessTable
+{
+    constant uchar *buffers [[id(BindlessTableIndexBuffers)]] [BINDLESS_CAPACITY];
+    texture2d<float> textures [[id(BindlessTableIndexTextures)]] [BINDLESS_CAPACITY];
+};
+
+// Same as vertexShader, but fetches its inputs through the bindless table.
+vertex RasterizerData
+vertexShaderBindless(uint vertexID [[vertex_id]],
+                     constant BindlessTable &table [[buffer(AAPLVertexInputIndexBindlessTable)]],
+                     constant BindlessDrawArguments &draw [[buffer(AAPLVertexInputIndexBindlessDraw)]])
+{
+    constant AAPLVertex *vertices = reinterpret_cast<constant AAPLVertex *>(table.buffers[draw.vertices]);
+    constant vector_uint2 *viewportSizePointer = reinterpret_cast<constant vector_uint2 *>(table.buffers[draw.viewportSize]);
+
+    RasterizerData out;
+
+    vector_float2 viewportSize = vector_float2(*viewportSizePointer);
+
+    out.position = vector_float4(0.0, 0.0, 0.0, 1.0);
+    out.position.xy = vertices[vertexID].position.xy / (viewportSize / 2.0);
+    out.color = vertices[vertexID].color;
+
+    return out;
+}
+
 fragment float4 fragmentShader(RasterizerData in [[stage_in]])
 {
     // Return the interpolated color.
@@ -16,6 +16,8 @@ typedef enum AAPLVertexInputIndex
 {
     AAPLVertexInputIndexVertices     = 0,
     AAPLVertexInputIndexViewportSize = 1,
+    AAPLVertexInputIndexBindlessTable = 2,
+    AAPLVertexInputIndexBindlessDraw  = 3,
 } AAPLVertexInputIndex;
 
 //  This structure defines the layout of vertices sent to the vertex
@@ -0,0 +1,98 @@
+/*
+Shaders for visibility buffer rendering: the geometry pass stores which
+triangle covers each pixel, and a compute pass shades every pixel once
+*/
+
+#include <metal_stdlib>
+
+using namespace metal;
+
+#include "triangle_types.h"
+#include "core/visibility_types.h"
+
+struct VisibilityRasterizerData
+{
+    float4 position [[position]];
+    uint instanceID [[flat]];
+};
+
+// Same transform as vertexShader in triangle.metal; no varyings besides the
+// instance, since attributes are reconstructed when shading.
+vertex VisibilityRasterizerData
+visibilityVertex(uint vertexID [[vertex_id]],
+                 uint instanceID [[instance_id]],
+                 constant AAPLVertex *vertices [[buffer(AAPLVertexInputIndexVertices)]],
+                 constant vector_uint2 *viewportSizePointer [[buffer(AAPLVertexInputIndexViewportSize)]])
+{
+    VisibilityRasterizerData out;
+
+    vector_float2 viewportSize = vector_float2(*viewportSizePointer);
+
+    out.position = vector_float4(0.0, 0.0, 0.0, 1.0);
+    out.position.xy = vertices[vertexID].position.xy / (viewportSize / 2.0);
+    out.instanceID = instanceID;
+
+    return out;
+}
+
+fragment uint
+visibilityFragment(VisibilityRasterizerData in [[stage_in]],
+                   uint primitiveID [[primitive_id]])
+{
+    return visibilityPack(in.instanceID, primitiveID);
+}
+
+// Window position of a vertex, as the rasterizer computed it in the geometry
+// pass: clip space from the vertex shader, then the viewport transform.
+static float2
+windowPosition(constant AAPLVertex &v, float2 viewportSize, float4 viewport)
+{
+    float2 ndc = v.position.xy / (viewportSize / 2.0);
+    return viewport.xy + float2(ndc.x * 0.5 + 0.5, 0.5 - ndc.y * 0.5) * viewport.zw;
+}
+
+static float
+edgeFunction(float2 a, float2 b, float2 p)
+{
+    return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+}
+
+// One thread per pixel. Fetches the triangle named by the visibility buffer,
+// rebuilds its barycentrics at the pixel center and runs fragmentShader's
+// shading. Instances of a draw share its vertices, so only the primitive
+// selects them.
+kernel void
+visibilityShade(uint2 gid [[thread_position_in_grid]],
+                texture2d<uint, access::read> visibility [[texture(VisibilityShadeIndexVisibility)]],
+                texture2d<float, access::write> output [[texture(VisibilityShadeIndexOutput)]],
+                constant AAPLVertex *vertices [[buffer(VisibilityShadeIndexVertices)]],
+                constant float4 &viewport [[buffer(VisibilityShadeIndexViewport)]],
+                constant vector_uint2 *viewportSizePointer [[buffer(VisibilityShadeIndexViewportSize)]])
+{
+    if (gid.x >= output.get_width() || gid.y >= output.get_height()) {
+        return;
+    }
+
+    uint id = visibility.read(gid).x;
+
+    if (id == VISIBILITY_EMPTY) {
+        output.write(float4(0.0, 0.0, 0.0, 1.0), gid);
+        return;
+    }
+
+    uint first = visibilityPrimitive(id) * 3;
+    float2 viewportSize = float2(*viewportSizePointer);
+
+    float2 p0 = windowPosition(vertices[first], viewportSize, viewport);
+    float2 p1 = windowPosition(vertices[first + 1], viewportSize, viewport);
+    float2 p2 = windowPosition(vertices[first + 2], viewportSize, viewport);
+
+    float2 p = float2(gid) + 0.5;
+    float area = edgeFunction(p0, p1, p2);
+
+    float3 b = float3(edgeFunction(p1, p2, p), edgeFunction(p2, p0, p), edgeFunction(p0, p1, p)) / area;
+
+    float4 color = vertices[first].color * b.x + vertices[first + 1].color * b.y + vertices[first + 2].color * b.z;
+
+    output.write(color, gid);
+}
@@ -0,0 +1,101 @@
+#include "visibility_buffer.h"
+#include "interned_string.h"
+#include "visibility_types.h"
+
+#include <iostream>
+
+namespace {
+
+#include "visibility_metallib.h"
+
+}
+
+VisibilityBuffer::VisibilityBuffer(MTL::Device *device)
+    : d_device(device) {
+    NS::Error *err;
+
+    auto library_data = dispatch_data_create(
+        &visibility_metallib[0], visibility_metallib_len,
+        dispatch_get_main_queue(),
+        ^{ });
+
+    auto library = MTL::make_owned(device->newLibrary(library_data, &err));
+
+    if (!library) {
+        std::cerr << "Failed to create visibility buffer library" << std::endl;
+        std::exit(-1);
+    }
+
+    auto vertex_function = MTL::make_owned(library->newFunction(NS_STATIC_STRING("visibilityVertex")));
+    auto fragment_function = MTL::make_owned(library->newFunction(NS_STATIC_STRING("visibilityFragment")));
+
+    auto pipeline_descriptor = MTL::make_owned(MTL::RenderPipelineDescriptor::alloc()->init());
+    pipeline_descriptor->setVertexFunction(vertex_function.get());
+    pipeline_descriptor->setFragmentFunction(fragment_function.get());
+    pipeline_descriptor->colorAttachments()->object(0)->setPixelFormat(MTL::PixelFormatR32Uint);
+
+    d_geometry_pipeline = MTL::make_owned(device->newRenderPipelineState(pipeline_descriptor.get(), &err));
+
+    if (!d_geometry_pipeline) {
+        std::cerr << "Failed to create visibility buffer geometry pipeline" << std::endl;
+        std::exit(-1);
+    }
+
+    auto shade_function = MTL::make_owned(library->newFunction(NS_STATIC_STRING("visibilityShade")));
+
+    d_shade_pipeline = MTL::make_owned(device->newComputePipelineState(shade_function.get(), &err));
+
+    if (!d_shade_pipeline) {
+        std::cerr << "Failed to create visibility buffer shading pipeline" << std::endl;
+        std::exit(-1);
+    }
+}
+
+MTL::shared_ptr<MTL::RenderPassDescriptor>
+VisibilityBuffer::geometryPass(NS::UInteger width, NS::UInteger height) {
+    if (!d_ids || d_ids->width() != width || d_ids->height() != height) {
+        auto texture_descriptor = MTL::TextureDescriptor::texture2DDescriptor(
+            MTL::PixelFormatR32Uint, width, height, false);
+        texture_descriptor->setUsage(MTL::TextureUsageRenderTarget | MTL::TextureUsageShaderRead);
+        texture_descriptor->setStorageMode(MTL::StorageModePrivate);
+
+        d_ids = MTL::make_owned(d_device->newTexture(texture_descriptor));
+    }
+
+    auto pass = MTL::make_owned(MTL::RenderPassDescriptor::alloc()->init());
+
+    auto color_attachment = pass->colorAttachments()->object(0);
+    color_attachment->setLoadAction(MTL::LoadAction::LoadActionClear);
+    color_attachment->setStoreAction(MTL::StoreAction::StoreActionStore);
+    color_attachment->setClearColor(MTL::ClearColor((double)VISIBILITY_EMPTY, 0.0, 0.0, 0.0));
+    color_attachment->setTexture(d_ids.get());
+
+    return pass;
+}
+
+void
+VisibilityBuffer::shade(MTL::CommandBuffer *buffer, MTL::Texture *target,
+    const void *vertices, NS::UInteger vertices_length,
+    const void *viewport_size, NS::UInteger viewport_size_length,
+    const MTL::Viewport& viewport) const {
+    float viewport_rect[4] = {
+        (float)viewport.originX, (float)viewport.originY,
+        (float)viewport.width, (float)viewport.height
+    };
+
+    auto encoder = buffer->computeCommandEncoder();
+
+    encoder->setComputePipelineState(d_shade_pipeline.get());
+    encoder->setTexture(d_ids.get(), VisibilityShadeIndexVisibility);
+    encoder->setTexture(target, VisibilityShadeIndexOutput);
+    encoder->setBytes(vertices, vertices_length, VisibilityShadeIndexVertices);
+    encoder->setBytes(viewport_rect, sizeof(viewport_rect), VisibilityShadeIndexViewport);
+    encoder->setBytes(viewport_size, viewport_size_length, VisibilityShadeIndexViewportSize);
+
+    // 2D threadgroups of one SIMD group's width, as tall as the pipeline allows.
+    NS::UInteger width = d_shade_pipeline->threadExecutionWidth();
+    NS::UInteger height = d_shade_pipeline->maxTotalThreadsPerThreadgroup() / width;
+    encoder->dispatchThreads(MTL::Size(target->width(), target->height(), 1), MTL::Size(width, height, 1));
+
+    encoder->endEncoding();
+}
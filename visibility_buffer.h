@@ -0,0 +1,42 @@
+#pragma once
+
+#include <Metal/Metal.hpp>
+#include <Metal/shared_ptr.hpp>
+
+// Two-phase rendering of the triangle scene: a geometry pass writes packed
+// (instance, primitive) IDs into an R32Uint target, then a compute pass reads
+// them back, reconstructs the triangle's attributes and shades each pixel
+// exactly once regardless of overdraw.
+class VisibilityBuffer {
+public:
+
+    explicit VisibilityBuffer(MTL::Device *device);
+
+    // Pipeline for the geometry pass; takes the same vertex buffers as the
+    // triangle pipeline.
+    MTL::RenderPipelineState *geometryPipeline() const {
+        return d_geometry_pipeline.get();
+    }
+
+    // Geometry pass into the ID target, reallocated to the given size when it
+    // changes and cleared to VISIBILITY_EMPTY.
+    MTL::shared_ptr<MTL::RenderPassDescriptor> geometryPass(NS::UInteger width, NS::UInteger height);
+
+    // Shades `target` from the ID target. `vertices` and `viewport_size` must
+    // be what the geometry pass drew with, and `viewport` its MTL::Viewport.
+    // `target` needs MTL::TextureUsageShaderWrite, so a drawable only works
+    // with CA::MetalLayer::framebufferOnly off.
+    void shade(MTL::CommandBuffer *buffer, MTL::Texture *target,
+        const void *vertices, NS::UInteger vertices_length,
+        const void *viewport_size, NS::UInteger viewport_size_length,
+        const MTL::Viewport& viewport) const;
+
+private:
+
+    MTL::Device *d_device;
+
+    MTL::shared_ptr<MTL::RenderPipelineState> d_geometry_pipeline;
+    MTL::shared_ptr<MTL::ComputePipelineState> d_shade_pipeline;
+
+    MTL::shared_ptr<MTL::Texture> d_ids;
+};
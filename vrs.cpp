@@ -0,0 +1,110 @@
+#include "vrs.h"
+#include "interned_string.h"
+#include "vrs_types.h"
+
+#include <iostream>
+
+namespace {
+
+#include "vrs_metallib.h"
+
+}
+
+VariableRateShading::VariableRateShading(MTL::Device *device, MTL::PixelFormat pixel_format)
+    : d_device(device)
+    , d_pixel_format(pixel_format) {
+    NS::Error *err;
+
+    auto library_data = dispatch_data_create(
+        &vrs_metallib[0], vrs_metallib_len,
+        dispatch_get_main_queue(),
+        ^{ });
+
+    auto library = MTL::make_owned(device->newLibrary(library_data, &err));
+
+    if (!library) {
+        std::cerr << "Failed to create VRS library" << std::endl;
+        std::exit(-1);
+    }
+
+    auto vertex_function = MTL::make_owned(library->newFunction(NS_STATIC_STRING("vrsResolveVertex")));
+    auto fragment_function = MTL::make_owned(library->newFunction(NS_STATIC_STRING("vrsResolveFragment")));
+
+    auto pipeline_descriptor = MTL::make_owned(MTL::RenderPipelineDescriptor::alloc()->init());
+    pipeline_descriptor->setVertexFunction(vertex_function.get());
+    pipeline_descriptor->setFragmentFunction(fragment_function.get());
+    pipeline_descriptor->colorAttachments()->object(0)->setPixelFormat(pixel_format);
+
+    d_resolve_pipeline = MTL::make_owned(device->newRenderPipelineState(pipeline_descriptor.get(), &err));
+
+    if (!d_resolve_pipeline) {
+        std::cerr << "Failed to create VRS resolve pipeline" << std::endl;
+        std::exit(-1);
+    }
+}
+
+void
+VariableRateShading::update(const RateMapLayer& layer, NS::UInteger screen_width, NS::UInteger screen_height) {
+    auto layer_descriptor = MTL::make_owned(MTL::RasterizationRateLayerDescriptor::alloc()->init(
+        MTL::Size(layer.horizontal.size(), layer.vertical.size(), 1),
+        layer.horizontal.data(), layer.vertical.data()));
+
+    auto map_descriptor = MTL::RasterizationRateMapDescriptor::rasterizationRateMapDescriptor(
+        MTL::Size(screen_width, screen_height, 0), layer_descriptor.get());
+
+    d_rate_map = MTL::make_owned(d_device->newRasterizationRateMap(map_descriptor));
+
+    if (!d_rate_map) {
+        std::cerr << "Failed to create rasterization rate map" << std::endl;
+        std::exit(-1);
+    }
+
+    auto parameter_size = d_rate_map->parameterBufferSizeAndAlign();
+    d_rate_map_data = MTL::make_owned(d_device->newBuffer(parameter_size.size, MTL::ResourceStorageModeShared));
+    d_rate_map->copyParameterDataToBuffer(d_rate_map_data.get(), 0);
+
+    auto physical_size = d_rate_map->physicalSize(0);
+
+    auto texture_descriptor = MTL::TextureDescriptor::texture2DDescriptor(
+        d_pixel_format, physical_size.width, physical_size.height, false);
+    texture_descriptor->setUsage(MTL::TextureUsageRenderTarget | MTL::TextureUsageShaderRead);
+    texture_descriptor->setStorageMode(MTL::StorageModePrivate);
+
+    d_physical_color = MTL::make_owned(d_device->newTexture(texture_descriptor));
+
+    d_screen_width = screen_width;
+    d_screen_height = screen_height;
+}
+
+MTL::shared_ptr<MTL::RenderPassDescriptor>
+VariableRateShading::renderPass() const {
+    auto pass = MTL::make_owned(MTL::RenderPassDescriptor::alloc()->init());
+
+    auto color_attachment = pass->colorAttachments()->object(0);
+    color_attachment->setLoadAction(MTL::LoadAction::LoadActionClear);
+    color_attachment->setStoreAction(MTL::StoreAction::StoreActionStore);
+    color_attachment->setTexture(d_physical_color.get());
+
+    pass->setRasterizationRateMap(d_rate_map.get());
+
+    return pass;
+}
+
+void
+VariableRateShading::resolve(MTL::CommandBuffer *buffer, MTL::Texture *target) const {
+    auto pass = MTL::make_owned(MTL::RenderPassDescriptor::alloc()->init());
+
+    auto color_attachment = pass->colorAttachments()->object(0);
+    color_attachment->setLoadAction(MTL::LoadAction::LoadActionDontCare);
+    color_attachment->setStoreAction(MTL::StoreAction::StoreActionStore);
+    color_attachment->setTexture(target);
+
+    auto encoder = buffer->renderCommandEncoder(pass.get());
+
+    encoder->setRenderPipelineState(d_resolve_pipeline.get());
+    encoder->setFragmentBuffer(d_rate_map_data.get(), 0, VRSResolveInputIndexRateMapData);
+    encoder->setFragmentTexture(d_physical_color.get(), VRSResolveInputIndexPhysicalColor);
+    encoder->drawPrimitives(MTL::PrimitiveType::PrimitiveTypeTriangle, NS::UInteger(0), NS::UInteger(3));
+
+    encoder->endEncoding();
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "rate_map.h"
+
+#include <Metal/Metal.hpp>
+#include <Metal/shared_ptr.hpp>
+
+// Renders into a reduced-resolution target described by a
+// `MTL::RasterizationRateMap` and upscales it into the drawable.
+class VariableRateShading {
+public:
+
+    VariableRateShading(MTL::Device *device, MTL::PixelFormat pixel_format);
+
+    // Rebuilds the rate map and physical target for a screen of the given size.
+    void update(const RateMapLayer& layer, NS::UInteger screen_width, NS::UInteger screen_height);
+
+    // Pass that rasterizes the scene at the rates of the current map. Viewports
+    // set on it are in screen coordinates.
+    MTL::shared_ptr<MTL::RenderPassDescriptor> renderPass() const;
+
+    // Writes the physical target into `target` at screen resolution.
+    void resolve(MTL::CommandBuffer *buffer, MTL::Texture *target) const;
+
+    NS::UInteger screenWidth() const {
+        return d_screen_width;
+    }
+
+    NS::UInteger screenHeight() const {
+        return d_screen_height;
+    }
+
+private:
+
+    MTL::Device *d_device;
+    MTL::PixelFormat d_pixel_format;
+
+    MTL::shared_ptr<MTL::RenderPipelineState> d_resolve_pipeline;
+
+    MTL::shared_ptr<MTL::RasterizationRateMap> d_rate_map;
+    MTL::shared_ptr<MTL::Buffer> d_rate_map_data;
+    MTL::shared_ptr<MTL::Texture> d_physical_color;
+
+    NS::UInteger d_screen_width = 0, d_screen_height = 0;
+};
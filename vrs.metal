@@ -0,0 +1,42 @@
+/*
+Shaders that resolve a scene rendered with a rasterization rate map back to
+screen resolution
+*/
+
+#include <metal_stdlib>
+
+using namespace metal;
+
+#include "vrs_types.h"
+
+struct ResolveData
+{
+    float4 position [[position]];
+};
+
+// Draws a single triangle that covers the whole screen.
+vertex ResolveData
+vrsResolveVertex(uint vertexID [[vertex_id]])
+{
+    ResolveData out;
+
+    float2 uv = float2((vertexID << 1) & 2, vertexID & 2);
+    out.position = float4(uv * 2.0 - 1.0, 0.0, 1.0);
+
+    return out;
+}
+
+fragment float4
+vrsResolveFragment(ResolveData in [[stage_in]],
+                   constant rasterization_rate_map_data &data [[buffer(VRSResolveInputIndexRateMapData)]],
+                   texture2d<float> physicalColor [[texture(VRSResolveInputIndexPhysicalColor)]])
+{
+    constexpr sampler s(coord::pixel, address::clamp_to_edge, filter::linear);
+
+    // The position is in screen pixels; find where that pixel was rasterized
+    // in the physical target.
+    rasterization_rate_map_decoder map(data);
+    float2 physicalCoordinates = map.map_screen_to_physical_coordinates(in.position.xy);
+
+    return physicalColor.sample(s, physicalCoordinates);
+}
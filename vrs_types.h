@@ -0,0 +1,17 @@
+/*
+Header containing types and enum constants shared between the variable rate
+shading resolve shader and C++ code
+*/
+
+#ifndef vrs_types_H
+#define vrs_types_H
+
+// Buffer and texture indices for the pass that upscales the reduced-resolution
+// physical render target into the drawable.
+typedef enum VRSResolveInputIndex
+{
+    VRSResolveInputIndexRateMapData    = 0,
+    VRSResolveInputIndexPhysicalColor  = 0,
+} VRSResolveInputIndex;
+
+#endif /* vrs_types_H */